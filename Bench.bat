@@ -0,0 +1,31 @@
+@if not exist Build\bench\ (
+    @mkdir Build\bench
+)
+
+@if "%~1" == "" (
+	echo "Error: First parameter needs to be name of the benchmark to run"
+	exit /B 1
+)
+
+@rem Everything except the program entry point is linked into the benchmark, extra parameters are passed to the compiler (e.g. -DHS_SLOT_STACK)
+@pushd "Script/src"
+@set objs=
+@for /R %%f in (*.c) do @if /I not "%%~nxf" == "main.c" @call set objs=%%objs%% %%f
+@popd
+
+@set flags=
+@for /f "tokens=1,* delims= " %%a in ("%*") do @set flags=%%b
+
+clang -O2 -DNDEBUG -std=c99 -D_CRT_SECURE_NO_WARNINGS %flags% -o Build/bench/BenchMain.exe -I Script/include Script/bench/%1_bench.c %objs%
+
+@echo off
+set err=%errorlevel%
+
+if %err% NEQ 0 (
+    exit /B 1
+)
+
+pushd Data
+..\Build\bench\BenchMain.exe
+
+popd
@@ -0,0 +1,130 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "async.h"
+#include "bytecode_c.h"
+#include "embed.h"
+#include "scheduler.h"
+
+// Scripts waiting on simulated I/O, all on one thread. Every call of read() takes LATENCY ticks
+// to complete, the host posts its completion when it is due. A blocking read would keep the
+// thread for all of that time, with async calls the thread only resumes the scripts whose reads
+// are done. The nanoseconds per read are what it costs to park, post, complete and resume, the
+// last column is the same loop calling a native that returns right away.
+
+enum { LATENCY = 4, READS = 20 };
+
+static const int NUM_READS = 2000000;
+
+static char s_code[] =
+    "fun load(id: int): int\n"
+    "{\n"
+    "    var sum: int = 0; var i: int = 0;\n"
+    "    while (i < 20) { sum = sum + read(id); i = i + 1; }\n"
+    "    return sum;\n"
+    "}\n";
+
+// The tokens of the reads due in each of the next LATENCY ticks
+static int* s_due[LATENCY];
+static int s_dueCount[LATENCY];
+static int s_tick;
+
+static void NativeRead(SVMData* vmData)
+{
+    int id = (int)PopInt(&vmData->dataStack.base.stackPointer);
+    int slot = (s_tick + LATENCY - 1) % LATENCY;
+    s_due[slot][s_dueCount[slot]++] = id;
+    vmData->asyncCall = id;
+}
+
+static void NativeReadNow(SVMData* vmData)
+{
+    hsbint id = PopInt(&vmData->dataStack.base.stackPointer);
+    PushInt(&vmData->dataStack.base.stackPointer, id & 7);
+}
+
+static Bool8 CreateLoader(NativeFP* read, Bool8 isAsync, SProgram* outProgram)
+{
+    SNativeTable natives;
+    InitNativeTable(&natives);
+    if (isAsync)
+        RegisterAsyncNative(&natives, "read", "int(int)", read);
+    else
+        RegisterNative(&natives, "read", "int(int)", read);
+    EResult result = CreateProgram(s_code, strlen(s_code), &natives, outProgram);
+    DeleteNativeTable(&natives);
+    return result == R_OK;
+}
+
+static double Seconds(clock_t start)
+{
+    return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+int main()
+{
+    SProgram program;
+    SProgram blocking;
+    if (!CreateLoader(NativeRead, HS_TRUE, &program) || !CreateLoader(NativeReadNow, HS_FALSE, &blocking))
+        return 1;
+
+    SScriptContext context;
+    InitScriptContext(&context, &blocking);
+    clock_t start = clock();
+    for (int i = 0; i < NUM_READS / READS; ++i)
+        CallFunction(&context, FindFunction(&blocking, "load"), (SScriptValue[]){ { .i = i } }, 1, NULL);
+    double direct = Seconds(start) / NUM_READS;
+    DeleteScriptContext(&context);
+
+    printf("%-10s %10s %12s %14s %12s %12s\n", "in flight", "ticks", "tick [us]", "reads [1/s]", "read [ns]", "direct [ns]");
+
+    // the ids of the instances are the tokens, they have to fit an hsbint
+    for (int instances = 100; instances <= 10000; instances *= 10)
+    {
+        for (int i = 0; i < LATENCY; ++i)
+        {
+            s_due[i] = malloc(instances * sizeof(int));
+            s_dueCount[i] = 0;
+        }
+
+        SScheduler scheduler;
+        InitScheduler(&scheduler, &program, 1000);
+        for (int i = 0; i < instances; ++i)
+            SpawnInstance(&scheduler, FindFunction(&program, "load"), (SScriptValue[]){ { .i = i } }, 1);
+
+        // the I/O of a tick is done at its end, the reads started in it are due LATENCY ticks later
+        int rounds = NUM_READS / (instances * READS) > 0 ? NUM_READS / (instances * READS) : 1;
+        int ticks = 0;
+        start = clock();
+        for (int round = 0; round < rounds; ++round)
+        {
+            while (RunSchedulerTick(&scheduler) > 0)
+            {
+                int slot = s_tick++ % LATENCY;
+                for (int i = 0; i < s_dueCount[slot]; ++i)
+                    PostCompletion(&scheduler.completions, s_due[slot][i], (SScriptValue){ .i = s_due[slot][i] & 7 });
+                s_dueCount[slot] = 0;
+                ++ticks;
+            }
+
+            for (int i = 0; round + 1 < rounds && i < instances; ++i)
+            {
+                FreeInstance(&scheduler, i);
+                SpawnInstance(&scheduler, FindFunction(&program, "load"), (SScriptValue[]){ { .i = i } }, 1);
+            }
+        }
+        double seconds = Seconds(start);
+        DeleteScheduler(&scheduler);
+        for (int i = 0; i < LATENCY; ++i)
+            free(s_due[i]);
+
+        double reads = (double)rounds * instances * READS;
+        printf("%-10d %10d %12.1f %14.0f %12.1f %12.1f\n", instances, ticks, seconds * 1e6 / ticks, reads / seconds,
+            seconds * 1e9 / reads, direct * 1e9);
+    }
+
+    DeleteProgram(&program);
+    DeleteProgram(&blocking);
+    return 0;
+}
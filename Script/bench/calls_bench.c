@@ -0,0 +1,232 @@
+#include <stdio.h>
+#include <time.h>
+
+#include "bytecode_c.h"
+#include "stack_usage.h"
+
+// Recursive calls with the arguments copied to variables (ALLOC_VAR, SAVE_VAR ... DEALLOC_VAR,
+// RETURN) against INS_ENTER frames, where they stay on the operand stack (ENTER ... LEAVE_I)
+
+static const int DATA_SIZE = 1 << 16;
+static const int NUM_RUNS = 20;
+
+typedef struct
+{
+    SStackData s;
+    Bool8 useFrames;
+    int argumentCount;
+} SBuilder;
+
+static void AddInt(SStackData* instructionStack, EInstruction instruction, hsbint value)
+{
+    AddInstruction(instructionStack, instruction);
+    StoreIntFwd(&instructionStack->stackPointer, value);
+}
+
+static void AddOffset(SStackData* instructionStack, EInstruction instruction, int offset)
+{
+    AddInstruction(instructionStack, instruction);
+    *instructionStack->stackPointer++ = offset;
+}
+
+static hsbaddress AddJump(SStackData* instructionStack, EInstruction instruction, hsbaddress address)
+{
+    hsbaddress position = instructionStack->stackPointer - instructionStack->begin;
+    AddInstruction(instructionStack, instruction);
+    StoreAddress(instructionStack->stackPointer, address);
+    instructionStack->stackPointer += sizeof(hsbaddress);
+    return position;
+}
+
+static hsbaddress Here(SBuilder* b)
+{
+    return b->s.stackPointer - b->s.begin;
+}
+
+static void Patch(SBuilder* b, hsbaddress jump)
+{
+    StoreAddress(b->s.begin + jump + 1, Here(b));
+}
+
+// The int arguments of the function become its locals
+static void Enter(SBuilder* b)
+{
+    if (b->useFrames)
+    {
+        AddInstruction(&b->s, INS_ENTER);
+        *b->s.stackPointer++ = b->argumentCount * HS_DATA_SIZE_INT;
+        *b->s.stackPointer++ = 0;
+        *b->s.stackPointer++ = 0;
+        return;
+    }
+
+    for (int i = 0; i < b->argumentCount; ++i)
+        AddInstruction(&b->s, INS_ALLOC_VAR_I);
+    for (int i = 0; i < b->argumentCount; ++i)
+        AddOffset(&b->s, INS_SAVE_VAR_I, i * HS_DATA_SIZE_INT);
+}
+
+static void LoadArgument(SBuilder* b, int argument)
+{
+    if (b->useFrames)
+        AddOffset(&b->s, INS_LOAD_FRAME_I, argument * HS_DATA_SIZE_INT);
+    else
+        AddOffset(&b->s, INS_LOAD_VAR_I, (b->argumentCount - 1 - argument) * HS_DATA_SIZE_INT);
+}
+
+// Returns the int on top
+static void Leave(SBuilder* b)
+{
+    if (b->useFrames)
+    {
+        AddInstruction(&b->s, INS_LEAVE_I);
+        return;
+    }
+
+    for (int i = 0; i < b->argumentCount; ++i)
+        AddInstruction(&b->s, INS_DEALLOC_VAR_I);
+    AddInstruction(&b->s, INS_RETURN);
+}
+
+static SStackData Finish(SBuilder* b)
+{
+    b->s.end = b->s.stackPointer;
+    b->s.stackPointer = b->s.begin;
+    return b->s;
+}
+
+// fib(n) = n < 2 ? n : fib(n - 1) + fib(n - 2)
+static SStackData Fibonacci(hsbint n, Bool8 useFrames)
+{
+    SBuilder b = { CreateStack(200), useFrames, 1 };
+    AddInt(&b.s, INS_LITERAL_I, n);
+    hsbaddress call = AddJump(&b.s, INS_CALL, 0);
+    AddInstruction(&b.s, INS_END);
+
+    hsbaddress function = Here(&b);
+    Patch(&b, call);
+    Enter(&b);
+    LoadArgument(&b, 0);
+    AddInt(&b.s, INS_LITERAL_I, 2);
+    AddInstruction(&b.s, INS_CMP_I_LESS);
+    hsbaddress small = AddJump(&b.s, INS_COND_JUMP_B, 0);
+    LoadArgument(&b, 0);
+    AddInt(&b.s, INS_ADD_LITERAL_I, -1);
+    AddJump(&b.s, INS_CALL, function);
+    LoadArgument(&b, 0);
+    AddInt(&b.s, INS_ADD_LITERAL_I, -2);
+    AddJump(&b.s, INS_CALL, function);
+    AddInstruction(&b.s, INS_ADD_I);
+    Leave(&b);
+
+    Patch(&b, small);
+    LoadArgument(&b, 0);
+    Leave(&b);
+    return Finish(&b);
+}
+
+// ack(m, n) = m == 0 ? n + 1 : n == 0 ? ack(m - 1, 1) : ack(m - 1, ack(m, n - 1))
+static SStackData Ackermann(hsbint m, hsbint n, Bool8 useFrames)
+{
+    SBuilder b = { CreateStack(200), useFrames, 2 };
+    AddInt(&b.s, INS_LITERAL_I, m);
+    AddInt(&b.s, INS_LITERAL_I, n);
+    hsbaddress call = AddJump(&b.s, INS_CALL, 0);
+    AddInstruction(&b.s, INS_END);
+
+    hsbaddress function = Here(&b);
+    Patch(&b, call);
+    Enter(&b);
+    LoadArgument(&b, 0);
+    AddInt(&b.s, INS_LITERAL_I, 0);
+    AddInstruction(&b.s, INS_CMP_I_EQ);
+    hsbaddress mZero = AddJump(&b.s, INS_COND_JUMP_B, 0);
+    LoadArgument(&b, 1);
+    AddInt(&b.s, INS_LITERAL_I, 0);
+    AddInstruction(&b.s, INS_CMP_I_EQ);
+    hsbaddress nZero = AddJump(&b.s, INS_COND_JUMP_B, 0);
+
+    LoadArgument(&b, 0);
+    AddInt(&b.s, INS_ADD_LITERAL_I, -1);
+    LoadArgument(&b, 0);
+    LoadArgument(&b, 1);
+    AddInt(&b.s, INS_ADD_LITERAL_I, -1);
+    AddJump(&b.s, INS_CALL, function);
+    AddJump(&b.s, INS_CALL, function);
+    Leave(&b);
+
+    Patch(&b, mZero);
+    LoadArgument(&b, 1);
+    AddInt(&b.s, INS_ADD_LITERAL_I, 1);
+    Leave(&b);
+
+    Patch(&b, nZero);
+    LoadArgument(&b, 0);
+    AddInt(&b.s, INS_ADD_LITERAL_I, -1);
+    AddInt(&b.s, INS_LITERAL_I, 1);
+    AddJump(&b.s, INS_CALL, function);
+    Leave(&b);
+    return Finish(&b);
+}
+
+// Runs the program NUM_RUNS times, returns the result or -1 when it failed
+static int Run(SStackData instructions, int* outDispatches, double* outSeconds)
+{
+    SStackUsage usage;
+    if (AnalyzeStackUsage(instructions, &usage) != R_OK)
+    {
+        printf("ERROR: %s at %d\n", usage.error, usage.errorOffset);
+        return -1;
+    }
+
+    SVMData vmData;
+    FuncArray funcArray = { 0 };
+    InitVMForProgram(&vmData, instructions, &usage, DATA_SIZE, funcArray);
+    FreeStackUsage(&usage);
+
+    *outDispatches = 1;
+    while (VMProcessInstructions(&vmData, 1))
+        ++*outDispatches;
+
+    clock_t start = clock();
+    for (int run = 0; run < NUM_RUNS; ++run)
+    {
+        vmData.instructionStack.stackPointer = vmData.instructionStack.begin;
+        vmData.dataStack.base.stackPointer = vmData.dataStack.base.begin;
+        while (VMProcessInstructions(&vmData, 1 << 30))
+        {
+        }
+    }
+    *outSeconds = (double)(clock() - start) / CLOCKS_PER_SEC / NUM_RUNS;
+
+    int result = vmData.error == VM_OK ? LoadVarInt(vmData.dataStack.base.begin) : -1;
+    DeleteVM(&vmData, HS_TRUE, HS_TRUE);
+    return result;
+}
+
+static void Compare(const char* name, SStackData variables, SStackData frames)
+{
+    int dispatches, frameDispatches;
+    double seconds, frameSeconds;
+    int result = Run(variables, &dispatches, &seconds);
+    int frameResult = Run(frames, &frameDispatches, &frameSeconds);
+
+    printf("%-16s %8d %10d %10d %10.2f %10.2f %7.2fx%s\n",
+        name, result, dispatches, frameDispatches, seconds * 1000.0, frameSeconds * 1000.0,
+        seconds / frameSeconds, result == frameResult ? "" : " RESULTS DIFFER");
+
+    DeleteStack(variables);
+    DeleteStack(frames);
+}
+
+int main()
+{
+    printf("%-16s %8s %10s %10s %10s %10s %8s\n", "program", "result", "dispatches", "frames", "time [ms]", "frames [ms]", "speedup");
+
+    Compare("fib(20)", Fibonacci(20, HS_FALSE), Fibonacci(20, HS_TRUE));
+    Compare("fib(22)", Fibonacci(22, HS_FALSE), Fibonacci(22, HS_TRUE));
+    Compare("ack(2, 200)", Ackermann(2, 200, HS_FALSE), Ackermann(2, 200, HS_TRUE));
+    Compare("ack(3, 6)", Ackermann(3, 6, HS_FALSE), Ackermann(3, 6, HS_TRUE));
+
+    return 0;
+}
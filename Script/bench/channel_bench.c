@@ -0,0 +1,203 @@
+#if !defined(_WIN32)
+    // clock_gettime is not part of C99
+    #define _POSIX_C_SOURCE 199309L
+#endif
+
+#include <stdio.h>
+#include <time.h>
+#if defined(_WIN32)
+#include <windows.h>
+#endif
+
+#include "bytecode_c.h"
+#include "channel.h"
+#include "embed.h"
+#include "scheduler.h"
+#include "thread_pool.h"
+
+// Scripts on different threads passing values through channels. Throughput: 1 to 3 producer
+// scripts, each on a thread of its own, send to a consumer script on another one, the host
+// column is the same channel used from C without VMs. Latency: two scripts on two threads
+// send a value back and forth, the round trip includes waking the waiting one through its
+// scheduler. A thread whose instances all wait gives up its time slice (YieldThread), so on
+// fewer cores than threads the numbers are mostly the time slices of the OS.
+
+enum { CAPACITY = 1024, MESSAGES = 30000, ROUNDS = 10, ROUND_TRIPS = 20000, MAX_PRODUCERS = 3 };
+
+static char s_code[] =
+    "fun produce(channel: int, count: int): int\n"
+    "{\n"
+    "    var i: int = 0;\n"
+    "    while (i < count) { if (send(channel, i) == 1) i = i + 1; else yield; }\n"
+    "    return i;\n"
+    "}\n"
+    "fun consume(channel: int, count: int): int\n"
+    "{\n"
+    "    var sum: int = 0; var i: int = 0;\n"
+    "    while (i < count) { sum = sum + receive(channel); i = i + 1; }\n"
+    "    return sum;\n"
+    "}\n"
+    "fun ping(to: int, from: int, count: int): int\n"
+    "{\n"
+    "    var i: int = 0;\n"
+    "    while (i < count) { while (send(to, i) == 0) yield; i = receive(from) + 1; }\n"
+    "    return i;\n"
+    "}\n"
+    "fun pong(from: int, to: int, count: int): int\n"
+    "{\n"
+    "    var i: int = 0;\n"
+    "    while (i < count) { var value: int = receive(from); while (send(to, value) == 0) yield; i = i + 1; }\n"
+    "    return i;\n"
+    "}\n";
+
+typedef struct
+{
+    SProgram* program;
+    SScheduler schedulers[MAX_PRODUCERS + 1];
+    int producers;      // Threads 0 to producers - 1, the consumer is the last thread
+    int channels[2];
+    SScriptValue arguments[MAX_PRODUCERS + 1][3];
+    const char* functions[MAX_PRODUCERS + 1];
+    int argumentCounts[MAX_PRODUCERS + 1];
+} SBench;
+
+static double WallSeconds()
+{
+#if defined(_WIN32)
+    LARGE_INTEGER now, frequency;
+    QueryPerformanceCounter(&now);
+    QueryPerformanceFrequency(&frequency);
+    return (double)now.QuadPart / frequency.QuadPart;
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec * 1e-9;
+#endif
+}
+
+//------------------------------------------------------------------------------
+// Each thread runs the function of its scheduler ROUNDS times, the last thread is the consumer
+static void RunScripts(void* data, int thread)
+{
+    SBench* bench = data;
+    int index = thread < bench->producers ? thread : MAX_PRODUCERS;
+    if (thread > bench->producers)
+        return;
+
+    SScheduler* scheduler = &bench->schedulers[index];
+    int function = FindFunction(bench->program, bench->functions[index]);
+    for (int round = 0; round < ROUNDS; ++round)
+    {
+        SpawnInstance(scheduler, function, bench->arguments[index], bench->argumentCounts[index]);
+        while (RunSchedulerTick(scheduler) > 0)
+        {
+            if (scheduler->runningCount == 0)
+                YieldThread();
+        }
+        FreeInstance(scheduler, 0);
+    }
+}
+
+//------------------------------------------------------------------------------
+static void RunHost(void* data, int thread)
+{
+    SBench* bench = data;
+    SChannel* channel = GetChannel(bench->channels[0]);
+    if (thread < bench->producers)
+    {
+        for (int i = 0; i < ROUNDS * MESSAGES; ++i)
+        {
+            while (!SendValue(channel, (SScriptValue){ .i = (hsbint)i }))
+                YieldThread();
+        }
+    }
+    else if (thread == bench->producers)
+    {
+        SScriptValue value;
+        for (int i = 0; i < ROUNDS * MESSAGES * bench->producers; ++i)
+        {
+            while (!ReceiveValue(channel, &value))
+                YieldThread();
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+static double Run(SBench* bench, SProgram* program, int producers, ThreadWork* work)
+{
+    bench->program = program;
+    bench->producers = producers;
+    for (int i = 0; i <= MAX_PRODUCERS; ++i)
+        InitScheduler(&bench->schedulers[i], program, 1000);
+
+    SThreadPool* pool = CreateThreadPool(producers + 1);
+    double start = WallSeconds();
+    RunOnThreads(pool, work, bench);
+    double seconds = WallSeconds() - start;
+    DeleteThreadPool(pool);
+
+    for (int i = 0; i <= MAX_PRODUCERS; ++i)
+        DeleteScheduler(&bench->schedulers[i]);
+    return seconds;
+}
+
+int main()
+{
+    SNativeTable natives;
+    InitNativeTable(&natives);
+    RegisterChannelNatives(&natives);
+    SProgram program;
+    EResult result = CreateProgram(s_code, strlen(s_code), &natives, &program);
+    DeleteNativeTable(&natives);
+    if (result != R_OK)
+        return 1;
+
+    static SBench bench;
+    printf("%-10s %8s %16s %16s %12s\n", "producers", "kind", "scripts [1/s]", "host [1/s]", "send [ns]");
+    for (int producers = 1; producers <= MAX_PRODUCERS; ++producers)
+    {
+        // the completions are the consumer's, its scheduler is set up again by Run
+        bench.channels[0] = CreateChannel(CAPACITY, producers == 1, &bench.schedulers[MAX_PRODUCERS].completions, 0);
+        for (int i = 0; i < producers; ++i)
+        {
+            bench.functions[i] = "produce";
+            bench.arguments[i][0].i = (hsbint)bench.channels[0];
+            bench.arguments[i][1].i = MESSAGES / producers;
+            bench.argumentCounts[i] = 2;
+        }
+        bench.functions[MAX_PRODUCERS] = "consume";
+        bench.arguments[MAX_PRODUCERS][0].i = (hsbint)bench.channels[0];
+        bench.arguments[MAX_PRODUCERS][1].i = (hsbint)(MESSAGES / producers * producers);
+        bench.argumentCounts[MAX_PRODUCERS] = 2;
+
+        double messages = (double)ROUNDS * (MESSAGES / producers * producers);
+        double scripts = Run(&bench, &program, producers, RunScripts);
+        double host = Run(&bench, &program, producers, RunHost);
+        printf("%-10d %8s %16.0f %16.0f %12.1f\n", producers, producers == 1 ? "SPSC" : "MPSC", messages / scripts,
+            (double)ROUNDS * MESSAGES * producers / host, scripts * 1e9 / messages);
+        DeleteChannel(bench.channels[0]);
+    }
+
+    // one script on each of two threads, the consumer slot runs pong
+    bench.channels[0] = CreateChannel(16, HS_TRUE, &bench.schedulers[MAX_PRODUCERS].completions, 0);
+    bench.channels[1] = CreateChannel(16, HS_TRUE, &bench.schedulers[0].completions, 1);
+    bench.functions[0] = "ping";
+    bench.arguments[0][0].i = (hsbint)bench.channels[0];
+    bench.arguments[0][1].i = (hsbint)bench.channels[1];
+    bench.arguments[0][2].i = ROUND_TRIPS;
+    bench.argumentCounts[0] = 3;
+    bench.functions[MAX_PRODUCERS] = "pong";
+    bench.arguments[MAX_PRODUCERS][0].i = (hsbint)bench.channels[0];
+    bench.arguments[MAX_PRODUCERS][1].i = (hsbint)bench.channels[1];
+    bench.arguments[MAX_PRODUCERS][2].i = ROUND_TRIPS;
+    bench.argumentCounts[MAX_PRODUCERS] = 3;
+
+    double seconds = Run(&bench, &program, 1, RunScripts);
+    printf("\n%-10s %16s\n", "latency", "round trip [ns]");
+    printf("%-10s %16.0f\n", "ping-pong", seconds * 1e9 / ((double)ROUNDS * ROUND_TRIPS));
+
+    DeleteChannel(bench.channels[0]);
+    DeleteChannel(bench.channels[1]);
+    DeleteProgram(&program);
+    return 0;
+}
@@ -0,0 +1,137 @@
+#include <stdio.h>
+#include <time.h>
+
+#include "bytecode_c.h"
+#include "embed.h"
+
+// Cost of calling a script function from the host with CallFunction, per call, against the
+// same function called from a loop in the script itself. Then a frame of entities updated
+// with a call each against a single CallFunctionBatch.
+
+static const int NUM_CALLS = 1000000;
+static const int NUM_ENTITIES = 100000;
+static const int NUM_FRAMES = 20;
+
+static char s_code[] =
+    "fun add(a: int, b: int): int { return a + b; }\n"
+    "fun update(position: float, velocity: float, dt: float): float { return position + velocity * dt; }\n"
+    "fun loopAdd(count: int): int { var i: int = 0; var s: int = 0; while (i < count) { s = add(s, 1); i = i + 1; } return s; }\n"
+    "fun loopUpdate(count: int): float\n"
+    "{\n"
+    "    var i: int = 0; var p: float = 0.0;\n"
+    "    while (i < count) { p = update(p, 2.0, 0.5); i = i + 1; }\n"
+    "    return p;\n"
+    "}\n";
+
+static double Seconds(clock_t start)
+{
+    return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+int main()
+{
+    SProgram program;
+    if (CreateProgram(s_code, strlen(s_code), NULL, &program) != R_OK)
+        return 1;
+
+    SScriptContext context;
+    InitScriptContext(&context, &program);
+
+    int add = FindFunction(&program, "add");
+    int update = FindFunction(&program, "update");
+    int loopAdd = FindFunction(&program, "loopAdd");
+    int loopUpdate = FindFunction(&program, "loopUpdate");
+
+    printf("%-10s %12s %12s %12s\n", "function", "host [ns]", "script [ns]", "overhead");
+
+    // add from the host
+    SScriptValue arguments[3];
+    SScriptValue result = { .i = 0 };
+    clock_t start = clock();
+    for (int i = 0; i < NUM_CALLS; ++i)
+    {
+        arguments[0].i = result.i;
+        arguments[1].i = 1;
+        CallFunction(&context, add, arguments, 2, &result);
+    }
+    double host = Seconds(start);
+    hsbint hostSum = result.i;
+
+    // add from a loop in the script, 30000 calls at a time to stay in the int range
+    start = clock();
+    hsbint scriptSum = 0;
+    for (int i = 0; i < NUM_CALLS / 30000; ++i)
+    {
+        arguments[0].i = 30000;
+        CallFunction(&context, loopAdd, arguments, 1, &result);
+        scriptSum += result.i;
+    }
+    double script = Seconds(start) * NUM_CALLS / (NUM_CALLS / 30000 * 30000);
+    printf("%-10s %12.1f %12.1f %11.2fx%s\n", "add", host * 1e9 / NUM_CALLS, script * 1e9 / NUM_CALLS, host / script,
+        hostSum == (hsbint)NUM_CALLS && scriptSum == (hsbint)(NUM_CALLS / 30000 * 30000) ? "" : " WRONG RESULT");
+
+    // update from the host
+    SScriptValue position = { .f = 0.0f };
+    start = clock();
+    for (int i = 0; i < NUM_CALLS; ++i)
+    {
+        arguments[0].f = position.f;
+        arguments[1].f = 2.0f;
+        arguments[2].f = 0.5f;
+        CallFunction(&context, update, arguments, 3, &position);
+    }
+    host = Seconds(start);
+
+    start = clock();
+    arguments[0].i = 30000;
+    for (int i = 0; i < NUM_CALLS / 30000; ++i)
+        CallFunction(&context, loopUpdate, arguments, 1, &result);
+    script = Seconds(start) * NUM_CALLS / (NUM_CALLS / 30000 * 30000);
+    printf("%-10s %12.1f %12.1f %11.2fx%s\n", "update", host * 1e9 / NUM_CALLS, script * 1e9 / NUM_CALLS, host / script,
+        result.f == 30000.0f ? "" : " WRONG RESULT");
+
+    // A column per argument, the positions are updated in place
+    hsbfloat* positions = malloc(NUM_ENTITIES * sizeof(hsbfloat));
+    hsbfloat* velocities = malloc(NUM_ENTITIES * sizeof(hsbfloat));
+    hsbfloat* deltas = malloc(NUM_ENTITIES * sizeof(hsbfloat));
+    for (int i = 0; i < NUM_ENTITIES; ++i)
+    {
+        positions[i] = 0.0f;
+        velocities[i] = (float)(i % 100);
+        deltas[i] = 0.5f;
+    }
+
+    start = clock();
+    for (int frame = 0; frame < NUM_FRAMES; ++frame)
+    {
+        for (int i = 0; i < NUM_ENTITIES; ++i)
+        {
+            arguments[0].f = positions[i];
+            arguments[1].f = velocities[i];
+            arguments[2].f = deltas[i];
+            CallFunction(&context, update, arguments, 3, &position);
+            positions[i] = position.f;
+        }
+    }
+    double single = Seconds(start);
+    hsbfloat singleLast = positions[NUM_ENTITIES - 1];
+
+    for (int i = 0; i < NUM_ENTITIES; ++i)
+        positions[i] = 0.0f;
+    const void* columns[] = { positions, velocities, deltas };
+    start = clock();
+    for (int frame = 0; frame < NUM_FRAMES; ++frame)
+        CallFunctionBatch(&context, update, columns, 3, positions, NUM_ENTITIES);
+    double batched = Seconds(start);
+
+    printf("\n%-10s %12s %12s %12s\n", "entities", "single [ms]", "batch [ms]", "speedup");
+    printf("%-10d %12.2f %12.2f %11.2fx%s\n", NUM_ENTITIES, single * 1000.0 / NUM_FRAMES, batched * 1000.0 / NUM_FRAMES,
+        single / batched, singleLast == positions[NUM_ENTITIES - 1] ? "" : " RESULTS DIFFER");
+
+    free(deltas);
+    free(velocities);
+    free(positions);
+    DeleteScriptContext(&context);
+    DeleteProgram(&program);
+    return 0;
+}
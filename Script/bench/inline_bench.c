@@ -0,0 +1,308 @@
+#include <stdio.h>
+#include <time.h>
+
+#include "bytecode_c.h"
+#include "optimizer.h"
+
+// Executed calls, dispatches and run time of programs with small helper functions
+// before and after InlineCalls. The language has no functions yet, the programs are built
+// here the way the compiler would translate them.
+
+static const int DATA_SIZE = 1024;
+static const int NUM_RUNS = 2000;
+static const int NUM_ITERATIONS = 1000;
+static const SInlineOptions INLINE_OPTIONS = { 64, 1024, 4 };
+
+static void AddInt(SStackData* instructionStack, EInstruction instruction, hsbint value)
+{
+    AddInstruction(instructionStack, instruction);
+    StoreIntFwd(&instructionStack->stackPointer, value);
+}
+
+static void AddFloat(SStackData* instructionStack, EInstruction instruction, hsbfloat value)
+{
+    AddInstruction(instructionStack, instruction);
+    StoreFloatFwd(&instructionStack->stackPointer, value);
+}
+
+static void AddOffset(SStackData* instructionStack, EInstruction instruction, int offset)
+{
+    AddInstruction(instructionStack, instruction);
+    *instructionStack->stackPointer++ = offset;
+}
+
+static hsbaddress AddJump(SStackData* instructionStack, EInstruction instruction, hsbaddress address)
+{
+    hsbaddress position = instructionStack->stackPointer - instructionStack->begin;
+    AddInstruction(instructionStack, instruction);
+    StoreAddress(instructionStack->stackPointer, address);
+    instructionStack->stackPointer += sizeof(hsbaddress);
+    return position;
+}
+
+static hsbaddress Here(SStackData* instructionStack)
+{
+    return instructionStack->stackPointer - instructionStack->begin;
+}
+
+static void Patch(SStackData* instructionStack, hsbaddress jump)
+{
+    StoreAddress(instructionStack->begin + jump + 1, Here(instructionStack));
+}
+
+static SStackData Finish(SStackData instructionStack)
+{
+    instructionStack.end = instructionStack.stackPointer;
+    instructionStack.stackPointer = instructionStack.begin;
+    return instructionStack;
+}
+
+// ++i, loops while i < NUM_ITERATIONS, then ends. i is the variable on top.
+static void EndLoop(SStackData* s, hsbaddress loop)
+{
+    AddOffset(s, INS_LOAD_VAR_I, 0);
+    AddInt(s, INS_ADD_LITERAL_I, 1);
+    AddOffset(s, INS_SAVE_VAR_I, 0);
+    AddOffset(s, INS_LOAD_VAR_I, 0);
+    AddInt(s, INS_LITERAL_I, NUM_ITERATIONS);
+    AddInstruction(s, INS_CMP_I_LESS);
+    AddJump(s, INS_COND_JUMP_B, loop);
+    AddInstruction(s, INS_END);
+}
+
+// clamp(x, lo, hi), the arguments move to variables
+static hsbaddress AddClamp(SStackData* s)
+{
+    hsbaddress clamp = Here(s);
+    AddInstruction(s, INS_ALLOC_VAR_I);
+    AddInstruction(s, INS_ALLOC_VAR_I);
+    AddInstruction(s, INS_ALLOC_VAR_I);
+    AddOffset(s, INS_SAVE_VAR_I, 0);
+    AddOffset(s, INS_SAVE_VAR_I, HS_DATA_SIZE_INT);
+    AddOffset(s, INS_SAVE_VAR_I, 2 * HS_DATA_SIZE_INT);
+    AddOffset(s, INS_LOAD_VAR_I, 2 * HS_DATA_SIZE_INT);
+    AddOffset(s, INS_LOAD_VAR_I, HS_DATA_SIZE_INT);
+    AddInstruction(s, INS_CMP_I_LESS);
+    hsbaddress low = AddJump(s, INS_COND_JUMP_B, 0);
+    AddOffset(s, INS_LOAD_VAR_I, 0);
+    AddOffset(s, INS_LOAD_VAR_I, 2 * HS_DATA_SIZE_INT);
+    AddInstruction(s, INS_CMP_I_LESS);
+    hsbaddress high = AddJump(s, INS_COND_JUMP_B, 0);
+    AddOffset(s, INS_LOAD_VAR_I, 2 * HS_DATA_SIZE_INT);
+    hsbaddress done = AddJump(s, INS_JUMP, 0);
+    Patch(s, low);
+    AddOffset(s, INS_LOAD_VAR_I, HS_DATA_SIZE_INT);
+    hsbaddress lowDone = AddJump(s, INS_JUMP, 0);
+    Patch(s, high);
+    AddOffset(s, INS_LOAD_VAR_I, 0);
+    Patch(s, done);
+    Patch(s, lowDone);
+    AddInstruction(s, INS_DEALLOC_VAR_I);
+    AddInstruction(s, INS_DEALLOC_VAR_I);
+    AddInstruction(s, INS_DEALLOC_VAR_I);
+    AddInstruction(s, INS_RETURN);
+    return clamp;
+}
+
+// total = total + clamp(i - 490, 0, 20)
+static SStackData ClampProgram()
+{
+    SStackData s = CreateStack(200);
+    AddInstruction(&s, INS_ALLOC_VAR_I); // total
+    AddInstruction(&s, INS_ALLOC_VAR_I); // i
+    hsbaddress start = AddJump(&s, INS_JUMP, 0);
+    hsbaddress clamp = AddClamp(&s);
+
+    Patch(&s, start);
+    hsbaddress loop = Here(&s);
+    AddOffset(&s, INS_LOAD_VAR_I, 0);
+    AddInt(&s, INS_ADD_LITERAL_I, -490);
+    AddInt(&s, INS_LITERAL_I, 0);
+    AddInt(&s, INS_LITERAL_I, 20);
+    AddJump(&s, INS_CALL, clamp);
+    AddOffset(&s, INS_LOAD_VAR_I, HS_DATA_SIZE_INT);
+    AddInstruction(&s, INS_ADD_I);
+    AddOffset(&s, INS_SAVE_VAR_I, HS_DATA_SIZE_INT);
+    EndLoop(&s, loop);
+    return Finish(s);
+}
+
+// x = lerp(x, 10, t) with t growing by 0.001 and lerp(a, b, t) = a + (b - a) * t
+static SStackData LerpProgram()
+{
+    SStackData s = CreateStack(200);
+    AddInstruction(&s, INS_ALLOC_VAR_F); // x
+    AddInstruction(&s, INS_ALLOC_VAR_F); // t
+    AddInstruction(&s, INS_ALLOC_VAR_I); // i
+    hsbaddress start = AddJump(&s, INS_JUMP, 0);
+
+    hsbaddress lerp = Here(&s);
+    AddInstruction(&s, INS_ALLOC_VAR_F);
+    AddInstruction(&s, INS_ALLOC_VAR_F);
+    AddInstruction(&s, INS_ALLOC_VAR_F);
+    AddOffset(&s, INS_SAVE_VAR_F, 0);
+    AddOffset(&s, INS_SAVE_VAR_F, HS_DATA_SIZE_FLOAT);
+    AddOffset(&s, INS_SAVE_VAR_F, 2 * HS_DATA_SIZE_FLOAT);
+    AddOffset(&s, INS_LOAD_VAR_F, 2 * HS_DATA_SIZE_FLOAT);
+    AddOffset(&s, INS_LOAD_VAR_F, HS_DATA_SIZE_FLOAT);
+    AddOffset(&s, INS_LOAD_VAR_F, 2 * HS_DATA_SIZE_FLOAT);
+    AddInstruction(&s, INS_SUBSTRACT_F);
+    AddOffset(&s, INS_LOAD_VAR_F, 0);
+    AddInstruction(&s, INS_MULTIPLY_F);
+    AddInstruction(&s, INS_ADD_F);
+    AddInstruction(&s, INS_DEALLOC_VAR_F);
+    AddInstruction(&s, INS_DEALLOC_VAR_F);
+    AddInstruction(&s, INS_DEALLOC_VAR_F);
+    AddInstruction(&s, INS_RETURN);
+
+    Patch(&s, start);
+    hsbaddress loop = Here(&s);
+    AddOffset(&s, INS_LOAD_VAR_F, HS_DATA_SIZE_INT);
+    AddFloat(&s, INS_LITERAL_F, 0.001f);
+    AddInstruction(&s, INS_ADD_F);
+    AddOffset(&s, INS_SAVE_VAR_F, HS_DATA_SIZE_INT);
+    AddOffset(&s, INS_LOAD_VAR_F, HS_DATA_SIZE_INT + HS_DATA_SIZE_FLOAT);
+    AddFloat(&s, INS_LITERAL_F, 10.0f);
+    AddOffset(&s, INS_LOAD_VAR_F, HS_DATA_SIZE_INT);
+    AddJump(&s, INS_CALL, lerp);
+    AddOffset(&s, INS_SAVE_VAR_F, HS_DATA_SIZE_INT + HS_DATA_SIZE_FLOAT);
+    EndLoop(&s, loop);
+    return Finish(s);
+}
+
+// total = total + getX() + getY() with getters reading variables of the main program
+static SStackData GetterProgram()
+{
+    const int totalOffset = HS_DATA_SIZE_INT;
+    const int yOffset = 2 * HS_DATA_SIZE_INT;
+
+    SStackData s = CreateStack(200);
+    AddInstruction(&s, INS_ALLOC_VAR_I); // x
+    AddInstruction(&s, INS_ALLOC_VAR_I); // y
+    AddInstruction(&s, INS_ALLOC_VAR_I); // total
+    AddInstruction(&s, INS_ALLOC_VAR_I); // i
+    AddInt(&s, INS_LITERAL_I, 3);
+    AddOffset(&s, INS_SAVE_VAR_I, yOffset + HS_DATA_SIZE_INT);
+    AddInt(&s, INS_LITERAL_I, 4);
+    AddOffset(&s, INS_SAVE_VAR_I, yOffset);
+    hsbaddress start = AddJump(&s, INS_JUMP, 0);
+
+    hsbaddress getX = Here(&s);
+    AddOffset(&s, INS_LOAD_VAR_I, HS_DATA_SIZE_ADDRESS + yOffset + HS_DATA_SIZE_INT);
+    AddInstruction(&s, INS_RETURN);
+    hsbaddress getY = Here(&s);
+    AddOffset(&s, INS_LOAD_VAR_I, HS_DATA_SIZE_ADDRESS + yOffset);
+    AddInstruction(&s, INS_RETURN);
+
+    Patch(&s, start);
+    hsbaddress loop = Here(&s);
+    AddJump(&s, INS_CALL, getX);
+    AddJump(&s, INS_CALL, getY);
+    AddInstruction(&s, INS_ADD_I);
+    AddOffset(&s, INS_LOAD_VAR_I, totalOffset);
+    AddInstruction(&s, INS_ADD_I);
+    AddOffset(&s, INS_SAVE_VAR_I, totalOffset);
+    EndLoop(&s, loop);
+    return Finish(s);
+}
+
+// total = total + addClamped(i) with addClamped(x) = clamp(x - 490, 0, 20), two rounds
+static SStackData NestedProgram()
+{
+    SStackData s = CreateStack(200);
+    AddInstruction(&s, INS_ALLOC_VAR_I); // total
+    AddInstruction(&s, INS_ALLOC_VAR_I); // i
+    hsbaddress start = AddJump(&s, INS_JUMP, 0);
+    hsbaddress clamp = AddClamp(&s);
+
+    hsbaddress addClamped = Here(&s);
+    AddInt(&s, INS_ADD_LITERAL_I, -490);
+    AddInt(&s, INS_LITERAL_I, 0);
+    AddInt(&s, INS_LITERAL_I, 20);
+    AddJump(&s, INS_CALL, clamp);
+    AddInstruction(&s, INS_RETURN);
+
+    Patch(&s, start);
+    hsbaddress loop = Here(&s);
+    AddOffset(&s, INS_LOAD_VAR_I, 0);
+    AddJump(&s, INS_CALL, addClamped);
+    AddOffset(&s, INS_LOAD_VAR_I, HS_DATA_SIZE_INT);
+    AddInstruction(&s, INS_ADD_I);
+    AddOffset(&s, INS_SAVE_VAR_I, HS_DATA_SIZE_INT);
+    EndLoop(&s, loop);
+    return Finish(s);
+}
+
+static int CountDispatches(SStackData instructions, int* outCalls)
+{
+    SVMData vmData;
+    FuncArray funcArray = { 0 };
+    InitVM(&vmData, instructions, DATA_SIZE, funcArray);
+
+    int dispatches = 0;
+    *outCalls = 0;
+    do
+    {
+        *outCalls += *vmData.instructionStack.stackPointer == INS_CALL;
+        ++dispatches;
+    } while (VMProcessInstructions(&vmData, 1));
+
+    DeleteVM(&vmData, HS_TRUE, HS_TRUE);
+    return dispatches;
+}
+
+static double Time(SStackData instructions)
+{
+    SVMData vmData;
+    FuncArray funcArray = { 0 };
+    InitVM(&vmData, instructions, DATA_SIZE, funcArray);
+
+    clock_t start = clock();
+    for (int run = 0; run < NUM_RUNS; ++run)
+    {
+        vmData.instructionStack.stackPointer = vmData.instructionStack.begin;
+        vmData.dataStack.reversePointer = vmData.dataStack.base.end;
+        while (VMProcessInstructions(&vmData, 1 << 30))
+        {
+        }
+    }
+    double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    DeleteVM(&vmData, HS_TRUE, HS_TRUE);
+    return seconds;
+}
+
+static void Compare(const char* name, SStackData instructions)
+{
+    int calls, inlinedCalls, inlinedCount;
+    int dispatches = CountDispatches(instructions, &calls);
+    double seconds = Time(instructions);
+
+    if (InlineCalls(&instructions, &INLINE_OPTIONS, &inlinedCount) != R_OK)
+    {
+        DeleteStack(instructions);
+        return;
+    }
+
+    int inlinedDispatches = CountDispatches(instructions, &inlinedCalls);
+    double inlinedSeconds = Time(instructions);
+
+    printf("%-10s %8d %8d %10d %10d %7.1f%% %10.2f %10.2f\n",
+        name, calls, inlinedCalls, dispatches, inlinedDispatches, 100.0 * inlinedDispatches / dispatches,
+        seconds * 1000.0, inlinedSeconds * 1000.0);
+
+    DeleteStack(instructions);
+}
+
+int main()
+{
+    printf("%-10s %8s %8s %10s %10s %8s %10s %10s\n",
+        "program", "calls", "after", "dispatches", "after", "ratio", "time [ms]", "after [ms]");
+
+    Compare("clamp", ClampProgram());
+    Compare("lerp", LerpProgram());
+    Compare("getters", GetterProgram());
+    Compare("nested", NestedProgram());
+
+    return 0;
+}
@@ -0,0 +1,121 @@
+#include <stdio.h>
+#include <time.h>
+
+#include "bytecode_c.h"
+#include "compiler.h"
+#include "file.h"
+
+// Dispatches and run time of the corpus compiled straight from the AST (level 0) and through
+// the SSA IR and its passes (level 1, see ir.h). Run from Data/.
+
+static const int DATA_SIZE = 1024;
+static const int NUM_RUNS = 200;
+
+// Invariant and repeated subexpressions in a nested loop, the way scripts tend to be written
+static const char* GRID_CODE =
+    "var width: int = 40; var height: int = 30; var scale: float = 0.5; var total: float = 0.0;"
+    "var y: int = 0;"
+    "while (y < height)"
+    "{"
+    "    var x: int = 0;"
+    "    while (x < width)"
+    "    {"
+    "        var cell: int = y * width + x;"
+    "        total = total + scale * scale * 2.0;"
+    "        if (y * width + x < width * height / 2) { total = total - 1.0; }"
+    "        x = x + 1;"
+    "    }"
+    "    y = y + 1;"
+    "}";
+
+static int CountDispatches(SStackData instructions)
+{
+    SVMData vmData;
+    FuncArray funcArray = { 0 };
+    InitVM(&vmData, instructions, DATA_SIZE, funcArray);
+
+    int dispatches = 0;
+    while (VMProcessInstructions(&vmData, 1))
+        ++dispatches;
+
+    DeleteVM(&vmData, HS_TRUE, HS_TRUE);
+    return dispatches;
+}
+
+static double Time(SStackData instructions)
+{
+    SVMData vmData;
+    FuncArray funcArray = { 0 };
+    InitVM(&vmData, instructions, DATA_SIZE, funcArray);
+
+    clock_t start = clock();
+    for (int run = 0; run < NUM_RUNS; ++run)
+    {
+        vmData.instructionStack.stackPointer = vmData.instructionStack.begin;
+        vmData.dataStack.reversePointer = vmData.dataStack.base.end;
+        while (VMProcessInstructions(&vmData, 1 << 30))
+        {
+        }
+    }
+    double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    DeleteVM(&vmData, HS_TRUE, HS_TRUE);
+    return seconds;
+}
+
+static void Compare(const char* name, char* code, int size)
+{
+    SStackData compiled;
+    SStackData optimized;
+    if (CompileSourceOptimized(code, size, 0, &compiled) != R_OK)
+        return;
+    if (CompileSourceOptimized(code, size, 1, &optimized) != R_OK)
+    {
+        DeleteStack(compiled);
+        return;
+    }
+
+    int dispatches = CountDispatches(compiled);
+    int optimizedDispatches = CountDispatches(optimized);
+    double seconds = Time(compiled);
+    double optimizedSeconds = Time(optimized);
+
+    printf("%-10s %6d %6d %10d %10d %7.1f%% %10.2f %10.2f\n",
+        name, (int)(compiled.end - compiled.begin), (int)(optimized.end - optimized.begin),
+        dispatches, optimizedDispatches, 100.0 * optimizedDispatches / dispatches,
+        seconds * 1000.0, optimizedSeconds * 1000.0);
+
+    DeleteStack(compiled);
+    DeleteStack(optimized);
+}
+
+static void CompareScript(const char* name, const char* fileName)
+{
+    char* code;
+    int size;
+    if (!ReadFile(fileName, &code, &size))
+    {
+        printf("Failed to read %s\n", fileName);
+        return;
+    }
+
+    Compare(name, code, size);
+    free(code);
+}
+
+int main()
+{
+    printf("%-10s %6s %6s %10s %10s %8s %10s %10s\n",
+        "program", "bytes", "after", "dispatches", "after", "ratio", "time [ms]", "after [ms]");
+
+    CompareScript("Fibonacci", "Fibonacci.hss");
+    CompareScript("Physics", "Physics.hss");
+    CompareScript("Primes", "Primes.hss");
+    CompareScript("Sum", "Sum.hss");
+
+    char grid[1024];
+    strcpy(grid, GRID_CODE);
+    Compare("Grid", grid, strlen(grid));
+
+    return 0;
+}
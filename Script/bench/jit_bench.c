@@ -0,0 +1,102 @@
+#include <stdio.h>
+#include <time.h>
+
+#include "bytecode_c.h"
+#include "compiler.h"
+#include "file.h"
+#include "jit.h"
+#include "optimizer.h"
+
+// Run time of the script corpus (with superinstructions) in the checked interpreter,
+// the unchecked interpreter (VMRunVerified) and as JIT code
+
+static const int DATA_SIZE = 1024;
+static const int NUM_RUNS = 2000;
+
+static const char* CORPUS[] =
+{
+    "Sum.hss",
+    "Fibonacci.hss",
+    "Primes.hss",
+    "Physics.hss",
+};
+
+typedef enum
+{
+    MODE_CHECKED,
+    MODE_VERIFIED,
+    MODE_JIT,
+} EMode;
+
+static double Time(SStackData instructions, const SJitCode* code, EMode mode)
+{
+    SVMData vmData;
+    FuncArray funcArray = { 0 };
+    InitVM(&vmData, instructions, DATA_SIZE, funcArray);
+
+    clock_t start = clock();
+    for (int run = 0; run < NUM_RUNS; ++run)
+    {
+        vmData.instructionStack.stackPointer = vmData.instructionStack.begin;
+        vmData.dataStack.base.stackPointer = vmData.dataStack.base.begin;
+        vmData.dataStack.reversePointer = vmData.dataStack.base.end;
+
+        switch (mode)
+        {
+            case MODE_CHECKED:
+                while (VMProcessInstructions(&vmData, 1 << 30))
+                {
+                }
+                break;
+            case MODE_VERIFIED:
+                VMRunVerified(&vmData);
+                break;
+            case MODE_JIT:
+                VMRunJit(&vmData, code);
+                break;
+        }
+    }
+    double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    DeleteVM(&vmData, HS_TRUE, HS_TRUE);
+    return seconds;
+}
+
+int main()
+{
+#if !HS_JIT_SUPPORTED
+    printf("The JIT is not supported on this platform\n");
+    return 1;
+#endif
+
+    printf("%-16s %13s %13s %13s %8s\n", "script", "checked [ms]", "verified [ms]", "jit [ms]", "speedup");
+
+    for (int i = 0; i < (int)(sizeof(CORPUS) / sizeof(CORPUS[0])); ++i)
+    {
+        char* code;
+        int size;
+        SStackData instructions;
+        if (!ReadFile(CORPUS[i], &code, &size) || CompileSource(code, size, &instructions) != R_OK
+            || FuseSuperinstructions(&instructions) != R_OK)
+        {
+            return 1;
+        }
+
+        SJitCode jitCode;
+        if (JitCompile(instructions, DATA_SIZE, &jitCode) != R_OK)
+            return 1;
+
+        double checked = Time(instructions, NULL, MODE_CHECKED);
+        double verified = Time(instructions, NULL, MODE_VERIFIED);
+        double jit = Time(instructions, &jitCode, MODE_JIT);
+
+        printf("%-16s %13.2f %13.2f %13.2f %7.1fx\n",
+            CORPUS[i], checked * 1000.0, verified * 1000.0, jit * 1000.0, verified / jit);
+
+        FreeJitCode(&jitCode);
+        DeleteStack(instructions);
+        free(code);
+    }
+
+    return 0;
+}
@@ -0,0 +1,125 @@
+#include <stdio.h>
+#include <time.h>
+
+#include "bytecode_c.h"
+#include "compiler.h"
+#include "natives.h"
+#include "verifier.h"
+
+// Cost of a native call: the same loop with the arithmetic in script and in natives called
+// through INS_CALL_EXT, in the checked interpreter and in VMRunVerified
+
+static const int DATA_SIZE = 200;
+static const int NUM_RUNS = 20;
+
+static void NativeAdd(SVMData* vmData)
+{
+    hsbint second = PopInt(&vmData->dataStack.base.stackPointer);
+    hsbint first = PopInt(&vmData->dataStack.base.stackPointer);
+    PushInt(&vmData->dataStack.base.stackPointer, first + second);
+}
+
+static void NativeMadd(SVMData* vmData)
+{
+    hsbfloat add = PopFloat(&vmData->dataStack.base.stackPointer);
+    hsbfloat factor = PopFloat(&vmData->dataStack.base.stackPointer);
+    hsbfloat value = PopFloat(&vmData->dataStack.base.stackPointer);
+    PushFloat(&vmData->dataStack.base.stackPointer, value * factor + add);
+}
+
+static void NativeNothing(SVMData* vmData)
+{
+}
+
+// Runs the program NUM_RUNS times, returns the seconds per run or -1 when it failed
+static double Run(SStackData instructions, const SNativeTable* natives, Bool8 verified)
+{
+    SVMData vmData;
+    InitVM(&vmData, instructions, DATA_SIZE, CreateNativeFunctions(natives));
+
+    clock_t start = clock();
+    for (int run = 0; run < NUM_RUNS; ++run)
+    {
+        vmData.instructionStack.stackPointer = vmData.instructionStack.begin;
+        vmData.dataStack.base.stackPointer = vmData.dataStack.base.begin;
+        vmData.dataStack.reversePointer = vmData.dataStack.base.end;
+        if (verified)
+        {
+            VMRunVerified(&vmData);
+        }
+        else
+        {
+            while (VMProcessInstructions(&vmData, 1 << 30))
+            {
+            }
+        }
+    }
+    double seconds = (double)(clock() - start) / CLOCKS_PER_SEC / NUM_RUNS;
+
+    Bool8 failed = vmData.error != VM_OK;
+    DeleteVM(&vmData, HS_TRUE, HS_FALSE);
+    return failed ? -1.0 : seconds;
+}
+
+static void Compare(const char* name, char* script, char* native, const SNativeTable* natives)
+{
+    SStackData scriptInstructions, nativeInstructions;
+    SVerifyResult result;
+    if (CompileSource(script, strlen(script), &scriptInstructions) != R_OK
+        || CompileSourceWithNatives(native, strlen(native), natives, &nativeInstructions) != R_OK)
+    {
+        printf("ERROR: %s does not compile\n", name);
+        return;
+    }
+    if (VerifyInstructions(scriptInstructions, DATA_SIZE, &result) != R_OK
+        || VerifyInstructions(nativeInstructions, DATA_SIZE, &result) != R_OK)
+    {
+        printf("ERROR: %s at %d\n", result.error, result.errorOffset);
+        return;
+    }
+
+    double checked = Run(scriptInstructions, natives, HS_FALSE);
+    double nativeChecked = Run(nativeInstructions, natives, HS_FALSE);
+    double verified = Run(scriptInstructions, natives, HS_TRUE);
+    double nativeVerified = Run(nativeInstructions, natives, HS_TRUE);
+
+    printf("%-12s %10.2f %10.2f %10.2f %10.2f\n", name,
+        checked * 1000.0, nativeChecked * 1000.0, verified * 1000.0, nativeVerified * 1000.0);
+
+    DeleteStack(scriptInstructions);
+    DeleteStack(nativeInstructions);
+}
+
+int main()
+{
+    SNativeTable natives;
+    InitNativeTable(&natives);
+    RegisterNative(&natives, "add", "int(int, int)", NativeAdd);
+    RegisterNative(&natives, "madd", "float(float, float, float)", NativeMadd);
+    RegisterNative(&natives, "nothing", "void()", NativeNothing);
+
+    char addScript[] =
+        "var n: int = 0; while (n < 100) { var i: int = 0; var s: int = 0;"
+        " while (i < 300) { s = s + i; i = i + 1; } n = n + 1; }";
+    char addNative[] =
+        "var n: int = 0; while (n < 100) { var i: int = 0; var s: int = 0;"
+        " while (i < 300) { s = add(s, i); i = add(i, 1); } n = n + 1; }";
+    char maddScript[] =
+        "var n: int = 0; var f: float = 0.0; while (n < 30000) { f = f * 0.5 + 1.0; n = n + 1; }";
+    char maddNative[] =
+        "var n: int = 0; var f: float = 0.0; while (n < 30000) { f = madd(f, 0.5, 1.0); n = n + 1; }";
+    char emptyScript[] =
+        "var n: int = 0; while (n < 30000) { n = n + 1; }";
+    char emptyNative[] =
+        "var n: int = 0; while (n < 30000) { nothing(); n = n + 1; }";
+
+    printf("%-12s %10s %10s %10s %10s\n", "program", "checked", "native", "verified", "native");
+    printf("%-12s %10s %10s %10s %10s\n", "", "[ms]", "[ms]", "[ms]", "[ms]");
+
+    Compare("add", addScript, addNative, &natives);
+    Compare("madd", maddScript, maddNative, &natives);
+    Compare("empty call", emptyScript, emptyNative, &natives);
+
+    DeleteNativeTable(&natives);
+    return 0;
+}
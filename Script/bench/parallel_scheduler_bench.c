@@ -0,0 +1,98 @@
+#if !defined(_WIN32)
+    // clock_gettime is not part of C99
+    #define _POSIX_C_SOURCE 199309L
+#endif
+
+#include <stdio.h>
+#include <time.h>
+#if defined(_WIN32)
+#include <windows.h>
+#endif
+
+#include "bytecode_c.h"
+#include "embed.h"
+#include "parallel_scheduler.h"
+
+// Ticks of 20000 agents of two programs on 1 to 16 threads. Every agent does a different amount
+// of work between its yields, so the deques run dry at different times and the threads steal.
+// The scaling is against 1 thread, the last column the batches stolen per tick.
+
+static const int NUM_AGENTS = 20000;
+static const int NUM_TICKS = 50;
+
+static char s_walkers[] =
+    "fun walk(seed: int): int\n"
+    "{\n"
+    "    var x: int = 0;\n"
+    "    while (1 == 1)\n"
+    "    {\n"
+    "        var i: int = seed - seed / 64 * 64;\n"
+    "        while (i > 0) { x = x + i * 3 - x / 2; i = i - 1; }\n"
+    "        yield;\n"
+    "    }\n"
+    "    return x;\n"
+    "}\n";
+
+static char s_thinkers[] =
+    "fun think(seed: int): float\n"
+    "{\n"
+    "    var f: float = 1.0;\n"
+    "    while (1 == 1) { var i: int = seed - seed / 16 * 16; while (i > 0) { f = f * 0.5 + 1.0; i = i - 1; } yield; }\n"
+    "    return f;\n"
+    "}\n";
+
+static double WallSeconds()
+{
+#if defined(_WIN32)
+    LARGE_INTEGER now, frequency;
+    QueryPerformanceCounter(&now);
+    QueryPerformanceFrequency(&frequency);
+    return (double)now.QuadPart / frequency.QuadPart;
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec * 1e-9;
+#endif
+}
+
+int main()
+{
+    SProgram* walkers = CreateSharedProgram(s_walkers, strlen(s_walkers), NULL);
+    SProgram* thinkers = CreateSharedProgram(s_thinkers, strlen(s_thinkers), NULL);
+    if (!walkers || !thinkers)
+        return 1;
+
+    printf("%-8s %12s %14s %10s %10s\n", "threads", "tick [ms]", "agents [1/s]", "scaling", "stolen");
+
+    double single = 0.0;
+    for (int threads = 1; threads <= 16; threads *= 2)
+    {
+        SParallelScheduler* scheduler = CreateParallelScheduler(threads);
+        int programs[] = { AddParallelProgram(scheduler, walkers, 100000), AddParallelProgram(scheduler, thinkers, 100000) };
+        int functions[] = { FindFunction(walkers, "walk"), FindFunction(thinkers, "think") };
+        for (int i = 0; i < NUM_AGENTS; ++i)
+        {
+            SScriptValue arguments[] = { { .i = (hsbint)(i * 7919 % 10007) } };
+            SpawnParallelInstance(scheduler, programs[i % 4 == 3], functions[i % 4 == 3], arguments, 1);
+        }
+
+        int stolen = 0;
+        double start = WallSeconds();
+        for (int tick = 0; tick < NUM_TICKS; ++tick)
+        {
+            RunParallelTick(scheduler);
+            stolen += GetStolenBatchCount(scheduler);
+        }
+        double seconds = (WallSeconds() - start) / NUM_TICKS;
+        DeleteParallelScheduler(scheduler);
+
+        if (threads == 1)
+            single = seconds;
+        printf("%-8d %12.2f %14.0f %9.2fx %10d\n", threads, seconds * 1000.0, NUM_AGENTS / seconds, single / seconds,
+            stolen / NUM_TICKS);
+    }
+
+    ReleaseProgram(walkers);
+    ReleaseProgram(thinkers);
+    return 0;
+}
@@ -0,0 +1,145 @@
+#include <stdio.h>
+#include <time.h>
+
+#include "bytecode_c.h"
+#include "compiler.h"
+#include "file.h"
+#include "optimizer.h"
+#include "profiler.h"
+#include "sampler.h"
+
+// Overhead of the profiled interpreter (profiler.h) over VMProcessInstructions on the script
+// corpus, and the profile of the whole corpus after FuseSuperinstructions: the opcodes which
+// take the time are the candidates for the next superinstructions. Then the same for the
+// sampling profiler (sampler.h) on the bytecode as compiled, with its hot lines and folded stacks.
+
+static const int DATA_SIZE = 1024;
+static const int NUM_RUNS = 2000;
+static const int SAMPLE_PERIOD = 1000;
+
+static const char* CORPUS[] =
+{
+    "Sum.hss",
+    "Fibonacci.hss",
+    "Primes.hss",
+    "Physics.hss",
+};
+
+static double Time(SStackData instructions, SProfile* profile, SSampleProfile* samples)
+{
+    SVMData vmData;
+    FuncArray funcArray = { 0 };
+    InitVM(&vmData, instructions, DATA_SIZE, funcArray);
+
+    clock_t start = clock();
+    for (int run = 0; run < NUM_RUNS; ++run)
+    {
+        vmData.instructionStack.stackPointer = vmData.instructionStack.begin;
+        vmData.dataStack.reversePointer = vmData.dataStack.base.end;
+        if (profile)
+        {
+            while (ProfiledProcessInstructions(&vmData, 1 << 30, profile))
+            {
+            }
+        }
+        else if (samples)
+        {
+            while (SampledProcessInstructions(&vmData, 1 << 30, samples))
+            {
+            }
+        }
+        else
+        {
+            while (VMProcessInstructions(&vmData, 1 << 30))
+            {
+            }
+        }
+    }
+    double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    DeleteVM(&vmData, HS_TRUE, HS_TRUE);
+    return seconds;
+}
+
+int main()
+{
+    const int numScripts = sizeof(CORPUS) / sizeof(CORPUS[0]);
+    SProfile profiles[sizeof(CORPUS) / sizeof(CORPUS[0])];
+    SStackData programs[sizeof(CORPUS) / sizeof(CORPUS[0])];
+
+    printf("%-16s %10s %13s %9s\n", "script", "time [ms]", "profiled [ms]", "overhead");
+    for (int i = 0; i < numScripts; ++i)
+    {
+        char* code;
+        int size;
+        if (!ReadFile(CORPUS[i], &code, &size) || CompileSource(code, size, &programs[i]) != R_OK
+            || FuseSuperinstructions(&programs[i]) != R_OK)
+        {
+            printf("Failed to compile %s\n", CORPUS[i]);
+            return 1;
+        }
+        free(code);
+
+        InitProfile(&profiles[i], programs[i]);
+        double seconds = Time(programs[i], NULL, NULL);
+        double profiledSeconds = Time(programs[i], &profiles[i], NULL);
+        printf("%-16s %10.1f %13.1f %8.2fx\n", CORPUS[i], seconds * 1e3, profiledSeconds * 1e3, profiledSeconds / seconds);
+    }
+
+    // The opcodes of all scripts together, then each script's hottest offsets
+    SProfile total = profiles[0];
+    for (int i = 1; i < numScripts; ++i)
+    {
+        for (int opcode = 0; opcode < INS_COUNT; ++opcode)
+        {
+            total.counts[opcode] += profiles[i].counts[opcode];
+            total.ticks[opcode] += profiles[i].ticks[opcode];
+        }
+    }
+    printf("\nCorpus, %d runs\n", NUM_RUNS);
+    PrintProfile(&total, 0, stdout);
+
+    for (int i = 0; i < numScripts; ++i)
+    {
+        printf("\n%s\n", CORPUS[i]);
+        PrintProfile(&profiles[i], 8, stdout);
+        DeleteProfile(&profiles[i]);
+        DeleteStack(programs[i]);
+    }
+
+    printf("\nSampling every %d instructions\n", SAMPLE_PERIOD);
+    printf("%-16s %10s %12s %9s %9s\n", "script", "time [ms]", "sampled [ms]", "overhead", "samples");
+    char* sources[sizeof(CORPUS) / sizeof(CORPUS[0])];
+    SSampleProfile samples[sizeof(CORPUS) / sizeof(CORPUS[0])];
+    SLineTable lines[sizeof(CORPUS) / sizeof(CORPUS[0])];
+    for (int i = 0; i < numScripts; ++i)
+    {
+        // The source stays for the report
+        int size;
+        if (!ReadFile(CORPUS[i], &sources[i], &size) || CompileSourceWithLines(sources[i], size, &programs[i], &lines[i]) != R_OK)
+        {
+            printf("Failed to compile %s\n", CORPUS[i]);
+            return 1;
+        }
+
+        InitSampleProfile(&samples[i], programs[i], SAMPLE_PERIOD);
+        double seconds = Time(programs[i], NULL, NULL);
+        double sampledSeconds = Time(programs[i], NULL, &samples[i]);
+        printf("%-16s %10.1f %12.1f %8.2fx %9" PRIu64 "\n", CORPUS[i], seconds * 1e3, sampledSeconds * 1e3,
+            sampledSeconds / seconds, samples[i].sampleCount);
+    }
+
+    for (int i = 0; i < numScripts; ++i)
+    {
+        printf("\n%s\n", CORPUS[i]);
+        PrintSampleProfile(&samples[i], &lines[i], sources[i], stdout);
+        printf("\n");
+        WriteFoldedStacks(&samples[i], &lines[i], CORPUS[i], HS_TRUE, stdout);
+
+        DeleteSampleProfile(&samples[i]);
+        DeleteLineTable(&lines[i]);
+        DeleteStack(programs[i]);
+        free(sources[i]);
+    }
+    return 0;
+}
@@ -0,0 +1,82 @@
+#if !defined(_WIN32)
+    // clock_gettime is not part of C99
+    #define _POSIX_C_SOURCE 199309L
+#endif
+
+#include <stdio.h>
+#include <time.h>
+#if defined(_WIN32)
+#include <windows.h>
+#endif
+
+#include "bytecode_c.h"
+#include "embed.h"
+#include "runner.h"
+
+// Calls per second of a script runner with 1 to 16 threads on one shared program. clock()
+// counts the time of all threads of the process, so this measures the wall time.
+
+static const int NUM_JOBS = 200000;
+static const int NUM_RUNS = 5;
+
+static char s_code[] =
+    "fun work(n: int, factor: float): float\n"
+    "{\n"
+    "    var result: float = 0.0;\n"
+    "    var i: int = 0;\n"
+    "    while (i < n) { result = result * 0.5 + factor; i = i + 1; }\n"
+    "    return result;\n"
+    "}\n";
+
+static double WallSeconds()
+{
+#if defined(_WIN32)
+    LARGE_INTEGER now, frequency;
+    QueryPerformanceCounter(&now);
+    QueryPerformanceFrequency(&frequency);
+    return (double)now.QuadPart / frequency.QuadPart;
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec * 1e-9;
+#endif
+}
+
+int main()
+{
+    SProgram* program = CreateSharedProgram(s_code, strlen(s_code), NULL);
+    if (!program)
+        return 1;
+
+    SScriptJob* jobs = malloc(NUM_JOBS * sizeof(SScriptJob));
+    for (int i = 0; i < NUM_JOBS; ++i)
+    {
+        jobs[i].function = 0;
+        jobs[i].argumentCount = 2;
+        jobs[i].arguments[0].i = (hsbint)(i % 32 + 1);
+        jobs[i].arguments[1].f = 1.0f;
+    }
+
+    printf("%-8s %12s %14s %10s\n", "threads", "wall [ms]", "calls [1/s]", "scaling");
+
+    double single = 0.0;
+    for (int threads = 1; threads <= 16; threads *= 2)
+    {
+        SScriptRunner* runner = CreateScriptRunner(program, threads);
+        double start = WallSeconds();
+        Bool8 failed = HS_FALSE;
+        for (int run = 0; run < NUM_RUNS; ++run)
+            failed |= RunScriptJobs(runner, jobs, NUM_JOBS) != R_OK;
+        double seconds = (WallSeconds() - start) / NUM_RUNS;
+        DeleteScriptRunner(runner);
+
+        if (threads == 1)
+            single = seconds;
+        printf("%-8d %12.2f %14.0f %9.2fx%s\n", threads, seconds * 1000.0, NUM_JOBS / seconds, single / seconds,
+            failed ? " FAILED" : "");
+    }
+
+    free(jobs);
+    ReleaseProgram(program);
+    return 0;
+}
@@ -0,0 +1,87 @@
+#include <stdio.h>
+#include <time.h>
+
+#include "bytecode_c.h"
+#include "compiler.h"
+#include "optimizer.h"
+#include "file.h"
+
+// Dispatch counts and run time of the script corpus before and after FuseSuperinstructions
+
+static const int DATA_SIZE = 1024;
+static const int NUM_RUNS = 2000;
+
+static const char* CORPUS[] =
+{
+    "Sum.hss",
+    "Fibonacci.hss",
+    "Primes.hss",
+    "Physics.hss",
+};
+
+static int CountDispatches(SStackData instructions)
+{
+    SVMData vmData;
+    FuncArray funcArray = { 0 };
+    InitVM(&vmData, instructions, DATA_SIZE, funcArray);
+
+    int dispatches = 1;
+    while (VMProcessInstructions(&vmData, 1))
+        ++dispatches;
+
+    DeleteVM(&vmData, HS_TRUE, HS_TRUE);
+    return dispatches;
+}
+
+static double Time(SStackData instructions)
+{
+    SVMData vmData;
+    FuncArray funcArray = { 0 };
+    InitVM(&vmData, instructions, DATA_SIZE, funcArray);
+
+    clock_t start = clock();
+    for (int run = 0; run < NUM_RUNS; ++run)
+    {
+        vmData.instructionStack.stackPointer = vmData.instructionStack.begin;
+        vmData.dataStack.reversePointer = vmData.dataStack.base.end;
+        while (VMProcessInstructions(&vmData, 1 << 30))
+        {
+        }
+    }
+    double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    DeleteVM(&vmData, HS_TRUE, HS_TRUE);
+    return seconds;
+}
+
+int main()
+{
+    printf("%-16s %10s %10s %8s %10s %10s\n", "script", "dispatches", "fused", "ratio", "time [ms]", "fused [ms]");
+
+    for (int i = 0; i < (int)(sizeof(CORPUS) / sizeof(CORPUS[0])); ++i)
+    {
+        char* code;
+        int size;
+        SStackData instructions;
+        if (!ReadFile(CORPUS[i], &code, &size) || CompileSource(code, size, &instructions) != R_OK)
+            return 1;
+
+        int dispatches = CountDispatches(instructions);
+        double seconds = Time(instructions);
+
+        if (FuseSuperinstructions(&instructions) != R_OK)
+            return 1;
+
+        int fusedDispatches = CountDispatches(instructions);
+        double fusedSeconds = Time(instructions);
+
+        printf("%-16s %10d %10d %7.1f%% %10.2f %10.2f\n",
+            CORPUS[i], dispatches, fusedDispatches, 100.0 * fusedDispatches / dispatches,
+            seconds * 1000.0, fusedSeconds * 1000.0);
+
+        DeleteStack(instructions);
+        free(code);
+    }
+
+    return 0;
+}
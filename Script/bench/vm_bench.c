@@ -0,0 +1,184 @@
+#include <stdio.h>
+#include <time.h>
+
+#include "bytecode_c.h"
+#include "guarded_stack.h"
+#include "tiered.h"
+#include "verifier.h"
+
+// Interpreter throughput on an int/float arithmetic loop, checked, verified (VMRunVerified),
+// checked on a guard page protected data stack (guarded_stack.h) and tiered (tiered.h).
+// Run once with the default build and once with -DHS_SLOT_STACK to compare the data stack layouts.
+
+static const int DATA_SIZE = 200;
+static const int NUM_ITERATIONS = 30000;
+static const int NUM_RUNS = 200;
+
+// instructions executed by one iteration of the loop below
+static const int LOOP_INSTRUCTIONS = 16;
+
+// backward jumps before a tiered VM is promoted
+static const int TIER_THRESHOLD = 1000;
+
+static SStackData CreateLoopProgram()
+{
+    SStackData instructionStack = CreateStack(200);
+
+    // var i: int; var acc: float;
+    AddInstruction(&instructionStack, INS_ALLOC_VAR_F);
+    AddInstruction(&instructionStack, INS_ALLOC_VAR_I);
+    AddInstruction(&instructionStack, INS_LITERAL_I);
+    StoreIntFwd(&instructionStack.stackPointer, 0);
+    AddInstruction(&instructionStack, INS_SAVE_VAR_I);
+    *instructionStack.stackPointer++ = 0;
+    AddInstruction(&instructionStack, INS_LITERAL_F);
+    StoreFloatFwd(&instructionStack.stackPointer, 0.0f);
+    AddInstruction(&instructionStack, INS_SAVE_VAR_F);
+    *instructionStack.stackPointer++ = HS_DATA_SIZE_INT;
+
+    hsbaddress loopStartAddress = instructionStack.stackPointer - instructionStack.begin;
+
+    // acc = acc + acc * 0.5 - 0.25;
+    AddInstruction(&instructionStack, INS_LOAD_VAR_F);
+    *instructionStack.stackPointer++ = HS_DATA_SIZE_INT;
+    AddInstruction(&instructionStack, INS_LOAD_VAR_F);
+    *instructionStack.stackPointer++ = HS_DATA_SIZE_INT;
+    AddInstruction(&instructionStack, INS_LITERAL_F);
+    StoreFloatFwd(&instructionStack.stackPointer, 0.5f);
+    AddInstruction(&instructionStack, INS_MULTIPLY_F);
+    AddInstruction(&instructionStack, INS_ADD_F);
+    AddInstruction(&instructionStack, INS_LITERAL_F);
+    StoreFloatFwd(&instructionStack.stackPointer, 0.25f);
+    AddInstruction(&instructionStack, INS_SUBSTRACT_F);
+    AddInstruction(&instructionStack, INS_SAVE_VAR_F);
+    *instructionStack.stackPointer++ = HS_DATA_SIZE_INT;
+
+    // i = i + 1;
+    AddInstruction(&instructionStack, INS_LOAD_VAR_I);
+    *instructionStack.stackPointer++ = 0;
+    AddInstruction(&instructionStack, INS_LITERAL_I);
+    StoreIntFwd(&instructionStack.stackPointer, 1);
+    AddInstruction(&instructionStack, INS_ADD_I);
+    AddInstruction(&instructionStack, INS_SAVE_VAR_I);
+    *instructionStack.stackPointer++ = 0;
+
+    // while (i < NUM_ITERATIONS)
+    AddInstruction(&instructionStack, INS_LOAD_VAR_I);
+    *instructionStack.stackPointer++ = 0;
+    AddInstruction(&instructionStack, INS_LITERAL_I);
+    StoreIntFwd(&instructionStack.stackPointer, NUM_ITERATIONS);
+    AddInstruction(&instructionStack, INS_CMP_I_LESS);
+    AddInstruction(&instructionStack, INS_COND_JUMP_B);
+    StoreAddress(instructionStack.stackPointer, loopStartAddress);
+    instructionStack.stackPointer += sizeof(hsbaddress);
+
+    AddInstruction(&instructionStack, INS_DEALLOC_VAR_I);
+    AddInstruction(&instructionStack, INS_DEALLOC_VAR_F);
+    AddInstruction(&instructionStack, INS_END);
+
+    instructionStack.end = instructionStack.stackPointer;
+    instructionStack.stackPointer = instructionStack.begin;
+
+    return instructionStack;
+}
+
+static double TimeChecked(SVMData* vmData)
+{
+    clock_t start = clock();
+    for (int run = 0; run < NUM_RUNS; ++run)
+    {
+        vmData->instructionStack.stackPointer = vmData->instructionStack.begin;
+        while (VMProcessInstructions(vmData, 1 << 30))
+        {
+        }
+    }
+    return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+static double TimeGuarded(SVMData* vmData)
+{
+    clock_t start = clock();
+    for (int run = 0; run < NUM_RUNS; ++run)
+    {
+        vmData->instructionStack.stackPointer = vmData->instructionStack.begin;
+        while (VMProcessInstructionsGuarded(vmData, 1 << 30))
+        {
+        }
+    }
+    return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+// A new tiered VM every run, each one starts on the baseline tier
+static double TimeTiered(SStackData instructionStack)
+{
+    int size = instructionStack.end - instructionStack.begin;
+    FuncArray funcArray = { 0 };
+
+    clock_t start = clock();
+    for (int run = 0; run < NUM_RUNS; ++run)
+    {
+        SStackData instructions = CreateStack(size);
+        memcpy(instructions.begin, instructionStack.begin, size);
+        instructions.end = instructions.begin + size;
+
+        STieredVM tiered;
+        InitTieredVM(&tiered, instructions, DATA_SIZE, funcArray, TIER_THRESHOLD);
+        while (TieredProcessInstructions(&tiered, 1 << 30))
+        {
+        }
+        DeleteTieredVM(&tiered, HS_TRUE);
+    }
+    return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+static double TimeVerified(SVMData* vmData)
+{
+    clock_t start = clock();
+    for (int run = 0; run < NUM_RUNS; ++run)
+    {
+        vmData->instructionStack.stackPointer = vmData->instructionStack.begin;
+        VMRunVerified(vmData);
+    }
+    return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+int main()
+{
+    SStackData instructionStack = CreateLoopProgram();
+
+    SVerifyResult verifyResult;
+    if (VerifyInstructions(instructionStack, DATA_SIZE, &verifyResult) != R_OK)
+    {
+        printf("Verification failed at %d: %s\n", verifyResult.errorOffset, verifyResult.error);
+        return 1;
+    }
+
+    FuncArray funcArray = { 0 };
+    SVMData vmData;
+    InitVM(&vmData, instructionStack, DATA_SIZE, funcArray);
+
+    double seconds = TimeChecked(&vmData);
+    double verifiedSeconds = TimeVerified(&vmData);
+
+    SVMData guardedVmData;
+    InitGuardedVM(&guardedVmData, instructionStack, DATA_SIZE, funcArray);
+    double guardedSeconds = TimeGuarded(&guardedVmData);
+    DeleteGuardedVM(&guardedVmData, HS_TRUE, HS_TRUE);
+
+    double tieredSeconds = TimeTiered(instructionStack);
+
+    double instructions = (double)NUM_RUNS * NUM_ITERATIONS * LOOP_INSTRUCTIONS;
+#ifdef HS_SLOT_STACK
+    printf("Data stack: 8-byte slots\n");
+#else
+    printf("Data stack: packed\n");
+#endif
+    printf("Instructions: %.0f\n", instructions);
+    printf("Checked:  %.3f s (%.2f ns/instruction)\n", seconds, seconds * 1e9 / instructions);
+    printf("Verified: %.3f s (%.2f ns/instruction)\n", verifiedSeconds, verifiedSeconds * 1e9 / instructions);
+    printf("Guarded:  %.3f s (%.2f ns/instruction)\n", guardedSeconds, guardedSeconds * 1e9 / instructions);
+    printf("Tiered:   %.3f s (%.2f ns/instruction)\n", tieredSeconds, tieredSeconds * 1e9 / instructions);
+
+    DeleteVM(&vmData, HS_FALSE, HS_TRUE);
+    return 0;
+}
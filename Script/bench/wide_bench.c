@@ -0,0 +1,94 @@
+#include <stdio.h>
+#include <time.h>
+
+#include "bytecode_c.h"
+#include "embed.h"
+#include "wide_vm.h"
+
+// Rows per second of CallFunctionBatch against CallFunctionWide, for arithmetic the lanes run
+// together and for a loop that runs a different number of times in every lane. Pass -mavx2 to
+// compare lane loops on 8 floats at a time.
+
+static const int NUM_ROWS = 100000;
+static const int NUM_FRAMES = 20;
+
+static char s_code[] =
+    "fun update(position: float, velocity: float, dt: float): float\n"
+    "{\n"
+    "    var p: float = position + velocity * dt;\n"
+    "    if (p < 0.0) { p = 0.0 - p; }\n"
+    "    return p * 0.5 + position * 0.25 + velocity * dt * 0.25;\n"
+    "}\n"
+    "fun steps(n: int, dt: float, unused: float): float\n"
+    "{\n"
+    "    var s: float = 0.0;\n"
+    "    while (n > 1) { if (n - n / 2 * 2 == 0) n = n / 2; else n = 3 * n + 1; s = s + dt; }\n"
+    "    return s;\n"
+    "}\n";
+
+static double Seconds(clock_t start)
+{
+    return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+static void Compare(const char* name, SScriptContext* context, SWideContext* wide, int function,
+    const void* const* inputs, hsbfloat* batchResults, hsbfloat* wideResults)
+{
+    clock_t start = clock();
+    for (int frame = 0; frame < NUM_FRAMES; ++frame)
+        CallFunctionBatch(context, function, inputs, 3, batchResults, NUM_ROWS);
+    double batch = Seconds(start) / NUM_FRAMES;
+
+    start = clock();
+    for (int frame = 0; frame < NUM_FRAMES; ++frame)
+        CallFunctionWide(wide, function, inputs, 3, wideResults, NUM_ROWS);
+    double wideSeconds = Seconds(start) / NUM_FRAMES;
+
+    printf("%-10s %12.2f %12.2f %11.2fx%s\n", name, batch * 1000.0, wideSeconds * 1000.0, batch / wideSeconds,
+        memcmp(batchResults, wideResults, NUM_ROWS * sizeof(hsbfloat)) == 0 ? "" : " RESULTS DIFFER");
+}
+
+int main()
+{
+    SProgram program;
+    if (CreateProgram(s_code, strlen(s_code), NULL, &program) != R_OK)
+        return 1;
+
+    SScriptContext context;
+    InitScriptContext(&context, &program);
+    SWideContext wide;
+    InitWideContext(&wide, &program);
+
+    hsbfloat* positions = malloc(NUM_ROWS * sizeof(hsbfloat));
+    hsbfloat* velocities = malloc(NUM_ROWS * sizeof(hsbfloat));
+    hsbfloat* deltas = malloc(NUM_ROWS * sizeof(hsbfloat));
+    hsbint* counts = malloc(NUM_ROWS * sizeof(hsbint));
+    hsbfloat* batchResults = malloc(NUM_ROWS * sizeof(hsbfloat));
+    hsbfloat* wideResults = malloc(NUM_ROWS * sizeof(hsbfloat));
+    for (int i = 0; i < NUM_ROWS; ++i)
+    {
+        positions[i] = (float)(i % 100) - 50.0f;
+        velocities[i] = (float)(i % 7);
+        deltas[i] = 0.5f;
+        counts[i] = (hsbint)(i % 30 + 1);
+    }
+
+    printf("%-10s %12s %12s %12s\n", "function", "batch [ms]", "wide [ms]", "speedup");
+
+    const void* updateInputs[] = { positions, velocities, deltas };
+    Compare("update", &context, &wide, FindFunction(&program, "update"), updateInputs, batchResults, wideResults);
+
+    const void* stepsInputs[] = { counts, deltas, deltas };
+    Compare("steps", &context, &wide, FindFunction(&program, "steps"), stepsInputs, batchResults, wideResults);
+
+    free(wideResults);
+    free(batchResults);
+    free(counts);
+    free(deltas);
+    free(velocities);
+    free(positions);
+    DeleteWideContext(&wide);
+    DeleteScriptContext(&context);
+    DeleteProgram(&program);
+    return 0;
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <stdio.h>
+
+#include "bytecode_d.h"
+
+// Ahead-of-time translation of bytecode to C, for scripts shipped with the host. The
+// translation is a single function
+//     Bool8 <functionName>(SVMData* vmData);
+// which is called instead of VMRunVerified on a VM set up with the same instructions.
+// Operands and variables live in C locals (the verifier proves a single stack layout
+// at every instruction), jumps are gotos and INS_RETURN dispatches on the return address.
+// The data stack is written once at INS_END, so the VM looks the same as after
+// VMRunVerified. INS_YIELD writes it the same way and returns HS_TRUE. A VM that is not at the
+// beginning of the program, like one that yielded, is handed over to VMRunVerified, the
+// translation only starts from the first instruction. Native functions
+// (INS_CALL_EXT) get their arguments pushed to the data stack, which has to have room for them.
+// An INS_CALL_ASYNC that waits writes the data stack like INS_YIELD, without the arguments.
+// The generated code does not depend on HS_SLOT_STACK, the host build selects the layout.
+
+//------------------------------------------------------------------------------
+// Verifies the instructions (see VerifyInstructions) and writes the C source to out.
+// Fails for invalid code.
+EResult TranslateToC(SStackData instructions, const char* functionName, FILE* out);
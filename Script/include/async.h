@@ -0,0 +1,77 @@
+#pragma once
+
+#include "embed.h"
+
+// Natives that wait for their result without blocking the thread of the VM (see natives.h).
+// An async native starts the operation, e.g. a file read on another thread, stores a token
+// of it in vmData->asyncCall and returns without a result. The VM stops after the call and
+// the context keeps everything else of the script, so nothing runs until the result is there.
+// The thread that did the operation posts the token and the result to a completion queue,
+// the thread of the VM takes them and completes the calls:
+//
+//     static void NativeRead(SVMData* vmData)
+//     {
+//         hsbint file = PopInt(&vmData->dataStack.base.stackPointer);
+//         vmData->asyncCall = StartRead(file); // PostCompletion(&queue, token, bytes) once read
+//     }
+//
+//     RegisterAsyncNative(&natives, "read", "int(int)", NativeRead);
+//
+// A scheduler (scheduler.h) keeps thousands of such scripts in flight on one thread: waiting
+// instances cost nothing per tick, a tick completes the calls of the posted tokens and resumes
+// their instances. Tokens are chosen by the host and are not negative, only the calls that
+// wait at the same time need different ones.
+//
+// A completion can also leave its result to the thread that takes it (PostDeferredCompletion),
+// e.g. a channel (channel.h) wakes its receiver and the receiver takes the message itself.
+
+//------------------------------------------------------------------------------
+// The result of a deferred completion, called by the thread that takes it
+typedef SScriptValue (DeferredResult)(void* data);
+
+//------------------------------------------------------------------------------
+typedef struct SCompletion
+{
+    struct SCompletion* next;
+    int token;
+    SScriptValue result;
+    DeferredResult* deferred; // Gets the result instead when it is not NULL
+    void* data;
+} SCompletion;
+
+//------------------------------------------------------------------------------
+// Any number of threads post, one takes. The completions are a list pushed with a compare and
+// swap, the taker swaps the whole list out at once.
+typedef struct
+{
+    SCompletion* head; // The last one posted
+} SCompletionQueue;
+
+//------------------------------------------------------------------------------
+// Called by TakeCompletions for every completion
+typedef void (CompletionHandler)(void* data, int token, SScriptValue result);
+
+//------------------------------------------------------------------------------
+// Pushes the result of the INS_CALL_ASYNC the VM waits for, in the member of its type, the
+// next run continues after the call. vmData->asyncCall is HS_NO_ASYNC_CALL after.
+void CompleteAsyncCall(SVMData* vmData, SScriptValue result);
+
+//------------------------------------------------------------------------------
+void InitCompletionQueue(SCompletionQueue* queue);
+
+//------------------------------------------------------------------------------
+// Frees the completions that were not taken
+void DeleteCompletionQueue(SCompletionQueue* queue);
+
+//------------------------------------------------------------------------------
+// Adds the result of the operation with the token, from any thread
+void PostCompletion(SCompletionQueue* queue, int token, SScriptValue result);
+
+//------------------------------------------------------------------------------
+// PostCompletion with a result that TakeCompletions gets from deferred(data) when it takes it
+void PostDeferredCompletion(SCompletionQueue* queue, int token, DeferredResult* deferred, void* data);
+
+//------------------------------------------------------------------------------
+// Calls handler for the completions posted so far in the order they were posted, returns their
+// number. Only one thread at a time may take.
+int TakeCompletions(SCompletionQueue* queue, CompletionHandler* handler, void* data);
@@ -31,9 +31,17 @@ inline void DeleteStack(SStackData stackData)
 inline void InitVM(SVMData* vmData, SStackData instructionStack, int dataSize, FuncArray functions)
 {
 	vmData->instructionStack = instructionStack;
+#ifdef HS_SLOT_STACK
+	// keep the variable area (growing down from the end) slot aligned
+	dataSize -= dataSize % sizeof(SValue);
+#endif
 	vmData->dataStack.base = CreateStack(dataSize);
 	vmData->dataStack.reversePointer = vmData->dataStack.base.end;
 	vmData->functions = functions;
+	vmData->error = VM_OK;
+	vmData->callReserve = 0;
+	vmData->framePointer = vmData->dataStack.base.begin;
+	vmData->asyncCall = HS_NO_ASYNC_CALL;
 }
 
 inline void DeleteVM(SVMData* vmData, Bool8 keepInstructions, Bool8 keepFunctions)
@@ -139,20 +147,174 @@ inline void StoreBoolFwd(byte** pointer, hsbbool value)
 	*pointer += sizeof(hsbbool);
 }
 
+// Data stack operations (the layout depends on HS_SLOT_STACK, see bytecode_d.h)
+#ifdef HS_SLOT_STACK
+// whole slots are written, unused bytes are zero
+inline SValue IntSlot(hsbint value)
+{
+	SValue slot = { .raw = 0 };
+	slot.i = value;
+	return slot;
+}
+
+inline SValue FloatSlot(hsbfloat value)
+{
+	SValue slot = { .raw = 0 };
+	slot.f = value;
+	return slot;
+}
+
+inline SValue BoolSlot(hsbbool value)
+{
+	SValue slot = { .raw = 0 };
+	slot.b = value;
+	return slot;
+}
+
+inline SValue AddressSlot(hsbaddress value)
+{
+	SValue slot = { .raw = 0 };
+	slot.a = value;
+	return slot;
+}
+
+inline void PushInt(byte** pointer, hsbint value)
+{
+	*(SValue*)*pointer = IntSlot(value);
+	*pointer += sizeof(SValue);
+}
+
+inline void PushFloat(byte** pointer, hsbfloat value)
+{
+	*(SValue*)*pointer = FloatSlot(value);
+	*pointer += sizeof(SValue);
+}
+
+inline void PushBool(byte** pointer, hsbbool value)
+{
+	*(SValue*)*pointer = BoolSlot(value);
+	*pointer += sizeof(SValue);
+}
+
+inline hsbint PopInt(byte** pointer)
+{
+	*pointer -= sizeof(SValue);
+	return ((SValue*)*pointer)->i;
+}
+
+inline hsbfloat PopFloat(byte** pointer)
+{
+	*pointer -= sizeof(SValue);
+	return ((SValue*)*pointer)->f;
+}
+
+inline hsbbool PopBool(byte** pointer)
+{
+	*pointer -= sizeof(SValue);
+	return ((SValue*)*pointer)->b;
+}
+
+inline hsbint LoadVarInt(byte* pointer)
+{
+	return ((SValue*)pointer)->i;
+}
+
+inline hsbfloat LoadVarFloat(byte* pointer)
+{
+	return ((SValue*)pointer)->f;
+}
+
+inline void StoreVarInt(byte* pointer, hsbint value)
+{
+	*(SValue*)pointer = IntSlot(value);
+}
+
+inline void StoreVarFloat(byte* pointer, hsbfloat value)
+{
+	*(SValue*)pointer = FloatSlot(value);
+}
+#else
+inline void PushInt(byte** pointer, hsbint value)
+{
+	StoreIntFwd(pointer, value);
+}
+
+inline void PushFloat(byte** pointer, hsbfloat value)
+{
+	StoreFloatFwd(pointer, value);
+}
+
+inline void PushBool(byte** pointer, hsbbool value)
+{
+	StoreBoolFwd(pointer, value);
+}
+
+inline hsbint PopInt(byte** pointer)
+{
+	return LoadIntFwd(pointer);
+}
+
+inline hsbfloat PopFloat(byte** pointer)
+{
+	return LoadFloatFwd(pointer);
+}
+
+inline hsbbool PopBool(byte** pointer)
+{
+	return LoadBoolFwd(pointer);
+}
+
+inline hsbint LoadVarInt(byte* pointer)
+{
+	return LoadInt(pointer);
+}
+
+inline hsbfloat LoadVarFloat(byte* pointer)
+{
+	return LoadFloat(pointer);
+}
+
+inline void StoreVarInt(byte* pointer, hsbint value)
+{
+	StoreInt(pointer, value);
+}
+
+inline void StoreVarFloat(byte* pointer, hsbfloat value)
+{
+	StoreFloat(pointer, value);
+}
+#endif
+
+// number of values on the data stack, only countable when every value has the same size
+#ifdef HS_SLOT_STACK
+inline int GetDataStackDepth(const SVMData* vmData)
+{
+	return (int)((vmData->dataStack.base.stackPointer - vmData->dataStack.base.begin) / sizeof(SValue));
+}
+#endif
+
 // store and load address to the variable space
 inline void StoreAddressVar(byte** varPointer, hsbaddress address)
 {
 	// var stack grows in the opposite direction
-	*varPointer -= sizeof(hsbaddress);
+	*varPointer -= HS_DATA_SIZE_ADDRESS;
+#ifdef HS_SLOT_STACK
+	*(SValue*)*varPointer = AddressSlot(address);
+#else
 	memcpy(*varPointer, &address, sizeof(hsbaddress));
+#endif
 }
 
 inline hsbaddress LoadAddressVar(byte** varPointer)
 {
 	hsbaddress address;
+#ifdef HS_SLOT_STACK
+	address = ((SValue*)*varPointer)->a;
+#else
 	memcpy(&address, *varPointer, sizeof(hsbaddress));
+#endif
 	// delete address from the variable stack
-	*varPointer += sizeof(hsbaddress);
+	*varPointer += HS_DATA_SIZE_ADDRESS;
 	return address;
 }
 
@@ -174,342 +336,22 @@ inline void LoadInsStackPointerVar(SVMData* vmData)
 
 
 
+// Processes up to count instructions, returns HS_FALSE when the program ended. Stops early
+// after an INS_YIELD and after an INS_CALL_ASYNC that waits, which CompleteAsyncCall (async.h)
+// has to complete before the next call.
 inline Bool8 VMProcessInstructions(SVMData* vmData, int count)
 {
-	for (int i=0; i < count; ++i)
-	{
-		EInstruction instruction = *vmData->instructionStack.stackPointer++;
-		
-		switch (instruction)
-		{
-			case INS_NOOP:
-			{
-				break;
-			}
-			
-			case INS_ADD_I:
-			{
-				hsbint second = LoadIntFwd(&vmData->dataStack.base.stackPointer);
-				hsbint first = LoadIntFwd(&vmData->dataStack.base.stackPointer);
-				
-				hsbint result = first + second;
-				StoreIntFwd(&vmData->dataStack.base.stackPointer, result);
-				break;
-			}
-			
-			case INS_ADD_F:
-			{
-				hsbfloat second = LoadFloatFwd(&vmData->dataStack.base.stackPointer);
-				hsbfloat first = LoadFloatFwd(&vmData->dataStack.base.stackPointer);
-				
-				hsbfloat result = first + second;
-				StoreIntFwd(&vmData->dataStack.base.stackPointer, result);
-				break;
-			}
-			case INS_SUBSTRACT_I:
-			{
-				hsbint second = LoadIntFwd(&vmData->dataStack.base.stackPointer);
-				hsbint first = LoadIntFwd(&vmData->dataStack.base.stackPointer);
-				
-				hsbint result = first - second;
-				StoreIntFwd(&vmData->dataStack.base.stackPointer, result);
-				break;
-			}
-			case INS_SUBSTRACT_F:
-			{
-				hsbfloat second = LoadFloatFwd(&vmData->dataStack.base.stackPointer);
-				hsbfloat first = LoadFloatFwd(&vmData->dataStack.base.stackPointer);
-				
-				hsbfloat result = first - second;
-				StoreIntFwd(&vmData->dataStack.base.stackPointer, result);
-				break;
-			}
-			case INS_MULTIPLY_I:
-			{
-				hsbint second = LoadIntFwd(&vmData->dataStack.base.stackPointer);
-				hsbint first = LoadIntFwd(&vmData->dataStack.base.stackPointer);
-				
-				hsbint result = first * second;
-				StoreIntFwd(&vmData->dataStack.base.stackPointer, result);
-				break;
-			}
-			case INS_MULTIPLY_F:
-			{
-				hsbfloat second = LoadFloatFwd(&vmData->dataStack.base.stackPointer);
-				hsbfloat first = LoadFloatFwd(&vmData->dataStack.base.stackPointer);
-				
-				hsbfloat result = first * second;
-				StoreIntFwd(&vmData->dataStack.base.stackPointer, result);
-				break;
-			}
-			case INS_DIVIDE_I:
-			{
-				hsbint second = LoadIntFwd(&vmData->dataStack.base.stackPointer);
-				hsbint first = LoadIntFwd(&vmData->dataStack.base.stackPointer);
-				
-				hsbint result = first / second;
-				StoreIntFwd(&vmData->dataStack.base.stackPointer, result);
-				break;
-			}
-			case INS_DIVIDE_F:
-			{
-				hsbfloat second = LoadFloatFwd(&vmData->dataStack.base.stackPointer);
-				hsbfloat first = LoadFloatFwd(&vmData->dataStack.base.stackPointer);
-				
-				hsbfloat result = first / second;
-				StoreIntFwd(&vmData->dataStack.base.stackPointer, result);
-				break;
-			}
-
-			case INS_LITERAL_I:
-			{
-				// load from instructions
-				hsbint value = LoadInt(vmData->instructionStack.stackPointer);
-				vmData->instructionStack.stackPointer += sizeof(hsbint);
-				
-				// store to data
-				StoreIntFwd(&vmData->dataStack.base.stackPointer, value);
-				break;
-			}
-			case INS_LITERAL_F:
-			{
-				// load from instructions
-				hsbfloat value = LoadFloat(vmData->instructionStack.stackPointer);
-				vmData->instructionStack.stackPointer += sizeof(hsbfloat);
-				
-				// store to data
-				StoreFloatFwd(&vmData->dataStack.base.stackPointer, value);
-				break;
-			}
-			
-			case INS_LITERAL_B:
-			{
-				// load from instructions
-				hsbbool value = LoadBool(vmData->instructionStack.stackPointer);
-				vmData->instructionStack.stackPointer += sizeof(hsbbool);
-				
-				// store to data
-				StoreBoolFwd(&vmData->dataStack.base.stackPointer, value);
-				break;
-			}
-			case INS_NEGATE_B:
-			{
-				hsbbool value = LoadBoolFwd(&vmData->dataStack.base.stackPointer);
-				
-				// negate (bools have values 0 or 1)
-				value = 1 - value;
-				
-				StoreBoolFwd(&vmData->dataStack.base.stackPointer, value);
-				
-				break;
-			}
-			case INS_AND_B:
-			{
-				hsbbool second = LoadBoolFwd(&vmData->dataStack.base.stackPointer);
-				hsbbool first = LoadBoolFwd(&vmData->dataStack.base.stackPointer);
-				
-				hsbbool result = first & second;
-				StoreBoolFwd(&vmData->dataStack.base.stackPointer, result);
-				
-				break;
-			}
-			case INS_OR_B:
-			{
-				hsbbool second = LoadBoolFwd(&vmData->dataStack.base.stackPointer);
-				hsbbool first = LoadBoolFwd(&vmData->dataStack.base.stackPointer);
-				
-				hsbbool result = first | second;
-				StoreBoolFwd(&vmData->dataStack.base.stackPointer, result);
-				
-				break;
-			}
-			
-			
-			case INS_CMP_I_EQ:
-			{
-				hsbint second = LoadIntFwd(&vmData->dataStack.base.stackPointer);
-				hsbint first = LoadIntFwd(&vmData->dataStack.base.stackPointer);
-				
-				hsbbool result = first == second;
-				StoreBoolFwd(&vmData->dataStack.base.stackPointer, result);
-				
-				break;
-			}
-			case INS_CMP_I_LESS:
-			{
-				hsbint second = LoadIntFwd(&vmData->dataStack.base.stackPointer);
-				hsbint first = LoadIntFwd(&vmData->dataStack.base.stackPointer);
-				
-				hsbbool result = first < second;
-				StoreBoolFwd(&vmData->dataStack.base.stackPointer, result);
-				
-				break;
-			}
-			case INS_CMP_I_LESS_EQ:
-			{
-				hsbint second = LoadIntFwd(&vmData->dataStack.base.stackPointer);
-				hsbint first = LoadIntFwd(&vmData->dataStack.base.stackPointer);
-				
-				hsbbool result = first <= second;
-				StoreBoolFwd(&vmData->dataStack.base.stackPointer, result);
-				
-				break;
-			}
-			
-			case INS_CMP_F_EQ:
-			{
-				hsbfloat second = LoadFloatFwd(&vmData->dataStack.base.stackPointer);
-				hsbfloat first = LoadFloatFwd(&vmData->dataStack.base.stackPointer);
-				
-				hsbbool result = first == second;
-				StoreBoolFwd(&vmData->dataStack.base.stackPointer, result);
-				
-				break;
-			}
-			case INS_CMP_F_LESS:
-			{
-				hsbfloat second = LoadFloatFwd(&vmData->dataStack.base.stackPointer);
-				hsbfloat first = LoadFloatFwd(&vmData->dataStack.base.stackPointer);
-				
-				hsbbool result = first < second;
-				StoreBoolFwd(&vmData->dataStack.base.stackPointer, result);
-				
-				break;
-			}
-			case INS_CMP_F_LESS_EQ:
-			{
-				hsbfloat second = LoadFloatFwd(&vmData->dataStack.base.stackPointer);
-				hsbfloat first = LoadFloatFwd(&vmData->dataStack.base.stackPointer);
-				
-				hsbbool result = first <= second;
-				StoreBoolFwd(&vmData->dataStack.base.stackPointer, result);
-				
-				break;
-			}
-
-			case INS_ALLOC_VAR_I:
-			{
-				vmData->dataStack.reversePointer -= sizeof(hsbint);
-				break;
-			}
-			
-			case INS_ALLOC_VAR_F:
-			{
-				vmData->dataStack.reversePointer -= sizeof(hsbfloat);
-				break;
-			}
-			
-			case INS_DEALLOC_VAR_I:
-			{
-				vmData->dataStack.reversePointer += sizeof(hsbint);
-				break;
-			}
-			
-			case INS_DEALLOC_VAR_F:
-			{
-				vmData->dataStack.reversePointer += sizeof(hsbfloat);
-				break;
-			}
-
-			case INS_SAVE_VAR_I:
-			{
-				int offset = *vmData->instructionStack.stackPointer++;
-				hsbint value = LoadIntFwd(&vmData->dataStack.base.stackPointer);
-				
-				StoreInt(vmData->dataStack.reversePointer + offset, value);
-				break;
-			}
-			
-			case INS_SAVE_VAR_F:
-			{
-				int offset = *vmData->instructionStack.stackPointer++;
-				hsbfloat value = LoadFloatFwd(&vmData->dataStack.base.stackPointer);
-				
-				StoreFloat(vmData->dataStack.reversePointer + offset, value);
-				break;
-			}
-			
-			case INS_LOAD_VAR_I:
-			{
-				int offset = *vmData->instructionStack.stackPointer++;
-				
-				hsbint value = LoadInt(vmData->dataStack.reversePointer + offset);
-				
-				StoreIntFwd(&vmData->dataStack.base.stackPointer, value);
-				break;
-			}
-			
-			case INS_LOAD_VAR_F:
-			{
-				int offset = *vmData->instructionStack.stackPointer++;
-				
-				hsbfloat value = LoadFloat(vmData->dataStack.reversePointer + offset);
-				
-				StoreFloatFwd(&vmData->dataStack.base.stackPointer, value);
-				break;
-			}
-
-			case INS_JUMP:
-			{
-				hsbaddress address = LoadAddress(vmData->instructionStack.stackPointer);
-				// do not need to move the stack pointer, we're jumping anyway
-				// vmData->instructionStack.stackPointer += sizeof(hsbaddress);
-				vmData->instructionStack.stackPointer = vmData->instructionStack.begin + address;
-				
-				break;
-			}
-			
-			case INS_COND_JUMP_B:
-			{
-				hsbaddress address = LoadAddress(vmData->instructionStack.stackPointer);
-				vmData->instructionStack.stackPointer += sizeof(hsbaddress);
-				
-				hsbbool value = LoadBoolFwd(&vmData->dataStack.base.stackPointer);
-				
-				if (value != 0)
-				{
-					// jump
-					vmData->instructionStack.stackPointer = vmData->instructionStack.begin + address;
-				}
-				
-				break;
-			}
-
-			case INS_CALL:
-			{
-				hsbaddress address = LoadAddress(vmData->instructionStack.stackPointer);
-				vmData->instructionStack.stackPointer += sizeof(hsbaddress);
-				
-				// save current position
-				SaveInsStackPointerVar(vmData);
-				// move to the function instructions
-				vmData->instructionStack.stackPointer = vmData->instructionStack.begin + address;
-				break;
-			}
-			
-			case INS_RETURN:
-			{
-				LoadInsStackPointerVar(vmData);
-				break;
-			}
-			
-			case INS_CALL_EXT:
-			{
-				// TODO - add support for some native functions, implemented in C
-				break;
-			}
-			
-			default:
-				// error, unrecognized instruction, exit immediately 
-				return HS_FALSE;
-		}
-		
-		// no instructions left, reached end of the program
-		if (vmData->instructionStack.stackPointer >= vmData->instructionStack.end)
-		{
-			return HS_FALSE;
-		}
-	}
-	
-	return HS_TRUE;
+#define HS_VM_CHECKED 1
+#include "bytecode_interpreter.inl"
+#undef HS_VM_CHECKED
+}
+
+// Runs the program until INS_END without any runtime checks. Only for instructions
+// accepted by VerifyInstructions (verifier.h). Returns HS_FALSE as the program ended, HS_TRUE
+// after an INS_YIELD or a waiting INS_CALL_ASYNC, when the next call continues the program.
+inline Bool8 VMRunVerified(SVMData* vmData)
+{
+#define HS_VM_CHECKED 0
+#include "bytecode_interpreter.inl"
+#undef HS_VM_CHECKED
 }
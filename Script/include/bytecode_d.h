@@ -9,6 +9,30 @@ typedef float hsbfloat;
 typedef uint16_t hsbaddress;
 typedef uint8_t hsbbool;
 
+// Build with HS_SLOT_STACK defined to store every value on the data stack and in the variable
+// area in its own naturally aligned 8-byte slot. Loads and stores are then single aligned moves
+// and the stack depth can be counted in slots. By default values are packed at byte offsets.
+#ifdef HS_SLOT_STACK
+typedef union
+{
+	hsbint i;
+	hsbfloat f;
+	hsbbool b;
+	hsbaddress a;
+	uint64_t raw;
+} SValue;
+
+#define HS_DATA_SIZE_INT sizeof(SValue)
+#define HS_DATA_SIZE_FLOAT sizeof(SValue)
+#define HS_DATA_SIZE_BOOL sizeof(SValue)
+#define HS_DATA_SIZE_ADDRESS sizeof(SValue)
+#else
+#define HS_DATA_SIZE_INT sizeof(hsbint)
+#define HS_DATA_SIZE_FLOAT sizeof(hsbfloat)
+#define HS_DATA_SIZE_BOOL sizeof(hsbbool)
+#define HS_DATA_SIZE_ADDRESS sizeof(hsbaddress)
+#endif
+
 struct SVMData;
 typedef void (NativeFP)(struct SVMData* vmData);
 
@@ -25,17 +49,41 @@ typedef struct
 	byte* reversePointer;
 } SDoubleStackData;
 
+// Native functions by the index INS_CALL_EXT calls them with (see natives.h)
 typedef struct
 {
 	int count;
-	NativeFP* begin;
+	NativeFP** begin;
 } FuncArray;
 
-typedef struct
+// Types in the signature of a native function, the operands of INS_CALL_EXT encode them
+typedef enum
+{
+	NATIVE_NONE, // no result
+	NATIVE_INT,
+	NATIVE_FLOAT,
+} ENativeType;
+
+#define HS_NATIVE_MAX_ARGUMENTS 8
+
+typedef enum
+{
+	VM_OK,
+	VM_ERROR_INVALID_INSTRUCTION,
+	VM_ERROR_STACK_OVERFLOW,
+} EVMError;
+
+#define HS_NO_ASYNC_CALL -1
+
+typedef struct SVMData
 {
 	SStackData instructionStack;
 	SDoubleStackData dataStack;
 	FuncArray functions;
+	EVMError error; // why the VM stopped early, VM_OK when it ran to the end
+	int callReserve; // free data stack bytes INS_CALL requires, 0 disables the check (see stack_usage.h)
+	byte* framePointer; // first argument of the function in an INS_ENTER frame, the operand stack begin outside of frames
+	int asyncCall; // token of the INS_CALL_ASYNC the VM waits for, HS_NO_ASYNC_CALL when it does not wait
 } SVMData;
 
 typedef enum
@@ -83,7 +131,40 @@ typedef enum
 	INS_CALL,
 	INS_RETURN,
 	
-	INS_CALL_EXT
+	INS_CALL_EXT,                // index, argument count, float arguments (a bit each, the first lowest), result type
+	
+	INS_END,
+	
+	// superinstructions, produced by FuseSuperinstructions (optimizer.h)
+	INS_LOAD_VAR_VAR_ADD_I,      // LOAD_VAR_I a, LOAD_VAR_I b, ADD_I
+	INS_LOAD_VAR_VAR_SUBSTRACT_I,
+	INS_LOAD_VAR_VAR_MULTIPLY_I,
+	INS_ADD_LITERAL_I,           // LITERAL_I value, ADD_I
+	INS_SUBSTRACT_LITERAL_I,
+	INS_MULTIPLY_LITERAL_I,
+	INS_CMP_I_EQ_JUMP,           // CMP_I_EQ, COND_JUMP_B address
+	INS_CMP_I_LESS_JUMP,
+	INS_CMP_I_LESS_EQ_JUMP,
+	INS_MOVE_VAR_I,              // LOAD_VAR_I from, SAVE_VAR_I to
+	INS_MOVE_VAR_F,
+	
+	// frames, the arguments stay on the operand stack and become the first locals of the function
+	INS_ENTER,                   // argument size, int locals, float locals
+	INS_LOAD_FRAME_I,            // offset from the frame pointer
+	INS_LOAD_FRAME_F,
+	INS_SAVE_FRAME_I,
+	INS_SAVE_FRAME_F,
+	INS_LEAVE,                   // drops the frame and returns
+	INS_LEAVE_I,                 // drops the frame, returns the int on top in place of the arguments
+	INS_LEAVE_F,
+	INS_TAIL_CALL,               // address, argument size: the callee takes over the frame (see optimizer.h)
+	
+	INS_SWITCH,                  // low, count: takes one of the count + 1 INS_JUMP after it, the first when out of range
+	
+	INS_YIELD,                   // stops the interpreter after the instruction, calling it again resumes the script
+	INS_CALL_ASYNC,              // operands of INS_CALL_EXT: a native that can wait for its result (see async.h)
+	
+	INS_COUNT
 	
 } EInstruction;
 
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "bytecode_d.h"
+
+//------------------------------------------------------------------------------
+const char* GetInstructionName(EInstruction instruction);
+
+//------------------------------------------------------------------------------
+// Size of the instruction including its operands, 0 for invalid instructions
+int GetInstructionSize(EInstruction instruction);
+
+//------------------------------------------------------------------------------
+// Whether the first operand of the instruction is an instruction address
+Bool8 HasAddressOperand(EInstruction instruction);
+
+//------------------------------------------------------------------------------
+// Operand bytes the instruction pops and then pushes, and bytes it adds to the variable area
+// (negative when it removes them). INS_CALL and INS_RETURN depend on the called function
+// and report 0. INS_ENTER and the INS_LEAVE instructions and INS_TAIL_CALL depend on their
+// operands and the frame, they report 0 as well, so do INS_CALL_EXT and INS_CALL_ASYNC (see
+// GetCallExtEffect).
+void GetStackEffect(EInstruction instruction, int* outPopSize, int* outPushSize, int* outVarDelta);
+
+//------------------------------------------------------------------------------
+// Operand bytes the INS_CALL_EXT or INS_CALL_ASYNC at ins pops and pushes, from the signature
+// in its operands. The result of INS_CALL_ASYNC can be pushed later by CompleteAsyncCall.
+void GetCallExtEffect(const byte* ins, int* outPopSize, int* outPushSize);
+
+//------------------------------------------------------------------------------
+// Prints one instruction per line with its address and operands
+void PrintInstructions(SStackData instructions);
@@ -0,0 +1,739 @@
+// Body of the interpreter loop, included by the entry points in bytecode_c.h.
+// HS_VM_CHECKED selects whether the instruction count and the end of the instruction stack are
+// tested. Unchecked code has to stop at INS_END, which VerifyInstructions (verifier.h) proves.
+// HS_VM_COUNTED adds the hotness counters of tiered execution (tiered.c), which has a
+// SHotness* hotness in scope.
+// HS_VM_PROFILED adds the instruction profiler (profiler.c), which has a SProfile* profile in
+// scope.
+
+#if HS_VM_CHECKED
+	for (int i=0; i < count; ++i)
+#else
+	for (;;)
+#endif
+	{
+#if HS_VM_PROFILED
+		ProfileInstruction(profile, vmData);
+#endif
+		EInstruction instruction = *vmData->instructionStack.stackPointer++;
+		
+		switch (instruction)
+		{
+			case INS_NOOP:
+			{
+				break;
+			}
+			
+			case INS_ADD_I:
+			{
+				hsbint second = PopInt(&vmData->dataStack.base.stackPointer);
+				hsbint first = PopInt(&vmData->dataStack.base.stackPointer);
+				
+				hsbint result = first + second;
+				PushInt(&vmData->dataStack.base.stackPointer, result);
+				break;
+			}
+			
+			case INS_ADD_F:
+			{
+				hsbfloat second = PopFloat(&vmData->dataStack.base.stackPointer);
+				hsbfloat first = PopFloat(&vmData->dataStack.base.stackPointer);
+				
+				hsbfloat result = first + second;
+				PushFloat(&vmData->dataStack.base.stackPointer, result);
+				break;
+			}
+			case INS_SUBSTRACT_I:
+			{
+				hsbint second = PopInt(&vmData->dataStack.base.stackPointer);
+				hsbint first = PopInt(&vmData->dataStack.base.stackPointer);
+				
+				hsbint result = first - second;
+				PushInt(&vmData->dataStack.base.stackPointer, result);
+				break;
+			}
+			case INS_SUBSTRACT_F:
+			{
+				hsbfloat second = PopFloat(&vmData->dataStack.base.stackPointer);
+				hsbfloat first = PopFloat(&vmData->dataStack.base.stackPointer);
+				
+				hsbfloat result = first - second;
+				PushFloat(&vmData->dataStack.base.stackPointer, result);
+				break;
+			}
+			case INS_MULTIPLY_I:
+			{
+				hsbint second = PopInt(&vmData->dataStack.base.stackPointer);
+				hsbint first = PopInt(&vmData->dataStack.base.stackPointer);
+				
+				hsbint result = first * second;
+				PushInt(&vmData->dataStack.base.stackPointer, result);
+				break;
+			}
+			case INS_MULTIPLY_F:
+			{
+				hsbfloat second = PopFloat(&vmData->dataStack.base.stackPointer);
+				hsbfloat first = PopFloat(&vmData->dataStack.base.stackPointer);
+				
+				hsbfloat result = first * second;
+				PushFloat(&vmData->dataStack.base.stackPointer, result);
+				break;
+			}
+			case INS_DIVIDE_I:
+			{
+				hsbint second = PopInt(&vmData->dataStack.base.stackPointer);
+				hsbint first = PopInt(&vmData->dataStack.base.stackPointer);
+				
+				hsbint result = first / second;
+				PushInt(&vmData->dataStack.base.stackPointer, result);
+				break;
+			}
+			case INS_DIVIDE_F:
+			{
+				hsbfloat second = PopFloat(&vmData->dataStack.base.stackPointer);
+				hsbfloat first = PopFloat(&vmData->dataStack.base.stackPointer);
+				
+				hsbfloat result = first / second;
+				PushFloat(&vmData->dataStack.base.stackPointer, result);
+				break;
+			}
+
+			case INS_LITERAL_I:
+			{
+				// load from instructions
+				hsbint value = LoadInt(vmData->instructionStack.stackPointer);
+				vmData->instructionStack.stackPointer += sizeof(hsbint);
+				
+				// store to data
+				PushInt(&vmData->dataStack.base.stackPointer, value);
+				break;
+			}
+			case INS_LITERAL_F:
+			{
+				// load from instructions
+				hsbfloat value = LoadFloat(vmData->instructionStack.stackPointer);
+				vmData->instructionStack.stackPointer += sizeof(hsbfloat);
+				
+				// store to data
+				PushFloat(&vmData->dataStack.base.stackPointer, value);
+				break;
+			}
+			
+			case INS_LITERAL_B:
+			{
+				// load from instructions
+				hsbbool value = LoadBool(vmData->instructionStack.stackPointer);
+				vmData->instructionStack.stackPointer += sizeof(hsbbool);
+				
+				// store to data
+				PushBool(&vmData->dataStack.base.stackPointer, value);
+				break;
+			}
+			case INS_NEGATE_B:
+			{
+				hsbbool value = PopBool(&vmData->dataStack.base.stackPointer);
+				
+				// negate (bools have values 0 or 1)
+				value = 1 - value;
+				
+				PushBool(&vmData->dataStack.base.stackPointer, value);
+				
+				break;
+			}
+			case INS_AND_B:
+			{
+				hsbbool second = PopBool(&vmData->dataStack.base.stackPointer);
+				hsbbool first = PopBool(&vmData->dataStack.base.stackPointer);
+				
+				hsbbool result = first & second;
+				PushBool(&vmData->dataStack.base.stackPointer, result);
+				
+				break;
+			}
+			case INS_OR_B:
+			{
+				hsbbool second = PopBool(&vmData->dataStack.base.stackPointer);
+				hsbbool first = PopBool(&vmData->dataStack.base.stackPointer);
+				
+				hsbbool result = first | second;
+				PushBool(&vmData->dataStack.base.stackPointer, result);
+				
+				break;
+			}
+			
+			
+			case INS_CMP_I_EQ:
+			{
+				hsbint second = PopInt(&vmData->dataStack.base.stackPointer);
+				hsbint first = PopInt(&vmData->dataStack.base.stackPointer);
+				
+				hsbbool result = first == second;
+				PushBool(&vmData->dataStack.base.stackPointer, result);
+				
+				break;
+			}
+			case INS_CMP_I_LESS:
+			{
+				hsbint second = PopInt(&vmData->dataStack.base.stackPointer);
+				hsbint first = PopInt(&vmData->dataStack.base.stackPointer);
+				
+				hsbbool result = first < second;
+				PushBool(&vmData->dataStack.base.stackPointer, result);
+				
+				break;
+			}
+			case INS_CMP_I_LESS_EQ:
+			{
+				hsbint second = PopInt(&vmData->dataStack.base.stackPointer);
+				hsbint first = PopInt(&vmData->dataStack.base.stackPointer);
+				
+				hsbbool result = first <= second;
+				PushBool(&vmData->dataStack.base.stackPointer, result);
+				
+				break;
+			}
+			
+			case INS_CMP_F_EQ:
+			{
+				hsbfloat second = PopFloat(&vmData->dataStack.base.stackPointer);
+				hsbfloat first = PopFloat(&vmData->dataStack.base.stackPointer);
+				
+				hsbbool result = first == second;
+				PushBool(&vmData->dataStack.base.stackPointer, result);
+				
+				break;
+			}
+			case INS_CMP_F_LESS:
+			{
+				hsbfloat second = PopFloat(&vmData->dataStack.base.stackPointer);
+				hsbfloat first = PopFloat(&vmData->dataStack.base.stackPointer);
+				
+				hsbbool result = first < second;
+				PushBool(&vmData->dataStack.base.stackPointer, result);
+				
+				break;
+			}
+			case INS_CMP_F_LESS_EQ:
+			{
+				hsbfloat second = PopFloat(&vmData->dataStack.base.stackPointer);
+				hsbfloat first = PopFloat(&vmData->dataStack.base.stackPointer);
+				
+				hsbbool result = first <= second;
+				PushBool(&vmData->dataStack.base.stackPointer, result);
+				
+				break;
+			}
+
+			case INS_ALLOC_VAR_I:
+			{
+				// variables start zeroed, the store also touches a guard page (guarded_stack.h) right away
+				vmData->dataStack.reversePointer -= HS_DATA_SIZE_INT;
+				StoreVarInt(vmData->dataStack.reversePointer, 0);
+				break;
+			}
+			
+			case INS_ALLOC_VAR_F:
+			{
+				vmData->dataStack.reversePointer -= HS_DATA_SIZE_FLOAT;
+				StoreVarFloat(vmData->dataStack.reversePointer, 0.0f);
+				break;
+			}
+			
+			case INS_DEALLOC_VAR_I:
+			{
+				vmData->dataStack.reversePointer += HS_DATA_SIZE_INT;
+				break;
+			}
+			
+			case INS_DEALLOC_VAR_F:
+			{
+				vmData->dataStack.reversePointer += HS_DATA_SIZE_FLOAT;
+				break;
+			}
+
+			case INS_SAVE_VAR_I:
+			{
+				int offset = *vmData->instructionStack.stackPointer++;
+				hsbint value = PopInt(&vmData->dataStack.base.stackPointer);
+				
+				StoreVarInt(vmData->dataStack.reversePointer + offset, value);
+				break;
+			}
+			
+			case INS_SAVE_VAR_F:
+			{
+				int offset = *vmData->instructionStack.stackPointer++;
+				hsbfloat value = PopFloat(&vmData->dataStack.base.stackPointer);
+				
+				StoreVarFloat(vmData->dataStack.reversePointer + offset, value);
+				break;
+			}
+			
+			case INS_LOAD_VAR_I:
+			{
+				int offset = *vmData->instructionStack.stackPointer++;
+				
+				hsbint value = LoadVarInt(vmData->dataStack.reversePointer + offset);
+				
+				PushInt(&vmData->dataStack.base.stackPointer, value);
+				break;
+			}
+			
+			case INS_LOAD_VAR_F:
+			{
+				int offset = *vmData->instructionStack.stackPointer++;
+				
+				hsbfloat value = LoadVarFloat(vmData->dataStack.reversePointer + offset);
+				
+				PushFloat(&vmData->dataStack.base.stackPointer, value);
+				break;
+			}
+
+			case INS_JUMP:
+			{
+				hsbaddress address = LoadAddress(vmData->instructionStack.stackPointer);
+				
+#if HS_VM_COUNTED
+				// a backward jump goes to a loop header, stop there once it gets hot
+				if (address < vmData->instructionStack.stackPointer - vmData->instructionStack.begin
+					&& address < hotness->size && ++hotness->counters[address] == hotness->threshold)
+				{
+					hotness->hotAddress = address;
+					vmData->instructionStack.stackPointer = vmData->instructionStack.begin + address;
+					return HS_TRUE;
+				}
+#endif
+				// do not need to move the stack pointer, we're jumping anyway
+				// vmData->instructionStack.stackPointer += sizeof(hsbaddress);
+				vmData->instructionStack.stackPointer = vmData->instructionStack.begin + address;
+				
+				break;
+			}
+			
+			case INS_COND_JUMP_B:
+			{
+				hsbaddress address = LoadAddress(vmData->instructionStack.stackPointer);
+				vmData->instructionStack.stackPointer += sizeof(hsbaddress);
+				
+				hsbbool value = PopBool(&vmData->dataStack.base.stackPointer);
+				
+				if (value != 0)
+				{
+#if HS_VM_COUNTED
+					Bool8 isHot = address < vmData->instructionStack.stackPointer - vmData->instructionStack.begin
+						&& address < hotness->size && ++hotness->counters[address] == hotness->threshold;
+#endif
+					// jump
+					vmData->instructionStack.stackPointer = vmData->instructionStack.begin + address;
+#if HS_VM_COUNTED
+					if (isHot)
+					{
+						hotness->hotAddress = address;
+						return HS_TRUE;
+					}
+#endif
+				}
+				
+				break;
+			}
+
+			case INS_CALL:
+			{
+				hsbaddress address = LoadAddress(vmData->instructionStack.stackPointer);
+				vmData->instructionStack.stackPointer += sizeof(hsbaddress);
+				
+#if HS_VM_CHECKED
+				// the only overflow check, every function fits into the reserve until it calls again
+				if (vmData->dataStack.reversePointer - vmData->dataStack.base.stackPointer < vmData->callReserve)
+				{
+					vmData->instructionStack.stackPointer -= 1 + sizeof(hsbaddress);
+					vmData->error = VM_ERROR_STACK_OVERFLOW;
+					return HS_FALSE;
+				}
+#endif
+				
+				// save current position
+				SaveInsStackPointerVar(vmData);
+				// move to the function instructions
+				vmData->instructionStack.stackPointer = vmData->instructionStack.begin + address;
+				
+#if HS_VM_COUNTED
+				// function entries count every call
+				if (address < hotness->size && ++hotness->counters[address] == hotness->threshold)
+				{
+					hotness->hotAddress = address;
+					return HS_TRUE;
+				}
+#endif
+				break;
+			}
+			
+			case INS_RETURN:
+			{
+				LoadInsStackPointerVar(vmData);
+				break;
+			}
+			
+			case INS_CALL_EXT:
+			{
+				int index = *vmData->instructionStack.stackPointer;
+				vmData->instructionStack.stackPointer += 4;
+				
+#if HS_VM_CHECKED
+				// the signature is not checked, the functions have to be the ones the code was compiled for
+				if (index >= vmData->functions.count)
+				{
+					vmData->instructionStack.stackPointer -= 5;
+					vmData->error = VM_ERROR_INVALID_INSTRUCTION;
+					return HS_FALSE;
+				}
+#endif
+				
+				// the native pops its arguments off the data stack and pushes its result
+				vmData->functions.begin[index](vmData);
+				break;
+			}
+
+			case INS_CALL_ASYNC:
+			{
+				int index = *vmData->instructionStack.stackPointer;
+				vmData->instructionStack.stackPointer += 4;
+
+#if HS_VM_CHECKED
+				if (index >= vmData->functions.count)
+				{
+					vmData->instructionStack.stackPointer -= 5;
+					vmData->error = VM_ERROR_INVALID_INSTRUCTION;
+					return HS_FALSE;
+				}
+#endif
+
+				// a native that did not finish right away left a token instead of its result, the
+				// VM stops after the instruction until CompleteAsyncCall pushes the result
+				vmData->functions.begin[index](vmData);
+				if (vmData->asyncCall != HS_NO_ASYNC_CALL)
+					return HS_TRUE;
+				break;
+			}
+			
+			case INS_END:
+			{
+				// stay on the instruction, the program is finished
+				--vmData->instructionStack.stackPointer;
+				return HS_FALSE;
+			}
+			
+			case INS_LOAD_VAR_VAR_ADD_I:
+			{
+				int firstOffset = *vmData->instructionStack.stackPointer++;
+				int secondOffset = *vmData->instructionStack.stackPointer++;
+				
+				hsbint first = LoadVarInt(vmData->dataStack.reversePointer + firstOffset);
+				hsbint second = LoadVarInt(vmData->dataStack.reversePointer + secondOffset);
+				
+				hsbint result = first + second;
+				PushInt(&vmData->dataStack.base.stackPointer, result);
+				break;
+			}
+			
+			case INS_LOAD_VAR_VAR_SUBSTRACT_I:
+			{
+				int firstOffset = *vmData->instructionStack.stackPointer++;
+				int secondOffset = *vmData->instructionStack.stackPointer++;
+				
+				hsbint first = LoadVarInt(vmData->dataStack.reversePointer + firstOffset);
+				hsbint second = LoadVarInt(vmData->dataStack.reversePointer + secondOffset);
+				
+				hsbint result = first - second;
+				PushInt(&vmData->dataStack.base.stackPointer, result);
+				break;
+			}
+			
+			case INS_LOAD_VAR_VAR_MULTIPLY_I:
+			{
+				int firstOffset = *vmData->instructionStack.stackPointer++;
+				int secondOffset = *vmData->instructionStack.stackPointer++;
+				
+				hsbint first = LoadVarInt(vmData->dataStack.reversePointer + firstOffset);
+				hsbint second = LoadVarInt(vmData->dataStack.reversePointer + secondOffset);
+				
+				hsbint result = first * second;
+				PushInt(&vmData->dataStack.base.stackPointer, result);
+				break;
+			}
+			
+			case INS_ADD_LITERAL_I:
+			{
+				hsbint second = LoadInt(vmData->instructionStack.stackPointer);
+				vmData->instructionStack.stackPointer += sizeof(hsbint);
+				hsbint first = PopInt(&vmData->dataStack.base.stackPointer);
+				
+				hsbint result = first + second;
+				PushInt(&vmData->dataStack.base.stackPointer, result);
+				break;
+			}
+			
+			case INS_SUBSTRACT_LITERAL_I:
+			{
+				hsbint second = LoadInt(vmData->instructionStack.stackPointer);
+				vmData->instructionStack.stackPointer += sizeof(hsbint);
+				hsbint first = PopInt(&vmData->dataStack.base.stackPointer);
+				
+				hsbint result = first - second;
+				PushInt(&vmData->dataStack.base.stackPointer, result);
+				break;
+			}
+			
+			case INS_MULTIPLY_LITERAL_I:
+			{
+				hsbint second = LoadInt(vmData->instructionStack.stackPointer);
+				vmData->instructionStack.stackPointer += sizeof(hsbint);
+				hsbint first = PopInt(&vmData->dataStack.base.stackPointer);
+				
+				hsbint result = first * second;
+				PushInt(&vmData->dataStack.base.stackPointer, result);
+				break;
+			}
+			
+			case INS_CMP_I_EQ_JUMP:
+			{
+				hsbaddress address = LoadAddress(vmData->instructionStack.stackPointer);
+				vmData->instructionStack.stackPointer += sizeof(hsbaddress);
+				
+				hsbint second = PopInt(&vmData->dataStack.base.stackPointer);
+				hsbint first = PopInt(&vmData->dataStack.base.stackPointer);
+				
+				if (first == second)
+				{
+					// jump
+					vmData->instructionStack.stackPointer = vmData->instructionStack.begin + address;
+				}
+				
+				break;
+			}
+			
+			case INS_CMP_I_LESS_JUMP:
+			{
+				hsbaddress address = LoadAddress(vmData->instructionStack.stackPointer);
+				vmData->instructionStack.stackPointer += sizeof(hsbaddress);
+				
+				hsbint second = PopInt(&vmData->dataStack.base.stackPointer);
+				hsbint first = PopInt(&vmData->dataStack.base.stackPointer);
+				
+				if (first < second)
+				{
+					// jump
+					vmData->instructionStack.stackPointer = vmData->instructionStack.begin + address;
+				}
+				
+				break;
+			}
+			
+			case INS_CMP_I_LESS_EQ_JUMP:
+			{
+				hsbaddress address = LoadAddress(vmData->instructionStack.stackPointer);
+				vmData->instructionStack.stackPointer += sizeof(hsbaddress);
+				
+				hsbint second = PopInt(&vmData->dataStack.base.stackPointer);
+				hsbint first = PopInt(&vmData->dataStack.base.stackPointer);
+				
+				if (first <= second)
+				{
+					// jump
+					vmData->instructionStack.stackPointer = vmData->instructionStack.begin + address;
+				}
+				
+				break;
+			}
+			
+			case INS_MOVE_VAR_I:
+			{
+				int fromOffset = *vmData->instructionStack.stackPointer++;
+				int toOffset = *vmData->instructionStack.stackPointer++;
+				
+				hsbint value = LoadVarInt(vmData->dataStack.reversePointer + fromOffset);
+				StoreVarInt(vmData->dataStack.reversePointer + toOffset, value);
+				break;
+			}
+			
+			case INS_MOVE_VAR_F:
+			{
+				int fromOffset = *vmData->instructionStack.stackPointer++;
+				int toOffset = *vmData->instructionStack.stackPointer++;
+				
+				hsbfloat value = LoadVarFloat(vmData->dataStack.reversePointer + fromOffset);
+				StoreVarFloat(vmData->dataStack.reversePointer + toOffset, value);
+				break;
+			}
+
+			case INS_ENTER:
+			{
+				int argumentSize = *vmData->instructionStack.stackPointer++;
+				int intCount = *vmData->instructionStack.stackPointer++;
+				int floatCount = *vmData->instructionStack.stackPointer++;
+
+				// the caller's frame pointer goes above the return address, as an offset like the return address
+				StoreAddressVar(&vmData->dataStack.reversePointer, vmData->framePointer - vmData->dataStack.base.begin);
+				vmData->framePointer = vmData->dataStack.base.stackPointer - argumentSize;
+
+				// locals start zeroed like variables
+				for (int local = 0; local < intCount; ++local)
+				{
+					PushInt(&vmData->dataStack.base.stackPointer, 0);
+				}
+				for (int local = 0; local < floatCount; ++local)
+				{
+					PushFloat(&vmData->dataStack.base.stackPointer, 0.0f);
+				}
+				break;
+			}
+
+			case INS_LOAD_FRAME_I:
+			{
+				int offset = *vmData->instructionStack.stackPointer++;
+
+				hsbint value = LoadVarInt(vmData->framePointer + offset);
+
+				PushInt(&vmData->dataStack.base.stackPointer, value);
+				break;
+			}
+
+			case INS_LOAD_FRAME_F:
+			{
+				int offset = *vmData->instructionStack.stackPointer++;
+
+				hsbfloat value = LoadVarFloat(vmData->framePointer + offset);
+
+				PushFloat(&vmData->dataStack.base.stackPointer, value);
+				break;
+			}
+
+			case INS_SAVE_FRAME_I:
+			{
+				int offset = *vmData->instructionStack.stackPointer++;
+				hsbint value = PopInt(&vmData->dataStack.base.stackPointer);
+
+				StoreVarInt(vmData->framePointer + offset, value);
+				break;
+			}
+
+			case INS_SAVE_FRAME_F:
+			{
+				int offset = *vmData->instructionStack.stackPointer++;
+				hsbfloat value = PopFloat(&vmData->dataStack.base.stackPointer);
+
+				StoreVarFloat(vmData->framePointer + offset, value);
+				break;
+			}
+
+			case INS_LEAVE:
+			{
+				vmData->dataStack.base.stackPointer = vmData->framePointer;
+				vmData->framePointer = vmData->dataStack.base.begin + LoadAddressVar(&vmData->dataStack.reversePointer);
+				LoadInsStackPointerVar(vmData);
+				break;
+			}
+
+			case INS_LEAVE_I:
+			{
+				hsbint value = PopInt(&vmData->dataStack.base.stackPointer);
+
+				// the result takes the place of the arguments
+				vmData->dataStack.base.stackPointer = vmData->framePointer;
+				PushInt(&vmData->dataStack.base.stackPointer, value);
+
+				vmData->framePointer = vmData->dataStack.base.begin + LoadAddressVar(&vmData->dataStack.reversePointer);
+				LoadInsStackPointerVar(vmData);
+				break;
+			}
+
+			case INS_LEAVE_F:
+			{
+				hsbfloat value = PopFloat(&vmData->dataStack.base.stackPointer);
+
+				vmData->dataStack.base.stackPointer = vmData->framePointer;
+				PushFloat(&vmData->dataStack.base.stackPointer, value);
+
+				vmData->framePointer = vmData->dataStack.base.begin + LoadAddressVar(&vmData->dataStack.reversePointer);
+				LoadInsStackPointerVar(vmData);
+				break;
+			}
+
+			case INS_TAIL_CALL:
+			{
+				hsbaddress address = LoadAddress(vmData->instructionStack.stackPointer);
+				int argumentSize = vmData->instructionStack.stackPointer[sizeof(hsbaddress)];
+				vmData->instructionStack.stackPointer += sizeof(hsbaddress) + 1;
+
+#if HS_VM_CHECKED
+				// the same check as INS_CALL, the callee could need more than the frame it replaces
+				if (vmData->dataStack.reversePointer - vmData->dataStack.base.stackPointer < vmData->callReserve)
+				{
+					vmData->instructionStack.stackPointer -= 2 + sizeof(hsbaddress);
+					vmData->error = VM_ERROR_STACK_OVERFLOW;
+					return HS_FALSE;
+				}
+#endif
+
+				// the arguments replace the frame, the return address stays for the callee
+				memmove(vmData->framePointer, vmData->dataStack.base.stackPointer - argumentSize, argumentSize);
+				vmData->dataStack.base.stackPointer = vmData->framePointer + argumentSize;
+				vmData->framePointer = vmData->dataStack.base.begin + LoadAddressVar(&vmData->dataStack.reversePointer);
+				vmData->instructionStack.stackPointer = vmData->instructionStack.begin + address;
+
+#if HS_VM_COUNTED
+				if (address < hotness->size && ++hotness->counters[address] == hotness->threshold)
+				{
+					hotness->hotAddress = address;
+					return HS_TRUE;
+				}
+#endif
+				break;
+			}
+
+			case INS_SWITCH:
+			{
+				hsbint low = LoadInt(vmData->instructionStack.stackPointer);
+				int count = vmData->instructionStack.stackPointer[sizeof(hsbint)];
+				hsbint value = PopInt(&vmData->dataStack.base.stackPointer);
+				
+				// the jump for the value is taken right away, the first one is the default
+				byte* entry = vmData->instructionStack.stackPointer + sizeof(hsbint) + 1;
+				int index = value - low;
+				if (index >= 0 && index < count)
+					entry += (index + 1) * (1 + sizeof(hsbaddress));
+				
+#if HS_VM_CHECKED
+				if (entry + 1 + sizeof(hsbaddress) > vmData->instructionStack.end || *entry != INS_JUMP)
+				{
+					vmData->instructionStack.stackPointer -= 1;
+					vmData->error = VM_ERROR_INVALID_INSTRUCTION;
+					return HS_FALSE;
+				}
+#endif
+				vmData->instructionStack.stackPointer = vmData->instructionStack.begin + LoadAddress(entry + 1);
+				break;
+			}
+
+			case INS_YIELD:
+			{
+				// the VM stays as it is, the next call continues after the instruction
+				return HS_TRUE;
+			}
+
+			default:
+				// error, unrecognized instruction, exit immediately 
+				vmData->error = VM_ERROR_INVALID_INSTRUCTION;
+				return HS_FALSE;
+		}
+		
+#if HS_VM_CHECKED
+		// no instructions left, reached end of the program
+		if (vmData->instructionStack.stackPointer >= vmData->instructionStack.end)
+		{
+			return HS_FALSE;
+		}
+#endif
+	}
+	
+	return HS_TRUE;
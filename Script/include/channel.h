@@ -0,0 +1,60 @@
+#pragma once
+
+#include "async.h"
+
+// Channels between script instances, also on different threads, without locks and without the
+// host in between. A channel is a bounded ring of values with any number of senders, or a
+// single one, and one receiver. The host creates it for the scheduler of the receiver and the
+// scripts use it by its handle through natives (RegisterChannelNatives):
+//
+//     int jobs = CreateChannel(1024, HS_FALSE, &consumers.completions, 100);
+//
+//     // on the threads of the producers
+//     while (send(jobs, job) == 0) yield;
+//     // on the thread of the consumers
+//     var job: int = receive(jobs);
+//
+// send and sendFloat return 1, or 0 when the channel is full. receive and receiveFloat are
+// async natives (async.h): on an empty channel the instance waits with the token of the channel,
+// the send that finds it waiting wakes it through the completions of its scheduler. The
+// receiver takes the value itself when its scheduler takes the completion, so the values come
+// out in the order they were sent, and in the order of each sender when there are several.
+//
+// Each cell of the ring has a sequence number, which tells senders and the receiver whether it
+// is free or holds a value of the current round (Vyukov's bounded queue). Senders take a position
+// with a compare and swap, a single sender with a plain store. Only one instance may receive
+// from a channel, with a token that no other instance of its scheduler waits for. Freeing it
+// while it waits drops the value that wakes it. Channels are created and deleted while no
+// script runs.
+
+#define HS_MAX_CHANNELS 256
+
+//------------------------------------------------------------------------------
+// The ring and the positions, the type is in channel.c
+typedef struct SChannel SChannel;
+
+//------------------------------------------------------------------------------
+// A channel of capacity values, rounded up to a power of two. The receiver waits with token,
+// its scheduler takes the completions of receiver. Returns the handle of the channel for the
+// scripts, -1 when there are HS_MAX_CHANNELS already.
+int CreateChannel(int capacity, Bool8 isSingleSender, SCompletionQueue* receiver, int token);
+
+//------------------------------------------------------------------------------
+void DeleteChannel(int channel);
+
+//------------------------------------------------------------------------------
+// The channel of the handle, NULL for an invalid one
+SChannel* GetChannel(int channel);
+
+//------------------------------------------------------------------------------
+// Adds the value, wakes the receiver if it waits. Fails when the channel is full.
+Bool8 SendValue(SChannel* channel, SScriptValue value);
+
+//------------------------------------------------------------------------------
+// Takes the oldest value, fails when there is none. Only on the thread of the receiver.
+Bool8 ReceiveValue(SChannel* channel, SScriptValue* outValue);
+
+//------------------------------------------------------------------------------
+// send(int, int): int, sendFloat(int, float): int, receive(int): int and
+// receiveFloat(int): float
+EResult RegisterChannelNatives(SNativeTable* table);
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "bytecode_d.h"
+#include "line_table.h"
+#include "natives.h"
+#include "parser.h"
+
+//------------------------------------------------------------------------------
+// A function of the program. It runs in an INS_ENTER frame with the arguments in it and returns
+// with INS_LEAVE, INS_LEAVE_I or INS_LEAVE_F. The signature has the encoding of the natives.
+typedef struct
+{
+    char* name;
+    int entry;
+    SNativeSignature signature;
+} SScriptFunction;
+
+//------------------------------------------------------------------------------
+typedef struct
+{
+    SScriptFunction* functions; // In the order declared
+    int count;
+    int mainEnd; // Address of the INS_END of the main program, the functions follow it
+} SFunctionTable;
+
+//------------------------------------------------------------------------------
+// Input = AST
+// Output = Bytecode, the caller owns outInstructions (DeleteStack). Calls of script functions in
+// tail position are INS_TAIL_CALL (EliminateTailCalls).
+EResult Compile(SASTNode* root, SStackData* outInstructions);
+
+//------------------------------------------------------------------------------
+// Compile with the source position of every instruction, the caller owns outLines as well
+// (DeleteLineTable). Passes which move instructions afterwards (optimizer.h) leave the table
+// behind, it describes the bytecode as compiled.
+EResult CompileWithLines(SASTNode* root, SStackData* outInstructions, SLineTable* outLines);
+
+//------------------------------------------------------------------------------
+// Compile with calls of the natives, resolved to their indices in the table. The code runs on a
+// VM with the functions of the same table (CreateNativeFunctions). outLines can be NULL.
+EResult CompileWithNatives(SASTNode* root, const SNativeTable* natives, SStackData* outInstructions, SLineTable* outLines);
+
+//------------------------------------------------------------------------------
+// CompileWithNatives that also returns the functions of the program, the caller owns them
+// (DeleteFunctionTable). natives can be NULL.
+EResult CompileWithFunctions(SASTNode* root, const SNativeTable* natives, SStackData* outInstructions, SFunctionTable* outFunctions);
+
+//------------------------------------------------------------------------------
+void DeleteFunctionTable(SFunctionTable* functions);
+
+//------------------------------------------------------------------------------
+// Index of the function with the name, -1 when there is none
+int FindScriptFunction(const SFunctionTable* functions, const char* name);
+
+//------------------------------------------------------------------------------
+// Tokenizes, parses and compiles the code
+EResult CompileSource(char* code, int size, SStackData* outInstructions);
+
+//------------------------------------------------------------------------------
+EResult CompileSourceWithLines(char* code, int size, SStackData* outInstructions, SLineTable* outLines);
+
+//------------------------------------------------------------------------------
+EResult CompileSourceWithNatives(char* code, int size, const SNativeTable* natives, SStackData* outInstructions);
+
+//------------------------------------------------------------------------------
+EResult CompileSourceWithFunctions(char* code, int size, const SNativeTable* natives, SStackData* outInstructions, SFunctionTable* outFunctions);
+
+//------------------------------------------------------------------------------
+// Level 0 is Compile, level 1 and above go through the SSA IR and its passes (see ir.h).
+// The program ends with the same variable area either way.
+EResult CompileOptimized(SASTNode* root, int level, SStackData* outInstructions);
+
+//------------------------------------------------------------------------------
+EResult CompileSourceOptimized(char* code, int size, int level, SStackData* outInstructions);
@@ -0,0 +1,130 @@
+#pragma once
+
+#include "compiler.h"
+
+// Calling the functions of a script from the host. A program is compiled once and does not
+// change after, a context is a VM prepared to run its functions, so a call only pushes the
+// arguments, runs and pops the result without allocating:
+//
+//     SProgram program;
+//     CreateProgram(code, size, &natives, &program);
+//     int update = FindFunction(&program, "update");
+//
+//     SScriptContext context;
+//     InitScriptContext(&context, &program);
+//     SScriptValue arguments[] = { { .i = entity }, { .f = deltaTime } };
+//     SScriptValue result;
+//     CallFunction(&context, update, arguments, 2, &result);
+//
+// Every call starts from an empty data stack, the functions see their arguments and locals
+// only. The statements outside of functions are not run. A context runs one call at a time,
+// several contexts can share a program, also on different threads: a program does not change
+// after CreateProgram and a context holds the stacks and the instruction pointer of its VM only.
+// Natives called from several threads have to be thread safe themselves.
+//
+// A program shared by owners with different lifetimes, e.g. a script runner (runner.h) and the
+// code that created it, is created by CreateSharedProgram and deleted with its last reference.
+//
+// CallFunctionBatch calls a function once per row of its argument columns, it checks the call
+// and sets up the VM once, each row only resets the stacks and fills the frame straight from the
+// columns. The instructions of the function are still dispatched per row, CallFunctionWide
+// (wide_vm.h) dispatches them once for 8 rows.
+//
+// CallFunction runs through the yield statements of a function. StartFunction and
+// ResumeFunction run it as a coroutine instead, each resume up to the next yield or a number of
+// instructions. The state of a suspended call is the VM of the context, nothing is copied to
+// suspend or resume it. A scheduler of many such calls is in scheduler.h. Only coroutines can
+// call async natives (async.h), the others fail when a native waits.
+
+#define HS_RECURSIVE_DATA_SIZE (1 << 14)
+
+//------------------------------------------------------------------------------
+typedef union
+{
+    hsbint i;
+    hsbfloat f;
+} SScriptValue;
+
+//------------------------------------------------------------------------------
+typedef struct
+{
+    SStackData instructions;
+    SFunctionTable functions;
+    FuncArray natives;  // Of the table the program was compiled with, shared by the contexts
+    int dataSize;       // Data stack bytes of the deepest call, HS_RECURSIVE_DATA_SIZE when recursive
+    int callReserve;    // For INS_CALL of a recursive program (see stack_usage.h), 0 otherwise
+    int references;     // Of a program from CreateSharedProgram, 0 for the others
+} SProgram;
+
+//------------------------------------------------------------------------------
+typedef struct
+{
+    const SProgram* program;
+    SVMData vmData;
+    int function;       // Started by StartFunction and not finished yet, -1 for none
+} SScriptContext;
+
+//------------------------------------------------------------------------------
+typedef enum
+{
+    SCRIPT_RUNNING,     // Suspended at a yield or after its instructions, resumed by ResumeFunction
+    SCRIPT_WAITING,     // Suspended at a call of an async native until CompleteAsyncCall (async.h)
+    SCRIPT_FINISHED,
+    SCRIPT_FAILED,
+} EScriptState;
+
+//------------------------------------------------------------------------------
+// Compiles the code with calls of the natives, which can be NULL. The program keeps the
+// functions of the table, the table itself does not have to outlive it.
+EResult CreateProgram(char* code, int size, const SNativeTable* natives, SProgram* outProgram);
+
+//------------------------------------------------------------------------------
+void DeleteProgram(SProgram* program);
+
+//------------------------------------------------------------------------------
+// CreateProgram on the heap with one reference, NULL when the code does not compile
+SProgram* CreateSharedProgram(char* code, int size, const SNativeTable* natives);
+
+//------------------------------------------------------------------------------
+// Another reference to a program from CreateSharedProgram, from any thread. Returns the program.
+SProgram* RetainProgram(SProgram* program);
+
+//------------------------------------------------------------------------------
+// Drops a reference, the last one deletes and frees the program
+void ReleaseProgram(SProgram* program);
+
+//------------------------------------------------------------------------------
+// The handle of the function with the name for CallFunction, -1 when there is none
+int FindFunction(const SProgram* program, const char* name);
+
+//------------------------------------------------------------------------------
+// The program has to outlive the context
+void InitScriptContext(SScriptContext* context, const SProgram* program);
+
+//------------------------------------------------------------------------------
+void DeleteScriptContext(SScriptContext* context);
+
+//------------------------------------------------------------------------------
+// Runs the function with the arguments in the order declared, each in the member of its type
+// in the signature (i for int, f for float). outResult gets the result and can be NULL.
+// Fails for a wrong number of arguments and when the VM stops with an error.
+EResult CallFunction(SScriptContext* context, int function, const SScriptValue* arguments, int argumentCount,
+    SScriptValue* outResult);
+
+//------------------------------------------------------------------------------
+// Runs the function for rowCount rows. inputs has a column per argument, an array of hsbint or
+// hsbfloat by the type of the argument, outputs is the same for the result and can be NULL.
+// Fails at the first row that stops the VM with an error, the rows before it have their results.
+EResult CallFunctionBatch(SScriptContext* context, int function, const void* const* inputs, int argumentCount,
+    void* outputs, int rowCount);
+
+//------------------------------------------------------------------------------
+// Pushes the arguments like CallFunction without running anything of the function. A call of
+// CallFunction or CallFunctionBatch on the context in between drops the started function.
+EResult StartFunction(SScriptContext* context, int function, const SScriptValue* arguments, int argumentCount);
+
+//------------------------------------------------------------------------------
+// Runs the started function until it yields, waits for an async native, finishes or ran count
+// instructions. outResult gets the result once it finished and can be NULL. A waiting function
+// does not run until its call is completed.
+EScriptState ResumeFunction(SScriptContext* context, int count, SScriptValue* outResult);
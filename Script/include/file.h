@@ -0,0 +1,7 @@
+#pragma once
+
+#include "inc.h"
+
+//------------------------------------------------------------------------------
+// Reads the whole file into a zero terminated buffer, the caller frees fileBuff
+Bool8 ReadFile(const char* fileName, char** fileBuff, int* size);
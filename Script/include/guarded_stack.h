@@ -0,0 +1,34 @@
+#pragma once
+
+#include "bytecode_d.h"
+
+// Data stacks that trap on overflow instead of checking every push. The operand stack and
+// the variable area (growing down from the end) get their own regions of at least dataSize
+// bytes with PROT_NONE guard pages before, between and after them. The regions are only
+// reserved, the system commits a page on its first touch.
+// A fault in a guard page while VMProcessInstructionsGuarded runs stops the VM with
+// VM_ERROR_STACK_OVERFLOW, other faults go to the handler installed before the first
+// InitGuardedVM. Only available with mmap and sigaction, elsewhere
+// (HS_GUARDED_STACK_SUPPORTED is 0) the functions fall back to InitVM and VMProcessInstructions.
+
+#if defined(__unix__) || defined(__APPLE__)
+	#define HS_GUARDED_STACK_SUPPORTED 1
+#else
+	#define HS_GUARDED_STACK_SUPPORTED 0
+#endif
+
+//------------------------------------------------------------------------------
+void InitGuardedVM(SVMData* vmData, SStackData instructionStack, int dataSize, FuncArray functions);
+
+//------------------------------------------------------------------------------
+// Counterpart of DeleteVM for VMs created by InitGuardedVM
+void DeleteGuardedVM(SVMData* vmData, Bool8 keepInstructions, Bool8 keepFunctions);
+
+//------------------------------------------------------------------------------
+// VMProcessInstructions that turns a fault in the guard pages of the VM into
+// VM_ERROR_STACK_OVERFLOW. The VM cannot continue after that.
+Bool8 VMProcessInstructionsGuarded(SVMData* vmData, int count);
+
+//------------------------------------------------------------------------------
+// Bytes of the data stack backed by memory, for comparing with the reserved size
+int GetGuardedStackResidentSize(const SVMData* vmData);
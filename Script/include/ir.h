@@ -0,0 +1,156 @@
+#pragma once
+
+#include "bytecode_d.h"
+#include "parser.h"
+
+#include <stdio.h>
+
+// Mid-level IR in SSA form between the AST and the bytecode. Every value is defined once,
+// variables become the values assigned to them and phi nodes merge them where control flow
+// joins. The program ends with the values of its globals, everything else is free to change.
+
+//------------------------------------------------------------------------------
+typedef enum
+{
+    IRT_INT,
+    IRT_FLOAT,
+    IRT_BOOL,
+} EIRType;
+
+//------------------------------------------------------------------------------
+typedef enum
+{
+    IR_CONST,
+    IR_ADD,
+    IR_SUBSTRACT,
+    IR_MULTIPLY,
+    IR_DIVIDE,
+    IR_CMP_EQ,
+    IR_CMP_LESS,
+    IR_CMP_LESS_EQ,
+    IR_NOT,
+    IR_COPY,
+    IR_PHI,
+    IR_REMOVED, // Left behind by the passes, not part of any block
+} EIROp;
+
+//------------------------------------------------------------------------------
+typedef struct
+{
+    EIROp op;
+    EIRType type;
+    int block;        // Index of the block the value is defined in
+    int operands[2];  // Values, IR_NOT and IR_COPY use the first only
+    int* phiOperands; // IR_PHI: one value per predecessor of the block, in the same order
+    union
+    {
+        hsbint intValue;     // IR_CONST of IRT_INT, and of IRT_BOOL with 0 or 1
+        hsbfloat floatValue; // IR_CONST of IRT_FLOAT
+    };
+} SIRValue;
+
+//------------------------------------------------------------------------------
+typedef enum
+{
+    IR_JUMP,   // To successors[0]
+    IR_BRANCH, // To successors[0] when the condition is true, successors[1] otherwise
+    IR_SWITCH, // To successors[cases[condition - caseLow]] for the caseCount ints from caseLow,
+               // successors[0] for the others. Every target is among the successors once.
+    IR_END,    // The program ends with the globals
+} EIRTerminator;
+
+//------------------------------------------------------------------------------
+typedef struct
+{
+    int* values; // Defined in order, phis first
+    int valueCount;
+    int valueCapacity;
+
+    int* preds;
+    int predCount;
+    int predCapacity;
+
+    EIRTerminator terminator;
+    int condition;
+    int* successors;
+    int successorCount;
+    int* cases; // IR_SWITCH: indices into the successors
+    int caseCount;
+    hsbint caseLow;
+    Bool8 isRemoved; // Unreachable, dropped by RemoveUnreachableBlocks
+} SIRBlock;
+
+//------------------------------------------------------------------------------
+typedef struct
+{
+    SIRValue* values;
+    int valueCount;
+    int valueCapacity;
+
+    SIRBlock* blocks; // The entry first
+    int blockCount;
+    int blockCapacity;
+
+    // The values of the globals at IR_END, first declared first
+    int* globals;
+    EIRType* globalTypes;
+    int globalCount;
+} SIRProgram;
+
+//------------------------------------------------------------------------------
+// Builds the IR of the program, reports the same errors as Compile
+EResult BuildIR(SASTNode* root, SIRProgram* outProgram);
+
+//------------------------------------------------------------------------------
+void FreeIR(SIRProgram* program);
+
+//------------------------------------------------------------------------------
+// Writes the blocks and their values in a readable form, for debugging and golden tests
+void DumpIR(const SIRProgram* program, FILE* out);
+
+//------------------------------------------------------------------------------
+// The passes, each returns whether it changed the program
+// - FoldConstants evaluates operations on constants the way the VM would and turns branches
+//   and switches on constants into jumps
+// - RemoveUnreachableBlocks drops the blocks the entry cannot reach and their phi operands
+// - PropagateCopies makes the users of IR_COPY and of phis merging a single value use the source
+// - EliminateCommonSubexpressions reuses an equal value computed in a dominating block
+// - HoistLoopInvariants moves values which only depend on values from outside of a loop to
+//   its preheader, except int divisions which could trap where the loop would not run
+// - EliminateDeadCode removes values the globals and branches do not depend on, assignments
+//   to variables which are never read again included
+Bool8 FoldConstants(SIRProgram* program);
+Bool8 RemoveUnreachableBlocks(SIRProgram* program);
+Bool8 PropagateCopies(SIRProgram* program);
+Bool8 EliminateCommonSubexpressions(SIRProgram* program);
+Bool8 HoistLoopInvariants(SIRProgram* program);
+Bool8 EliminateDeadCode(SIRProgram* program);
+
+//------------------------------------------------------------------------------
+// Runs all passes until none of them changes the program any more
+void OptimizeIR(SIRProgram* program);
+
+//------------------------------------------------------------------------------
+// Helpers of the lowerings
+// - GetIRPredIndex finds the index among the predecessors of the target of the given edge
+//   between the blocks, the second one for a branch with both successors the same
+// - GetIREdge is that edge for the successor at the index
+// - GetIRLayout orders the reachable blocks in reverse postorder with the false successors
+//   visited first, so the true successor of a branch usually follows it and loop bodies come
+//   before their exits, and returns their count
+// - AssignIRVariables gives the values marked in hasVariable a variable, the others are
+//   computed from their operands where they are used. A phi shares its variable with the
+//   operands it is never live at the same time with, with isReused so do all such values.
+//   The globals' values get the variables 0 to globalCount - 1 where possible. Returns the
+//   number of variables, outVariables gets the one of each value or -1.
+int GetIRPredIndex(const SIRProgram* program, int from, int to, int edge);
+int GetIREdge(const SIRBlock* block, int successorIndex);
+int GetIRLayout(const SIRProgram* program, int* outOrder);
+int AssignIRVariables(const SIRProgram* program, const Bool8* hasVariable, Bool8 isReused, int* outVariables);
+
+//------------------------------------------------------------------------------
+// Emits bytecode ending with the globals in the variable area like Compile does. Values used
+// once in their own block are computed where they are used, constants and bools wherever
+// they are needed, the others live in variables allocated after the globals. Phi nodes are
+// resolved by parallel copies through the operand stack at the end of their predecessors.
+EResult LowerIR(const SIRProgram* program, SStackData* outInstructions);
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "bytecode_d.h"
+
+// Baseline JIT for x86-64 (System V ABI, Linux). Every instruction is translated by copying
+// its machine code template and patching in the operands: literals, variable offsets, jump
+// targets and return addresses. The code keeps the data stack layout of the interpreter,
+// so a VM can be inspected the same way after running either of them.
+
+#if defined(__x86_64__) && defined(__linux__)
+	#define HS_JIT_SUPPORTED 1
+#else
+	#define HS_JIT_SUPPORTED 0
+#endif
+
+//------------------------------------------------------------------------------
+typedef struct
+{
+    byte* code;     // Executable, not writable
+    int codeSize;   // Size of the mapping
+    void** entries; // Native address of every instruction, indexed by its address
+} SJitCode;
+
+//------------------------------------------------------------------------------
+// Verifies the instructions for a VM with dataSize bytes of data stack (see VerifyInstructions)
+// and translates them. Fails for invalid code and when the JIT is not supported.
+EResult JitCompile(SStackData instructions, int dataSize, SJitCode* outCode);
+
+//------------------------------------------------------------------------------
+void FreeJitCode(SJitCode* code);
+
+//------------------------------------------------------------------------------
+// Counterpart of VMRunVerified, runs the translated instructions from the current instruction
+// of the VM until INS_END. Returns HS_FALSE as the program ended.
+Bool8 VMRunJit(SVMData* vmData, const SJitCode* code);
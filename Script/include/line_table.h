@@ -0,0 +1,51 @@
+#pragma once
+
+#include "bytecode_d.h"
+#include "tokenizer.h"
+
+// Maps instruction offsets to the source position they were compiled from (CompileWithLines
+// in compiler.h). An entry covers the instructions from its offset up to the next entry, it
+// is only added when the position changes. Entries are delta encoded in a few bytes each:
+// the offset from the previous entry and the line from the previous one as variable length
+// integers, the line zigzag encoded as it can go back, and then the column.
+
+//------------------------------------------------------------------------------
+typedef struct
+{
+    byte* data;
+    int size;
+    int capacity;
+
+    // Last entry added, the next one is encoded relative to it
+    int lastOffset;
+    SSourcePosition lastPosition;
+    int entryCount;
+} SLineTable;
+
+//------------------------------------------------------------------------------
+// An entry decoded by ReadLineEntry
+typedef struct
+{
+    int offset; // First instruction of the entry
+    SSourcePosition position;
+    int next;   // Byte of the next entry in the data
+} SLineEntry;
+
+//------------------------------------------------------------------------------
+void InitLineTable(SLineTable* table);
+
+//------------------------------------------------------------------------------
+void DeleteLineTable(SLineTable* table);
+
+//------------------------------------------------------------------------------
+// Instructions from offset on come from position, offsets have to be added in increasing order
+void AddLineEntry(SLineTable* table, int offset, SSourcePosition position);
+
+//------------------------------------------------------------------------------
+// Decodes the entry after the one in entry, a zeroed entry reads the first one. Returns HS_FALSE
+// after the last entry.
+Bool8 ReadLineEntry(const SLineTable* table, SLineEntry* entry);
+
+//------------------------------------------------------------------------------
+// Position of the instruction at offset, HS_FALSE when no entry covers it
+Bool8 FindSourcePosition(const SLineTable* table, int offset, SSourcePosition* outPosition);
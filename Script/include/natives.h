@@ -0,0 +1,82 @@
+#pragma once
+
+#include "bytecode_d.h"
+
+// Native functions the scripts call by name. The host registers each one with its signature
+// before compiling, the compiler resolves the names to indices into the table and checks the
+// arguments (CompileWithNatives in compiler.h), so a call is an INS_CALL_EXT with the index
+// and nothing is looked up while the script runs. The VM calls the function at the index of
+// the FuncArray made from the same table. It pops the arguments off the data stack, the last
+// one first, and pushes its result, there is no copying in between:
+//
+//     static void NativeMin(SVMData* vmData)
+//     {
+//         hsbint second = PopInt(&vmData->dataStack.base.stackPointer);
+//         hsbint first = PopInt(&vmData->dataStack.base.stackPointer);
+//         PushInt(&vmData->dataStack.base.stackPointer, first < second ? first : second);
+//     }
+//
+//     RegisterNative(&natives, "min", "int(int, int)", NativeMin);
+//
+// Natives only use the data stack, the instruction pointer is not up to date while they run.
+//
+// A native registered with RegisterAsyncNative can leave its result for later, e.g. a file
+// read on another thread. It pops its arguments as usual and either pushes the result right
+// away or starts the operation, stores a token of it in vmData->asyncCall and pushes nothing.
+// The VM stops after the call and CompleteAsyncCall (async.h) pushes the result once it is
+// there. The compiler emits INS_CALL_ASYNC for these natives.
+
+#define HS_MAX_NATIVES 256
+
+//------------------------------------------------------------------------------
+typedef struct
+{
+    byte argumentCount;
+    byte floatArguments; // A bit per argument, set for a float, the first argument lowest
+    byte result;         // ENativeType
+} SNativeSignature;
+
+//------------------------------------------------------------------------------
+typedef struct
+{
+    char* name;
+    SNativeSignature signature;
+    NativeFP* function;
+    Bool8 isAsync;       // Called by INS_CALL_ASYNC, can wait for its result
+} SNative;
+
+//------------------------------------------------------------------------------
+typedef struct
+{
+    SNative* natives; // Indexed by the index INS_CALL_EXT calls them with
+    int count;
+    int capacity;
+} SNativeTable;
+
+//------------------------------------------------------------------------------
+void InitNativeTable(SNativeTable* table);
+
+//------------------------------------------------------------------------------
+void DeleteNativeTable(SNativeTable* table);
+
+//------------------------------------------------------------------------------
+// Adds the function under the name. The signature is the result type and the argument types
+// in parentheses, "float(float, int)", "int()" or "void(float)". Fails for a name that is
+// taken, an invalid signature and when the table is full.
+EResult RegisterNative(SNativeTable* table, const char* name, const char* signature, NativeFP* function);
+
+//------------------------------------------------------------------------------
+// RegisterNative for a native that can wait for its result
+EResult RegisterAsyncNative(SNativeTable* table, const char* name, const char* signature, NativeFP* function);
+
+//------------------------------------------------------------------------------
+// Index of the native with the name, -1 when there is none
+int FindNative(const SNativeTable* table, const char* name);
+
+//------------------------------------------------------------------------------
+// The functions of the table by index, for InitVM. The VM owns the array (see DeleteVM).
+FuncArray CreateNativeFunctions(const SNativeTable* table);
+
+//------------------------------------------------------------------------------
+// sqrt, sin and cos of a float, and printInt and printFloat which print a line to stdout
+EResult RegisterStandardNatives(SNativeTable* table);
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "bytecode_d.h"
+
+//------------------------------------------------------------------------------
+// Peephole pass rewriting frequent instruction sequences into superinstructions
+// (see the end of EInstruction). Sequences containing a jump target are left alone,
+// jump addresses are remapped. The instructions are rewritten in place and end moves back.
+EResult FuseSuperinstructions(SStackData* instructions);
+
+//------------------------------------------------------------------------------
+// FuseSuperinstructions that also fills outNewAddress (one entry per byte of the instructions
+// plus one for the end) with the address every instruction moved to. Positions inside a fused
+// sequence map to the superinstruction, only its first instruction is a safe place to continue.
+EResult FuseSuperinstructionsMapped(SStackData* instructions, int* outNewAddress);
+
+//------------------------------------------------------------------------------
+// Rewrites INS_CALL followed by a leave instruction into INS_TAIL_CALL, so the callee takes
+// over the frame and tail recursion runs in constant stack space. Variables deallocated between
+// the call and the leave are deallocated before the INS_TAIL_CALL instead. Only calls to functions
+// starting with INS_ENTER whose every exit is the same leave instruction are rewritten, and
+// never when the leave is a jump target. The size of the code stays the same.
+EResult EliminateTailCalls(SStackData* instructions);
+
+//------------------------------------------------------------------------------
+typedef struct
+{
+    int maxCalleeSize; // Largest function body in bytes which is inlined
+    int maxGrowth;     // Bytes the code may grow by in total
+    int maxDepth;      // Rounds of inlining, each one can inline the callers of the functions before
+} SInlineOptions;
+
+//------------------------------------------------------------------------------
+// Replaces INS_CALL of small functions by a copy of their body, saving the call and the return.
+// Only functions using the variable area are inlined (not INS_ENTER frames): their body has to
+// follow the entry without a gap, end in INS_RETURN only and call no other function. Each round
+// works bottom up, a function whose calls were all inlined can be inlined in the next one.
+// Offsets to variables of the caller lose the return address, jumps are remapped and INS_RETURN
+// jumps to the end of the copy. The original functions stay in place. The instructions have to pass VerifyInstructions and
+// get a new buffer when anything was inlined.
+EResult InlineCalls(SStackData* instructions, const SInlineOptions* options, int* outInlinedCount);
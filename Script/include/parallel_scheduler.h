@@ -0,0 +1,64 @@
+#pragma once
+
+#include "scheduler.h"
+
+// The scheduler of scheduler.h on a pool of threads, for tens of thousands of instances per
+// tick. The instances of each program run in batches of up to HS_STEAL_BATCH, which never mix
+// programs. A tick deals the batches out to a deque per thread, each thread a contiguous share
+// in program order, and runs them. A thread whose deque ran dry steals a batch from the other
+// end of another deque, so uneven instances even out without a shared queue:
+//
+//     SParallelScheduler* scheduler = CreateParallelScheduler(8);
+//     int agents = AddParallelProgram(scheduler, program, 1000);
+//     for (int i = 0; i < 20000; ++i)
+//         SpawnParallelInstance(scheduler, agents, FindFunction(program, "think"), arguments, 1);
+//
+//     while (RunParallelTick(scheduler) > 0) // once per frame
+//         ...
+//
+// RunParallelTick is the barrier at the end of a tick: it returns once every running instance
+// yielded, finished or ran its quantum, and the host sees their state. The other functions must
+// not be called during a tick. Async natives (async.h) need the scheduler of scheduler.h, an
+// instance that waits for one here stays SCRIPT_WAITING and is not resumed.
+
+#define HS_STEAL_BATCH 32
+
+//------------------------------------------------------------------------------
+// The threads, deques, programs and instances, the types are in parallel_scheduler.c
+typedef struct SParallelScheduler SParallelScheduler;
+
+//------------------------------------------------------------------------------
+// Starts threadCount - 1 threads, the caller of RunParallelTick is the last one. NULL when the
+// threads could not be started.
+SParallelScheduler* CreateParallelScheduler(int threadCount);
+
+//------------------------------------------------------------------------------
+// Stops the threads and releases the programs
+void DeleteParallelScheduler(SParallelScheduler* scheduler);
+
+//------------------------------------------------------------------------------
+// Keeps a reference to the program, which has to come from CreateSharedProgram. Its instances
+// run quantum instructions per tick. Returns the handle of the program for SpawnParallelInstance.
+int AddParallelProgram(SParallelScheduler* scheduler, SProgram* program, int quantum);
+
+//------------------------------------------------------------------------------
+// Starts the function of the program with the arguments (see CallFunction), it runs from the
+// next tick on. Returns the handle of the instance, -1 when the call is invalid.
+int SpawnParallelInstance(SParallelScheduler* scheduler, int program, int function, const SScriptValue* arguments,
+    int argumentCount);
+
+//------------------------------------------------------------------------------
+// The instance, valid until the next SpawnParallelInstance
+const SScriptInstance* GetParallelInstance(const SParallelScheduler* scheduler, int instance);
+
+//------------------------------------------------------------------------------
+// Stops the instance if it still runs, its handle is invalid after
+void FreeParallelInstance(SParallelScheduler* scheduler, int instance);
+
+//------------------------------------------------------------------------------
+// Resumes every running instance once on the threads, returns the number still running
+int RunParallelTick(SParallelScheduler* scheduler);
+
+//------------------------------------------------------------------------------
+// Batches of the last tick that ran on another thread than the one they were dealt to
+int GetStolenBatchCount(const SParallelScheduler* scheduler);
@@ -1,22 +1,33 @@
 #pragma once
 
 #include "inc.h"
+#include "tokenizer.h"
 
 //------------------------------------------------------------------------------
 typedef enum
 {
     ANT_PROGRAM,
     ANT_DECL_VAR,
+    ANT_DECL_FUNC,
     ANT_DECL_STMT,
+    ANT_PARAMETER,
 
     ANT_ASSIGN,
 
     ANT_EXPR_STMT,
     ANT_BLOCK,
+    ANT_IF,
+    ANT_WHILE,
+    ANT_SWITCH,
+    ANT_CASE,
+    ANT_RETURN,
+    ANT_YIELD,
 
     ANT_LITERAL,
     ANT_UNARY_OP,
     ANT_BINARY_OP,
+    ANT_CALL,
+    ANT_ARGUMENT,
 } EASTNodeType;
 
 //------------------------------------------------------------------------------
@@ -24,8 +35,30 @@ typedef struct Statement
 {
     union
     {
-        struct ASTNode* block;  // Block statement
-        struct ASTNode* expr;   // Expression statement
+        struct ASTNode* block;  // Block statement, first declaration of the block
+        struct ASTNode* expr;   // Expression statement, value of a return statement (possibly NULL)
+
+        // If statement
+        struct
+        {
+            struct ASTNode* cond;
+            struct ASTNode* then;
+            struct ASTNode* otherwise; // Possibly NULL
+        } ifStmt;
+
+        // While statement
+        struct
+        {
+            struct ASTNode* cond;
+            struct ASTNode* body;
+        } whileStmt;
+
+        // Switch statement
+        struct
+        {
+            struct ASTNode* value;
+            struct ASTNode* cases; // First case, in the order written
+        } switchStmt;
     };
 } SStatement;
 
@@ -33,6 +66,7 @@ typedef struct Statement
 typedef struct ASTNode
 {
     EASTNodeType type;
+    SSourcePosition position; // Of the first token, the operator of unary and binary operators
     union
     {
         struct ASTNode* programChild;
@@ -44,6 +78,7 @@ typedef struct ASTNode
             union
             {
                 struct ASTNode* declVar;
+                struct ASTNode* declFunc;
                 struct ASTNode* stmt;
             };
         } decl;
@@ -56,8 +91,34 @@ typedef struct ASTNode
             struct ASTNode* initExpr; // Possibly NULL
         } declVar;
 
+        // Function declaration, only at the top level of the program
+        struct
+        {
+            struct Token* name;
+            struct ASTNode* parameters; // First parameter, NULL without parameters
+            struct Token* resultType;   // NULL without a result
+            struct ASTNode* body;       // Block
+        } declFunc;
+
+        struct
+        {
+            struct Token* type;
+            struct Token* name;
+            struct ASTNode* next; // Also a parameter
+        } parameter;
+
         struct Statement stmt;
 
+        // Case of a switch statement, its body runs when the value matches and then the
+        // statement ends. A case without a body shares the one of the next case.
+        struct
+        {
+            int value;
+            Bool8 isDefault;
+            struct ASTNode* body; // Block, NULL when empty
+            struct ASTNode* next;
+        } switchCase;
+
         struct Assign
         {
             struct Token* var;
@@ -82,6 +143,19 @@ typedef struct ASTNode
         {
             struct Token* token;
         } literal;
+
+        // Call of a function of the program or a native function (natives.h)
+        struct
+        {
+            struct Token* name;
+            struct ASTNode* arguments; // First argument, NULL without arguments
+        } call;
+
+        struct
+        {
+            struct ASTNode* value;
+            struct ASTNode* next; // Also an argument
+        } argument;
     };
 } SASTNode;
 
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "bytecode_d.h"
+
+#include <stdio.h>
+
+// Instruction profiler. ProfiledProcessInstructions is VMProcessInstructions with counters:
+// how often every opcode ran, the clock ticks spent in it and how often the instruction at
+// every offset ran. The ticks of an instruction are read when the next one starts, so they
+// include the dispatch and the reading of the clock itself, which InitProfile measures so the
+// report can leave it out. The profiled interpreter is a separate copy of the loop
+// (HS_VM_PROFILED in bytecode_interpreter.inl), the others do not change. Ticks are the time
+// stamp counter on x86 and nanoseconds elsewhere.
+
+//------------------------------------------------------------------------------
+typedef struct
+{
+    SStackData instructions; // The profiled program, which has to outlive the profile
+    uint64_t counts[INS_COUNT];
+    uint64_t ticks[INS_COUNT];
+    uint64_t* hits;          // Indexed by offset of the instruction
+    uint64_t clockTicks;     // Of one reading of the clock, part of the ticks of every instruction
+
+    // The running instruction, its ticks are added once the next one starts
+    int lastInstruction;     // INS_COUNT when none is running
+    uint64_t lastTicks;
+} SProfile;
+
+//------------------------------------------------------------------------------
+void InitProfile(SProfile* profile, SStackData instructions);
+
+//------------------------------------------------------------------------------
+void DeleteProfile(SProfile* profile);
+
+//------------------------------------------------------------------------------
+// Counterpart of VMProcessInstructions, the VM has to run the profiled instructions
+Bool8 ProfiledProcessInstructions(SVMData* vmData, int count, SProfile* profile);
+
+//------------------------------------------------------------------------------
+// Sum of the counts of all opcodes
+uint64_t GetProfiledInstructionCount(const SProfile* profile);
+
+//------------------------------------------------------------------------------
+// Opcodes which ran, the most ticks first, and the maxOffsets offsets hit most often. The
+// ticks per instruction are without clockTicks.
+void PrintProfile(const SProfile* profile, int maxOffsets, FILE* out);
+
+//------------------------------------------------------------------------------
+// The same as comma separated values with a header line, one line per opcode which ran
+// ("opcode,<opcode>,<name>,<count>,<ticks>") and per offset which was hit
+// ("offset,<offset>,<name>,<hits>,")
+void WriteProfileCsv(const SProfile* profile, FILE* out);
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "bytecode_d.h"
+#include "ir.h"
+
+// Register based bytecode next to the stack VM. Instructions name their operands and result as
+// registers, e.g. RINS_ADD_I r0 r1 r2 computes r0 = r1 + r2, so no instruction only moves a
+// value to or from an operand stack. Scripts have no calls, the registers are the one frame of
+// the program: its globals first, the values computed by the program and the constants after
+// them. Compares branch directly, there are no bool registers.
+
+#define HS_REGISTER_COUNT 256
+
+//------------------------------------------------------------------------------
+typedef enum
+{
+    RINS_NOOP,
+
+    RINS_LOAD_I,              // r, int literal
+    RINS_LOAD_F,              // r, float literal
+    RINS_MOVE,                // r, a
+
+    RINS_ADD_I,               // r, a, b
+    RINS_ADD_F,
+    RINS_SUBSTRACT_I,
+    RINS_SUBSTRACT_F,
+    RINS_MULTIPLY_I,
+    RINS_MULTIPLY_F,
+    RINS_DIVIDE_I,
+    RINS_DIVIDE_F,
+
+    RINS_JUMP,                // address
+
+    RINS_JUMP_I_EQ,           // a, b, address: jumps when a == b
+    RINS_JUMP_I_NOT_EQ,
+    RINS_JUMP_I_LESS,
+    RINS_JUMP_I_LESS_EQ,
+    RINS_JUMP_F_EQ,
+    RINS_JUMP_F_NOT_EQ,
+    RINS_JUMP_F_LESS,
+    RINS_JUMP_F_LESS_EQ,
+    RINS_JUMP_F_NOT_LESS,     // Also when either is NaN
+    RINS_JUMP_F_NOT_LESS_EQ,
+
+    RINS_SWITCH,              // a, int low, count: takes one of the count + 1 RINS_JUMP after
+                              // it, the first when a is out of range
+
+    RINS_END,
+
+    RINS_COUNT
+} ERegInstruction;
+
+//------------------------------------------------------------------------------
+typedef union
+{
+    hsbint i;
+    hsbfloat f;
+} SRegister;
+
+//------------------------------------------------------------------------------
+typedef struct
+{
+    SStackData instructions;
+    int registerCount;
+    EIRType* globalTypes; // The globals are in the first registers at RINS_END
+    int globalCount;
+} SRegProgram;
+
+//------------------------------------------------------------------------------
+typedef struct
+{
+    SStackData instructionStack;
+    SRegister registers[HS_REGISTER_COUNT]; // Any register operand is in bounds
+    EVMError error; // Why the VM stopped early, VM_OK when it ran to the end
+} SRegVMData;
+
+//------------------------------------------------------------------------------
+// Builds and optimizes the IR of the program and lowers it to register bytecode
+EResult CompileSourceToRegisters(char* code, int size, SRegProgram* outProgram);
+
+//------------------------------------------------------------------------------
+// Phi nodes become moves on the edges into their block, values share registers where they
+// are never live at the same time (see AssignIRVariables)
+EResult LowerIRToRegisters(const SIRProgram* program, SRegProgram* outProgram);
+
+//------------------------------------------------------------------------------
+void DeleteRegProgram(SRegProgram* program);
+
+//------------------------------------------------------------------------------
+// The VM runs the instructions of the program, which has to outlive it
+void InitRegVM(SRegVMData* vmData, const SRegProgram* program);
+
+//------------------------------------------------------------------------------
+// Counterpart of VMProcessInstructions, returns HS_FALSE once the program ended or failed
+Bool8 RegVMProcessInstructions(SRegVMData* vmData, int count);
+
+//------------------------------------------------------------------------------
+const char* GetRegInstructionName(ERegInstruction instruction);
+
+//------------------------------------------------------------------------------
+// Size of the instruction including its operands, 0 for invalid instructions
+int GetRegInstructionSize(ERegInstruction instruction);
+
+//------------------------------------------------------------------------------
+// Prints one instruction per line with its address and operands
+void PrintRegInstructions(const SRegProgram* program);
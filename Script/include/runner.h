@@ -0,0 +1,47 @@
+#pragma once
+
+#include "embed.h"
+
+// Runs many calls of the functions of a shared program on a pool of threads. Every thread has
+// its own context, the program is only read, so the calls need no locks:
+//
+//     SProgram* program = CreateSharedProgram(code, size, &natives);
+//     SScriptRunner* runner = CreateScriptRunner(program, 8);
+//     ReleaseProgram(program); // The runner keeps its own reference
+//
+//     SScriptJob jobs[1000];   // function, arguments and argumentCount of each call
+//     RunScriptJobs(runner, jobs, 1000);
+//     DeleteScriptRunner(runner);
+//
+// RunScriptJobs hands the jobs out in chunks of HS_RUNNER_CHUNK to the threads and the caller,
+// which runs jobs as well, and returns once all of them ran.
+
+#define HS_RUNNER_CHUNK 64
+
+//------------------------------------------------------------------------------
+typedef struct
+{
+    int function;
+    SScriptValue arguments[HS_NATIVE_MAX_ARGUMENTS];
+    int argumentCount;
+    SScriptValue result; // Set by RunScriptJobs for functions with a result
+    EResult status;      // Set by RunScriptJobs, R_ERROR when CallFunction failed
+} SScriptJob;
+
+//------------------------------------------------------------------------------
+// Thread pool and per-thread contexts, defined in runner.c
+typedef struct SScriptRunner SScriptRunner;
+
+//------------------------------------------------------------------------------
+// Starts threadCount - 1 threads, the caller of RunScriptJobs is the last one. Keeps a reference
+// to the program, which has to come from CreateSharedProgram. NULL when the threads could not
+// be started.
+SScriptRunner* CreateScriptRunner(SProgram* program, int threadCount);
+
+//------------------------------------------------------------------------------
+// Stops the threads and releases the program
+void DeleteScriptRunner(SScriptRunner* runner);
+
+//------------------------------------------------------------------------------
+// Runs every job, R_ERROR when one of them failed. Calls for the same runner must not overlap.
+EResult RunScriptJobs(SScriptRunner* runner, SScriptJob* jobs, int jobCount);
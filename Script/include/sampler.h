@@ -0,0 +1,76 @@
+#pragma once
+
+#include "bytecode_d.h"
+#include "line_table.h"
+
+#include <stdio.h>
+
+// Sampling profiler. SampledProcessInstructions runs VMProcessInstructions in chunks of about
+// period instructions and records where each chunk stopped: the instruction about to run and the
+// return addresses of the calls it is in. The interpreter loop is the plain one, a sample costs a
+// return from it and a walk of the variable area. Chunks vary by up to a quarter of the period so
+// the samples do not line up with a loop whose length divides it. Samples are spread by the
+// instructions run rather than by time, every instruction weighs the same.
+//
+// The return addresses are found with the stack layouts of the verifier (verifier.h), programs it
+// rejects (recursive ones among them) are sampled without their callers.
+
+//------------------------------------------------------------------------------
+// A distinct stack and how often it was sampled
+typedef struct
+{
+    int first;  // Index of its outermost frame in frames
+    int depth;
+    int next;   // Next stack with the same sampled offset, -1 for none
+    uint64_t count;
+} SSampleStack;
+
+//------------------------------------------------------------------------------
+typedef struct
+{
+    SStackData instructions; // The sampled program, which has to outlive the profile
+    int period;
+    uint64_t sampleCount;
+    uint64_t* samples;       // Indexed by offset of the sampled instruction
+
+    // Frames of a stack are the return addresses, the outermost first, then the sampled offset
+    SSampleStack* stacks;
+    int stackCount;
+    int stackCapacity;
+    int* firstStacks;        // Indexed by sampled offset, -1 for none
+    hsbaddress* frames;
+    int frameCount;
+    int frameCapacity;
+
+    // From the verifier, indexed by offset
+    int* functions;          // Entry of the function the instruction is in, 0 in the main program
+    int* returnSlots;        // Index of the first return address in slots, the next offset's ends it
+    int* slots;              // Return addresses as bytes above the top of the variable area, the innermost first
+
+    int untilSample;         // Instructions to run before the next sample
+    uint32_t random;         // State of the chunk length variation
+} SSampleProfile;
+
+//------------------------------------------------------------------------------
+// period is the average number of instructions between samples
+void InitSampleProfile(SSampleProfile* profile, SStackData instructions, int period);
+
+//------------------------------------------------------------------------------
+void DeleteSampleProfile(SSampleProfile* profile);
+
+//------------------------------------------------------------------------------
+// Counterpart of VMProcessInstructions, the VM has to run the sampled instructions from its start
+Bool8 SampledProcessInstructions(SVMData* vmData, int count, SSampleProfile* profile);
+
+//------------------------------------------------------------------------------
+// Samples per function, in it and in what it called, and per source line, the most first. lines
+// is the table of the program (CompileWithLines) or NULL, source the code it was compiled from
+// to print the lines with or NULL.
+void PrintSampleProfile(const SSampleProfile* profile, const SLineTable* lines, const char* source, FILE* out);
+
+//------------------------------------------------------------------------------
+// Folded stacks as flame graph tools read them, a line per stack: the frames separated by ';'
+// and the samples after a space. Frames are functions, "main" or "function_<entry>", with the
+// line of the instruction (":<line>") when perLine is set, or its offset ("+<offset>") when the
+// table has no line for it. name is the outermost frame when not NULL.
+void WriteFoldedStacks(const SSampleProfile* profile, const SLineTable* lines, const char* name, Bool8 perLine, FILE* out);
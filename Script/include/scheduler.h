@@ -0,0 +1,88 @@
+#pragma once
+
+#include "async.h"
+
+// Runs many calls of script functions as coroutines, one context each, in time slices. A tick
+// resumes every running instance once, in the order they were spawned, until it yields,
+// finishes or ran its quantum of instructions:
+//
+//     SScheduler scheduler;
+//     InitScheduler(&scheduler, &program, 1000);
+//     int enemy = SpawnInstance(&scheduler, FindFunction(&program, "patrol"), arguments, 1);
+//
+//     while (RunSchedulerTick(&scheduler) > 0) // once per frame
+//         ...
+//
+// A script waits for the next tick with a yield statement, so "wait n frames" is a loop around
+// a yield. A preempted instance goes on where it stopped at the next tick. Finished instances
+// keep their state and result until FreeInstance, which makes their context available to the
+// next SpawnInstance. The scheduler runs on the thread that calls it.
+//
+// An instance that calls an async native (async.h) waits outside of the running ones, by the
+// token of the call. The natives, or the threads doing their work, post the results to the
+// completions of the scheduler. A tick first completes the calls of the tokens posted since
+// the last one and resumes their instances after the running ones, a token that no instance
+// waits for is dropped.
+
+//------------------------------------------------------------------------------
+typedef struct
+{
+    SScriptContext context;
+    int quantum;            // Instructions per tick
+    EScriptState state;
+    SScriptValue result;    // Once finished, of functions with a result
+    Bool8 isFree;
+} SScriptInstance;
+
+//------------------------------------------------------------------------------
+typedef struct
+{
+    int token;              // HS_NO_ASYNC_CALL for an empty slot
+    int instance;
+} SWaitingInstance;
+
+//------------------------------------------------------------------------------
+typedef struct
+{
+    const SProgram* program;
+    int quantum;            // Of new instances
+    SScriptInstance* instances;
+    int instanceCount;
+    int instanceCapacity;
+    int* running;           // Instances to resume in the next tick, in spawn order
+    int runningCount;
+    int* free;              // Freed instances whose contexts new ones take over
+    int freeCount;
+    SWaitingInstance* waiting; // By token, open addressing with linear probing
+    int waitingCount;
+    int waitingCapacity;    // A power of two, at most half of it is used
+    SCompletionQueue completions; // Posted from any thread, taken by RunSchedulerTick
+} SScheduler;
+
+//------------------------------------------------------------------------------
+// The program has to outlive the scheduler
+void InitScheduler(SScheduler* scheduler, const SProgram* program, int quantum);
+
+//------------------------------------------------------------------------------
+void DeleteScheduler(SScheduler* scheduler);
+
+//------------------------------------------------------------------------------
+// Starts the function with the arguments (see CallFunction), it runs from the next tick on.
+// Returns the handle of the instance, -1 when the call is invalid.
+int SpawnInstance(SScheduler* scheduler, int function, const SScriptValue* arguments, int argumentCount);
+
+//------------------------------------------------------------------------------
+void SetInstanceQuantum(SScheduler* scheduler, int instance, int quantum);
+
+//------------------------------------------------------------------------------
+// The instance, valid until the next SpawnInstance
+const SScriptInstance* GetInstance(const SScheduler* scheduler, int instance);
+
+//------------------------------------------------------------------------------
+// Stops the instance if it still runs, its handle is invalid after
+void FreeInstance(SScheduler* scheduler, int instance);
+
+//------------------------------------------------------------------------------
+// Completes the posted calls and resumes every running instance once, returns the number of
+// instances still running or waiting
+int RunSchedulerTick(SScheduler* scheduler);
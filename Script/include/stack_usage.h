@@ -0,0 +1,54 @@
+#pragma once
+
+#include "bytecode_d.h"
+
+//------------------------------------------------------------------------------
+typedef struct
+{
+    int entry;          // Address of the first instruction, 0 for the main program
+    int argumentSize;   // Operand bytes the function (with its calls) pops from its caller
+    int maxOperandSize; // Largest operand stack use in bytes, relative to the entry
+    int maxFrameSize;   // Largest variable area use in bytes, relative to the entry
+    int maxLocalSize;   // Largest use of both together, called functions excluded
+    int maxTotalSize;   // Including the called functions, -1 when the function can recurse
+} SFunctionUsage;
+
+//------------------------------------------------------------------------------
+typedef struct
+{
+    int errorOffset;    // Address of the offending instruction, -1 when the analysis succeeded
+    const char* error;  // NULL when the analysis succeeded
+
+    SFunctionUsage* functions; // The main program first, then the called functions
+    int functionCount;
+
+    Bool8 isRecursive;
+    int requiredDataSize; // Data stack bytes the program needs, -1 when it is recursive
+    int callReserve;      // Free bytes INS_CALL checks for, 0 when the program is not recursive
+} SStackUsage;
+
+//------------------------------------------------------------------------------
+// Computes how much data stack the instructions need. Every function (the main program
+// and each INS_CALL target) is analyzed on its own: operand and variable sizes are tracked
+// relative to its entry, the size after INS_CALL comes from what the callee returns.
+// Operands below the entry are arguments, each caller has to provide them.
+// Control flow has to join with the same sizes and functions have to release their
+// variables before INS_RETURN. The call graph then adds up the deepest chain of calls,
+// a cycle in it marks the program as recursive. INS_TAIL_CALL of a function to itself reuses
+// the frame and is no cycle.
+EResult AnalyzeStackUsage(SStackData instructions, SStackUsage* outUsage);
+
+//------------------------------------------------------------------------------
+// AnalyzeStackUsage with functions the host calls directly (embed.h) besides the ones INS_CALL
+// reaches. Each entry is analyzed as a function from its entry on, requiredDataSize is still
+// what the main program needs.
+EResult AnalyzeStackUsageWithEntries(SStackData instructions, const int* entries, int entryCount, SStackUsage* outUsage);
+
+//------------------------------------------------------------------------------
+void FreeStackUsage(SStackUsage* usage);
+
+//------------------------------------------------------------------------------
+// InitVM with exactly the data stack the program needs. A recursive program has no static
+// bound, it gets recursiveDataSize bytes (at least what the main program needs itself)
+// and INS_CALL checks that callReserve bytes are free before entering a function.
+void InitVMForProgram(SVMData* vmData, SStackData instructions, const SStackUsage* usage, int recursiveDataSize, FuncArray functions);
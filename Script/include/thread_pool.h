@@ -0,0 +1,34 @@
+#pragma once
+
+// Threads that wait for work and run it together with the caller, for the parallel parts of
+// the host side (runner.h, parallel_scheduler.h). RunOnThreads hands the work to every thread,
+// the caller runs it as the last one, and returns once all of them returned from it, so the
+// work sees what the caller wrote before and the caller sees what the work wrote.
+
+//------------------------------------------------------------------------------
+// Runs on every thread of the pool, thread is 0 to threadCount - 1
+typedef void (ThreadWork)(void* data, int thread);
+
+//------------------------------------------------------------------------------
+// The platform types are in thread_pool.c
+typedef struct SThreadPool SThreadPool;
+
+//------------------------------------------------------------------------------
+// Starts threadCount - 1 threads, the caller of RunOnThreads is the last one. Returns NULL
+// when a thread could not be started.
+SThreadPool* CreateThreadPool(int threadCount);
+
+//------------------------------------------------------------------------------
+void DeleteThreadPool(SThreadPool* pool);
+
+//------------------------------------------------------------------------------
+int GetThreadCount(const SThreadPool* pool);
+
+//------------------------------------------------------------------------------
+// Calls work on every thread and waits for all of them. Calls for the same pool must not overlap.
+void RunOnThreads(SThreadPool* pool, ThreadWork* work, void* data);
+
+//------------------------------------------------------------------------------
+// Gives the rest of the time slice to another thread, for a thread that waits for the others
+// without anything to run, e.g. a scheduler whose instances all wait on channels (channel.h)
+void YieldThread(void);
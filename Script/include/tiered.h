@@ -0,0 +1,64 @@
+#pragma once
+
+#include "bytecode_d.h"
+
+// Tiered execution. Programs start on the baseline tier: the checked interpreter running the
+// instructions as compiled, counting calls of every function and backward jumps to every
+// loop header. When a counter reaches the threshold the program is optimized
+// (FuseSuperinstructions) and the VM swaps to the optimized instructions right at the hot
+// function entry or loop header, return addresses in the variable area are moved along.
+// Addresses change for the whole program when it is optimized, so promotion is for the whole
+// program, triggered by its hottest spot. The swap needs the stack layouts from the verifier,
+// programs it rejects (e.g. recursive ones) stay on the baseline tier.
+
+//------------------------------------------------------------------------------
+typedef enum
+{
+    TIER_BASELINE,
+    TIER_OPTIMIZED,
+} ETier;
+
+//------------------------------------------------------------------------------
+// Counters of the baseline interpreter
+typedef struct
+{
+    int* counters;  // Indexed by address of a function entry or a loop header
+    int size;       // Size of the baseline instructions
+    int threshold;  // Count at which the baseline interpreter stops to promote
+    int hotAddress; // The address which reached the threshold, -1 until then
+} SHotness;
+
+//------------------------------------------------------------------------------
+typedef struct
+{
+    int address;      // In the baseline instructions
+    Bool8 isFunction; // Function entry (INS_CALL target), otherwise a loop header
+    int count;
+} SHotSpot;
+
+//------------------------------------------------------------------------------
+typedef struct
+{
+    SVMData vm;
+    SStackData baseline;  // Owned by the tiered VM
+    SStackData optimized; // Owned by the tiered VM, empty until promoted
+    ETier tier;
+    SHotness hotness;
+    int promotionAddress; // Baseline address where the VM was promoted, -1 if it was not
+} STieredVM;
+
+//------------------------------------------------------------------------------
+// Takes ownership of the instructions. A threshold of 0 never promotes.
+void InitTieredVM(STieredVM* tiered, SStackData instructions, int dataSize, FuncArray functions, int threshold);
+
+//------------------------------------------------------------------------------
+void DeleteTieredVM(STieredVM* tiered, Bool8 keepFunctions);
+
+//------------------------------------------------------------------------------
+// Counterpart of VMProcessInstructions, a promotion ends the call early
+Bool8 TieredProcessInstructions(STieredVM* tiered, int count);
+
+//------------------------------------------------------------------------------
+// Function entries and loop headers that were reached, the hottest first.
+// Fills at most maxSpots and returns the number filled.
+int GetHotSpots(const STieredVM* tiered, SHotSpot* outSpots, int maxSpots);
@@ -7,6 +7,7 @@ typedef enum
 {
     TOKEN_SEMICOLON,
     TOKEN_COLON,
+    TOKEN_COMMA,
     TOKEN_EQUALS,
     TOKEN_LEFT_BRACE,
     TOKEN_RIGHT_BRACE,
@@ -25,10 +26,16 @@ typedef enum
     TOKEN_NOT_EQUAL,
 
     TOKEN_VAR,
+    TOKEN_FUN,
+    TOKEN_RETURN,
+    TOKEN_YIELD,
     TOKEN_IF,
     TOKEN_ELSE,
     TOKEN_WHILE,
     TOKEN_FOR,
+    TOKEN_SWITCH,
+    TOKEN_CASE,
+    TOKEN_DEFAULT,
 
     TOKEN_IDENTIFIER,
     TOKEN_STRING,
@@ -38,10 +45,20 @@ typedef enum
     TOKEN_END,
 } ETokenType;
 
+//------------------------------------------------------------------------------
+// Where a token starts in the source, lines and columns count from 1. Both stop at
+// UINT16_MAX, which keeps SToken at its size.
+typedef struct
+{
+    uint16_t line;
+    uint16_t column;
+} SSourcePosition;
+
 //------------------------------------------------------------------------------
 typedef struct Token
 {
     ETokenType type;
+    SSourcePosition position;
     union
     {
         char*   string;
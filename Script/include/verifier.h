@@ -0,0 +1,67 @@
+#pragma once
+
+#include "bytecode_d.h"
+
+//------------------------------------------------------------------------------
+typedef enum
+{
+    TAG_INT,
+    TAG_FLOAT,
+    TAG_BOOL,
+    TAG_ADDRESS,
+    TAG_FRAME,   // Caller's frame pointer saved by INS_ENTER, address sized
+    TAG_COUNT
+} ETypeTag;
+
+#define HS_LAYOUT_MAX_VALUES 128
+
+//------------------------------------------------------------------------------
+// Data stack bytes taken by a value of the type (ETypeTag)
+int GetTagSize(byte tag);
+
+//------------------------------------------------------------------------------
+// What is known about the data stack before an instruction
+typedef struct
+{
+    int function; // Entry address of the function being executed, -1 outside of functions
+    int frame;    // Index into stack of the first value of the INS_ENTER frame, -1 outside of frames
+    int stackCount;
+    int varCount;
+    byte stack[HS_LAYOUT_MAX_VALUES]; // Operand types (ETypeTag), the bottom first
+    byte vars[HS_LAYOUT_MAX_VALUES];  // Variable types (ETypeTag), the first allocated first
+} SStackLayout;
+
+//------------------------------------------------------------------------------
+typedef struct
+{
+    int errorOffset;    // Address of the offending instruction, -1 when the code is valid
+    const char* error;  // NULL when the code is valid
+    int maxDataSize;    // Largest number of data stack bytes (operands and variables) in use
+} SVerifyResult;
+
+//------------------------------------------------------------------------------
+// Proves by abstract interpretation that the instructions are safe to run with
+// VMRunVerified on a VM with dataSize bytes of data stack:
+// - every instruction is valid and jumps land on instruction boundaries
+// - execution never runs past the end of the code, it stops at INS_END
+// - operands have the types the instructions expect and the stack never underflows
+// - variable offsets point at a variable of the right type
+// - operands and variables together never use more than dataSize bytes
+// - every address in the variable area is popped by INS_RETURN only, every saved frame
+//   pointer by INS_LEAVE only, and frame offsets point at a local of the right type
+// INS_CALL_EXT and INS_CALL_ASYNC are trusted to have the signature of their operands and an
+// index of one of the functions of the VM, which is up to the host (see natives.h).
+// Each instruction has a single stack layout, so a function has to be called with the
+// same layout from everywhere, which also rules out recursion except for INS_TAIL_CALL
+// of a function to itself with arguments of the same types.
+EResult VerifyInstructions(SStackData instructions, int dataSize, SVerifyResult* outResult);
+
+//------------------------------------------------------------------------------
+// VerifyInstructions that also returns the stack layout before every instruction in
+// outLayouts, an array indexed by address with NULL for unreachable addresses.
+// The layouts are only returned for valid code, free them with FreeStackLayouts.
+EResult VerifyInstructionsWithLayouts(SStackData instructions, int dataSize, SVerifyResult* outResult,
+    SStackLayout*** outLayouts);
+
+//------------------------------------------------------------------------------
+void FreeStackLayouts(SStackLayout** layouts, int count);
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "embed.h"
+
+// Runs a script function for HS_WIDE_LANES rows at once. Every value on the data stack and in
+// the variable area is a vector with a lane per row, so an instruction is dispatched once for
+// all of them and its lane loop compiles to SIMD operations (build with e.g. -mavx2 for 8 floats
+// per operation).
+//
+// Lanes that branch differently split into groups. The group at the lowest instruction address
+// runs, the others wait with their own address, stack and variable pointers. When the running
+// group gets to the address of a waiting one they merge again, for the code of if, while and
+// switch that is right after the branch. Stores to variables and to the frame only change the
+// lanes that run, the operand stack holds the frame only wherever the compiler branches, so the
+// values the waiting lanes still need are never overwritten.
+//
+// Functions that call other functions or natives can not run wide (see CanRunWide), they run
+// with CallFunctionBatch.
+
+#ifndef HS_WIDE_LANES
+#define HS_WIDE_LANES 8
+#endif
+
+//------------------------------------------------------------------------------
+typedef union
+{
+    hsbint i[HS_WIDE_LANES];
+    hsbfloat f[HS_WIDE_LANES];
+    int32_t b[HS_WIDE_LANES]; // Bools with all bits set or clear, the bits of floats in lane masks
+} SWideValue;
+
+// Every byte of the data stack of the VM is a wide value, the offsets in the instructions stay
+// the same relative to the scale
+#define HS_WIDE_SCALE (sizeof(SWideValue) / HS_DATA_SIZE_BOOL)
+
+//------------------------------------------------------------------------------
+typedef struct
+{
+    const SProgram* program;
+    byte* dataBegin;
+    byte* dataEnd;
+} SWideContext;
+
+//------------------------------------------------------------------------------
+// The program has to outlive the context
+void InitWideContext(SWideContext* context, const SProgram* program);
+
+//------------------------------------------------------------------------------
+void DeleteWideContext(SWideContext* context);
+
+//------------------------------------------------------------------------------
+// Whether the function only uses instructions the wide VM runs, prints why not when it does not
+Bool8 CanRunWide(const SProgram* program, int function);
+
+//------------------------------------------------------------------------------
+// Same as CallFunctionBatch, HS_WIDE_LANES rows at a time. Fails for functions CanRunWide
+// rejects and when the VM stops with an error, the groups of rows before it have their results.
+EResult CallFunctionWide(SWideContext* context, int function, const void* const* inputs, int argumentCount,
+    void* outputs, int rowCount);
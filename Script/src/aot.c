@@ -0,0 +1,585 @@
+#include "aot.h"
+#include "bytecode_c.h"
+#include "bytecode_info.h"
+#include "verifier.h"
+
+#include <limits.h>
+#include <math.h>
+#include <stdarg.h>
+
+//------------------------------------------------------------------------------
+typedef enum
+{
+    LOCAL_OPERAND,
+    LOCAL_VAR,
+    LOCAL_COUNT,
+} ELocal;
+
+static const char LOCAL_PREFIX[] = { 's', 'v' };
+static const char TAG_SUFFIX[] = { 'i', 'f', 'b', 'a', 'p' };
+static const char* TAG_TYPE[] = { "hsbint", "hsbfloat", "hsbbool", "hsbaddress", "hsbaddress" };
+static const char* TAG_SIZE[] = { "HS_DATA_SIZE_INT", "HS_DATA_SIZE_FLOAT", "HS_DATA_SIZE_BOOL", "HS_DATA_SIZE_ADDRESS", "HS_DATA_SIZE_ADDRESS" };
+
+#define NUM_NAMES 4
+
+//------------------------------------------------------------------------------
+typedef struct
+{
+    FILE* out; // NULL while collecting which locals are read
+    byte* code;
+    int size;
+    SStackLayout** layouts;
+    Bool8* isLabel;
+    Bool8 hasFrames; // The framePointer local keeps the offset of the INS_ENTER frame
+
+    // Locals are declared when they are read, stores to the others are left out
+    Bool8 isRead[LOCAL_COUNT][HS_LAYOUT_MAX_VALUES][TAG_COUNT];
+
+    char names[NUM_NAMES][16];
+    int nextName;
+} STranslator;
+
+//------------------------------------------------------------------------------
+static void Emit(STranslator* t, const char* format, ...)
+{
+    if (!t->out)
+        return;
+
+    va_list args;
+    va_start(args, format);
+    vfprintf(t->out, format, args);
+    va_end(args);
+}
+
+//------------------------------------------------------------------------------
+static const char* Read(STranslator* t, ELocal kind, int index, byte tag)
+{
+    t->isRead[kind][index][tag] = HS_TRUE;
+
+    char* name = t->names[t->nextName++ % NUM_NAMES];
+    sprintf(name, "%c%d_%c", LOCAL_PREFIX[kind], index, TAG_SUFFIX[tag]);
+    return name;
+}
+
+//------------------------------------------------------------------------------
+static void Store(STranslator* t, ELocal kind, int index, byte tag, const char* format, ...)
+{
+    if (!t->out || !t->isRead[kind][index][tag])
+        return;
+
+    fprintf(t->out, "    %c%d_%c = ", LOCAL_PREFIX[kind], index, TAG_SUFFIX[tag]);
+    va_list args;
+    va_start(args, format);
+    vfprintf(t->out, format, args);
+    va_end(args);
+    fprintf(t->out, ";\n");
+}
+
+//------------------------------------------------------------------------------
+// Index of the variable at the byte offset from the top of the variable area,
+// the verifier proved that the offset points at a variable
+static int VarIndex(const SStackLayout* layout, int offset)
+{
+    int i = layout->varCount - 1;
+    for (int position = 0; position < offset; --i)
+        position += GetTagSize(layout->vars[i]);
+    return i;
+}
+
+//------------------------------------------------------------------------------
+// Index of the operand at the byte offset from the frame pointer, the arguments and
+// locals of a frame are the operand locals the caller pushed them to
+static int FrameIndex(const SStackLayout* layout, int offset)
+{
+    int i = layout->frame;
+    for (int position = 0; position < offset; ++i)
+        position += GetTagSize(layout->stack[i]);
+    return i;
+}
+
+//------------------------------------------------------------------------------
+// The data stack bytes of values with the counts of each tag
+static void EmitSize(STranslator* t, const int* counts)
+{
+    const char* separator = "";
+    for (int tag = 0; tag < TAG_COUNT; ++tag)
+    {
+        if (counts[tag] == 1)
+            Emit(t, "%s%s", separator, TAG_SIZE[tag]);
+        else if (counts[tag] > 1)
+            Emit(t, "%s%d * %s", separator, counts[tag], TAG_SIZE[tag]);
+
+        if (counts[tag] > 0)
+            separator = " + ";
+    }
+    if (!*separator)
+        Emit(t, "0");
+}
+
+//------------------------------------------------------------------------------
+static void Binary(STranslator* t, int stackCount, byte tag, byte resultTag, const char* operation)
+{
+    const char* first = Read(t, LOCAL_OPERAND, stackCount - 2, tag);
+    const char* second = Read(t, LOCAL_OPERAND, stackCount - 1, tag);
+    Store(t, LOCAL_OPERAND, stackCount - 2, resultTag, "%s %s %s", first, operation, second);
+}
+
+//------------------------------------------------------------------------------
+static void LiteralOperation(STranslator* t, int stackCount, const byte* ins, const char* operation)
+{
+    const char* first = Read(t, LOCAL_OPERAND, stackCount - 1, TAG_INT);
+    Store(t, LOCAL_OPERAND, stackCount - 1, TAG_INT, "%s %s %d", first, operation, LoadInt((byte*)ins + 1));
+}
+
+//------------------------------------------------------------------------------
+static void VarVarOperation(STranslator* t, const SStackLayout* layout, const byte* ins, const char* operation)
+{
+    const char* first = Read(t, LOCAL_VAR, VarIndex(layout, ins[1]), TAG_INT);
+    const char* second = Read(t, LOCAL_VAR, VarIndex(layout, ins[2]), TAG_INT);
+    Store(t, LOCAL_OPERAND, layout->stackCount, TAG_INT, "%s %s %s", first, operation, second);
+}
+
+//------------------------------------------------------------------------------
+static void CompareJump(STranslator* t, int stackCount, const byte* ins, const char* operation)
+{
+    const char* first = Read(t, LOCAL_OPERAND, stackCount - 2, TAG_INT);
+    const char* second = Read(t, LOCAL_OPERAND, stackCount - 1, TAG_INT);
+    Emit(t, "    if (%s %s %s)\n        goto L%d;\n", first, operation, second, LoadAddress((byte*)ins + 1));
+}
+
+//------------------------------------------------------------------------------
+// The C compiler picks how to dispatch, the targets are those of the jump table
+static void Switch(STranslator* t, int stackCount, const byte* ins)
+{
+    int low = LoadInt((byte*)ins + 1);
+    int count = ins[1 + sizeof(hsbint)];
+    const byte* table = ins + GetInstructionSize(INS_SWITCH);
+    int entrySize = GetInstructionSize(INS_JUMP);
+
+    Emit(t, "    switch (%s)\n    {\n", Read(t, LOCAL_OPERAND, stackCount - 1, TAG_INT));
+    for (int i = 0; i < count; ++i)
+        Emit(t, "        case %d: goto L%d;\n", low + i, LoadAddress((byte*)table + (i + 1) * entrySize + 1));
+    Emit(t, "        default: goto L%d;\n    }\n", LoadAddress((byte*)table + 1));
+}
+
+//------------------------------------------------------------------------------
+static void FloatLiteral(STranslator* t, int stackCount, hsbfloat value)
+{
+    // Hexadecimal literals keep every bit of the value
+    if (isnan(value))
+        Store(t, LOCAL_OPERAND, stackCount, TAG_FLOAT, "NAN");
+    else if (isinf(value))
+        Store(t, LOCAL_OPERAND, stackCount, TAG_FLOAT, value < 0 ? "-INFINITY" : "INFINITY");
+    else
+        Store(t, LOCAL_OPERAND, stackCount, TAG_FLOAT, "%af", (double)value);
+}
+
+//------------------------------------------------------------------------------
+// Marks the function and the functions tail calling it, the return address of any of them
+// can be on top of the variable area when the function returns
+static void MarkTailCallers(STranslator* t, int function, Bool8* isReturning)
+{
+    isReturning[function] = HS_TRUE;
+    for (int offset = 0; offset < t->size; offset += GetInstructionSize(t->code[offset]))
+    {
+        const SStackLayout* layout = t->layouts[offset];
+        if (layout && t->code[offset] == INS_TAIL_CALL && LoadAddress(t->code + offset + 1) == function
+            && !isReturning[layout->function])
+        {
+            MarkTailCallers(t, layout->function, isReturning);
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+static Bool8 IsReturnSite(STranslator* t, int offset, const Bool8* isReturning)
+{
+    return t->layouts[offset] && t->code[offset] == INS_CALL && isReturning[LoadAddress(t->code + offset + 1)];
+}
+
+//------------------------------------------------------------------------------
+// INS_RETURN goes back to any INS_CALL of the function
+static void Return(STranslator* t, int function, const char* address)
+{
+    Bool8* isReturning = calloc(t->size, sizeof(Bool8));
+    MarkTailCallers(t, function, isReturning);
+
+    int returnCount = 0;
+    for (int offset = 0; offset < t->size; offset += GetInstructionSize(t->code[offset]))
+    {
+        if (IsReturnSite(t, offset, isReturning))
+            ++returnCount;
+    }
+
+    if (returnCount == 1)
+        Emit(t, "    goto L");
+    else
+        Emit(t, "    switch (%s)\n    {\n", address);
+
+    int returnIndex = 0;
+    for (int offset = 0; offset < t->size; offset += GetInstructionSize(t->code[offset]))
+    {
+        if (!IsReturnSite(t, offset, isReturning))
+            continue;
+
+        int next = offset + GetInstructionSize(INS_CALL);
+        if (returnCount == 1)
+            Emit(t, "%d;\n", next);
+        else if (++returnIndex < returnCount)
+            Emit(t, "        case %d: goto L%d;\n", next, next);
+        else
+            Emit(t, "        default: goto L%d;\n", next);
+    }
+
+    if (returnCount > 1)
+        Emit(t, "    }\n");
+
+    free(isReturning);
+}
+
+//------------------------------------------------------------------------------
+// The arguments stay where they are, the locals follow them
+static void Enter(STranslator* t, const SStackLayout* layout, int offset, const byte* ins)
+{
+    const SStackLayout* frame = t->layouts[offset + GetInstructionSize(INS_ENTER)];
+
+    Store(t, LOCAL_VAR, layout->varCount, TAG_FRAME, "framePointer");
+    int counts[TAG_COUNT] = { 0 };
+    for (int i = 0; i < frame->frame; ++i)
+        ++counts[frame->stack[i]];
+    Emit(t, "    framePointer = ");
+    EmitSize(t, counts);
+    Emit(t, ";\n");
+
+    for (int i = layout->stackCount; i < frame->stackCount; ++i)
+        Store(t, LOCAL_OPERAND, i, frame->stack[i], frame->stack[i] == TAG_INT ? "0" : "0.0f");
+}
+
+//------------------------------------------------------------------------------
+// The value on top moves to the first argument, then the function returns
+static void Leave(STranslator* t, const SStackLayout* layout, byte valueTag)
+{
+    int top = layout->stackCount - 1;
+    if (valueTag != TAG_COUNT && top != layout->frame)
+        Store(t, LOCAL_OPERAND, layout->frame, valueTag, "%s", Read(t, LOCAL_OPERAND, top, valueTag));
+
+    Emit(t, "    framePointer = %s;\n", Read(t, LOCAL_VAR, layout->varCount - 1, TAG_FRAME));
+    Return(t, layout->function, Read(t, LOCAL_VAR, layout->varCount - 2, TAG_ADDRESS));
+}
+
+//------------------------------------------------------------------------------
+// The arguments move to the first argument of the frame and the callee takes over
+static void TailCall(STranslator* t, const SStackLayout* layout, const byte* ins)
+{
+    int first = layout->stackCount;
+    for (int size = 0; size < ins[1 + sizeof(hsbaddress)];)
+        size += GetTagSize(layout->stack[--first]);
+
+    if (first != layout->frame)
+    {
+        for (int i = first; i < layout->stackCount; ++i)
+        {
+            byte tag = layout->stack[i];
+            Store(t, LOCAL_OPERAND, layout->frame + i - first, tag, "%s", Read(t, LOCAL_OPERAND, i, tag));
+        }
+    }
+
+    Emit(t, "    framePointer = %s;\n", Read(t, LOCAL_VAR, layout->varCount - 1, TAG_FRAME));
+    Emit(t, "    goto L%d;\n", LoadAddress((byte*)ins + 1));
+}
+
+//------------------------------------------------------------------------------
+// Writes the locals to the data stack the way the interpreter leaves it, the VM continues at
+// offset. Only the lowest stackCount operands of the layout are still there.
+static void End(STranslator* t, const SStackLayout* layout, int stackCount, int offset, const char* result)
+{
+    int counts[TAG_COUNT] = { 0 };
+    for (int i = 0; i < stackCount; ++i)
+        ++counts[layout->stack[i]];
+    for (int i = 0; i < layout->varCount; ++i)
+        ++counts[layout->vars[i]];
+
+    if (stackCount + layout->varCount > 0)
+    {
+        Emit(t, "    if (vmData->dataStack.base.end - vmData->dataStack.base.begin < (ptrdiff_t)(");
+        EmitSize(t, counts);
+        Emit(t, "))\n    {\n        vmData->error = VM_ERROR_STACK_OVERFLOW;\n        return HS_FALSE;\n    }\n");
+    }
+
+    static const char* PUSH[] = { "PushInt", "PushFloat", "PushBool" };
+    for (int i = 0; i < stackCount; ++i)
+    {
+        const char* value = Read(t, LOCAL_OPERAND, i, layout->stack[i]);
+        Emit(t, "    %s(&vmData->dataStack.base.stackPointer, %s);\n", PUSH[layout->stack[i]], value);
+    }
+
+    static const char* STORE_VAR[] = { "StoreVarInt", "StoreVarFloat" };
+    for (int i = 0; i < layout->varCount; ++i)
+    {
+        byte tag = layout->vars[i];
+        const char* value = Read(t, LOCAL_VAR, i, tag);
+        if (tag == TAG_ADDRESS || tag == TAG_FRAME)
+        {
+            Emit(t, "    StoreAddressVar(&vmData->dataStack.reversePointer, %s);\n", value);
+        }
+        else
+        {
+            Emit(t, "    vmData->dataStack.reversePointer -= %s;\n", TAG_SIZE[tag]);
+            Emit(t, "    %s(vmData->dataStack.reversePointer, %s);\n", STORE_VAR[tag], value);
+        }
+    }
+
+    if (t->hasFrames)
+        Emit(t, "    vmData->framePointer = vmData->dataStack.base.begin + framePointer;\n");
+    Emit(t, "    vmData->instructionStack.stackPointer = vmData->instructionStack.begin + %d;\n", offset);
+    Emit(t, "    return %s;\n", result);
+}
+
+//------------------------------------------------------------------------------
+// The native finds its arguments on the data stack, which is otherwise unused until INS_END,
+// and leaves its result there. An async native that waits leaves the VM after the call like
+// INS_YIELD, with the operands below its arguments.
+static void CallNative(STranslator* t, const SStackLayout* layout, int offset, const byte* ins)
+{
+    static const char* PUSH[] = { "PushInt", "PushFloat" };
+    int first = layout->stackCount - ins[2];
+    for (int i = 0; i < ins[2]; ++i)
+    {
+        byte tag = ins[3] & 1 << i ? TAG_FLOAT : TAG_INT;
+        const char* value = Read(t, LOCAL_OPERAND, first + i, tag);
+        Emit(t, "    %s(&vmData->dataStack.base.stackPointer, %s);\n", PUSH[tag], value);
+    }
+    Emit(t, "    vmData->functions.begin[%d](vmData);\n", ins[1]);
+
+    if (ins[0] == INS_CALL_ASYNC)
+    {
+        Emit(t, "    if (vmData->asyncCall == HS_NO_ASYNC_CALL)\n        goto C%d;\n", offset);
+        End(t, layout, first, offset + GetInstructionSize(INS_CALL_ASYNC), "HS_TRUE");
+        Emit(t, "C%d:\n", offset);
+    }
+
+    if (ins[4] == NATIVE_NONE)
+        return;
+
+    byte tag = ins[4] == NATIVE_INT ? TAG_INT : TAG_FLOAT;
+    if (t->isRead[LOCAL_OPERAND][first][tag])
+        Store(t, LOCAL_OPERAND, first, tag, "%s(&vmData->dataStack.base.stackPointer)", tag == TAG_INT ? "PopInt" : "PopFloat");
+    else
+        Emit(t, "    vmData->dataStack.base.stackPointer -= %s;\n", TAG_SIZE[tag]);
+}
+
+//------------------------------------------------------------------------------
+static void Translate(STranslator* t, int offset)
+{
+    const SStackLayout* layout = t->layouts[offset];
+    const byte* ins = t->code + offset;
+    EInstruction instruction = ins[0];
+    int n = layout->stackCount;
+
+    if (t->isLabel[offset])
+        Emit(t, "L%d:\n", offset);
+    Emit(t, "    // %s\n", GetInstructionName(instruction));
+
+    switch (instruction)
+    {
+        case INS_NOOP:
+        case INS_DEALLOC_VAR_I:
+        case INS_DEALLOC_VAR_F:
+            break;
+
+        case INS_ADD_I: Binary(t, n, TAG_INT, TAG_INT, "+"); break;
+        case INS_ADD_F: Binary(t, n, TAG_FLOAT, TAG_FLOAT, "+"); break;
+        case INS_SUBSTRACT_I: Binary(t, n, TAG_INT, TAG_INT, "-"); break;
+        case INS_SUBSTRACT_F: Binary(t, n, TAG_FLOAT, TAG_FLOAT, "-"); break;
+        case INS_MULTIPLY_I: Binary(t, n, TAG_INT, TAG_INT, "*"); break;
+        case INS_MULTIPLY_F: Binary(t, n, TAG_FLOAT, TAG_FLOAT, "*"); break;
+        case INS_DIVIDE_I: Binary(t, n, TAG_INT, TAG_INT, "/"); break;
+        case INS_DIVIDE_F: Binary(t, n, TAG_FLOAT, TAG_FLOAT, "/"); break;
+
+        case INS_LITERAL_I: Store(t, LOCAL_OPERAND, n, TAG_INT, "%d", LoadInt((byte*)ins + 1)); break;
+        case INS_LITERAL_F: FloatLiteral(t, n, LoadFloat((byte*)ins + 1)); break;
+        case INS_LITERAL_B: Store(t, LOCAL_OPERAND, n, TAG_BOOL, "%d", LoadBool((byte*)ins + 1)); break;
+
+        case INS_NEGATE_B:
+        {
+            const char* value = Read(t, LOCAL_OPERAND, n - 1, TAG_BOOL);
+            Store(t, LOCAL_OPERAND, n - 1, TAG_BOOL, "1 - %s", value);
+            break;
+        }
+        case INS_AND_B: Binary(t, n, TAG_BOOL, TAG_BOOL, "&"); break;
+        case INS_OR_B: Binary(t, n, TAG_BOOL, TAG_BOOL, "|"); break;
+
+        case INS_CMP_I_EQ: Binary(t, n, TAG_INT, TAG_BOOL, "=="); break;
+        case INS_CMP_I_LESS: Binary(t, n, TAG_INT, TAG_BOOL, "<"); break;
+        case INS_CMP_I_LESS_EQ: Binary(t, n, TAG_INT, TAG_BOOL, "<="); break;
+        case INS_CMP_F_EQ: Binary(t, n, TAG_FLOAT, TAG_BOOL, "=="); break;
+        case INS_CMP_F_LESS: Binary(t, n, TAG_FLOAT, TAG_BOOL, "<"); break;
+        case INS_CMP_F_LESS_EQ: Binary(t, n, TAG_FLOAT, TAG_BOOL, "<="); break;
+
+        case INS_ALLOC_VAR_I: Store(t, LOCAL_VAR, layout->varCount, TAG_INT, "0"); break;
+        case INS_ALLOC_VAR_F: Store(t, LOCAL_VAR, layout->varCount, TAG_FLOAT, "0.0f"); break;
+
+        case INS_SAVE_VAR_I:
+        case INS_SAVE_VAR_F:
+        {
+            byte tag = instruction == INS_SAVE_VAR_I ? TAG_INT : TAG_FLOAT;
+            const char* value = Read(t, LOCAL_OPERAND, n - 1, tag);
+            Store(t, LOCAL_VAR, VarIndex(layout, ins[1]), tag, "%s", value);
+            break;
+        }
+        case INS_LOAD_VAR_I:
+        case INS_LOAD_VAR_F:
+        {
+            byte tag = instruction == INS_LOAD_VAR_I ? TAG_INT : TAG_FLOAT;
+            const char* value = Read(t, LOCAL_VAR, VarIndex(layout, ins[1]), tag);
+            Store(t, LOCAL_OPERAND, n, tag, "%s", value);
+            break;
+        }
+
+        case INS_JUMP:
+            Emit(t, "    goto L%d;\n", LoadAddress((byte*)ins + 1));
+            break;
+        case INS_COND_JUMP_B:
+            Emit(t, "    if (%s != 0)\n        goto L%d;\n", Read(t, LOCAL_OPERAND, n - 1, TAG_BOOL), LoadAddress((byte*)ins + 1));
+            break;
+
+        case INS_CALL:
+            Store(t, LOCAL_VAR, layout->varCount, TAG_ADDRESS, "%d", offset + GetInstructionSize(INS_CALL));
+            Emit(t, "    goto L%d;\n", LoadAddress((byte*)ins + 1));
+            break;
+        case INS_RETURN: Return(t, layout->function, Read(t, LOCAL_VAR, layout->varCount - 1, TAG_ADDRESS)); break;
+        case INS_END: End(t, layout, n, offset, "HS_FALSE"); break;
+        case INS_YIELD: End(t, layout, n, offset + 1, "HS_TRUE"); break;
+
+        case INS_LOAD_VAR_VAR_ADD_I: VarVarOperation(t, layout, ins, "+"); break;
+        case INS_LOAD_VAR_VAR_SUBSTRACT_I: VarVarOperation(t, layout, ins, "-"); break;
+        case INS_LOAD_VAR_VAR_MULTIPLY_I: VarVarOperation(t, layout, ins, "*"); break;
+        case INS_ADD_LITERAL_I: LiteralOperation(t, n, ins, "+"); break;
+        case INS_SUBSTRACT_LITERAL_I: LiteralOperation(t, n, ins, "-"); break;
+        case INS_MULTIPLY_LITERAL_I: LiteralOperation(t, n, ins, "*"); break;
+        case INS_CMP_I_EQ_JUMP: CompareJump(t, n, ins, "=="); break;
+        case INS_CMP_I_LESS_JUMP: CompareJump(t, n, ins, "<"); break;
+        case INS_CMP_I_LESS_EQ_JUMP: CompareJump(t, n, ins, "<="); break;
+        case INS_SWITCH: Switch(t, n, ins); break;
+        case INS_CALL_EXT:
+        case INS_CALL_ASYNC: CallNative(t, layout, offset, ins); break;
+
+        case INS_MOVE_VAR_I:
+        case INS_MOVE_VAR_F:
+        {
+            byte tag = instruction == INS_MOVE_VAR_I ? TAG_INT : TAG_FLOAT;
+            const char* value = Read(t, LOCAL_VAR, VarIndex(layout, ins[1]), tag);
+            Store(t, LOCAL_VAR, VarIndex(layout, ins[2]), tag, "%s", value);
+            break;
+        }
+
+        case INS_ENTER: Enter(t, layout, offset, ins); break;
+        case INS_LOAD_FRAME_I:
+        case INS_LOAD_FRAME_F:
+        {
+            byte tag = instruction == INS_LOAD_FRAME_I ? TAG_INT : TAG_FLOAT;
+            const char* value = Read(t, LOCAL_OPERAND, FrameIndex(layout, ins[1]), tag);
+            Store(t, LOCAL_OPERAND, n, tag, "%s", value);
+            break;
+        }
+        case INS_SAVE_FRAME_I:
+        case INS_SAVE_FRAME_F:
+        {
+            byte tag = instruction == INS_SAVE_FRAME_I ? TAG_INT : TAG_FLOAT;
+            const char* value = Read(t, LOCAL_OPERAND, n - 1, tag);
+            Store(t, LOCAL_OPERAND, FrameIndex(layout, ins[1]), tag, "%s", value);
+            break;
+        }
+        case INS_LEAVE: Leave(t, layout, TAG_COUNT); break;
+        case INS_LEAVE_I: Leave(t, layout, TAG_INT); break;
+        case INS_LEAVE_F: Leave(t, layout, TAG_FLOAT); break;
+        case INS_TAIL_CALL: TailCall(t, layout, ins); break;
+
+        default:
+            break;
+    }
+}
+
+//------------------------------------------------------------------------------
+static void TranslateAll(STranslator* t)
+{
+    for (int offset = 0; offset < t->size; offset += GetInstructionSize(t->code[offset]))
+    {
+        if (t->layouts[offset])
+            Translate(t, offset);
+    }
+}
+
+//------------------------------------------------------------------------------
+EResult TranslateToC(SStackData instructions, const char* functionName, FILE* out)
+{
+    // The translation keeps nothing on the data stack until INS_END checks its size
+    SVerifyResult verifyResult;
+    SStackLayout** layouts;
+    if (VerifyInstructionsWithLayouts(instructions, INT_MAX, &verifyResult, &layouts) != R_OK)
+    {
+        printf("ERROR: Cannot translate invalid code, %s at %d\n", verifyResult.error, verifyResult.errorOffset);
+        return R_ERROR;
+    }
+
+    STranslator t =
+    {
+        .code = instructions.begin,
+        .size = instructions.end - instructions.begin,
+        .layouts = layouts,
+    };
+
+    t.isLabel = calloc(t.size, sizeof(Bool8));
+    for (int offset = 0; offset < t.size; offset += GetInstructionSize(t.code[offset]))
+    {
+        if (layouts[offset] && HasAddressOperand(t.code[offset]))
+            t.isLabel[LoadAddress(t.code + offset + 1)] = HS_TRUE;
+        if (layouts[offset] && t.code[offset] == INS_CALL)
+            t.isLabel[offset + GetInstructionSize(INS_CALL)] = HS_TRUE;
+        if (layouts[offset] && t.code[offset] == INS_ENTER)
+            t.hasFrames = HS_TRUE;
+    }
+
+    // The first pass only finds the locals which are read
+    TranslateAll(&t);
+    t.out = out;
+
+    Emit(&t, "// Translated from HsScript bytecode by TranslateToC (aot.h), do not edit.\n");
+    Emit(&t, "// Runs like VMRunVerified on a VM set up with the translated instructions.\n\n");
+    Emit(&t, "#include <math.h>\n#include <stddef.h>\n\n#include \"bytecode_c.h\"\n\n");
+    Emit(&t, "Bool8 %s(SVMData* vmData)\n{\n", functionName);
+    Emit(&t, "    if (vmData->instructionStack.stackPointer != vmData->instructionStack.begin\n");
+    Emit(&t, "        || vmData->dataStack.base.stackPointer != vmData->dataStack.base.begin\n");
+    Emit(&t, "        || vmData->dataStack.reversePointer != vmData->dataStack.base.end)\n");
+    Emit(&t, "    {\n        return VMRunVerified(vmData);\n    }\n\n");
+
+    Bool8 hasLocals = HS_FALSE;
+    for (int kind = 0; kind < LOCAL_COUNT; ++kind)
+    {
+        for (int index = 0; index < HS_LAYOUT_MAX_VALUES; ++index)
+        {
+            for (int tag = 0; tag < TAG_COUNT; ++tag)
+            {
+                if (t.isRead[kind][index][tag])
+                {
+                    Emit(&t, "    %s %c%d_%c = 0;\n", TAG_TYPE[tag], LOCAL_PREFIX[kind], index, TAG_SUFFIX[tag]);
+                    hasLocals = HS_TRUE;
+                }
+            }
+        }
+    }
+    if (t.hasFrames)
+    {
+        Emit(&t, "    hsbaddress framePointer = 0;\n");
+        hasLocals = HS_TRUE;
+    }
+    if (hasLocals)
+        Emit(&t, "\n");
+
+    TranslateAll(&t);
+    Emit(&t, "}\n");
+
+    free(t.isLabel);
+    FreeStackLayouts(layouts, t.size);
+    return R_OK;
+}
@@ -0,0 +1,101 @@
+#include "async.h"
+#include "bytecode_c.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+//------------------------------------------------------------------------------
+void CompleteAsyncCall(SVMData* vmData, SScriptValue result)
+{
+    if (vmData->asyncCall == HS_NO_ASYNC_CALL)
+    {
+        printf("ERROR: No async call to complete\n");
+        return;
+    }
+
+    // the VM stopped right after the call, the result type is its last operand
+    ENativeType type = vmData->instructionStack.stackPointer[-1];
+    if (type == NATIVE_INT)
+        PushInt(&vmData->dataStack.base.stackPointer, result.i);
+    else if (type == NATIVE_FLOAT)
+        PushFloat(&vmData->dataStack.base.stackPointer, result.f);
+    vmData->asyncCall = HS_NO_ASYNC_CALL;
+}
+
+//------------------------------------------------------------------------------
+void InitCompletionQueue(SCompletionQueue* queue)
+{
+    queue->head = NULL;
+}
+
+//------------------------------------------------------------------------------
+void DeleteCompletionQueue(SCompletionQueue* queue)
+{
+    SCompletion* completion = queue->head;
+    while (completion)
+    {
+        SCompletion* next = completion->next;
+        free(completion);
+        completion = next;
+    }
+    queue->head = NULL;
+}
+
+//------------------------------------------------------------------------------
+static void Post(SCompletionQueue* queue, SCompletion* completion)
+{
+    // nothing is ever popped on its own, so the head cannot come back after it was read (no ABA)
+    completion->next = __atomic_load_n(&queue->head, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(&queue->head, &completion->next, completion, HS_TRUE, __ATOMIC_RELEASE,
+        __ATOMIC_RELAXED))
+    {
+    }
+}
+
+//------------------------------------------------------------------------------
+void PostCompletion(SCompletionQueue* queue, int token, SScriptValue result)
+{
+    SCompletion* completion = malloc(sizeof(SCompletion));
+    completion->token = token;
+    completion->result = result;
+    completion->deferred = NULL;
+    Post(queue, completion);
+}
+
+//------------------------------------------------------------------------------
+void PostDeferredCompletion(SCompletionQueue* queue, int token, DeferredResult* deferred, void* data)
+{
+    SCompletion* completion = malloc(sizeof(SCompletion));
+    completion->token = token;
+    completion->result.i = 0;
+    completion->deferred = deferred;
+    completion->data = data;
+    Post(queue, completion);
+}
+
+//------------------------------------------------------------------------------
+int TakeCompletions(SCompletionQueue* queue, CompletionHandler* handler, void* data)
+{
+    SCompletion* completion = __atomic_exchange_n(&queue->head, NULL, __ATOMIC_ACQUIRE);
+
+    // the list is the last one posted first
+    SCompletion* first = NULL;
+    while (completion)
+    {
+        SCompletion* next = completion->next;
+        completion->next = first;
+        first = completion;
+        completion = next;
+    }
+
+    int count = 0;
+    while (first)
+    {
+        SCompletion* next = first->next;
+        handler(data, first->token, first->deferred ? first->deferred(first->data) : first->result);
+        free(first);
+        first = next;
+        ++count;
+    }
+    return count;
+}
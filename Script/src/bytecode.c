@@ -1,2 +1,53 @@
 #include "bytecode_c.h"
 
+// The VM lives in bytecode_c.h as C99 inline functions. Redeclaring them extern here
+// emits the one external definition used wherever a call is not inlined.
+extern inline SStackData CreateStack(int size);
+extern inline void AddInstruction(SStackData* instructionStack, EInstruction instruction);
+extern inline void DeleteStack(SStackData stackData);
+extern inline void InitVM(SVMData* vmData, SStackData instructionStack, int dataSize, FuncArray functions);
+extern inline void DeleteVM(SVMData* vmData, Bool8 keepInstructions, Bool8 keepFunctions);
+
+extern inline hsbint LoadInt(byte* pointer);
+extern inline hsbfloat LoadFloat(byte* pointer);
+extern inline hsbbool LoadBool(byte* pointer);
+extern inline hsbaddress LoadAddress(byte* pointer);
+extern inline void StoreInt(byte* pointer, hsbint value);
+extern inline void StoreFloat(byte* pointer, hsbfloat value);
+extern inline void StoreBool(byte* pointer, hsbbool value);
+extern inline void StoreAddress(byte* pointer, hsbaddress value);
+
+extern inline hsbint LoadIntFwd(byte** pointer);
+extern inline hsbfloat LoadFloatFwd(byte** pointer);
+extern inline hsbbool LoadBoolFwd(byte** pointer);
+extern inline void StoreIntFwd(byte** pointer, hsbint value);
+extern inline void StoreFloatFwd(byte** pointer, hsbfloat value);
+extern inline void StoreBoolFwd(byte** pointer, hsbbool value);
+
+#ifdef HS_SLOT_STACK
+extern inline SValue IntSlot(hsbint value);
+extern inline SValue FloatSlot(hsbfloat value);
+extern inline SValue BoolSlot(hsbbool value);
+extern inline SValue AddressSlot(hsbaddress value);
+#endif
+extern inline void PushInt(byte** pointer, hsbint value);
+extern inline void PushFloat(byte** pointer, hsbfloat value);
+extern inline void PushBool(byte** pointer, hsbbool value);
+extern inline hsbint PopInt(byte** pointer);
+extern inline hsbfloat PopFloat(byte** pointer);
+extern inline hsbbool PopBool(byte** pointer);
+extern inline hsbint LoadVarInt(byte* pointer);
+extern inline hsbfloat LoadVarFloat(byte* pointer);
+extern inline void StoreVarInt(byte* pointer, hsbint value);
+extern inline void StoreVarFloat(byte* pointer, hsbfloat value);
+#ifdef HS_SLOT_STACK
+extern inline int GetDataStackDepth(const SVMData* vmData);
+#endif
+
+extern inline void StoreAddressVar(byte** varPointer, hsbaddress address);
+extern inline hsbaddress LoadAddressVar(byte** varPointer);
+extern inline void SaveInsStackPointerVar(SVMData* vmData);
+extern inline void LoadInsStackPointerVar(SVMData* vmData);
+
+extern inline Bool8 VMProcessInstructions(SVMData* vmData, int count);
+extern inline Bool8 VMRunVerified(SVMData* vmData);
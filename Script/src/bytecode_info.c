@@ -0,0 +1,352 @@
+#include "bytecode_c.h"
+#include "bytecode_info.h"
+
+#include <stdio.h>
+
+//------------------------------------------------------------------------------
+const char* GetInstructionName(EInstruction instruction)
+{
+    switch (instruction)
+    {
+        case INS_NOOP: return "INS_NOOP";
+        case INS_ADD_I: return "INS_ADD_I";
+        case INS_ADD_F: return "INS_ADD_F";
+        case INS_SUBSTRACT_I: return "INS_SUBSTRACT_I";
+        case INS_SUBSTRACT_F: return "INS_SUBSTRACT_F";
+        case INS_MULTIPLY_I: return "INS_MULTIPLY_I";
+        case INS_MULTIPLY_F: return "INS_MULTIPLY_F";
+        case INS_DIVIDE_I: return "INS_DIVIDE_I";
+        case INS_DIVIDE_F: return "INS_DIVIDE_F";
+        case INS_LITERAL_I: return "INS_LITERAL_I";
+        case INS_LITERAL_F: return "INS_LITERAL_F";
+        case INS_LITERAL_B: return "INS_LITERAL_B";
+        case INS_NEGATE_B: return "INS_NEGATE_B";
+        case INS_AND_B: return "INS_AND_B";
+        case INS_OR_B: return "INS_OR_B";
+        case INS_CMP_I_EQ: return "INS_CMP_I_EQ";
+        case INS_CMP_I_LESS: return "INS_CMP_I_LESS";
+        case INS_CMP_I_LESS_EQ: return "INS_CMP_I_LESS_EQ";
+        case INS_CMP_F_EQ: return "INS_CMP_F_EQ";
+        case INS_CMP_F_LESS: return "INS_CMP_F_LESS";
+        case INS_CMP_F_LESS_EQ: return "INS_CMP_F_LESS_EQ";
+        case INS_ALLOC_VAR_I: return "INS_ALLOC_VAR_I";
+        case INS_ALLOC_VAR_F: return "INS_ALLOC_VAR_F";
+        case INS_DEALLOC_VAR_I: return "INS_DEALLOC_VAR_I";
+        case INS_DEALLOC_VAR_F: return "INS_DEALLOC_VAR_F";
+        case INS_SAVE_VAR_I: return "INS_SAVE_VAR_I";
+        case INS_SAVE_VAR_F: return "INS_SAVE_VAR_F";
+        case INS_LOAD_VAR_I: return "INS_LOAD_VAR_I";
+        case INS_LOAD_VAR_F: return "INS_LOAD_VAR_F";
+        case INS_JUMP: return "INS_JUMP";
+        case INS_COND_JUMP_B: return "INS_COND_JUMP_B";
+        case INS_CALL: return "INS_CALL";
+        case INS_RETURN: return "INS_RETURN";
+        case INS_CALL_EXT: return "INS_CALL_EXT";
+        case INS_END: return "INS_END";
+        case INS_LOAD_VAR_VAR_ADD_I: return "INS_LOAD_VAR_VAR_ADD_I";
+        case INS_LOAD_VAR_VAR_SUBSTRACT_I: return "INS_LOAD_VAR_VAR_SUBSTRACT_I";
+        case INS_LOAD_VAR_VAR_MULTIPLY_I: return "INS_LOAD_VAR_VAR_MULTIPLY_I";
+        case INS_ADD_LITERAL_I: return "INS_ADD_LITERAL_I";
+        case INS_SUBSTRACT_LITERAL_I: return "INS_SUBSTRACT_LITERAL_I";
+        case INS_MULTIPLY_LITERAL_I: return "INS_MULTIPLY_LITERAL_I";
+        case INS_CMP_I_EQ_JUMP: return "INS_CMP_I_EQ_JUMP";
+        case INS_CMP_I_LESS_JUMP: return "INS_CMP_I_LESS_JUMP";
+        case INS_CMP_I_LESS_EQ_JUMP: return "INS_CMP_I_LESS_EQ_JUMP";
+        case INS_MOVE_VAR_I: return "INS_MOVE_VAR_I";
+        case INS_MOVE_VAR_F: return "INS_MOVE_VAR_F";
+        case INS_ENTER: return "INS_ENTER";
+        case INS_LOAD_FRAME_I: return "INS_LOAD_FRAME_I";
+        case INS_LOAD_FRAME_F: return "INS_LOAD_FRAME_F";
+        case INS_SAVE_FRAME_I: return "INS_SAVE_FRAME_I";
+        case INS_SAVE_FRAME_F: return "INS_SAVE_FRAME_F";
+        case INS_LEAVE: return "INS_LEAVE";
+        case INS_LEAVE_I: return "INS_LEAVE_I";
+        case INS_LEAVE_F: return "INS_LEAVE_F";
+        case INS_TAIL_CALL: return "INS_TAIL_CALL";
+        case INS_SWITCH: return "INS_SWITCH";
+        case INS_YIELD: return "INS_YIELD";
+        case INS_CALL_ASYNC: return "INS_CALL_ASYNC";
+        default: return "ERROR_INVALID_INSTRUCTION";
+    }
+}
+
+//------------------------------------------------------------------------------
+int GetInstructionSize(EInstruction instruction)
+{
+    switch (instruction)
+    {
+        case INS_LITERAL_I:
+        case INS_ADD_LITERAL_I:
+        case INS_SUBSTRACT_LITERAL_I:
+        case INS_MULTIPLY_LITERAL_I:
+            return 1 + sizeof(hsbint);
+
+        case INS_LITERAL_F:
+            return 1 + sizeof(hsbfloat);
+
+        case INS_LITERAL_B:
+            return 1 + sizeof(hsbbool);
+
+        // variable offset
+        case INS_SAVE_VAR_I:
+        case INS_SAVE_VAR_F:
+        case INS_LOAD_VAR_I:
+        case INS_LOAD_VAR_F:
+            return 2;
+
+        // frame offset
+        case INS_LOAD_FRAME_I:
+        case INS_LOAD_FRAME_F:
+        case INS_SAVE_FRAME_I:
+        case INS_SAVE_FRAME_F:
+            return 2;
+
+        // argument size, int and float locals
+        case INS_ENTER:
+            return 4;
+
+        // index, argument count, float arguments, result type
+        case INS_CALL_EXT:
+        case INS_CALL_ASYNC:
+            return 5;
+
+        // two variable offsets
+        case INS_LOAD_VAR_VAR_ADD_I:
+        case INS_LOAD_VAR_VAR_SUBSTRACT_I:
+        case INS_LOAD_VAR_VAR_MULTIPLY_I:
+        case INS_MOVE_VAR_I:
+        case INS_MOVE_VAR_F:
+            return 3;
+
+        case INS_JUMP:
+        case INS_COND_JUMP_B:
+        case INS_CALL:
+        case INS_CMP_I_EQ_JUMP:
+        case INS_CMP_I_LESS_JUMP:
+        case INS_CMP_I_LESS_EQ_JUMP:
+            return 1 + sizeof(hsbaddress);
+
+        // address, argument size
+        case INS_TAIL_CALL:
+            return 2 + sizeof(hsbaddress);
+
+        // low, count, the jump table after it is made of INS_JUMP
+        case INS_SWITCH:
+            return 2 + sizeof(hsbint);
+
+        default:
+            return instruction < INS_COUNT ? 1 : 0;
+    }
+}
+
+//------------------------------------------------------------------------------
+Bool8 HasAddressOperand(EInstruction instruction)
+{
+    switch (instruction)
+    {
+        case INS_JUMP:
+        case INS_COND_JUMP_B:
+        case INS_CALL:
+        case INS_TAIL_CALL:
+        case INS_CMP_I_EQ_JUMP:
+        case INS_CMP_I_LESS_JUMP:
+        case INS_CMP_I_LESS_EQ_JUMP:
+            return HS_TRUE;
+        default:
+            return HS_FALSE;
+    }
+}
+
+//------------------------------------------------------------------------------
+void GetStackEffect(EInstruction instruction, int* outPopSize, int* outPushSize, int* outVarDelta)
+{
+    const int I = HS_DATA_SIZE_INT;
+    const int F = HS_DATA_SIZE_FLOAT;
+    const int B = HS_DATA_SIZE_BOOL;
+
+    int pop = 0;
+    int push = 0;
+    int vars = 0;
+    switch (instruction)
+    {
+        case INS_ADD_I:
+        case INS_SUBSTRACT_I:
+        case INS_MULTIPLY_I:
+        case INS_DIVIDE_I:
+            pop = 2 * I;
+            push = I;
+            break;
+        case INS_ADD_F:
+        case INS_SUBSTRACT_F:
+        case INS_MULTIPLY_F:
+        case INS_DIVIDE_F:
+            pop = 2 * F;
+            push = F;
+            break;
+
+        case INS_ADD_LITERAL_I:
+        case INS_SUBSTRACT_LITERAL_I:
+        case INS_MULTIPLY_LITERAL_I:
+            pop = I;
+            push = I;
+            break;
+
+        case INS_LITERAL_I:
+        case INS_LOAD_VAR_I:
+        case INS_LOAD_VAR_VAR_ADD_I:
+        case INS_LOAD_VAR_VAR_SUBSTRACT_I:
+        case INS_LOAD_VAR_VAR_MULTIPLY_I:
+        case INS_LOAD_FRAME_I:
+            push = I;
+            break;
+        case INS_LITERAL_F:
+        case INS_LOAD_VAR_F:
+        case INS_LOAD_FRAME_F:
+            push = F;
+            break;
+        case INS_LITERAL_B:
+            push = B;
+            break;
+
+        case INS_NEGATE_B:
+            pop = B;
+            push = B;
+            break;
+        case INS_AND_B:
+        case INS_OR_B:
+            pop = 2 * B;
+            push = B;
+            break;
+        case INS_COND_JUMP_B:
+            pop = B;
+            break;
+        case INS_SWITCH:
+            pop = I;
+            break;
+
+        case INS_CMP_I_EQ:
+        case INS_CMP_I_LESS:
+        case INS_CMP_I_LESS_EQ:
+            pop = 2 * I;
+            push = B;
+            break;
+        case INS_CMP_F_EQ:
+        case INS_CMP_F_LESS:
+        case INS_CMP_F_LESS_EQ:
+            pop = 2 * F;
+            push = B;
+            break;
+        case INS_CMP_I_EQ_JUMP:
+        case INS_CMP_I_LESS_JUMP:
+        case INS_CMP_I_LESS_EQ_JUMP:
+            pop = 2 * I;
+            break;
+
+        case INS_SAVE_VAR_I:
+        case INS_SAVE_FRAME_I:
+            pop = I;
+            break;
+        case INS_SAVE_VAR_F:
+        case INS_SAVE_FRAME_F:
+            pop = F;
+            break;
+
+        case INS_ALLOC_VAR_I:
+            vars = I;
+            break;
+        case INS_ALLOC_VAR_F:
+            vars = F;
+            break;
+        case INS_DEALLOC_VAR_I:
+            vars = -I;
+            break;
+        case INS_DEALLOC_VAR_F:
+            vars = -F;
+            break;
+
+        default:
+            break;
+    }
+
+    *outPopSize = pop;
+    *outPushSize = push;
+    *outVarDelta = vars;
+}
+
+//------------------------------------------------------------------------------
+void GetCallExtEffect(const byte* ins, int* outPopSize, int* outPushSize)
+{
+    int pop = 0;
+    for (int i = 0; i < ins[2]; ++i)
+        pop += ins[3] & 1 << i ? HS_DATA_SIZE_FLOAT : HS_DATA_SIZE_INT;
+
+    *outPopSize = pop;
+    switch (ins[4])
+    {
+        case NATIVE_INT: *outPushSize = HS_DATA_SIZE_INT; break;
+        case NATIVE_FLOAT: *outPushSize = HS_DATA_SIZE_FLOAT; break;
+        default: *outPushSize = 0; break;
+    }
+}
+
+//------------------------------------------------------------------------------
+void PrintInstructions(SStackData instructions)
+{
+    byte* ins = instructions.begin;
+    while (ins < instructions.end)
+    {
+        EInstruction instruction = *ins;
+        int size = GetInstructionSize(instruction);
+        printf("%5d  %s", (int)(ins - instructions.begin), GetInstructionName(instruction));
+
+        if (size == 0)
+        {
+            printf("\n");
+            return;
+        }
+
+        switch (instruction)
+        {
+            case INS_LITERAL_I:
+            case INS_ADD_LITERAL_I:
+            case INS_SUBSTRACT_LITERAL_I:
+            case INS_MULTIPLY_LITERAL_I:
+                printf(" %d", LoadInt(ins + 1));
+                break;
+            case INS_LITERAL_F:
+                printf(" %f", LoadFloat(ins + 1));
+                break;
+            case INS_LITERAL_B:
+                printf(" %d", LoadBool(ins + 1));
+                break;
+            case INS_ENTER:
+                printf(" %d %d %d", ins[1], ins[2], ins[3]);
+                break;
+            case INS_TAIL_CALL:
+                printf(" @%d %d", LoadAddress(ins + 1), ins[1 + sizeof(hsbaddress)]);
+                break;
+            case INS_SWITCH:
+                printf(" %d %d", LoadInt(ins + 1), ins[1 + sizeof(hsbint)]);
+                break;
+            case INS_CALL_EXT:
+            case INS_CALL_ASYNC:
+                printf(" #%d %d %d %d", ins[1], ins[2], ins[3], ins[4]);
+                break;
+            default:
+                if (HasAddressOperand(instruction))
+                {
+                    printf(" @%d", LoadAddress(ins + 1));
+                }
+                else
+                {
+                    // variable offsets
+                    for (int i = 1; i < size; ++i)
+                        printf(" [%d]", ins[i]);
+                }
+                break;
+        }
+        printf("\n");
+
+        ins += size;
+    }
+}
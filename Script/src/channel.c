@@ -0,0 +1,239 @@
+#include "channel.h"
+#include "bytecode_c.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+//------------------------------------------------------------------------------
+// A value can be sent into the cell at position p when its sequence is p, and received from it
+// when the sequence is p + 1. Receiving sets it to p + capacity for the next round.
+typedef struct
+{
+    unsigned sequence;
+    SScriptValue value;
+} SChannelCell;
+
+//------------------------------------------------------------------------------
+// The senders, the receiver and the wakeup change on their own, a cache line apart they do
+// not slow each other down
+struct SChannel
+{
+    SChannelCell* cells;
+    unsigned mask;
+    Bool8 isSingleSender;
+    SCompletionQueue* receiver;
+    int token;
+    byte padding0[64];
+
+    unsigned sendPosition;
+    byte padding1[64];
+
+    unsigned receivePosition;   // Only changed by the receiver
+    byte padding2[64];
+
+    int isWaiting;              // Set by a receiver that found the channel empty, cleared by who wakes it
+    byte padding3[64];
+};
+
+static SChannel* s_channels[HS_MAX_CHANNELS];
+
+//------------------------------------------------------------------------------
+int CreateChannel(int capacity, Bool8 isSingleSender, SCompletionQueue* receiver, int token)
+{
+    int handle = 0;
+    while (handle < HS_MAX_CHANNELS && s_channels[handle])
+        ++handle;
+    if (handle == HS_MAX_CHANNELS)
+    {
+        printf("ERROR: Too many channels\n");
+        return -1;
+    }
+
+    unsigned size = 1;
+    while (size < (unsigned)capacity)
+        size *= 2;
+
+    SChannel* channel = calloc(1, sizeof(SChannel));
+    channel->cells = malloc(size * sizeof(SChannelCell));
+    for (unsigned i = 0; i < size; ++i)
+        channel->cells[i].sequence = i;
+    channel->mask = size - 1;
+    channel->isSingleSender = isSingleSender;
+    channel->receiver = receiver;
+    channel->token = token;
+    s_channels[handle] = channel;
+    return handle;
+}
+
+//------------------------------------------------------------------------------
+void DeleteChannel(int channel)
+{
+    SChannel* c = GetChannel(channel);
+    if (!c)
+        return;
+
+    free(c->cells);
+    free(c);
+    s_channels[channel] = NULL;
+}
+
+//------------------------------------------------------------------------------
+SChannel* GetChannel(int channel)
+{
+    if (channel < 0 || channel >= HS_MAX_CHANNELS || !s_channels[channel])
+    {
+        printf("ERROR: Invalid channel handle %d\n", channel);
+        return NULL;
+    }
+    return s_channels[channel];
+}
+
+//------------------------------------------------------------------------------
+// DeferredResult of the completion that wakes the receiver. The sender that woke it wrote its
+// value before, but a sender that took an earlier cell can still be writing the oldest one.
+static SScriptValue TakeWaitingValue(void* data)
+{
+    SScriptValue value;
+    while (!ReceiveValue(data, &value))
+    {
+    }
+    return value;
+}
+
+//------------------------------------------------------------------------------
+Bool8 SendValue(SChannel* channel, SScriptValue value)
+{
+    unsigned position = __atomic_load_n(&channel->sendPosition, __ATOMIC_RELAXED);
+    SChannelCell* cell;
+    for (;;)
+    {
+        cell = &channel->cells[position & channel->mask];
+        int difference = (int)(__atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE) - position);
+        if (difference < 0)
+            return HS_FALSE;
+
+        if (channel->isSingleSender)
+        {
+            __atomic_store_n(&channel->sendPosition, position + 1, __ATOMIC_RELAXED);
+            break;
+        }
+        if (difference == 0 && __atomic_compare_exchange_n(&channel->sendPosition, &position, position + 1, HS_TRUE,
+            __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        {
+            break;
+        }
+        if (difference > 0)
+            position = __atomic_load_n(&channel->sendPosition, __ATOMIC_RELAXED);
+    }
+
+    cell->value = value;
+
+    // either this send sees the receiver waiting or the receiver sees the value after it set
+    // isWaiting, both are sequentially consistent
+    __atomic_store_n(&cell->sequence, position + 1, __ATOMIC_SEQ_CST);
+    int isWaiting = 1;
+    if (__atomic_load_n(&channel->isWaiting, __ATOMIC_SEQ_CST)
+        && __atomic_compare_exchange_n(&channel->isWaiting, &isWaiting, 0, HS_FALSE, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+    {
+        PostDeferredCompletion(channel->receiver, channel->token, TakeWaitingValue, channel);
+    }
+    return HS_TRUE;
+}
+
+//------------------------------------------------------------------------------
+static Bool8 IsReady(SChannel* channel)
+{
+    SChannelCell* cell = &channel->cells[channel->receivePosition & channel->mask];
+    return __atomic_load_n(&cell->sequence, __ATOMIC_SEQ_CST) == channel->receivePosition + 1;
+}
+
+//------------------------------------------------------------------------------
+Bool8 ReceiveValue(SChannel* channel, SScriptValue* outValue)
+{
+    unsigned position = channel->receivePosition;
+    SChannelCell* cell = &channel->cells[position & channel->mask];
+    if (__atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE) != position + 1)
+        return HS_FALSE;
+
+    *outValue = cell->value;
+    __atomic_store_n(&cell->sequence, position + channel->mask + 1, __ATOMIC_RELEASE);
+    channel->receivePosition = position + 1;
+    return HS_TRUE;
+}
+
+//------------------------------------------------------------------------------
+static void Send(SVMData* vmData, SScriptValue value)
+{
+    SChannel* channel = GetChannel(PopInt(&vmData->dataStack.base.stackPointer));
+    PushInt(&vmData->dataStack.base.stackPointer, channel && SendValue(channel, value));
+}
+
+//------------------------------------------------------------------------------
+// The value when there is one, the receiver waits for the next send otherwise
+static Bool8 Receive(SVMData* vmData, SScriptValue* outValue)
+{
+    SChannel* channel = GetChannel(PopInt(&vmData->dataStack.base.stackPointer));
+    if (!channel)
+    {
+        outValue->i = 0;
+        return HS_TRUE;
+    }
+    if (ReceiveValue(channel, outValue))
+        return HS_TRUE;
+
+    // a send after this sees isWaiting, a send before it left its value, which IsReady sees.
+    // Whoever clears isWaiting again delivers the value.
+    __atomic_store_n(&channel->isWaiting, 1, __ATOMIC_SEQ_CST);
+    int isWaiting = 1;
+    if (IsReady(channel)
+        && __atomic_compare_exchange_n(&channel->isWaiting, &isWaiting, 0, HS_FALSE, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+    {
+        return ReceiveValue(channel, outValue);
+    }
+
+    vmData->asyncCall = channel->token;
+    return HS_FALSE;
+}
+
+//------------------------------------------------------------------------------
+static void NativeSend(SVMData* vmData)
+{
+    SScriptValue value = { .i = PopInt(&vmData->dataStack.base.stackPointer) };
+    Send(vmData, value);
+}
+
+//------------------------------------------------------------------------------
+static void NativeSendFloat(SVMData* vmData)
+{
+    SScriptValue value = { .f = PopFloat(&vmData->dataStack.base.stackPointer) };
+    Send(vmData, value);
+}
+
+//------------------------------------------------------------------------------
+static void NativeReceive(SVMData* vmData)
+{
+    SScriptValue value;
+    if (Receive(vmData, &value))
+        PushInt(&vmData->dataStack.base.stackPointer, value.i);
+}
+
+//------------------------------------------------------------------------------
+static void NativeReceiveFloat(SVMData* vmData)
+{
+    SScriptValue value;
+    if (Receive(vmData, &value))
+        PushFloat(&vmData->dataStack.base.stackPointer, value.f);
+}
+
+//------------------------------------------------------------------------------
+EResult RegisterChannelNatives(SNativeTable* table)
+{
+    if (RegisterNative(table, "send", "int(int, int)", NativeSend) != R_OK
+        || RegisterNative(table, "sendFloat", "int(int, float)", NativeSendFloat) != R_OK
+        || RegisterAsyncNative(table, "receive", "int(int)", NativeReceive) != R_OK
+        || RegisterAsyncNative(table, "receiveFloat", "float(int)", NativeReceiveFloat) != R_OK)
+    {
+        return R_ERROR;
+    }
+    return R_OK;
+}
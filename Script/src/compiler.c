@@ -0,0 +1,1173 @@
+#include "compiler.h"
+#include "bytecode_c.h"
+#include "tokenizer.h"
+#include "ir.h"
+#include "line_table.h"
+#include "optimizer.h"
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <assert.h>
+
+//------------------------------------------------------------------------------
+typedef enum
+{
+    VT_INT,
+    VT_FLOAT,
+    VT_BOOL,
+} EValueType;
+
+//------------------------------------------------------------------------------
+typedef struct
+{
+    const char* name;
+    EValueType type;
+    int position; // Size of the variable area right after the variable was allocated, the offset from the frame pointer of a parameter
+    Bool8 isParameter;
+} SVariable;
+
+//------------------------------------------------------------------------------
+typedef struct
+{
+    // Bytecode being emitted
+    byte* code;
+    int size;
+    int capacity;
+
+    // Variables in scope, the innermost last
+    SVariable variables[256];
+    int variableCount;
+    int varSize; // Bytes allocated in the variable area at the current instruction
+
+    // Position of the node being compiled, instructions are added to the line table with it
+    SSourcePosition position;
+    SLineTable* lines; // NULL when not wanted
+
+    const SNativeTable* natives; // Functions the code can call, NULL for none
+
+    // Functions of the program, calls are patched with their entries once all are compiled
+    SScriptFunction* functions;
+    int functionCount;
+    int* callPositions;
+    int* callTargets;
+    int callCount;
+    int callCapacity;
+
+    // Function being compiled, -1 in the main program
+    int function;
+    int functionVariables; // Index of its first variable after the parameters
+
+    EResult result;
+} SCompilerState;
+
+//------------------------------------------------------------------------------
+static void Error(SCompilerState* s, const char* format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    printf("ERROR: ");
+    vprintf(format, args);
+    printf("\n");
+    va_end(args);
+
+    s->result = R_ERROR;
+}
+
+//------------------------------------------------------------------------------
+static void EmitBytes(SCompilerState* s, const void* bytes, int size)
+{
+    if (s->size + size > s->capacity)
+    {
+        while (s->size + size > s->capacity)
+            s->capacity *= 2;
+        s->code = realloc(s->code, s->capacity);
+    }
+
+    memcpy(s->code + s->size, bytes, size);
+    s->size += size;
+}
+
+//------------------------------------------------------------------------------
+static void EmitInstruction(SCompilerState* s, EInstruction instruction)
+{
+    if (s->lines)
+        AddLineEntry(s->lines, s->size, s->position);
+
+    byte b = instruction;
+    EmitBytes(s, &b, 1);
+}
+
+//------------------------------------------------------------------------------
+static void EmitOffset(SCompilerState* s, EInstruction instruction, int offset)
+{
+    if (offset > 255)
+    {
+        Error(s, "Too many variables in scope");
+        return;
+    }
+
+    byte operand = offset;
+    EmitInstruction(s, instruction);
+    EmitBytes(s, &operand, 1);
+}
+
+//------------------------------------------------------------------------------
+// Returns position of the address operand for PatchAddress
+static int EmitJump(SCompilerState* s, EInstruction instruction, int address)
+{
+    EmitInstruction(s, instruction);
+    int position = s->size;
+    hsbaddress operand = address;
+    EmitBytes(s, &operand, sizeof(hsbaddress));
+    return position;
+}
+
+//------------------------------------------------------------------------------
+static void PatchAddress(SCompilerState* s, int position, int address)
+{
+    StoreAddress(s->code + position, address);
+}
+
+//------------------------------------------------------------------------------
+static SVariable* FindVariable(SCompilerState* s, const char* name)
+{
+    for (int i = s->variableCount - 1; i >= 0; --i)
+    {
+        if (strcmp(s->variables[i].name, name) == 0)
+            return &s->variables[i];
+    }
+
+    Error(s, "Undeclared variable '%s'", name);
+    return NULL;
+}
+
+//------------------------------------------------------------------------------
+static int VariableOffset(SCompilerState* s, SVariable* var)
+{
+    return s->varSize - var->position;
+}
+
+//------------------------------------------------------------------------------
+static void EmitLoad(SCompilerState* s, SVariable* var)
+{
+    if (var->isParameter)
+        EmitOffset(s, var->type == VT_INT ? INS_LOAD_FRAME_I : INS_LOAD_FRAME_F, var->position);
+    else
+        EmitOffset(s, var->type == VT_INT ? INS_LOAD_VAR_I : INS_LOAD_VAR_F, VariableOffset(s, var));
+}
+
+//------------------------------------------------------------------------------
+static void EmitSave(SCompilerState* s, SVariable* var)
+{
+    if (var->isParameter)
+        EmitOffset(s, var->type == VT_INT ? INS_SAVE_FRAME_I : INS_SAVE_FRAME_F, var->position);
+    else
+        EmitOffset(s, var->type == VT_INT ? INS_SAVE_VAR_I : INS_SAVE_VAR_F, VariableOffset(s, var));
+}
+
+//------------------------------------------------------------------------------
+static void EmitIntLiteral(SCompilerState* s, int value)
+{
+    if (value < INT16_MIN || value > INT16_MAX)
+    {
+        Error(s, "Integer literal %d out of range", value);
+        return;
+    }
+
+    hsbint operand = value;
+    EmitInstruction(s, INS_LITERAL_I);
+    EmitBytes(s, &operand, sizeof(hsbint));
+}
+
+//------------------------------------------------------------------------------
+static void EmitFloatLiteral(SCompilerState* s, float value)
+{
+    hsbfloat operand = value;
+    EmitInstruction(s, INS_LITERAL_F);
+    EmitBytes(s, &operand, sizeof(hsbfloat));
+}
+
+//------------------------------------------------------------------------------
+static EValueType CompileExpr(SCompilerState* s, SASTNode* node);
+
+//------------------------------------------------------------------------------
+static EValueType CompileAssign(SCompilerState* s, SASTNode* node, Bool8 keepValue)
+{
+    EValueType type = CompileExpr(s, node->assign.assign);
+    SVariable* var = FindVariable(s, node->assign.var->name);
+    if (!var)
+        return type;
+
+    if (var->type != type)
+    {
+        Error(s, "Type mismatch in assignment to '%s'", var->name);
+        return type;
+    }
+
+    EmitSave(s, var);
+    if (keepValue)
+        EmitLoad(s, var);
+
+    return type;
+}
+
+//------------------------------------------------------------------------------
+static EValueType CompileLiteral(SCompilerState* s, SToken* token)
+{
+    switch (token->type)
+    {
+        case TOKEN_INTEGER:
+        {
+            EmitIntLiteral(s, token->intNum);
+            return VT_INT;
+        }
+        case TOKEN_FLOAT:
+        {
+            EmitFloatLiteral(s, token->floatNum);
+            return VT_FLOAT;
+        }
+        case TOKEN_IDENTIFIER:
+        {
+            SVariable* var = FindVariable(s, token->name);
+            if (!var)
+                return VT_INT;
+
+            EmitLoad(s, var);
+            return var->type;
+        }
+        default: assert(0); return VT_INT;
+    }
+}
+
+//------------------------------------------------------------------------------
+static EValueType CompileUnary(SCompilerState* s, SASTNode* node)
+{
+    assert(node->unary.op->type == TOKEN_MINUS);
+
+    // Negative literals are emitted directly
+    SASTNode* right = node->unary.right;
+    if (right->type == ANT_LITERAL && right->literal.token->type == TOKEN_INTEGER)
+    {
+        EmitIntLiteral(s, -right->literal.token->intNum);
+        return VT_INT;
+    }
+    if (right->type == ANT_LITERAL && right->literal.token->type == TOKEN_FLOAT)
+    {
+        EmitFloatLiteral(s, -right->literal.token->floatNum);
+        return VT_FLOAT;
+    }
+
+    // value * -1
+    EValueType type = CompileExpr(s, right);
+    if (type == VT_INT)
+    {
+        EmitIntLiteral(s, -1);
+        EmitInstruction(s, INS_MULTIPLY_I);
+    }
+    else if (type == VT_FLOAT)
+    {
+        EmitFloatLiteral(s, -1.0f);
+        EmitInstruction(s, INS_MULTIPLY_F);
+    }
+    else
+    {
+        Error(s, "Cannot negate a bool");
+    }
+
+    return type;
+}
+
+//------------------------------------------------------------------------------
+static EValueType CompileBinary(SCompilerState* s, SASTNode* node)
+{
+    EValueType left = CompileExpr(s, node->binary.left);
+    EValueType right = CompileExpr(s, node->binary.right);
+
+    if (left != right || left == VT_BOOL)
+    {
+        Error(s, "Invalid operand types of a binary operator");
+        return left;
+    }
+
+    Bool8 isInt = left == VT_INT;
+    switch (node->binary.op->type)
+    {
+        case TOKEN_PLUS: EmitInstruction(s, isInt ? INS_ADD_I : INS_ADD_F); return left;
+        case TOKEN_MINUS: EmitInstruction(s, isInt ? INS_SUBSTRACT_I : INS_SUBSTRACT_F); return left;
+        case TOKEN_STAR: EmitInstruction(s, isInt ? INS_MULTIPLY_I : INS_MULTIPLY_F); return left;
+        case TOKEN_SLASH: EmitInstruction(s, isInt ? INS_DIVIDE_I : INS_DIVIDE_F); return left;
+
+        case TOKEN_EQUAL_EQUAL:
+            EmitInstruction(s, isInt ? INS_CMP_I_EQ : INS_CMP_F_EQ);
+            return VT_BOOL;
+        case TOKEN_LESS:
+            EmitInstruction(s, isInt ? INS_CMP_I_LESS : INS_CMP_F_LESS);
+            return VT_BOOL;
+        case TOKEN_LESS_EQUAL:
+            EmitInstruction(s, isInt ? INS_CMP_I_LESS_EQ : INS_CMP_F_LESS_EQ);
+            return VT_BOOL;
+
+        // Negated forms of the above
+        case TOKEN_NOT_EQUAL:
+            EmitInstruction(s, isInt ? INS_CMP_I_EQ : INS_CMP_F_EQ);
+            EmitInstruction(s, INS_NEGATE_B);
+            return VT_BOOL;
+        case TOKEN_GREATER_EQUAL:
+            EmitInstruction(s, isInt ? INS_CMP_I_LESS : INS_CMP_F_LESS);
+            EmitInstruction(s, INS_NEGATE_B);
+            return VT_BOOL;
+        case TOKEN_GREATER:
+            EmitInstruction(s, isInt ? INS_CMP_I_LESS_EQ : INS_CMP_F_LESS_EQ);
+            EmitInstruction(s, INS_NEGATE_B);
+            return VT_BOOL;
+
+        default: assert(0); return left;
+    }
+}
+
+//------------------------------------------------------------------------------
+static int FindFunction(SCompilerState* s, const char* name)
+{
+    for (int i = 0; i < s->functionCount; ++i)
+    {
+        if (strcmp(s->functions[i].name, name) == 0)
+            return i;
+    }
+    return -1;
+}
+
+//------------------------------------------------------------------------------
+// The arguments in the order written, then INS_CALL to a function of the program, patched once
+// it is compiled, or INS_CALL_EXT with the index and the signature of the native, INS_CALL_ASYNC
+// for an async one. Only a call without a result can be a statement, there is no instruction
+// to drop it.
+static EValueType CompileCall(SCompilerState* s, SASTNode* node, Bool8 isStatement)
+{
+    const char* name = node->call.name->name;
+    int function = FindFunction(s, name);
+    int index = function < 0 && s->natives ? FindNative(s->natives, name) : -1;
+    if (function < 0 && index < 0)
+    {
+        Error(s, "Unknown function '%s'", name);
+        return VT_INT;
+    }
+
+    SNativeSignature signature = function >= 0 ? s->functions[function].signature : s->natives->natives[index].signature;
+    int argumentCount = 0;
+    for (SASTNode* argument = node->call.arguments; argument; argument = argument->argument.next)
+    {
+        EValueType type = CompileExpr(s, argument->argument.value);
+        EValueType expected = signature.floatArguments & 1 << argumentCount ? VT_FLOAT : VT_INT;
+        if (argumentCount < signature.argumentCount && type != expected)
+            Error(s, "Argument %d of '%s' has a different type", argumentCount + 1, name);
+        ++argumentCount;
+    }
+    if (argumentCount != signature.argumentCount)
+    {
+        Error(s, "'%s' takes %d arguments, not %d", name, signature.argumentCount, argumentCount);
+        return VT_INT;
+    }
+
+    if (function >= 0)
+    {
+        if (s->callCount == s->callCapacity)
+        {
+            s->callCapacity = s->callCapacity ? s->callCapacity * 2 : 16;
+            s->callPositions = realloc(s->callPositions, s->callCapacity * sizeof(int));
+            s->callTargets = realloc(s->callTargets, s->callCapacity * sizeof(int));
+        }
+        s->callPositions[s->callCount] = EmitJump(s, INS_CALL, 0);
+        s->callTargets[s->callCount++] = function;
+    }
+    else
+    {
+        byte operands[] = { index, signature.argumentCount, signature.floatArguments, signature.result };
+        EmitInstruction(s, s->natives->natives[index].isAsync ? INS_CALL_ASYNC : INS_CALL_EXT);
+        EmitBytes(s, operands, sizeof(operands));
+    }
+
+    if (isStatement && signature.result != NATIVE_NONE)
+        Error(s, "Result of '%s' is not used", name);
+    else if (!isStatement && signature.result == NATIVE_NONE)
+        Error(s, "'%s' has no result", name);
+    return signature.result == NATIVE_FLOAT ? VT_FLOAT : VT_INT;
+}
+
+//------------------------------------------------------------------------------
+// Instructions of the node get its position, the ones after it the position from before
+static SSourcePosition EnterNode(SCompilerState* s, SASTNode* node)
+{
+    SSourcePosition position = s->position;
+    s->position = node->position;
+    return position;
+}
+
+//------------------------------------------------------------------------------
+static EValueType CompileExpr(SCompilerState* s, SASTNode* node)
+{
+    SSourcePosition position = EnterNode(s, node);
+    EValueType type;
+    switch (node->type)
+    {
+        case ANT_ASSIGN: type = CompileAssign(s, node, HS_TRUE); break;
+        case ANT_LITERAL: type = CompileLiteral(s, node->literal.token); break;
+        case ANT_UNARY_OP: type = CompileUnary(s, node); break;
+        case ANT_BINARY_OP: type = CompileBinary(s, node); break;
+        case ANT_CALL: type = CompileCall(s, node, HS_FALSE); break;
+        default: assert(0); type = VT_INT; break;
+    }
+
+    s->position = position;
+    return type;
+}
+
+//------------------------------------------------------------------------------
+static void CompileCondition(SCompilerState* s, SASTNode* node)
+{
+    if (CompileExpr(s, node) != VT_BOOL)
+        Error(s, "Condition has to be a bool");
+}
+
+//------------------------------------------------------------------------------
+static void CompileDeclaration(SCompilerState* s, SASTNode* node);
+
+//------------------------------------------------------------------------------
+static void CompileStatement(SCompilerState* s, SASTNode* node);
+
+//------------------------------------------------------------------------------
+// Up to this many cases are compared one by one, a jump table needs at least every second
+// value of its range to be a case
+#define SWITCH_CHAIN_MAX 3
+#define SWITCH_TABLE_MAX 255
+
+//------------------------------------------------------------------------------
+typedef struct
+{
+    int value;
+    int target; // Index of the case whose body runs, -1 for the end of the switch
+} SSwitchCase;
+
+//------------------------------------------------------------------------------
+// Jumps to the bodies emitted before the bodies themselves
+typedef struct
+{
+    int* positions;
+    int* targets;
+    int count;
+} SSwitchJumps;
+
+//------------------------------------------------------------------------------
+static void EmitCaseJump(SCompilerState* s, SSwitchJumps* jumps, EInstruction instruction, int target)
+{
+    jumps->positions[jumps->count] = EmitJump(s, instruction, 0);
+    jumps->targets[jumps->count++] = target;
+}
+
+//------------------------------------------------------------------------------
+static int CompareSwitchCases(const void* a, const void* b)
+{
+    // the values are not checked against hsbint yet, a difference could overflow
+    int first = ((const SSwitchCase*)a)->value;
+    int second = ((const SSwitchCase*)b)->value;
+    return (first > second) - (first < second);
+}
+
+//------------------------------------------------------------------------------
+// Binary search over the sorted cases on the value in the variable at the top of the
+// variable area, small ranges are compared one by one
+static void EmitCaseSearch(SCompilerState* s, SSwitchJumps* jumps, const SSwitchCase* cases, int first, int last, int defaultTarget)
+{
+    if (last - first < SWITCH_CHAIN_MAX)
+    {
+        for (int i = first; i <= last; ++i)
+        {
+            EmitOffset(s, INS_LOAD_VAR_I, 0);
+            EmitIntLiteral(s, cases[i].value);
+            EmitInstruction(s, INS_CMP_I_EQ);
+            EmitCaseJump(s, jumps, INS_COND_JUMP_B, cases[i].target);
+        }
+        EmitCaseJump(s, jumps, INS_JUMP, defaultTarget);
+        return;
+    }
+
+    int middle = (first + last + 1) / 2;
+    EmitOffset(s, INS_LOAD_VAR_I, 0);
+    EmitIntLiteral(s, cases[middle].value);
+    EmitInstruction(s, INS_CMP_I_LESS);
+    int lowerJump = EmitJump(s, INS_COND_JUMP_B, 0);
+
+    EmitCaseSearch(s, jumps, cases, middle, last, defaultTarget);
+    PatchAddress(s, lowerJump, s->size);
+    EmitCaseSearch(s, jumps, cases, first, middle - 1, defaultTarget);
+}
+
+//------------------------------------------------------------------------------
+// Dense cases dispatch through an INS_SWITCH jump table, sparse ones by binary search and
+// a few by comparing them in turn. Each body ends the switch, there is no fall through.
+static void CompileSwitch(SCompilerState* s, SASTNode* node)
+{
+    int caseCount = 0;
+    for (SASTNode* c = node->stmt.switchStmt.cases; c; c = c->switchCase.next)
+        ++caseCount;
+
+    SASTNode** caseNodes = malloc((caseCount + 1) * sizeof(SASTNode*));
+    SSwitchCase* cases = malloc((caseCount + 1) * sizeof(SSwitchCase));
+    int* bodyAddresses = malloc((caseCount + 1) * sizeof(int));
+    int index = 0;
+    for (SASTNode* c = node->stmt.switchStmt.cases; c; c = c->switchCase.next)
+        caseNodes[index++] = c;
+
+    // A case without a body runs the next one
+    int defaultTarget = -1;
+    int defaultCount = 0;
+    int valueCount = 0;
+    for (int i = caseCount - 1, target = -1; i >= 0; --i)
+    {
+        target = caseNodes[i]->switchCase.body ? i : target;
+        if (caseNodes[i]->switchCase.isDefault)
+        {
+            defaultTarget = target;
+            ++defaultCount;
+        }
+        else
+        {
+            cases[valueCount++] = (SSwitchCase){ .value = caseNodes[i]->switchCase.value, .target = target };
+        }
+    }
+    if (defaultCount > 1)
+        Error(s, "Switch has more than one default");
+
+    qsort(cases, valueCount, sizeof(SSwitchCase), CompareSwitchCases);
+    for (int i = 0; i < valueCount; ++i)
+    {
+        if (cases[i].value < INT16_MIN || cases[i].value > INT16_MAX)
+            Error(s, "Integer literal %d out of range", cases[i].value);
+        else if (i > 0 && cases[i].value == cases[i - 1].value)
+            Error(s, "Duplicate case value %d", cases[i].value);
+    }
+
+    long long span = valueCount > 0 ? (long long)cases[valueCount - 1].value - cases[0].value + 1 : 0;
+    Bool8 isTable = valueCount > SWITCH_CHAIN_MAX && span <= 2 * valueCount && span <= SWITCH_TABLE_MAX;
+    int range = isTable ? (int)span : 0;
+    SSwitchJumps jumps = { .count = 0 };
+    jumps.positions = malloc((2 * valueCount + range + caseCount + 2) * sizeof(int));
+    jumps.targets = malloc((2 * valueCount + range + caseCount + 2) * sizeof(int));
+
+    if (isTable)
+    {
+        if (CompileExpr(s, node->stmt.switchStmt.value) != VT_INT)
+            Error(s, "Switch value has to be an int");
+
+        hsbint low = cases[0].value;
+        byte count = range;
+        EmitInstruction(s, INS_SWITCH);
+        EmitBytes(s, &low, sizeof(hsbint));
+        EmitBytes(s, &count, 1);
+
+        EmitCaseJump(s, &jumps, INS_JUMP, defaultTarget);
+        for (int i = 0, value = low; value < low + range; ++value)
+            EmitCaseJump(s, &jumps, INS_JUMP, cases[i].value == value ? cases[i++].target : defaultTarget);
+    }
+    else
+    {
+        // The value is kept in a variable without a name for the compares, a return in a body
+        // deallocates it with the named ones
+        EmitInstruction(s, INS_ALLOC_VAR_I);
+        s->varSize += HS_DATA_SIZE_INT;
+        if (s->variableCount == sizeof(s->variables) / sizeof(s->variables[0]))
+            Error(s, "Too many variables in scope");
+        else
+            s->variables[s->variableCount++] = (SVariable){ .name = "", .type = VT_INT, .position = s->varSize };
+        if (CompileExpr(s, node->stmt.switchStmt.value) != VT_INT)
+            Error(s, "Switch value has to be an int");
+        EmitOffset(s, INS_SAVE_VAR_I, 0);
+
+        if (valueCount > 0)
+            EmitCaseSearch(s, &jumps, cases, 0, valueCount - 1, defaultTarget);
+        else
+            EmitCaseJump(s, &jumps, INS_JUMP, defaultTarget);
+    }
+
+    // Bodies in the order written, each but the last jumps to the end
+    int lastBody = -1;
+    for (int i = 0; i < caseCount; ++i)
+        lastBody = caseNodes[i]->switchCase.body ? i : lastBody;
+    for (int i = 0; i < caseCount; ++i)
+    {
+        if (!caseNodes[i]->switchCase.body)
+            continue;
+
+        bodyAddresses[i] = s->size;
+        CompileStatement(s, caseNodes[i]->switchCase.body);
+        if (i != lastBody)
+            EmitCaseJump(s, &jumps, INS_JUMP, -1);
+    }
+
+    for (int i = 0; i < jumps.count; ++i)
+        PatchAddress(s, jumps.positions[i], jumps.targets[i] >= 0 ? bodyAddresses[jumps.targets[i]] : s->size);
+
+    if (!isTable)
+    {
+        EmitInstruction(s, INS_DEALLOC_VAR_I);
+        s->varSize -= HS_DATA_SIZE_INT;
+        --s->variableCount;
+    }
+
+    free(jumps.targets);
+    free(jumps.positions);
+    free(bodyAddresses);
+    free(cases);
+    free(caseNodes);
+}
+
+//------------------------------------------------------------------------------
+// The value is left on the operand stack, the variables of the function are deallocated and
+// the frame takes the value in place of the arguments
+static void CompileReturn(SCompilerState* s, SASTNode* node)
+{
+    if (s->function < 0)
+    {
+        Error(s, "Return outside of a function");
+        return;
+    }
+
+    const char* name = s->functions[s->function].name;
+    ENativeType result = s->functions[s->function].signature.result;
+    if (node->stmt.expr)
+    {
+        EValueType type = CompileExpr(s, node->stmt.expr);
+        if (result == NATIVE_NONE)
+            Error(s, "'%s' has no result to return", name);
+        else if (type != (result == NATIVE_FLOAT ? VT_FLOAT : VT_INT))
+            Error(s, "Type mismatch in return of '%s'", name);
+    }
+    else if (result != NATIVE_NONE)
+    {
+        Error(s, "'%s' has to return a value", name);
+    }
+
+    // The scopes stay as they are for the code after the return
+    for (int i = s->variableCount - 1; i >= s->functionVariables; --i)
+        EmitInstruction(s, s->variables[i].type == VT_INT ? INS_DEALLOC_VAR_I : INS_DEALLOC_VAR_F);
+
+    EmitInstruction(s, result == NATIVE_INT ? INS_LEAVE_I : result == NATIVE_FLOAT ? INS_LEAVE_F : INS_LEAVE);
+}
+
+//------------------------------------------------------------------------------
+static void CompileStatement(SCompilerState* s, SASTNode* node)
+{
+    SSourcePosition position = EnterNode(s, node);
+    switch (node->type)
+    {
+        case ANT_EXPR_STMT:
+        {
+            // There is no instruction to drop a value, only assignments and calls can be statements
+            if (node->stmt.expr->type == ANT_CALL)
+            {
+                CompileCall(s, node->stmt.expr, HS_TRUE);
+                break;
+            }
+            if (node->stmt.expr->type != ANT_ASSIGN)
+            {
+                Error(s, "Expression statement has no effect");
+                break;
+            }
+            CompileAssign(s, node->stmt.expr, HS_FALSE);
+            break;
+        }
+        case ANT_BLOCK:
+        {
+            int variableCount = s->variableCount;
+
+            for (SASTNode* child = node->stmt.block; child; child = child->decl.sibling)
+                CompileDeclaration(s, child);
+
+            // Free the block variables
+            while (s->variableCount > variableCount)
+            {
+                SVariable* var = &s->variables[--s->variableCount];
+                if (var->type == VT_INT)
+                {
+                    EmitInstruction(s, INS_DEALLOC_VAR_I);
+                    s->varSize -= HS_DATA_SIZE_INT;
+                }
+                else
+                {
+                    EmitInstruction(s, INS_DEALLOC_VAR_F);
+                    s->varSize -= HS_DATA_SIZE_FLOAT;
+                }
+            }
+            break;
+        }
+        case ANT_IF:
+        {
+            CompileCondition(s, node->stmt.ifStmt.cond);
+            EmitInstruction(s, INS_NEGATE_B);
+            int elseJump = EmitJump(s, INS_COND_JUMP_B, 0);
+
+            CompileStatement(s, node->stmt.ifStmt.then);
+
+            if (node->stmt.ifStmt.otherwise)
+            {
+                int endJump = EmitJump(s, INS_JUMP, 0);
+                PatchAddress(s, elseJump, s->size);
+                CompileStatement(s, node->stmt.ifStmt.otherwise);
+                PatchAddress(s, endJump, s->size);
+            }
+            else
+            {
+                PatchAddress(s, elseJump, s->size);
+            }
+            break;
+        }
+        case ANT_WHILE:
+        {
+            // The condition is at the bottom so each iteration takes a single conditional jump
+            int condJump = EmitJump(s, INS_JUMP, 0);
+            int bodyAddress = s->size;
+            CompileStatement(s, node->stmt.whileStmt.body);
+
+            PatchAddress(s, condJump, s->size);
+            CompileCondition(s, node->stmt.whileStmt.cond);
+            EmitJump(s, INS_COND_JUMP_B, bodyAddress);
+            break;
+        }
+        case ANT_SWITCH: CompileSwitch(s, node); break;
+        case ANT_RETURN: CompileReturn(s, node); break;
+        case ANT_YIELD: EmitInstruction(s, INS_YIELD); break;
+        default: assert(0); break;
+    }
+
+    s->position = position;
+}
+
+//------------------------------------------------------------------------------
+static void CompileVariableDeclaration(SCompilerState* s, SASTNode* node)
+{
+    const char* typeName = node->declVar.type->name;
+    EValueType type;
+    if (strcmp(typeName, "int") == 0)
+    {
+        type = VT_INT;
+        EmitInstruction(s, INS_ALLOC_VAR_I);
+        s->varSize += HS_DATA_SIZE_INT;
+    }
+    else if (strcmp(typeName, "float") == 0)
+    {
+        type = VT_FLOAT;
+        EmitInstruction(s, INS_ALLOC_VAR_F);
+        s->varSize += HS_DATA_SIZE_FLOAT;
+    }
+    else
+    {
+        Error(s, "Unknown type '%s'", typeName);
+        return;
+    }
+
+    if (s->variableCount == sizeof(s->variables) / sizeof(s->variables[0]))
+    {
+        Error(s, "Too many variables in scope");
+        return;
+    }
+
+    // The variable is in scope only after its initializer
+    if (node->declVar.initExpr)
+    {
+        if (CompileExpr(s, node->declVar.initExpr) != type)
+            Error(s, "Type mismatch in initialization of '%s'", node->declVar.name->name);
+        EmitOffset(s, type == VT_INT ? INS_SAVE_VAR_I : INS_SAVE_VAR_F, 0);
+    }
+
+    s->variables[s->variableCount++] = (SVariable)
+    {
+        .name = node->declVar.name->name,
+        .type = type,
+        .position = s->varSize,
+    };
+}
+
+//------------------------------------------------------------------------------
+static void CompileDeclaration(SCompilerState* s, SASTNode* node)
+{
+    SSourcePosition position = EnterNode(s, node);
+    switch (node->type)
+    {
+        case ANT_DECL_VAR: CompileVariableDeclaration(s, node->decl.declVar); break;
+        case ANT_DECL_STMT: CompileStatement(s, node->decl.stmt); break;
+        case ANT_DECL_FUNC: Error(s, "Function '%s' is not at the top level", node->decl.declFunc->declFunc.name->name); break;
+        default: assert(0); break;
+    }
+
+    s->position = position;
+}
+
+//------------------------------------------------------------------------------
+static Bool8 ParseValueType(SCompilerState* s, const char* typeName, ENativeType* outType)
+{
+    if (strcmp(typeName, "int") == 0)
+    {
+        *outType = NATIVE_INT;
+        return HS_TRUE;
+    }
+    if (strcmp(typeName, "float") == 0)
+    {
+        *outType = NATIVE_FLOAT;
+        return HS_TRUE;
+    }
+
+    Error(s, "Unknown type '%s'", typeName);
+    return HS_FALSE;
+}
+
+//------------------------------------------------------------------------------
+// The functions of the program are known before any code is compiled, so they can be called
+// before they are declared and call each other
+static void DeclareFunctions(SCompilerState* s, SASTNode* root)
+{
+    int count = 0;
+    for (SASTNode* child = root->programChild; child; child = child->decl.sibling)
+        count += child->type == ANT_DECL_FUNC;
+    s->functions = malloc((count > 0 ? count : 1) * sizeof(SScriptFunction));
+
+    for (SASTNode* child = root->programChild; child; child = child->decl.sibling)
+    {
+        if (child->type != ANT_DECL_FUNC)
+            continue;
+
+        SASTNode* node = child->decl.declFunc;
+        const char* name = node->declFunc.name->name;
+        s->position = node->position;
+        if (FindFunction(s, name) >= 0)
+            Error(s, "Function '%s' is already declared", name);
+        else if (s->natives && FindNative(s->natives, name) >= 0)
+            Error(s, "Function '%s' is already a native", name);
+
+        SNativeSignature signature = { 0 };
+        for (SASTNode* parameter = node->declFunc.parameters; parameter; parameter = parameter->parameter.next)
+        {
+            ENativeType type;
+            if (signature.argumentCount == HS_NATIVE_MAX_ARGUMENTS)
+            {
+                Error(s, "'%s' has more than %d parameters", name, HS_NATIVE_MAX_ARGUMENTS);
+                break;
+            }
+            if (!ParseValueType(s, parameter->parameter.type->name, &type))
+                break;
+            if (type == NATIVE_FLOAT)
+                signature.floatArguments |= 1 << signature.argumentCount;
+            ++signature.argumentCount;
+        }
+
+        ENativeType result = NATIVE_NONE;
+        if (node->declFunc.resultType)
+            ParseValueType(s, node->declFunc.resultType->name, &result);
+        signature.result = result;
+
+        s->functions[s->functionCount++] = (SScriptFunction){ .name = (char*)name, .entry = 0, .signature = signature };
+    }
+    s->position = root->position;
+}
+
+//------------------------------------------------------------------------------
+static Bool8 AlwaysReturns(SASTNode* node)
+{
+    switch (node->type)
+    {
+        case ANT_RETURN: return HS_TRUE;
+        case ANT_BLOCK:
+        {
+            for (SASTNode* child = node->stmt.block; child; child = child->decl.sibling)
+            {
+                if (child->type == ANT_DECL_STMT && AlwaysReturns(child->decl.stmt))
+                    return HS_TRUE;
+            }
+            return HS_FALSE;
+        }
+        case ANT_IF:
+            return node->stmt.ifStmt.otherwise && AlwaysReturns(node->stmt.ifStmt.then)
+                && AlwaysReturns(node->stmt.ifStmt.otherwise);
+        case ANT_SWITCH:
+        {
+            // A case without a body runs the next one
+            Bool8 hasDefault = HS_FALSE;
+            for (SASTNode* c = node->stmt.switchStmt.cases; c; c = c->switchCase.next)
+            {
+                hasDefault |= c->switchCase.isDefault;
+                if (c->switchCase.body && !AlwaysReturns(c->switchCase.body))
+                    return HS_FALSE;
+            }
+            return hasDefault;
+        }
+        default: return HS_FALSE;
+    }
+}
+
+//------------------------------------------------------------------------------
+// The arguments stay where the caller pushed them and are read relative to the frame pointer,
+// the locals are variables as in the main program. Globals are not in scope.
+static void CompileFunction(SCompilerState* s, int index, SASTNode* node)
+{
+    SSourcePosition position = EnterNode(s, node);
+    SScriptFunction* function = &s->functions[index];
+    function->entry = s->size;
+    s->function = index;
+    s->variableCount = 0;
+    s->varSize = 0;
+
+    int argumentSize = 0;
+    int argument = 0;
+    for (SASTNode* parameter = node->declFunc.parameters; parameter; parameter = parameter->parameter.next, ++argument)
+    {
+        EValueType type = function->signature.floatArguments & 1 << argument ? VT_FLOAT : VT_INT;
+        s->variables[s->variableCount++] = (SVariable)
+        {
+            .name = parameter->parameter.name->name,
+            .type = type,
+            .position = argumentSize,
+            .isParameter = HS_TRUE,
+        };
+        argumentSize += type == VT_INT ? HS_DATA_SIZE_INT : HS_DATA_SIZE_FLOAT;
+    }
+    s->functionVariables = s->variableCount;
+
+    byte operands[] = { argumentSize, 0, 0 };
+    EmitInstruction(s, INS_ENTER);
+    EmitBytes(s, operands, sizeof(operands));
+
+    CompileStatement(s, node->declFunc.body);
+    if (function->signature.result == NATIVE_NONE)
+        EmitInstruction(s, INS_LEAVE);
+    else if (!AlwaysReturns(node->declFunc.body))
+        Error(s, "'%s' can end without returning a value", function->name);
+
+    s->function = -1;
+    s->position = position;
+}
+
+//------------------------------------------------------------------------------
+// The main program first, then the functions in the order declared
+static EResult CompileProgram(SASTNode* root, const SNativeTable* natives, SStackData* outInstructions, SLineTable* outLines,
+    SFunctionTable* outFunctions)
+{
+    assert(root->type == ANT_PROGRAM);
+
+    SCompilerState state =
+    {
+        .capacity = 64,
+        .position = root->position,
+        .lines = outLines,
+        .natives = natives,
+        .function = -1,
+        .result = R_OK,
+    };
+    state.code = malloc(state.capacity);
+    if (outLines)
+        InitLineTable(outLines);
+
+    DeclareFunctions(&state, root);
+
+    // Globals stay allocated when the program ends
+    for (SASTNode* child = root->programChild; child; child = child->decl.sibling)
+    {
+        if (child->type != ANT_DECL_FUNC)
+            CompileDeclaration(&state, child);
+    }
+    int mainEnd = state.size;
+    EmitInstruction(&state, INS_END);
+
+    int function = 0;
+    for (SASTNode* child = root->programChild; child; child = child->decl.sibling)
+    {
+        if (child->type == ANT_DECL_FUNC)
+            CompileFunction(&state, function++, child->decl.declFunc);
+    }
+
+    for (int i = 0; i < state.callCount; ++i)
+        PatchAddress(&state, state.callPositions[i], state.functions[state.callTargets[i]].entry);
+
+    if (state.size > UINT16_MAX)
+        Error(&state, "Program is too large to be addressed");
+
+    // Calls of script functions in tail position become INS_TAIL_CALL, the size stays the same
+    // so the entries and the lines do not move
+    SStackData code = { .begin = state.code, .end = state.code + state.size, .stackPointer = state.code };
+    if (state.result == R_OK && EliminateTailCalls(&code) != R_OK)
+        state.result = R_ERROR;
+
+    free(state.callPositions);
+    free(state.callTargets);
+    if (state.result != R_OK)
+    {
+        free(state.functions);
+        free(state.code);
+        if (outLines)
+            DeleteLineTable(outLines);
+        return state.result;
+    }
+
+    // The names are copied, the tokens they come from do not outlive the compilation
+    if (outFunctions)
+    {
+        for (int i = 0; i < state.functionCount; ++i)
+        {
+            const char* name = state.functions[i].name;
+            state.functions[i].name = malloc(strlen(name) + 1);
+            strcpy(state.functions[i].name, name);
+        }
+        outFunctions->functions = state.functions;
+        outFunctions->count = state.functionCount;
+        outFunctions->mainEnd = mainEnd;
+    }
+    else
+    {
+        free(state.functions);
+    }
+
+    outInstructions->begin = state.code;
+    outInstructions->end = state.code + state.size;
+    outInstructions->stackPointer = state.code;
+    return R_OK;
+}
+
+//------------------------------------------------------------------------------
+EResult Compile(SASTNode* root, SStackData* outInstructions)
+{
+    return CompileWithLines(root, outInstructions, NULL);
+}
+
+//------------------------------------------------------------------------------
+EResult CompileWithLines(SASTNode* root, SStackData* outInstructions, SLineTable* outLines)
+{
+    return CompileWithNatives(root, NULL, outInstructions, outLines);
+}
+
+//------------------------------------------------------------------------------
+EResult CompileWithNatives(SASTNode* root, const SNativeTable* natives, SStackData* outInstructions, SLineTable* outLines)
+{
+    return CompileProgram(root, natives, outInstructions, outLines, NULL);
+}
+
+//------------------------------------------------------------------------------
+EResult CompileWithFunctions(SASTNode* root, const SNativeTable* natives, SStackData* outInstructions, SFunctionTable* outFunctions)
+{
+    return CompileProgram(root, natives, outInstructions, NULL, outFunctions);
+}
+
+//------------------------------------------------------------------------------
+void DeleteFunctionTable(SFunctionTable* functions)
+{
+    for (int i = 0; i < functions->count; ++i)
+        free(functions->functions[i].name);
+    free(functions->functions);
+    memset(functions, 0, sizeof(SFunctionTable));
+}
+
+//------------------------------------------------------------------------------
+int FindScriptFunction(const SFunctionTable* functions, const char* name)
+{
+    for (int i = 0; i < functions->count; ++i)
+    {
+        if (strcmp(functions->functions[i].name, name) == 0)
+            return i;
+    }
+    return -1;
+}
+
+//------------------------------------------------------------------------------
+EResult CompileOptimized(SASTNode* root, int level, SStackData* outInstructions)
+{
+    if (level <= 0)
+        return Compile(root, outInstructions);
+
+    SIRProgram program;
+    EResult r = BuildIR(root, &program);
+    if (r != R_OK)
+        return r;
+
+    OptimizeIR(&program);
+    r = LowerIR(&program, outInstructions);
+    FreeIR(&program);
+    return r;
+}
+
+//------------------------------------------------------------------------------
+EResult CompileSource(char* code, int size, SStackData* outInstructions)
+{
+    return CompileSourceOptimized(code, size, 0, outInstructions);
+}
+
+//------------------------------------------------------------------------------
+EResult CompileSourceWithLines(char* code, int size, SStackData* outInstructions, SLineTable* outLines)
+{
+    SToken* tokens;
+    int tokenCount;
+
+    EResult r = Tokenize(code, size, &tokens, &tokenCount);
+    if (r != R_OK)
+        return r;
+
+    SASTNode* astRoot;
+    r = Parse(tokens, tokenCount, &astRoot);
+    if (r == R_OK)
+        r = CompileWithLines(astRoot, outInstructions, outLines);
+
+    FreeTokens(&tokens, &tokenCount);
+    return r;
+}
+
+//------------------------------------------------------------------------------
+EResult CompileSourceWithNatives(char* code, int size, const SNativeTable* natives, SStackData* outInstructions)
+{
+    SToken* tokens;
+    int tokenCount;
+
+    EResult r = Tokenize(code, size, &tokens, &tokenCount);
+    if (r != R_OK)
+        return r;
+
+    SASTNode* astRoot;
+    r = Parse(tokens, tokenCount, &astRoot);
+    if (r == R_OK)
+        r = CompileWithNatives(astRoot, natives, outInstructions, NULL);
+
+    FreeTokens(&tokens, &tokenCount);
+    return r;
+}
+
+//------------------------------------------------------------------------------
+EResult CompileSourceWithFunctions(char* code, int size, const SNativeTable* natives, SStackData* outInstructions, SFunctionTable* outFunctions)
+{
+    SToken* tokens;
+    int tokenCount;
+
+    EResult r = Tokenize(code, size, &tokens, &tokenCount);
+    if (r != R_OK)
+        return r;
+
+    SASTNode* astRoot;
+    r = Parse(tokens, tokenCount, &astRoot);
+    if (r == R_OK)
+        r = CompileWithFunctions(astRoot, natives, outInstructions, outFunctions);
+
+    FreeTokens(&tokens, &tokenCount);
+    return r;
+}
+
+//------------------------------------------------------------------------------
+EResult CompileSourceOptimized(char* code, int size, int level, SStackData* outInstructions)
+{
+    SToken* tokens;
+    int tokenCount;
+
+    EResult r = Tokenize(code, size, &tokens, &tokenCount);
+    if (r != R_OK)
+        return r;
+
+    SASTNode* astRoot;
+    r = Parse(tokens, tokenCount, &astRoot);
+    if (r == R_OK)
+        r = CompileOptimized(astRoot, level, outInstructions);
+
+    FreeTokens(&tokens, &tokenCount);
+    return r;
+}
@@ -0,0 +1,320 @@
+#include "embed.h"
+#include "bytecode_c.h"
+#include "stack_usage.h"
+
+#include <limits.h>
+#include <stdio.h>
+
+//------------------------------------------------------------------------------
+// The data stack a call of each function needs is its arguments, the return address and what
+// the stack usage analysis found from its entry on
+static EResult SizeDataStack(SProgram* program)
+{
+    int count = program->functions.count;
+    int* entries = malloc((count > 0 ? count : 1) * sizeof(int));
+    for (int i = 0; i < count; ++i)
+        entries[i] = program->functions.functions[i].entry;
+
+    SStackUsage usage;
+    EResult r = AnalyzeStackUsageWithEntries(program->instructions, entries, count, &usage);
+    free(entries);
+    if (r != R_OK)
+    {
+        printf("ERROR: %s at %d\n", usage.error, usage.errorOffset);
+        FreeStackUsage(&usage);
+        return r;
+    }
+
+    program->dataSize = usage.isRecursive ? HS_RECURSIVE_DATA_SIZE : 0;
+    program->callReserve = usage.isRecursive ? usage.callReserve : 0;
+    for (int i = 0; i < usage.functionCount; ++i)
+    {
+        const SFunctionUsage* f = &usage.functions[i];
+        if (f->entry == 0)
+            continue;
+
+        int size = f->argumentSize + HS_DATA_SIZE_ADDRESS + (usage.isRecursive ? f->maxLocalSize : f->maxTotalSize);
+        if (size > program->dataSize)
+            program->dataSize = size;
+    }
+
+    FreeStackUsage(&usage);
+    return R_OK;
+}
+
+//------------------------------------------------------------------------------
+EResult CreateProgram(char* code, int size, const SNativeTable* natives, SProgram* outProgram)
+{
+    memset(outProgram, 0, sizeof(SProgram));
+    EResult r = CompileSourceWithFunctions(code, size, natives, &outProgram->instructions, &outProgram->functions);
+    if (r != R_OK)
+        return r;
+
+    r = SizeDataStack(outProgram);
+    if (r != R_OK)
+    {
+        DeleteFunctionTable(&outProgram->functions);
+        DeleteStack(outProgram->instructions);
+        return r;
+    }
+
+    if (natives)
+        outProgram->natives = CreateNativeFunctions(natives);
+    return R_OK;
+}
+
+//------------------------------------------------------------------------------
+void DeleteProgram(SProgram* program)
+{
+    free(program->natives.begin);
+    DeleteFunctionTable(&program->functions);
+    DeleteStack(program->instructions);
+    memset(program, 0, sizeof(SProgram));
+}
+
+//------------------------------------------------------------------------------
+SProgram* CreateSharedProgram(char* code, int size, const SNativeTable* natives)
+{
+    SProgram* program = malloc(sizeof(SProgram));
+    if (CreateProgram(code, size, natives, program) != R_OK)
+    {
+        free(program);
+        return NULL;
+    }
+    program->references = 1;
+    return program;
+}
+
+//------------------------------------------------------------------------------
+// The counts are updated with the atomic builtins of gcc and clang, C99 has no atomics
+SProgram* RetainProgram(SProgram* program)
+{
+    __atomic_add_fetch(&program->references, 1, __ATOMIC_RELAXED);
+    return program;
+}
+
+//------------------------------------------------------------------------------
+void ReleaseProgram(SProgram* program)
+{
+    // the release orders the uses of the program before its deletion on another thread
+    if (__atomic_sub_fetch(&program->references, 1, __ATOMIC_ACQ_REL) == 0)
+    {
+        DeleteProgram(program);
+        free(program);
+    }
+}
+
+//------------------------------------------------------------------------------
+int FindFunction(const SProgram* program, const char* name)
+{
+    return FindScriptFunction(&program->functions, name);
+}
+
+//------------------------------------------------------------------------------
+void InitScriptContext(SScriptContext* context, const SProgram* program)
+{
+    context->program = program;
+    InitVM(&context->vmData, program->instructions, program->dataSize, program->natives);
+    context->vmData.callReserve = program->callReserve;
+    context->function = -1;
+}
+
+//------------------------------------------------------------------------------
+void DeleteScriptContext(SScriptContext* context)
+{
+    DeleteVM(&context->vmData, HS_TRUE, HS_TRUE);
+}
+
+//------------------------------------------------------------------------------
+static const SScriptFunction* CheckCall(const SProgram* program, int function, int argumentCount)
+{
+    if (function < 0 || function >= program->functions.count)
+    {
+        printf("ERROR: Invalid function handle %d\n", function);
+        return NULL;
+    }
+
+    const SScriptFunction* f = &program->functions.functions[function];
+    if (argumentCount != f->signature.argumentCount)
+    {
+        printf("ERROR: '%s' takes %d arguments, not %d\n", f->name, f->signature.argumentCount, argumentCount);
+        return NULL;
+    }
+    return f;
+}
+
+//------------------------------------------------------------------------------
+// Empty data stack, then the return address to the INS_END of the main program as if the
+// function was called from there
+static void EnterFunction(SVMData* vmData, const SProgram* program, const SScriptFunction* f)
+{
+    StoreAddressVar(&vmData->dataStack.reversePointer, program->functions.mainEnd);
+    vmData->instructionStack.stackPointer = vmData->instructionStack.begin + f->entry;
+}
+
+//------------------------------------------------------------------------------
+static void ResetVM(SScriptContext* context)
+{
+    SVMData* vmData = &context->vmData;
+    context->function = -1;
+    vmData->dataStack.base.stackPointer = vmData->dataStack.base.begin;
+    vmData->dataStack.reversePointer = vmData->dataStack.base.end;
+    vmData->framePointer = vmData->dataStack.base.begin;
+    vmData->error = VM_OK;
+    vmData->asyncCall = HS_NO_ASYNC_CALL;
+}
+
+//------------------------------------------------------------------------------
+static void PushArguments(SVMData* vmData, const SScriptFunction* f, const SScriptValue* arguments)
+{
+    for (int i = 0; i < f->signature.argumentCount; ++i)
+    {
+        if (f->signature.floatArguments & 1 << i)
+            PushFloat(&vmData->dataStack.base.stackPointer, arguments[i].f);
+        else
+            PushInt(&vmData->dataStack.base.stackPointer, arguments[i].i);
+    }
+}
+
+//------------------------------------------------------------------------------
+static void PopResult(SVMData* vmData, const SScriptFunction* f, SScriptValue* outResult)
+{
+    if (outResult && f->signature.result == NATIVE_INT)
+        outResult->i = PopInt(&vmData->dataStack.base.stackPointer);
+    else if (outResult && f->signature.result == NATIVE_FLOAT)
+        outResult->f = PopFloat(&vmData->dataStack.base.stackPointer);
+}
+
+//------------------------------------------------------------------------------
+EResult CallFunction(SScriptContext* context, int function, const SScriptValue* arguments, int argumentCount,
+    SScriptValue* outResult)
+{
+    const SProgram* program = context->program;
+    const SScriptFunction* f = CheckCall(program, function, argumentCount);
+    if (!f)
+        return R_ERROR;
+
+    SVMData* vmData = &context->vmData;
+    ResetVM(context);
+    PushArguments(vmData, f, arguments);
+    EnterFunction(vmData, program, f);
+    while (VMProcessInstructions(vmData, INT_MAX))
+    {
+        if (vmData->asyncCall != HS_NO_ASYNC_CALL)
+        {
+            printf("ERROR: '%s' waits for an async native, it has to be started with StartFunction\n", f->name);
+            return R_ERROR;
+        }
+    }
+
+    if (vmData->error != VM_OK)
+    {
+        printf("ERROR: '%s' stopped with error %d\n", f->name, vmData->error);
+        return R_ERROR;
+    }
+
+    PopResult(vmData, f, outResult);
+    return R_OK;
+}
+
+//------------------------------------------------------------------------------
+EResult CallFunctionBatch(SScriptContext* context, int function, const void* const* inputs, int argumentCount,
+    void* outputs, int rowCount)
+{
+    const SProgram* program = context->program;
+    const SScriptFunction* f = CheckCall(program, function, argumentCount);
+    if (!f)
+        return R_ERROR;
+
+    // Everything but the stacks is set up once. A row that returns leaves the frame pointer
+    // where it was, a row that fails ends the batch.
+    SVMData* vmData = &context->vmData;
+    ResetVM(context);
+    byte* operands = vmData->dataStack.base.begin;
+    byte* variables = vmData->dataStack.base.end;
+    byte* entry = vmData->instructionStack.begin + f->entry;
+    hsbaddress mainEnd = (hsbaddress)program->functions.mainEnd;
+    byte floatArguments = f->signature.floatArguments;
+    ENativeType result = outputs ? f->signature.result : NATIVE_NONE;
+
+    for (int row = 0; row < rowCount; ++row)
+    {
+        vmData->dataStack.base.stackPointer = operands;
+        vmData->dataStack.reversePointer = variables;
+        for (int i = 0; i < argumentCount; ++i)
+        {
+            if (floatArguments & 1 << i)
+                PushFloat(&vmData->dataStack.base.stackPointer, ((const hsbfloat*)inputs[i])[row]);
+            else
+                PushInt(&vmData->dataStack.base.stackPointer, ((const hsbint*)inputs[i])[row]);
+        }
+        StoreAddressVar(&vmData->dataStack.reversePointer, mainEnd);
+        vmData->instructionStack.stackPointer = entry;
+
+        while (VMProcessInstructions(vmData, INT_MAX))
+        {
+            if (vmData->asyncCall != HS_NO_ASYNC_CALL)
+            {
+                printf("ERROR: '%s' waits for an async native in row %d\n", f->name, row);
+                return R_ERROR;
+            }
+        }
+
+        if (vmData->error != VM_OK)
+        {
+            printf("ERROR: '%s' stopped with error %d in row %d\n", f->name, vmData->error, row);
+            return R_ERROR;
+        }
+
+        if (result == NATIVE_INT)
+            ((hsbint*)outputs)[row] = PopInt(&vmData->dataStack.base.stackPointer);
+        else if (result == NATIVE_FLOAT)
+            ((hsbfloat*)outputs)[row] = PopFloat(&vmData->dataStack.base.stackPointer);
+    }
+    return R_OK;
+}
+
+//------------------------------------------------------------------------------
+EResult StartFunction(SScriptContext* context, int function, const SScriptValue* arguments, int argumentCount)
+{
+    const SProgram* program = context->program;
+    const SScriptFunction* f = CheckCall(program, function, argumentCount);
+    if (!f)
+        return R_ERROR;
+
+    SVMData* vmData = &context->vmData;
+    ResetVM(context);
+    PushArguments(vmData, f, arguments);
+    EnterFunction(vmData, program, f);
+    context->function = function;
+    return R_OK;
+}
+
+//------------------------------------------------------------------------------
+EScriptState ResumeFunction(SScriptContext* context, int count, SScriptValue* outResult)
+{
+    if (context->function < 0)
+    {
+        printf("ERROR: No function started\n");
+        return SCRIPT_FAILED;
+    }
+
+    // a yield, a waiting native and the end of the instructions all leave the VM as it is for
+    // the next resume
+    SVMData* vmData = &context->vmData;
+    if (vmData->asyncCall != HS_NO_ASYNC_CALL)
+        return SCRIPT_WAITING;
+    if (VMProcessInstructions(vmData, count))
+        return vmData->asyncCall != HS_NO_ASYNC_CALL ? SCRIPT_WAITING : SCRIPT_RUNNING;
+
+    const SScriptFunction* f = &context->program->functions.functions[context->function];
+    context->function = -1;
+    if (vmData->error != VM_OK)
+    {
+        printf("ERROR: '%s' stopped with error %d\n", f->name, vmData->error);
+        return SCRIPT_FAILED;
+    }
+
+    PopResult(vmData, f, outResult);
+    return SCRIPT_FINISHED;
+}
@@ -0,0 +1,46 @@
+#include "file.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+//------------------------------------------------------------------------------
+Bool8 ReadFile(const char* fileName, char** fileBuff, int* size)
+{
+    FILE* file = fopen(fileName, "rb");
+    if (!file)
+    {
+        printf("File does not exist\n");
+        return HS_FALSE;
+    }
+
+    Bool8 result = HS_TRUE;
+    fseek(file , 0 , SEEK_END);
+    int fileSize = ftell(file);
+    rewind(file);
+
+    *fileBuff = malloc(fileSize + 1);
+
+    if (!*fileBuff)
+    {
+        result = HS_FALSE;
+        printf("Failed to allocate memory for the file\n");
+        goto end;
+    }
+
+    int readSize = fread(*fileBuff, 1, fileSize, file);
+    int eof = feof(file);
+
+    if (readSize != fileSize && !eof)
+    {
+        free(*fileBuff);
+        result = HS_FALSE;
+        printf("Failed to read the whole file\n");
+        goto end;
+    }
+
+    (*fileBuff)[fileSize] = 0; // Zero terminate to have a proper string
+    *size = readSize;
+end:
+    fclose(file);
+    return result;
+}
@@ -0,0 +1,213 @@
+#if defined(__unix__) || defined(__APPLE__)
+    // mmap flags, sigaction and mincore are not part of C99
+    #define _DEFAULT_SOURCE
+    #define _DARWIN_C_SOURCE
+#endif
+
+#include "guarded_stack.h"
+#include "bytecode_c.h"
+
+#include <stdio.h>
+
+#if HS_GUARDED_STACK_SUPPORTED
+
+#include <pthread.h>
+#include <setjmp.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+//------------------------------------------------------------------------------
+static int s_pageSize;
+static struct sigaction s_previousSegv;
+static struct sigaction s_previousBus;
+static pthread_once_t s_installOnce = PTHREAD_ONCE_INIT;
+
+// The VM running in VMProcessInstructionsGuarded on this thread
+static __thread const SVMData* s_activeVM;
+static __thread sigjmp_buf* s_activeJump;
+
+//------------------------------------------------------------------------------
+static int RoundToPages(int size)
+{
+    if (size < 1)
+        size = 1;
+    return (size + s_pageSize - 1) / s_pageSize * s_pageSize;
+}
+
+//------------------------------------------------------------------------------
+static Bool8 IsInGuardedStack(const SVMData* vmData, const byte* address)
+{
+    return address >= vmData->dataStack.base.begin - s_pageSize
+        && address < vmData->dataStack.base.end + s_pageSize;
+}
+
+//------------------------------------------------------------------------------
+static void OnFault(int signal, siginfo_t* info, void* context)
+{
+    if (s_activeVM && IsInGuardedStack(s_activeVM, info->si_addr))
+        siglongjmp(*s_activeJump, 1);
+
+    // Not a VM stack, the fault goes to the previous handler and this one stays installed,
+    // a handler that recovers from its faults (e.g. a garbage collector) keeps working
+    const struct sigaction* previous = signal == SIGSEGV ? &s_previousSegv : &s_previousBus;
+    if (previous->sa_flags & SA_SIGINFO)
+    {
+        previous->sa_sigaction(signal, info, context);
+        return;
+    }
+    if (previous->sa_handler != SIG_DFL && previous->sa_handler != SIG_IGN)
+    {
+        previous->sa_handler(signal);
+        return;
+    }
+
+    // The default action, ignoring a fault would run the instruction forever
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = SIG_DFL;
+    sigemptyset(&action.sa_mask);
+    sigaction(signal, &action, NULL);
+    raise(signal);
+}
+
+//------------------------------------------------------------------------------
+static void InstallHandler()
+{
+    s_pageSize = (int)sysconf(_SC_PAGESIZE);
+
+    // SA_NODEFER keeps the signal unblocked after siglongjmp leaves the handler,
+    // so sigsetjmp does not have to save the signal mask on every run
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_sigaction = OnFault;
+    action.sa_flags = SA_SIGINFO | SA_NODEFER;
+    sigemptyset(&action.sa_mask);
+
+    sigaction(SIGSEGV, &action, &s_previousSegv);
+    sigaction(SIGBUS, &action, &s_previousBus);
+}
+
+//------------------------------------------------------------------------------
+void InitGuardedVM(SVMData* vmData, SStackData instructionStack, int dataSize, FuncArray functions)
+{
+    pthread_once(&s_installOnce, InstallHandler);
+
+    // [guard][operands][guard][variables][guard]
+    int regionSize = RoundToPages(dataSize);
+    int mappingSize = 3 * s_pageSize + 2 * regionSize;
+    byte* mapping = mmap(NULL, mappingSize, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (mapping == MAP_FAILED)
+    {
+        printf("ERROR: Could not reserve %d bytes for a guarded stack\n", mappingSize);
+        memset(vmData, 0, sizeof(SVMData));
+        vmData->error = VM_ERROR_STACK_OVERFLOW;
+        vmData->asyncCall = HS_NO_ASYNC_CALL;
+        return;
+    }
+
+    byte* operands = mapping + s_pageSize;
+    byte* vars = operands + regionSize + s_pageSize;
+    mprotect(operands, regionSize, PROT_READ | PROT_WRITE);
+    mprotect(vars, regionSize, PROT_READ | PROT_WRITE);
+
+    vmData->instructionStack = instructionStack;
+    vmData->dataStack.base.begin = operands;
+    vmData->dataStack.base.stackPointer = operands;
+    vmData->dataStack.base.end = vars + regionSize;
+    vmData->dataStack.reversePointer = vmData->dataStack.base.end;
+    vmData->functions = functions;
+    vmData->error = VM_OK;
+    // the regions do not share space, the reserve check at INS_CALL would not hold
+    vmData->callReserve = 0;
+    vmData->framePointer = operands;
+    vmData->asyncCall = HS_NO_ASYNC_CALL;
+}
+
+//------------------------------------------------------------------------------
+void DeleteGuardedVM(SVMData* vmData, Bool8 keepInstructions, Bool8 keepFunctions)
+{
+    if (!keepInstructions)
+        DeleteStack(vmData->instructionStack);
+    if (!keepFunctions)
+        free(vmData->functions.begin);
+
+    if (vmData->dataStack.base.begin)
+    {
+        byte* mapping = vmData->dataStack.base.begin - s_pageSize;
+        munmap(mapping, vmData->dataStack.base.end - mapping + s_pageSize);
+    }
+}
+
+//------------------------------------------------------------------------------
+Bool8 VMProcessInstructionsGuarded(SVMData* vmData, int count)
+{
+    if (vmData->error != VM_OK)
+        return HS_FALSE;
+
+    // Guarded runs can nest, e.g. a native function running another VM
+    const SVMData* previousVM = s_activeVM;
+    sigjmp_buf* previousJump = s_activeJump;
+
+    sigjmp_buf jump;
+    if (sigsetjmp(jump, 0))
+    {
+        s_activeVM = previousVM;
+        s_activeJump = previousJump;
+        vmData->error = VM_ERROR_STACK_OVERFLOW;
+        return HS_FALSE;
+    }
+
+    s_activeVM = vmData;
+    s_activeJump = &jump;
+    Bool8 result = VMProcessInstructions(vmData, count);
+    s_activeVM = previousVM;
+    s_activeJump = previousJump;
+    return result;
+}
+
+//------------------------------------------------------------------------------
+int GetGuardedStackResidentSize(const SVMData* vmData)
+{
+    byte* begin = vmData->dataStack.base.begin;
+    int size = (int)(vmData->dataStack.base.end - begin);
+    int pageCount = size / s_pageSize;
+
+    unsigned char* pages = malloc(pageCount);
+    int resident = 0;
+    if (mincore(begin, size, (void*)pages) == 0)
+    {
+        for (int i = 0; i < pageCount; ++i)
+            resident += pages[i] & 1;
+    }
+    free(pages);
+    return resident * s_pageSize;
+}
+
+#else
+
+//------------------------------------------------------------------------------
+void InitGuardedVM(SVMData* vmData, SStackData instructionStack, int dataSize, FuncArray functions)
+{
+    InitVM(vmData, instructionStack, dataSize, functions);
+}
+
+//------------------------------------------------------------------------------
+void DeleteGuardedVM(SVMData* vmData, Bool8 keepInstructions, Bool8 keepFunctions)
+{
+    DeleteVM(vmData, keepInstructions, keepFunctions);
+}
+
+//------------------------------------------------------------------------------
+Bool8 VMProcessInstructionsGuarded(SVMData* vmData, int count)
+{
+    return VMProcessInstructions(vmData, count);
+}
+
+//------------------------------------------------------------------------------
+int GetGuardedStackResidentSize(const SVMData* vmData)
+{
+    return (int)(vmData->dataStack.base.end - vmData->dataStack.base.begin);
+}
+
+#endif
@@ -0,0 +1,850 @@
+#include "ir.h"
+#include "tokenizer.h"
+
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+//------------------------------------------------------------------------------
+typedef struct
+{
+    const char* name;
+    EIRType type;
+} SIRVariable;
+
+//------------------------------------------------------------------------------
+typedef struct
+{
+    SIRProgram* program;
+
+    // Variables in scope, the innermost last, and the value each one has right now
+    SIRVariable variables[256];
+    int defs[256];
+    int variableCount;
+
+    int block; // Where the next value goes
+
+    EResult result;
+} SIRBuilder;
+
+//------------------------------------------------------------------------------
+static void Error(SIRBuilder* b, const char* format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    printf("ERROR: ");
+    vprintf(format, args);
+    printf("\n");
+    va_end(args);
+
+    b->result = R_ERROR;
+}
+
+//------------------------------------------------------------------------------
+// Makes room for one more element of the given size in a growing array
+static void* Reserve(void* array, int count, int* capacity, int size)
+{
+    if (count < *capacity)
+        return array;
+
+    *capacity = *capacity ? *capacity * 2 : 8;
+    return realloc(array, *capacity * size);
+}
+
+//------------------------------------------------------------------------------
+static int AddBlock(SIRProgram* p)
+{
+    p->blocks = Reserve(p->blocks, p->blockCount, &p->blockCapacity, sizeof(SIRBlock));
+    p->blocks[p->blockCount] = (SIRBlock){ .terminator = IR_END, .condition = -1 };
+    return p->blockCount++;
+}
+
+//------------------------------------------------------------------------------
+// Every phi of the block gets an operand for the new predecessor, -1 until it is set
+static void AddPred(SIRProgram* p, int block, int pred)
+{
+    SIRBlock* b = &p->blocks[block];
+    b->preds = Reserve(b->preds, b->predCount, &b->predCapacity, sizeof(int));
+    b->preds[b->predCount++] = pred;
+
+    for (int i = 0; i < b->valueCount && p->values[b->values[i]].op == IR_PHI; ++i)
+    {
+        SIRValue* phi = &p->values[b->values[i]];
+        phi->phiOperands = realloc(phi->phiOperands, b->predCount * sizeof(int));
+        phi->phiOperands[b->predCount - 1] = -1;
+    }
+}
+
+//------------------------------------------------------------------------------
+static int AddValue(SIRProgram* p, int block, EIROp op, EIRType type, int first, int second)
+{
+    p->values = Reserve(p->values, p->valueCount, &p->valueCapacity, sizeof(SIRValue));
+    p->values[p->valueCount] = (SIRValue){ .op = op, .type = type, .block = block, .operands = { first, second } };
+
+    SIRBlock* b = &p->blocks[block];
+    b->values = Reserve(b->values, b->valueCount, &b->valueCapacity, sizeof(int));
+    b->values[b->valueCount++] = p->valueCount;
+    return p->valueCount++;
+}
+
+//------------------------------------------------------------------------------
+// Phis go before the other values of the block
+static int AddPhi(SIRProgram* p, int block, EIRType type)
+{
+    int phi = AddValue(p, block, IR_PHI, type, -1, -1);
+    SIRBlock* b = &p->blocks[block];
+    int position = 0;
+    while (p->values[b->values[position]].op == IR_PHI && b->values[position] != phi)
+        ++position;
+    memmove(b->values + position + 1, b->values + position, (b->valueCount - 1 - position) * sizeof(int));
+    b->values[position] = phi;
+
+    p->values[phi].phiOperands = malloc((b->predCount ? b->predCount : 1) * sizeof(int));
+    for (int i = 0; i < b->predCount; ++i)
+        p->values[phi].phiOperands[i] = -1;
+    return phi;
+}
+
+//------------------------------------------------------------------------------
+static int AddIntConst(SIRBuilder* b, int value)
+{
+    if (value < INT16_MIN || value > INT16_MAX)
+        Error(b, "Integer literal %d out of range", value);
+
+    int v = AddValue(b->program, b->block, IR_CONST, IRT_INT, -1, -1);
+    b->program->values[v].intValue = value;
+    return v;
+}
+
+//------------------------------------------------------------------------------
+static int AddFloatConst(SIRBuilder* b, float value)
+{
+    int v = AddValue(b->program, b->block, IR_CONST, IRT_FLOAT, -1, -1);
+    b->program->values[v].floatValue = value;
+    return v;
+}
+
+//------------------------------------------------------------------------------
+// Ends the current block, the successors are set by the caller
+static SIRBlock* Terminate(SIRBuilder* b, EIRTerminator terminator, int condition, int successorCount)
+{
+    SIRBlock* block = &b->program->blocks[b->block];
+    block->terminator = terminator;
+    block->condition = condition;
+    block->successors = realloc(block->successors, successorCount * sizeof(int));
+    block->successorCount = successorCount;
+    return block;
+}
+
+//------------------------------------------------------------------------------
+static void Jump(SIRBuilder* b, int target)
+{
+    SIRBlock* block = Terminate(b, IR_JUMP, -1, 1);
+    block->successors[0] = target;
+    AddPred(b->program, target, b->block);
+}
+
+//------------------------------------------------------------------------------
+static void Branch(SIRBuilder* b, int condition, int whenTrue, int whenFalse)
+{
+    SIRBlock* block = Terminate(b, IR_BRANCH, condition, 2);
+    block->successors[0] = whenTrue;
+    block->successors[1] = whenFalse;
+    AddPred(b->program, whenTrue, b->block);
+    AddPred(b->program, whenFalse, b->block);
+}
+
+//------------------------------------------------------------------------------
+static int FindVariable(SIRBuilder* b, const char* name)
+{
+    for (int i = b->variableCount - 1; i >= 0; --i)
+    {
+        if (strcmp(b->variables[i].name, name) == 0)
+            return i;
+    }
+
+    Error(b, "Undeclared variable '%s'", name);
+    return -1;
+}
+
+//------------------------------------------------------------------------------
+static EIRType GetType(SIRBuilder* b, int value)
+{
+    return b->program->values[value].type;
+}
+
+//------------------------------------------------------------------------------
+static int BuildExpr(SIRBuilder* b, SASTNode* node);
+
+//------------------------------------------------------------------------------
+// Assignments copy the value, PropagateCopies removes the copies again
+static int BuildAssign(SIRBuilder* b, SASTNode* node)
+{
+    int value = BuildExpr(b, node->assign.assign);
+    int var = FindVariable(b, node->assign.var->name);
+    if (var < 0)
+        return value;
+
+    if (b->variables[var].type != GetType(b, value))
+    {
+        Error(b, "Type mismatch in assignment to '%s'", b->variables[var].name);
+        return value;
+    }
+
+    b->defs[var] = AddValue(b->program, b->block, IR_COPY, GetType(b, value), value, -1);
+    return b->defs[var];
+}
+
+//------------------------------------------------------------------------------
+static int BuildLiteral(SIRBuilder* b, SToken* token)
+{
+    switch (token->type)
+    {
+        case TOKEN_INTEGER: return AddIntConst(b, token->intNum);
+        case TOKEN_FLOAT: return AddFloatConst(b, token->floatNum);
+        case TOKEN_IDENTIFIER:
+        {
+            int var = FindVariable(b, token->name);
+            return var < 0 ? AddIntConst(b, 0) : b->defs[var];
+        }
+        default: assert(0); return AddIntConst(b, 0);
+    }
+}
+
+//------------------------------------------------------------------------------
+static int BuildUnary(SIRBuilder* b, SASTNode* node)
+{
+    assert(node->unary.op->type == TOKEN_MINUS);
+
+    // Negative literals are constants, anything else is multiplied by -1 like Compile does
+    SASTNode* right = node->unary.right;
+    if (right->type == ANT_LITERAL && right->literal.token->type == TOKEN_INTEGER)
+        return AddIntConst(b, -right->literal.token->intNum);
+    if (right->type == ANT_LITERAL && right->literal.token->type == TOKEN_FLOAT)
+        return AddFloatConst(b, -right->literal.token->floatNum);
+
+    int value = BuildExpr(b, right);
+    EIRType type = GetType(b, value);
+    if (type == IRT_BOOL)
+    {
+        Error(b, "Cannot negate a bool");
+        return value;
+    }
+
+    int minusOne = type == IRT_INT ? AddIntConst(b, -1) : AddFloatConst(b, -1.0f);
+    return AddValue(b->program, b->block, IR_MULTIPLY, type, value, minusOne);
+}
+
+//------------------------------------------------------------------------------
+static int BuildBinary(SIRBuilder* b, SASTNode* node)
+{
+    int left = BuildExpr(b, node->binary.left);
+    int right = BuildExpr(b, node->binary.right);
+    EIRType type = GetType(b, left);
+
+    if (type != GetType(b, right) || type == IRT_BOOL)
+    {
+        Error(b, "Invalid operand types of a binary operator");
+        return left;
+    }
+
+    SIRProgram* p = b->program;
+    switch (node->binary.op->type)
+    {
+        case TOKEN_PLUS: return AddValue(p, b->block, IR_ADD, type, left, right);
+        case TOKEN_MINUS: return AddValue(p, b->block, IR_SUBSTRACT, type, left, right);
+        case TOKEN_STAR: return AddValue(p, b->block, IR_MULTIPLY, type, left, right);
+        case TOKEN_SLASH: return AddValue(p, b->block, IR_DIVIDE, type, left, right);
+
+        case TOKEN_EQUAL_EQUAL: return AddValue(p, b->block, IR_CMP_EQ, IRT_BOOL, left, right);
+        case TOKEN_LESS: return AddValue(p, b->block, IR_CMP_LESS, IRT_BOOL, left, right);
+        case TOKEN_LESS_EQUAL: return AddValue(p, b->block, IR_CMP_LESS_EQ, IRT_BOOL, left, right);
+
+        // Negated forms of the above
+        case TOKEN_NOT_EQUAL:
+            return AddValue(p, b->block, IR_NOT, IRT_BOOL, AddValue(p, b->block, IR_CMP_EQ, IRT_BOOL, left, right), -1);
+        case TOKEN_GREATER_EQUAL:
+            return AddValue(p, b->block, IR_NOT, IRT_BOOL, AddValue(p, b->block, IR_CMP_LESS, IRT_BOOL, left, right), -1);
+        case TOKEN_GREATER:
+            return AddValue(p, b->block, IR_NOT, IRT_BOOL, AddValue(p, b->block, IR_CMP_LESS_EQ, IRT_BOOL, left, right), -1);
+
+        default: assert(0); return left;
+    }
+}
+
+//------------------------------------------------------------------------------
+static int BuildExpr(SIRBuilder* b, SASTNode* node)
+{
+    switch (node->type)
+    {
+        case ANT_ASSIGN: return BuildAssign(b, node);
+        case ANT_LITERAL: return BuildLiteral(b, node->literal.token);
+        case ANT_UNARY_OP: return BuildUnary(b, node);
+        case ANT_BINARY_OP: return BuildBinary(b, node);
+        case ANT_CALL:
+            // The IR has no calls, natives are compiled by Compile only
+            Error(b, "Call of '%s' in optimized code", node->call.name->name);
+            return AddIntConst(b, 0);
+        default: assert(0); return AddIntConst(b, 0);
+    }
+}
+
+//------------------------------------------------------------------------------
+static int BuildCondition(SIRBuilder* b, SASTNode* node)
+{
+    int value = BuildExpr(b, node);
+    if (GetType(b, value) != IRT_BOOL)
+        Error(b, "Condition has to be a bool");
+    return value;
+}
+
+//------------------------------------------------------------------------------
+// Where two paths join, variables with a different value on each get a phi
+static void Join(SIRBuilder* b, int block, const int* firstDefs, const int* secondDefs, int variableCount)
+{
+    for (int i = 0; i < variableCount; ++i)
+    {
+        if (firstDefs[i] == secondDefs[i])
+        {
+            b->defs[i] = firstDefs[i];
+            continue;
+        }
+
+        int phi = AddPhi(b->program, block, b->variables[i].type);
+        b->program->values[phi].phiOperands[0] = firstDefs[i];
+        b->program->values[phi].phiOperands[1] = secondDefs[i];
+        b->defs[i] = phi;
+    }
+}
+
+//------------------------------------------------------------------------------
+static void BuildDeclaration(SIRBuilder* b, SASTNode* node);
+
+//------------------------------------------------------------------------------
+static void BuildStatement(SIRBuilder* b, SASTNode* node);
+
+//------------------------------------------------------------------------------
+// Up to this many cases are compared one by one, more are split by binary search
+#define SWITCH_CHAIN_MAX 3
+#define SWITCH_TABLE_MAX 255
+
+//------------------------------------------------------------------------------
+typedef struct
+{
+    int value;
+    int target; // Block of the body which runs
+} SIRSwitchCase;
+
+//------------------------------------------------------------------------------
+// The paths into the end of a switch and the values of the variables on each
+typedef struct
+{
+    int end;
+    int* defs; // variableCount per path, in the order of the predecessors
+    int count;
+    int capacity;
+} SIRSwitchJoin;
+
+//------------------------------------------------------------------------------
+static void AddSwitchPath(SIRBuilder* b, SIRSwitchJoin* join, int target)
+{
+    if (target != join->end)
+        return;
+
+    if (join->count == join->capacity)
+    {
+        join->capacity = join->capacity ? join->capacity * 2 : 8;
+        join->defs = realloc(join->defs, join->capacity * (b->variableCount + 1) * sizeof(int));
+    }
+    memcpy(join->defs + join->count++ * b->variableCount, b->defs, b->variableCount * sizeof(int));
+}
+
+//------------------------------------------------------------------------------
+static void BranchCase(SIRBuilder* b, SIRSwitchJoin* join, int condition, int whenTrue, int whenFalse)
+{
+    Branch(b, condition, whenTrue, whenFalse);
+    AddSwitchPath(b, join, whenTrue);
+    AddSwitchPath(b, join, whenFalse);
+}
+
+//------------------------------------------------------------------------------
+static int CompareSwitchCases(const void* a, const void* b)
+{
+    return ((const SIRSwitchCase*)a)->value - ((const SIRSwitchCase*)b)->value;
+}
+
+//------------------------------------------------------------------------------
+// Binary search over the sorted cases, small ranges are compared one by one
+static void BuildCaseSearch(SIRBuilder* b, SIRSwitchJoin* join, int value, const SIRSwitchCase* cases, int first, int last, int defaultTarget)
+{
+    SIRProgram* p = b->program;
+    if (last - first < SWITCH_CHAIN_MAX)
+    {
+        // The next compare is the true successor, which the lowerings place after the branch
+        for (int i = first; i <= last; ++i)
+        {
+            int equal = AddValue(p, b->block, IR_CMP_EQ, IRT_BOOL, value, AddIntConst(b, cases[i].value));
+            int condition = AddValue(p, b->block, IR_NOT, IRT_BOOL, equal, -1);
+            int next = i < last ? AddBlock(p) : defaultTarget;
+            BranchCase(b, join, condition, next, cases[i].target);
+            b->block = next;
+        }
+        return;
+    }
+
+    int middle = (first + last + 1) / 2;
+    int condition = AddValue(p, b->block, IR_CMP_LESS, IRT_BOOL, value, AddIntConst(b, cases[middle].value));
+    int lower = AddBlock(p);
+    int upper = AddBlock(p);
+    Branch(b, condition, lower, upper);
+
+    b->block = upper;
+    BuildCaseSearch(b, join, value, cases, middle, last, defaultTarget);
+    b->block = lower;
+    BuildCaseSearch(b, join, value, cases, first, middle - 1, defaultTarget);
+}
+
+//------------------------------------------------------------------------------
+// The values of the sorted cases map to their targets, the ones in between to the default
+static void BuildCaseTable(SIRBuilder* b, SIRSwitchJoin* join, int value, const SIRSwitchCase* cases, int valueCount, int defaultTarget)
+{
+    int low = cases[0].value;
+    int span = cases[valueCount - 1].value - low + 1;
+    SIRBlock* block = Terminate(b, IR_SWITCH, value, 1);
+    block->successors = realloc(block->successors, (valueCount + 1) * sizeof(int));
+    block->successors[0] = defaultTarget;
+    block->cases = malloc(span * sizeof(int));
+    block->caseCount = span;
+    block->caseLow = low;
+    for (int i = 0; i < span; ++i)
+        block->cases[i] = 0;
+
+    for (int i = 0; i < valueCount; ++i)
+    {
+        int index = 0;
+        while (index < block->successorCount && block->successors[index] != cases[i].target)
+            ++index;
+        if (index == block->successorCount)
+            block->successors[block->successorCount++] = cases[i].target;
+        block->cases[cases[i].value - low] = index;
+    }
+
+    for (int i = 0; i < block->successorCount; ++i)
+    {
+        AddPred(b->program, block->successors[i], b->block);
+        AddSwitchPath(b, join, block->successors[i]);
+    }
+}
+
+//------------------------------------------------------------------------------
+// Dense cases dispatch through a table like Compile does, sparse ones by binary search. Every
+// body jumps to the end, where variables with different values on the paths into it get a phi.
+static void BuildSwitch(SIRBuilder* b, SASTNode* node)
+{
+    SIRProgram* p = b->program;
+    int value = BuildExpr(b, node->stmt.switchStmt.value);
+    if (GetType(b, value) != IRT_INT)
+        Error(b, "Switch value has to be an int");
+
+    int caseCount = 0;
+    for (SASTNode* c = node->stmt.switchStmt.cases; c; c = c->switchCase.next)
+        ++caseCount;
+
+    SASTNode** caseNodes = malloc((caseCount + 1) * sizeof(SASTNode*));
+    int* bodies = malloc((caseCount + 1) * sizeof(int));
+    SIRSwitchCase* cases = malloc((caseCount + 1) * sizeof(SIRSwitchCase));
+    int index = 0;
+    for (SASTNode* c = node->stmt.switchStmt.cases; c; c = c->switchCase.next)
+    {
+        bodies[index] = c->switchCase.body ? AddBlock(p) : -1;
+        caseNodes[index++] = c;
+    }
+
+    // A case without a body runs the next one
+    SIRSwitchJoin join = { .end = AddBlock(p) };
+    int defaultTarget = join.end;
+    int defaultCount = 0;
+    int valueCount = 0;
+    for (int i = caseCount - 1, target = join.end; i >= 0; --i)
+    {
+        target = bodies[i] >= 0 ? bodies[i] : target;
+        if (caseNodes[i]->switchCase.isDefault)
+        {
+            defaultTarget = target;
+            ++defaultCount;
+        }
+        else
+        {
+            cases[valueCount++] = (SIRSwitchCase){ .value = caseNodes[i]->switchCase.value, .target = target };
+        }
+    }
+    if (defaultCount > 1)
+        Error(b, "Switch has more than one default");
+
+    qsort(cases, valueCount, sizeof(SIRSwitchCase), CompareSwitchCases);
+    for (int i = 0; i < valueCount; ++i)
+    {
+        if (cases[i].value < INT16_MIN || cases[i].value > INT16_MAX)
+            Error(b, "Integer literal %d out of range", cases[i].value);
+        else if (i > 0 && cases[i].value == cases[i - 1].value)
+            Error(b, "Duplicate case value %d", cases[i].value);
+    }
+
+    int variableCount = b->variableCount;
+    int defs[256];
+    memcpy(defs, b->defs, variableCount * sizeof(int));
+
+    long long span = valueCount > 0 ? (long long)cases[valueCount - 1].value - cases[0].value + 1 : 0;
+    if (valueCount > SWITCH_CHAIN_MAX && span <= 2 * valueCount && span <= SWITCH_TABLE_MAX)
+    {
+        BuildCaseTable(b, &join, value, cases, valueCount, defaultTarget);
+    }
+    else if (valueCount > 0)
+    {
+        BuildCaseSearch(b, &join, value, cases, 0, valueCount - 1, defaultTarget);
+    }
+    else
+    {
+        Jump(b, defaultTarget);
+        AddSwitchPath(b, &join, defaultTarget);
+    }
+
+    for (int i = 0; i < caseCount; ++i)
+    {
+        if (bodies[i] < 0)
+            continue;
+
+        memcpy(b->defs, defs, variableCount * sizeof(int));
+        b->block = bodies[i];
+        BuildStatement(b, caseNodes[i]->switchCase.body);
+        Jump(b, join.end);
+        AddSwitchPath(b, &join, join.end);
+    }
+
+    for (int i = 0; i < variableCount; ++i)
+    {
+        b->defs[i] = join.defs[i];
+        for (int j = 1; j < join.count; ++j)
+        {
+            if (join.defs[j * variableCount + i] != join.defs[i])
+            {
+                b->defs[i] = AddPhi(p, join.end, b->variables[i].type);
+                for (int k = 0; k < join.count; ++k)
+                    p->values[b->defs[i]].phiOperands[k] = join.defs[k * variableCount + i];
+                break;
+            }
+        }
+    }
+    b->block = join.end;
+
+    free(join.defs);
+    free(cases);
+    free(bodies);
+    free(caseNodes);
+}
+
+//------------------------------------------------------------------------------
+static void BuildStatement(SIRBuilder* b, SASTNode* node)
+{
+    SIRProgram* p = b->program;
+    switch (node->type)
+    {
+        case ANT_EXPR_STMT:
+        {
+            if (node->stmt.expr->type == ANT_CALL)
+            {
+                BuildExpr(b, node->stmt.expr);
+                return;
+            }
+            if (node->stmt.expr->type != ANT_ASSIGN)
+            {
+                Error(b, "Expression statement has no effect");
+                return;
+            }
+            BuildAssign(b, node->stmt.expr);
+            break;
+        }
+        case ANT_BLOCK:
+        {
+            int variableCount = b->variableCount;
+            for (SASTNode* child = node->stmt.block; child; child = child->decl.sibling)
+                BuildDeclaration(b, child);
+            b->variableCount = variableCount;
+            break;
+        }
+        case ANT_IF:
+        {
+            int condition = BuildCondition(b, node->stmt.ifStmt.cond);
+            int then = AddBlock(p);
+            int otherwise = node->stmt.ifStmt.otherwise ? AddBlock(p) : -1;
+            int join = AddBlock(p);
+            Branch(b, condition, then, otherwise >= 0 ? otherwise : join);
+
+            int variableCount = b->variableCount;
+            int defs[256];
+            memcpy(defs, b->defs, variableCount * sizeof(int));
+
+            b->block = then;
+            BuildStatement(b, node->stmt.ifStmt.then);
+            Jump(b, join);
+            int thenDefs[256];
+            memcpy(thenDefs, b->defs, variableCount * sizeof(int));
+
+            // The predecessors of the join are the ends of both branches, or the condition
+            // block and the end of the then branch
+            memcpy(b->defs, defs, variableCount * sizeof(int));
+            if (otherwise >= 0)
+            {
+                b->block = otherwise;
+                BuildStatement(b, node->stmt.ifStmt.otherwise);
+                Jump(b, join);
+                Join(b, join, thenDefs, b->defs, variableCount);
+            }
+            else
+            {
+                Join(b, join, defs, thenDefs, variableCount);
+            }
+            b->block = join;
+            break;
+        }
+        case ANT_WHILE:
+        {
+            // Every variable gets a phi in the header, the ones the body does not change
+            // merge a single value and PropagateCopies removes them
+            int header = AddBlock(p);
+            int body = AddBlock(p);
+            int exit = AddBlock(p);
+            Jump(b, header);
+
+            int variableCount = b->variableCount;
+            int phis[256];
+            for (int i = 0; i < variableCount; ++i)
+            {
+                phis[i] = AddPhi(p, header, b->variables[i].type);
+                p->values[phis[i]].phiOperands[0] = b->defs[i];
+                b->defs[i] = phis[i];
+            }
+
+            b->block = header;
+            int condition = BuildCondition(b, node->stmt.whileStmt.cond);
+            Branch(b, condition, body, exit);
+            int exitDefs[256];
+            memcpy(exitDefs, b->defs, variableCount * sizeof(int));
+
+            b->block = body;
+            BuildStatement(b, node->stmt.whileStmt.body);
+            Jump(b, header);
+            for (int i = 0; i < variableCount; ++i)
+                p->values[phis[i]].phiOperands[1] = b->defs[i];
+
+            memcpy(b->defs, exitDefs, variableCount * sizeof(int));
+            b->block = exit;
+            break;
+        }
+        case ANT_SWITCH: BuildSwitch(b, node); break;
+        case ANT_RETURN: Error(b, "Return in optimized code"); break;
+        case ANT_YIELD: Error(b, "Yield in optimized code"); break;
+        default: assert(0); break;
+    }
+}
+
+//------------------------------------------------------------------------------
+static void BuildVariableDeclaration(SIRBuilder* b, SASTNode* node)
+{
+    const char* typeName = node->declVar.type->name;
+    EIRType type;
+    if (strcmp(typeName, "int") == 0)
+    {
+        type = IRT_INT;
+    }
+    else if (strcmp(typeName, "float") == 0)
+    {
+        type = IRT_FLOAT;
+    }
+    else
+    {
+        Error(b, "Unknown type '%s'", typeName);
+        return;
+    }
+
+    if (b->variableCount == sizeof(b->variables) / sizeof(b->variables[0]))
+    {
+        Error(b, "Too many variables in scope");
+        return;
+    }
+
+    // The variable is in scope only after its initializer, it starts zeroed without one
+    int value;
+    if (node->declVar.initExpr)
+    {
+        value = BuildExpr(b, node->declVar.initExpr);
+        if (GetType(b, value) != type)
+            Error(b, "Type mismatch in initialization of '%s'", node->declVar.name->name);
+        value = AddValue(b->program, b->block, IR_COPY, type, value, -1);
+    }
+    else
+    {
+        value = type == IRT_INT ? AddIntConst(b, 0) : AddFloatConst(b, 0.0f);
+    }
+
+    b->variables[b->variableCount] = (SIRVariable){ .name = node->declVar.name->name, .type = type };
+    b->defs[b->variableCount++] = value;
+}
+
+//------------------------------------------------------------------------------
+static void BuildDeclaration(SIRBuilder* b, SASTNode* node)
+{
+    switch (node->type)
+    {
+        case ANT_DECL_VAR: BuildVariableDeclaration(b, node->decl.declVar); break;
+        case ANT_DECL_STMT: BuildStatement(b, node->decl.stmt); break;
+        case ANT_DECL_FUNC:
+            // The IR is a single function, functions are compiled by Compile only
+            Error(b, "Function '%s' in optimized code", node->decl.declFunc->declFunc.name->name);
+            break;
+        default: assert(0); break;
+    }
+}
+
+//------------------------------------------------------------------------------
+EResult BuildIR(SASTNode* root, SIRProgram* outProgram)
+{
+    assert(root->type == ANT_PROGRAM);
+
+    memset(outProgram, 0, sizeof(*outProgram));
+    SIRBuilder builder =
+    {
+        .program = outProgram,
+        .result = R_OK,
+    };
+    builder.block = AddBlock(outProgram);
+
+    // The globals are the variables still in scope at the end
+    for (SASTNode* child = root->programChild; child; child = child->decl.sibling)
+        BuildDeclaration(&builder, child);
+
+    outProgram->globalCount = builder.variableCount;
+    outProgram->globals = malloc((builder.variableCount + 1) * sizeof(int));
+    outProgram->globalTypes = malloc((builder.variableCount + 1) * sizeof(EIRType));
+    for (int i = 0; i < builder.variableCount; ++i)
+    {
+        outProgram->globals[i] = builder.defs[i];
+        outProgram->globalTypes[i] = builder.variables[i].type;
+    }
+
+    if (builder.result != R_OK)
+        FreeIR(outProgram);
+    return builder.result;
+}
+
+//------------------------------------------------------------------------------
+void FreeIR(SIRProgram* program)
+{
+    for (int i = 0; i < program->valueCount; ++i)
+        free(program->values[i].phiOperands);
+    for (int i = 0; i < program->blockCount; ++i)
+    {
+        free(program->blocks[i].values);
+        free(program->blocks[i].preds);
+        free(program->blocks[i].successors);
+        free(program->blocks[i].cases);
+    }
+    free(program->values);
+    free(program->blocks);
+    free(program->globals);
+    free(program->globalTypes);
+    memset(program, 0, sizeof(*program));
+}
+
+//------------------------------------------------------------------------------
+static const char* GetOpName(EIROp op)
+{
+    switch (op)
+    {
+        case IR_CONST: return "const";
+        case IR_ADD: return "add";
+        case IR_SUBSTRACT: return "sub";
+        case IR_MULTIPLY: return "mul";
+        case IR_DIVIDE: return "div";
+        case IR_CMP_EQ: return "eq";
+        case IR_CMP_LESS: return "less";
+        case IR_CMP_LESS_EQ: return "lesseq";
+        case IR_NOT: return "not";
+        case IR_COPY: return "copy";
+        case IR_PHI: return "phi";
+        default: return "removed";
+    }
+}
+
+//------------------------------------------------------------------------------
+void DumpIR(const SIRProgram* program, FILE* out)
+{
+    static const char TYPE_SUFFIX[] = { 'i', 'f', 'b' };
+
+    for (int blockIndex = 0; blockIndex < program->blockCount; ++blockIndex)
+    {
+        const SIRBlock* block = &program->blocks[blockIndex];
+        if (block->isRemoved)
+            continue;
+
+        fprintf(out, "b%d:", blockIndex);
+        if (block->predCount > 0)
+            fprintf(out, " <-");
+        for (int i = 0; i < block->predCount; ++i)
+            fprintf(out, " b%d", block->preds[i]);
+        fprintf(out, "\n");
+
+        for (int i = 0; i < block->valueCount; ++i)
+        {
+            const SIRValue* value = &program->values[block->values[i]];
+            fprintf(out, "    v%d = %s.%c", block->values[i], GetOpName(value->op), TYPE_SUFFIX[value->type]);
+            switch (value->op)
+            {
+                case IR_CONST:
+                    if (value->type == IRT_FLOAT)
+                        fprintf(out, " %.9g", (double)value->floatValue);
+                    else
+                        fprintf(out, " %d", value->intValue);
+                    break;
+                case IR_PHI:
+                    for (int j = 0; j < block->predCount; ++j)
+                        fprintf(out, " v%d", value->phiOperands[j]);
+                    break;
+                case IR_NOT:
+                case IR_COPY:
+                    fprintf(out, " v%d", value->operands[0]);
+                    break;
+                default:
+                    fprintf(out, " v%d v%d", value->operands[0], value->operands[1]);
+                    break;
+            }
+            fprintf(out, "\n");
+        }
+
+        switch (block->terminator)
+        {
+            case IR_JUMP:
+                fprintf(out, "    jump b%d\n", block->successors[0]);
+                break;
+            case IR_BRANCH:
+                fprintf(out, "    branch v%d b%d b%d\n", block->condition, block->successors[0], block->successors[1]);
+                break;
+            case IR_SWITCH:
+                fprintf(out, "    switch v%d b%d", block->condition, block->successors[0]);
+                for (int i = 0; i < block->caseCount; ++i)
+                {
+                    if (block->cases[i] != 0)
+                        fprintf(out, " %d:b%d", block->caseLow + i, block->successors[block->cases[i]]);
+                }
+                fprintf(out, "\n");
+                break;
+            case IR_END:
+                fprintf(out, "    end");
+                for (int i = 0; i < program->globalCount; ++i)
+                    fprintf(out, " v%d", program->globals[i]);
+                fprintf(out, "\n");
+                break;
+        }
+    }
+}
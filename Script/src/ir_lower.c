@@ -0,0 +1,525 @@
+#include "ir.h"
+#include "bytecode_c.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+//------------------------------------------------------------------------------
+typedef struct
+{
+    int position; // Of the address operand
+    int target;   // Block, or stub when isStub
+    Bool8 isStub;
+} SIRFixup;
+
+//------------------------------------------------------------------------------
+// A branch edge into a block with phis gets its own copies after the program
+typedef struct
+{
+    int from;
+    int to;
+    int edge; // Which of the edges between the two blocks
+} SIRStub;
+
+//------------------------------------------------------------------------------
+typedef struct
+{
+    const SIRProgram* program;
+
+    // Bytecode being emitted
+    byte* code;
+    int size;
+    int capacity;
+
+    // Variable of every value which lives in one, -1 for the others
+    int* slots;
+    int* slotOffsets;
+    EIRType* slotTypes;
+    int slotCount;
+
+    int* blockAddresses;
+    SIRFixup* fixups;
+    int fixupCount;
+    SIRStub* stubs;
+    int stubCount;
+
+    EResult result;
+} SIRLowering;
+
+//------------------------------------------------------------------------------
+static void EmitBytes(SIRLowering* l, const void* bytes, int size)
+{
+    if (l->size + size > l->capacity)
+    {
+        while (l->size + size > l->capacity)
+            l->capacity *= 2;
+        l->code = realloc(l->code, l->capacity);
+    }
+
+    memcpy(l->code + l->size, bytes, size);
+    l->size += size;
+}
+
+//------------------------------------------------------------------------------
+static void EmitInstruction(SIRLowering* l, EInstruction instruction)
+{
+    byte b = instruction;
+    EmitBytes(l, &b, 1);
+}
+
+//------------------------------------------------------------------------------
+static void EmitSlot(SIRLowering* l, EInstruction intInstruction, EInstruction floatInstruction, int slot)
+{
+    if (l->slotOffsets[slot] > 255)
+    {
+        if (l->result == R_OK)
+            printf("ERROR: Too many variables in scope\n");
+        l->result = R_ERROR;
+        return;
+    }
+
+    byte operand = l->slotOffsets[slot];
+    EmitInstruction(l, l->slotTypes[slot] == IRT_INT ? intInstruction : floatInstruction);
+    EmitBytes(l, &operand, 1);
+}
+
+//------------------------------------------------------------------------------
+static void EmitJump(SIRLowering* l, EInstruction instruction, int target, Bool8 isStub)
+{
+    EmitInstruction(l, instruction);
+    l->fixups = realloc(l->fixups, (l->fixupCount + 1) * sizeof(SIRFixup));
+    l->fixups[l->fixupCount++] = (SIRFixup){ .position = l->size, .target = target, .isStub = isStub };
+
+    hsbaddress operand = 0;
+    EmitBytes(l, &operand, sizeof(hsbaddress));
+}
+
+//------------------------------------------------------------------------------
+static void EmitUse(SIRLowering* l, int value);
+
+//------------------------------------------------------------------------------
+static void EmitCompute(SIRLowering* l, int value)
+{
+    static const EInstruction INT_INSTRUCTIONS[] =
+    {
+        INS_ADD_I, INS_SUBSTRACT_I, INS_MULTIPLY_I, INS_DIVIDE_I, INS_CMP_I_EQ, INS_CMP_I_LESS, INS_CMP_I_LESS_EQ,
+    };
+    static const EInstruction FLOAT_INSTRUCTIONS[] =
+    {
+        INS_ADD_F, INS_SUBSTRACT_F, INS_MULTIPLY_F, INS_DIVIDE_F, INS_CMP_F_EQ, INS_CMP_F_LESS, INS_CMP_F_LESS_EQ,
+    };
+
+    const SIRValue* v = &l->program->values[value];
+    switch (v->op)
+    {
+        case IR_CONST:
+        {
+            if (v->type == IRT_FLOAT)
+            {
+                EmitInstruction(l, INS_LITERAL_F);
+                EmitBytes(l, &v->floatValue, sizeof(hsbfloat));
+            }
+            else if (v->type == IRT_INT)
+            {
+                EmitInstruction(l, INS_LITERAL_I);
+                EmitBytes(l, &v->intValue, sizeof(hsbint));
+            }
+            else
+            {
+                hsbbool operand = v->intValue != 0;
+                EmitInstruction(l, INS_LITERAL_B);
+                EmitBytes(l, &operand, sizeof(hsbbool));
+            }
+            break;
+        }
+        case IR_NOT:
+            EmitUse(l, v->operands[0]);
+            EmitInstruction(l, INS_NEGATE_B);
+            break;
+        case IR_COPY:
+            EmitUse(l, v->operands[0]);
+            break;
+        default:
+        {
+            // Compares are typed by their operands
+            EmitUse(l, v->operands[0]);
+            EmitUse(l, v->operands[1]);
+            EIRType type = l->program->values[v->operands[0]].type;
+            int index = v->op - IR_ADD;
+            EmitInstruction(l, type == IRT_INT ? INT_INSTRUCTIONS[index] : FLOAT_INSTRUCTIONS[index]);
+            break;
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+static void EmitUse(SIRLowering* l, int value)
+{
+    if (l->slots[value] >= 0)
+        EmitSlot(l, INS_LOAD_VAR_I, INS_LOAD_VAR_F, l->slots[value]);
+    else
+        EmitCompute(l, value);
+}
+
+//------------------------------------------------------------------------------
+// Pushes the condition, or its negation, with as few instructions as possible
+static void EmitCondition(SIRLowering* l, int value, Bool8 isNegated)
+{
+    const SIRValue* v = &l->program->values[value];
+    if (v->op == IR_NOT)
+    {
+        EmitCondition(l, v->operands[0], !isNegated);
+        return;
+    }
+    if (!isNegated)
+    {
+        EmitUse(l, value);
+        return;
+    }
+
+    // Swapping the operands negates the int compares, NaN rules that out for floats
+    Bool8 isIntCompare = (v->op == IR_CMP_LESS || v->op == IR_CMP_LESS_EQ)
+        && l->program->values[v->operands[0]].type == IRT_INT;
+    if (isIntCompare)
+    {
+        EmitUse(l, v->operands[1]);
+        EmitUse(l, v->operands[0]);
+        EmitInstruction(l, v->op == IR_CMP_LESS ? INS_CMP_I_LESS_EQ : INS_CMP_I_LESS);
+    }
+    else if (v->op == IR_CONST)
+    {
+        hsbbool operand = v->intValue == 0;
+        EmitInstruction(l, INS_LITERAL_B);
+        EmitBytes(l, &operand, sizeof(hsbbool));
+    }
+    else
+    {
+        EmitUse(l, value);
+        EmitInstruction(l, INS_NEGATE_B);
+    }
+}
+
+//------------------------------------------------------------------------------
+// Phis sharing the variable of their operand need no copy
+static Bool8 IsCopy(SIRLowering* l, int phi, int predIndex)
+{
+    int operand = l->program->values[phi].phiOperands[predIndex];
+    return l->slots[phi] >= 0 && operand != phi && l->slots[operand] != l->slots[phi];
+}
+
+//------------------------------------------------------------------------------
+static Bool8 HasCopies(SIRLowering* l, int to, int predIndex)
+{
+    const SIRBlock* b = &l->program->blocks[to];
+    for (int i = 0; i < b->valueCount && l->program->values[b->values[i]].op == IR_PHI; ++i)
+    {
+        if (IsCopy(l, b->values[i], predIndex))
+            return HS_TRUE;
+    }
+    return HS_FALSE;
+}
+
+//------------------------------------------------------------------------------
+// All sources are pushed before the first phi is written, so phis may swap
+static void EmitPhiCopies(SIRLowering* l, int to, int predIndex)
+{
+    const SIRBlock* b = &l->program->blocks[to];
+    int phiCount = 0;
+    while (phiCount < b->valueCount && l->program->values[b->values[phiCount]].op == IR_PHI)
+        ++phiCount;
+
+    for (int i = 0; i < phiCount; ++i)
+    {
+        if (IsCopy(l, b->values[i], predIndex))
+            EmitUse(l, l->program->values[b->values[i]].phiOperands[predIndex]);
+    }
+    for (int i = phiCount - 1; i >= 0; --i)
+    {
+        if (IsCopy(l, b->values[i], predIndex))
+            EmitSlot(l, INS_SAVE_VAR_I, INS_SAVE_VAR_F, l->slots[b->values[i]]);
+    }
+}
+
+//------------------------------------------------------------------------------
+// The stub of the edge when it needs copies, -1 otherwise
+static int AddStub(SIRLowering* l, int from, int to, int edge)
+{
+    if (!HasCopies(l, to, GetIRPredIndex(l->program, from, to, edge)))
+        return -1;
+
+    l->stubs = realloc(l->stubs, (l->stubCount + 1) * sizeof(SIRStub));
+    l->stubs[l->stubCount] = (SIRStub){ .from = from, .to = to, .edge = edge };
+    return l->stubCount++;
+}
+
+//------------------------------------------------------------------------------
+// Jumps to the target of the edge, or to a stub doing the copies first
+static void EmitEdgeJump(SIRLowering* l, EInstruction instruction, int from, int to, int edge)
+{
+    int stub = AddStub(l, from, to, edge);
+    EmitJump(l, instruction, stub >= 0 ? stub : to, stub >= 0);
+}
+
+//------------------------------------------------------------------------------
+// The table has a jump for the default and every case, the entries of a successor share its stub
+static void EmitSwitch(SIRLowering* l, int block)
+{
+    const SIRBlock* b = &l->program->blocks[block];
+    EmitUse(l, b->condition);
+    EmitInstruction(l, INS_SWITCH);
+    EmitBytes(l, &b->caseLow, sizeof(hsbint));
+    byte count = b->caseCount;
+    EmitBytes(l, &count, 1);
+
+    int* stubs = malloc(b->successorCount * sizeof(int));
+    for (int i = 0; i < b->successorCount; ++i)
+        stubs[i] = AddStub(l, block, b->successors[i], 0);
+    for (int i = 0; i <= b->caseCount; ++i)
+    {
+        int successor = i == 0 ? 0 : b->cases[i - 1];
+        EmitJump(l, INS_JUMP, stubs[successor] >= 0 ? stubs[successor] : b->successors[successor], stubs[successor] >= 0);
+    }
+    free(stubs);
+}
+
+//------------------------------------------------------------------------------
+// Falls through to the next block where possible
+static void EmitBranch(SIRLowering* l, int block, int next)
+{
+    const SIRBlock* b = &l->program->blocks[block];
+    int whenTrue = b->successors[0];
+    int whenFalse = b->successors[1];
+    int falseEdge = whenTrue == whenFalse ? 1 : 0;
+
+    if (whenTrue == next && whenFalse != next && !HasCopies(l, whenTrue, GetIRPredIndex(l->program, block, whenTrue, 0)))
+    {
+        EmitCondition(l, b->condition, HS_TRUE);
+        EmitEdgeJump(l, INS_COND_JUMP_B, block, whenFalse, falseEdge);
+        return;
+    }
+
+    EmitCondition(l, b->condition, HS_FALSE);
+    EmitEdgeJump(l, INS_COND_JUMP_B, block, whenTrue, 0);
+
+    EmitPhiCopies(l, whenFalse, GetIRPredIndex(l->program, block, whenFalse, falseEdge));
+    if (whenFalse != next)
+        EmitJump(l, INS_JUMP, whenFalse, HS_FALSE);
+}
+
+//------------------------------------------------------------------------------
+// Nothing but the branch has to be emitted for the block, loop headers usually
+static Bool8 IsBranchOnly(SIRLowering* l, int block)
+{
+    const SIRBlock* b = &l->program->blocks[block];
+    for (int i = 0; i < b->valueCount; ++i)
+    {
+        if (l->slots[b->values[i]] >= 0 && l->program->values[b->values[i]].op != IR_PHI)
+            return HS_FALSE;
+    }
+    return b->terminator == IR_BRANCH;
+}
+
+//------------------------------------------------------------------------------
+static void EmitEnd(SIRLowering* l)
+{
+    const SIRProgram* p = l->program;
+    for (int i = 0; i < p->globalCount; ++i)
+    {
+        if (l->slots[p->globals[i]] != i)
+            EmitUse(l, p->globals[i]);
+    }
+    for (int i = p->globalCount - 1; i >= 0; --i)
+    {
+        if (l->slots[p->globals[i]] != i)
+            EmitSlot(l, INS_SAVE_VAR_I, INS_SAVE_VAR_F, i);
+    }
+
+    for (int i = l->slotCount - 1; i >= p->globalCount; --i)
+        EmitInstruction(l, l->slotTypes[i] == IRT_INT ? INS_DEALLOC_VAR_I : INS_DEALLOC_VAR_F);
+    EmitInstruction(l, INS_END);
+}
+
+//------------------------------------------------------------------------------
+static void EmitBlock(SIRLowering* l, int block, int next)
+{
+    const SIRBlock* b = &l->program->blocks[block];
+    l->blockAddresses[block] = l->size;
+
+    for (int i = 0; i < b->valueCount; ++i)
+    {
+        int value = b->values[i];
+        if (l->slots[value] >= 0 && l->program->values[value].op != IR_PHI)
+        {
+            EmitCompute(l, value);
+            EmitSlot(l, INS_SAVE_VAR_I, INS_SAVE_VAR_F, l->slots[value]);
+        }
+    }
+
+    switch (b->terminator)
+    {
+        case IR_JUMP:
+        {
+            // Instead of jumping back to the condition of a loop the latch checks it again
+            int target = b->successors[0];
+            EmitPhiCopies(l, target, GetIRPredIndex(l->program, block, target, 0));
+            if (target != next && IsBranchOnly(l, target))
+                EmitBranch(l, target, next);
+            else if (target != next)
+                EmitJump(l, INS_JUMP, target, HS_FALSE);
+            break;
+        }
+        case IR_BRANCH: EmitBranch(l, block, next); break;
+        case IR_SWITCH: EmitSwitch(l, block); break;
+        case IR_END: EmitEnd(l); break;
+    }
+}
+
+//------------------------------------------------------------------------------
+static void CountUse(int* useCounts, int* useBlocks, int value, int block)
+{
+    ++useCounts[value];
+    useBlocks[value] = useBlocks[value] == -1 || useBlocks[value] == block ? block : -2;
+}
+
+//------------------------------------------------------------------------------
+// Constants and bools are computed where they are used and so are values used once in their
+// own block, the others get a variable
+static void AssignSlots(SIRLowering* l)
+{
+    const SIRProgram* p = l->program;
+    int* useCounts = calloc(p->valueCount + 1, sizeof(int));
+    int* useBlocks = malloc((p->valueCount + 1) * sizeof(int));
+    for (int i = 0; i < p->valueCount; ++i)
+        useBlocks[i] = -1;
+
+    int endBlock = 0;
+    for (int block = 0; block < p->blockCount; ++block)
+    {
+        const SIRBlock* b = &p->blocks[block];
+        if (b->isRemoved)
+            continue;
+
+        for (int i = 0; i < b->valueCount; ++i)
+        {
+            const SIRValue* v = &p->values[b->values[i]];
+            if (v->op == IR_PHI)
+            {
+                for (int j = 0; j < b->predCount; ++j)
+                {
+                    if (v->phiOperands[j] != b->values[i])
+                        CountUse(useCounts, useBlocks, v->phiOperands[j], b->preds[j]);
+                }
+                continue;
+            }
+            for (int j = 0; j < 2; ++j)
+            {
+                if (v->operands[j] >= 0)
+                    CountUse(useCounts, useBlocks, v->operands[j], block);
+            }
+        }
+
+        if (b->terminator == IR_BRANCH || b->terminator == IR_SWITCH)
+            CountUse(useCounts, useBlocks, b->condition, block);
+        if (b->terminator == IR_END)
+            endBlock = block;
+    }
+    for (int i = 0; i < p->globalCount; ++i)
+        CountUse(useCounts, useBlocks, p->globals[i], endBlock);
+
+    Bool8* hasVariable = malloc((p->valueCount + 1) * sizeof(Bool8));
+    for (int value = 0; value < p->valueCount; ++value)
+    {
+        const SIRValue* v = &p->values[value];
+        Bool8 isInline = v->op != IR_PHI && useCounts[value] == 1 && useBlocks[value] == v->block;
+        hasVariable[value] = v->op != IR_REMOVED && v->op != IR_CONST && v->type != IRT_BOOL && useCounts[value] > 0 && !isInline;
+    }
+
+    // Variables are typed here, the globals' ones first in the order Compile allocates them
+    l->slotCount = AssignIRVariables(p, hasVariable, HS_FALSE, l->slots);
+    for (int i = 0; i < p->globalCount; ++i)
+        l->slotTypes[i] = p->globalTypes[i];
+    for (int value = 0; value < p->valueCount; ++value)
+    {
+        if (l->slots[value] >= p->globalCount)
+            l->slotTypes[l->slots[value]] = p->values[value].type;
+    }
+
+    // The variable allocated last is at offset 0
+    int size = 0;
+    for (int i = 0; i < l->slotCount; ++i)
+    {
+        size += l->slotTypes[i] == IRT_INT ? HS_DATA_SIZE_INT : HS_DATA_SIZE_FLOAT;
+        l->slotOffsets[i] = size;
+    }
+    for (int i = 0; i < l->slotCount; ++i)
+        l->slotOffsets[i] = size - l->slotOffsets[i];
+
+    free(hasVariable);
+    free(useBlocks);
+    free(useCounts);
+}
+
+//------------------------------------------------------------------------------
+EResult LowerIR(const SIRProgram* program, SStackData* outInstructions)
+{
+    SIRLowering l =
+    {
+        .program = program,
+        .capacity = 64,
+        .result = R_OK,
+    };
+    l.code = malloc(l.capacity);
+    l.slots = malloc((program->valueCount + 1) * sizeof(int));
+    l.slotOffsets = malloc((program->valueCount + program->globalCount + 1) * sizeof(int));
+    l.slotTypes = malloc((program->valueCount + program->globalCount + 1) * sizeof(EIRType));
+    l.blockAddresses = malloc((program->blockCount + 1) * sizeof(int));
+    AssignSlots(&l);
+
+    for (int i = 0; i < l.slotCount; ++i)
+        EmitInstruction(&l, l.slotTypes[i] == IRT_INT ? INS_ALLOC_VAR_I : INS_ALLOC_VAR_F);
+
+    int* order = malloc((program->blockCount + 1) * sizeof(int));
+    int blockCount = GetIRLayout(program, order);
+    for (int i = 0; i < blockCount; ++i)
+        EmitBlock(&l, order[i], i + 1 < blockCount ? order[i + 1] : -1);
+    free(order);
+
+    int* stubAddresses = malloc((l.stubCount + 1) * sizeof(int));
+    for (int i = 0; i < l.stubCount; ++i)
+    {
+        stubAddresses[i] = l.size;
+        EmitPhiCopies(&l, l.stubs[i].to, GetIRPredIndex(program, l.stubs[i].from, l.stubs[i].to, l.stubs[i].edge));
+        EmitJump(&l, INS_JUMP, l.stubs[i].to, HS_FALSE);
+    }
+
+    for (int i = 0; i < l.fixupCount; ++i)
+    {
+        const SIRFixup* fixup = &l.fixups[i];
+        StoreAddress(l.code + fixup->position, fixup->isStub ? stubAddresses[fixup->target] : l.blockAddresses[fixup->target]);
+    }
+
+    if (l.size > UINT16_MAX && l.result == R_OK)
+    {
+        printf("ERROR: Program is too large to be addressed\n");
+        l.result = R_ERROR;
+    }
+
+    free(stubAddresses);
+    free(l.stubs);
+    free(l.fixups);
+    free(l.blockAddresses);
+    free(l.slotTypes);
+    free(l.slotOffsets);
+    free(l.slots);
+
+    if (l.result != R_OK)
+    {
+        free(l.code);
+        return l.result;
+    }
+
+    outInstructions->begin = l.code;
+    outInstructions->end = l.code + l.size;
+    outInstructions->stackPointer = l.code;
+    return R_OK;
+}
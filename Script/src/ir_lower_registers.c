@@ -0,0 +1,496 @@
+#include "register_vm.h"
+#include "bytecode_c.h"
+#include "tokenizer.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+//------------------------------------------------------------------------------
+typedef struct
+{
+    int position; // Of the address operand
+    int target;   // Block, or stub when isStub
+    Bool8 isStub;
+} SRegFixup;
+
+//------------------------------------------------------------------------------
+// A branch edge into a block with phis gets its own moves after the program
+typedef struct
+{
+    int from;
+    int to;
+    int edge; // Which of the edges between the two blocks
+} SRegStub;
+
+//------------------------------------------------------------------------------
+typedef struct
+{
+    const SIRProgram* program;
+
+    // Bytecode being emitted
+    byte* code;
+    int size;
+    int capacity;
+
+    // Register of every value which has one, constants included, -1 for the others
+    int* registers;
+    int registerCount;
+    int scratch; // Breaks cycles of moves
+
+    int* blockAddresses;
+    SRegFixup* fixups;
+    int fixupCount;
+    SRegStub* stubs;
+    int stubCount;
+
+    EResult result;
+} SRegLowering;
+
+//------------------------------------------------------------------------------
+static void EmitBytes(SRegLowering* l, const void* bytes, int size)
+{
+    if (l->size + size > l->capacity)
+    {
+        while (l->size + size > l->capacity)
+            l->capacity *= 2;
+        l->code = realloc(l->code, l->capacity);
+    }
+
+    memcpy(l->code + l->size, bytes, size);
+    l->size += size;
+}
+
+//------------------------------------------------------------------------------
+static void EmitInstruction(SRegLowering* l, ERegInstruction instruction, int operandCount, int first, int second, int third)
+{
+    byte bytes[] = { instruction, first, second, third };
+    EmitBytes(l, bytes, 1 + operandCount);
+}
+
+//------------------------------------------------------------------------------
+static void EmitJump(SRegLowering* l, ERegInstruction instruction, int first, int second, int target, Bool8 isStub)
+{
+    EmitInstruction(l, instruction, instruction == RINS_JUMP ? 0 : 2, first, second, 0);
+    l->fixups = realloc(l->fixups, (l->fixupCount + 1) * sizeof(SRegFixup));
+    l->fixups[l->fixupCount++] = (SRegFixup){ .position = l->size, .target = target, .isStub = isStub };
+
+    hsbaddress operand = 0;
+    EmitBytes(l, &operand, sizeof(hsbaddress));
+}
+
+//------------------------------------------------------------------------------
+// Copies compute nothing, they are read from their source
+static int Resolve(const SIRProgram* p, int value)
+{
+    while (p->values[value].op == IR_COPY)
+        value = p->values[value].operands[0];
+    return value;
+}
+
+//------------------------------------------------------------------------------
+static int GetRegister(SRegLowering* l, int value)
+{
+    return l->registers[Resolve(l->program, value)];
+}
+
+//------------------------------------------------------------------------------
+// Writes the sources to the targets as if all at once. A move waits while its target is still
+// to be read by another, when only such moves are left they form cycles and one source is
+// saved to the scratch register.
+static void EmitParallelMoves(SRegLowering* l, int* targets, int* sources, int count)
+{
+    int left = 0;
+    for (int i = 0; i < count; ++i)
+    {
+        if (targets[i] != sources[i])
+        {
+            targets[left] = targets[i];
+            sources[left++] = sources[i];
+        }
+    }
+
+    while (left > 0)
+    {
+        int ready = -1;
+        for (int i = 0; i < left && ready < 0; ++i)
+        {
+            ready = i;
+            for (int j = 0; j < left; ++j)
+            {
+                if (j != i && sources[j] == targets[i])
+                    ready = -1;
+            }
+        }
+
+        if (ready < 0)
+        {
+            EmitInstruction(l, RINS_MOVE, 2, l->scratch, sources[0], 0);
+            for (int i = 1; i < left; ++i)
+            {
+                if (sources[i] == sources[0])
+                    sources[i] = l->scratch;
+            }
+            sources[0] = l->scratch;
+            continue;
+        }
+
+        EmitInstruction(l, RINS_MOVE, 2, targets[ready], sources[ready], 0);
+        targets[ready] = targets[--left];
+        sources[ready] = sources[left];
+    }
+}
+
+//------------------------------------------------------------------------------
+static void EmitPhiMoves(SRegLowering* l, int to, int predIndex)
+{
+    const SIRBlock* b = &l->program->blocks[to];
+    int* targets = malloc((b->valueCount + 1) * sizeof(int));
+    int* sources = malloc((b->valueCount + 1) * sizeof(int));
+
+    int count = 0;
+    for (int i = 0; i < b->valueCount && l->program->values[b->values[i]].op == IR_PHI; ++i)
+    {
+        if (l->registers[b->values[i]] < 0)
+            continue;
+        targets[count] = l->registers[b->values[i]];
+        sources[count++] = GetRegister(l, l->program->values[b->values[i]].phiOperands[predIndex]);
+    }
+    EmitParallelMoves(l, targets, sources, count);
+
+    free(sources);
+    free(targets);
+}
+
+//------------------------------------------------------------------------------
+static Bool8 HasMoves(SRegLowering* l, int to, int predIndex)
+{
+    const SIRBlock* b = &l->program->blocks[to];
+    for (int i = 0; i < b->valueCount && l->program->values[b->values[i]].op == IR_PHI; ++i)
+    {
+        int phi = b->values[i];
+        if (l->registers[phi] >= 0 && GetRegister(l, l->program->values[phi].phiOperands[predIndex]) != l->registers[phi])
+            return HS_TRUE;
+    }
+    return HS_FALSE;
+}
+
+//------------------------------------------------------------------------------
+// The stub of the edge when it needs moves, -1 otherwise
+static int AddStub(SRegLowering* l, int from, int to, int edge)
+{
+    if (!HasMoves(l, to, GetIRPredIndex(l->program, from, to, edge)))
+        return -1;
+
+    l->stubs = realloc(l->stubs, (l->stubCount + 1) * sizeof(SRegStub));
+    l->stubs[l->stubCount] = (SRegStub){ .from = from, .to = to, .edge = edge };
+    return l->stubCount++;
+}
+
+//------------------------------------------------------------------------------
+// Jumps to the target of the edge when the condition holds, through a stub doing the moves
+// first where needed. A constant condition jumps always or never.
+static void EmitConditionJump(SRegLowering* l, int condition, Bool8 isNegated, int from, int to, int edge)
+{
+    const SIRProgram* p = l->program;
+    const SIRValue* v = &p->values[Resolve(p, condition)];
+    while (v->op == IR_NOT)
+    {
+        isNegated = !isNegated;
+        v = &p->values[Resolve(p, v->operands[0])];
+    }
+    if (v->op == IR_CONST && (v->intValue != 0) == isNegated)
+        return;
+
+    int stub = AddStub(l, from, to, edge);
+    Bool8 isStub = stub >= 0;
+    int target = isStub ? stub : to;
+
+    if (v->op == IR_CONST)
+    {
+        EmitJump(l, RINS_JUMP, 0, 0, target, isStub);
+        return;
+    }
+
+    // Swapping the operands negates the int compares, NaN rules that out for floats
+    int first = GetRegister(l, v->operands[0]);
+    int second = GetRegister(l, v->operands[1]);
+    ERegInstruction instruction;
+    if (p->values[v->operands[0]].type == IRT_INT)
+    {
+        switch (v->op)
+        {
+            case IR_CMP_EQ: instruction = isNegated ? RINS_JUMP_I_NOT_EQ : RINS_JUMP_I_EQ; break;
+            case IR_CMP_LESS: instruction = isNegated ? RINS_JUMP_I_LESS_EQ : RINS_JUMP_I_LESS; break;
+            default: instruction = isNegated ? RINS_JUMP_I_LESS : RINS_JUMP_I_LESS_EQ; break;
+        }
+        if (isNegated && v->op != IR_CMP_EQ)
+        {
+            first = second;
+            second = GetRegister(l, v->operands[0]);
+        }
+    }
+    else
+    {
+        switch (v->op)
+        {
+            case IR_CMP_EQ: instruction = isNegated ? RINS_JUMP_F_NOT_EQ : RINS_JUMP_F_EQ; break;
+            case IR_CMP_LESS: instruction = isNegated ? RINS_JUMP_F_NOT_LESS : RINS_JUMP_F_LESS; break;
+            default: instruction = isNegated ? RINS_JUMP_F_NOT_LESS_EQ : RINS_JUMP_F_LESS_EQ; break;
+        }
+    }
+    EmitJump(l, instruction, first, second, target, isStub);
+}
+
+//------------------------------------------------------------------------------
+// Falls through to the next block where possible
+static void EmitBranch(SRegLowering* l, int block, int next)
+{
+    const SIRBlock* b = &l->program->blocks[block];
+    int whenTrue = b->successors[0];
+    int whenFalse = b->successors[1];
+    int falseEdge = whenTrue == whenFalse ? 1 : 0;
+
+    if (whenTrue == next && whenFalse != next && !HasMoves(l, whenTrue, GetIRPredIndex(l->program, block, whenTrue, 0)))
+    {
+        EmitConditionJump(l, b->condition, HS_TRUE, block, whenFalse, falseEdge);
+        return;
+    }
+
+    EmitConditionJump(l, b->condition, HS_FALSE, block, whenTrue, 0);
+
+    EmitPhiMoves(l, whenFalse, GetIRPredIndex(l->program, block, whenFalse, falseEdge));
+    if (whenFalse != next)
+        EmitJump(l, RINS_JUMP, 0, 0, whenFalse, HS_FALSE);
+}
+
+//------------------------------------------------------------------------------
+// The table has a jump for the default and every case, the entries of a successor share its stub
+static void EmitSwitch(SRegLowering* l, int block)
+{
+    const SIRBlock* b = &l->program->blocks[block];
+    EmitInstruction(l, RINS_SWITCH, 1, GetRegister(l, b->condition), 0, 0);
+    EmitBytes(l, &b->caseLow, sizeof(hsbint));
+    byte count = b->caseCount;
+    EmitBytes(l, &count, 1);
+
+    int* stubs = malloc(b->successorCount * sizeof(int));
+    for (int i = 0; i < b->successorCount; ++i)
+        stubs[i] = AddStub(l, block, b->successors[i], 0);
+    for (int i = 0; i <= b->caseCount; ++i)
+    {
+        int successor = i == 0 ? 0 : b->cases[i - 1];
+        EmitJump(l, RINS_JUMP, 0, 0, stubs[successor] >= 0 ? stubs[successor] : b->successors[successor], stubs[successor] >= 0);
+    }
+    free(stubs);
+}
+
+//------------------------------------------------------------------------------
+// Nothing but the branch has to be emitted for the block, loop headers usually
+static Bool8 IsBranchOnly(SRegLowering* l, int block)
+{
+    const SIRBlock* b = &l->program->blocks[block];
+    for (int i = 0; i < b->valueCount; ++i)
+    {
+        const SIRValue* v = &l->program->values[b->values[i]];
+        if (l->registers[b->values[i]] >= 0 && v->op != IR_PHI && v->op != IR_CONST)
+            return HS_FALSE;
+    }
+    return b->terminator == IR_BRANCH;
+}
+
+//------------------------------------------------------------------------------
+static void EmitEnd(SRegLowering* l)
+{
+    const SIRProgram* p = l->program;
+    int* targets = malloc((p->globalCount + 1) * sizeof(int));
+    int* sources = malloc((p->globalCount + 1) * sizeof(int));
+    for (int i = 0; i < p->globalCount; ++i)
+    {
+        targets[i] = i;
+        sources[i] = GetRegister(l, p->globals[i]);
+    }
+    EmitParallelMoves(l, targets, sources, p->globalCount);
+    EmitInstruction(l, RINS_END, 0, 0, 0, 0);
+
+    free(sources);
+    free(targets);
+}
+
+//------------------------------------------------------------------------------
+static void EmitBlock(SRegLowering* l, int block, int next)
+{
+    const SIRProgram* p = l->program;
+    const SIRBlock* b = &p->blocks[block];
+    l->blockAddresses[block] = l->size;
+
+    for (int i = 0; i < b->valueCount; ++i)
+    {
+        const SIRValue* v = &p->values[b->values[i]];
+        if (l->registers[b->values[i]] < 0 || v->op < IR_ADD || v->op > IR_DIVIDE)
+            continue;
+
+        ERegInstruction instruction = RINS_ADD_I + 2 * (v->op - IR_ADD) + (v->type == IRT_FLOAT ? 1 : 0);
+        EmitInstruction(l, instruction, 3, l->registers[b->values[i]], GetRegister(l, v->operands[0]), GetRegister(l, v->operands[1]));
+    }
+
+    switch (b->terminator)
+    {
+        case IR_JUMP:
+        {
+            // Instead of jumping back to the condition of a loop the latch checks it again
+            int target = b->successors[0];
+            EmitPhiMoves(l, target, GetIRPredIndex(p, block, target, 0));
+            if (target != next && IsBranchOnly(l, target))
+                EmitBranch(l, target, next);
+            else if (target != next)
+                EmitJump(l, RINS_JUMP, 0, 0, target, HS_FALSE);
+            break;
+        }
+        case IR_BRANCH: EmitBranch(l, block, next); break;
+        case IR_SWITCH: EmitSwitch(l, block); break;
+        case IR_END: EmitEnd(l); break;
+    }
+}
+
+//------------------------------------------------------------------------------
+// Values get registers shared where they are never live at the same time, after them every
+// distinct constant gets one loaded at the start and the scratch register comes last
+static void AssignRegisters(SRegLowering* l)
+{
+    const SIRProgram* p = l->program;
+    Bool8* hasVariable = malloc((p->valueCount + 1) * sizeof(Bool8));
+    for (int value = 0; value < p->valueCount; ++value)
+    {
+        const SIRValue* v = &p->values[value];
+        hasVariable[value] = v->op != IR_REMOVED && v->op != IR_CONST && v->op != IR_COPY && v->type != IRT_BOOL;
+    }
+    l->registerCount = AssignIRVariables(p, hasVariable, HS_TRUE, l->registers);
+    free(hasVariable);
+
+    for (int value = 0; value < p->valueCount; ++value)
+    {
+        const SIRValue* v = &p->values[value];
+        if (v->op != IR_CONST || v->type == IRT_BOOL)
+            continue;
+
+        for (int other = 0; other < value && l->registers[value] < 0; ++other)
+        {
+            const SIRValue* o = &p->values[other];
+            Bool8 isSame = v->type == IRT_INT ? o->intValue == v->intValue : memcmp(&o->floatValue, &v->floatValue, sizeof(hsbfloat)) == 0;
+            if (o->op == IR_CONST && o->type == v->type && isSame)
+                l->registers[value] = l->registers[other];
+        }
+        if (l->registers[value] >= 0)
+            continue;
+
+        l->registers[value] = l->registerCount++;
+        if (l->registers[value] >= HS_REGISTER_COUNT)
+            continue;
+
+        if (v->type == IRT_INT)
+        {
+            EmitInstruction(l, RINS_LOAD_I, 1, l->registers[value], 0, 0);
+            EmitBytes(l, &v->intValue, sizeof(hsbint));
+        }
+        else
+        {
+            EmitInstruction(l, RINS_LOAD_F, 1, l->registers[value], 0, 0);
+            EmitBytes(l, &v->floatValue, sizeof(hsbfloat));
+        }
+    }
+
+    l->scratch = l->registerCount++;
+    if (l->registerCount > HS_REGISTER_COUNT)
+    {
+        printf("ERROR: Too many registers\n");
+        l->result = R_ERROR;
+    }
+}
+
+//------------------------------------------------------------------------------
+EResult LowerIRToRegisters(const SIRProgram* program, SRegProgram* outProgram)
+{
+    SRegLowering l =
+    {
+        .program = program,
+        .capacity = 64,
+        .result = R_OK,
+    };
+    l.code = malloc(l.capacity);
+    l.registers = malloc((program->valueCount + 1) * sizeof(int));
+    l.blockAddresses = malloc((program->blockCount + 1) * sizeof(int));
+    AssignRegisters(&l);
+
+    int* order = malloc((program->blockCount + 1) * sizeof(int));
+    int blockCount = GetIRLayout(program, order);
+    for (int i = 0; i < blockCount && l.result == R_OK; ++i)
+        EmitBlock(&l, order[i], i + 1 < blockCount ? order[i + 1] : -1);
+    free(order);
+
+    int* stubAddresses = malloc((l.stubCount + 1) * sizeof(int));
+    for (int i = 0; i < l.stubCount; ++i)
+    {
+        stubAddresses[i] = l.size;
+        EmitPhiMoves(&l, l.stubs[i].to, GetIRPredIndex(program, l.stubs[i].from, l.stubs[i].to, l.stubs[i].edge));
+        EmitJump(&l, RINS_JUMP, 0, 0, l.stubs[i].to, HS_FALSE);
+    }
+
+    for (int i = 0; i < l.fixupCount; ++i)
+    {
+        const SRegFixup* fixup = &l.fixups[i];
+        StoreAddress(l.code + fixup->position, fixup->isStub ? stubAddresses[fixup->target] : l.blockAddresses[fixup->target]);
+    }
+
+    if (l.size > UINT16_MAX && l.result == R_OK)
+    {
+        printf("ERROR: Program is too large to be addressed\n");
+        l.result = R_ERROR;
+    }
+
+    free(stubAddresses);
+    free(l.stubs);
+    free(l.fixups);
+    free(l.blockAddresses);
+    free(l.registers);
+
+    if (l.result != R_OK)
+    {
+        free(l.code);
+        return l.result;
+    }
+
+    outProgram->instructions.begin = l.code;
+    outProgram->instructions.end = l.code + l.size;
+    outProgram->instructions.stackPointer = l.code;
+    outProgram->registerCount = l.registerCount;
+    outProgram->globalCount = program->globalCount;
+    outProgram->globalTypes = malloc((program->globalCount + 1) * sizeof(EIRType));
+    memcpy(outProgram->globalTypes, program->globalTypes, program->globalCount * sizeof(EIRType));
+    return R_OK;
+}
+
+//------------------------------------------------------------------------------
+EResult CompileSourceToRegisters(char* code, int size, SRegProgram* outProgram)
+{
+    SToken* tokens;
+    int tokenCount;
+
+    EResult r = Tokenize(code, size, &tokens, &tokenCount);
+    if (r != R_OK)
+        return r;
+
+    SASTNode* astRoot;
+    SIRProgram program;
+    r = Parse(tokens, tokenCount, &astRoot);
+    if (r == R_OK)
+        r = BuildIR(astRoot, &program);
+    if (r == R_OK)
+    {
+        OptimizeIR(&program);
+        r = LowerIRToRegisters(&program, outProgram);
+        FreeIR(&program);
+    }
+
+    FreeTokens(&tokens, &tokenCount);
+    return r;
+}
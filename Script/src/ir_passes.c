@@ -0,0 +1,639 @@
+#include "ir.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+//------------------------------------------------------------------------------
+static Bool8 IsBinary(EIROp op)
+{
+    return op >= IR_ADD && op <= IR_CMP_LESS_EQ;
+}
+
+//------------------------------------------------------------------------------
+// Drops the predecessor at the index along with the phi operands for it
+static void RemovePredAt(SIRProgram* p, int block, int index)
+{
+    SIRBlock* b = &p->blocks[block];
+    for (int i = 0; i < b->valueCount && p->values[b->values[i]].op == IR_PHI; ++i)
+    {
+        int* operands = p->values[b->values[i]].phiOperands;
+        memmove(operands + index, operands + index + 1, (b->predCount - index - 1) * sizeof(int));
+    }
+
+    memmove(b->preds + index, b->preds + index + 1, (b->predCount - index - 1) * sizeof(int));
+    --b->predCount;
+}
+
+//------------------------------------------------------------------------------
+// Index of the successor a branch or a switch takes for the value of its condition
+static int GetTakenSuccessor(const SIRBlock* b, hsbint value)
+{
+    if (b->terminator == IR_BRANCH)
+        return value != 0 ? 0 : 1;
+
+    int index = value - b->caseLow;
+    return index >= 0 && index < b->caseCount ? b->cases[index] : 0;
+}
+
+//------------------------------------------------------------------------------
+static void RemoveValue(SIRProgram* p, int value)
+{
+    SIRValue* v = &p->values[value];
+    SIRBlock* b = &p->blocks[v->block];
+    for (int i = 0; i < b->valueCount; ++i)
+    {
+        if (b->values[i] == value)
+        {
+            memmove(b->values + i, b->values + i + 1, (b->valueCount - i - 1) * sizeof(int));
+            --b->valueCount;
+            break;
+        }
+    }
+
+    free(v->phiOperands);
+    v->phiOperands = NULL;
+    v->op = IR_REMOVED;
+}
+
+//------------------------------------------------------------------------------
+static void ReplaceUses(SIRProgram* p, int from, int to)
+{
+    for (int blockIndex = 0; blockIndex < p->blockCount; ++blockIndex)
+    {
+        SIRBlock* b = &p->blocks[blockIndex];
+        if (b->isRemoved)
+            continue;
+
+        for (int i = 0; i < b->valueCount; ++i)
+        {
+            SIRValue* v = &p->values[b->values[i]];
+            if (v->op == IR_PHI)
+            {
+                for (int j = 0; j < b->predCount; ++j)
+                    v->phiOperands[j] = v->phiOperands[j] == from ? to : v->phiOperands[j];
+            }
+            else
+            {
+                v->operands[0] = v->operands[0] == from ? to : v->operands[0];
+                v->operands[1] = v->operands[1] == from ? to : v->operands[1];
+            }
+        }
+        if (b->condition == from)
+            b->condition = to;
+    }
+
+    for (int i = 0; i < p->globalCount; ++i)
+        p->globals[i] = p->globals[i] == from ? to : p->globals[i];
+}
+
+//------------------------------------------------------------------------------
+// Blocks reachable from the entry in reverse postorder, returns their count
+static int GetReversePostorder(const SIRProgram* p, int* outOrder)
+{
+    Bool8* isVisited = calloc(p->blockCount, sizeof(Bool8));
+    int* stack = malloc(p->blockCount * sizeof(int));
+    int* nextSuccessor = calloc(p->blockCount, sizeof(int));
+
+    int count = 0;
+    int depth = 0;
+    stack[depth++] = 0;
+    isVisited[0] = HS_TRUE;
+    while (depth > 0)
+    {
+        int block = stack[depth - 1];
+        const SIRBlock* b = &p->blocks[block];
+        if (nextSuccessor[block] < b->successorCount)
+        {
+            int successor = b->successors[nextSuccessor[block]++];
+            if (!isVisited[successor])
+            {
+                isVisited[successor] = HS_TRUE;
+                stack[depth++] = successor;
+            }
+            continue;
+        }
+
+        outOrder[count++] = block;
+        --depth;
+    }
+
+    for (int i = 0; i < count / 2; ++i)
+    {
+        int block = outOrder[i];
+        outOrder[i] = outOrder[count - 1 - i];
+        outOrder[count - 1 - i] = block;
+    }
+
+    free(nextSuccessor);
+    free(stack);
+    free(isVisited);
+    return count;
+}
+
+//------------------------------------------------------------------------------
+// Immediate dominator of every reachable block, -1 for the others and the entry points
+// to itself (Cooper, Harvey and Kennedy, "A Simple, Fast Dominance Algorithm")
+static int* ComputeDominators(const SIRProgram* p)
+{
+    int* order = malloc(p->blockCount * sizeof(int));
+    int* orderIndex = malloc(p->blockCount * sizeof(int));
+    int* idom = malloc(p->blockCount * sizeof(int));
+    int count = GetReversePostorder(p, order);
+    for (int i = 0; i < p->blockCount; ++i)
+    {
+        idom[i] = -1;
+        orderIndex[i] = -1;
+    }
+    for (int i = 0; i < count; ++i)
+        orderIndex[order[i]] = i;
+    idom[0] = 0;
+
+    Bool8 changed = HS_TRUE;
+    while (changed)
+    {
+        changed = HS_FALSE;
+        for (int i = 1; i < count; ++i)
+        {
+            const SIRBlock* b = &p->blocks[order[i]];
+            int newIdom = -1;
+            for (int j = 0; j < b->predCount; ++j)
+            {
+                int pred = b->preds[j];
+                if (idom[pred] < 0)
+                    continue;
+                if (newIdom < 0)
+                {
+                    newIdom = pred;
+                    continue;
+                }
+
+                int first = pred;
+                int second = newIdom;
+                while (first != second)
+                {
+                    while (orderIndex[first] > orderIndex[second])
+                        first = idom[first];
+                    while (orderIndex[second] > orderIndex[first])
+                        second = idom[second];
+                }
+                newIdom = first;
+            }
+
+            if (idom[order[i]] != newIdom)
+            {
+                idom[order[i]] = newIdom;
+                changed = HS_TRUE;
+            }
+        }
+    }
+
+    free(orderIndex);
+    free(order);
+    return idom;
+}
+
+//------------------------------------------------------------------------------
+static Bool8 Dominates(const int* idom, int dominator, int block)
+{
+    while (block != dominator && block != 0)
+        block = idom[block];
+    return block == dominator;
+}
+
+//------------------------------------------------------------------------------
+// Evaluates the operation on constants the way the VM does, returns HS_FALSE when it would trap
+static Bool8 Evaluate(EIROp op, EIRType type, const SIRValue* first, const SIRValue* second, SIRValue* result)
+{
+    result->type = op >= IR_CMP_EQ ? IRT_BOOL : type;
+    if (op == IR_NOT)
+    {
+        result->intValue = 1 - first->intValue;
+        return HS_TRUE;
+    }
+
+    if (type == IRT_INT)
+    {
+        hsbint a = first->intValue;
+        hsbint b = second->intValue;
+        switch (op)
+        {
+            case IR_ADD: result->intValue = (hsbint)(a + b); return HS_TRUE;
+            case IR_SUBSTRACT: result->intValue = (hsbint)(a - b); return HS_TRUE;
+            case IR_MULTIPLY: result->intValue = (hsbint)(a * b); return HS_TRUE;
+            case IR_DIVIDE:
+                if (b == 0)
+                    return HS_FALSE;
+                result->intValue = (hsbint)(a / b);
+                return HS_TRUE;
+            case IR_CMP_EQ: result->intValue = a == b; return HS_TRUE;
+            case IR_CMP_LESS: result->intValue = a < b; return HS_TRUE;
+            case IR_CMP_LESS_EQ: result->intValue = a <= b; return HS_TRUE;
+            default: return HS_FALSE;
+        }
+    }
+
+    hsbfloat a = first->floatValue;
+    hsbfloat b = second->floatValue;
+    switch (op)
+    {
+        case IR_ADD: result->floatValue = a + b; return HS_TRUE;
+        case IR_SUBSTRACT: result->floatValue = a - b; return HS_TRUE;
+        case IR_MULTIPLY: result->floatValue = a * b; return HS_TRUE;
+        case IR_DIVIDE: result->floatValue = a / b; return HS_TRUE;
+        case IR_CMP_EQ: result->intValue = a == b; return HS_TRUE;
+        case IR_CMP_LESS: result->intValue = a < b; return HS_TRUE;
+        case IR_CMP_LESS_EQ: result->intValue = a <= b; return HS_TRUE;
+        default: return HS_FALSE;
+    }
+}
+
+//------------------------------------------------------------------------------
+Bool8 FoldConstants(SIRProgram* p)
+{
+    Bool8 changed = HS_FALSE;
+    for (int blockIndex = 0; blockIndex < p->blockCount; ++blockIndex)
+    {
+        SIRBlock* b = &p->blocks[blockIndex];
+        if (b->isRemoved)
+            continue;
+
+        for (int i = 0; i < b->valueCount; ++i)
+        {
+            SIRValue* v = &p->values[b->values[i]];
+            if (!IsBinary(v->op) && v->op != IR_NOT)
+                continue;
+
+            const SIRValue* first = &p->values[v->operands[0]];
+            const SIRValue* second = v->op == IR_NOT ? first : &p->values[v->operands[1]];
+            SIRValue result;
+            if (first->op == IR_CONST && second->op == IR_CONST && Evaluate(v->op, first->type, first, second, &result))
+            {
+                v->op = IR_CONST;
+                v->operands[0] = v->operands[1] = -1;
+                v->intValue = result.intValue;
+                if (result.type == IRT_FLOAT)
+                    v->floatValue = result.floatValue;
+                changed = HS_TRUE;
+            }
+        }
+
+        // The edges not taken go away, both successors of a branch can be the same block
+        if ((b->terminator == IR_BRANCH || b->terminator == IR_SWITCH) && p->values[b->condition].op == IR_CONST)
+        {
+            int taken = GetTakenSuccessor(b, p->values[b->condition].intValue);
+            for (int i = b->successorCount - 1; i >= 0; --i)
+            {
+                if (i != taken)
+                    RemovePredAt(p, b->successors[i], GetIRPredIndex(p, blockIndex, b->successors[i], GetIREdge(b, i)));
+            }
+
+            b->terminator = IR_JUMP;
+            b->successors[0] = b->successors[taken];
+            b->successorCount = 1;
+            b->caseCount = 0;
+            b->condition = -1;
+            changed = HS_TRUE;
+        }
+    }
+
+    return changed;
+}
+
+//------------------------------------------------------------------------------
+Bool8 RemoveUnreachableBlocks(SIRProgram* p)
+{
+    int* order = malloc(p->blockCount * sizeof(int));
+    Bool8* isReachable = calloc(p->blockCount, sizeof(Bool8));
+    int count = GetReversePostorder(p, order);
+    for (int i = 0; i < count; ++i)
+        isReachable[order[i]] = HS_TRUE;
+
+    Bool8 changed = HS_FALSE;
+    for (int blockIndex = 0; blockIndex < p->blockCount; ++blockIndex)
+    {
+        SIRBlock* b = &p->blocks[blockIndex];
+        if (b->isRemoved || isReachable[blockIndex])
+            continue;
+
+        for (int i = 0; i < b->successorCount; ++i)
+        {
+            SIRBlock* successor = &p->blocks[b->successors[i]];
+            for (int j = successor->predCount - 1; j >= 0; --j)
+            {
+                if (successor->preds[j] == blockIndex)
+                    RemovePredAt(p, b->successors[i], j);
+            }
+        }
+
+        while (b->valueCount > 0)
+            RemoveValue(p, b->values[b->valueCount - 1]);
+        b->isRemoved = HS_TRUE;
+        b->terminator = IR_END;
+        b->successorCount = 0;
+        b->caseCount = 0;
+        b->predCount = 0;
+        changed = HS_TRUE;
+    }
+
+    free(isReachable);
+    free(order);
+    return changed;
+}
+
+//------------------------------------------------------------------------------
+// The single value a phi merges apart from itself, -1 when it merges several
+static int GetTrivialPhiSource(const SIRProgram* p, int phi)
+{
+    const SIRValue* v = &p->values[phi];
+    const SIRBlock* b = &p->blocks[v->block];
+    int source = -1;
+    for (int i = 0; i < b->predCount; ++i)
+    {
+        int operand = v->phiOperands[i];
+        if (operand == phi || operand == source)
+            continue;
+        if (source >= 0)
+            return -1;
+        source = operand;
+    }
+    return source;
+}
+
+//------------------------------------------------------------------------------
+Bool8 PropagateCopies(SIRProgram* p)
+{
+    Bool8 changed = HS_FALSE;
+    for (int value = 0; value < p->valueCount; ++value)
+    {
+        const SIRValue* v = &p->values[value];
+        int source = v->op == IR_COPY ? v->operands[0] : v->op == IR_PHI ? GetTrivialPhiSource(p, value) : -1;
+        if (source < 0)
+            continue;
+
+        ReplaceUses(p, value, source);
+        RemoveValue(p, value);
+        changed = HS_TRUE;
+
+        // Phis merging the value with themselves may have become trivial
+        value = -1;
+    }
+
+    return changed;
+}
+
+//------------------------------------------------------------------------------
+static Bool8 IsSameComputation(const SIRValue* a, const SIRValue* b)
+{
+    if (a->op != b->op || a->type != b->type)
+        return HS_FALSE;
+    if (a->op == IR_CONST)
+        return a->type == IRT_FLOAT ? memcmp(&a->floatValue, &b->floatValue, sizeof(hsbfloat)) == 0 : a->intValue == b->intValue;
+    if (a->operands[0] == b->operands[0] && a->operands[1] == b->operands[1])
+        return HS_TRUE;
+
+    Bool8 isCommutative = a->op == IR_ADD || a->op == IR_MULTIPLY || a->op == IR_CMP_EQ;
+    return isCommutative && a->operands[0] == b->operands[1] && a->operands[1] == b->operands[0];
+}
+
+//------------------------------------------------------------------------------
+// Equal constants become one so the values computed from them match too. Bools are left
+// alone, lowering computes them again wherever they are used anyway.
+Bool8 EliminateCommonSubexpressions(SIRProgram* p)
+{
+    int* idom = ComputeDominators(p);
+    int* order = malloc(p->blockCount * sizeof(int));
+    int count = GetReversePostorder(p, order);
+    int* available = malloc(p->valueCount * sizeof(int));
+    int availableCount = 0;
+
+    Bool8 changed = HS_FALSE;
+    for (int i = 0; i < count; ++i)
+    {
+        SIRBlock* b = &p->blocks[order[i]];
+        for (int j = 0; j < b->valueCount; ++j)
+        {
+            int value = b->values[j];
+            const SIRValue* v = &p->values[value];
+            if ((!IsBinary(v->op) && v->op != IR_CONST) || v->type == IRT_BOOL)
+                continue;
+
+            int equal = -1;
+            for (int k = 0; k < availableCount && equal < 0; ++k)
+            {
+                const SIRValue* candidate = &p->values[available[k]];
+                if (candidate->op != IR_REMOVED && IsSameComputation(candidate, v)
+                    && Dominates(idom, candidate->block, v->block))
+                {
+                    equal = available[k];
+                }
+            }
+
+            if (equal < 0)
+            {
+                available[availableCount++] = value;
+                continue;
+            }
+
+            ReplaceUses(p, value, equal);
+            RemoveValue(p, value);
+            --j;
+            changed = HS_TRUE;
+        }
+    }
+
+    free(available);
+    free(order);
+    free(idom);
+    return changed;
+}
+
+//------------------------------------------------------------------------------
+static Bool8 IsHoistable(const SIRProgram* p, const SIRValue* v)
+{
+    if (!IsBinary(v->op) || v->type == IRT_BOOL)
+        return HS_FALSE;
+    if (v->op != IR_DIVIDE || v->type != IRT_INT)
+        return HS_TRUE;
+
+    const SIRValue* divisor = &p->values[v->operands[1]];
+    return divisor->op == IR_CONST && divisor->intValue != 0;
+}
+
+//------------------------------------------------------------------------------
+// Constants are wherever they are used first, but the same on every iteration
+static Bool8 IsInvariant(const SIRProgram* p, const Bool8* isInLoop, int value)
+{
+    return p->values[value].op == IR_CONST || !isInLoop[p->values[value].block];
+}
+
+//------------------------------------------------------------------------------
+// Hoists out of the loop closed by the back edge from latch to header
+static Bool8 HoistLoop(SIRProgram* p, int header, int latch)
+{
+    // The loop is the header and whatever reaches the latch without passing the header
+    Bool8* isInLoop = calloc(p->blockCount, sizeof(Bool8));
+    int* stack = malloc(p->blockCount * sizeof(int));
+    int depth = 0;
+    isInLoop[header] = HS_TRUE;
+    if (!isInLoop[latch])
+    {
+        isInLoop[latch] = HS_TRUE;
+        stack[depth++] = latch;
+    }
+    while (depth > 0)
+    {
+        const SIRBlock* b = &p->blocks[stack[--depth]];
+        for (int i = 0; i < b->predCount; ++i)
+        {
+            if (!isInLoop[b->preds[i]])
+            {
+                isInLoop[b->preds[i]] = HS_TRUE;
+                stack[depth++] = b->preds[i];
+            }
+        }
+    }
+
+    // A single block enters the loop and goes nowhere else
+    int preheader = -1;
+    const SIRBlock* h = &p->blocks[header];
+    for (int i = 0; i < h->predCount; ++i)
+    {
+        if (isInLoop[h->preds[i]])
+            continue;
+        if (preheader >= 0 && preheader != h->preds[i])
+        {
+            preheader = -1;
+            break;
+        }
+        preheader = h->preds[i];
+    }
+
+    Bool8 changed = HS_FALSE;
+    if (preheader >= 0 && p->blocks[preheader].terminator == IR_JUMP)
+    {
+        for (int block = 0; block < p->blockCount; ++block)
+        {
+            if (!isInLoop[block])
+                continue;
+
+            SIRBlock* b = &p->blocks[block];
+            for (int i = 0; i < b->valueCount; ++i)
+            {
+                int value = b->values[i];
+                SIRValue* v = &p->values[value];
+                if (!IsHoistable(p, v) || !IsInvariant(p, isInLoop, v->operands[0]) || !IsInvariant(p, isInLoop, v->operands[1]))
+                    continue;
+
+                memmove(b->values + i, b->values + i + 1, (b->valueCount - i - 1) * sizeof(int));
+                --b->valueCount;
+                --i;
+
+                SIRBlock* target = &p->blocks[preheader];
+                if (target->valueCount == target->valueCapacity)
+                {
+                    target->valueCapacity = target->valueCapacity ? target->valueCapacity * 2 : 8;
+                    target->values = realloc(target->values, target->valueCapacity * sizeof(int));
+                }
+                target->values[target->valueCount++] = value;
+                v->block = preheader;
+                changed = HS_TRUE;
+            }
+        }
+    }
+
+    free(stack);
+    free(isInLoop);
+    return changed;
+}
+
+//------------------------------------------------------------------------------
+Bool8 HoistLoopInvariants(SIRProgram* p)
+{
+    int* idom = ComputeDominators(p);
+    Bool8 changed = HS_FALSE;
+    for (int block = 0; block < p->blockCount; ++block)
+    {
+        const SIRBlock* b = &p->blocks[block];
+        if (b->isRemoved || idom[block] < 0)
+            continue;
+
+        for (int i = 0; i < b->successorCount; ++i)
+        {
+            if (Dominates(idom, b->successors[i], block))
+                changed |= HoistLoop(p, b->successors[i], block);
+        }
+    }
+
+    free(idom);
+    return changed;
+}
+
+//------------------------------------------------------------------------------
+Bool8 EliminateDeadCode(SIRProgram* p)
+{
+    Bool8* isLive = calloc(p->valueCount, sizeof(Bool8));
+    int* worklist = malloc(p->valueCount * sizeof(int));
+    int count = 0;
+
+    for (int i = 0; i < p->globalCount; ++i)
+    {
+        if (!isLive[p->globals[i]])
+        {
+            isLive[p->globals[i]] = HS_TRUE;
+            worklist[count++] = p->globals[i];
+        }
+    }
+    for (int block = 0; block < p->blockCount; ++block)
+    {
+        const SIRBlock* b = &p->blocks[block];
+        if (!b->isRemoved && (b->terminator == IR_BRANCH || b->terminator == IR_SWITCH) && !isLive[b->condition])
+        {
+            isLive[b->condition] = HS_TRUE;
+            worklist[count++] = b->condition;
+        }
+    }
+
+    while (count > 0)
+    {
+        const SIRValue* v = &p->values[worklist[--count]];
+        int operandCount = v->op == IR_PHI ? p->blocks[v->block].predCount : 2;
+        for (int i = 0; i < operandCount; ++i)
+        {
+            int operand = v->op == IR_PHI ? v->phiOperands[i] : v->operands[i];
+            if (operand >= 0 && !isLive[operand])
+            {
+                isLive[operand] = HS_TRUE;
+                worklist[count++] = operand;
+            }
+        }
+    }
+
+    Bool8 changed = HS_FALSE;
+    for (int value = 0; value < p->valueCount; ++value)
+    {
+        if (!isLive[value] && p->values[value].op != IR_REMOVED)
+        {
+            RemoveValue(p, value);
+            changed = HS_TRUE;
+        }
+    }
+
+    free(worklist);
+    free(isLive);
+    return changed;
+}
+
+//------------------------------------------------------------------------------
+void OptimizeIR(SIRProgram* program)
+{
+    Bool8 changed = HS_TRUE;
+    while (changed)
+    {
+        changed = FoldConstants(program);
+        changed |= RemoveUnreachableBlocks(program);
+        changed |= PropagateCopies(program);
+        changed |= EliminateCommonSubexpressions(program);
+        changed |= HoistLoopInvariants(program);
+        changed |= EliminateDeadCode(program);
+    }
+}
@@ -0,0 +1,305 @@
+#include "ir.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+//------------------------------------------------------------------------------
+int GetIRPredIndex(const SIRProgram* p, int from, int to, int edge)
+{
+    const SIRBlock* b = &p->blocks[to];
+    for (int i = 0; i < b->predCount; ++i)
+    {
+        if (b->preds[i] == from && edge-- == 0)
+            return i;
+    }
+    return -1;
+}
+
+//------------------------------------------------------------------------------
+int GetIREdge(const SIRBlock* b, int successorIndex)
+{
+    int edge = 0;
+    for (int i = 0; i < successorIndex; ++i)
+        edge += b->successors[i] == b->successors[successorIndex];
+    return edge;
+}
+
+//------------------------------------------------------------------------------
+int GetIRLayout(const SIRProgram* p, int* outOrder)
+{
+    Bool8* isVisited = calloc(p->blockCount, sizeof(Bool8));
+    int* stack = malloc(p->blockCount * sizeof(int));
+    int* nextSuccessor = calloc(p->blockCount, sizeof(int));
+
+    int count = 0;
+    int depth = 0;
+    stack[depth++] = 0;
+    isVisited[0] = HS_TRUE;
+    while (depth > 0)
+    {
+        int block = stack[depth - 1];
+        const SIRBlock* b = &p->blocks[block];
+        if (nextSuccessor[block] < b->successorCount)
+        {
+            int successor = b->successors[b->successorCount - 1 - nextSuccessor[block]++];
+            if (!isVisited[successor])
+            {
+                isVisited[successor] = HS_TRUE;
+                stack[depth++] = successor;
+            }
+            continue;
+        }
+
+        outOrder[count++] = block;
+        --depth;
+    }
+
+    for (int i = 0; i < count / 2; ++i)
+    {
+        int block = outOrder[i];
+        outOrder[i] = outOrder[count - 1 - i];
+        outOrder[count - 1 - i] = block;
+    }
+
+    free(nextSuccessor);
+    free(stack);
+    free(isVisited);
+    return count;
+}
+
+//------------------------------------------------------------------------------
+// Values with a variable, indexed densely, and what is live where among them
+typedef struct
+{
+    const SIRProgram* program;
+    int* indices; // Of every value, -1 for the ones computed where they are used
+    int* values;
+    int count;
+    int words; // Per set
+
+    unsigned* liveIn; // Per block, without its phis
+    unsigned* live;
+    Bool8* interferes; // count * count
+} SIRLiveness;
+
+//------------------------------------------------------------------------------
+static void AddLeaves(SIRLiveness* s, int value);
+
+//------------------------------------------------------------------------------
+// Adds the values with a variable the value is computed from
+static void AddOperandLeaves(SIRLiveness* s, int value)
+{
+    const SIRValue* v = &s->program->values[value];
+    if (v->op == IR_CONST || v->op == IR_PHI)
+        return;
+    AddLeaves(s, v->operands[0]);
+    if (v->op != IR_NOT && v->op != IR_COPY)
+        AddLeaves(s, v->operands[1]);
+}
+
+//------------------------------------------------------------------------------
+// Adds the value if it has a variable, what it is computed from where it is used otherwise
+static void AddLeaves(SIRLiveness* s, int value)
+{
+    if (s->indices[value] >= 0)
+        s->live[s->indices[value] / 32] |= 1u << (s->indices[value] % 32);
+    else
+        AddOperandLeaves(s, value);
+}
+
+//------------------------------------------------------------------------------
+static void Define(SIRLiveness* s, int value, Bool8 isRecorded)
+{
+    int index = s->indices[value];
+    s->live[index / 32] &= ~(1u << (index % 32));
+    for (int i = 0; i < s->count && isRecorded; ++i)
+    {
+        if (s->live[i / 32] & (1u << (i % 32)))
+            s->interferes[index * s->count + i] = s->interferes[i * s->count + index] = HS_TRUE;
+    }
+}
+
+//------------------------------------------------------------------------------
+// Walks the block backwards from its end, returns whether its live in set changed
+static Bool8 ScanBlock(SIRLiveness* s, int block, int endBlock, Bool8 isRecorded)
+{
+    const SIRProgram* p = s->program;
+    const SIRBlock* b = &p->blocks[block];
+    memset(s->live, 0, s->words * sizeof(unsigned));
+
+    // The phi copies, the condition and the globals are used at the end
+    for (int i = 0; i < b->successorCount; ++i)
+    {
+        int to = b->successors[i];
+        const SIRBlock* successor = &p->blocks[to];
+        int predIndex = GetIRPredIndex(p, block, to, GetIREdge(b, i));
+        for (int j = 0; j < s->words; ++j)
+            s->live[j] |= s->liveIn[to * s->words + j];
+        for (int j = 0; j < successor->valueCount && p->values[successor->values[j]].op == IR_PHI; ++j)
+        {
+            if (s->indices[successor->values[j]] >= 0)
+                AddLeaves(s, p->values[successor->values[j]].phiOperands[predIndex]);
+        }
+    }
+    if (b->terminator == IR_BRANCH || b->terminator == IR_SWITCH)
+        AddLeaves(s, b->condition);
+    for (int i = 0; i < p->globalCount && block == endBlock; ++i)
+        AddLeaves(s, p->globals[i]);
+
+    for (int i = b->valueCount - 1; i >= 0; --i)
+    {
+        int value = b->values[i];
+        if (s->indices[value] < 0 || p->values[value].op == IR_PHI)
+            continue;
+
+        Define(s, value, isRecorded);
+        AddOperandLeaves(s, value);
+    }
+
+    // Phis are written together before the block, with whatever else lives into it
+    for (int i = 0; i < b->valueCount && p->values[b->values[i]].op == IR_PHI; ++i)
+    {
+        if (s->indices[b->values[i]] >= 0)
+            Define(s, b->values[i], HS_FALSE);
+    }
+    for (int i = 0; i < b->valueCount && p->values[b->values[i]].op == IR_PHI && isRecorded; ++i)
+    {
+        int phi = s->indices[b->values[i]];
+        for (int j = 0; j < s->count && phi >= 0; ++j)
+        {
+            int other = s->values[j];
+            Bool8 isSiblingPhi = p->values[other].op == IR_PHI && p->values[other].block == block && j != phi;
+            if (isSiblingPhi || (s->live[j / 32] & (1u << (j % 32))))
+                s->interferes[phi * s->count + j] = s->interferes[j * s->count + phi] = HS_TRUE;
+        }
+    }
+
+    unsigned* liveIn = &s->liveIn[block * s->words];
+    Bool8 changed = memcmp(liveIn, s->live, s->words * sizeof(unsigned)) != 0;
+    memcpy(liveIn, s->live, s->words * sizeof(unsigned));
+    return changed;
+}
+
+//------------------------------------------------------------------------------
+static int FindClass(int* classes, int index)
+{
+    while (classes[index] != index)
+        index = classes[index] = classes[classes[index]];
+    return index;
+}
+
+//------------------------------------------------------------------------------
+// The merged class interferes with whatever either of them did
+static void MergeClasses(SIRLiveness* s, int* classes, int first, int second)
+{
+    classes[second] = first;
+    for (int i = 0; i < s->count; ++i)
+    {
+        Bool8 interferes = s->interferes[first * s->count + i] || s->interferes[second * s->count + i];
+        s->interferes[first * s->count + i] = s->interferes[i * s->count + first] = interferes;
+    }
+}
+
+//------------------------------------------------------------------------------
+int AssignIRVariables(const SIRProgram* program, const Bool8* hasVariable, Bool8 isReused, int* outVariables)
+{
+    const SIRProgram* p = program;
+    int endBlock = 0;
+    for (int block = 0; block < p->blockCount; ++block)
+    {
+        if (!p->blocks[block].isRemoved && p->blocks[block].terminator == IR_END)
+            endBlock = block;
+    }
+
+    SIRLiveness s = { .program = p };
+    s.indices = malloc((p->valueCount + 1) * sizeof(int));
+    s.values = malloc((p->valueCount + 1) * sizeof(int));
+    for (int value = 0; value < p->valueCount; ++value)
+    {
+        s.indices[value] = hasVariable[value] ? s.count : -1;
+        if (hasVariable[value])
+            s.values[s.count++] = value;
+    }
+
+    s.words = s.count / 32 + 1;
+    s.liveIn = calloc(p->blockCount * s.words, sizeof(unsigned));
+    s.live = malloc(s.words * sizeof(unsigned));
+    s.interferes = calloc(s.count * s.count + 1, sizeof(Bool8));
+
+    Bool8 changed = HS_TRUE;
+    while (changed)
+    {
+        changed = HS_FALSE;
+        for (int block = p->blockCount - 1; block >= 0; --block)
+            changed |= !p->blocks[block].isRemoved && ScanBlock(&s, block, endBlock, HS_FALSE);
+    }
+    for (int block = 0; block < p->blockCount; ++block)
+    {
+        if (!p->blocks[block].isRemoved)
+            ScanBlock(&s, block, endBlock, HS_TRUE);
+    }
+
+    int* classes = malloc((s.count + 1) * sizeof(int));
+    for (int i = 0; i < s.count; ++i)
+        classes[i] = i;
+    for (int i = 0; i < s.count; ++i)
+    {
+        const SIRValue* phi = &p->values[s.values[i]];
+        for (int j = 0; phi->op == IR_PHI && j < p->blocks[phi->block].predCount; ++j)
+        {
+            int operand = s.indices[phi->phiOperands[j]];
+            if (operand < 0)
+                continue;
+
+            int first = FindClass(classes, i);
+            int second = FindClass(classes, operand);
+            if (first != second && !s.interferes[first * s.count + second])
+                MergeClasses(&s, classes, first, second);
+        }
+    }
+
+    // The globals get theirs first, then the other classes take the first one free of
+    // interference when variables are reused or a new one otherwise
+    int* classVariables = malloc((s.count + 1) * sizeof(int));
+    for (int i = 0; i < s.count; ++i)
+        classVariables[i] = -1;
+    for (int i = 0; i < p->globalCount; ++i)
+    {
+        int index = s.indices[p->globals[i]];
+        if (index >= 0 && classVariables[FindClass(classes, index)] < 0)
+            classVariables[FindClass(classes, index)] = i;
+    }
+
+    int variableCount = p->globalCount;
+    for (int i = 0; i < s.count; ++i)
+    {
+        int root = FindClass(classes, i);
+        if (classVariables[root] >= 0)
+            continue;
+
+        int variable = isReused ? 0 : variableCount;
+        for (int j = 0; j < s.count && isReused; ++j)
+        {
+            int other = FindClass(classes, j);
+            if (classVariables[other] == variable && s.interferes[root * s.count + other])
+            {
+                ++variable;
+                j = -1;
+            }
+        }
+        classVariables[root] = variable;
+        variableCount = variable + 1 > variableCount ? variable + 1 : variableCount;
+    }
+
+    for (int value = 0; value < p->valueCount; ++value)
+        outVariables[value] = s.indices[value] >= 0 ? classVariables[FindClass(classes, s.indices[value])] : -1;
+
+    free(classVariables);
+    free(classes);
+    free(s.interferes);
+    free(s.live);
+    free(s.liveIn);
+    free(s.values);
+    free(s.indices);
+    return variableCount;
+}
@@ -0,0 +1,589 @@
+#if defined(__linux__)
+    // MAP_ANONYMOUS is not part of C99
+    #define _DEFAULT_SOURCE
+#endif
+
+#include "jit.h"
+#include "bytecode_c.h"
+#include "bytecode_info.h"
+#include "verifier.h"
+
+#include <stddef.h>
+#include <stdio.h>
+
+#if HS_JIT_SUPPORTED
+
+#include <sys/mman.h>
+
+// Register use of the generated code:
+// rdi - SVMData*, rsi - operand stack pointer, rdx - variable area pointer (reversePointer),
+// r8 - SJitCode::entries, rax/rcx/xmm0/xmm1 - values, r10 - saves rdx around idiv
+
+//------------------------------------------------------------------------------
+typedef enum
+{
+    PATCH_IMMEDIATE,  // imm32, the literal of the instruction
+    PATCH_VAR,        // disp32, the first variable offset
+    PATCH_SECOND_VAR, // disp32, the second variable offset
+    PATCH_TARGET,     // rel32, the instruction at the address operand
+    PATCH_NEXT,       // imm32, address of the next instruction (return address of INS_CALL)
+    PATCH_SELF,       // imm32, address of the instruction
+    PATCH_NATIVE,     // disp32, offset of the native function in FuncArray::begin
+} EPatch;
+
+//------------------------------------------------------------------------------
+typedef enum
+{
+    TYPE_INT,
+    TYPE_FLOAT,
+    TYPE_BOOL,
+} EType;
+
+#define MAX_TEMPLATE_SIZE 64
+#define MAX_PATCHES 3
+
+//------------------------------------------------------------------------------
+typedef struct
+{
+    byte code[MAX_TEMPLATE_SIZE];
+    int size;
+    int patchCount;
+    byte patchOffsets[MAX_PATCHES];
+    byte patchKinds[MAX_PATCHES];
+} STemplate;
+
+static STemplate s_templates[INS_COUNT];
+static STemplate s_prologue;
+static int s_prologueEntries; // Position of the SJitCode::entries immediate in the prologue
+static Bool8 s_hasTemplates;
+
+//------------------------------------------------------------------------------
+static void EmitBytes(STemplate* t, const byte* bytes, int count)
+{
+    memcpy(t->code + t->size, bytes, count);
+    t->size += count;
+}
+
+#define EMIT(t, ...) EmitBytes(t, (const byte[]){ __VA_ARGS__ }, sizeof((const byte[]){ __VA_ARGS__ }))
+
+//------------------------------------------------------------------------------
+static void EmitInt32(STemplate* t, int value)
+{
+    memcpy(t->code + t->size, &value, 4);
+    t->size += 4;
+}
+
+//------------------------------------------------------------------------------
+// A 4 byte field filled in for each instruction
+static void Hole(STemplate* t, EPatch kind)
+{
+    t->patchOffsets[t->patchCount] = t->size;
+    t->patchKinds[t->patchCount] = kind;
+    ++t->patchCount;
+    EmitInt32(t, 0);
+}
+
+//------------------------------------------------------------------------------
+static int TypeSize(EType type)
+{
+    switch (type)
+    {
+        case TYPE_INT: return HS_DATA_SIZE_INT;
+        case TYPE_FLOAT: return HS_DATA_SIZE_FLOAT;
+        default: return HS_DATA_SIZE_BOOL;
+    }
+}
+
+//------------------------------------------------------------------------------
+// eax/ecx (reg 0/1) or xmm0/xmm1 = operand at [rsi + offset]
+static void LoadOperand(STemplate* t, EType type, int reg, int offset)
+{
+    byte modrm = 0x46 | reg << 3;
+    switch (type)
+    {
+        case TYPE_INT: EMIT(t, 0x0F, 0xBF, modrm, (byte)offset); break;    // movsx r32, word
+        case TYPE_FLOAT: EMIT(t, 0xF3, 0x0F, 0x10, modrm, (byte)offset); break; // movss
+        case TYPE_BOOL: EMIT(t, 0x0F, 0xB6, modrm, (byte)offset); break;   // movzx r32, byte
+    }
+}
+
+//------------------------------------------------------------------------------
+// [rsi + offset] = eax or xmm0, whole slots with zeroed padding in slot mode
+static void StoreOperand(STemplate* t, EType type, int offset)
+{
+#ifdef HS_SLOT_STACK
+    switch (type)
+    {
+        case TYPE_INT: EMIT(t, 0x0F, 0xB7, 0xC0); break;         // movzx eax, ax
+        case TYPE_FLOAT: EMIT(t, 0x66, 0x0F, 0x7E, 0xC0); break; // movd eax, xmm0
+        case TYPE_BOOL: EMIT(t, 0x0F, 0xB6, 0xC0); break;        // movzx eax, al
+    }
+    EMIT(t, 0x48, 0x89, 0x46, (byte)offset);                      // mov [rsi + offset], rax
+#else
+    switch (type)
+    {
+        case TYPE_INT: EMIT(t, 0x66, 0x89, 0x46, (byte)offset); break;
+        case TYPE_FLOAT: EMIT(t, 0xF3, 0x0F, 0x11, 0x46, (byte)offset); break;
+        case TYPE_BOOL: EMIT(t, 0x88, 0x46, (byte)offset); break;
+    }
+#endif
+}
+
+//------------------------------------------------------------------------------
+static void AdjustOperands(STemplate* t, int delta)
+{
+    if (delta > 0)
+        EMIT(t, 0x48, 0x83, 0xC6, (byte)delta);  // add rsi, delta
+    else if (delta < 0)
+        EMIT(t, 0x48, 0x83, 0xEE, (byte)-delta); // sub rsi, -delta
+}
+
+//------------------------------------------------------------------------------
+// eax/ecx or xmm0/xmm1 = variable at [rdx + operand]
+static void LoadVar(STemplate* t, EType type, int reg, EPatch operand)
+{
+    byte modrm = 0x82 | reg << 3;
+    if (type == TYPE_FLOAT)
+        EMIT(t, 0xF3, 0x0F, 0x10, modrm);
+    else
+        EMIT(t, 0x0F, 0xBF, modrm);
+    Hole(t, operand);
+}
+
+//------------------------------------------------------------------------------
+// [rdx + operand] = eax or xmm0
+static void StoreVar(STemplate* t, EType type, EPatch operand)
+{
+#ifdef HS_SLOT_STACK
+    if (type == TYPE_FLOAT)
+        EMIT(t, 0x66, 0x0F, 0x7E, 0xC0);
+    else
+        EMIT(t, 0x0F, 0xB7, 0xC0);
+    EMIT(t, 0x48, 0x89, 0x82);
+#else
+    if (type == TYPE_FLOAT)
+        EMIT(t, 0xF3, 0x0F, 0x11, 0x82);
+    else
+        EMIT(t, 0x66, 0x89, 0x82);
+#endif
+    Hole(t, operand);
+}
+
+//------------------------------------------------------------------------------
+// Pops two operands into eax/ecx or xmm0/xmm1, applies the op bytes and pushes the result
+static void Binary(STemplate* t, EType operandType, EType resultType, const byte* op, int opSize)
+{
+    int size = TypeSize(operandType);
+    LoadOperand(t, operandType, 1, -size);
+    LoadOperand(t, operandType, 0, -2 * size);
+    EmitBytes(t, op, opSize);
+    StoreOperand(t, resultType, -2 * size);
+    AdjustOperands(t, TypeSize(resultType) - 2 * size);
+}
+
+#define BINARY(t, operandType, resultType, ...) \
+    Binary(t, operandType, resultType, (const byte[]){ __VA_ARGS__ }, sizeof((const byte[]){ __VA_ARGS__ }))
+
+//------------------------------------------------------------------------------
+static void PushLiteral(STemplate* t, EType type)
+{
+    EMIT(t, 0xB8); // mov eax, imm32
+    Hole(t, PATCH_IMMEDIATE);
+    if (type == TYPE_FLOAT)
+        EMIT(t, 0x66, 0x0F, 0x6E, 0xC0); // movd xmm0, eax
+    StoreOperand(t, type, 0);
+    AdjustOperands(t, TypeSize(type));
+}
+
+//------------------------------------------------------------------------------
+static void AllocVar(STemplate* t, int size)
+{
+    EMIT(t, 0x48, 0x83, 0xEA, (byte)size); // sub rdx, size
+    // zero the variable, as the interpreter does
+    if (size == 8)
+        EMIT(t, 0x48, 0xC7, 0x02, 0, 0, 0, 0);
+    else if (size == 4)
+        EMIT(t, 0xC7, 0x02, 0, 0, 0, 0);
+    else
+        EMIT(t, 0x66, 0xC7, 0x02, 0, 0);
+}
+
+//------------------------------------------------------------------------------
+static void CompareJump(STemplate* t, byte condition)
+{
+    const int I = HS_DATA_SIZE_INT;
+    LoadOperand(t, TYPE_INT, 1, -I);
+    LoadOperand(t, TYPE_INT, 0, -2 * I);
+    AdjustOperands(t, -2 * I);
+    EMIT(t, 0x39, 0xC8, 0x0F, condition); // cmp eax, ecx; jcc rel32
+    Hole(t, PATCH_TARGET);
+}
+
+//------------------------------------------------------------------------------
+static void BuildTemplates()
+{
+    const int stackPointer = offsetof(SVMData, dataStack.base.stackPointer);
+    const int reversePointer = offsetof(SVMData, dataStack.reversePointer);
+    const int insBegin = offsetof(SVMData, instructionStack.begin);
+    const int insPointer = offsetof(SVMData, instructionStack.stackPointer);
+    const int functions = offsetof(SVMData, functions.begin);
+
+    // Load the stack pointers and jump to the current instruction
+    STemplate* t = &s_prologue;
+    EMIT(t, 0x48, 0x8B, 0xB7); EmitInt32(t, stackPointer);     // mov rsi, [rdi + stackPointer]
+    EMIT(t, 0x48, 0x8B, 0x97); EmitInt32(t, reversePointer);   // mov rdx, [rdi + reversePointer]
+    EMIT(t, 0x49, 0xB8);                                        // mov r8, entries (patched by JitCompile)
+    s_prologueEntries = t->size;
+    EmitInt32(t, 0);
+    EmitInt32(t, 0);
+    EMIT(t, 0x48, 0x8B, 0x87); EmitInt32(t, insPointer);       // mov rax, [rdi + insPointer]
+    EMIT(t, 0x48, 0x2B, 0x87); EmitInt32(t, insBegin);         // sub rax, [rdi + insBegin]
+    EMIT(t, 0x41, 0xFF, 0x24, 0xC0);                           // jmp [r8 + rax * 8]
+
+    const int I = HS_DATA_SIZE_INT;
+    const int F = HS_DATA_SIZE_FLOAT;
+    const int B = HS_DATA_SIZE_BOOL;
+    const int A = HS_DATA_SIZE_ADDRESS;
+
+    BINARY(&s_templates[INS_ADD_I], TYPE_INT, TYPE_INT, 0x01, 0xC8);             // add eax, ecx
+    BINARY(&s_templates[INS_SUBSTRACT_I], TYPE_INT, TYPE_INT, 0x29, 0xC8);       // sub eax, ecx
+    BINARY(&s_templates[INS_MULTIPLY_I], TYPE_INT, TYPE_INT, 0x0F, 0xAF, 0xC1);  // imul eax, ecx
+    // mov r10, rdx; cdq; idiv ecx; mov rdx, r10
+    BINARY(&s_templates[INS_DIVIDE_I], TYPE_INT, TYPE_INT, 0x49, 0x89, 0xD2, 0x99, 0xF7, 0xF9, 0x4C, 0x89, 0xD2);
+    BINARY(&s_templates[INS_ADD_F], TYPE_FLOAT, TYPE_FLOAT, 0xF3, 0x0F, 0x58, 0xC1);       // addss
+    BINARY(&s_templates[INS_SUBSTRACT_F], TYPE_FLOAT, TYPE_FLOAT, 0xF3, 0x0F, 0x5C, 0xC1); // subss
+    BINARY(&s_templates[INS_MULTIPLY_F], TYPE_FLOAT, TYPE_FLOAT, 0xF3, 0x0F, 0x59, 0xC1);  // mulss
+    BINARY(&s_templates[INS_DIVIDE_F], TYPE_FLOAT, TYPE_FLOAT, 0xF3, 0x0F, 0x5E, 0xC1);    // divss
+
+    PushLiteral(&s_templates[INS_LITERAL_I], TYPE_INT);
+    PushLiteral(&s_templates[INS_LITERAL_F], TYPE_FLOAT);
+    PushLiteral(&s_templates[INS_LITERAL_B], TYPE_BOOL);
+
+    t = &s_templates[INS_NEGATE_B];
+    LoadOperand(t, TYPE_BOOL, 0, -B);
+    EMIT(t, 0x34, 0x01); // xor al, 1
+    StoreOperand(t, TYPE_BOOL, -B);
+
+    BINARY(&s_templates[INS_AND_B], TYPE_BOOL, TYPE_BOOL, 0x20, 0xC8); // and al, cl
+    BINARY(&s_templates[INS_OR_B], TYPE_BOOL, TYPE_BOOL, 0x08, 0xC8);  // or al, cl
+
+    // cmp eax, ecx; setcc al
+    BINARY(&s_templates[INS_CMP_I_EQ], TYPE_INT, TYPE_BOOL, 0x39, 0xC8, 0x0F, 0x94, 0xC0);
+    BINARY(&s_templates[INS_CMP_I_LESS], TYPE_INT, TYPE_BOOL, 0x39, 0xC8, 0x0F, 0x9C, 0xC0);
+    BINARY(&s_templates[INS_CMP_I_LESS_EQ], TYPE_INT, TYPE_BOOL, 0x39, 0xC8, 0x0F, 0x9E, 0xC0);
+    // unordered (NaN) compares false like in C: ucomiss xmm0, xmm1; sete al; setnp cl; and al, cl
+    BINARY(&s_templates[INS_CMP_F_EQ], TYPE_FLOAT, TYPE_BOOL, 0x0F, 0x2E, 0xC1, 0x0F, 0x94, 0xC0, 0x0F, 0x9B, 0xC1, 0x20, 0xC8);
+    // ucomiss xmm1, xmm0; seta al / setae al
+    BINARY(&s_templates[INS_CMP_F_LESS], TYPE_FLOAT, TYPE_BOOL, 0x0F, 0x2E, 0xC8, 0x0F, 0x97, 0xC0);
+    BINARY(&s_templates[INS_CMP_F_LESS_EQ], TYPE_FLOAT, TYPE_BOOL, 0x0F, 0x2E, 0xC8, 0x0F, 0x93, 0xC0);
+
+    AllocVar(&s_templates[INS_ALLOC_VAR_I], I);
+    AllocVar(&s_templates[INS_ALLOC_VAR_F], F);
+    EMIT(&s_templates[INS_DEALLOC_VAR_I], 0x48, 0x83, 0xC2, (byte)I); // add rdx, size
+    EMIT(&s_templates[INS_DEALLOC_VAR_F], 0x48, 0x83, 0xC2, (byte)F);
+
+    t = &s_templates[INS_SAVE_VAR_I];
+    LoadOperand(t, TYPE_INT, 0, -I);
+    AdjustOperands(t, -I);
+    StoreVar(t, TYPE_INT, PATCH_VAR);
+
+    t = &s_templates[INS_SAVE_VAR_F];
+    LoadOperand(t, TYPE_FLOAT, 0, -F);
+    AdjustOperands(t, -F);
+    StoreVar(t, TYPE_FLOAT, PATCH_VAR);
+
+    t = &s_templates[INS_LOAD_VAR_I];
+    LoadVar(t, TYPE_INT, 0, PATCH_VAR);
+    StoreOperand(t, TYPE_INT, 0);
+    AdjustOperands(t, I);
+
+    t = &s_templates[INS_LOAD_VAR_F];
+    LoadVar(t, TYPE_FLOAT, 0, PATCH_VAR);
+    StoreOperand(t, TYPE_FLOAT, 0);
+    AdjustOperands(t, F);
+
+    t = &s_templates[INS_JUMP];
+    EMIT(t, 0xE9); // jmp rel32
+    Hole(t, PATCH_TARGET);
+
+    t = &s_templates[INS_COND_JUMP_B];
+    LoadOperand(t, TYPE_BOOL, 0, -B);
+    AdjustOperands(t, -B);
+    EMIT(t, 0x84, 0xC0, 0x0F, 0x85); // test al, al; jnz rel32
+    Hole(t, PATCH_TARGET);
+
+    // The return address is the address of the next instruction, as SaveInsStackPointerVar stores it
+    t = &s_templates[INS_CALL];
+    EMIT(t, 0x48, 0x83, 0xEA, (byte)A); // sub rdx, A
+    EMIT(t, 0xB8);                      // mov eax, next
+    Hole(t, PATCH_NEXT);
+#ifdef HS_SLOT_STACK
+    EMIT(t, 0x48, 0x89, 0x02);          // mov [rdx], rax
+#else
+    EMIT(t, 0x66, 0x89, 0x02);          // mov [rdx], ax
+#endif
+    EMIT(t, 0xE9);
+    Hole(t, PATCH_TARGET);
+
+    t = &s_templates[INS_RETURN];
+    EMIT(t, 0x0F, 0xB7, 0x02);          // movzx eax, word [rdx]
+    EMIT(t, 0x48, 0x83, 0xC2, (byte)A); // add rdx, A
+    EMIT(t, 0x41, 0xFF, 0x24, 0xC0);    // jmp [r8 + rax * 8]
+
+    // Store the stack pointers, stay on the instruction like the interpreter
+    t = &s_templates[INS_END];
+    EMIT(t, 0x48, 0x89, 0xB7); EmitInt32(t, stackPointer);   // mov [rdi + stackPointer], rsi
+    EMIT(t, 0x48, 0x89, 0x97); EmitInt32(t, reversePointer); // mov [rdi + reversePointer], rdx
+    EMIT(t, 0x48, 0x8B, 0x87); EmitInt32(t, insBegin);       // mov rax, [rdi + insBegin]
+    EMIT(t, 0x48, 0x05); Hole(t, PATCH_SELF);                // add rax, self
+    EMIT(t, 0x48, 0x89, 0x87); EmitInt32(t, insPointer);     // mov [rdi + insPointer], rax
+    EMIT(t, 0xC3);                                           // ret
+
+    // The native works on the stack pointers in SVMData. rdi and r8 are saved around the call,
+    // which keeps the stack 16 byte aligned with the padding.
+    t = &s_templates[INS_CALL_EXT];
+    EMIT(t, 0x48, 0x89, 0xB7); EmitInt32(t, stackPointer);   // mov [rdi + stackPointer], rsi
+    EMIT(t, 0x48, 0x89, 0x97); EmitInt32(t, reversePointer); // mov [rdi + reversePointer], rdx
+    EMIT(t, 0x57, 0x41, 0x50);                               // push rdi; push r8
+    EMIT(t, 0x48, 0x83, 0xEC, 0x08);                         // sub rsp, 8
+    EMIT(t, 0x48, 0x8B, 0x87); EmitInt32(t, functions);      // mov rax, [rdi + functions]
+    EMIT(t, 0xFF, 0x90);                                     // call [rax + native]
+    Hole(t, PATCH_NATIVE);
+    EMIT(t, 0x48, 0x83, 0xC4, 0x08);                         // add rsp, 8
+    EMIT(t, 0x41, 0x58, 0x5F);                               // pop r8; pop rdi
+    EMIT(t, 0x48, 0x8B, 0xB7); EmitInt32(t, stackPointer);   // mov rsi, [rdi + stackPointer]
+    EMIT(t, 0x48, 0x8B, 0x97); EmitInt32(t, reversePointer); // mov rdx, [rdi + reversePointer]
+
+    // INS_NOOP has an empty template
+
+    t = &s_templates[INS_LOAD_VAR_VAR_ADD_I];
+    LoadVar(t, TYPE_INT, 0, PATCH_VAR);
+    LoadVar(t, TYPE_INT, 1, PATCH_SECOND_VAR);
+    EMIT(t, 0x01, 0xC8);
+    StoreOperand(t, TYPE_INT, 0);
+    AdjustOperands(t, I);
+
+    t = &s_templates[INS_LOAD_VAR_VAR_SUBSTRACT_I];
+    LoadVar(t, TYPE_INT, 0, PATCH_VAR);
+    LoadVar(t, TYPE_INT, 1, PATCH_SECOND_VAR);
+    EMIT(t, 0x29, 0xC8);
+    StoreOperand(t, TYPE_INT, 0);
+    AdjustOperands(t, I);
+
+    t = &s_templates[INS_LOAD_VAR_VAR_MULTIPLY_I];
+    LoadVar(t, TYPE_INT, 0, PATCH_VAR);
+    LoadVar(t, TYPE_INT, 1, PATCH_SECOND_VAR);
+    EMIT(t, 0x0F, 0xAF, 0xC1);
+    StoreOperand(t, TYPE_INT, 0);
+    AdjustOperands(t, I);
+
+    t = &s_templates[INS_ADD_LITERAL_I];
+    LoadOperand(t, TYPE_INT, 0, -I);
+    EMIT(t, 0x05); // add eax, imm32
+    Hole(t, PATCH_IMMEDIATE);
+    StoreOperand(t, TYPE_INT, -I);
+
+    t = &s_templates[INS_SUBSTRACT_LITERAL_I];
+    LoadOperand(t, TYPE_INT, 0, -I);
+    EMIT(t, 0x2D); // sub eax, imm32
+    Hole(t, PATCH_IMMEDIATE);
+    StoreOperand(t, TYPE_INT, -I);
+
+    t = &s_templates[INS_MULTIPLY_LITERAL_I];
+    LoadOperand(t, TYPE_INT, 0, -I);
+    EMIT(t, 0x69, 0xC0); // imul eax, eax, imm32
+    Hole(t, PATCH_IMMEDIATE);
+    StoreOperand(t, TYPE_INT, -I);
+
+    CompareJump(&s_templates[INS_CMP_I_EQ_JUMP], 0x84);      // je
+    CompareJump(&s_templates[INS_CMP_I_LESS_JUMP], 0x8C);    // jl
+    CompareJump(&s_templates[INS_CMP_I_LESS_EQ_JUMP], 0x8E); // jle
+
+    t = &s_templates[INS_MOVE_VAR_I];
+    LoadVar(t, TYPE_INT, 0, PATCH_VAR);
+    StoreVar(t, TYPE_INT, PATCH_SECOND_VAR);
+
+    t = &s_templates[INS_MOVE_VAR_F];
+    LoadVar(t, TYPE_FLOAT, 0, PATCH_VAR);
+    StoreVar(t, TYPE_FLOAT, PATCH_SECOND_VAR);
+
+    s_hasTemplates = HS_TRUE;
+}
+
+//------------------------------------------------------------------------------
+static int Immediate(const byte* ins)
+{
+    switch ((EInstruction)ins[0])
+    {
+        case INS_LITERAL_F:
+        {
+            int bits;
+            memcpy(&bits, ins + 1, sizeof(hsbfloat));
+            return bits;
+        }
+        case INS_LITERAL_B:
+            return LoadBool((byte*)ins + 1);
+        default:
+            return LoadInt((byte*)ins + 1);
+    }
+}
+
+//------------------------------------------------------------------------------
+// Frames keep the frame pointer in SVMData, which the templates do not track yet. INS_SWITCH
+// would need a table of native addresses, INS_YIELD and INS_CALL_ASYNC a way back into the middle
+// of the code.
+static Bool8 HasTemplate(EInstruction instruction)
+{
+    switch (instruction)
+    {
+        case INS_ENTER:
+        case INS_LOAD_FRAME_I:
+        case INS_LOAD_FRAME_F:
+        case INS_SAVE_FRAME_I:
+        case INS_SAVE_FRAME_F:
+        case INS_LEAVE:
+        case INS_LEAVE_I:
+        case INS_LEAVE_F:
+        case INS_TAIL_CALL:
+        case INS_SWITCH:
+        case INS_YIELD:
+        case INS_CALL_ASYNC:
+            return HS_FALSE;
+        default:
+            return HS_TRUE;
+    }
+}
+
+//------------------------------------------------------------------------------
+EResult JitCompile(SStackData instructions, int dataSize, SJitCode* outCode)
+{
+    memset(outCode, 0, sizeof(SJitCode));
+
+    // The templates do no checks at all
+    SVerifyResult verifyResult;
+    if (VerifyInstructions(instructions, dataSize, &verifyResult) != R_OK)
+    {
+        printf("ERROR: Cannot compile unverified code, %s at %d\n", verifyResult.error, verifyResult.errorOffset);
+        return R_ERROR;
+    }
+
+    if (!s_hasTemplates)
+        BuildTemplates();
+
+    byte* code = instructions.begin;
+    int size = instructions.end - instructions.begin;
+
+    for (int address = 0; address < size; address += GetInstructionSize(code[address]))
+    {
+        if (!HasTemplate(code[address]))
+        {
+            printf("ERROR: Cannot compile %s at %d\n", GetInstructionName(code[address]), address);
+            return R_ERROR;
+        }
+    }
+
+    // Native offset of each instruction
+    int* nativeOffsets = malloc((size + 1) * sizeof(int));
+    int nativeSize = s_prologue.size;
+    for (int address = 0; address < size; address += GetInstructionSize(code[address]))
+    {
+        nativeOffsets[address] = nativeSize;
+        nativeSize += s_templates[code[address]].size;
+    }
+
+    outCode->codeSize = nativeSize;
+    outCode->code = mmap(NULL, nativeSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (outCode->code == MAP_FAILED)
+    {
+        printf("ERROR: Could not allocate %d bytes of code\n", nativeSize);
+        outCode->code = NULL;
+        free(nativeOffsets);
+        return R_ERROR;
+    }
+    outCode->entries = calloc(size + 1, sizeof(void*));
+
+    memcpy(outCode->code, s_prologue.code, s_prologue.size);
+    memcpy(outCode->code + s_prologueEntries, &outCode->entries, sizeof(void*));
+
+    for (int address = 0; address < size;)
+    {
+        const byte* ins = code + address;
+        const STemplate* t = &s_templates[ins[0]];
+        byte* native = outCode->code + nativeOffsets[address];
+        outCode->entries[address] = native;
+        memcpy(native, t->code, t->size);
+
+        int instructionSize = GetInstructionSize(ins[0]);
+        for (int i = 0; i < t->patchCount; ++i)
+        {
+            byte* hole = native + t->patchOffsets[i];
+            int value = 0;
+            switch ((EPatch)t->patchKinds[i])
+            {
+                case PATCH_IMMEDIATE: value = Immediate(ins); break;
+                case PATCH_VAR: value = ins[1]; break;
+                case PATCH_SECOND_VAR: value = ins[2]; break;
+                case PATCH_NEXT: value = address + instructionSize; break;
+                case PATCH_SELF: value = address; break;
+                case PATCH_NATIVE: value = ins[1] * (int)sizeof(NativeFP*); break;
+                case PATCH_TARGET:
+                    value = nativeOffsets[LoadAddress((byte*)ins + 1)] - (int)(hole + 4 - outCode->code);
+                    break;
+            }
+            memcpy(hole, &value, 4);
+        }
+
+        address += instructionSize;
+    }
+    free(nativeOffsets);
+
+    // W^X, the code is never writable and executable at the same time
+    if (mprotect(outCode->code, nativeSize, PROT_READ | PROT_EXEC) != 0)
+    {
+        printf("ERROR: Could not make the code executable\n");
+        FreeJitCode(outCode);
+        return R_ERROR;
+    }
+    return R_OK;
+}
+
+//------------------------------------------------------------------------------
+void FreeJitCode(SJitCode* code)
+{
+    if (code->code)
+        munmap(code->code, code->codeSize);
+    free(code->entries);
+    memset(code, 0, sizeof(SJitCode));
+}
+
+//------------------------------------------------------------------------------
+Bool8 VMRunJit(SVMData* vmData, const SJitCode* code)
+{
+    void (*entry)(SVMData*);
+    memcpy(&entry, &code->code, sizeof(entry));
+    entry(vmData);
+    return HS_FALSE;
+}
+
+#else
+
+//------------------------------------------------------------------------------
+EResult JitCompile(SStackData instructions, int dataSize, SJitCode* outCode)
+{
+    memset(outCode, 0, sizeof(SJitCode));
+    printf("ERROR: The JIT is not supported on this platform\n");
+    return R_ERROR;
+}
+
+//------------------------------------------------------------------------------
+void FreeJitCode(SJitCode* code)
+{
+}
+
+//------------------------------------------------------------------------------
+Bool8 VMRunJit(SVMData* vmData, const SJitCode* code)
+{
+    return VMRunVerified(vmData);
+}
+
+#endif
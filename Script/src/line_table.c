@@ -0,0 +1,98 @@
+#include "line_table.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+//------------------------------------------------------------------------------
+static void WriteByte(SLineTable* table, byte value)
+{
+    if (table->size == table->capacity)
+    {
+        table->capacity = table->capacity ? table->capacity * 2 : 64;
+        table->data = realloc(table->data, table->capacity);
+    }
+    table->data[table->size++] = value;
+}
+
+//------------------------------------------------------------------------------
+// Seven bits per byte, the high bit set on all but the last
+static void WriteUnsigned(SLineTable* table, uint32_t value)
+{
+    while (value >= 0x80)
+    {
+        WriteByte(table, (value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+    WriteByte(table, value);
+}
+
+//------------------------------------------------------------------------------
+static uint32_t ReadUnsigned(const SLineTable* table, int* position)
+{
+    uint32_t value = 0;
+    for (int shift = 0; *position < table->size; shift += 7)
+    {
+        byte b = table->data[(*position)++];
+        value |= (uint32_t)(b & 0x7F) << shift;
+        if (!(b & 0x80))
+            break;
+    }
+    return value;
+}
+
+//------------------------------------------------------------------------------
+void InitLineTable(SLineTable* table)
+{
+    memset(table, 0, sizeof(SLineTable));
+}
+
+//------------------------------------------------------------------------------
+void DeleteLineTable(SLineTable* table)
+{
+    free(table->data);
+    InitLineTable(table);
+}
+
+//------------------------------------------------------------------------------
+void AddLineEntry(SLineTable* table, int offset, SSourcePosition position)
+{
+    if (table->entryCount > 0 && position.line == table->lastPosition.line && position.column == table->lastPosition.column)
+        return;
+
+    assert(table->entryCount == 0 || offset > table->lastOffset);
+    int lineDelta = (int)position.line - table->lastPosition.line;
+    WriteUnsigned(table, offset - table->lastOffset);
+    WriteUnsigned(table, lineDelta >= 0 ? 2 * (uint32_t)lineDelta : 2 * (uint32_t)-lineDelta - 1);
+    WriteUnsigned(table, position.column);
+
+    table->lastOffset = offset;
+    table->lastPosition = position;
+    ++table->entryCount;
+}
+
+//------------------------------------------------------------------------------
+Bool8 ReadLineEntry(const SLineTable* table, SLineEntry* entry)
+{
+    if (entry->next >= table->size)
+        return HS_FALSE;
+
+    entry->offset += ReadUnsigned(table, &entry->next);
+    uint32_t line = ReadUnsigned(table, &entry->next);
+    entry->position.line += line & 1 ? -(int)((line + 1) / 2) : (int)(line / 2);
+    entry->position.column = ReadUnsigned(table, &entry->next);
+    return HS_TRUE;
+}
+
+//------------------------------------------------------------------------------
+Bool8 FindSourcePosition(const SLineTable* table, int offset, SSourcePosition* outPosition)
+{
+    Bool8 found = HS_FALSE;
+    SLineEntry entry = { 0 };
+    while (ReadLineEntry(table, &entry) && entry.offset <= offset)
+    {
+        *outPosition = entry.position;
+        found = HS_TRUE;
+    }
+    return found;
+}
@@ -1,5 +1,10 @@
+#include "bytecode_c.h"
+#include "bytecode_info.h"
 #include "tokenizer.h"
 #include "parser.h"
+#include "compiler.h"
+#include "file.h"
+#include "stack_usage.h"
 #include "inc.h"
 
 #include <stdio.h>
@@ -14,6 +19,7 @@ const char* GetTokenString(ETokenType token)
     switch (token)
     {
         case TOKEN_SEMICOLON: return "TOKEN_SEMICOLON";
+        case TOKEN_COMMA: return "TOKEN_COMMA";
         case TOKEN_EQUALS: return "TOKEN_EQUALS";
         case TOKEN_LEFT_BRACE: return "TOKEN_LEFT_BRACE";
         case TOKEN_RIGHT_BRACE: return "TOKEN_RIGHT_BRACE";
@@ -55,14 +61,6 @@ static void PrintToken(SToken token)
     }
 }
 
-//------------------------------------------------------------------------------
-static EResult Compile()
-{
-    // Input = AST
-    // Output = Bytecode
-    return R_OK;
-}
-
 //------------------------------------------------------------------------------
 static void PrintNode(SASTNode* node);
 
@@ -111,6 +109,24 @@ static void PrintNode(SASTNode* node)
             break;
         }
 
+        case ANT_DECL_FUNC:
+        {
+            node = node->decl.declFunc;
+            printf("fun %s(", node->declFunc.name->name);
+            for (SASTNode* parameter = node->declFunc.parameters; parameter; parameter = parameter->parameter.next)
+            {
+                printf("%s: %s", parameter->parameter.name->name, parameter->parameter.type->name);
+                if (parameter->parameter.next)
+                    printf(", ");
+            }
+            printf(")");
+            if (node->declFunc.resultType)
+                printf(": %s", node->declFunc.resultType->name);
+            printf("\n");
+            PrintNode(node->declFunc.body);
+            break;
+        }
+
         case ANT_DECL_STMT:
         {
             PrintNode(node->decl.stmt);
@@ -124,6 +140,67 @@ static void PrintNode(SASTNode* node)
             break;
         }
 
+        case ANT_RETURN:
+        {
+            printf("return");
+            if (node->stmt.expr)
+            {
+                printf(" ");
+                PrintNode(node->stmt.expr);
+            }
+            break;
+        }
+
+        case ANT_YIELD:
+        {
+            printf("yield");
+            break;
+        }
+
+        case ANT_IF:
+        {
+            printf("if (");
+            PrintNode(node->stmt.ifStmt.cond);
+            printf(")\n");
+            PrintNode(node->stmt.ifStmt.then);
+            if (node->stmt.ifStmt.otherwise)
+            {
+                printf("\nelse\n");
+                PrintNode(node->stmt.ifStmt.otherwise);
+            }
+            break;
+        }
+
+        case ANT_WHILE:
+        {
+            printf("while (");
+            PrintNode(node->stmt.whileStmt.cond);
+            printf(")\n");
+            PrintNode(node->stmt.whileStmt.body);
+            break;
+        }
+
+        case ANT_SWITCH:
+        {
+            printf("switch (");
+            PrintNode(node->stmt.switchStmt.value);
+            printf(")\n{");
+            for (SASTNode* switchCase = node->stmt.switchStmt.cases; switchCase; switchCase = switchCase->switchCase.next)
+            {
+                if (switchCase->switchCase.isDefault)
+                    printf("\ndefault:");
+                else
+                    printf("\ncase %d:", switchCase->switchCase.value);
+                if (switchCase->switchCase.body)
+                {
+                    printf("\n");
+                    PrintNode(switchCase->switchCase.body);
+                }
+            }
+            printf("\n}");
+            break;
+        }
+
         case ANT_ASSIGN:
         {
             printf("%s = ", node->assign.var->name);
@@ -196,6 +273,12 @@ static void PrintNode(SASTNode* node)
                     printf("/ ");
                     break;
                 }
+                case TOKEN_LESS: printf("< "); break;
+                case TOKEN_LESS_EQUAL: printf("<= "); break;
+                case TOKEN_GREATER: printf("> "); break;
+                case TOKEN_GREATER_EQUAL: printf(">= "); break;
+                case TOKEN_EQUAL_EQUAL: printf("== "); break;
+                case TOKEN_NOT_EQUAL: printf("!= "); break;
                 default: assert(0); break;
             }
             PrintNode(node->binary.left); printf(" ");
@@ -203,6 +286,18 @@ static void PrintNode(SASTNode* node)
             printf(")");
             break;
         }
+        case ANT_CALL:
+        {
+            printf("%s(", node->call.name->name);
+            for (SASTNode* argument = node->call.arguments; argument; argument = argument->argument.next)
+            {
+                PrintNode(argument->argument.value);
+                if (argument->argument.next)
+                    printf(", ");
+            }
+            printf(")");
+            break;
+        }
         default: assert(0); break;
     }
 }
@@ -244,54 +339,22 @@ static EResult CompileCode(char* code, int size)
 
     PrintAST(astRoot);
 
-    r = Compile();
+    SStackData instructions;
+    r = Compile(astRoot, &instructions);
     if (r != R_OK)
         goto end;
 
-end:
-    FreeTokens(&tokens, &tokenCount);
-    return r;
-}
+    PrintInstructions(instructions);
 
-//------------------------------------------------------------------------------
-static Bool8 ReadFile(char** fileBuff, int* size)
-{
-    FILE* file = fopen("SimpleTest.hss", "rb");
-    if (!file)
-    {
-        printf("File does not exist\n");
-        return HS_FALSE;
-    }
-
-    Bool8 result = HS_TRUE;
-    fseek(file , 0 , SEEK_END);
-    int fileSize = ftell(file);
-    rewind(file);
-
-    *fileBuff = malloc(fileSize + 1);
-
-    if (!*fileBuff)
-    {
-        printf("Failed to allocate memory for the file\n");
-        goto end;
-    }
-
-    int readSize = fread(*fileBuff, 1, fileSize, file);
-    int eof = feof(file);
-
-    if (readSize != fileSize && !eof)
-    {
-        free(*fileBuff);
-        result = HS_FALSE;
-        printf("Failed to read the whole file\n");
-        goto end;
-    }
+    SStackUsage usage;
+    if (AnalyzeStackUsage(instructions, &usage) == R_OK)
+        printf("Data stack: %d bytes\n", usage.requiredDataSize);
+    FreeStackUsage(&usage);
+    DeleteStack(instructions);
 
-    (*fileBuff)[fileSize] = 0; // Zero terminate to have a proper string
-    *size = readSize;
 end:
-    fclose(file);
-    return result;
+    FreeTokens(&tokens, &tokenCount);
+    return r;
 }
 
 //------------------------------------------------------------------------------
@@ -301,13 +364,14 @@ static void Test()
 
     char* file;
     int size;
-    if (!ReadFile(&file, &size))
+    if (!ReadFile("SimpleTest.hss", &file, &size))
     {
         printf("Failed to read the file\n");
         return;
     }
 
     CompileCode(file, size);
+    free(file);
 }
 
 //------------------------------------------------------------------------------
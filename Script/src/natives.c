@@ -0,0 +1,197 @@
+#include "natives.h"
+#include "bytecode_c.h"
+
+#include <math.h>
+#include <stdio.h>
+
+//------------------------------------------------------------------------------
+void InitNativeTable(SNativeTable* table)
+{
+    memset(table, 0, sizeof(SNativeTable));
+}
+
+//------------------------------------------------------------------------------
+void DeleteNativeTable(SNativeTable* table)
+{
+    for (int i = 0; i < table->count; ++i)
+        free(table->natives[i].name);
+    free(table->natives);
+    InitNativeTable(table);
+}
+
+//------------------------------------------------------------------------------
+static void SkipSpaces(const char** c)
+{
+    while (**c == ' ')
+        ++*c;
+}
+
+//------------------------------------------------------------------------------
+static Bool8 ParseType(const char** c, ENativeType* outType)
+{
+    static const char* NAMES[] = { "void", "int", "float" };
+
+    SkipSpaces(c);
+    for (int type = NATIVE_NONE; type <= NATIVE_FLOAT; ++type)
+    {
+        int length = strlen(NAMES[type]);
+        if (strncmp(*c, NAMES[type], length) == 0)
+        {
+            *c += length;
+            *outType = type;
+            SkipSpaces(c);
+            return HS_TRUE;
+        }
+    }
+    return HS_FALSE;
+}
+
+//------------------------------------------------------------------------------
+static Bool8 ParseSignature(const char* c, SNativeSignature* outSignature)
+{
+    memset(outSignature, 0, sizeof(SNativeSignature));
+
+    ENativeType type;
+    if (!ParseType(&c, &type) || *c++ != '(')
+        return HS_FALSE;
+    outSignature->result = type;
+
+    SkipSpaces(&c);
+    if (*c == ')')
+        return *++c == 0;
+
+    for (;;)
+    {
+        if (outSignature->argumentCount == HS_NATIVE_MAX_ARGUMENTS || !ParseType(&c, &type) || type == NATIVE_NONE)
+            return HS_FALSE;
+        if (type == NATIVE_FLOAT)
+            outSignature->floatArguments |= 1 << outSignature->argumentCount;
+        ++outSignature->argumentCount;
+
+        char separator = *c++;
+        if (separator == ')')
+            return *c == 0;
+        if (separator != ',')
+            return HS_FALSE;
+    }
+}
+
+//------------------------------------------------------------------------------
+static EResult AddNative(SNativeTable* table, const char* name, const char* signature, NativeFP* function,
+    Bool8 isAsync)
+{
+    SNativeSignature parsed;
+    if (!ParseSignature(signature, &parsed))
+    {
+        printf("ERROR: Invalid signature '%s' of native '%s'\n", signature, name);
+        return R_ERROR;
+    }
+    if (FindNative(table, name) >= 0)
+    {
+        printf("ERROR: Native '%s' is already registered\n", name);
+        return R_ERROR;
+    }
+    if (table->count == HS_MAX_NATIVES)
+    {
+        printf("ERROR: Too many natives\n");
+        return R_ERROR;
+    }
+
+    if (table->count == table->capacity)
+    {
+        table->capacity = table->capacity ? table->capacity * 2 : 16;
+        table->natives = realloc(table->natives, table->capacity * sizeof(SNative));
+    }
+
+    int length = strlen(name);
+    SNative* native = &table->natives[table->count++];
+    native->name = malloc(length + 1);
+    memcpy(native->name, name, length + 1);
+    native->signature = parsed;
+    native->function = function;
+    native->isAsync = isAsync;
+    return R_OK;
+}
+
+//------------------------------------------------------------------------------
+EResult RegisterNative(SNativeTable* table, const char* name, const char* signature, NativeFP* function)
+{
+    return AddNative(table, name, signature, function, HS_FALSE);
+}
+
+//------------------------------------------------------------------------------
+EResult RegisterAsyncNative(SNativeTable* table, const char* name, const char* signature, NativeFP* function)
+{
+    return AddNative(table, name, signature, function, HS_TRUE);
+}
+
+//------------------------------------------------------------------------------
+int FindNative(const SNativeTable* table, const char* name)
+{
+    for (int i = 0; i < table->count; ++i)
+    {
+        if (strcmp(table->natives[i].name, name) == 0)
+            return i;
+    }
+    return -1;
+}
+
+//------------------------------------------------------------------------------
+FuncArray CreateNativeFunctions(const SNativeTable* table)
+{
+    FuncArray functions =
+    {
+        .count = table->count,
+        .begin = malloc((table->count > 0 ? table->count : 1) * sizeof(NativeFP*)),
+    };
+    for (int i = 0; i < table->count; ++i)
+        functions.begin[i] = table->natives[i].function;
+    return functions;
+}
+
+//------------------------------------------------------------------------------
+static void NativeSqrt(SVMData* vmData)
+{
+    hsbfloat value = PopFloat(&vmData->dataStack.base.stackPointer);
+    PushFloat(&vmData->dataStack.base.stackPointer, sqrtf(value));
+}
+
+//------------------------------------------------------------------------------
+static void NativeSin(SVMData* vmData)
+{
+    hsbfloat value = PopFloat(&vmData->dataStack.base.stackPointer);
+    PushFloat(&vmData->dataStack.base.stackPointer, sinf(value));
+}
+
+//------------------------------------------------------------------------------
+static void NativeCos(SVMData* vmData)
+{
+    hsbfloat value = PopFloat(&vmData->dataStack.base.stackPointer);
+    PushFloat(&vmData->dataStack.base.stackPointer, cosf(value));
+}
+
+//------------------------------------------------------------------------------
+static void NativePrintInt(SVMData* vmData)
+{
+    printf("%d\n", PopInt(&vmData->dataStack.base.stackPointer));
+}
+
+//------------------------------------------------------------------------------
+static void NativePrintFloat(SVMData* vmData)
+{
+    printf("%f\n", PopFloat(&vmData->dataStack.base.stackPointer));
+}
+
+//------------------------------------------------------------------------------
+EResult RegisterStandardNatives(SNativeTable* table)
+{
+    if (RegisterNative(table, "sqrt", "float(float)", NativeSqrt) != R_OK
+        || RegisterNative(table, "sin", "float(float)", NativeSin) != R_OK
+        || RegisterNative(table, "cos", "float(float)", NativeCos) != R_OK
+        || RegisterNative(table, "printInt", "void(int)", NativePrintInt) != R_OK
+        || RegisterNative(table, "printFloat", "void(float)", NativePrintFloat) != R_OK)
+    {
+        return R_ERROR;
+    }
+    return R_OK;
+}
@@ -0,0 +1,630 @@
+#include "optimizer.h"
+#include "bytecode_c.h"
+#include "bytecode_info.h"
+#include "verifier.h"
+
+#include <limits.h>
+#include <stdio.h>
+
+//------------------------------------------------------------------------------
+typedef struct
+{
+    byte* code;
+    int size;
+    Bool8* isTarget; // Indexed by address, whether any jump lands there
+} SPeepholeInput;
+
+//------------------------------------------------------------------------------
+// Instruction at the position if it can be part of a sequence started before it
+static EInstruction Next(SPeepholeInput* in, int position)
+{
+    if (position >= in->size || in->isTarget[position])
+        return INS_COUNT;
+    return in->code[position];
+}
+
+//------------------------------------------------------------------------------
+static EInstruction FuseLoadLoadOp(EInstruction op)
+{
+    switch (op)
+    {
+        case INS_ADD_I: return INS_LOAD_VAR_VAR_ADD_I;
+        case INS_SUBSTRACT_I: return INS_LOAD_VAR_VAR_SUBSTRACT_I;
+        case INS_MULTIPLY_I: return INS_LOAD_VAR_VAR_MULTIPLY_I;
+        default: return INS_COUNT;
+    }
+}
+
+//------------------------------------------------------------------------------
+static EInstruction FuseLiteralOp(EInstruction op)
+{
+    switch (op)
+    {
+        case INS_ADD_I: return INS_ADD_LITERAL_I;
+        case INS_SUBSTRACT_I: return INS_SUBSTRACT_LITERAL_I;
+        case INS_MULTIPLY_I: return INS_MULTIPLY_LITERAL_I;
+        default: return INS_COUNT;
+    }
+}
+
+//------------------------------------------------------------------------------
+static EInstruction FuseCompareJump(EInstruction op)
+{
+    switch (op)
+    {
+        case INS_CMP_I_EQ: return INS_CMP_I_EQ_JUMP;
+        case INS_CMP_I_LESS: return INS_CMP_I_LESS_JUMP;
+        case INS_CMP_I_LESS_EQ: return INS_CMP_I_LESS_EQ_JUMP;
+        default: return INS_COUNT;
+    }
+}
+
+//------------------------------------------------------------------------------
+// Writes the superinstruction starting at the position to out, returns the number of
+// input bytes it replaces or 0 when there is nothing to fuse
+static int Fuse(SPeepholeInput* in, int position, byte* out, int* outSize)
+{
+    byte* ins = in->code + position;
+    EInstruction first = ins[0];
+    EInstruction second = Next(in, position + GetInstructionSize(first));
+
+    switch (first)
+    {
+        case INS_LOAD_VAR_I:
+        {
+            // LOAD_VAR_I a, LOAD_VAR_I b, op -> op a b
+            if (second == INS_LOAD_VAR_I)
+            {
+                EInstruction fused = FuseLoadLoadOp(Next(in, position + 4));
+                if (fused != INS_COUNT)
+                {
+                    out[0] = fused;
+                    out[1] = ins[1];
+                    out[2] = ins[3];
+                    *outSize = 3;
+                    return 5;
+                }
+            }
+
+            // LOAD_VAR_I from, SAVE_VAR_I to -> MOVE_VAR_I from to
+            if (second == INS_SAVE_VAR_I)
+            {
+                out[0] = INS_MOVE_VAR_I;
+                out[1] = ins[1];
+                out[2] = ins[3];
+                *outSize = 3;
+                return 4;
+            }
+            return 0;
+        }
+        case INS_LOAD_VAR_F:
+        {
+            if (second == INS_SAVE_VAR_F)
+            {
+                out[0] = INS_MOVE_VAR_F;
+                out[1] = ins[1];
+                out[2] = ins[3];
+                *outSize = 3;
+                return 4;
+            }
+            return 0;
+        }
+        case INS_LITERAL_I:
+        {
+            // LITERAL_I value, op -> op value
+            EInstruction fused = FuseLiteralOp(second);
+            if (fused != INS_COUNT)
+            {
+                out[0] = fused;
+                memcpy(out + 1, ins + 1, sizeof(hsbint));
+                *outSize = 1 + sizeof(hsbint);
+                return 2 + sizeof(hsbint);
+            }
+            return 0;
+        }
+        case INS_CMP_I_EQ:
+        case INS_CMP_I_LESS:
+        case INS_CMP_I_LESS_EQ:
+        {
+            // CMP, COND_JUMP_B address -> CMP_JUMP address
+            if (second == INS_COND_JUMP_B)
+            {
+                out[0] = FuseCompareJump(first);
+                memcpy(out + 1, ins + 2, sizeof(hsbaddress));
+                *outSize = 1 + sizeof(hsbaddress);
+                return 2 + sizeof(hsbaddress);
+            }
+            return 0;
+        }
+        default:
+            return 0;
+    }
+}
+
+//------------------------------------------------------------------------------
+EResult FuseSuperinstructionsMapped(SStackData* instructions, int* outNewAddress)
+{
+    SPeepholeInput in =
+    {
+        .code = instructions->begin,
+        .size = instructions->end - instructions->begin,
+    };
+    EResult result = R_OK;
+
+    in.isTarget = calloc(in.size + 1, sizeof(Bool8));
+    byte* out = malloc(in.size);
+
+    // Find jump targets
+    for (int position = 0; position < in.size;)
+    {
+        EInstruction instruction = in.code[position];
+        int size = GetInstructionSize(instruction);
+        if (size == 0 || position + size > in.size)
+        {
+            printf("ERROR: Invalid instruction at %d\n", position);
+            result = R_ERROR;
+            goto end;
+        }
+
+        if (HasAddressOperand(instruction))
+        {
+            int address = LoadAddress(in.code + position + 1);
+            if (address > in.size)
+            {
+                printf("ERROR: Jump outside of the program at %d\n", position);
+                result = R_ERROR;
+                goto end;
+            }
+            in.isTarget[address] = HS_TRUE;
+        }
+
+        position += size;
+    }
+
+    // Rewrite
+    int outSize = 0;
+    for (int position = 0; position < in.size;)
+    {
+        int fusedSize;
+        int replaced = Fuse(&in, position, out + outSize, &fusedSize);
+        if (replaced == 0)
+        {
+            replaced = GetInstructionSize(in.code[position]);
+            fusedSize = replaced;
+            memcpy(out + outSize, in.code + position, replaced);
+        }
+
+        // Only the first instruction of a fused sequence can be a target
+        for (int i = 0; i < replaced; ++i)
+            outNewAddress[position + i] = outSize;
+
+        position += replaced;
+        outSize += fusedSize;
+    }
+    outNewAddress[in.size] = outSize;
+
+    // Remap jumps
+    for (int position = 0; position < outSize;)
+    {
+        EInstruction instruction = out[position];
+        if (HasAddressOperand(instruction))
+        {
+            hsbaddress address = LoadAddress(out + position + 1);
+            StoreAddress(out + position + 1, outNewAddress[address]);
+        }
+        position += GetInstructionSize(instruction);
+    }
+
+    memcpy(instructions->begin, out, outSize);
+    instructions->end = instructions->begin + outSize;
+
+end:
+    free(out);
+    free(in.isTarget);
+    return result;
+}
+
+//------------------------------------------------------------------------------
+EResult FuseSuperinstructions(SStackData* instructions)
+{
+    int* newAddress = malloc((instructions->end - instructions->begin + 1) * sizeof(int));
+    EResult result = FuseSuperinstructionsMapped(instructions, newAddress);
+    free(newAddress);
+    return result;
+}
+
+//------------------------------------------------------------------------------
+// Whether every exit reachable from the position within its function is the leave instruction,
+// calls are assumed to return. Marks the visited positions.
+static Bool8 ExitsWith(byte* code, int size, int position, EInstruction leave, Bool8* isVisited)
+{
+    while (position < size && !isVisited[position])
+    {
+        isVisited[position] = HS_TRUE;
+        EInstruction instruction = code[position];
+        switch (instruction)
+        {
+            case INS_LEAVE:
+            case INS_LEAVE_I:
+            case INS_LEAVE_F:
+                return instruction == leave;
+            case INS_RETURN:
+            case INS_TAIL_CALL:
+            case INS_END:
+                return HS_FALSE;
+            case INS_JUMP:
+                position = LoadAddress(code + position + 1);
+                continue;
+            case INS_SWITCH:
+            {
+                // the walk goes on with the default, the other entries of the table are checked here
+                int table = position + GetInstructionSize(INS_SWITCH);
+                for (int i = 1; i <= code[position + 1 + sizeof(hsbint)]; ++i)
+                {
+                    if (!ExitsWith(code, size, table + i * GetInstructionSize(INS_JUMP), leave, isVisited))
+                        return HS_FALSE;
+                }
+                break;
+            }
+            default:
+                break;
+        }
+
+        if (HasAddressOperand(instruction) && instruction != INS_CALL
+            && !ExitsWith(code, size, LoadAddress(code + position + 1), leave, isVisited))
+        {
+            return HS_FALSE;
+        }
+        position += GetInstructionSize(instruction);
+    }
+
+    return position < size;
+}
+
+//------------------------------------------------------------------------------
+EResult EliminateTailCalls(SStackData* instructions)
+{
+    byte* code = instructions->begin;
+    int size = instructions->end - instructions->begin;
+    EResult result = R_OK;
+
+    Bool8* isTarget = calloc(size + 1, sizeof(Bool8));
+    Bool8* isTailCall = calloc(size, sizeof(Bool8));
+    Bool8* isVisited = malloc(size);
+
+    // Find jump targets
+    for (int position = 0; position < size;)
+    {
+        EInstruction instruction = code[position];
+        int instructionSize = GetInstructionSize(instruction);
+        if (instructionSize == 0 || position + instructionSize > size
+            || (HasAddressOperand(instruction) && LoadAddress(code + position + 1) > size))
+        {
+            printf("ERROR: Invalid instruction at %d\n", position);
+            result = R_ERROR;
+            goto end;
+        }
+
+        if (HasAddressOperand(instruction))
+            isTarget[LoadAddress(code + position + 1)] = HS_TRUE;
+        position += instructionSize;
+    }
+
+    // Decide on the original code, a rewritten call would end the walk of its function
+    for (int position = 0; position < size; position += GetInstructionSize(code[position]))
+    {
+        if (code[position] != INS_CALL)
+            continue;
+
+        // the variables of the caller are deallocated between the call and the leave
+        int leave = position + GetInstructionSize(INS_CALL);
+        while (leave < size && !isTarget[leave] && (code[leave] == INS_DEALLOC_VAR_I || code[leave] == INS_DEALLOC_VAR_F))
+            ++leave;
+        if (leave >= size || isTarget[leave])
+            continue;
+        if (code[leave] != INS_LEAVE && code[leave] != INS_LEAVE_I && code[leave] != INS_LEAVE_F)
+            continue;
+
+        int function = LoadAddress(code + position + 1);
+        if (function >= size || code[function] != INS_ENTER)
+            continue;
+
+        memset(isVisited, 0, size);
+        isTailCall[position] = ExitsWith(code, size, function, code[leave], isVisited);
+    }
+
+    // CALL address, DEALLOC_VAR..., LEAVE and DEALLOC_VAR..., TAIL_CALL address, argument size
+    // take the same bytes. The arguments are on the data stack already when the variables go.
+    for (int position = 0; position < size; position += GetInstructionSize(code[position]))
+    {
+        if (!isTailCall[position])
+            continue;
+
+        hsbaddress function = LoadAddress(code + position + 1);
+        int deallocCount = 0;
+        while (code[position + GetInstructionSize(INS_CALL) + deallocCount] != INS_LEAVE
+            && code[position + GetInstructionSize(INS_CALL) + deallocCount] != INS_LEAVE_I
+            && code[position + GetInstructionSize(INS_CALL) + deallocCount] != INS_LEAVE_F)
+        {
+            ++deallocCount;
+        }
+
+        memmove(code + position, code + position + GetInstructionSize(INS_CALL), deallocCount);
+        byte* tailCall = code + position + deallocCount;
+        tailCall[0] = INS_TAIL_CALL;
+        StoreAddress(tailCall + 1, function);
+        tailCall[1 + sizeof(hsbaddress)] = code[function + 1];
+        position += deallocCount;
+    }
+
+end:
+    free(isVisited);
+    free(isTailCall);
+    free(isTarget);
+    return result;
+}
+
+//------------------------------------------------------------------------------
+typedef struct
+{
+    byte* code;
+    int size;
+    SStackLayout** layouts;
+    int* bodyEnd;      // Indexed by function entry, address after its body, 0 when it cannot be inlined
+    int* localAddress; // Addresses in the copy being made, indexed by distance from the entry
+    byte* out;
+    int outSize;
+    Bool8* isResolved; // Indexed by out position, whether a jump in a copy already points into out
+} SInliner;
+
+//------------------------------------------------------------------------------
+// Number of variable offsets the instruction has as operands, they follow the opcode
+static int GetVarOffsetCount(EInstruction instruction)
+{
+    switch (instruction)
+    {
+        case INS_SAVE_VAR_I:
+        case INS_SAVE_VAR_F:
+        case INS_LOAD_VAR_I:
+        case INS_LOAD_VAR_F:
+            return 1;
+        case INS_LOAD_VAR_VAR_ADD_I:
+        case INS_LOAD_VAR_VAR_SUBSTRACT_I:
+        case INS_LOAD_VAR_VAR_MULTIPLY_I:
+        case INS_MOVE_VAR_I:
+        case INS_MOVE_VAR_F:
+            return 2;
+        default:
+            return 0;
+    }
+}
+
+//------------------------------------------------------------------------------
+// End of the body of the function, which has to be the instructions from the entry on
+// without a gap, reached from the entry only through jumps and left through INS_RETURN.
+// Only functions without calls are inlined: a function called from a copy would see the variable
+// area without the return address, different from its other callers.
+// Returns 0 for functions which cannot be inlined. Uses isVisited, indexed by address.
+static int FindBody(SInliner* in, int entry, Bool8* isVisited, int* pending)
+{
+    memset(isVisited, 0, in->size);
+    int pendingCount = 0;
+    pending[pendingCount++] = entry;
+
+    int end = entry;
+    while (pendingCount > 0)
+    {
+        int position = pending[--pendingCount];
+        while (!isVisited[position])
+        {
+            isVisited[position] = HS_TRUE;
+            EInstruction instruction = in->code[position];
+            int size = GetInstructionSize(instruction);
+            if (position + size > end)
+                end = position + size;
+
+            if (instruction == INS_RETURN)
+                break;
+            if (instruction == INS_JUMP)
+            {
+                position = LoadAddress(in->code + position + 1);
+                continue;
+            }
+            if (instruction == INS_CALL || instruction == INS_END || instruction == INS_ENTER || instruction == INS_TAIL_CALL
+                || instruction == INS_LEAVE || instruction == INS_LEAVE_I || instruction == INS_LEAVE_F)
+            {
+                return 0;
+            }
+
+            if (HasAddressOperand(instruction))
+                pending[pendingCount++] = LoadAddress(in->code + position + 1);
+            if (instruction == INS_SWITCH)
+            {
+                for (int i = 1; i <= in->code[position + 1 + sizeof(hsbint)]; ++i)
+                    pending[pendingCount++] = position + size + i * GetInstructionSize(INS_JUMP);
+            }
+            position += size;
+        }
+    }
+
+    for (int position = entry; position < end; position += GetInstructionSize(in->code[position]))
+    {
+        if (!isVisited[position])
+            return 0;
+    }
+    return end;
+}
+
+//------------------------------------------------------------------------------
+// Size of the copy of the body, INS_RETURN becomes a jump to its end unless it is the last instruction
+static int GetCopySize(SInliner* in, int entry)
+{
+    int end = in->bodyEnd[entry];
+    int copySize = 0;
+    for (int position = entry; position < end; position += GetInstructionSize(in->code[position]))
+    {
+        in->localAddress[position - entry] = copySize;
+        if (in->code[position] != INS_RETURN)
+            copySize += GetInstructionSize(in->code[position]);
+        else if (position + 1 < end)
+            copySize += GetInstructionSize(INS_JUMP);
+    }
+    in->localAddress[end - entry] = copySize;
+    return copySize;
+}
+
+//------------------------------------------------------------------------------
+// Appends the body in place of the INS_CALL. The return address is gone, so variables of the
+// caller are that much closer to the top of the variable area.
+static void CopyBody(SInliner* in, int entry)
+{
+    int end = in->bodyEnd[entry];
+    int base = in->outSize;
+    int copySize = GetCopySize(in, entry);
+    int returnAddressIndex = in->layouts[entry]->varCount - 1;
+
+    for (int position = entry; position < end; position += GetInstructionSize(in->code[position]))
+    {
+        EInstruction instruction = in->code[position];
+        byte* out = in->out + in->outSize;
+        if (instruction == INS_RETURN)
+        {
+            if (position + 1 == end)
+                continue;
+
+            out[0] = INS_JUMP;
+            StoreAddress(out + 1, base + copySize);
+            in->isResolved[in->outSize] = HS_TRUE;
+            in->outSize += GetInstructionSize(INS_JUMP);
+            continue;
+        }
+
+        int size = GetInstructionSize(instruction);
+        memcpy(out, in->code + position, size);
+        if (HasAddressOperand(instruction))
+        {
+            StoreAddress(out + 1, base + in->localAddress[LoadAddress(in->code + position + 1) - entry]);
+            in->isResolved[in->outSize] = HS_TRUE;
+        }
+
+        const SStackLayout* layout = in->layouts[position];
+        for (int i = 1; i <= GetVarOffsetCount(instruction); ++i)
+        {
+            int index = layout->varCount - 1;
+            for (int offset = 0; offset < out[i]; --index)
+                offset += GetTagSize(layout->vars[index]);
+            if (index < returnAddressIndex)
+                out[i] -= HS_DATA_SIZE_ADDRESS;
+        }
+
+        in->outSize += size;
+    }
+}
+
+//------------------------------------------------------------------------------
+// One round of inlining on verified code, returns the number of inlined calls or -1
+static int InlineRound(SStackData* instructions, const SInlineOptions* options, int* growth)
+{
+    SVerifyResult verifyResult;
+    SInliner in =
+    {
+        .code = instructions->begin,
+        .size = instructions->end - instructions->begin,
+    };
+    if (VerifyInstructionsWithLayouts(*instructions, INT_MAX, &verifyResult, &in.layouts) != R_OK)
+    {
+        printf("ERROR: Cannot inline into invalid code, %s at %d\n", verifyResult.error, verifyResult.errorOffset);
+        return -1;
+    }
+
+    int capacity = in.size + options->maxGrowth - *growth;
+    in.bodyEnd = calloc(in.size, sizeof(int));
+    in.localAddress = malloc((in.size + 1) * sizeof(int));
+    in.out = malloc(capacity);
+    in.isResolved = calloc(capacity, sizeof(Bool8));
+    int* newAddress = malloc((in.size + 1) * sizeof(int));
+    Bool8* isVisited = malloc(in.size);
+    int* pending = malloc(in.size * sizeof(int));
+
+    // Small functions which are called
+    for (int position = 0; position < in.size; position += GetInstructionSize(in.code[position]))
+    {
+        if (!in.layouts[position] || in.code[position] != INS_CALL)
+            continue;
+
+        int entry = LoadAddress(in.code + position + 1);
+        if (in.bodyEnd[entry] == 0)
+        {
+            int end = FindBody(&in, entry, isVisited, pending);
+            in.bodyEnd[entry] = end > 0 && end - entry <= options->maxCalleeSize ? end : -1;
+        }
+    }
+
+    // Calls in the order of the code until the budget is used up
+    int inlinedCount = 0;
+    for (int position = 0; position < in.size;)
+    {
+        EInstruction instruction = in.code[position];
+        int size = GetInstructionSize(instruction);
+        int entry = instruction == INS_CALL ? LoadAddress(in.code + position + 1) : 0;
+        int delta = in.layouts[position] && entry > 0 && in.bodyEnd[entry] > 0 ? GetCopySize(&in, entry) - size : INT_MAX;
+
+        for (int i = 0; i < size; ++i)
+            newAddress[position + i] = in.outSize;
+
+        if (delta <= options->maxGrowth - *growth && in.size + *growth + delta <= UINT16_MAX)
+        {
+            CopyBody(&in, entry);
+            *growth += delta;
+            ++inlinedCount;
+        }
+        else
+        {
+            memcpy(in.out + in.outSize, in.code + position, size);
+            in.outSize += size;
+        }
+        position += size;
+    }
+    newAddress[in.size] = in.outSize;
+
+    // Remap the jumps outside of the copies
+    for (int position = 0; position < in.outSize; position += GetInstructionSize(in.out[position]))
+    {
+        if (HasAddressOperand(in.out[position]) && !in.isResolved[position])
+            StoreAddress(in.out + position + 1, newAddress[LoadAddress(in.out + position + 1)]);
+    }
+
+    if (inlinedCount > 0)
+    {
+        DeleteStack(*instructions);
+        *instructions = CreateStack(in.outSize);
+        memcpy(instructions->begin, in.out, in.outSize);
+    }
+
+    free(pending);
+    free(isVisited);
+    free(newAddress);
+    free(in.isResolved);
+    free(in.out);
+    free(in.localAddress);
+    free(in.bodyEnd);
+    FreeStackLayouts(in.layouts, in.size);
+    return inlinedCount;
+}
+
+//------------------------------------------------------------------------------
+EResult InlineCalls(SStackData* instructions, const SInlineOptions* options, int* outInlinedCount)
+{
+    int growth = 0;
+    *outInlinedCount = 0;
+    for (int round = 0; round < options->maxDepth; ++round)
+    {
+        int inlinedCount = InlineRound(instructions, options, &growth);
+        if (inlinedCount < 0)
+            return R_ERROR;
+        if (inlinedCount == 0)
+            break;
+        *outInlinedCount += inlinedCount;
+    }
+    return R_OK;
+}
@@ -0,0 +1,351 @@
+#include "parallel_scheduler.h"
+#include "thread_pool.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//------------------------------------------------------------------------------
+typedef struct
+{
+    SScriptInstance instance;
+    int program;
+} SParallelInstance;
+
+//------------------------------------------------------------------------------
+typedef struct
+{
+    SProgram* program;
+    int quantum;
+    int* running;       // Instances to resume in the next tick, in spawn order
+    int runningCount;
+    int* free;          // Freed instances of the program whose contexts new ones take over
+    int freeCount;
+    int instanceCount;  // Running, finished and free
+    int capacity;       // Of running and free
+} SProgramInstances;
+
+//------------------------------------------------------------------------------
+// Instances running[first] to running[first + count - 1] of a program
+typedef struct
+{
+    int program;
+    int first;
+    int count;
+} SBatch;
+
+//------------------------------------------------------------------------------
+// The owner takes batches from the bottom, the other threads steal from the top. The batches
+// are dealt out before the tick and only read during it, so the deque never grows while it
+// is used. Deques are a cache line apart as top and bottom change all the time.
+typedef struct
+{
+    int top;
+    int bottom;
+    SBatch* batches;
+    int capacity;
+    int stolen;         // By the owner from other deques in this tick
+} SDeque;
+
+typedef union
+{
+    SDeque deque;
+    byte padding[sizeof(SDeque) + 64];
+} SPaddedDeque;
+
+//------------------------------------------------------------------------------
+struct SParallelScheduler
+{
+    SThreadPool* pool;
+    SPaddedDeque* deques;   // One per thread of the pool
+
+    SProgramInstances* programs;
+    int programCount;
+
+    SParallelInstance* instances;
+    int instanceCount;
+    int instanceCapacity;
+};
+
+//------------------------------------------------------------------------------
+SParallelScheduler* CreateParallelScheduler(int threadCount)
+{
+    SThreadPool* pool = CreateThreadPool(threadCount);
+    if (!pool)
+        return NULL;
+
+    SParallelScheduler* scheduler = calloc(1, sizeof(SParallelScheduler));
+    scheduler->pool = pool;
+    scheduler->deques = calloc(GetThreadCount(scheduler->pool), sizeof(SPaddedDeque));
+    return scheduler;
+}
+
+//------------------------------------------------------------------------------
+void DeleteParallelScheduler(SParallelScheduler* scheduler)
+{
+    for (int i = 0; i < GetThreadCount(scheduler->pool); ++i)
+        free(scheduler->deques[i].deque.batches);
+    DeleteThreadPool(scheduler->pool);
+
+    for (int i = 0; i < scheduler->instanceCount; ++i)
+        DeleteScriptContext(&scheduler->instances[i].instance.context);
+    for (int i = 0; i < scheduler->programCount; ++i)
+    {
+        free(scheduler->programs[i].running);
+        free(scheduler->programs[i].free);
+        ReleaseProgram(scheduler->programs[i].program);
+    }
+
+    free(scheduler->instances);
+    free(scheduler->programs);
+    free(scheduler->deques);
+    free(scheduler);
+}
+
+//------------------------------------------------------------------------------
+int AddParallelProgram(SParallelScheduler* scheduler, SProgram* program, int quantum)
+{
+    scheduler->programs = realloc(scheduler->programs, (scheduler->programCount + 1) * sizeof(SProgramInstances));
+    SProgramInstances* p = &scheduler->programs[scheduler->programCount];
+    memset(p, 0, sizeof(SProgramInstances));
+    p->program = RetainProgram(program);
+    p->quantum = quantum;
+    return scheduler->programCount++;
+}
+
+//------------------------------------------------------------------------------
+// A freed instance of the program when there is one, its context is set up for the program already
+static int NewInstance(SParallelScheduler* scheduler, int program)
+{
+    SProgramInstances* p = &scheduler->programs[program];
+    if (p->freeCount > 0)
+        return p->free[--p->freeCount];
+
+    if (scheduler->instanceCount == scheduler->instanceCapacity)
+    {
+        scheduler->instanceCapacity = scheduler->instanceCapacity ? 2 * scheduler->instanceCapacity : 64;
+        scheduler->instances = realloc(scheduler->instances, scheduler->instanceCapacity * sizeof(SParallelInstance));
+    }
+
+    // every instance of the program can be running or free
+    if (p->instanceCount == p->capacity)
+    {
+        p->capacity = p->capacity ? 2 * p->capacity : 64;
+        p->running = realloc(p->running, p->capacity * sizeof(int));
+        p->free = realloc(p->free, p->capacity * sizeof(int));
+    }
+
+    ++p->instanceCount;
+    int instance = scheduler->instanceCount++;
+    scheduler->instances[instance].program = program;
+    InitScriptContext(&scheduler->instances[instance].instance.context, p->program);
+    return instance;
+}
+
+//------------------------------------------------------------------------------
+int SpawnParallelInstance(SParallelScheduler* scheduler, int program, int function, const SScriptValue* arguments,
+    int argumentCount)
+{
+    if (program < 0 || program >= scheduler->programCount)
+    {
+        printf("ERROR: Invalid program handle %d\n", program);
+        return -1;
+    }
+
+    SProgramInstances* p = &scheduler->programs[program];
+    int instance = NewInstance(scheduler, program);
+    SScriptInstance* s = &scheduler->instances[instance].instance;
+    if (StartFunction(&s->context, function, arguments, argumentCount) != R_OK)
+    {
+        s->isFree = HS_TRUE;
+        p->free[p->freeCount++] = instance;
+        return -1;
+    }
+
+    s->quantum = p->quantum;
+    s->state = SCRIPT_RUNNING;
+    s->result.i = 0;
+    s->isFree = HS_FALSE;
+    p->running[p->runningCount++] = instance;
+    return instance;
+}
+
+//------------------------------------------------------------------------------
+static Bool8 IsValid(const SParallelScheduler* scheduler, int instance)
+{
+    if (instance < 0 || instance >= scheduler->instanceCount || scheduler->instances[instance].instance.isFree)
+    {
+        printf("ERROR: Invalid instance handle %d\n", instance);
+        return HS_FALSE;
+    }
+    return HS_TRUE;
+}
+
+//------------------------------------------------------------------------------
+const SScriptInstance* GetParallelInstance(const SParallelScheduler* scheduler, int instance)
+{
+    return IsValid(scheduler, instance) ? &scheduler->instances[instance].instance : NULL;
+}
+
+//------------------------------------------------------------------------------
+void FreeParallelInstance(SParallelScheduler* scheduler, int instance)
+{
+    if (!IsValid(scheduler, instance))
+        return;
+
+    SScriptInstance* s = &scheduler->instances[instance].instance;
+    SProgramInstances* p = &scheduler->programs[scheduler->instances[instance].program];
+    if (s->state == SCRIPT_RUNNING)
+    {
+        // the others keep their order
+        int i = 0;
+        while (p->running[i] != instance)
+            ++i;
+        memmove(&p->running[i], &p->running[i + 1], (p->runningCount - i - 1) * sizeof(int));
+        --p->runningCount;
+    }
+
+    s->context.function = -1;
+    s->isFree = HS_TRUE;
+    p->free[p->freeCount++] = instance;
+}
+
+//------------------------------------------------------------------------------
+// Cuts the running instances of every program into batches, each thread gets a contiguous
+// share of them
+static void DealBatches(SParallelScheduler* scheduler)
+{
+    int batchCount = 0;
+    for (int i = 0; i < scheduler->programCount; ++i)
+        batchCount += (scheduler->programs[i].runningCount + HS_STEAL_BATCH - 1) / HS_STEAL_BATCH;
+
+    int threadCount = GetThreadCount(scheduler->pool);
+    int program = 0;
+    int first = 0;
+    for (int thread = 0; thread < threadCount; ++thread)
+    {
+        SDeque* deque = &scheduler->deques[thread].deque;
+        int count = (thread + 1) * batchCount / threadCount - thread * batchCount / threadCount;
+        if (count > deque->capacity)
+        {
+            deque->capacity = count;
+            deque->batches = realloc(deque->batches, count * sizeof(SBatch));
+        }
+
+        for (int i = 0; i < count; ++i)
+        {
+            while (first >= scheduler->programs[program].runningCount)
+            {
+                ++program;
+                first = 0;
+            }
+
+            int left = scheduler->programs[program].runningCount - first;
+            deque->batches[i] = (SBatch){ program, first, left < HS_STEAL_BATCH ? left : HS_STEAL_BATCH };
+            first += HS_STEAL_BATCH;
+        }
+
+        deque->top = 0;
+        deque->bottom = count;
+        deque->stolen = 0;
+    }
+}
+
+//------------------------------------------------------------------------------
+// The owner's end of the deque (Chase and Lev), only the last batch is contended
+static Bool8 PopBatch(SDeque* deque, SBatch* outBatch)
+{
+    int bottom = __atomic_load_n(&deque->bottom, __ATOMIC_RELAXED) - 1;
+    __atomic_store_n(&deque->bottom, bottom, __ATOMIC_SEQ_CST);
+    int top = __atomic_load_n(&deque->top, __ATOMIC_SEQ_CST);
+    if (top > bottom)
+    {
+        __atomic_store_n(&deque->bottom, bottom + 1, __ATOMIC_RELAXED);
+        return HS_FALSE;
+    }
+
+    *outBatch = deque->batches[bottom];
+    if (top < bottom)
+        return HS_TRUE;
+
+    // the last one goes to whoever moves top first
+    Bool8 taken = __atomic_compare_exchange_n(&deque->top, &top, top + 1, HS_FALSE, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED);
+    __atomic_store_n(&deque->bottom, bottom + 1, __ATOMIC_RELAXED);
+    return taken;
+}
+
+//------------------------------------------------------------------------------
+// Tries the other deques from the next thread on. No batches are added during a tick, so
+// when every deque is empty the tick is done for this thread.
+static Bool8 StealBatch(SParallelScheduler* scheduler, int thread, SBatch* outBatch)
+{
+    int threadCount = GetThreadCount(scheduler->pool);
+    for (int i = 1; i < threadCount; ++i)
+    {
+        SDeque* victim = &scheduler->deques[(thread + i) % threadCount].deque;
+        for (;;)
+        {
+            int top = __atomic_load_n(&victim->top, __ATOMIC_SEQ_CST);
+            int bottom = __atomic_load_n(&victim->bottom, __ATOMIC_SEQ_CST);
+            if (top >= bottom)
+                break;
+
+            *outBatch = victim->batches[top];
+            if (__atomic_compare_exchange_n(&victim->top, &top, top + 1, HS_FALSE, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+            {
+                ++scheduler->deques[thread].deque.stolen;
+                return HS_TRUE;
+            }
+        }
+    }
+    return HS_FALSE;
+}
+
+//------------------------------------------------------------------------------
+static void RunTick(void* data, int thread)
+{
+    SParallelScheduler* scheduler = data;
+    SDeque* deque = &scheduler->deques[thread].deque;
+    SBatch batch;
+    while (PopBatch(deque, &batch) || StealBatch(scheduler, thread, &batch))
+    {
+        const int* running = scheduler->programs[batch.program].running + batch.first;
+        for (int i = 0; i < batch.count; ++i)
+        {
+            SScriptInstance* s = &scheduler->instances[running[i]].instance;
+            s->state = ResumeFunction(&s->context, s->quantum, &s->result);
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+int RunParallelTick(SParallelScheduler* scheduler)
+{
+    DealBatches(scheduler);
+    RunOnThreads(scheduler->pool, RunTick, scheduler);
+
+    // the finished instances drop out of the lists in the order they ran
+    int runningCount = 0;
+    for (int i = 0; i < scheduler->programCount; ++i)
+    {
+        SProgramInstances* p = &scheduler->programs[i];
+        int count = 0;
+        for (int j = 0; j < p->runningCount; ++j)
+        {
+            if (scheduler->instances[p->running[j]].instance.state == SCRIPT_RUNNING)
+                p->running[count++] = p->running[j];
+        }
+        p->runningCount = count;
+        runningCount += count;
+    }
+    return runningCount;
+}
+
+//------------------------------------------------------------------------------
+int GetStolenBatchCount(const SParallelScheduler* scheduler)
+{
+    int stolen = 0;
+    for (int i = 0; i < GetThreadCount(scheduler->pool); ++i)
+        stolen += scheduler->deques[i].deque.stolen;
+    return stolen;
+}
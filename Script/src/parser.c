@@ -3,6 +3,7 @@
 
 #include <stdarg.h>
 #include <assert.h>
+#include <stddef.h>
 
 //------------------------------------------------------------------------------
 typedef struct
@@ -16,6 +17,7 @@ static SASTNode* g_NodesNext = g_Nodes;
 
 static SASTNode* AllocNode()
 {
+    assert(g_NodesNext < g_Nodes + sizeof(g_Nodes) / sizeof(g_Nodes[0]));
     return g_NodesNext++;
 }
 
@@ -50,7 +52,9 @@ statement      → exprStmt
                | ifStmt
                | printStmt
                | returnStmt
+               | switchStmt
                | whileStmt
+               | yieldStmt
                | block ;
 
 exprStmt       → expression ";" ;
@@ -59,9 +63,12 @@ forStmt        → "for" "(" ( varDecl | exprStmt | ";" )
                            expression? ")" statement ;
 ifStmt         → "if" "(" expression ")" statement
                  ( "else" statement )? ;
+switchStmt     → "switch" "(" expression ")" "{" switchCase* "}" ;
+switchCase     → ( "case" "-"? INTEGER | "default" ) ":" declaration* ;
 printStmt      → "print" expression ";" ;
 returnStmt     → "return" expression? ";" ;
 whileStmt      → "while" "(" expression ")" statement ;
+yieldStmt      → "yield" ";" ;
 block          → "{" declaration* "}" ;
 
 
@@ -124,6 +131,7 @@ SASTNode* MakeBinary(SASTNode* left, SToken* op, SASTNode* right)
     *node = (SASTNode)
     {
         .type = ANT_BINARY_OP,
+        .position = op->position,
         .binary =
         {
             .left = left,
@@ -142,6 +150,7 @@ SASTNode* MakeUnary(SToken* op, SASTNode* right)
     *node = (SASTNode)
     {
         .type = ANT_UNARY_OP,
+        .position = op->position,
         .unary =
         {
             .op = op,
@@ -159,6 +168,7 @@ SASTNode* MakeLiteral(SToken* literal)
     *node = (SASTNode)
     {
         .type = ANT_LITERAL,
+        .position = literal->position,
         .literal =
         {
             .token = literal,
@@ -168,13 +178,55 @@ SASTNode* MakeLiteral(SToken* literal)
     return node;
 }
 
+//------------------------------------------------------------------------------
+static SASTNode* Expr(SParserState* s);
+
+//------------------------------------------------------------------------------
+// IDENTIFIER "(" ( expression ( "," expression )* )? ")"
+static SASTNode* Call(SParserState* s)
+{
+    SASTNode* node = AllocNodeType(ANT_CALL);
+    node->position = s->t->position;
+    node->call.name = Expect(s->t++, TOKEN_IDENTIFIER);
+    node->call.arguments = NULL;
+    Expect(s->t++, TOKEN_LEFT_BRACE);
+
+    SASTNode** next = &node->call.arguments;
+    while (s->t->type != TOKEN_RIGHT_BRACE)
+    {
+        if (node->call.arguments)
+            Expect(s->t++, TOKEN_COMMA);
+
+        SASTNode* argument = AllocNodeType(ANT_ARGUMENT);
+        argument->position = s->t->position;
+        argument->argument.value = Expr(s);
+        argument->argument.next = NULL;
+        *next = argument;
+        next = &argument->argument.next;
+    }
+    ++s->t;
+
+    return node;
+}
+
 //------------------------------------------------------------------------------
 static SASTNode* Primary(SParserState* s)
 {
-    if (Match(s->t, 3, TOKEN_INTEGER, TOKEN_FLOAT, TOKEN_IDENTIFIER))
+    if (s->t->type == TOKEN_IDENTIFIER && (s->t + 1)->type == TOKEN_LEFT_BRACE)
+    {
+        return Call(s);
+    }
+    else if (Match(s->t, 3, TOKEN_INTEGER, TOKEN_FLOAT, TOKEN_IDENTIFIER))
     {
       return MakeLiteral(s->t++);
     }
+    else if (Match(s->t, 1, TOKEN_LEFT_BRACE))
+    {
+        ++s->t;
+        SASTNode* expr = Expr(s);
+        Expect(s->t++, TOKEN_RIGHT_BRACE);
+        return expr;
+    }
     else
     {
         assert(!"Unexpected");
@@ -225,12 +277,49 @@ static SASTNode* Term(SParserState* s)
     return expr;
 }
 
+//------------------------------------------------------------------------------
+static SASTNode* Comparison(SParserState* s)
+{
+    SASTNode* expr = Term(s);
+    while (Match(s->t, 4, TOKEN_GREATER, TOKEN_GREATER_EQUAL, TOKEN_LESS, TOKEN_LESS_EQUAL))
+    {
+        SToken* op = s->t++;
+        SASTNode* right = Term(s);
+
+        expr = MakeBinary(expr, op, right);
+    }
+
+    return expr;
+}
+
+//------------------------------------------------------------------------------
+static SASTNode* Equality(SParserState* s)
+{
+    SASTNode* expr = Comparison(s);
+    while (Match(s->t, 2, TOKEN_EQUAL_EQUAL, TOKEN_NOT_EQUAL))
+    {
+        SToken* op = s->t++;
+        SASTNode* right = Comparison(s);
+
+        expr = MakeBinary(expr, op, right);
+    }
+
+    return expr;
+}
+
 //------------------------------------------------------------------------------
 /*
+funDecl        → "fun" IDENTIFIER "(" ( parameter ( "," parameter )* )? ")" ( ":" IDENTIFIER )? block ;
+parameter      → IDENTIFIER ":" IDENTIFIER ;
+returnStmt     → "return" expression? ";" ;
+
 expression     → assignment ;
 
 assignment     → IDENTIFIER "=" assignment
-               | term ;
+               | equality ;
+
+primary        → NUMBER | IDENTIFIER | call | "(" expression ")" ;
+call           → IDENTIFIER "(" ( expression ( "," expression )* )? ")" ;
 */
 
 //------------------------------------------------------------------------------
@@ -239,6 +328,7 @@ static SASTNode* Assignment(SParserState* s)
     if ((s->t + 1)->type == TOKEN_EQUALS)
     {
         SASTNode* node = AllocNodeType(ANT_ASSIGN);
+        node->position = s->t->position;
 
         node->assign.var = Expect(s->t++, TOKEN_IDENTIFIER);
 
@@ -249,7 +339,7 @@ static SASTNode* Assignment(SParserState* s)
     }
     else
     {
-        return Term(s);
+        return Equality(s);
     }
 }
 
@@ -260,16 +350,140 @@ static SASTNode* Expr(SParserState* s)
     return expr;
 }
 
+//------------------------------------------------------------------------------
+static SASTNode* Declaration(SParserState* s);
+
+//------------------------------------------------------------------------------
+static SASTNode* SwitchCase(SParserState* s)
+{
+    SASTNode* node = AllocNodeType(ANT_CASE);
+    node->position = s->t->position;
+    node->switchCase.value = 0;
+    node->switchCase.isDefault = s->t->type == TOKEN_DEFAULT;
+    node->switchCase.body = NULL;
+    node->switchCase.next = NULL;
+
+    if (s->t++->type == TOKEN_CASE)
+    {
+        Bool8 isNegative = s->t->type == TOKEN_MINUS;
+        if (isNegative)
+            ++s->t;
+        int value = Expect(s->t++, TOKEN_INTEGER)->intNum;
+        node->switchCase.value = isNegative ? -value : value;
+    }
+    Expect(s->t++, TOKEN_COLON);
+
+    // The body is a block of everything up to the next case
+    SASTNode** next = &node->switchCase.body;
+    while (!Match(s->t, 3, TOKEN_CASE, TOKEN_DEFAULT, TOKEN_RIGHT_CURLY))
+    {
+        assert(s->t->type != TOKEN_END);
+        if (!node->switchCase.body)
+        {
+            node->switchCase.body = AllocNodeType(ANT_BLOCK);
+            node->switchCase.body->position = s->t->position;
+            next = &node->switchCase.body->stmt.block;
+        }
+        *next = Declaration(s);
+        next = &(*next)->decl.sibling;
+    }
+
+    return node;
+}
+
 //------------------------------------------------------------------------------
 static SASTNode* Statement(SParserState* s)
 {
     SASTNode* stmt = AllocNode();
-    // TODO(pavel): Match statements
+    stmt->position = s->t->position;
 
-    // Expression statement
-    stmt->type = ANT_EXPR_STMT;
-    stmt->stmt.expr = Expr(s);
-    Expect(s->t++, TOKEN_SEMICOLON);
+    switch (s->t->type)
+    {
+        case TOKEN_LEFT_CURLY:
+        {
+            ++s->t;
+            stmt->type = ANT_BLOCK;
+            stmt->stmt.block = NULL;
+
+            SASTNode** next = &stmt->stmt.block;
+            while (s->t->type != TOKEN_RIGHT_CURLY)
+            {
+                assert(s->t->type != TOKEN_END);
+                *next = Declaration(s);
+                next = &(*next)->decl.sibling;
+            }
+            ++s->t;
+            break;
+        }
+        case TOKEN_IF:
+        {
+            ++s->t;
+            stmt->type = ANT_IF;
+            Expect(s->t++, TOKEN_LEFT_BRACE);
+            stmt->stmt.ifStmt.cond = Expr(s);
+            Expect(s->t++, TOKEN_RIGHT_BRACE);
+            stmt->stmt.ifStmt.then = Statement(s);
+            stmt->stmt.ifStmt.otherwise = NULL;
+            if (s->t->type == TOKEN_ELSE)
+            {
+                ++s->t;
+                stmt->stmt.ifStmt.otherwise = Statement(s);
+            }
+            break;
+        }
+        case TOKEN_WHILE:
+        {
+            ++s->t;
+            stmt->type = ANT_WHILE;
+            Expect(s->t++, TOKEN_LEFT_BRACE);
+            stmt->stmt.whileStmt.cond = Expr(s);
+            Expect(s->t++, TOKEN_RIGHT_BRACE);
+            stmt->stmt.whileStmt.body = Statement(s);
+            break;
+        }
+        case TOKEN_SWITCH:
+        {
+            ++s->t;
+            stmt->type = ANT_SWITCH;
+            Expect(s->t++, TOKEN_LEFT_BRACE);
+            stmt->stmt.switchStmt.value = Expr(s);
+            Expect(s->t++, TOKEN_RIGHT_BRACE);
+            Expect(s->t++, TOKEN_LEFT_CURLY);
+
+            SASTNode** next = &stmt->stmt.switchStmt.cases;
+            *next = NULL;
+            while (s->t->type != TOKEN_RIGHT_CURLY)
+            {
+                assert(Match(s->t, 2, TOKEN_CASE, TOKEN_DEFAULT));
+                *next = SwitchCase(s);
+                next = &(*next)->switchCase.next;
+            }
+            ++s->t;
+            break;
+        }
+        case TOKEN_RETURN:
+        {
+            ++s->t;
+            stmt->type = ANT_RETURN;
+            stmt->stmt.expr = s->t->type != TOKEN_SEMICOLON ? Expr(s) : NULL;
+            Expect(s->t++, TOKEN_SEMICOLON);
+            break;
+        }
+        case TOKEN_YIELD:
+        {
+            ++s->t;
+            stmt->type = ANT_YIELD;
+            Expect(s->t++, TOKEN_SEMICOLON);
+            break;
+        }
+        default: // Expression statement
+        {
+            stmt->type = ANT_EXPR_STMT;
+            stmt->stmt.expr = Expr(s);
+            Expect(s->t++, TOKEN_SEMICOLON);
+            break;
+        }
+    }
 
     return stmt;
 }
@@ -292,6 +506,7 @@ static SASTNode* VariableDeclaration(SParserState* s)
     *varDecl = (SASTNode)
     {
         .type = ANT_DECL_VAR,
+        .position = name->position,
         .declVar =
         {
             .type = type,
@@ -305,10 +520,51 @@ static SASTNode* VariableDeclaration(SParserState* s)
     return varDecl;
 }
 
+//------------------------------------------------------------------------------
+// IDENTIFIER "(" ( parameter ( "," parameter )* )? ")" ( ":" IDENTIFIER )? block
+// parameter → IDENTIFIER ":" IDENTIFIER
+static SASTNode* FunctionDeclaration(SParserState* s)
+{
+    SASTNode* funcDecl = AllocNodeType(ANT_DECL_FUNC);
+    funcDecl->position = s->t->position;
+    funcDecl->declFunc.name = Expect(s->t++, TOKEN_IDENTIFIER);
+    funcDecl->declFunc.parameters = NULL;
+    funcDecl->declFunc.resultType = NULL;
+    Expect(s->t++, TOKEN_LEFT_BRACE);
+
+    SASTNode** next = &funcDecl->declFunc.parameters;
+    while (s->t->type != TOKEN_RIGHT_BRACE)
+    {
+        if (funcDecl->declFunc.parameters)
+            Expect(s->t++, TOKEN_COMMA);
+
+        SASTNode* parameter = AllocNodeType(ANT_PARAMETER);
+        parameter->position = s->t->position;
+        parameter->parameter.name = Expect(s->t++, TOKEN_IDENTIFIER);
+        Expect(s->t++, TOKEN_COLON);
+        parameter->parameter.type = Expect(s->t++, TOKEN_IDENTIFIER);
+        parameter->parameter.next = NULL;
+        *next = parameter;
+        next = &parameter->parameter.next;
+    }
+    ++s->t;
+
+    if (s->t->type == TOKEN_COLON)
+    {
+        ++s->t;
+        funcDecl->declFunc.resultType = Expect(s->t++, TOKEN_IDENTIFIER);
+    }
+
+    Expect(s->t, TOKEN_LEFT_CURLY);
+    funcDecl->declFunc.body = Statement(s);
+    return funcDecl;
+}
+
 //------------------------------------------------------------------------------
 static SASTNode* Declaration(SParserState* s)
 {
     SASTNode* decl = AllocNode();
+    decl->position = s->t->position;
     decl->decl.sibling = NULL;
 
     switch (s->t->type)
@@ -320,7 +576,13 @@ static SASTNode* Declaration(SParserState* s)
             decl->decl.declVar = VariableDeclaration(s);
             break;
         }
-        // TODO other declarations
+        case TOKEN_FUN:
+        {
+            ++s->t;
+            decl->type = ANT_DECL_FUNC;
+            decl->decl.declFunc = FunctionDeclaration(s);
+            break;
+        }
         default: // Statement
         {
             decl->type = ANT_DECL_STMT;
@@ -342,6 +604,9 @@ EResult Parse(SToken* tokens, int tokenCount, SASTNode** root)
         .t = tokens,
     };
 
+    // Nodes of the previously parsed program are reused
+    g_NodesNext = g_Nodes;
+
     *root = AllocNode();
     **root = (SASTNode)
     {
@@ -357,6 +622,9 @@ EResult Parse(SToken* tokens, int tokenCount, SASTNode** root)
         next = &(*next)->decl.sibling;
     }
 
+    // The end of the program is where the source ends
+    (*root)->position = state.t->position;
+
 
     return R_OK;
 }
@@ -0,0 +1,211 @@
+#if !defined(__x86_64__) && !defined(__i386__) && !defined(_M_X64) && !defined(_M_IX86)
+#define _POSIX_C_SOURCE 199309L
+#endif
+
+#include "profiler.h"
+#include "bytecode_c.h"
+#include "bytecode_info.h"
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+
+//------------------------------------------------------------------------------
+static inline uint64_t ReadTicks()
+{
+    return __rdtsc();
+}
+#else
+#include <time.h>
+
+//------------------------------------------------------------------------------
+static inline uint64_t ReadTicks()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000u + now.tv_nsec;
+}
+#endif
+
+//------------------------------------------------------------------------------
+// The instruction about to run ends the one before it
+static inline void ProfileInstruction(SProfile* profile, const SVMData* vmData)
+{
+    uint64_t now = ReadTicks();
+    if (profile->lastInstruction != INS_COUNT)
+        profile->ticks[profile->lastInstruction] += now - profile->lastTicks;
+
+    int offset = vmData->instructionStack.stackPointer - vmData->instructionStack.begin;
+    EInstruction instruction = *vmData->instructionStack.stackPointer;
+    if (instruction < INS_COUNT)
+    {
+        ++profile->counts[instruction];
+        ++profile->hits[offset];
+    }
+    profile->lastInstruction = instruction < INS_COUNT ? instruction : INS_COUNT;
+    profile->lastTicks = now;
+}
+
+//------------------------------------------------------------------------------
+// VMProcessInstructions with the counters
+static Bool8 ProcessProfiled(SVMData* vmData, int count, SProfile* profile)
+{
+#define HS_VM_CHECKED 1
+#define HS_VM_PROFILED 1
+#include "bytecode_interpreter.inl"
+#undef HS_VM_PROFILED
+#undef HS_VM_CHECKED
+}
+
+//------------------------------------------------------------------------------
+// The least time between two readings, interruptions make some of them longer
+static uint64_t MeasureClockTicks()
+{
+    uint64_t least = UINT64_MAX;
+    for (int i = 0; i < 1000; ++i)
+    {
+        uint64_t start = ReadTicks();
+        uint64_t ticks = ReadTicks() - start;
+        least = ticks < least ? ticks : least;
+    }
+    return least;
+}
+
+//------------------------------------------------------------------------------
+void InitProfile(SProfile* profile, SStackData instructions)
+{
+    memset(profile, 0, sizeof(SProfile));
+    profile->instructions = instructions;
+    profile->hits = calloc(instructions.end - instructions.begin + 1, sizeof(uint64_t));
+    profile->clockTicks = MeasureClockTicks();
+    profile->lastInstruction = INS_COUNT;
+}
+
+//------------------------------------------------------------------------------
+void DeleteProfile(SProfile* profile)
+{
+    free(profile->hits);
+    profile->hits = NULL;
+}
+
+//------------------------------------------------------------------------------
+Bool8 ProfiledProcessInstructions(SVMData* vmData, int count, SProfile* profile)
+{
+    Bool8 running = ProcessProfiled(vmData, count, profile);
+
+    // Time between the calls is not the instruction's
+    if (profile->lastInstruction != INS_COUNT)
+        profile->ticks[profile->lastInstruction] += ReadTicks() - profile->lastTicks;
+    profile->lastInstruction = INS_COUNT;
+    return running;
+}
+
+//------------------------------------------------------------------------------
+uint64_t GetProfiledInstructionCount(const SProfile* profile)
+{
+    uint64_t total = 0;
+    for (int i = 0; i < INS_COUNT; ++i)
+        total += profile->counts[i];
+    return total;
+}
+
+//------------------------------------------------------------------------------
+// An opcode or an offset of the report
+typedef struct
+{
+    int index;
+    uint64_t key; // Sorted by, the largest first
+} SProfileEntry;
+
+//------------------------------------------------------------------------------
+static int CompareProfileEntries(const void* a, const void* b)
+{
+    const SProfileEntry* first = a;
+    const SProfileEntry* second = b;
+    if (first->key != second->key)
+        return second->key > first->key ? 1 : -1;
+    return first->index - second->index;
+}
+
+//------------------------------------------------------------------------------
+void PrintProfile(const SProfile* profile, int maxOffsets, FILE* out)
+{
+    int size = profile->instructions.end - profile->instructions.begin;
+    uint64_t totalCount = GetProfiledInstructionCount(profile);
+    uint64_t totalTicks = 0;
+    for (int i = 0; i < INS_COUNT; ++i)
+        totalTicks += profile->ticks[i];
+
+    SProfileEntry opcodes[INS_COUNT];
+    int opcodeCount = 0;
+    for (int i = 0; i < INS_COUNT; ++i)
+    {
+        if (profile->counts[i] > 0)
+            opcodes[opcodeCount++] = (SProfileEntry){ i, profile->ticks[i] };
+    }
+
+    SProfileEntry* offsets = malloc((size + 1) * sizeof(SProfileEntry));
+    int offsetCount = 0;
+    for (int i = 0; i < size; ++i)
+    {
+        if (profile->hits[i] > 0)
+            offsets[offsetCount++] = (SProfileEntry){ i, profile->hits[i] };
+    }
+
+    qsort(opcodes, opcodeCount, sizeof(SProfileEntry), CompareProfileEntries);
+    qsort(offsets, offsetCount, sizeof(SProfileEntry), CompareProfileEntries);
+
+    fprintf(out, "%" PRIu64 " instructions, %" PRIu64 " ticks, %" PRIu64 " ticks per reading of the clock\n",
+        totalCount, totalTicks, profile->clockTicks);
+    fprintf(out, "%-28s %12s %7s %14s %7s %10s\n", "opcode", "count", "count%", "ticks", "ticks%", "ticks/ins");
+    for (int i = 0; i < opcodeCount; ++i)
+    {
+        int opcode = opcodes[i].index;
+        fprintf(out, "%-28s %12" PRIu64 " %6.2f%% %14" PRIu64 " %6.2f%% %10.1f\n",
+            GetInstructionName(opcode),
+            profile->counts[opcode],
+            100.0 * profile->counts[opcode] / totalCount,
+            profile->ticks[opcode],
+            totalTicks ? 100.0 * profile->ticks[opcode] / totalTicks : 0.0,
+            (double)profile->ticks[opcode] / profile->counts[opcode] - (double)profile->clockTicks);
+    }
+
+    if (offsetCount > maxOffsets)
+        offsetCount = maxOffsets;
+    fprintf(out, "\n%-8s %-28s %12s %7s\n", "offset", "instruction", "hits", "hits%");
+    for (int i = 0; i < offsetCount; ++i)
+    {
+        int offset = offsets[i].index;
+        fprintf(out, "%8d %-28s %12" PRIu64 " %6.2f%%\n",
+            offset,
+            GetInstructionName(profile->instructions.begin[offset]),
+            profile->hits[offset],
+            100.0 * profile->hits[offset] / totalCount);
+    }
+
+    free(offsets);
+}
+
+//------------------------------------------------------------------------------
+void WriteProfileCsv(const SProfile* profile, FILE* out)
+{
+    int size = profile->instructions.end - profile->instructions.begin;
+    fprintf(out, "kind,index,name,count,ticks\n");
+    for (int i = 0; i < INS_COUNT; ++i)
+    {
+        if (profile->counts[i] > 0)
+            fprintf(out, "opcode,%d,%s,%" PRIu64 ",%" PRIu64 "\n", i, GetInstructionName(i), profile->counts[i], profile->ticks[i]);
+    }
+    for (int i = 0; i < size; ++i)
+    {
+        if (profile->hits[i] > 0)
+            fprintf(out, "offset,%d,%s,%" PRIu64 ",\n", i, GetInstructionName(profile->instructions.begin[i]), profile->hits[i]);
+    }
+}
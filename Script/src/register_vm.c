@@ -0,0 +1,196 @@
+#include "register_vm.h"
+#include "bytecode_c.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//------------------------------------------------------------------------------
+void DeleteRegProgram(SRegProgram* program)
+{
+    free(program->instructions.begin);
+    free(program->globalTypes);
+    program->instructions = (SStackData){ 0 };
+    program->globalTypes = NULL;
+}
+
+//------------------------------------------------------------------------------
+void InitRegVM(SRegVMData* vmData, const SRegProgram* program)
+{
+    memset(vmData->registers, 0, sizeof(vmData->registers));
+    vmData->instructionStack = program->instructions;
+    vmData->instructionStack.stackPointer = program->instructions.begin;
+    vmData->error = VM_OK;
+}
+
+//------------------------------------------------------------------------------
+Bool8 RegVMProcessInstructions(SRegVMData* vmData, int count)
+{
+    SRegister* r = vmData->registers;
+    byte* begin = vmData->instructionStack.begin;
+    byte* ins = vmData->instructionStack.stackPointer;
+
+    for (int i = 0; i < count; ++i)
+    {
+        switch ((ERegInstruction)*ins)
+        {
+            case RINS_NOOP: ins += 1; break;
+
+            case RINS_LOAD_I: r[ins[1]].i = LoadInt(ins + 2); ins += 2 + sizeof(hsbint); break;
+            case RINS_LOAD_F: r[ins[1]].f = LoadFloat(ins + 2); ins += 2 + sizeof(hsbfloat); break;
+            case RINS_MOVE: r[ins[1]] = r[ins[2]]; ins += 3; break;
+
+            case RINS_ADD_I: r[ins[1]].i = r[ins[2]].i + r[ins[3]].i; ins += 4; break;
+            case RINS_ADD_F: r[ins[1]].f = r[ins[2]].f + r[ins[3]].f; ins += 4; break;
+            case RINS_SUBSTRACT_I: r[ins[1]].i = r[ins[2]].i - r[ins[3]].i; ins += 4; break;
+            case RINS_SUBSTRACT_F: r[ins[1]].f = r[ins[2]].f - r[ins[3]].f; ins += 4; break;
+            case RINS_MULTIPLY_I: r[ins[1]].i = r[ins[2]].i * r[ins[3]].i; ins += 4; break;
+            case RINS_MULTIPLY_F: r[ins[1]].f = r[ins[2]].f * r[ins[3]].f; ins += 4; break;
+            case RINS_DIVIDE_I: r[ins[1]].i = r[ins[2]].i / r[ins[3]].i; ins += 4; break;
+            case RINS_DIVIDE_F: r[ins[1]].f = r[ins[2]].f / r[ins[3]].f; ins += 4; break;
+
+            case RINS_JUMP: ins = begin + LoadAddress(ins + 1); break;
+
+#define HS_REG_JUMP_IF(condition) ins = (condition) ? begin + LoadAddress(ins + 3) : ins + 3 + sizeof(hsbaddress); break
+            case RINS_JUMP_I_EQ: HS_REG_JUMP_IF(r[ins[1]].i == r[ins[2]].i);
+            case RINS_JUMP_I_NOT_EQ: HS_REG_JUMP_IF(r[ins[1]].i != r[ins[2]].i);
+            case RINS_JUMP_I_LESS: HS_REG_JUMP_IF(r[ins[1]].i < r[ins[2]].i);
+            case RINS_JUMP_I_LESS_EQ: HS_REG_JUMP_IF(r[ins[1]].i <= r[ins[2]].i);
+            case RINS_JUMP_F_EQ: HS_REG_JUMP_IF(r[ins[1]].f == r[ins[2]].f);
+            case RINS_JUMP_F_NOT_EQ: HS_REG_JUMP_IF(r[ins[1]].f != r[ins[2]].f);
+            case RINS_JUMP_F_LESS: HS_REG_JUMP_IF(r[ins[1]].f < r[ins[2]].f);
+            case RINS_JUMP_F_LESS_EQ: HS_REG_JUMP_IF(r[ins[1]].f <= r[ins[2]].f);
+            case RINS_JUMP_F_NOT_LESS: HS_REG_JUMP_IF(!(r[ins[1]].f < r[ins[2]].f));
+            case RINS_JUMP_F_NOT_LESS_EQ: HS_REG_JUMP_IF(!(r[ins[1]].f <= r[ins[2]].f));
+#undef HS_REG_JUMP_IF
+
+            case RINS_SWITCH:
+            {
+                int index = r[ins[1]].i - LoadInt(ins + 2);
+                byte* entry = ins + 3 + sizeof(hsbint);
+                if (index >= 0 && index < ins[2 + sizeof(hsbint)])
+                    entry += (index + 1) * (1 + sizeof(hsbaddress));
+                ins = begin + LoadAddress(entry + 1);
+                break;
+            }
+
+            case RINS_END:
+                // stay on the instruction, the program is finished
+                vmData->instructionStack.stackPointer = ins;
+                return HS_FALSE;
+
+            default:
+                vmData->instructionStack.stackPointer = ins;
+                vmData->error = VM_ERROR_INVALID_INSTRUCTION;
+                return HS_FALSE;
+        }
+
+        // no instructions left, reached end of the program
+        if (ins >= vmData->instructionStack.end)
+        {
+            vmData->instructionStack.stackPointer = ins;
+            return HS_FALSE;
+        }
+    }
+
+    vmData->instructionStack.stackPointer = ins;
+    return HS_TRUE;
+}
+
+//------------------------------------------------------------------------------
+const char* GetRegInstructionName(ERegInstruction instruction)
+{
+    switch (instruction)
+    {
+        case RINS_NOOP: return "RINS_NOOP";
+        case RINS_LOAD_I: return "RINS_LOAD_I";
+        case RINS_LOAD_F: return "RINS_LOAD_F";
+        case RINS_MOVE: return "RINS_MOVE";
+        case RINS_ADD_I: return "RINS_ADD_I";
+        case RINS_ADD_F: return "RINS_ADD_F";
+        case RINS_SUBSTRACT_I: return "RINS_SUBSTRACT_I";
+        case RINS_SUBSTRACT_F: return "RINS_SUBSTRACT_F";
+        case RINS_MULTIPLY_I: return "RINS_MULTIPLY_I";
+        case RINS_MULTIPLY_F: return "RINS_MULTIPLY_F";
+        case RINS_DIVIDE_I: return "RINS_DIVIDE_I";
+        case RINS_DIVIDE_F: return "RINS_DIVIDE_F";
+        case RINS_JUMP: return "RINS_JUMP";
+        case RINS_JUMP_I_EQ: return "RINS_JUMP_I_EQ";
+        case RINS_JUMP_I_NOT_EQ: return "RINS_JUMP_I_NOT_EQ";
+        case RINS_JUMP_I_LESS: return "RINS_JUMP_I_LESS";
+        case RINS_JUMP_I_LESS_EQ: return "RINS_JUMP_I_LESS_EQ";
+        case RINS_JUMP_F_EQ: return "RINS_JUMP_F_EQ";
+        case RINS_JUMP_F_NOT_EQ: return "RINS_JUMP_F_NOT_EQ";
+        case RINS_JUMP_F_LESS: return "RINS_JUMP_F_LESS";
+        case RINS_JUMP_F_LESS_EQ: return "RINS_JUMP_F_LESS_EQ";
+        case RINS_JUMP_F_NOT_LESS: return "RINS_JUMP_F_NOT_LESS";
+        case RINS_JUMP_F_NOT_LESS_EQ: return "RINS_JUMP_F_NOT_LESS_EQ";
+        case RINS_SWITCH: return "RINS_SWITCH";
+        case RINS_END: return "RINS_END";
+        default: return "ERROR_INVALID_INSTRUCTION";
+    }
+}
+
+//------------------------------------------------------------------------------
+int GetRegInstructionSize(ERegInstruction instruction)
+{
+    switch (instruction)
+    {
+        case RINS_NOOP:
+        case RINS_END:
+            return 1;
+        case RINS_LOAD_I:
+            return 2 + sizeof(hsbint);
+        case RINS_LOAD_F:
+            return 2 + sizeof(hsbfloat);
+        case RINS_MOVE:
+            return 3;
+        case RINS_JUMP:
+            return 1 + sizeof(hsbaddress);
+        case RINS_SWITCH:
+            return 3 + sizeof(hsbint);
+        default:
+            if (instruction >= RINS_ADD_I && instruction <= RINS_DIVIDE_F)
+                return 4;
+            if (instruction >= RINS_JUMP_I_EQ && instruction <= RINS_JUMP_F_NOT_LESS_EQ)
+                return 3 + sizeof(hsbaddress);
+            return 0;
+    }
+}
+
+//------------------------------------------------------------------------------
+void PrintRegInstructions(const SRegProgram* program)
+{
+    byte* begin = program->instructions.begin;
+    byte* ins = begin;
+    while (ins < program->instructions.end)
+    {
+        ERegInstruction instruction = *ins;
+        int size = GetRegInstructionSize(instruction);
+        printf("%5d  %s", (int)(ins - begin), GetRegInstructionName(instruction));
+
+        if (size == 0)
+        {
+            printf("\n");
+            return;
+        }
+
+        if (instruction == RINS_LOAD_I)
+            printf(" r%d %d", ins[1], LoadInt(ins + 2));
+        else if (instruction == RINS_LOAD_F)
+            printf(" r%d %f", ins[1], LoadFloat(ins + 2));
+        else if (instruction == RINS_MOVE)
+            printf(" r%d r%d", ins[1], ins[2]);
+        else if (instruction == RINS_JUMP)
+            printf(" @%d", LoadAddress(ins + 1));
+        else if (instruction == RINS_SWITCH)
+            printf(" r%d %d %d", ins[1], LoadInt(ins + 2), ins[2 + sizeof(hsbint)]);
+        else if (size == 4)
+            printf(" r%d r%d r%d", ins[1], ins[2], ins[3]);
+        else if (size == 3 + (int)sizeof(hsbaddress))
+            printf(" r%d r%d @%d", ins[1], ins[2], LoadAddress(ins + 3));
+
+        printf("\n");
+        ins += size;
+    }
+}
@@ -0,0 +1,91 @@
+#include "runner.h"
+#include "thread_pool.h"
+
+#include <stdlib.h>
+
+//------------------------------------------------------------------------------
+// The VMs of the threads change with every call, a cache line apart they do not slow each other down
+typedef union
+{
+    SScriptContext context;
+    byte padding[sizeof(SScriptContext) + 64];
+} SRunnerContext;
+
+//------------------------------------------------------------------------------
+struct SScriptRunner
+{
+    SProgram* program;
+    SThreadPool* pool;
+    SRunnerContext* contexts; // One per thread of the pool
+
+    SScriptJob* jobs;
+    int jobCount;
+    int nextJob; // Taken with an atomic add, HS_RUNNER_CHUNK at a time
+    int failed;
+};
+
+//------------------------------------------------------------------------------
+// Runs chunks of the jobs until there are none left
+static void RunJobs(void* data, int thread)
+{
+    SScriptRunner* runner = data;
+    SScriptContext* context = &runner->contexts[thread].context;
+    int failed = 0;
+    for (;;)
+    {
+        int first = __atomic_fetch_add(&runner->nextJob, HS_RUNNER_CHUNK, __ATOMIC_RELAXED);
+        if (first >= runner->jobCount)
+            break;
+
+        int last = first + HS_RUNNER_CHUNK < runner->jobCount ? first + HS_RUNNER_CHUNK : runner->jobCount;
+        for (int i = first; i < last; ++i)
+        {
+            SScriptJob* job = &runner->jobs[i];
+            job->status = CallFunction(context, job->function, job->arguments, job->argumentCount, &job->result);
+            failed |= job->status != R_OK;
+        }
+    }
+
+    if (failed)
+        __atomic_store_n(&runner->failed, 1, __ATOMIC_RELAXED);
+}
+
+//------------------------------------------------------------------------------
+SScriptRunner* CreateScriptRunner(SProgram* program, int threadCount)
+{
+    SThreadPool* pool = CreateThreadPool(threadCount);
+    if (!pool)
+        return NULL;
+
+    SScriptRunner* runner = calloc(1, sizeof(SScriptRunner));
+    runner->program = RetainProgram(program);
+    runner->pool = pool;
+    threadCount = GetThreadCount(runner->pool);
+    runner->contexts = malloc(threadCount * sizeof(SRunnerContext));
+    for (int i = 0; i < threadCount; ++i)
+        InitScriptContext(&runner->contexts[i].context, program);
+    return runner;
+}
+
+//------------------------------------------------------------------------------
+void DeleteScriptRunner(SScriptRunner* runner)
+{
+    int threadCount = GetThreadCount(runner->pool);
+    DeleteThreadPool(runner->pool);
+    for (int i = 0; i < threadCount; ++i)
+        DeleteScriptContext(&runner->contexts[i].context);
+    ReleaseProgram(runner->program);
+    free(runner->contexts);
+    free(runner);
+}
+
+//------------------------------------------------------------------------------
+EResult RunScriptJobs(SScriptRunner* runner, SScriptJob* jobs, int jobCount)
+{
+    runner->jobs = jobs;
+    runner->jobCount = jobCount;
+    runner->nextJob = 0;
+    runner->failed = 0;
+    RunOnThreads(runner->pool, RunJobs, runner);
+    return runner->failed ? R_ERROR : R_OK;
+}
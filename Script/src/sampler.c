@@ -0,0 +1,391 @@
+#include "sampler.h"
+#include "bytecode_c.h"
+#include "bytecode_info.h"
+#include "verifier.h"
+
+#include <inttypes.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+//------------------------------------------------------------------------------
+// Return addresses of every offset from the stack layouts, none when the verifier rejects the code
+static void FindReturnSlots(SSampleProfile* profile)
+{
+    int size = profile->instructions.end - profile->instructions.begin;
+    SVerifyResult verifyResult;
+    SStackLayout** layouts;
+    if (VerifyInstructionsWithLayouts(profile->instructions, INT_MAX, &verifyResult, &layouts) != R_OK)
+        return;
+
+    int slotCount = 0;
+    for (int offset = 0; offset < size; ++offset)
+    {
+        for (int i = 0; layouts[offset] && i < layouts[offset]->varCount; ++i)
+            slotCount += layouts[offset]->vars[i] == TAG_ADDRESS;
+    }
+
+    profile->slots = malloc((slotCount + 1) * sizeof(int));
+    slotCount = 0;
+    for (int offset = 0; offset < size; ++offset)
+    {
+        profile->returnSlots[offset] = slotCount;
+        const SStackLayout* layout = layouts[offset];
+        if (!layout)
+            continue;
+
+        profile->functions[offset] = layout->function > 0 ? layout->function : 0;
+        int slot = 0;
+        for (int i = layout->varCount - 1; i >= 0; --i)
+        {
+            if (layout->vars[i] == TAG_ADDRESS)
+                profile->slots[slotCount++] = slot;
+            slot += GetTagSize(layout->vars[i]);
+        }
+    }
+    profile->returnSlots[size] = slotCount;
+
+    FreeStackLayouts(layouts, size);
+}
+
+//------------------------------------------------------------------------------
+// Instructions until the sample after the next, xorshift spreads them over half the period
+static int NextChunk(SSampleProfile* profile)
+{
+    profile->random ^= profile->random << 13;
+    profile->random ^= profile->random >> 17;
+    profile->random ^= profile->random << 5;
+    int spread = profile->period / 2;
+    return profile->period - profile->period / 4 + (int)(profile->random % (spread + 1));
+}
+
+//------------------------------------------------------------------------------
+void InitSampleProfile(SSampleProfile* profile, SStackData instructions, int period)
+{
+    memset(profile, 0, sizeof(SSampleProfile));
+    int size = instructions.end - instructions.begin;
+    profile->instructions = instructions;
+    profile->period = period > 0 ? period : 1;
+    profile->samples = calloc(size + 1, sizeof(uint64_t));
+    profile->firstStacks = malloc((size + 1) * sizeof(int));
+    for (int i = 0; i <= size; ++i)
+        profile->firstStacks[i] = -1;
+
+    profile->functions = calloc(size + 1, sizeof(int));
+    profile->returnSlots = calloc(size + 1, sizeof(int));
+    FindReturnSlots(profile);
+
+    profile->random = 0x9E3779B9u;
+    profile->untilSample = NextChunk(profile);
+}
+
+//------------------------------------------------------------------------------
+void DeleteSampleProfile(SSampleProfile* profile)
+{
+    free(profile->samples);
+    free(profile->stacks);
+    free(profile->firstStacks);
+    free(profile->frames);
+    free(profile->functions);
+    free(profile->returnSlots);
+    free(profile->slots);
+    memset(profile, 0, sizeof(SSampleProfile));
+}
+
+//------------------------------------------------------------------------------
+static void AddStack(SSampleProfile* profile, const hsbaddress* frames, int depth)
+{
+    int offset = frames[depth - 1];
+    ++profile->samples[offset];
+    ++profile->sampleCount;
+
+    for (int i = profile->firstStacks[offset]; i >= 0; i = profile->stacks[i].next)
+    {
+        SSampleStack* stack = &profile->stacks[i];
+        if (stack->depth == depth && memcmp(profile->frames + stack->first, frames, depth * sizeof(hsbaddress)) == 0)
+        {
+            ++stack->count;
+            return;
+        }
+    }
+
+    if (profile->stackCount == profile->stackCapacity)
+    {
+        profile->stackCapacity = profile->stackCapacity ? profile->stackCapacity * 2 : 16;
+        profile->stacks = realloc(profile->stacks, profile->stackCapacity * sizeof(SSampleStack));
+    }
+    while (profile->frameCount + depth > profile->frameCapacity)
+    {
+        profile->frameCapacity = profile->frameCapacity ? profile->frameCapacity * 2 : 64;
+        profile->frames = realloc(profile->frames, profile->frameCapacity * sizeof(hsbaddress));
+    }
+
+    memcpy(profile->frames + profile->frameCount, frames, depth * sizeof(hsbaddress));
+    profile->stacks[profile->stackCount] = (SSampleStack){ profile->frameCount, depth, profile->firstStacks[offset], 1 };
+    profile->firstStacks[offset] = profile->stackCount++;
+    profile->frameCount += depth;
+}
+
+//------------------------------------------------------------------------------
+// The instruction about to run and the calls it is in
+static void TakeSample(SSampleProfile* profile, const SVMData* vmData)
+{
+    int offset = vmData->instructionStack.stackPointer - vmData->instructionStack.begin;
+    if (offset < 0 || offset >= profile->instructions.end - profile->instructions.begin)
+        return;
+
+    hsbaddress frames[HS_LAYOUT_MAX_VALUES + 1];
+    int depth = profile->returnSlots[offset + 1] - profile->returnSlots[offset];
+    if (depth < 0)
+        depth = 0;
+
+    // The slots are the innermost first, the frames the outermost
+    for (int i = 0; i < depth; ++i)
+    {
+        byte* var = vmData->dataStack.reversePointer + profile->slots[profile->returnSlots[offset] + i];
+        frames[depth - 1 - i] = LoadAddressVar(&var);
+    }
+    frames[depth] = offset;
+    AddStack(profile, frames, depth + 1);
+}
+
+//------------------------------------------------------------------------------
+Bool8 SampledProcessInstructions(SVMData* vmData, int count, SSampleProfile* profile)
+{
+    while (count > 0)
+    {
+        int chunk = profile->untilSample < count ? profile->untilSample : count;
+        if (!VMProcessInstructions(vmData, chunk))
+            return HS_FALSE;
+
+        count -= chunk;
+        profile->untilSample -= chunk;
+        if (profile->untilSample == 0)
+        {
+            TakeSample(profile, vmData);
+            profile->untilSample = NextChunk(profile);
+        }
+    }
+    return HS_TRUE;
+}
+
+//------------------------------------------------------------------------------
+// Line of every offset, 0 where the table has none
+static int* MapLines(const SSampleProfile* profile, const SLineTable* lines)
+{
+    int size = profile->instructions.end - profile->instructions.begin;
+    int* lineOf = calloc(size + 1, sizeof(int));
+    if (!lines)
+        return lineOf;
+
+    SLineEntry entry = { 0 };
+    int line = 0;
+    int offset = 0;
+    while (ReadLineEntry(lines, &entry) && entry.offset < size)
+    {
+        for (; offset < entry.offset; ++offset)
+            lineOf[offset] = line;
+        line = entry.position.line;
+    }
+    for (; offset < size; ++offset)
+        lineOf[offset] = line;
+    return lineOf;
+}
+
+//------------------------------------------------------------------------------
+// Instruction a frame stands for, the call before the return address for all but the last
+static int GetFrameOffset(const SSampleProfile* profile, const SSampleStack* stack, int frame)
+{
+    int offset = profile->frames[stack->first + frame];
+    return frame < stack->depth - 1 ? offset - GetInstructionSize(INS_CALL) : offset;
+}
+
+//------------------------------------------------------------------------------
+static int PrintFunctionName(char* text, int function)
+{
+    return function ? sprintf(text, "function_%d", function) : sprintf(text, "main");
+}
+
+//------------------------------------------------------------------------------
+static int PrintFrame(char* text, const SSampleProfile* profile, const int* lineOf, int offset, Bool8 perLine)
+{
+    int length = PrintFunctionName(text, offset >= 0 ? profile->functions[offset] : 0);
+    if (perLine)
+    {
+        if (offset >= 0 && lineOf[offset] > 0)
+            length += sprintf(text + length, ":%d", lineOf[offset]);
+        else
+            length += sprintf(text + length, "+%d", offset);
+    }
+    return length;
+}
+
+//------------------------------------------------------------------------------
+// A function, a line or a folded stack of the reports
+typedef struct
+{
+    int index;
+    uint64_t key; // Sorted by, the largest first
+} SSampleEntry;
+
+//------------------------------------------------------------------------------
+static int CompareSampleEntries(const void* a, const void* b)
+{
+    const SSampleEntry* first = a;
+    const SSampleEntry* second = b;
+    if (first->key != second->key)
+        return second->key > first->key ? 1 : -1;
+    return first->index - second->index;
+}
+
+//------------------------------------------------------------------------------
+// Prints the line of the source without its indentation
+static void PrintSourceLine(const char* source, int line, FILE* out)
+{
+    for (int current = 1; *source && current < line; ++source)
+        current += *source == '\n';
+
+    while (*source == ' ' || *source == '\t')
+        ++source;
+    int length = 0;
+    while (source[length] && source[length] != '\n' && source[length] != '\r')
+        ++length;
+    fprintf(out, "%.*s", length, source);
+}
+
+//------------------------------------------------------------------------------
+void PrintSampleProfile(const SSampleProfile* profile, const SLineTable* lines, const char* source, FILE* out)
+{
+    int size = profile->instructions.end - profile->instructions.begin;
+    int* lineOf = MapLines(profile, lines);
+    int maxLine = 0;
+    for (int i = 0; i < size; ++i)
+        maxLine = lineOf[i] > maxLine ? lineOf[i] : maxLine;
+
+    // Functions are indexed by their entry, a function counts once per stack for its total
+    uint64_t* self = calloc(size + 1, sizeof(uint64_t));
+    uint64_t* total = calloc(size + 1, sizeof(uint64_t));
+    int* lastStack = malloc((size + 1) * sizeof(int));
+    uint64_t* lineSamples = calloc(maxLine + 1, sizeof(uint64_t));
+    for (int i = 0; i <= size; ++i)
+        lastStack[i] = -1;
+
+    for (int i = 0; i < profile->stackCount; ++i)
+    {
+        const SSampleStack* stack = &profile->stacks[i];
+        for (int frame = 0; frame < stack->depth; ++frame)
+        {
+            int offset = GetFrameOffset(profile, stack, frame);
+            int function = offset >= 0 ? profile->functions[offset] : 0;
+            if (lastStack[function] != i)
+                total[function] += stack->count;
+            lastStack[function] = i;
+        }
+
+        int offset = profile->frames[stack->first + stack->depth - 1];
+        self[profile->functions[offset]] += stack->count;
+        lineSamples[lineOf[offset]] += stack->count;
+    }
+
+    SSampleEntry* entries = malloc((size + maxLine + 2) * sizeof(SSampleEntry));
+    int entryCount = 0;
+    for (int i = 0; i < size; ++i)
+    {
+        if (total[i] > 0)
+            entries[entryCount++] = (SSampleEntry){ i, total[i] };
+    }
+    qsort(entries, entryCount, sizeof(SSampleEntry), CompareSampleEntries);
+
+    uint64_t samples = profile->sampleCount ? profile->sampleCount : 1;
+    fprintf(out, "%" PRIu64 " samples, one every %d instructions\n", profile->sampleCount, profile->period);
+    fprintf(out, "%-20s %10s %7s %10s %7s\n", "function", "self", "self%", "total", "total%");
+    for (int i = 0; i < entryCount; ++i)
+    {
+        char name[32];
+        int function = entries[i].index;
+        PrintFunctionName(name, function);
+        fprintf(out, "%-20s %10" PRIu64 " %6.2f%% %10" PRIu64 " %6.2f%%\n",
+            name, self[function], 100.0 * self[function] / samples, total[function], 100.0 * total[function] / samples);
+    }
+
+    entryCount = 0;
+    for (int i = 0; i <= maxLine; ++i)
+    {
+        if (lineSamples[i] > 0)
+            entries[entryCount++] = (SSampleEntry){ i, lineSamples[i] };
+    }
+    qsort(entries, entryCount, sizeof(SSampleEntry), CompareSampleEntries);
+
+    fprintf(out, "\n%6s %10s %8s  %s\n", "line", "samples", "samples%", "source");
+    for (int i = 0; i < entryCount; ++i)
+    {
+        int line = entries[i].index;
+        if (line > 0)
+            fprintf(out, "%6d", line);
+        else
+            fprintf(out, "%6s", "-");
+        fprintf(out, " %10" PRIu64 " %7.2f%%  ", lineSamples[line], 100.0 * lineSamples[line] / samples);
+        if (source && line > 0)
+            PrintSourceLine(source, line, out);
+        fprintf(out, "\n");
+    }
+
+    free(entries);
+    free(lineSamples);
+    free(lastStack);
+    free(total);
+    free(self);
+    free(lineOf);
+}
+
+//------------------------------------------------------------------------------
+typedef struct
+{
+    char* text; // Frames of the stack
+    uint64_t count;
+} SFoldedStack;
+
+//------------------------------------------------------------------------------
+static int CompareFoldedStacks(const void* a, const void* b)
+{
+    return strcmp(((const SFoldedStack*)a)->text, ((const SFoldedStack*)b)->text);
+}
+
+//------------------------------------------------------------------------------
+void WriteFoldedStacks(const SSampleProfile* profile, const SLineTable* lines, const char* name, Bool8 perLine, FILE* out)
+{
+    int* lineOf = MapLines(profile, lines);
+    int nameLength = name ? strlen(name) + 1 : 0;
+
+    SFoldedStack* folded = malloc((profile->stackCount + 1) * sizeof(SFoldedStack));
+    for (int i = 0; i < profile->stackCount; ++i)
+    {
+        const SSampleStack* stack = &profile->stacks[i];
+        char* text = malloc(nameLength + stack->depth * 40 + 1);
+        int length = name ? sprintf(text, "%s", name) : 0;
+        for (int frame = 0; frame < stack->depth; ++frame)
+        {
+            if (length > 0)
+                text[length++] = ';';
+            length += PrintFrame(text + length, profile, lineOf, GetFrameOffset(profile, stack, frame), perLine);
+        }
+        text[length] = 0;
+        folded[i] = (SFoldedStack){ text, stack->count };
+    }
+
+    // Stacks whose frames are on the same lines, or in the same functions, are one line
+    qsort(folded, profile->stackCount, sizeof(SFoldedStack), CompareFoldedStacks);
+    for (int i = 0; i < profile->stackCount;)
+    {
+        int first = i;
+        uint64_t count = 0;
+        for (; i < profile->stackCount && strcmp(folded[i].text, folded[first].text) == 0; ++i)
+            count += folded[i].count;
+        fprintf(out, "%s %" PRIu64 "\n", folded[first].text, count);
+    }
+
+    for (int i = 0; i < profile->stackCount; ++i)
+        free(folded[i].text);
+    free(folded);
+    free(lineOf);
+}
@@ -0,0 +1,239 @@
+#include "scheduler.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//------------------------------------------------------------------------------
+void InitScheduler(SScheduler* scheduler, const SProgram* program, int quantum)
+{
+    memset(scheduler, 0, sizeof(SScheduler));
+    scheduler->program = program;
+    scheduler->quantum = quantum;
+    InitCompletionQueue(&scheduler->completions);
+}
+
+//------------------------------------------------------------------------------
+void DeleteScheduler(SScheduler* scheduler)
+{
+    for (int i = 0; i < scheduler->instanceCount; ++i)
+        DeleteScriptContext(&scheduler->instances[i].context);
+    free(scheduler->instances);
+    free(scheduler->running);
+    free(scheduler->free);
+    free(scheduler->waiting);
+    DeleteCompletionQueue(&scheduler->completions);
+    memset(scheduler, 0, sizeof(SScheduler));
+}
+
+//------------------------------------------------------------------------------
+// A freed instance when there is one, its context is set up for the program already
+static int NewInstance(SScheduler* scheduler)
+{
+    if (scheduler->freeCount > 0)
+        return scheduler->free[--scheduler->freeCount];
+
+    if (scheduler->instanceCount == scheduler->instanceCapacity)
+    {
+        int capacity = scheduler->instanceCapacity ? 2 * scheduler->instanceCapacity : 16;
+        scheduler->instances = realloc(scheduler->instances, capacity * sizeof(SScriptInstance));
+        scheduler->running = realloc(scheduler->running, capacity * sizeof(int));
+        scheduler->free = realloc(scheduler->free, capacity * sizeof(int));
+        scheduler->instanceCapacity = capacity;
+    }
+
+    int instance = scheduler->instanceCount++;
+    InitScriptContext(&scheduler->instances[instance].context, scheduler->program);
+    return instance;
+}
+
+//------------------------------------------------------------------------------
+// Tokens are often consecutive, the multiplication spreads them over the table
+static int HomeSlot(const SScheduler* scheduler, int token)
+{
+    return (int)((unsigned)token * 2654435761u & (unsigned)(scheduler->waitingCapacity - 1));
+}
+
+//------------------------------------------------------------------------------
+// The slot of the token or the empty one where it would go
+static int FindWaiting(const SScheduler* scheduler, int token)
+{
+    int mask = scheduler->waitingCapacity - 1;
+    int slot = HomeSlot(scheduler, token);
+    while (scheduler->waiting[slot].token != HS_NO_ASYNC_CALL && scheduler->waiting[slot].token != token)
+        slot = (slot + 1) & mask;
+    return slot;
+}
+
+//------------------------------------------------------------------------------
+static void AddWaiting(SScheduler* scheduler, int token, int instance)
+{
+    if (2 * (scheduler->waitingCount + 1) > scheduler->waitingCapacity)
+    {
+        SWaitingInstance* old = scheduler->waiting;
+        int oldCapacity = scheduler->waitingCapacity;
+        scheduler->waitingCapacity = oldCapacity ? 2 * oldCapacity : 64;
+        scheduler->waiting = malloc(scheduler->waitingCapacity * sizeof(SWaitingInstance));
+        for (int i = 0; i < scheduler->waitingCapacity; ++i)
+            scheduler->waiting[i].token = HS_NO_ASYNC_CALL;
+        for (int i = 0; i < oldCapacity; ++i)
+        {
+            if (old[i].token != HS_NO_ASYNC_CALL)
+                scheduler->waiting[FindWaiting(scheduler, old[i].token)] = old[i];
+        }
+        free(old);
+    }
+
+    scheduler->waiting[FindWaiting(scheduler, token)] = (SWaitingInstance){ token, instance };
+    ++scheduler->waitingCount;
+}
+
+//------------------------------------------------------------------------------
+// The instance waiting for the token, -1 when there is none. The entries after it move back
+// into the gap, so the ones probed past it are still found.
+static int RemoveWaiting(SScheduler* scheduler, int token)
+{
+    if (scheduler->waitingCount == 0)
+        return -1;
+
+    int mask = scheduler->waitingCapacity - 1;
+    int slot = FindWaiting(scheduler, token);
+    if (scheduler->waiting[slot].token == HS_NO_ASYNC_CALL)
+        return -1;
+
+    int instance = scheduler->waiting[slot].instance;
+    for (int next = (slot + 1) & mask; scheduler->waiting[next].token != HS_NO_ASYNC_CALL; next = (next + 1) & mask)
+    {
+        // an entry stays when its home slot is cyclically after the gap
+        int home = HomeSlot(scheduler, scheduler->waiting[next].token);
+        if (((next - home) & mask) >= ((next - slot) & mask))
+        {
+            scheduler->waiting[slot] = scheduler->waiting[next];
+            slot = next;
+        }
+    }
+
+    scheduler->waiting[slot].token = HS_NO_ASYNC_CALL;
+    --scheduler->waitingCount;
+    return instance;
+}
+
+//------------------------------------------------------------------------------
+int SpawnInstance(SScheduler* scheduler, int function, const SScriptValue* arguments, int argumentCount)
+{
+    int instance = NewInstance(scheduler);
+    SScriptInstance* s = &scheduler->instances[instance];
+    if (StartFunction(&s->context, function, arguments, argumentCount) != R_OK)
+    {
+        s->isFree = HS_TRUE;
+        scheduler->free[scheduler->freeCount++] = instance;
+        return -1;
+    }
+
+    s->quantum = scheduler->quantum;
+    s->state = SCRIPT_RUNNING;
+    s->result.i = 0;
+    s->isFree = HS_FALSE;
+    scheduler->running[scheduler->runningCount++] = instance;
+    return instance;
+}
+
+//------------------------------------------------------------------------------
+static Bool8 IsValid(const SScheduler* scheduler, int instance)
+{
+    if (instance < 0 || instance >= scheduler->instanceCount || scheduler->instances[instance].isFree)
+    {
+        printf("ERROR: Invalid instance handle %d\n", instance);
+        return HS_FALSE;
+    }
+    return HS_TRUE;
+}
+
+//------------------------------------------------------------------------------
+void SetInstanceQuantum(SScheduler* scheduler, int instance, int quantum)
+{
+    if (IsValid(scheduler, instance))
+        scheduler->instances[instance].quantum = quantum;
+}
+
+//------------------------------------------------------------------------------
+const SScriptInstance* GetInstance(const SScheduler* scheduler, int instance)
+{
+    return IsValid(scheduler, instance) ? &scheduler->instances[instance] : NULL;
+}
+
+//------------------------------------------------------------------------------
+void FreeInstance(SScheduler* scheduler, int instance)
+{
+    if (!IsValid(scheduler, instance))
+        return;
+
+    SScriptInstance* s = &scheduler->instances[instance];
+    if (s->state == SCRIPT_WAITING)
+        RemoveWaiting(scheduler, s->context.vmData.asyncCall);
+    else if (s->state == SCRIPT_RUNNING)
+    {
+        // the others keep their order
+        int i = 0;
+        while (scheduler->running[i] != instance)
+            ++i;
+        memmove(&scheduler->running[i], &scheduler->running[i + 1], (scheduler->runningCount - i - 1) * sizeof(int));
+        --scheduler->runningCount;
+    }
+
+    s->context.function = -1;
+    s->isFree = HS_TRUE;
+    scheduler->free[scheduler->freeCount++] = instance;
+}
+
+//------------------------------------------------------------------------------
+// CompletionHandler of the completions of a tick
+static void WakeInstance(void* data, int token, SScriptValue result)
+{
+    SScheduler* scheduler = data;
+    int instance = RemoveWaiting(scheduler, token);
+    if (instance < 0)
+        return;
+
+    SScriptInstance* s = &scheduler->instances[instance];
+    CompleteAsyncCall(&s->context.vmData, result);
+    s->state = SCRIPT_RUNNING;
+    scheduler->running[scheduler->runningCount++] = instance;
+}
+
+//------------------------------------------------------------------------------
+int RunSchedulerTick(SScheduler* scheduler)
+{
+    TakeCompletions(&scheduler->completions, WakeInstance, scheduler);
+
+    // the finished and waiting instances drop out of the list as it is walked
+    int runningCount = 0;
+    for (int i = 0; i < scheduler->runningCount; ++i)
+    {
+        int instance = scheduler->running[i];
+        SScriptInstance* s = &scheduler->instances[instance];
+        s->state = ResumeFunction(&s->context, s->quantum, &s->result);
+        if (s->state == SCRIPT_RUNNING)
+        {
+            scheduler->running[runningCount++] = instance;
+        }
+        else if (s->state == SCRIPT_WAITING)
+        {
+            int token = s->context.vmData.asyncCall;
+            if (token >= 0 && (scheduler->waitingCount == 0
+                || scheduler->waiting[FindWaiting(scheduler, token)].token != token))
+            {
+                AddWaiting(scheduler, token, instance);
+            }
+            else
+            {
+                printf("ERROR: Invalid or already waiting token %d\n", token);
+                s->context.function = -1;
+                s->state = SCRIPT_FAILED;
+            }
+        }
+    }
+
+    scheduler->runningCount = runningCount;
+    return runningCount + scheduler->waitingCount;
+}
@@ -0,0 +1,506 @@
+#include "stack_usage.h"
+#include "bytecode_c.h"
+#include "bytecode_info.h"
+
+//------------------------------------------------------------------------------
+// Data stack use before an instruction, relative to the entry of its function
+typedef struct
+{
+    int function; // Index into SStackUsage::functions, -1 until the instruction is reached
+    int operands;
+    int vars;
+    Bool8 hasFrame; // Inside an INS_ENTER frame
+    int frame;      // Operand bytes at the frame pointer, negative when it points at arguments
+} SDepth;
+
+//------------------------------------------------------------------------------
+typedef struct
+{
+    int address;
+    int caller;
+    int callee;
+    int operands; // Operand bytes of the caller at the call, relative to its entry
+    int depth; // Bytes the caller uses at the call, the return address included
+    Bool8 isTail; // INS_TAIL_CALL, the callee replaces the frame of the caller
+} SCallSite;
+
+//------------------------------------------------------------------------------
+typedef struct
+{
+    byte* code;
+    int size;
+
+    Bool8* isBoundary;
+    SDepth* depths;     // Indexed by address
+    int* exitOperands;  // Indexed by function, operand bytes left at INS_RETURN
+    Bool8* isReturning; // Indexed by function, whether INS_RETURN has been reached
+
+    SCallSite* calls;
+    int callCount;
+
+    int* worklist;
+    int worklistCount;
+    Bool8* queued;
+
+    SStackUsage* usage;
+} SAnalysis;
+
+//------------------------------------------------------------------------------
+static Bool8 Fail(SAnalysis* a, int offset, const char* error)
+{
+    a->usage->errorOffset = offset;
+    a->usage->error = error;
+    return HS_FALSE;
+}
+
+//------------------------------------------------------------------------------
+static void Enqueue(SAnalysis* a, int address)
+{
+    if (!a->queued[address])
+    {
+        a->queued[address] = HS_TRUE;
+        a->worklist[a->worklistCount++] = address;
+    }
+}
+
+//------------------------------------------------------------------------------
+// Records the depth at the target of a control flow edge
+static Bool8 Flow(SAnalysis* a, int offset, int target, SDepth depth)
+{
+    if (target >= a->size)
+        return Fail(a, offset, "Execution runs past the end of the code without INS_END");
+    if (!a->isBoundary[target])
+        return Fail(a, offset, "Jump into the middle of an instruction");
+
+    SDepth* known = &a->depths[target];
+    if (known->function == -1)
+    {
+        *known = depth;
+
+        SFunctionUsage* f = &a->usage->functions[depth.function];
+        if (depth.operands > f->maxOperandSize)
+            f->maxOperandSize = depth.operands;
+        if (depth.vars > f->maxFrameSize)
+            f->maxFrameSize = depth.vars;
+        if (depth.operands + depth.vars > f->maxLocalSize)
+            f->maxLocalSize = depth.operands + depth.vars;
+
+        Enqueue(a, target);
+        return HS_TRUE;
+    }
+
+    if (known->function != depth.function)
+        return Fail(a, offset, "Code is shared between functions");
+    if (known->operands != depth.operands || known->vars != depth.vars
+        || known->hasFrame != depth.hasFrame || (depth.hasFrame && known->frame != depth.frame))
+        return Fail(a, offset, "Different stack sizes where control flow joins");
+    return HS_TRUE;
+}
+
+//------------------------------------------------------------------------------
+static int FindOrAddFunction(SAnalysis* a, int entry)
+{
+    SStackUsage* usage = a->usage;
+    for (int i = 0; i < usage->functionCount; ++i)
+    {
+        if (usage->functions[i].entry == entry)
+            return i;
+    }
+
+    SFunctionUsage* f = &usage->functions[usage->functionCount];
+    memset(f, 0, sizeof(SFunctionUsage));
+    f->entry = entry;
+    a->isReturning[usage->functionCount] = HS_FALSE;
+    return usage->functionCount++;
+}
+
+//------------------------------------------------------------------------------
+// Flows into the function called at the offset and records the call, returns the callee
+// or -1 when the flow fails
+static int EnterCallee(SAnalysis* a, int offset, SDepth depth, int returnAddressSize)
+{
+    int entry = LoadAddress(a->code + offset + 1);
+    int callee = FindOrAddFunction(a, entry);
+
+    SDepth entryDepth = { callee, 0, 0, HS_FALSE, 0 };
+    if (!Flow(a, offset, entry, entryDepth))
+        return -1;
+
+    Bool8 isRecorded = HS_FALSE;
+    for (int i = 0; i < a->callCount; ++i)
+        isRecorded |= a->calls[i].address == offset;
+
+    if (!isRecorded)
+    {
+        SCallSite* call = &a->calls[a->callCount++];
+        call->address = offset;
+        call->caller = depth.function;
+        call->callee = callee;
+        call->operands = depth.operands;
+        call->depth = depth.operands + depth.vars + returnAddressSize;
+        call->isTail = returnAddressSize == 0;
+    }
+    return callee;
+}
+
+//------------------------------------------------------------------------------
+static Bool8 Call(SAnalysis* a, int offset, SDepth depth, int next)
+{
+    int callee = EnterCallee(a, offset, depth, HS_DATA_SIZE_ADDRESS);
+    if (callee < 0)
+        return HS_FALSE;
+
+    // Continued once the callee is known to return
+    if (!a->isReturning[callee])
+        return HS_TRUE;
+
+    depth.operands += a->exitOperands[callee];
+    return Flow(a, offset, next, depth);
+}
+
+//------------------------------------------------------------------------------
+static Bool8 Return(SAnalysis* a, int offset, SDepth depth)
+{
+    if (depth.function == 0)
+        return Fail(a, offset, "INS_RETURN outside of a function");
+    if (depth.hasFrame)
+        return Fail(a, offset, "INS_RETURN inside of a frame, it has to INS_LEAVE");
+    if (depth.vars != 0)
+        return Fail(a, offset, "Variables are still allocated at INS_RETURN");
+
+    int* exit = &a->exitOperands[depth.function];
+    if (!a->isReturning[depth.function])
+    {
+        a->isReturning[depth.function] = HS_TRUE;
+        *exit = depth.operands;
+        for (int i = 0; i < a->callCount; ++i)
+        {
+            if (a->calls[i].callee == depth.function)
+                Enqueue(a, a->calls[i].address);
+        }
+    }
+    else if (*exit != depth.operands)
+    {
+        return Fail(a, offset, "Function returns different operand sizes");
+    }
+    return HS_TRUE;
+}
+
+//------------------------------------------------------------------------------
+// The arguments stay on the operand stack and become the first locals of the frame
+static Bool8 Enter(SAnalysis* a, int offset, SDepth depth, int next)
+{
+    const byte* ins = a->code + offset;
+    if (depth.hasFrame)
+        return Fail(a, offset, "INS_ENTER inside of a frame");
+
+    depth.hasFrame = HS_TRUE;
+    depth.frame = depth.operands - ins[1];
+    if (depth.frame < 0 && depth.function == 0)
+        return Fail(a, offset, "Stack underflow");
+
+    SFunctionUsage* f = &a->usage->functions[depth.function];
+    if (-depth.frame > f->argumentSize)
+        f->argumentSize = -depth.frame;
+
+    depth.operands += ins[2] * HS_DATA_SIZE_INT + ins[3] * HS_DATA_SIZE_FLOAT;
+    depth.vars += HS_DATA_SIZE_ADDRESS; // the caller's frame pointer
+    return Flow(a, offset, next, depth);
+}
+
+//------------------------------------------------------------------------------
+// Drops the frame, the value on top takes the place of the arguments, then returns
+static Bool8 Leave(SAnalysis* a, int offset, SDepth depth, int valueSize)
+{
+    if (!depth.hasFrame)
+        return Fail(a, offset, "INS_LEAVE without INS_ENTER");
+    if (depth.operands - valueSize < depth.frame)
+        return Fail(a, offset, "Stack underflow");
+
+    depth.operands = depth.frame + valueSize;
+    depth.vars -= HS_DATA_SIZE_ADDRESS;
+    depth.hasFrame = HS_FALSE;
+    return Return(a, offset, depth);
+}
+
+//------------------------------------------------------------------------------
+// The arguments on top replace the frame and the callee returns in place of the function
+static Bool8 TailCall(SAnalysis* a, int offset, SDepth depth)
+{
+    int argumentSize = a->code[offset + 1 + sizeof(hsbaddress)];
+    if (!depth.hasFrame)
+        return Fail(a, offset, "INS_TAIL_CALL outside of a frame");
+    if (depth.operands - argumentSize < depth.frame)
+        return Fail(a, offset, "Stack underflow");
+
+    depth.operands = depth.frame + argumentSize;
+    depth.vars -= HS_DATA_SIZE_ADDRESS;
+    depth.hasFrame = HS_FALSE;
+    if (depth.vars != 0)
+        return Fail(a, offset, "Variables are still allocated at INS_TAIL_CALL");
+
+    int callee = EnterCallee(a, offset, depth, 0);
+    if (callee < 0)
+        return HS_FALSE;
+
+    // Continued once the callee is known to return
+    if (!a->isReturning[callee])
+        return HS_TRUE;
+
+    depth.operands += a->exitOperands[callee];
+    return Return(a, offset, depth);
+}
+
+//------------------------------------------------------------------------------
+static Bool8 Step(SAnalysis* a, int offset)
+{
+    SDepth depth = a->depths[offset];
+    EInstruction instruction = a->code[offset];
+    int next = offset + GetInstructionSize(instruction);
+
+    switch (instruction)
+    {
+        case INS_END: return HS_TRUE;
+        case INS_CALL: return Call(a, offset, depth, next);
+        case INS_RETURN: return Return(a, offset, depth);
+        case INS_JUMP: return Flow(a, offset, LoadAddress(a->code + offset + 1), depth);
+        case INS_ENTER: return Enter(a, offset, depth, next);
+        case INS_LEAVE: return Leave(a, offset, depth, 0);
+        case INS_LEAVE_I: return Leave(a, offset, depth, HS_DATA_SIZE_INT);
+        case INS_LEAVE_F: return Leave(a, offset, depth, HS_DATA_SIZE_FLOAT);
+        case INS_TAIL_CALL: return TailCall(a, offset, depth);
+        default: break;
+    }
+
+    int popSize, pushSize, varDelta;
+    GetStackEffect(instruction, &popSize, &pushSize, &varDelta);
+    if (instruction == INS_CALL_EXT || instruction == INS_CALL_ASYNC)
+        GetCallExtEffect(a->code + offset, &popSize, &pushSize);
+
+    // Functions can pop arguments, their callers are checked in PropagateArguments
+    depth.operands -= popSize;
+    if (depth.operands < 0 && depth.function == 0)
+        return Fail(a, offset, "Stack underflow");
+
+    SFunctionUsage* f = &a->usage->functions[depth.function];
+    if (-depth.operands > f->argumentSize)
+        f->argumentSize = -depth.operands;
+
+    depth.operands += pushSize;
+    depth.vars += varDelta;
+    if (depth.vars < 0)
+        return Fail(a, offset, "Deallocating more variables than the function allocated");
+
+    if (HasAddressOperand(instruction) && !Flow(a, offset, LoadAddress(a->code + offset + 1), depth))
+        return HS_FALSE;
+
+    // The first jump of the table is next
+    for (int i = 1; instruction == INS_SWITCH && i <= a->code[offset + 1 + sizeof(hsbint)]; ++i)
+    {
+        if (!Flow(a, offset, next + i * GetInstructionSize(INS_JUMP), depth))
+            return HS_FALSE;
+    }
+    return Flow(a, offset, next, depth);
+}
+
+//------------------------------------------------------------------------------
+// A callee can pop more operands than its caller pushed before the call, the rest
+// has to come from the caller's caller. The main program has nothing to pop.
+static Bool8 PropagateArguments(SAnalysis* a)
+{
+    SFunctionUsage* functions = a->usage->functions;
+    int lastChange = -1;
+
+    // Each round settles at least one more function unless the consumption grows in a cycle
+    for (int round = 0; round <= a->usage->functionCount; ++round)
+    {
+        lastChange = -1;
+        for (int i = 0; i < a->callCount; ++i)
+        {
+            SCallSite* call = &a->calls[i];
+            int consumed = functions[call->callee].argumentSize - call->operands;
+            if (consumed > functions[call->caller].argumentSize)
+            {
+                if (call->caller == 0)
+                    return Fail(a, call->address, "Stack underflow");
+
+                functions[call->caller].argumentSize = consumed;
+                lastChange = call->address;
+            }
+        }
+
+        if (lastChange == -1)
+            return HS_TRUE;
+    }
+
+    return Fail(a, lastChange, "Recursion pops an unbounded number of operands");
+}
+
+//------------------------------------------------------------------------------
+// Deepest use of the function including its calls, -1 when it can recurse
+static int TotalSize(SAnalysis* a, int function, byte* visited)
+{
+    SFunctionUsage* f = &a->usage->functions[function];
+    if (visited[function] == 2)
+        return f->maxTotalSize;
+    if (visited[function] == 1)
+    {
+        a->usage->isRecursive = HS_TRUE;
+        return -1;
+    }
+
+    visited[function] = 1;
+    int total = f->maxLocalSize;
+    for (int i = 0; i < a->callCount; ++i)
+    {
+        if (a->calls[i].caller != function)
+            continue;
+
+        // A function tail calling itself no higher than it was called runs in its own space
+        if (a->calls[i].isTail && a->calls[i].callee == function && a->calls[i].depth <= 0)
+            continue;
+
+        int calleeSize = TotalSize(a, a->calls[i].callee, visited);
+        if (calleeSize < 0 || total < 0)
+            total = -1;
+        else if (a->calls[i].depth + calleeSize > total)
+            total = a->calls[i].depth + calleeSize;
+    }
+    visited[function] = 2;
+
+    f->maxTotalSize = total;
+    return total;
+}
+
+//------------------------------------------------------------------------------
+EResult AnalyzeStackUsage(SStackData instructions, SStackUsage* outUsage)
+{
+    return AnalyzeStackUsageWithEntries(instructions, NULL, 0, outUsage);
+}
+
+//------------------------------------------------------------------------------
+EResult AnalyzeStackUsageWithEntries(SStackData instructions, const int* entries, int entryCount, SStackUsage* outUsage)
+{
+    SAnalysis a =
+    {
+        .code = instructions.begin,
+        .size = instructions.end - instructions.begin,
+        .usage = outUsage,
+    };
+
+    outUsage->errorOffset = -1;
+    outUsage->error = NULL;
+    outUsage->functions = malloc((a.size + 1) * sizeof(SFunctionUsage));
+    outUsage->functionCount = 0;
+    outUsage->isRecursive = HS_FALSE;
+    outUsage->requiredDataSize = -1;
+    outUsage->callReserve = 0;
+
+    a.isBoundary = calloc(a.size + 1, sizeof(Bool8));
+    a.depths = malloc((a.size + 1) * sizeof(SDepth));
+    a.exitOperands = malloc((a.size + 1) * sizeof(int));
+    a.isReturning = malloc((a.size + 1) * sizeof(Bool8));
+    a.calls = malloc((a.size + 1) * sizeof(SCallSite));
+    a.callCount = 0;
+    a.worklist = malloc((a.size + 1) * sizeof(int));
+    a.worklistCount = 0;
+    a.queued = calloc(a.size + 1, sizeof(Bool8));
+    byte* visited = NULL;
+
+    Bool8 isValid = HS_TRUE;
+    for (int position = 0; position < a.size;)
+    {
+        EInstruction instruction = a.code[position];
+        int size = GetInstructionSize(instruction);
+        if (size == 0 || position + size > a.size)
+        {
+            isValid = Fail(&a, position, "Invalid instruction");
+            break;
+        }
+
+        a.isBoundary[position] = HS_TRUE;
+        a.depths[position].function = -1;
+        position += size;
+    }
+
+    // The main program
+    FindOrAddFunction(&a, 0);
+    SDepth start = { 0, 0, 0, HS_FALSE, 0 };
+    if (isValid)
+        isValid = Flow(&a, 0, 0, start);
+
+    // Entered as if they were called
+    for (int i = 0; isValid && i < entryCount; ++i)
+    {
+        if (entries[i] < 0 || entries[i] >= a.size || !a.isBoundary[entries[i]])
+        {
+            isValid = Fail(&a, entries[i], "Entry is not an instruction");
+            break;
+        }
+
+        SDepth entryDepth = { FindOrAddFunction(&a, entries[i]), 0, 0, HS_FALSE, 0 };
+        isValid = Flow(&a, entries[i], entries[i], entryDepth);
+    }
+
+    while (isValid && a.worklistCount > 0)
+    {
+        int offset = a.worklist[--a.worklistCount];
+        a.queued[offset] = HS_FALSE;
+        isValid = Step(&a, offset);
+    }
+
+    if (isValid)
+        isValid = PropagateArguments(&a);
+
+    if (isValid)
+    {
+        visited = calloc(outUsage->functionCount, 1);
+        for (int i = 0; i < outUsage->functionCount; ++i)
+            TotalSize(&a, i, visited);
+
+        outUsage->requiredDataSize = outUsage->functions[0].maxTotalSize;
+
+        if (outUsage->isRecursive)
+        {
+            for (int i = 0; i < a.callCount; ++i)
+            {
+                int reserve = HS_DATA_SIZE_ADDRESS + outUsage->functions[a.calls[i].callee].maxLocalSize;
+                if (reserve > outUsage->callReserve)
+                    outUsage->callReserve = reserve;
+            }
+        }
+    }
+
+    free(visited);
+    free(a.queued);
+    free(a.worklist);
+    free(a.calls);
+    free(a.isReturning);
+    free(a.exitOperands);
+    free(a.depths);
+    free(a.isBoundary);
+    return isValid ? R_OK : R_ERROR;
+}
+
+//------------------------------------------------------------------------------
+void FreeStackUsage(SStackUsage* usage)
+{
+    free(usage->functions);
+    usage->functions = NULL;
+    usage->functionCount = 0;
+}
+
+//------------------------------------------------------------------------------
+void InitVMForProgram(SVMData* vmData, SStackData instructions, const SStackUsage* usage, int recursiveDataSize, FuncArray functions)
+{
+    int dataSize = usage->requiredDataSize;
+    if (usage->isRecursive)
+    {
+        dataSize = recursiveDataSize;
+        if (dataSize < usage->functions[0].maxLocalSize)
+            dataSize = usage->functions[0].maxLocalSize;
+    }
+
+    InitVM(vmData, instructions, dataSize, functions);
+    vmData->callReserve = usage->isRecursive ? usage->callReserve : 0;
+}
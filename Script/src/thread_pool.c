@@ -0,0 +1,206 @@
+#include "thread_pool.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+//------------------------------------------------------------------------------
+// The threads wait on start for the next generation of work, the caller waits on done until
+// none of them is busy
+struct SThreadPool
+{
+    int threadCount;
+#if defined(_WIN32)
+    HANDLE* threads;
+    SRWLOCK lock;
+    CONDITION_VARIABLE start;
+    CONDITION_VARIABLE done;
+#else
+    pthread_t* threads;
+    pthread_mutex_t lock;
+    pthread_cond_t start;
+    pthread_cond_t done;
+#endif
+    int generation;
+    int quit;
+    int busy;
+
+    ThreadWork* work;
+    void* data;
+};
+
+//------------------------------------------------------------------------------
+typedef struct
+{
+    SThreadPool* pool;
+    int index;
+} SPoolThread;
+
+#if defined(_WIN32)
+
+static void Lock(SThreadPool* pool) { AcquireSRWLockExclusive(&pool->lock); }
+static void Unlock(SThreadPool* pool) { ReleaseSRWLockExclusive(&pool->lock); }
+static void Wait(SThreadPool* pool, CONDITION_VARIABLE* condition) { SleepConditionVariableSRW(condition, &pool->lock, INFINITE, 0); }
+static void WakeAll(CONDITION_VARIABLE* condition) { WakeAllConditionVariable(condition); }
+
+#else
+
+static void Lock(SThreadPool* pool) { pthread_mutex_lock(&pool->lock); }
+static void Unlock(SThreadPool* pool) { pthread_mutex_unlock(&pool->lock); }
+static void Wait(SThreadPool* pool, pthread_cond_t* condition) { pthread_cond_wait(condition, &pool->lock); }
+static void WakeAll(pthread_cond_t* condition) { pthread_cond_broadcast(condition); }
+
+#endif
+
+//------------------------------------------------------------------------------
+#if defined(_WIN32)
+static DWORD WINAPI PoolThread(void* parameter)
+#else
+static void* PoolThread(void* parameter)
+#endif
+{
+    SPoolThread* thread = parameter;
+    SThreadPool* pool = thread->pool;
+    int index = thread->index;
+    free(thread);
+
+    int generation = 0;
+    for (;;)
+    {
+        Lock(pool);
+        while (pool->generation == generation && !pool->quit)
+            Wait(pool, &pool->start);
+        generation = pool->generation;
+        int quit = pool->quit;
+        ThreadWork* work = pool->work;
+        void* data = pool->data;
+        Unlock(pool);
+
+        if (quit)
+            break;
+
+        work(data, index);
+
+        Lock(pool);
+        if (--pool->busy == 0)
+            WakeAll(&pool->done);
+        Unlock(pool);
+    }
+    return 0;
+}
+
+//------------------------------------------------------------------------------
+SThreadPool* CreateThreadPool(int threadCount)
+{
+    if (threadCount < 1)
+        threadCount = 1;
+
+    SThreadPool* pool = calloc(1, sizeof(SThreadPool));
+    pool->threadCount = threadCount;
+
+#if defined(_WIN32)
+    pool->threads = malloc(threadCount * sizeof(HANDLE));
+    InitializeSRWLock(&pool->lock);
+    InitializeConditionVariable(&pool->start);
+    InitializeConditionVariable(&pool->done);
+#else
+    pool->threads = malloc(threadCount * sizeof(pthread_t));
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->start, NULL);
+    pthread_cond_init(&pool->done, NULL);
+#endif
+
+    for (int i = 0; i < threadCount - 1; ++i)
+    {
+        SPoolThread* thread = malloc(sizeof(SPoolThread));
+        thread->pool = pool;
+        thread->index = i;
+#if defined(_WIN32)
+        pool->threads[i] = CreateThread(NULL, 0, PoolThread, thread, 0, NULL);
+        int isStarted = pool->threads[i] != NULL;
+#else
+        int isStarted = pthread_create(&pool->threads[i], NULL, PoolThread, thread) == 0;
+#endif
+        if (!isStarted)
+        {
+            // only the threads before this one are joined
+            printf("ERROR: Could not start thread %d of %d\n", i + 1, threadCount - 1);
+            free(thread);
+            pool->threadCount = i + 1;
+            DeleteThreadPool(pool);
+            return NULL;
+        }
+    }
+    return pool;
+}
+
+//------------------------------------------------------------------------------
+void DeleteThreadPool(SThreadPool* pool)
+{
+    Lock(pool);
+    pool->quit = 1;
+    WakeAll(&pool->start);
+    Unlock(pool);
+
+    for (int i = 0; i < pool->threadCount - 1; ++i)
+    {
+#if defined(_WIN32)
+        WaitForSingleObject(pool->threads[i], INFINITE);
+        CloseHandle(pool->threads[i]);
+#else
+        pthread_join(pool->threads[i], NULL);
+#endif
+    }
+
+#if !defined(_WIN32)
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->start);
+    pthread_cond_destroy(&pool->done);
+#endif
+
+    free(pool->threads);
+    free(pool);
+}
+
+//------------------------------------------------------------------------------
+int GetThreadCount(const SThreadPool* pool)
+{
+    return pool->threadCount;
+}
+
+//------------------------------------------------------------------------------
+void RunOnThreads(SThreadPool* pool, ThreadWork* work, void* data)
+{
+    // the lock publishes what the caller wrote to the threads
+    Lock(pool);
+    pool->work = work;
+    pool->data = data;
+    pool->busy = pool->threadCount - 1;
+    ++pool->generation;
+    WakeAll(&pool->start);
+    Unlock(pool);
+
+    work(data, pool->threadCount - 1);
+
+    // and makes what they wrote visible here
+    Lock(pool);
+    while (pool->busy > 0)
+        Wait(pool, &pool->done);
+    Unlock(pool);
+}
+
+//------------------------------------------------------------------------------
+void YieldThread(void)
+{
+#if defined(_WIN32)
+    SwitchToThread();
+#else
+    sched_yield();
+#endif
+}
@@ -0,0 +1,170 @@
+#include "tiered.h"
+#include "bytecode_c.h"
+#include "bytecode_info.h"
+#include "optimizer.h"
+#include "verifier.h"
+
+#include <stdio.h>
+
+//------------------------------------------------------------------------------
+// The baseline tier, VMProcessInstructions with the hotness counters
+static Bool8 ProcessCounted(SVMData* vmData, int count, SHotness* hotness)
+{
+#define HS_VM_CHECKED 1
+#define HS_VM_COUNTED 1
+#include "bytecode_interpreter.inl"
+#undef HS_VM_COUNTED
+#undef HS_VM_CHECKED
+}
+
+//------------------------------------------------------------------------------
+void InitTieredVM(STieredVM* tiered, SStackData instructions, int dataSize, FuncArray functions, int threshold)
+{
+    int size = instructions.end - instructions.begin;
+
+    tiered->baseline = instructions;
+    tiered->optimized = (SStackData){ 0 };
+    tiered->tier = TIER_BASELINE;
+    tiered->hotness = (SHotness)
+    {
+        .counters = calloc(size, sizeof(int)),
+        .size = size,
+        .threshold = threshold,
+        .hotAddress = -1,
+    };
+    tiered->promotionAddress = -1;
+
+    InitVM(&tiered->vm, instructions, dataSize, functions);
+}
+
+//------------------------------------------------------------------------------
+void DeleteTieredVM(STieredVM* tiered, Bool8 keepFunctions)
+{
+    DeleteVM(&tiered->vm, HS_TRUE, keepFunctions);
+    DeleteStack(tiered->baseline);
+    if (tiered->optimized.begin)
+        DeleteStack(tiered->optimized);
+    free(tiered->hotness.counters);
+}
+
+//------------------------------------------------------------------------------
+// Moves the VM from the baseline instructions to optimized ones, the VM stands at the
+// hot address which is a jump target so it cannot be inside a fused sequence
+static EResult Promote(STieredVM* tiered)
+{
+    SVMData* vm = &tiered->vm;
+    int size = tiered->hotness.size;
+    int address = vm->instructionStack.stackPointer - vm->instructionStack.begin;
+
+    // The layout tells where the return addresses are in the variable area
+    SVerifyResult verifyResult;
+    SStackLayout** layouts;
+    int dataSize = vm->dataStack.base.end - vm->dataStack.base.begin;
+    if (VerifyInstructionsWithLayouts(tiered->baseline, dataSize, &verifyResult, &layouts) != R_OK)
+        return R_ERROR;
+
+    const SStackLayout* layout = layouts[address];
+    SStackData optimized = CreateStack(size);
+    memcpy(optimized.begin, tiered->baseline.begin, size);
+    optimized.end = optimized.begin + size;
+
+    int* newAddress = malloc((size + 1) * sizeof(int));
+    if (!layout || FuseSuperinstructionsMapped(&optimized, newAddress) != R_OK)
+    {
+        free(newAddress);
+        DeleteStack(optimized);
+        FreeStackLayouts(layouts, size);
+        return R_ERROR;
+    }
+
+    byte* var = vm->dataStack.reversePointer;
+    for (int i = layout->varCount - 1; i >= 0; --i)
+    {
+        if (layout->vars[i] == TAG_ADDRESS)
+        {
+            byte* pointer = var;
+            hsbaddress returnAddress = LoadAddressVar(&pointer);
+            StoreAddressVar(&pointer, newAddress[returnAddress]);
+        }
+        var += GetTagSize(layout->vars[i]);
+    }
+
+    // The swap, from the next instruction on the VM runs the optimized code
+    optimized.stackPointer = optimized.begin + newAddress[address];
+    vm->instructionStack = optimized;
+    tiered->optimized = optimized;
+    tiered->tier = TIER_OPTIMIZED;
+    tiered->promotionAddress = address;
+
+    free(newAddress);
+    FreeStackLayouts(layouts, size);
+    return R_OK;
+}
+
+//------------------------------------------------------------------------------
+Bool8 TieredProcessInstructions(STieredVM* tiered, int count)
+{
+    if (tiered->tier != TIER_BASELINE)
+        return VMProcessInstructions(&tiered->vm, count);
+
+    Bool8 running = ProcessCounted(&tiered->vm, count, &tiered->hotness);
+    if (tiered->hotness.hotAddress >= 0)
+    {
+        if (Promote(tiered) != R_OK)
+        {
+            // Keep counting for GetHotSpots without stopping again
+            printf("ERROR: Cannot optimize the program, it stays on the baseline tier\n");
+            tiered->hotness.threshold = 0;
+            tiered->hotness.hotAddress = -1;
+        }
+    }
+    return running;
+}
+
+//------------------------------------------------------------------------------
+static int CompareHotSpots(const void* a, const void* b)
+{
+    const SHotSpot* first = a;
+    const SHotSpot* second = b;
+    if (first->count != second->count)
+        return second->count > first->count ? 1 : -1;
+    return first->address - second->address;
+}
+
+//------------------------------------------------------------------------------
+int GetHotSpots(const STieredVM* tiered, SHotSpot* outSpots, int maxSpots)
+{
+    const SHotness* hotness = &tiered->hotness;
+    Bool8* isFunction = calloc(hotness->size, sizeof(Bool8));
+    for (byte* ins = tiered->baseline.begin; ins < tiered->baseline.end; ins += GetInstructionSize(*ins))
+    {
+        if (GetInstructionSize(*ins) == 0)
+            break;
+        if ((*ins == INS_CALL || *ins == INS_TAIL_CALL) && LoadAddress(ins + 1) < hotness->size)
+            isFunction[LoadAddress(ins + 1)] = HS_TRUE;
+    }
+
+    int count = 0;
+    for (int address = 0; address < hotness->size; ++address)
+    {
+        if (hotness->counters[address] > 0)
+            ++count;
+    }
+
+    SHotSpot* spots = malloc((count + 1) * sizeof(SHotSpot));
+    int spotCount = 0;
+    for (int address = 0; address < hotness->size; ++address)
+    {
+        if (hotness->counters[address] > 0)
+            spots[spotCount++] = (SHotSpot){ address, isFunction[address], hotness->counters[address] };
+    }
+    qsort(spots, spotCount, sizeof(SHotSpot), CompareHotSpots);
+
+    if (spotCount > maxSpots)
+        spotCount = maxSpots;
+    memcpy(outSpots, spots, spotCount * sizeof(SHotSpot));
+
+    free(spots);
+    free(isFunction);
+    return spotCount;
+}
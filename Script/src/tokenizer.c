@@ -49,8 +49,27 @@ static Bool8 IsIdentifierStart(char c)
 }
 
 //------------------------------------------------------------------------------
-static void AddToken(SToken token, SToken** tokens, int* tokenCount, int* tokenCapacity)
+static Bool8 IsKeyword(const char* start, int size, const char* keyword)
 {
+    // The whole identifier has to match, "i" is not "if"
+    return size == (int)strlen(keyword) && strncmp(start, keyword, size) == 0;
+}
+
+//------------------------------------------------------------------------------
+static SSourcePosition MakePosition(int line, int column)
+{
+    SSourcePosition position =
+    {
+        .line = line < UINT16_MAX ? line : UINT16_MAX,
+        .column = column < UINT16_MAX ? column : UINT16_MAX,
+    };
+    return position;
+}
+
+//------------------------------------------------------------------------------
+static void AddToken(SToken token, SSourcePosition position, SToken** tokens, int* tokenCount, int* tokenCapacity)
+{
+    token.position = position;
     if (*tokenCount == *tokenCapacity)
     {
         *tokenCapacity *= 2;
@@ -62,10 +81,10 @@ static void AddToken(SToken token, SToken** tokens, int* tokenCount, int* tokenC
 }
 
 //------------------------------------------------------------------------------
-static void AddSimpleToken(ETokenType type, SToken** tokens, int* tokenCount, int* tokenCapacity)
+static void AddSimpleToken(ETokenType type, SSourcePosition position, SToken** tokens, int* tokenCount, int* tokenCapacity)
 {
     SToken token = { .type = type };
-    AddToken(token, tokens, tokenCount, tokenCapacity);
+    AddToken(token, position, tokens, tokenCount, tokenCapacity);
 }
 
 //------------------------------------------------------------------------------
@@ -99,10 +118,13 @@ EResult Tokenize(char* code, int size, SToken** outTokens, int* outTokenCount)
     int tokenCount = 0;
 
     char* c = code;
+    char* lineStart = code;
+    int line = 1;
 
     // Note that if *c != 0 then *c must be valid (maybe 0 though)
     while (*c)
     {
+        SSourcePosition position = MakePosition(line, c - lineStart + 1);
         if (*c == '/' && *(c + 1) == '/') // Comment
         {
             c += 2;
@@ -113,6 +135,8 @@ EResult Tokenize(char* code, int size, SToken** outTokens, int* outTokenCount)
                 {
                     if (*(c + 1) == '\r')
                         ++c;
+                    ++line;
+                    lineStart = c + 1;
                     break;
                 }
                 ++c;
@@ -120,78 +144,93 @@ EResult Tokenize(char* code, int size, SToken** outTokens, int* outTokenCount)
         }
         else if (*c == ';')
         {
-            AddSimpleToken(TOKEN_SEMICOLON, &tokens, &tokenCount, &tokenCapacity);
+            AddSimpleToken(TOKEN_SEMICOLON, position, &tokens, &tokenCount, &tokenCapacity);
         }
         else if (*c == ':')
         {
-            AddSimpleToken(TOKEN_COLON, &tokens, &tokenCount, &tokenCapacity);
+            AddSimpleToken(TOKEN_COLON, position, &tokens, &tokenCount, &tokenCapacity);
+        }
+        else if (*c == ',')
+        {
+            AddSimpleToken(TOKEN_COMMA, position, &tokens, &tokenCount, &tokenCapacity);
         }
         else if (*c == '=' && *(c + 1) == '=')
         {
-            AddSimpleToken(TOKEN_EQUAL_EQUAL, &tokens, &tokenCount, &tokenCapacity);
+            AddSimpleToken(TOKEN_EQUAL_EQUAL, position, &tokens, &tokenCount, &tokenCapacity);
+            ++c; // Two characters
         }
         else if (*c == '!' && *(c + 1) == '=')
         {
-            AddSimpleToken(TOKEN_NOT_EQUAL, &tokens, &tokenCount, &tokenCapacity);
+            AddSimpleToken(TOKEN_NOT_EQUAL, position, &tokens, &tokenCount, &tokenCapacity);
+            ++c; // Two characters
         }
         else if (*c == '>' && *(c + 1) == '=')
         {
-            AddSimpleToken(TOKEN_GREATER_EQUAL, &tokens, &tokenCount, &tokenCapacity);
+            AddSimpleToken(TOKEN_GREATER_EQUAL, position, &tokens, &tokenCount, &tokenCapacity);
+            ++c; // Two characters
         }
         else if (*c == '<' && *(c + 1) == '=')
         {
-            AddSimpleToken(TOKEN_LESS_EQUAL, &tokens, &tokenCount, &tokenCapacity);
+            AddSimpleToken(TOKEN_LESS_EQUAL, position, &tokens, &tokenCount, &tokenCapacity);
+            ++c; // Two characters
         }
         else if (*c == '=')
         {
-            AddSimpleToken(TOKEN_EQUALS, &tokens, &tokenCount, &tokenCapacity);
+            AddSimpleToken(TOKEN_EQUALS, position, &tokens, &tokenCount, &tokenCapacity);
         }
         else if (*c == '>')
         {
-            AddSimpleToken(TOKEN_GREATER, &tokens, &tokenCount, &tokenCapacity);
+            AddSimpleToken(TOKEN_GREATER, position, &tokens, &tokenCount, &tokenCapacity);
         }
         else if (*c == '<')
         {
-            AddSimpleToken(TOKEN_LESS, &tokens, &tokenCount, &tokenCapacity);
+            AddSimpleToken(TOKEN_LESS, position, &tokens, &tokenCount, &tokenCapacity);
         }
         else if (*c == '(')
         {
-            AddSimpleToken(TOKEN_LEFT_BRACE, &tokens, &tokenCount, &tokenCapacity);
+            AddSimpleToken(TOKEN_LEFT_BRACE, position, &tokens, &tokenCount, &tokenCapacity);
         }
         else if (*c == ')')
         {
-            AddSimpleToken(TOKEN_RIGHT_BRACE, &tokens, &tokenCount, &tokenCapacity);
+            AddSimpleToken(TOKEN_RIGHT_BRACE, position, &tokens, &tokenCount, &tokenCapacity);
         }
         else if (*c == '{')
         {
-            AddSimpleToken(TOKEN_LEFT_CURLY, &tokens, &tokenCount, &tokenCapacity);
+            AddSimpleToken(TOKEN_LEFT_CURLY, position, &tokens, &tokenCount, &tokenCapacity);
         }
         else if (*c == '}')
         {
-            AddSimpleToken(TOKEN_RIGHT_CURLY, &tokens, &tokenCount, &tokenCapacity);
+            AddSimpleToken(TOKEN_RIGHT_CURLY, position, &tokens, &tokenCount, &tokenCapacity);
         }
         else if (*c == '+')
         {
-            AddSimpleToken(TOKEN_PLUS, &tokens, &tokenCount, &tokenCapacity);
+            AddSimpleToken(TOKEN_PLUS, position, &tokens, &tokenCount, &tokenCapacity);
         }
         else if (*c == '-')
         {
-            AddSimpleToken(TOKEN_MINUS, &tokens, &tokenCount, &tokenCapacity);
+            AddSimpleToken(TOKEN_MINUS, position, &tokens, &tokenCount, &tokenCapacity);
         }
         else if (*c == '/')
         {
-            AddSimpleToken(TOKEN_SLASH, &tokens, &tokenCount, &tokenCapacity);
+            AddSimpleToken(TOKEN_SLASH, position, &tokens, &tokenCount, &tokenCapacity);
         }
         else if (*c == '*')
         {
-            AddSimpleToken(TOKEN_STAR, &tokens, &tokenCount, &tokenCapacity);
+            AddSimpleToken(TOKEN_STAR, position, &tokens, &tokenCount, &tokenCapacity);
         }
         else if (*c == '"') // String
         {
             char* start = c + 1;
             ++c;
             while (*c && *c != '"')
+            {
+                if (*c == '\n')
+                {
+                    ++line;
+                    lineStart = c + 1;
+                }
                 ++c;
+            }
 
             if (!*c)
             {
@@ -208,7 +247,7 @@ EResult Tokenize(char* code, int size, SToken** outTokens, int* outTokenCount)
                 token.string[size] = 0;
             }
 
-            AddToken(token, &tokens, &tokenCount, &tokenCapacity);
+            AddToken(token, position, &tokens, &tokenCount, &tokenCapacity);
         }
         else if (IsNumber(*c))
         {
@@ -246,12 +285,16 @@ EResult Tokenize(char* code, int size, SToken** outTokens, int* outTokenCount)
 
             *c = previous;
 
-            AddToken(token, &tokens, &tokenCount, &tokenCapacity);
+            AddToken(token, position, &tokens, &tokenCount, &tokenCapacity);
             continue;
         }
         else if (IsWhitespace(*c)) // Whitespace
         {
-            // Continue
+            if (*c == '\n')
+            {
+                ++line;
+                lineStart = c + 1;
+            }
         }
         else // Identifier
         {
@@ -260,25 +303,54 @@ EResult Tokenize(char* code, int size, SToken** outTokens, int* outTokenCount)
                 ++c;
 
             int size = c - start;
-            if (strncmp(start, "if", size) == 0)
+            if (size == 0)
+            {
+                printf("ERROR: Unexpected character '%c'\n", *c);
+                goto error;
+            }
+            else if (IsKeyword(start, size, "if"))
+            {
+                AddSimpleToken(TOKEN_IF, position, &tokens, &tokenCount, &tokenCapacity);
+            }
+            else if (IsKeyword(start, size, "else"))
+            {
+                AddSimpleToken(TOKEN_ELSE, position, &tokens, &tokenCount, &tokenCapacity);
+            }
+            else if (IsKeyword(start, size, "while"))
+            {
+                AddSimpleToken(TOKEN_WHILE, position, &tokens, &tokenCount, &tokenCapacity);
+            }
+            else if (IsKeyword(start, size, "for"))
+            {
+                AddSimpleToken(TOKEN_FOR, position, &tokens, &tokenCount, &tokenCapacity);
+            }
+            else if (IsKeyword(start, size, "switch"))
+            {
+                AddSimpleToken(TOKEN_SWITCH, position, &tokens, &tokenCount, &tokenCapacity);
+            }
+            else if (IsKeyword(start, size, "case"))
+            {
+                AddSimpleToken(TOKEN_CASE, position, &tokens, &tokenCount, &tokenCapacity);
+            }
+            else if (IsKeyword(start, size, "default"))
             {
-                AddSimpleToken(TOKEN_IF, &tokens, &tokenCount, &tokenCapacity);
+                AddSimpleToken(TOKEN_DEFAULT, position, &tokens, &tokenCount, &tokenCapacity);
             }
-            else if (strncmp(start, "else", size) == 0)
+            else if (IsKeyword(start, size, "var"))
             {
-                AddSimpleToken(TOKEN_ELSE, &tokens, &tokenCount, &tokenCapacity);
+                AddSimpleToken(TOKEN_VAR, position, &tokens, &tokenCount, &tokenCapacity);
             }
-            else if (strncmp(start, "while", size) == 0)
+            else if (IsKeyword(start, size, "fun"))
             {
-                AddSimpleToken(TOKEN_WHILE, &tokens, &tokenCount, &tokenCapacity);
+                AddSimpleToken(TOKEN_FUN, position, &tokens, &tokenCount, &tokenCapacity);
             }
-            else if (strncmp(start, "for", size) == 0)
+            else if (IsKeyword(start, size, "return"))
             {
-                AddSimpleToken(TOKEN_FOR, &tokens, &tokenCount, &tokenCapacity);
+                AddSimpleToken(TOKEN_RETURN, position, &tokens, &tokenCount, &tokenCapacity);
             }
-            else if (strncmp(start, "var", size) == 0)
+            else if (IsKeyword(start, size, "yield"))
             {
-                AddSimpleToken(TOKEN_VAR, &tokens, &tokenCount, &tokenCapacity);
+                AddSimpleToken(TOKEN_YIELD, position, &tokens, &tokenCount, &tokenCapacity);
             }
             else
             {
@@ -287,7 +359,7 @@ EResult Tokenize(char* code, int size, SToken** outTokens, int* outTokenCount)
                 memcpy(token.name, start, size);
                 token.name[size] = 0;
 
-                AddToken(token, &tokens, &tokenCount, &tokenCapacity);
+                AddToken(token, position, &tokens, &tokenCount, &tokenCapacity);
             }
             continue;
         }
@@ -295,7 +367,7 @@ EResult Tokenize(char* code, int size, SToken** outTokens, int* outTokenCount)
         ++c;
     }
 
-    AddSimpleToken(TOKEN_END, &tokens, &tokenCount, &tokenCapacity);
+    AddSimpleToken(TOKEN_END, MakePosition(line, c - lineStart + 1), &tokens, &tokenCount, &tokenCapacity);
 
     *outTokens = tokens;
     *outTokenCount = tokenCount;
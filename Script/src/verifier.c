@@ -0,0 +1,651 @@
+#include "verifier.h"
+#include "bytecode_c.h"
+#include "bytecode_info.h"
+
+//------------------------------------------------------------------------------
+typedef struct
+{
+    byte* code;
+    int size;
+    int dataSize;
+
+    Bool8* isBoundary;
+    SStackLayout** states;     // Indexed by address, NULL until reached
+    SStackLayout** exitStates; // Indexed by function entry, the state after INS_RETURN
+
+    int* worklist;
+    int worklistCount;
+    Bool8* queued;
+
+    SVerifyResult* result;
+} SVerifier;
+
+//------------------------------------------------------------------------------
+static Bool8 Fail(SVerifier* v, int offset, const char* error)
+{
+    v->result->errorOffset = offset;
+    v->result->error = error;
+    return HS_FALSE;
+}
+
+//------------------------------------------------------------------------------
+int GetTagSize(byte tag)
+{
+    switch (tag)
+    {
+        case TAG_INT: return HS_DATA_SIZE_INT;
+        case TAG_FLOAT: return HS_DATA_SIZE_FLOAT;
+        case TAG_BOOL: return HS_DATA_SIZE_BOOL;
+        default: return HS_DATA_SIZE_ADDRESS;
+    }
+}
+
+//------------------------------------------------------------------------------
+static int UsedDataSize(const SStackLayout* s)
+{
+    int size = 0;
+    for (int i = 0; i < s->stackCount; ++i)
+        size += GetTagSize(s->stack[i]);
+    for (int i = 0; i < s->varCount; ++i)
+        size += GetTagSize(s->vars[i]);
+    return size;
+}
+
+//------------------------------------------------------------------------------
+static Bool8 IsSameState(const SStackLayout* a, const SStackLayout* b)
+{
+    return a->function == b->function
+        && a->frame == b->frame
+        && a->stackCount == b->stackCount
+        && a->varCount == b->varCount
+        && memcmp(a->stack, b->stack, a->stackCount) == 0
+        && memcmp(a->vars, b->vars, a->varCount) == 0;
+}
+
+//------------------------------------------------------------------------------
+static void Enqueue(SVerifier* v, int address)
+{
+    if (!v->queued[address])
+    {
+        v->queued[address] = HS_TRUE;
+        v->worklist[v->worklistCount++] = address;
+    }
+}
+
+//------------------------------------------------------------------------------
+static Bool8 CheckSize(SVerifier* v, int offset, const SStackLayout* s)
+{
+    int used = UsedDataSize(s);
+    if (used > v->dataSize)
+        return Fail(v, offset, "Data stack overflow");
+
+    if (used > v->result->maxDataSize)
+        v->result->maxDataSize = used;
+    return HS_TRUE;
+}
+
+//------------------------------------------------------------------------------
+static Bool8 Push(SVerifier* v, int offset, SStackLayout* s, ETypeTag tag)
+{
+    if (s->stackCount == HS_LAYOUT_MAX_VALUES)
+        return Fail(v, offset, "Too many values on the stack to verify");
+
+    s->stack[s->stackCount++] = tag;
+    return CheckSize(v, offset, s);
+}
+
+//------------------------------------------------------------------------------
+static Bool8 Pop(SVerifier* v, int offset, SStackLayout* s, ETypeTag tag)
+{
+    if (s->stackCount == 0)
+        return Fail(v, offset, "Stack underflow");
+    if (s->stack[s->stackCount - 1] != tag)
+        return Fail(v, offset, "Operand has a different type than the instruction expects");
+
+    --s->stackCount;
+    return HS_TRUE;
+}
+
+//------------------------------------------------------------------------------
+static Bool8 PushVar(SVerifier* v, int offset, SStackLayout* s, ETypeTag tag)
+{
+    if (s->varCount == HS_LAYOUT_MAX_VALUES)
+        return Fail(v, offset, "Too many variables to verify");
+
+    s->vars[s->varCount++] = tag;
+    return CheckSize(v, offset, s);
+}
+
+//------------------------------------------------------------------------------
+static Bool8 PopVar(SVerifier* v, int offset, SStackLayout* s, ETypeTag tag)
+{
+    if (s->varCount == 0)
+        return Fail(v, offset, "Variable area underflow");
+    if (s->vars[s->varCount - 1] != tag)
+        return Fail(v, offset, "Deallocated variable has a different type");
+
+    --s->varCount;
+    return HS_TRUE;
+}
+
+//------------------------------------------------------------------------------
+// The variable at the byte offset from the top of the variable area has to have the type
+static Bool8 CheckVar(SVerifier* v, int offset, SStackLayout* s, int varOffset, ETypeTag tag)
+{
+    int position = 0;
+    for (int i = s->varCount - 1; i >= 0; --i)
+    {
+        if (position == varOffset)
+        {
+            if (s->vars[i] != tag)
+                return Fail(v, offset, "Variable has a different type than the instruction expects");
+            return HS_TRUE;
+        }
+
+        position += GetTagSize(s->vars[i]);
+        if (position > varOffset)
+            return Fail(v, offset, "Variable offset points into the middle of a variable");
+    }
+
+    return Fail(v, offset, "Variable offset outside of the variable area");
+}
+
+//------------------------------------------------------------------------------
+// The frame local at the byte offset from the frame pointer has to have the type
+static Bool8 CheckFrame(SVerifier* v, int offset, SStackLayout* s, int frameOffset, ETypeTag tag)
+{
+    if (s->frame < 0)
+        return Fail(v, offset, "Frame access outside of an INS_ENTER frame");
+
+    int position = 0;
+    for (int i = s->frame; i < s->stackCount; ++i)
+    {
+        if (position == frameOffset)
+        {
+            if (s->stack[i] != tag)
+                return Fail(v, offset, "Frame local has a different type than the instruction expects");
+            return HS_TRUE;
+        }
+
+        position += GetTagSize(s->stack[i]);
+        if (position > frameOffset)
+            return Fail(v, offset, "Frame offset points into the middle of a local");
+    }
+
+    return Fail(v, offset, "Frame offset outside of the frame");
+}
+
+//------------------------------------------------------------------------------
+static Bool8 Merge(SVerifier* v, int offset, int address, const SStackLayout* s, const char* mismatchError)
+{
+    if (!v->states[address])
+    {
+        v->states[address] = malloc(sizeof(SStackLayout));
+        *v->states[address] = *s;
+        Enqueue(v, address);
+        return HS_TRUE;
+    }
+
+    if (!IsSameState(v->states[address], s))
+        return Fail(v, offset, mismatchError);
+    return HS_TRUE;
+}
+
+//------------------------------------------------------------------------------
+// Control flow from the instruction at offset to the address
+static Bool8 Flow(SVerifier* v, int offset, int address, const SStackLayout* s)
+{
+    if (address >= v->size)
+        return Fail(v, offset, "Execution runs past the end of the code without INS_END");
+    if (!v->isBoundary[address])
+        return Fail(v, offset, "Jump into the middle of an instruction");
+
+    return Merge(v, offset, address, s, "Stack layout differs where control flow joins");
+}
+
+//------------------------------------------------------------------------------
+static Bool8 Call(SVerifier* v, int offset, SStackLayout* s, int next)
+{
+    int entry = LoadAddress(v->code + offset + 1);
+    if (entry >= v->size || !v->isBoundary[entry])
+        return Fail(v, offset, "Call into the middle of an instruction");
+
+    // Frames belong to one function, the callee has none until its INS_ENTER
+    SStackLayout callee = *s;
+    callee.function = entry;
+    callee.frame = -1;
+    if (!PushVar(v, offset, &callee, TAG_ADDRESS)
+        || !Merge(v, offset, entry, &callee, "Function called with a different stack layout"))
+    {
+        return HS_FALSE;
+    }
+
+    // Continue once the function is known to return, Return enqueues the call again
+    if (v->exitStates[entry])
+    {
+        SStackLayout returned = *v->exitStates[entry];
+        returned.function = s->function;
+        returned.frame = s->frame;
+        return Flow(v, offset, next, &returned);
+    }
+
+    return HS_TRUE;
+}
+
+//------------------------------------------------------------------------------
+// The state after the function returned, the calls waiting for it continue
+static Bool8 RecordExit(SVerifier* v, int offset, SStackLayout* s)
+{
+    if (v->exitStates[s->function])
+    {
+        if (!IsSameState(v->exitStates[s->function], s))
+            return Fail(v, offset, "Function returns with different stack layouts");
+        return HS_TRUE;
+    }
+
+    v->exitStates[s->function] = malloc(sizeof(SStackLayout));
+    *v->exitStates[s->function] = *s;
+
+    // Revisit the calls waiting for the function to return
+    for (int address = 0; address < v->size; ++address)
+    {
+        if (v->states[address] && (v->code[address] == INS_CALL || v->code[address] == INS_TAIL_CALL)
+            && LoadAddress(v->code + address + 1) == s->function)
+        {
+            Enqueue(v, address);
+        }
+    }
+    return HS_TRUE;
+}
+
+//------------------------------------------------------------------------------
+static Bool8 Return(SVerifier* v, int offset, SStackLayout* s)
+{
+    if (s->function < 0)
+        return Fail(v, offset, "Return outside of a function");
+    if (s->frame >= 0)
+        return Fail(v, offset, "INS_RETURN inside of a frame, it has to INS_LEAVE");
+    if (s->varCount == 0 || s->vars[s->varCount - 1] != TAG_ADDRESS)
+        return Fail(v, offset, "Return address is not on top of the variable area");
+    --s->varCount;
+
+    const SStackLayout* entry = v->states[s->function];
+    if (entry->varCount - 1 != s->varCount || memcmp(entry->vars, s->vars, s->varCount) != 0)
+        return Fail(v, offset, "Function returns with different variables than it was called with");
+
+    return RecordExit(v, offset, s);
+}
+
+//------------------------------------------------------------------------------
+// The arguments on top of the stack become the first locals of the frame
+static Bool8 Enter(SVerifier* v, int offset, SStackLayout* s, const byte* ins)
+{
+    if (s->function < 0)
+        return Fail(v, offset, "INS_ENTER outside of a function");
+    if (s->frame >= 0)
+        return Fail(v, offset, "INS_ENTER inside of a frame");
+
+    int base = s->stackCount;
+    int argumentSize = 0;
+    while (argumentSize < ins[1] && base > 0)
+        argumentSize += GetTagSize(s->stack[--base]);
+    if (argumentSize != ins[1])
+        return Fail(v, offset, base == 0 ? "Stack underflow" : "Arguments end in the middle of a value");
+
+    // Frame pointers are saved as offsets of the size of an address
+    int baseOffset = 0;
+    for (int i = 0; i < base; ++i)
+        baseOffset += GetTagSize(s->stack[i]);
+    if (baseOffset > UINT16_MAX)
+        return Fail(v, offset, "Frame too far up the data stack");
+
+    s->frame = base;
+    Bool8 ok = PushVar(v, offset, s, TAG_FRAME);
+    for (int i = 0; ok && i < ins[2]; ++i)
+        ok = Push(v, offset, s, TAG_INT);
+    for (int i = 0; ok && i < ins[3]; ++i)
+        ok = Push(v, offset, s, TAG_FLOAT);
+    return ok;
+}
+
+//------------------------------------------------------------------------------
+// The value on top replaces the frame, then the function returns
+static Bool8 Leave(SVerifier* v, int offset, SStackLayout* s, int valueTag)
+{
+    if (s->frame < 0)
+        return Fail(v, offset, "INS_LEAVE without INS_ENTER");
+    if (valueTag >= 0)
+    {
+        if (!Pop(v, offset, s, valueTag))
+            return HS_FALSE;
+        if (s->stackCount < s->frame)
+            return Fail(v, offset, "Returned value is not in the frame");
+    }
+
+    s->stackCount = s->frame;
+    if (valueTag >= 0)
+        s->stack[s->stackCount++] = valueTag;
+
+    if (s->varCount == 0 || s->vars[s->varCount - 1] != TAG_FRAME)
+        return Fail(v, offset, "Frame pointer is not on top of the variable area");
+    --s->varCount;
+    s->frame = -1;
+
+    return Return(v, offset, s);
+}
+
+//------------------------------------------------------------------------------
+// Control goes on at one of the jumps of the table after the instruction
+static Bool8 Switch(SVerifier* v, int offset, SStackLayout* s, const byte* ins, int next)
+{
+    if (!Pop(v, offset, s, TAG_INT))
+        return HS_FALSE;
+
+    int count = ins[1 + sizeof(hsbint)];
+    for (int i = 0; i <= count; ++i)
+    {
+        int entry = next + i * GetInstructionSize(INS_JUMP);
+        if (entry < v->size && v->code[entry] != INS_JUMP)
+            return Fail(v, offset, "Switch table entry is not an INS_JUMP");
+        if (!Flow(v, offset, entry, s))
+            return HS_FALSE;
+    }
+    return HS_TRUE;
+}
+
+//------------------------------------------------------------------------------
+// The arguments on top replace the frame, the callee returns where the function would
+static Bool8 TailCall(SVerifier* v, int offset, SStackLayout* s, const byte* ins)
+{
+    int entry = LoadAddress((byte*)ins + 1);
+    int argumentSize = ins[1 + sizeof(hsbaddress)];
+    if (entry >= v->size || !v->isBoundary[entry])
+        return Fail(v, offset, "Call into the middle of an instruction");
+    if (s->frame < 0)
+        return Fail(v, offset, "INS_TAIL_CALL outside of a frame");
+
+    int first = s->stackCount;
+    int size = 0;
+    while (size < argumentSize && first > s->frame)
+        size += GetTagSize(s->stack[--first]);
+    if (size != argumentSize)
+        return Fail(v, offset, size < argumentSize ? "Arguments are not in the frame" : "Arguments end in the middle of a value");
+
+    int argumentCount = s->stackCount - first;
+    memmove(s->stack + s->frame, s->stack + first, argumentCount);
+    s->stackCount = s->frame + argumentCount;
+
+    if (s->varCount == 0 || s->vars[s->varCount - 1] != TAG_FRAME)
+        return Fail(v, offset, "Frame pointer is not on top of the variable area");
+    --s->varCount;
+    s->frame = -1;
+
+    const SStackLayout* own = v->states[s->function];
+    if (own->varCount != s->varCount || memcmp(own->vars, s->vars, s->varCount) != 0)
+        return Fail(v, offset, "Variables are still allocated at INS_TAIL_CALL");
+
+    SStackLayout callee = *s;
+    callee.function = entry;
+    if (!Merge(v, offset, entry, &callee, "Function called with a different stack layout"))
+        return HS_FALSE;
+
+    // Continue once the callee is known to return, RecordExit enqueues the call again
+    if (!v->exitStates[entry])
+        return HS_TRUE;
+
+    SStackLayout returned = *v->exitStates[entry];
+    returned.function = s->function;
+    return RecordExit(v, offset, &returned);
+}
+
+//------------------------------------------------------------------------------
+// The arguments of the signature in the operands are popped, the last one first, and the result
+// pushed. Whether the function at the index has the signature is up to the host.
+static Bool8 CallNative(SVerifier* v, int offset, SStackLayout* s, const byte* ins)
+{
+    int argumentCount = ins[2];
+    if (argumentCount > HS_NATIVE_MAX_ARGUMENTS || ins[3] >> argumentCount != 0 || ins[4] > NATIVE_FLOAT)
+        return Fail(v, offset, "Invalid native function signature");
+
+    for (int i = argumentCount - 1; i >= 0; --i)
+    {
+        if (!Pop(v, offset, s, ins[3] & 1 << i ? TAG_FLOAT : TAG_INT))
+            return HS_FALSE;
+    }
+
+    switch (ins[4])
+    {
+        case NATIVE_INT: return Push(v, offset, s, TAG_INT);
+        case NATIVE_FLOAT: return Push(v, offset, s, TAG_FLOAT);
+        default: return HS_TRUE;
+    }
+}
+
+//------------------------------------------------------------------------------
+static Bool8 Step(SVerifier* v, int offset, SStackLayout* s)
+{
+    byte* ins = v->code + offset;
+    EInstruction instruction = ins[0];
+    int next = offset + GetInstructionSize(instruction);
+
+    Bool8 ok = HS_TRUE;
+    switch (instruction)
+    {
+        case INS_NOOP:
+        case INS_YIELD:
+            break;
+        case INS_CALL_EXT:
+        case INS_CALL_ASYNC: ok = CallNative(v, offset, s, ins); break;
+
+        case INS_ADD_I:
+        case INS_SUBSTRACT_I:
+        case INS_MULTIPLY_I:
+        case INS_DIVIDE_I:
+            ok = Pop(v, offset, s, TAG_INT) && Pop(v, offset, s, TAG_INT) && Push(v, offset, s, TAG_INT);
+            break;
+        case INS_ADD_F:
+        case INS_SUBSTRACT_F:
+        case INS_MULTIPLY_F:
+        case INS_DIVIDE_F:
+            ok = Pop(v, offset, s, TAG_FLOAT) && Pop(v, offset, s, TAG_FLOAT) && Push(v, offset, s, TAG_FLOAT);
+            break;
+
+        case INS_LITERAL_I: ok = Push(v, offset, s, TAG_INT); break;
+        case INS_LITERAL_F: ok = Push(v, offset, s, TAG_FLOAT); break;
+        case INS_LITERAL_B: ok = Push(v, offset, s, TAG_BOOL); break;
+
+        case INS_NEGATE_B:
+            ok = Pop(v, offset, s, TAG_BOOL) && Push(v, offset, s, TAG_BOOL);
+            break;
+        case INS_AND_B:
+        case INS_OR_B:
+            ok = Pop(v, offset, s, TAG_BOOL) && Pop(v, offset, s, TAG_BOOL) && Push(v, offset, s, TAG_BOOL);
+            break;
+
+        case INS_CMP_I_EQ:
+        case INS_CMP_I_LESS:
+        case INS_CMP_I_LESS_EQ:
+            ok = Pop(v, offset, s, TAG_INT) && Pop(v, offset, s, TAG_INT) && Push(v, offset, s, TAG_BOOL);
+            break;
+        case INS_CMP_F_EQ:
+        case INS_CMP_F_LESS:
+        case INS_CMP_F_LESS_EQ:
+            ok = Pop(v, offset, s, TAG_FLOAT) && Pop(v, offset, s, TAG_FLOAT) && Push(v, offset, s, TAG_BOOL);
+            break;
+
+        case INS_ALLOC_VAR_I: ok = PushVar(v, offset, s, TAG_INT); break;
+        case INS_ALLOC_VAR_F: ok = PushVar(v, offset, s, TAG_FLOAT); break;
+        case INS_DEALLOC_VAR_I: ok = PopVar(v, offset, s, TAG_INT); break;
+        case INS_DEALLOC_VAR_F: ok = PopVar(v, offset, s, TAG_FLOAT); break;
+
+        case INS_SAVE_VAR_I:
+            ok = Pop(v, offset, s, TAG_INT) && CheckVar(v, offset, s, ins[1], TAG_INT);
+            break;
+        case INS_SAVE_VAR_F:
+            ok = Pop(v, offset, s, TAG_FLOAT) && CheckVar(v, offset, s, ins[1], TAG_FLOAT);
+            break;
+        case INS_LOAD_VAR_I:
+            ok = CheckVar(v, offset, s, ins[1], TAG_INT) && Push(v, offset, s, TAG_INT);
+            break;
+        case INS_LOAD_VAR_F:
+            ok = CheckVar(v, offset, s, ins[1], TAG_FLOAT) && Push(v, offset, s, TAG_FLOAT);
+            break;
+
+        case INS_JUMP:
+            return Flow(v, offset, LoadAddress(ins + 1), s);
+        case INS_COND_JUMP_B:
+            ok = Pop(v, offset, s, TAG_BOOL) && Flow(v, offset, LoadAddress(ins + 1), s);
+            break;
+
+        case INS_CALL: return Call(v, offset, s, next);
+        case INS_RETURN: return Return(v, offset, s);
+        case INS_END: return HS_TRUE;
+
+        case INS_LOAD_VAR_VAR_ADD_I:
+        case INS_LOAD_VAR_VAR_SUBSTRACT_I:
+        case INS_LOAD_VAR_VAR_MULTIPLY_I:
+            ok = CheckVar(v, offset, s, ins[1], TAG_INT) && CheckVar(v, offset, s, ins[2], TAG_INT)
+                && Push(v, offset, s, TAG_INT);
+            break;
+        case INS_ADD_LITERAL_I:
+        case INS_SUBSTRACT_LITERAL_I:
+        case INS_MULTIPLY_LITERAL_I:
+            ok = Pop(v, offset, s, TAG_INT) && Push(v, offset, s, TAG_INT);
+            break;
+        case INS_CMP_I_EQ_JUMP:
+        case INS_CMP_I_LESS_JUMP:
+        case INS_CMP_I_LESS_EQ_JUMP:
+            ok = Pop(v, offset, s, TAG_INT) && Pop(v, offset, s, TAG_INT) && Flow(v, offset, LoadAddress(ins + 1), s);
+            break;
+        case INS_MOVE_VAR_I:
+            ok = CheckVar(v, offset, s, ins[1], TAG_INT) && CheckVar(v, offset, s, ins[2], TAG_INT);
+            break;
+        case INS_MOVE_VAR_F:
+            ok = CheckVar(v, offset, s, ins[1], TAG_FLOAT) && CheckVar(v, offset, s, ins[2], TAG_FLOAT);
+            break;
+
+        case INS_ENTER: ok = Enter(v, offset, s, ins); break;
+        case INS_LOAD_FRAME_I:
+            ok = CheckFrame(v, offset, s, ins[1], TAG_INT) && Push(v, offset, s, TAG_INT);
+            break;
+        case INS_LOAD_FRAME_F:
+            ok = CheckFrame(v, offset, s, ins[1], TAG_FLOAT) && Push(v, offset, s, TAG_FLOAT);
+            break;
+        case INS_SAVE_FRAME_I:
+            ok = Pop(v, offset, s, TAG_INT) && CheckFrame(v, offset, s, ins[1], TAG_INT);
+            break;
+        case INS_SAVE_FRAME_F:
+            ok = Pop(v, offset, s, TAG_FLOAT) && CheckFrame(v, offset, s, ins[1], TAG_FLOAT);
+            break;
+        case INS_LEAVE: return Leave(v, offset, s, -1);
+        case INS_LEAVE_I: return Leave(v, offset, s, TAG_INT);
+        case INS_LEAVE_F: return Leave(v, offset, s, TAG_FLOAT);
+        case INS_TAIL_CALL: return TailCall(v, offset, s, ins);
+        case INS_SWITCH: return Switch(v, offset, s, ins, next);
+
+        default:
+            return Fail(v, offset, "Invalid instruction");
+    }
+
+    return ok && Flow(v, offset, next, s);
+}
+
+//------------------------------------------------------------------------------
+EResult VerifyInstructionsWithLayouts(SStackData instructions, int dataSize, SVerifyResult* outResult,
+    SStackLayout*** outLayouts)
+{
+    *outResult = (SVerifyResult)
+    {
+        .errorOffset = -1,
+        .error = NULL,
+        .maxDataSize = 0,
+    };
+
+    SVerifier v =
+    {
+        .code = instructions.begin,
+        .size = instructions.end - instructions.begin,
+        .dataSize = dataSize,
+        .result = outResult,
+    };
+
+    if (v.size == 0)
+    {
+        Fail(&v, 0, "Execution runs past the end of the code without INS_END");
+        return R_ERROR;
+    }
+    if (v.size > UINT16_MAX)
+    {
+        Fail(&v, 0, "Code too large to be addressed");
+        return R_ERROR;
+    }
+
+    v.isBoundary = calloc(v.size, sizeof(Bool8));
+    v.states = calloc(v.size, sizeof(SStackLayout*));
+    v.exitStates = calloc(v.size, sizeof(SStackLayout*));
+    v.worklist = malloc(v.size * sizeof(int));
+    v.queued = calloc(v.size, sizeof(Bool8));
+
+    Bool8 ok = HS_TRUE;
+
+    // Instruction boundaries
+    for (int offset = 0; ok && offset < v.size;)
+    {
+        int size = GetInstructionSize(v.code[offset]);
+        if (size == 0)
+            ok = Fail(&v, offset, "Invalid instruction");
+        else if (offset + size > v.size)
+            ok = Fail(&v, offset, "Instruction operands past the end of the code");
+
+        v.isBoundary[offset] = HS_TRUE;
+        offset += size;
+    }
+
+    // Propagate stack layouts from the first instruction until nothing changes
+    if (ok)
+    {
+        SStackLayout start = { .function = -1, .frame = -1 };
+        Merge(&v, 0, 0, &start, NULL);
+    }
+
+    while (ok && v.worklistCount > 0)
+    {
+        int offset = v.worklist[--v.worklistCount];
+        v.queued[offset] = HS_FALSE;
+
+        SStackLayout s = *v.states[offset];
+        ok = Step(&v, offset, &s);
+    }
+
+    for (int i = 0; i < v.size; ++i)
+        free(v.exitStates[i]);
+
+    if (ok && outLayouts)
+        *outLayouts = v.states;
+    else
+        FreeStackLayouts(v.states, v.size);
+
+    free(v.queued);
+    free(v.worklist);
+    free(v.exitStates);
+    free(v.isBoundary);
+
+    return ok ? R_OK : R_ERROR;
+}
+
+//------------------------------------------------------------------------------
+EResult VerifyInstructions(SStackData instructions, int dataSize, SVerifyResult* outResult)
+{
+    return VerifyInstructionsWithLayouts(instructions, dataSize, outResult, NULL);
+}
+
+//------------------------------------------------------------------------------
+void FreeStackLayouts(SStackLayout** layouts, int count)
+{
+    if (!layouts)
+        return;
+
+    for (int i = 0; i < count; ++i)
+        free(layouts[i]);
+    free(layouts);
+}
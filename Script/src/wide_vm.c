@@ -0,0 +1,618 @@
+#include "wide_vm.h"
+#include "bytecode_c.h"
+#include "bytecode_info.h"
+
+#include <stdio.h>
+
+#define WIDE_SIZE_INT (HS_DATA_SIZE_INT * HS_WIDE_SCALE)
+#define WIDE_SIZE_FLOAT (HS_DATA_SIZE_FLOAT * HS_WIDE_SCALE)
+#define WIDE_SIZE_BOOL (HS_DATA_SIZE_BOOL * HS_WIDE_SCALE)
+#define WIDE_SIZE_ADDRESS (HS_DATA_SIZE_ADDRESS * HS_WIDE_SCALE)
+
+//------------------------------------------------------------------------------
+// The lanes of one group of rows, bit l of a lane set is lane l
+typedef struct
+{
+    unsigned active;          // The lanes that run
+    unsigned waiting;         // The lanes parked at ip, stack and variables of their own
+    byte* mergeIp;            // Lowest ip of the waiting lanes, the end of the instructions when none wait
+    byte* codeEnd;
+    SWideValue intMask;       // All bits set in the ints of the active lanes, clear in the others
+    SWideValue floatMask;
+    byte* ip[HS_WIDE_LANES];
+    byte* stack[HS_WIDE_LANES];
+    byte* variables[HS_WIDE_LANES];
+} SWideLanes;
+
+//------------------------------------------------------------------------------
+void InitWideContext(SWideContext* context, const SProgram* program)
+{
+    int dataSize = program->dataSize;
+#ifdef HS_SLOT_STACK
+    dataSize -= dataSize % sizeof(SValue);
+#endif
+    context->program = program;
+    context->dataBegin = malloc(dataSize * HS_WIDE_SCALE);
+    context->dataEnd = context->dataBegin + dataSize * HS_WIDE_SCALE;
+}
+
+//------------------------------------------------------------------------------
+void DeleteWideContext(SWideContext* context)
+{
+    free(context->dataBegin);
+    context->dataBegin = NULL;
+    context->dataEnd = NULL;
+}
+
+//------------------------------------------------------------------------------
+static Bool8 IsWideInstruction(EInstruction instruction)
+{
+    switch (instruction)
+    {
+        case INS_CALL:
+        case INS_RETURN:
+        case INS_CALL_EXT:
+        case INS_CALL_ASYNC:
+        case INS_END:
+        case INS_TAIL_CALL:
+            return HS_FALSE;
+        default:
+            return GetInstructionSize(instruction) != 0;
+    }
+}
+
+//------------------------------------------------------------------------------
+// The code of a function goes up to the entry of the next one, the last is at the end
+Bool8 CanRunWide(const SProgram* program, int function)
+{
+    if (function < 0 || function >= program->functions.count)
+    {
+        printf("ERROR: Invalid function handle %d\n", function);
+        return HS_FALSE;
+    }
+
+    const SScriptFunction* f = &program->functions.functions[function];
+    byte* code = program->instructions.begin;
+    int end = (int)(program->instructions.end - code);
+    for (int i = 0; i < program->functions.count; ++i)
+    {
+        int entry = program->functions.functions[i].entry;
+        if (entry > f->entry && entry < end)
+            end = entry;
+    }
+
+    const char* error = NULL;
+    int offset = f->entry;
+    if (code[offset] != INS_ENTER)
+        error = "no INS_ENTER";
+
+    while (!error && offset < end)
+    {
+        EInstruction instruction = code[offset];
+        int size = GetInstructionSize(instruction);
+        if (!IsWideInstruction(instruction))
+        {
+            error = GetInstructionName(instruction);
+        }
+        else if (offset + size > end)
+        {
+            error = "instruction past the end";
+        }
+        else if (HasAddressOperand(instruction))
+        {
+            int address = LoadAddress(code + offset + 1);
+            if (address < f->entry || address >= end)
+                error = "jump out of the function";
+        }
+        else if (instruction == INS_SWITCH)
+        {
+            // the table is scanned as the jumps it is made of
+            int tableEnd = offset + size + (code[offset + 1 + sizeof(hsbint)] + 1) * (1 + sizeof(hsbaddress));
+            for (int entry = offset + size; !error && entry < tableEnd; entry += 1 + sizeof(hsbaddress))
+            {
+                if (tableEnd > end || code[entry] != INS_JUMP)
+                    error = "invalid switch table";
+            }
+        }
+
+        if (!error)
+            offset += size;
+    }
+
+    if (error)
+    {
+        printf("ERROR: '%s' can not run wide, %s at %d\n", f->name, error, offset);
+        return HS_FALSE;
+    }
+    return HS_TRUE;
+}
+
+//------------------------------------------------------------------------------
+static void UpdateLaneMasks(SWideLanes* lanes)
+{
+    for (int l = 0; l < HS_WIDE_LANES; ++l)
+    {
+        lanes->intMask.i[l] = lanes->active & 1u << l ? -1 : 0;
+        lanes->floatMask.b[l] = lanes->active & 1u << l ? -1 : 0;
+    }
+}
+
+//------------------------------------------------------------------------------
+static void ParkLanes(SWideLanes* lanes, unsigned park, byte* ip, byte* stack, byte* variables)
+{
+    for (int l = 0; l < HS_WIDE_LANES; ++l)
+    {
+        if (park & 1u << l)
+        {
+            lanes->ip[l] = ip;
+            lanes->stack[l] = stack;
+            lanes->variables[l] = variables;
+        }
+    }
+    lanes->waiting |= park;
+    if (park && ip < lanes->mergeIp)
+        lanes->mergeIp = ip;
+}
+
+//------------------------------------------------------------------------------
+// Parks the running lanes and continues with the waiting ones at the lowest ip, which includes
+// the running lanes when they are there. HS_FALSE when no lanes are left.
+static Bool8 ScheduleLanes(SWideLanes* lanes, byte** ip, byte** stack, byte** variables)
+{
+    ParkLanes(lanes, lanes->active, *ip, *stack, *variables);
+    if (!lanes->waiting)
+        return HS_FALSE;
+
+    byte* lowest = lanes->mergeIp;
+    lanes->active = 0;
+    lanes->mergeIp = lanes->codeEnd;
+    for (int l = 0; l < HS_WIDE_LANES; ++l)
+    {
+        if (!(lanes->waiting & 1u << l))
+            continue;
+
+        if (lanes->ip[l] == lowest)
+        {
+            // lanes at the same ip have the same stack depth
+            lanes->active |= 1u << l;
+            *stack = lanes->stack[l];
+            *variables = lanes->variables[l];
+        }
+        else if (lanes->ip[l] < lanes->mergeIp)
+        {
+            lanes->mergeIp = lanes->ip[l];
+        }
+    }
+
+    lanes->waiting &= ~lanes->active;
+    *ip = lowest;
+    UpdateLaneMasks(lanes);
+    return HS_TRUE;
+}
+
+//------------------------------------------------------------------------------
+// The taken lanes wait at the target when the others continue at ip
+static void BranchLanes(SWideLanes* lanes, unsigned taken, byte* target, byte** ip, byte* stack, byte* variables)
+{
+    taken &= lanes->active;
+    if (taken == lanes->active)
+    {
+        *ip = target;
+    }
+    else if (taken)
+    {
+        ParkLanes(lanes, taken, target, stack, variables);
+        lanes->active &= ~taken;
+        UpdateLaneMasks(lanes);
+    }
+}
+
+//------------------------------------------------------------------------------
+static void StoreWideInt(byte* to, const SWideValue* value, const SWideValue* intMask)
+{
+    SWideValue* v = (SWideValue*)to;
+    for (int l = 0; l < HS_WIDE_LANES; ++l)
+        v->i[l] = (hsbint)((value->i[l] & intMask->i[l]) | (v->i[l] & ~intMask->i[l]));
+}
+
+//------------------------------------------------------------------------------
+static void StoreWideFloat(byte* to, const SWideValue* value, const SWideValue* floatMask)
+{
+    SWideValue* v = (SWideValue*)to;
+    for (int l = 0; l < HS_WIDE_LANES; ++l)
+        v->b[l] = (value->b[l] & floatMask->b[l]) | (v->b[l] & ~floatMask->b[l]);
+}
+
+//------------------------------------------------------------------------------
+// Runs the function from its INS_ENTER with the arguments below stack until every lane left,
+// their results go to the lanes of outResult
+static EVMError RunLanes(const SWideContext* context, byte* entry, byte* stack, int laneCount, SWideValue* outResult)
+{
+    static const SWideValue zero = { { 0 } };
+
+    SWideLanes lanes;
+    lanes.active = (unsigned)(((uint64_t)1 << laneCount) - 1);
+    lanes.waiting = 0;
+    lanes.codeEnd = context->program->instructions.end;
+    lanes.mergeIp = lanes.codeEnd;
+    UpdateLaneMasks(&lanes);
+
+    byte* begin = context->program->instructions.begin;
+    byte* ins = entry;
+    byte* sp = stack;
+    // the return address of the call is not used, its place keeps the offsets of the variables
+    byte* rp = context->dataEnd - WIDE_SIZE_ADDRESS;
+    byte* fp = context->dataBegin;
+
+// first and second are the operands, the result replaces first
+#define HS_WIDE_BINARY(size, member, expression) \
+    { \
+        sp -= size; \
+        const SWideValue* second = (const SWideValue*)sp; \
+        SWideValue* first = (SWideValue*)(sp - size); \
+        for (int l = 0; l < HS_WIDE_LANES; ++l) \
+            first->member[l] = expression; \
+        ins += 1; \
+        break; \
+    }
+#define HS_WIDE_COMPARE(size, member, op) \
+    { \
+        sp -= 2 * size; \
+        const SWideValue* first = (const SWideValue*)sp; \
+        const SWideValue* second = (const SWideValue*)(sp + size); \
+        SWideValue result; \
+        for (int l = 0; l < HS_WIDE_LANES; ++l) \
+            result.b[l] = -(int32_t)(first->member[l] op second->member[l]); \
+        *(SWideValue*)sp = result; \
+        sp += WIDE_SIZE_BOOL; \
+        ins += 1; \
+        break; \
+    }
+#define HS_WIDE_LITERAL(member, value) \
+    { \
+        SWideValue* first = (SWideValue*)(sp - WIDE_SIZE_INT); \
+        hsbint literal = LoadInt(ins + 1); \
+        for (int l = 0; l < HS_WIDE_LANES; ++l) \
+            first->member[l] = value; \
+        ins += 1 + sizeof(hsbint); \
+        break; \
+    }
+#define HS_WIDE_VAR_VAR(op) \
+    { \
+        const SWideValue* first = (const SWideValue*)(rp + ins[1] * HS_WIDE_SCALE); \
+        const SWideValue* second = (const SWideValue*)(rp + ins[2] * HS_WIDE_SCALE); \
+        SWideValue* result = (SWideValue*)sp; \
+        for (int l = 0; l < HS_WIDE_LANES; ++l) \
+            result->i[l] = (hsbint)(first->i[l] op second->i[l]); \
+        sp += WIDE_SIZE_INT; \
+        ins += 3; \
+        break; \
+    }
+#define HS_WIDE_COMPARE_JUMP(op) \
+    { \
+        sp -= 2 * WIDE_SIZE_INT; \
+        const SWideValue* first = (const SWideValue*)sp; \
+        const SWideValue* second = (const SWideValue*)(sp + WIDE_SIZE_INT); \
+        unsigned taken = 0; \
+        for (int l = 0; l < HS_WIDE_LANES; ++l) \
+            taken |= (unsigned)(first->i[l] op second->i[l]) << l; \
+        byte* target = begin + LoadAddress(ins + 1); \
+        ins += 1 + sizeof(hsbaddress); \
+        BranchLanes(&lanes, taken, target, &ins, sp, rp); \
+        break; \
+    }
+
+    for (;;)
+    {
+        // the running lanes got to or past the lowest waiting ones, which run first
+        if (ins >= lanes.mergeIp)
+        {
+            ScheduleLanes(&lanes, &ins, &sp, &rp);
+            if (ins >= lanes.codeEnd)
+                return VM_ERROR_INVALID_INSTRUCTION;
+        }
+
+        switch ((EInstruction)*ins)
+        {
+            case INS_NOOP:
+            case INS_YIELD: ins += 1; break; // the lanes run to the end like CallFunctionBatch
+
+            case INS_ADD_I: HS_WIDE_BINARY(WIDE_SIZE_INT, i, (hsbint)(first->i[l] + second->i[l]))
+            case INS_ADD_F: HS_WIDE_BINARY(WIDE_SIZE_FLOAT, f, first->f[l] + second->f[l])
+            case INS_SUBSTRACT_I: HS_WIDE_BINARY(WIDE_SIZE_INT, i, (hsbint)(first->i[l] - second->i[l]))
+            case INS_SUBSTRACT_F: HS_WIDE_BINARY(WIDE_SIZE_FLOAT, f, first->f[l] - second->f[l])
+            case INS_MULTIPLY_I: HS_WIDE_BINARY(WIDE_SIZE_INT, i, (hsbint)(first->i[l] * second->i[l]))
+            case INS_MULTIPLY_F: HS_WIDE_BINARY(WIDE_SIZE_FLOAT, f, first->f[l] * second->f[l])
+            // the lanes that do not run hold anything, they must not divide by 0
+            case INS_DIVIDE_I: HS_WIDE_BINARY(WIDE_SIZE_INT, i, (hsbint)(first->i[l] / (lanes.intMask.i[l] ? second->i[l] : 1)))
+            case INS_DIVIDE_F: HS_WIDE_BINARY(WIDE_SIZE_FLOAT, f, first->f[l] / second->f[l])
+
+            case INS_LITERAL_I:
+            {
+                SWideValue* value = (SWideValue*)sp;
+                hsbint literal = LoadInt(ins + 1);
+                for (int l = 0; l < HS_WIDE_LANES; ++l)
+                    value->i[l] = literal;
+                sp += WIDE_SIZE_INT;
+                ins += 1 + sizeof(hsbint);
+                break;
+            }
+            case INS_LITERAL_F:
+            {
+                SWideValue* value = (SWideValue*)sp;
+                hsbfloat literal = LoadFloat(ins + 1);
+                for (int l = 0; l < HS_WIDE_LANES; ++l)
+                    value->f[l] = literal;
+                sp += WIDE_SIZE_FLOAT;
+                ins += 1 + sizeof(hsbfloat);
+                break;
+            }
+            case INS_LITERAL_B:
+            {
+                SWideValue* value = (SWideValue*)sp;
+                int32_t literal = -(int32_t)(LoadBool(ins + 1) != 0);
+                for (int l = 0; l < HS_WIDE_LANES; ++l)
+                    value->b[l] = literal;
+                sp += WIDE_SIZE_BOOL;
+                ins += 1 + sizeof(hsbbool);
+                break;
+            }
+
+            case INS_NEGATE_B:
+            {
+                SWideValue* value = (SWideValue*)(sp - WIDE_SIZE_BOOL);
+                for (int l = 0; l < HS_WIDE_LANES; ++l)
+                    value->b[l] = ~value->b[l];
+                ins += 1;
+                break;
+            }
+            case INS_AND_B: HS_WIDE_BINARY(WIDE_SIZE_BOOL, b, first->b[l] & second->b[l])
+            case INS_OR_B: HS_WIDE_BINARY(WIDE_SIZE_BOOL, b, first->b[l] | second->b[l])
+
+            case INS_CMP_I_EQ: HS_WIDE_COMPARE(WIDE_SIZE_INT, i, ==)
+            case INS_CMP_I_LESS: HS_WIDE_COMPARE(WIDE_SIZE_INT, i, <)
+            case INS_CMP_I_LESS_EQ: HS_WIDE_COMPARE(WIDE_SIZE_INT, i, <=)
+            case INS_CMP_F_EQ: HS_WIDE_COMPARE(WIDE_SIZE_FLOAT, f, ==)
+            case INS_CMP_F_LESS: HS_WIDE_COMPARE(WIDE_SIZE_FLOAT, f, <)
+            case INS_CMP_F_LESS_EQ: HS_WIDE_COMPARE(WIDE_SIZE_FLOAT, f, <=)
+
+            // variables start zeroed in the lanes that run, the others may still use the place
+            case INS_ALLOC_VAR_I:
+            {
+                rp -= WIDE_SIZE_INT;
+                StoreWideInt(rp, &zero, &lanes.intMask);
+                ins += 1;
+                break;
+            }
+            case INS_ALLOC_VAR_F:
+            {
+                rp -= WIDE_SIZE_FLOAT;
+                StoreWideFloat(rp, &zero, &lanes.floatMask);
+                ins += 1;
+                break;
+            }
+            case INS_DEALLOC_VAR_I: rp += WIDE_SIZE_INT; ins += 1; break;
+            case INS_DEALLOC_VAR_F: rp += WIDE_SIZE_FLOAT; ins += 1; break;
+
+            case INS_SAVE_VAR_I:
+            {
+                sp -= WIDE_SIZE_INT;
+                StoreWideInt(rp + ins[1] * HS_WIDE_SCALE, (const SWideValue*)sp, &lanes.intMask);
+                ins += 2;
+                break;
+            }
+            case INS_SAVE_VAR_F:
+            {
+                sp -= WIDE_SIZE_FLOAT;
+                StoreWideFloat(rp + ins[1] * HS_WIDE_SCALE, (const SWideValue*)sp, &lanes.floatMask);
+                ins += 2;
+                break;
+            }
+            case INS_LOAD_VAR_I:
+            {
+                *(SWideValue*)sp = *(const SWideValue*)(rp + ins[1] * HS_WIDE_SCALE);
+                sp += WIDE_SIZE_INT;
+                ins += 2;
+                break;
+            }
+            case INS_LOAD_VAR_F:
+            {
+                *(SWideValue*)sp = *(const SWideValue*)(rp + ins[1] * HS_WIDE_SCALE);
+                sp += WIDE_SIZE_FLOAT;
+                ins += 2;
+                break;
+            }
+
+            case INS_JUMP: ins = begin + LoadAddress(ins + 1); break;
+            case INS_COND_JUMP_B:
+            {
+                sp -= WIDE_SIZE_BOOL;
+                const SWideValue* value = (const SWideValue*)sp;
+                unsigned taken = 0;
+                for (int l = 0; l < HS_WIDE_LANES; ++l)
+                    taken |= (unsigned)(value->b[l] & 1) << l;
+                byte* target = begin + LoadAddress(ins + 1);
+                ins += 1 + sizeof(hsbaddress);
+                BranchLanes(&lanes, taken, target, &ins, sp, rp);
+                break;
+            }
+
+            case INS_LOAD_VAR_VAR_ADD_I: HS_WIDE_VAR_VAR(+)
+            case INS_LOAD_VAR_VAR_SUBSTRACT_I: HS_WIDE_VAR_VAR(-)
+            case INS_LOAD_VAR_VAR_MULTIPLY_I: HS_WIDE_VAR_VAR(*)
+            case INS_ADD_LITERAL_I: HS_WIDE_LITERAL(i, (hsbint)(first->i[l] + literal))
+            case INS_SUBSTRACT_LITERAL_I: HS_WIDE_LITERAL(i, (hsbint)(first->i[l] - literal))
+            case INS_MULTIPLY_LITERAL_I: HS_WIDE_LITERAL(i, (hsbint)(first->i[l] * literal))
+            case INS_CMP_I_EQ_JUMP: HS_WIDE_COMPARE_JUMP(==)
+            case INS_CMP_I_LESS_JUMP: HS_WIDE_COMPARE_JUMP(<)
+            case INS_CMP_I_LESS_EQ_JUMP: HS_WIDE_COMPARE_JUMP(<=)
+            case INS_MOVE_VAR_I:
+            {
+                StoreWideInt(rp + ins[2] * HS_WIDE_SCALE, (const SWideValue*)(rp + ins[1] * HS_WIDE_SCALE), &lanes.intMask);
+                ins += 3;
+                break;
+            }
+            case INS_MOVE_VAR_F:
+            {
+                StoreWideFloat(rp + ins[2] * HS_WIDE_SCALE, (const SWideValue*)(rp + ins[1] * HS_WIDE_SCALE), &lanes.floatMask);
+                ins += 3;
+                break;
+            }
+
+            case INS_ENTER:
+            {
+                // there is no caller frame, the place of its pointer keeps the offsets of the variables
+                rp -= WIDE_SIZE_ADDRESS;
+                fp = sp - ins[1] * HS_WIDE_SCALE;
+                for (int local = 0; local < ins[2]; ++local)
+                {
+                    *(SWideValue*)sp = zero;
+                    sp += WIDE_SIZE_INT;
+                }
+                for (int local = 0; local < ins[3]; ++local)
+                {
+                    *(SWideValue*)sp = zero;
+                    sp += WIDE_SIZE_FLOAT;
+                }
+                ins += 4;
+                break;
+            }
+            case INS_LOAD_FRAME_I:
+            {
+                *(SWideValue*)sp = *(const SWideValue*)(fp + ins[1] * HS_WIDE_SCALE);
+                sp += WIDE_SIZE_INT;
+                ins += 2;
+                break;
+            }
+            case INS_LOAD_FRAME_F:
+            {
+                *(SWideValue*)sp = *(const SWideValue*)(fp + ins[1] * HS_WIDE_SCALE);
+                sp += WIDE_SIZE_FLOAT;
+                ins += 2;
+                break;
+            }
+            case INS_SAVE_FRAME_I:
+            {
+                sp -= WIDE_SIZE_INT;
+                StoreWideInt(fp + ins[1] * HS_WIDE_SCALE, (const SWideValue*)sp, &lanes.intMask);
+                ins += 2;
+                break;
+            }
+            case INS_SAVE_FRAME_F:
+            {
+                sp -= WIDE_SIZE_FLOAT;
+                StoreWideFloat(fp + ins[1] * HS_WIDE_SCALE, (const SWideValue*)sp, &lanes.floatMask);
+                ins += 2;
+                break;
+            }
+
+            // the running lanes are done, the waiting ones continue
+            case INS_LEAVE:
+            case INS_LEAVE_I:
+            case INS_LEAVE_F:
+            {
+                if (*ins == INS_LEAVE_I)
+                    StoreWideInt((byte*)outResult, (const SWideValue*)(sp - WIDE_SIZE_INT), &lanes.intMask);
+                else if (*ins == INS_LEAVE_F)
+                    StoreWideFloat((byte*)outResult, (const SWideValue*)(sp - WIDE_SIZE_FLOAT), &lanes.floatMask);
+                lanes.active = 0;
+                if (!ScheduleLanes(&lanes, &ins, &sp, &rp))
+                    return VM_OK;
+                break;
+            }
+
+            case INS_SWITCH:
+            {
+                // every lane waits at its case, the lowest run first
+                hsbint low = LoadInt(ins + 1);
+                int count = ins[1 + sizeof(hsbint)];
+                byte* table = ins + 2 + sizeof(hsbint);
+                sp -= WIDE_SIZE_INT;
+                const SWideValue* value = (const SWideValue*)sp;
+                for (int l = 0; l < HS_WIDE_LANES; ++l)
+                {
+                    if (!(lanes.active & 1u << l))
+                        continue;
+
+                    int index = value->i[l] - low;
+                    byte* entry = table + (index >= 0 && index < count ? index + 1 : 0) * (1 + sizeof(hsbaddress));
+                    ParkLanes(&lanes, 1u << l, begin + LoadAddress(entry + 1), sp, rp);
+                }
+                lanes.active = 0;
+                ScheduleLanes(&lanes, &ins, &sp, &rp);
+                break;
+            }
+
+            default:
+                // CanRunWide leaves calls out
+                return VM_ERROR_INVALID_INSTRUCTION;
+        }
+    }
+
+#undef HS_WIDE_BINARY
+#undef HS_WIDE_COMPARE
+#undef HS_WIDE_LITERAL
+#undef HS_WIDE_VAR_VAR
+#undef HS_WIDE_COMPARE_JUMP
+}
+
+//------------------------------------------------------------------------------
+EResult CallFunctionWide(SWideContext* context, int function, const void* const* inputs, int argumentCount,
+    void* outputs, int rowCount)
+{
+    const SProgram* program = context->program;
+    if (!CanRunWide(program, function))
+        return R_ERROR;
+
+    const SScriptFunction* f = &program->functions.functions[function];
+    if (argumentCount != f->signature.argumentCount)
+    {
+        printf("ERROR: '%s' takes %d arguments, not %d\n", f->name, f->signature.argumentCount, argumentCount);
+        return R_ERROR;
+    }
+
+    byte* entry = program->instructions.begin + f->entry;
+    for (int row = 0; row < rowCount; row += HS_WIDE_LANES)
+    {
+        // the lanes past the last row get zeros
+        int laneCount = rowCount - row < HS_WIDE_LANES ? rowCount - row : HS_WIDE_LANES;
+        byte* stack = context->dataBegin;
+        for (int i = 0; i < argumentCount; ++i)
+        {
+            SWideValue* value = (SWideValue*)stack;
+            *value = (SWideValue){ { 0 } };
+            if (f->signature.floatArguments & 1 << i)
+            {
+                for (int l = 0; l < laneCount; ++l)
+                    value->f[l] = ((const hsbfloat*)inputs[i])[row + l];
+                stack += WIDE_SIZE_FLOAT;
+            }
+            else
+            {
+                for (int l = 0; l < laneCount; ++l)
+                    value->i[l] = ((const hsbint*)inputs[i])[row + l];
+                stack += WIDE_SIZE_INT;
+            }
+        }
+
+        SWideValue result = { { 0 } };
+        EVMError error = RunLanes(context, entry, stack, laneCount, &result);
+        if (error != VM_OK)
+        {
+            printf("ERROR: '%s' stopped with error %d in rows %d to %d\n", f->name, error, row, row + laneCount - 1);
+            return R_ERROR;
+        }
+
+        if (outputs && f->signature.result == NATIVE_INT)
+        {
+            for (int l = 0; l < laneCount; ++l)
+                ((hsbint*)outputs)[row + l] = result.i[l];
+        }
+        else if (outputs && f->signature.result == NATIVE_FLOAT)
+        {
+            for (int l = 0; l < laneCount; ++l)
+                ((hsbfloat*)outputs)[row + l] = result.f[l];
+        }
+    }
+    return R_OK;
+}
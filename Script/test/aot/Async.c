@@ -0,0 +1,93 @@
+// Translated from HsScript bytecode by TranslateToC (aot.h), do not edit.
+// Runs like VMRunVerified on a VM set up with the translated instructions.
+
+#include <math.h>
+#include <stddef.h>
+
+#include "bytecode_c.h"
+
+Bool8 RunAsync(SVMData* vmData)
+{
+    if (vmData->instructionStack.stackPointer != vmData->instructionStack.begin
+        || vmData->dataStack.base.stackPointer != vmData->dataStack.base.begin
+        || vmData->dataStack.reversePointer != vmData->dataStack.base.end)
+    {
+        return VMRunVerified(vmData);
+    }
+
+    hsbint s0_i = 0;
+    hsbint s1_i = 0;
+    hsbint v0_i = 0;
+    hsbint v1_i = 0;
+
+    // INS_ALLOC_VAR_I
+    v0_i = 0;
+    // INS_LITERAL_I
+    s0_i = 0;
+    // INS_SAVE_VAR_I
+    v0_i = s0_i;
+    // INS_ALLOC_VAR_I
+    v1_i = 0;
+    // INS_LITERAL_I
+    s0_i = 0;
+    // INS_SAVE_VAR_I
+    v1_i = s0_i;
+    // INS_JUMP
+    goto L37;
+L15:
+    // INS_LOAD_VAR_I
+    s0_i = v0_i;
+    // INS_LOAD_VAR_I
+    s1_i = v1_i;
+    // INS_CALL_ASYNC
+    PushInt(&vmData->dataStack.base.stackPointer, s1_i);
+    vmData->functions.begin[2](vmData);
+    if (vmData->asyncCall == HS_NO_ASYNC_CALL)
+        goto C19;
+    if (vmData->dataStack.base.end - vmData->dataStack.base.begin < (ptrdiff_t)(3 * HS_DATA_SIZE_INT))
+    {
+        vmData->error = VM_ERROR_STACK_OVERFLOW;
+        return HS_FALSE;
+    }
+    PushInt(&vmData->dataStack.base.stackPointer, s0_i);
+    vmData->dataStack.reversePointer -= HS_DATA_SIZE_INT;
+    StoreVarInt(vmData->dataStack.reversePointer, v0_i);
+    vmData->dataStack.reversePointer -= HS_DATA_SIZE_INT;
+    StoreVarInt(vmData->dataStack.reversePointer, v1_i);
+    vmData->instructionStack.stackPointer = vmData->instructionStack.begin + 24;
+    return HS_TRUE;
+C19:
+    s1_i = PopInt(&vmData->dataStack.base.stackPointer);
+    // INS_MULTIPLY_LITERAL_I
+    s1_i = s1_i * 2;
+    // INS_ADD_I
+    s0_i = s0_i + s1_i;
+    // INS_SAVE_VAR_I
+    v0_i = s0_i;
+    // INS_LOAD_VAR_I
+    s0_i = v1_i;
+    // INS_ADD_LITERAL_I
+    s0_i = s0_i + 1;
+    // INS_SAVE_VAR_I
+    v1_i = s0_i;
+L37:
+    // INS_LOAD_VAR_I
+    s0_i = v1_i;
+    // INS_LITERAL_I
+    s1_i = 6;
+    // INS_CMP_I_LESS_JUMP
+    if (s0_i < s1_i)
+        goto L15;
+    // INS_END
+    if (vmData->dataStack.base.end - vmData->dataStack.base.begin < (ptrdiff_t)(2 * HS_DATA_SIZE_INT))
+    {
+        vmData->error = VM_ERROR_STACK_OVERFLOW;
+        return HS_FALSE;
+    }
+    vmData->dataStack.reversePointer -= HS_DATA_SIZE_INT;
+    StoreVarInt(vmData->dataStack.reversePointer, v0_i);
+    vmData->dataStack.reversePointer -= HS_DATA_SIZE_INT;
+    StoreVarInt(vmData->dataStack.reversePointer, v1_i);
+    vmData->instructionStack.stackPointer = vmData->instructionStack.begin + 45;
+    return HS_FALSE;
+}
@@ -0,0 +1,67 @@
+// Translated from HsScript bytecode by TranslateToC (aot.h), do not edit.
+// Runs like VMRunVerified on a VM set up with the translated instructions.
+
+#include <math.h>
+#include <stddef.h>
+
+#include "bytecode_c.h"
+
+Bool8 RunCalls(SVMData* vmData)
+{
+    if (vmData->instructionStack.stackPointer != vmData->instructionStack.begin
+        || vmData->dataStack.base.stackPointer != vmData->dataStack.base.begin
+        || vmData->dataStack.reversePointer != vmData->dataStack.base.end)
+    {
+        return VMRunVerified(vmData);
+    }
+
+    hsbint s0_i = 0;
+    hsbfloat s0_f = 0;
+    hsbbool s1_b = 0;
+    hsbint v0_i = 0;
+    hsbaddress v1_a = 0;
+
+    // INS_ALLOC_VAR_I
+    v0_i = 0;
+    // INS_LITERAL_I
+    s0_i = 5;
+    // INS_SAVE_VAR_I
+    v0_i = s0_i;
+    // INS_CALL
+    v1_a = 9;
+    goto L20;
+L9:
+    // INS_CALL
+    v1_a = 12;
+    goto L20;
+L12:
+    // INS_LITERAL_F
+    s0_f = 0x1.8p+0f;
+    // INS_LITERAL_B
+    s1_b = 1;
+    // INS_END
+    if (vmData->dataStack.base.end - vmData->dataStack.base.begin < (ptrdiff_t)(HS_DATA_SIZE_INT + HS_DATA_SIZE_FLOAT + HS_DATA_SIZE_BOOL))
+    {
+        vmData->error = VM_ERROR_STACK_OVERFLOW;
+        return HS_FALSE;
+    }
+    PushFloat(&vmData->dataStack.base.stackPointer, s0_f);
+    PushBool(&vmData->dataStack.base.stackPointer, s1_b);
+    vmData->dataStack.reversePointer -= HS_DATA_SIZE_INT;
+    StoreVarInt(vmData->dataStack.reversePointer, v0_i);
+    vmData->instructionStack.stackPointer = vmData->instructionStack.begin + 19;
+    return HS_FALSE;
+L20:
+    // INS_LOAD_VAR_I
+    s0_i = v0_i;
+    // INS_MULTIPLY_LITERAL_I
+    s0_i = s0_i * 3;
+    // INS_SAVE_VAR_I
+    v0_i = s0_i;
+    // INS_RETURN
+    switch (v1_a)
+    {
+        case 9: goto L9;
+        default: goto L12;
+    }
+}
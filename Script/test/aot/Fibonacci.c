@@ -0,0 +1,104 @@
+// Translated from HsScript bytecode by TranslateToC (aot.h), do not edit.
+// Runs like VMRunVerified on a VM set up with the translated instructions.
+
+#include <math.h>
+#include <stddef.h>
+
+#include "bytecode_c.h"
+
+Bool8 RunFibonacci(SVMData* vmData)
+{
+    if (vmData->instructionStack.stackPointer != vmData->instructionStack.begin
+        || vmData->dataStack.base.stackPointer != vmData->dataStack.base.begin
+        || vmData->dataStack.reversePointer != vmData->dataStack.base.end)
+    {
+        return VMRunVerified(vmData);
+    }
+
+    hsbint s0_i = 0;
+    hsbbool s0_b = 0;
+    hsbint s1_i = 0;
+    hsbint v0_i = 0;
+    hsbint v1_i = 0;
+    hsbint v2_i = 0;
+    hsbint v3_i = 0;
+
+    // INS_ALLOC_VAR_I
+    v0_i = 0;
+    // INS_LITERAL_I
+    s0_i = 0;
+    // INS_SAVE_VAR_I
+    v0_i = s0_i;
+    // INS_ALLOC_VAR_I
+    v1_i = 0;
+    // INS_LITERAL_I
+    s0_i = 1;
+    // INS_SAVE_VAR_I
+    v1_i = s0_i;
+    // INS_ALLOC_VAR_I
+    v2_i = 0;
+    // INS_LITERAL_I
+    s0_i = 0;
+    // INS_SAVE_VAR_I
+    v2_i = s0_i;
+    // INS_JUMP
+    goto L58;
+L21:
+    // INS_ALLOC_VAR_I
+    v3_i = 0;
+    // INS_LOAD_VAR_VAR_ADD_I
+    s0_i = v0_i + v1_i;
+    // INS_SAVE_VAR_I
+    v3_i = s0_i;
+    // INS_LITERAL_I
+    s0_i = 10000;
+    // INS_LOAD_VAR_I
+    s1_i = v3_i;
+    // INS_CMP_I_LESS_EQ
+    s0_b = s0_i <= s1_i;
+    // INS_NEGATE_B
+    s0_b = 1 - s0_b;
+    // INS_COND_JUMP_B
+    if (s0_b != 0)
+        goto L44;
+    // INS_LOAD_VAR_I
+    s0_i = v3_i;
+    // INS_SUBSTRACT_LITERAL_I
+    s0_i = s0_i - 10000;
+    // INS_SAVE_VAR_I
+    v3_i = s0_i;
+L44:
+    // INS_MOVE_VAR_I
+    v0_i = v1_i;
+    // INS_MOVE_VAR_I
+    v1_i = v3_i;
+    // INS_LOAD_VAR_I
+    s0_i = v2_i;
+    // INS_ADD_LITERAL_I
+    s0_i = s0_i + 1;
+    // INS_SAVE_VAR_I
+    v2_i = s0_i;
+    // INS_DEALLOC_VAR_I
+L58:
+    // INS_LOAD_VAR_I
+    s0_i = v2_i;
+    // INS_LITERAL_I
+    s1_i = 150;
+    // INS_CMP_I_LESS_JUMP
+    if (s0_i < s1_i)
+        goto L21;
+    // INS_END
+    if (vmData->dataStack.base.end - vmData->dataStack.base.begin < (ptrdiff_t)(3 * HS_DATA_SIZE_INT))
+    {
+        vmData->error = VM_ERROR_STACK_OVERFLOW;
+        return HS_FALSE;
+    }
+    vmData->dataStack.reversePointer -= HS_DATA_SIZE_INT;
+    StoreVarInt(vmData->dataStack.reversePointer, v0_i);
+    vmData->dataStack.reversePointer -= HS_DATA_SIZE_INT;
+    StoreVarInt(vmData->dataStack.reversePointer, v1_i);
+    vmData->dataStack.reversePointer -= HS_DATA_SIZE_INT;
+    StoreVarInt(vmData->dataStack.reversePointer, v2_i);
+    vmData->instructionStack.stackPointer = vmData->instructionStack.begin + 66;
+    return HS_FALSE;
+}
@@ -0,0 +1,106 @@
+// Translated from HsScript bytecode by TranslateToC (aot.h), do not edit.
+// Runs like VMRunVerified on a VM set up with the translated instructions.
+
+#include <math.h>
+#include <stddef.h>
+
+#include "bytecode_c.h"
+
+Bool8 RunFrames(SVMData* vmData)
+{
+    if (vmData->instructionStack.stackPointer != vmData->instructionStack.begin
+        || vmData->dataStack.base.stackPointer != vmData->dataStack.base.begin
+        || vmData->dataStack.reversePointer != vmData->dataStack.base.end)
+    {
+        return VMRunVerified(vmData);
+    }
+
+    hsbint s0_i = 0;
+    hsbint s1_i = 0;
+    hsbfloat s1_f = 0;
+    hsbint s2_i = 0;
+    hsbint s3_i = 0;
+    hsbfloat s3_f = 0;
+    hsbbool s3_b = 0;
+    hsbfloat s4_f = 0;
+    hsbint v0_i = 0;
+    hsbaddress v1_a = 0;
+    hsbaddress v2_p = 0;
+    hsbaddress framePointer = 0;
+
+    // INS_ALLOC_VAR_I
+    v0_i = 0;
+    // INS_LITERAL_I
+    s0_i = 5;
+    // INS_LITERAL_F
+    s1_f = 0x1.8p+0f;
+    // INS_CALL
+    v1_a = 12;
+    goto L29;
+L12:
+    // INS_SAVE_VAR_I
+    v0_i = s0_i;
+    // INS_LITERAL_I
+    s0_i = 2;
+    // INS_LITERAL_F
+    s1_f = -0x1p+0f;
+    // INS_CALL
+    v1_a = 25;
+    goto L29;
+L25:
+    // INS_LOAD_VAR_I
+    s1_i = v0_i;
+    // INS_ADD_I
+    s0_i = s0_i + s1_i;
+    // INS_END
+    if (vmData->dataStack.base.end - vmData->dataStack.base.begin < (ptrdiff_t)(2 * HS_DATA_SIZE_INT))
+    {
+        vmData->error = VM_ERROR_STACK_OVERFLOW;
+        return HS_FALSE;
+    }
+    PushInt(&vmData->dataStack.base.stackPointer, s0_i);
+    vmData->dataStack.reversePointer -= HS_DATA_SIZE_INT;
+    StoreVarInt(vmData->dataStack.reversePointer, v0_i);
+    vmData->framePointer = vmData->dataStack.base.begin + framePointer;
+    vmData->instructionStack.stackPointer = vmData->instructionStack.begin + 28;
+    return HS_FALSE;
+L29:
+    // INS_ENTER
+    v2_p = framePointer;
+    framePointer = 0;
+    s2_i = 0;
+    // INS_LOAD_FRAME_I
+    s3_i = s0_i;
+    // INS_SAVE_FRAME_I
+    s2_i = s3_i;
+    // INS_LITERAL_F
+    s3_f = 0x0p+0f;
+    // INS_LOAD_FRAME_F
+    s4_f = s1_f;
+    // INS_CMP_F_LESS
+    s3_b = s3_f < s4_f;
+    // INS_NEGATE_B
+    s3_b = 1 - s3_b;
+    // INS_COND_JUMP_B
+    if (s3_b != 0)
+        goto L56;
+    // INS_LOAD_FRAME_I
+    s3_i = s0_i;
+    // INS_MULTIPLY_LITERAL_I
+    s3_i = s3_i * 3;
+    // INS_SAVE_FRAME_I
+    s2_i = s3_i;
+L56:
+    // INS_LOAD_FRAME_I
+    s3_i = s2_i;
+    // INS_ADD_LITERAL_I
+    s3_i = s3_i + 1;
+    // INS_LEAVE_I
+    s0_i = s3_i;
+    framePointer = v2_p;
+    switch (v1_a)
+    {
+        case 12: goto L12;
+        default: goto L25;
+    }
+}
@@ -0,0 +1,91 @@
+// Translated from HsScript bytecode by TranslateToC (aot.h), do not edit.
+// Runs like VMRunVerified on a VM set up with the translated instructions.
+
+#include <math.h>
+#include <stddef.h>
+
+#include "bytecode_c.h"
+
+Bool8 RunNatives(SVMData* vmData)
+{
+    if (vmData->instructionStack.stackPointer != vmData->instructionStack.begin
+        || vmData->dataStack.base.stackPointer != vmData->dataStack.base.begin
+        || vmData->dataStack.reversePointer != vmData->dataStack.base.end)
+    {
+        return VMRunVerified(vmData);
+    }
+
+    hsbint s0_i = 0;
+    hsbfloat s0_f = 0;
+    hsbint s1_i = 0;
+    hsbfloat s1_f = 0;
+    hsbfloat s2_f = 0;
+    hsbfloat v0_f = 0;
+    hsbint v1_i = 0;
+
+    // INS_ALLOC_VAR_F
+    v0_f = 0.0f;
+    // INS_LITERAL_F
+    s0_f = 0x0p+0f;
+    // INS_SAVE_VAR_F
+    v0_f = s0_f;
+    // INS_ALLOC_VAR_I
+    v1_i = 0;
+    // INS_LITERAL_I
+    s0_i = 0;
+    // INS_SAVE_VAR_I
+    v1_i = s0_i;
+    // INS_JUMP
+    goto L55;
+L17:
+    // INS_LOAD_VAR_F
+    s0_f = v0_f;
+    // INS_LOAD_VAR_I
+    s1_i = v1_i;
+    // INS_LITERAL_F
+    s2_f = 0x1p-1f;
+    // INS_CALL_EXT
+    PushInt(&vmData->dataStack.base.stackPointer, s1_i);
+    PushFloat(&vmData->dataStack.base.stackPointer, s2_f);
+    vmData->functions.begin[0](vmData);
+    s1_f = PopFloat(&vmData->dataStack.base.stackPointer);
+    // INS_LITERAL_F
+    s2_f = 0x1p+1f;
+    // INS_MULTIPLY_F
+    s1_f = s1_f * s2_f;
+    // INS_ADD_F
+    s0_f = s0_f + s1_f;
+    // INS_SAVE_VAR_F
+    v0_f = s0_f;
+    // INS_LOAD_VAR_VAR_MULTIPLY_I
+    s0_i = v1_i * v1_i;
+    // INS_CALL_EXT
+    PushInt(&vmData->dataStack.base.stackPointer, s0_i);
+    vmData->functions.begin[1](vmData);
+    // INS_LOAD_VAR_I
+    s0_i = v1_i;
+    // INS_ADD_LITERAL_I
+    s0_i = s0_i + 1;
+    // INS_SAVE_VAR_I
+    v1_i = s0_i;
+L55:
+    // INS_LOAD_VAR_I
+    s0_i = v1_i;
+    // INS_LITERAL_I
+    s1_i = 10;
+    // INS_CMP_I_LESS_JUMP
+    if (s0_i < s1_i)
+        goto L17;
+    // INS_END
+    if (vmData->dataStack.base.end - vmData->dataStack.base.begin < (ptrdiff_t)(HS_DATA_SIZE_INT + HS_DATA_SIZE_FLOAT))
+    {
+        vmData->error = VM_ERROR_STACK_OVERFLOW;
+        return HS_FALSE;
+    }
+    vmData->dataStack.reversePointer -= HS_DATA_SIZE_FLOAT;
+    StoreVarFloat(vmData->dataStack.reversePointer, v0_f);
+    vmData->dataStack.reversePointer -= HS_DATA_SIZE_INT;
+    StoreVarInt(vmData->dataStack.reversePointer, v1_i);
+    vmData->instructionStack.stackPointer = vmData->instructionStack.begin + 63;
+    return HS_FALSE;
+}
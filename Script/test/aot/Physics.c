@@ -0,0 +1,157 @@
+// Translated from HsScript bytecode by TranslateToC (aot.h), do not edit.
+// Runs like VMRunVerified on a VM set up with the translated instructions.
+
+#include <math.h>
+#include <stddef.h>
+
+#include "bytecode_c.h"
+
+Bool8 RunPhysics(SVMData* vmData)
+{
+    if (vmData->instructionStack.stackPointer != vmData->instructionStack.begin
+        || vmData->dataStack.base.stackPointer != vmData->dataStack.base.begin
+        || vmData->dataStack.reversePointer != vmData->dataStack.base.end)
+    {
+        return VMRunVerified(vmData);
+    }
+
+    hsbint s0_i = 0;
+    hsbfloat s0_f = 0;
+    hsbbool s0_b = 0;
+    hsbint s1_i = 0;
+    hsbfloat s1_f = 0;
+    hsbfloat s2_f = 0;
+    hsbfloat v0_f = 0;
+    hsbfloat v1_f = 0;
+    hsbfloat v2_f = 0;
+    hsbint v3_i = 0;
+    hsbint v4_i = 0;
+
+    // INS_ALLOC_VAR_F
+    v0_f = 0.0f;
+    // INS_LITERAL_F
+    s0_f = 0x1.4p+3f;
+    // INS_SAVE_VAR_F
+    v0_f = s0_f;
+    // INS_ALLOC_VAR_F
+    v1_f = 0.0f;
+    // INS_LITERAL_F
+    s0_f = 0x0p+0f;
+    // INS_SAVE_VAR_F
+    v1_f = s0_f;
+    // INS_ALLOC_VAR_F
+    v2_f = 0.0f;
+    // INS_LITERAL_F
+    s0_f = 0x1.47ae14p-7f;
+    // INS_SAVE_VAR_F
+    v2_f = s0_f;
+    // INS_ALLOC_VAR_I
+    v3_i = 0;
+    // INS_LITERAL_I
+    s0_i = 0;
+    // INS_SAVE_VAR_I
+    v3_i = s0_i;
+    // INS_ALLOC_VAR_I
+    v4_i = 0;
+    // INS_LITERAL_I
+    s0_i = 0;
+    // INS_SAVE_VAR_I
+    v4_i = s0_i;
+    // INS_JUMP
+    goto L114;
+L39:
+    // INS_LOAD_VAR_F
+    s0_f = v1_f;
+    // INS_LITERAL_F
+    s1_f = 0x1.39eb86p+3f;
+    // INS_LOAD_VAR_F
+    s2_f = v2_f;
+    // INS_MULTIPLY_F
+    s1_f = s1_f * s2_f;
+    // INS_SUBSTRACT_F
+    s0_f = s0_f - s1_f;
+    // INS_SAVE_VAR_F
+    v1_f = s0_f;
+    // INS_LOAD_VAR_F
+    s0_f = v0_f;
+    // INS_LOAD_VAR_F
+    s1_f = v1_f;
+    // INS_LOAD_VAR_F
+    s2_f = v2_f;
+    // INS_MULTIPLY_F
+    s1_f = s1_f * s2_f;
+    // INS_ADD_F
+    s0_f = s0_f + s1_f;
+    // INS_SAVE_VAR_F
+    v0_f = s0_f;
+    // INS_LOAD_VAR_F
+    s0_f = v0_f;
+    // INS_LITERAL_F
+    s1_f = 0x0p+0f;
+    // INS_CMP_F_LESS
+    s0_b = s0_f < s1_f;
+    // INS_NEGATE_B
+    s0_b = 1 - s0_b;
+    // INS_COND_JUMP_B
+    if (s0_b != 0)
+        goto L107;
+    // INS_LITERAL_F
+    s0_f = 0x0p+0f;
+    // INS_LOAD_VAR_F
+    s1_f = v0_f;
+    // INS_SUBSTRACT_F
+    s0_f = s0_f - s1_f;
+    // INS_SAVE_VAR_F
+    v0_f = s0_f;
+    // INS_LITERAL_F
+    s0_f = 0x0p+0f;
+    // INS_LOAD_VAR_F
+    s1_f = v1_f;
+    // INS_LITERAL_F
+    s2_f = 0x1.ccccccp-1f;
+    // INS_MULTIPLY_F
+    s1_f = s1_f * s2_f;
+    // INS_SUBSTRACT_F
+    s0_f = s0_f - s1_f;
+    // INS_SAVE_VAR_F
+    v1_f = s0_f;
+    // INS_LOAD_VAR_I
+    s0_i = v3_i;
+    // INS_ADD_LITERAL_I
+    s0_i = s0_i + 1;
+    // INS_SAVE_VAR_I
+    v3_i = s0_i;
+L107:
+    // INS_LOAD_VAR_I
+    s0_i = v4_i;
+    // INS_ADD_LITERAL_I
+    s0_i = s0_i + 1;
+    // INS_SAVE_VAR_I
+    v4_i = s0_i;
+L114:
+    // INS_LOAD_VAR_I
+    s0_i = v4_i;
+    // INS_LITERAL_I
+    s1_i = 1000;
+    // INS_CMP_I_LESS_JUMP
+    if (s0_i < s1_i)
+        goto L39;
+    // INS_END
+    if (vmData->dataStack.base.end - vmData->dataStack.base.begin < (ptrdiff_t)(2 * HS_DATA_SIZE_INT + 3 * HS_DATA_SIZE_FLOAT))
+    {
+        vmData->error = VM_ERROR_STACK_OVERFLOW;
+        return HS_FALSE;
+    }
+    vmData->dataStack.reversePointer -= HS_DATA_SIZE_FLOAT;
+    StoreVarFloat(vmData->dataStack.reversePointer, v0_f);
+    vmData->dataStack.reversePointer -= HS_DATA_SIZE_FLOAT;
+    StoreVarFloat(vmData->dataStack.reversePointer, v1_f);
+    vmData->dataStack.reversePointer -= HS_DATA_SIZE_FLOAT;
+    StoreVarFloat(vmData->dataStack.reversePointer, v2_f);
+    vmData->dataStack.reversePointer -= HS_DATA_SIZE_INT;
+    StoreVarInt(vmData->dataStack.reversePointer, v3_i);
+    vmData->dataStack.reversePointer -= HS_DATA_SIZE_INT;
+    StoreVarInt(vmData->dataStack.reversePointer, v4_i);
+    vmData->instructionStack.stackPointer = vmData->instructionStack.begin + 122;
+    return HS_FALSE;
+}
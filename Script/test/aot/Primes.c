@@ -0,0 +1,128 @@
+// Translated from HsScript bytecode by TranslateToC (aot.h), do not edit.
+// Runs like VMRunVerified on a VM set up with the translated instructions.
+
+#include <math.h>
+#include <stddef.h>
+
+#include "bytecode_c.h"
+
+Bool8 RunPrimes(SVMData* vmData)
+{
+    if (vmData->instructionStack.stackPointer != vmData->instructionStack.begin
+        || vmData->dataStack.base.stackPointer != vmData->dataStack.base.begin
+        || vmData->dataStack.reversePointer != vmData->dataStack.base.end)
+    {
+        return VMRunVerified(vmData);
+    }
+
+    hsbint s0_i = 0;
+    hsbbool s0_b = 0;
+    hsbint s1_i = 0;
+    hsbint v0_i = 0;
+    hsbint v1_i = 0;
+    hsbint v2_i = 0;
+    hsbint v3_i = 0;
+
+    // INS_ALLOC_VAR_I
+    v0_i = 0;
+    // INS_LITERAL_I
+    s0_i = 0;
+    // INS_SAVE_VAR_I
+    v0_i = s0_i;
+    // INS_ALLOC_VAR_I
+    v1_i = 0;
+    // INS_LITERAL_I
+    s0_i = 2;
+    // INS_SAVE_VAR_I
+    v1_i = s0_i;
+    // INS_JUMP
+    goto L82;
+L15:
+    // INS_ALLOC_VAR_I
+    v2_i = 0;
+    // INS_LITERAL_I
+    s0_i = 1;
+    // INS_SAVE_VAR_I
+    v2_i = s0_i;
+    // INS_ALLOC_VAR_I
+    v3_i = 0;
+    // INS_LITERAL_I
+    s0_i = 2;
+    // INS_SAVE_VAR_I
+    v3_i = s0_i;
+    // INS_JUMP
+    goto L60;
+L30:
+    // INS_LOAD_VAR_I
+    s0_i = v1_i;
+    // INS_LOAD_VAR_I
+    s1_i = v3_i;
+    // INS_DIVIDE_I
+    s0_i = s0_i / s1_i;
+    // INS_LOAD_VAR_I
+    s1_i = v3_i;
+    // INS_MULTIPLY_I
+    s0_i = s0_i * s1_i;
+    // INS_LOAD_VAR_I
+    s1_i = v1_i;
+    // INS_CMP_I_EQ
+    s0_b = s0_i == s1_i;
+    // INS_NEGATE_B
+    s0_b = 1 - s0_b;
+    // INS_COND_JUMP_B
+    if (s0_b != 0)
+        goto L53;
+    // INS_LITERAL_I
+    s0_i = 0;
+    // INS_SAVE_VAR_I
+    v2_i = s0_i;
+    // INS_MOVE_VAR_I
+    v3_i = v1_i;
+L53:
+    // INS_LOAD_VAR_I
+    s0_i = v3_i;
+    // INS_ADD_LITERAL_I
+    s0_i = s0_i + 1;
+    // INS_SAVE_VAR_I
+    v3_i = s0_i;
+L60:
+    // INS_LOAD_VAR_VAR_MULTIPLY_I
+    s0_i = v3_i * v3_i;
+    // INS_LOAD_VAR_I
+    s1_i = v1_i;
+    // INS_CMP_I_LESS_EQ_JUMP
+    if (s0_i <= s1_i)
+        goto L30;
+    // INS_LOAD_VAR_VAR_ADD_I
+    s0_i = v0_i + v2_i;
+    // INS_SAVE_VAR_I
+    v0_i = s0_i;
+    // INS_LOAD_VAR_I
+    s0_i = v1_i;
+    // INS_ADD_LITERAL_I
+    s0_i = s0_i + 1;
+    // INS_SAVE_VAR_I
+    v1_i = s0_i;
+    // INS_DEALLOC_VAR_I
+    // INS_DEALLOC_VAR_I
+L82:
+    // INS_LOAD_VAR_I
+    s0_i = v1_i;
+    // INS_LITERAL_I
+    s1_i = 300;
+    // INS_CMP_I_LESS_JUMP
+    if (s0_i < s1_i)
+        goto L15;
+    // INS_END
+    if (vmData->dataStack.base.end - vmData->dataStack.base.begin < (ptrdiff_t)(2 * HS_DATA_SIZE_INT))
+    {
+        vmData->error = VM_ERROR_STACK_OVERFLOW;
+        return HS_FALSE;
+    }
+    vmData->dataStack.reversePointer -= HS_DATA_SIZE_INT;
+    StoreVarInt(vmData->dataStack.reversePointer, v0_i);
+    vmData->dataStack.reversePointer -= HS_DATA_SIZE_INT;
+    StoreVarInt(vmData->dataStack.reversePointer, v1_i);
+    vmData->instructionStack.stackPointer = vmData->instructionStack.begin + 90;
+    return HS_FALSE;
+}
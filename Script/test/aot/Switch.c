@@ -0,0 +1,189 @@
+// Translated from HsScript bytecode by TranslateToC (aot.h), do not edit.
+// Runs like VMRunVerified on a VM set up with the translated instructions.
+
+#include <math.h>
+#include <stddef.h>
+
+#include "bytecode_c.h"
+
+Bool8 RunSwitch(SVMData* vmData)
+{
+    if (vmData->instructionStack.stackPointer != vmData->instructionStack.begin
+        || vmData->dataStack.base.stackPointer != vmData->dataStack.base.begin
+        || vmData->dataStack.reversePointer != vmData->dataStack.base.end)
+    {
+        return VMRunVerified(vmData);
+    }
+
+    hsbint s0_i = 0;
+    hsbint s1_i = 0;
+    hsbint v0_i = 0;
+    hsbint v1_i = 0;
+    hsbint v2_i = 0;
+    hsbint v3_i = 0;
+
+    // INS_ALLOC_VAR_I
+    v0_i = 0;
+    // INS_LITERAL_I
+    s0_i = 0;
+    // INS_SAVE_VAR_I
+    v0_i = s0_i;
+    // INS_ALLOC_VAR_I
+    v1_i = 0;
+    // INS_LITERAL_I
+    s0_i = 0;
+    // INS_SAVE_VAR_I
+    v1_i = s0_i;
+    // INS_ALLOC_VAR_I
+    v2_i = 0;
+    // INS_LITERAL_I
+    s0_i = -2;
+    // INS_SAVE_VAR_I
+    v2_i = s0_i;
+    // INS_JUMP
+    goto L151;
+L21:
+    // INS_LOAD_VAR_I
+    s0_i = v2_i;
+    // INS_SWITCH
+    switch (s0_i)
+    {
+        case 0: goto L48;
+        case 1: goto L48;
+        case 2: goto L58;
+        case 3: goto L80;
+        case 4: goto L66;
+        case 5: goto L72;
+        default: goto L80;
+    }
+    // INS_JUMP
+    goto L80;
+    // INS_JUMP
+    goto L48;
+    // INS_JUMP
+    goto L48;
+    // INS_JUMP
+    goto L58;
+    // INS_JUMP
+    goto L80;
+    // INS_JUMP
+    goto L66;
+    // INS_JUMP
+    goto L72;
+L48:
+    // INS_LOAD_VAR_I
+    s0_i = v0_i;
+    // INS_ADD_LITERAL_I
+    s0_i = s0_i + 1;
+    // INS_SAVE_VAR_I
+    v0_i = s0_i;
+    // INS_JUMP
+    goto L85;
+L58:
+    // INS_LOAD_VAR_VAR_ADD_I
+    s0_i = v1_i + v0_i;
+    // INS_SAVE_VAR_I
+    v1_i = s0_i;
+    // INS_JUMP
+    goto L85;
+L66:
+    // INS_MOVE_VAR_I
+    v0_i = v1_i;
+    // INS_JUMP
+    goto L85;
+L72:
+    // INS_LITERAL_I
+    s0_i = 0;
+    // INS_SAVE_VAR_I
+    v1_i = s0_i;
+    // INS_JUMP
+    goto L85;
+L80:
+    // INS_LOAD_VAR_VAR_ADD_I
+    s0_i = v0_i + v2_i;
+    // INS_SAVE_VAR_I
+    v0_i = s0_i;
+L85:
+    // INS_ALLOC_VAR_I
+    v3_i = 0;
+    // INS_LOAD_VAR_I
+    s0_i = v2_i;
+    // INS_MULTIPLY_LITERAL_I
+    s0_i = s0_i * 7;
+    // INS_SAVE_VAR_I
+    v3_i = s0_i;
+    // INS_LOAD_VAR_I
+    s0_i = v3_i;
+    // INS_LITERAL_I
+    s1_i = -7;
+    // INS_CMP_I_EQ_JUMP
+    if (s0_i == s1_i)
+        goto L130;
+    // INS_LOAD_VAR_I
+    s0_i = v3_i;
+    // INS_LITERAL_I
+    s1_i = 14;
+    // INS_CMP_I_EQ_JUMP
+    if (s0_i == s1_i)
+        goto L120;
+    // INS_LOAD_VAR_I
+    s0_i = v3_i;
+    // INS_LITERAL_I
+    s1_i = 700;
+    // INS_CMP_I_EQ_JUMP
+    if (s0_i == s1_i)
+        goto L138;
+    // INS_JUMP
+    goto L143;
+L120:
+    // INS_LOAD_VAR_I
+    s0_i = v1_i;
+    // INS_ADD_LITERAL_I
+    s0_i = s0_i + 1;
+    // INS_SAVE_VAR_I
+    v1_i = s0_i;
+    // INS_JUMP
+    goto L143;
+L130:
+    // INS_LITERAL_I
+    s0_i = 1;
+    // INS_SAVE_VAR_I
+    v1_i = s0_i;
+    // INS_JUMP
+    goto L143;
+L138:
+    // INS_LITERAL_I
+    s0_i = 0;
+    // INS_SAVE_VAR_I
+    v0_i = s0_i;
+L143:
+    // INS_DEALLOC_VAR_I
+    // INS_LOAD_VAR_I
+    s0_i = v2_i;
+    // INS_ADD_LITERAL_I
+    s0_i = s0_i + 1;
+    // INS_SAVE_VAR_I
+    v2_i = s0_i;
+L151:
+    // INS_LOAD_VAR_I
+    s0_i = v2_i;
+    // INS_LITERAL_I
+    s1_i = 8;
+    // INS_CMP_I_LESS_JUMP
+    if (s0_i < s1_i)
+        goto L21;
+    // INS_END
+    if (vmData->dataStack.base.end - vmData->dataStack.base.begin < (ptrdiff_t)(3 * HS_DATA_SIZE_INT))
+    {
+        vmData->error = VM_ERROR_STACK_OVERFLOW;
+        return HS_FALSE;
+    }
+    vmData->dataStack.reversePointer -= HS_DATA_SIZE_INT;
+    StoreVarInt(vmData->dataStack.reversePointer, v0_i);
+    vmData->dataStack.reversePointer -= HS_DATA_SIZE_INT;
+    StoreVarInt(vmData->dataStack.reversePointer, v1_i);
+    vmData->dataStack.reversePointer -= HS_DATA_SIZE_INT;
+    StoreVarInt(vmData->dataStack.reversePointer, v2_i);
+    vmData->instructionStack.stackPointer = vmData->instructionStack.begin + 159;
+    return HS_FALSE;
+}
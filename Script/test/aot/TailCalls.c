@@ -0,0 +1,117 @@
+// Translated from HsScript bytecode by TranslateToC (aot.h), do not edit.
+// Runs like VMRunVerified on a VM set up with the translated instructions.
+
+#include <math.h>
+#include <stddef.h>
+
+#include "bytecode_c.h"
+
+Bool8 RunTailCalls(SVMData* vmData)
+{
+    if (vmData->instructionStack.stackPointer != vmData->instructionStack.begin
+        || vmData->dataStack.base.stackPointer != vmData->dataStack.base.begin
+        || vmData->dataStack.reversePointer != vmData->dataStack.base.end)
+    {
+        return VMRunVerified(vmData);
+    }
+
+    hsbint s0_i = 0;
+    hsbint s1_i = 0;
+    hsbint s2_i = 0;
+    hsbbool s2_b = 0;
+    hsbint s3_i = 0;
+    hsbint s4_i = 0;
+    hsbint v0_i = 0;
+    hsbaddress v1_a = 0;
+    hsbaddress v2_p = 0;
+    hsbaddress framePointer = 0;
+
+    // INS_ALLOC_VAR_I
+    v0_i = 0;
+    // INS_LITERAL_I
+    s0_i = 10;
+    // INS_CALL
+    v1_a = 7;
+    goto L52;
+L7:
+    // INS_SAVE_VAR_I
+    v0_i = s0_i;
+    // INS_LITERAL_I
+    s0_i = 3;
+    // INS_LITERAL_I
+    s1_i = 0;
+    // INS_CALL
+    v1_a = 18;
+    goto L22;
+L18:
+    // INS_LOAD_VAR_I
+    s1_i = v0_i;
+    // INS_ADD_I
+    s0_i = s0_i + s1_i;
+    // INS_END
+    if (vmData->dataStack.base.end - vmData->dataStack.base.begin < (ptrdiff_t)(2 * HS_DATA_SIZE_INT))
+    {
+        vmData->error = VM_ERROR_STACK_OVERFLOW;
+        return HS_FALSE;
+    }
+    PushInt(&vmData->dataStack.base.stackPointer, s0_i);
+    vmData->dataStack.reversePointer -= HS_DATA_SIZE_INT;
+    StoreVarInt(vmData->dataStack.reversePointer, v0_i);
+    vmData->framePointer = vmData->dataStack.base.begin + framePointer;
+    vmData->instructionStack.stackPointer = vmData->instructionStack.begin + 21;
+    return HS_FALSE;
+L22:
+    // INS_ENTER
+    v2_p = framePointer;
+    framePointer = 0;
+    // INS_LOAD_FRAME_I
+    s2_i = s0_i;
+    // INS_LITERAL_I
+    s3_i = 0;
+    // INS_CMP_I_EQ
+    s2_b = s2_i == s3_i;
+    // INS_COND_JUMP_B
+    if (s2_b != 0)
+        goto L49;
+    // INS_LOAD_FRAME_I
+    s2_i = s0_i;
+    // INS_ADD_LITERAL_I
+    s2_i = s2_i + -1;
+    // INS_LOAD_FRAME_I
+    s3_i = s1_i;
+    // INS_LOAD_FRAME_I
+    s4_i = s0_i;
+    // INS_ADD_I
+    s3_i = s3_i + s4_i;
+    // INS_TAIL_CALL
+    s0_i = s2_i;
+    s1_i = s3_i;
+    framePointer = v2_p;
+    goto L22;
+L49:
+    // INS_LOAD_FRAME_I
+    s2_i = s1_i;
+    // INS_LEAVE_I
+    s0_i = s2_i;
+    framePointer = v2_p;
+    switch (v1_a)
+    {
+        case 7: goto L7;
+        default: goto L18;
+    }
+L52:
+    // INS_ENTER
+    v2_p = framePointer;
+    framePointer = 0;
+    // INS_LOAD_FRAME_I
+    s1_i = s0_i;
+    // INS_ADD_LITERAL_I
+    s1_i = s1_i + 1;
+    // INS_LITERAL_I
+    s2_i = 0;
+    // INS_TAIL_CALL
+    s0_i = s1_i;
+    s1_i = s2_i;
+    framePointer = v2_p;
+    goto L22;
+}
@@ -0,0 +1,101 @@
+// Translated from HsScript bytecode by TranslateToC (aot.h), do not edit.
+// Runs like VMRunVerified on a VM set up with the translated instructions.
+
+#include <math.h>
+#include <stddef.h>
+
+#include "bytecode_c.h"
+
+Bool8 RunYield(SVMData* vmData)
+{
+    if (vmData->instructionStack.stackPointer != vmData->instructionStack.begin
+        || vmData->dataStack.base.stackPointer != vmData->dataStack.base.begin
+        || vmData->dataStack.reversePointer != vmData->dataStack.base.end)
+    {
+        return VMRunVerified(vmData);
+    }
+
+    hsbint s0_i = 0;
+    hsbfloat s0_f = 0;
+    hsbint s1_i = 0;
+    hsbfloat s1_f = 0;
+    hsbint v0_i = 0;
+    hsbfloat v1_f = 0;
+    hsbint v2_i = 0;
+
+    // INS_ALLOC_VAR_I
+    v0_i = 0;
+    // INS_LITERAL_I
+    s0_i = 0;
+    // INS_SAVE_VAR_I
+    v0_i = s0_i;
+    // INS_ALLOC_VAR_F
+    v1_f = 0.0f;
+    // INS_LITERAL_F
+    s0_f = 0x1p+0f;
+    // INS_SAVE_VAR_F
+    v1_f = s0_f;
+    // INS_ALLOC_VAR_I
+    v2_i = 0;
+    // INS_LITERAL_I
+    s0_i = 0;
+    // INS_SAVE_VAR_I
+    v2_i = s0_i;
+    // INS_JUMP
+    goto L46;
+L23:
+    // INS_LOAD_VAR_VAR_ADD_I
+    s0_i = v0_i + v2_i;
+    // INS_SAVE_VAR_I
+    v0_i = s0_i;
+    // INS_YIELD
+    if (vmData->dataStack.base.end - vmData->dataStack.base.begin < (ptrdiff_t)(2 * HS_DATA_SIZE_INT + HS_DATA_SIZE_FLOAT))
+    {
+        vmData->error = VM_ERROR_STACK_OVERFLOW;
+        return HS_FALSE;
+    }
+    vmData->dataStack.reversePointer -= HS_DATA_SIZE_INT;
+    StoreVarInt(vmData->dataStack.reversePointer, v0_i);
+    vmData->dataStack.reversePointer -= HS_DATA_SIZE_FLOAT;
+    StoreVarFloat(vmData->dataStack.reversePointer, v1_f);
+    vmData->dataStack.reversePointer -= HS_DATA_SIZE_INT;
+    StoreVarInt(vmData->dataStack.reversePointer, v2_i);
+    vmData->instructionStack.stackPointer = vmData->instructionStack.begin + 29;
+    return HS_TRUE;
+    // INS_LOAD_VAR_F
+    s0_f = v1_f;
+    // INS_LITERAL_F
+    s1_f = 0x1.8p+0f;
+    // INS_MULTIPLY_F
+    s0_f = s0_f * s1_f;
+    // INS_SAVE_VAR_F
+    v1_f = s0_f;
+    // INS_LOAD_VAR_I
+    s0_i = v2_i;
+    // INS_ADD_LITERAL_I
+    s0_i = s0_i + 1;
+    // INS_SAVE_VAR_I
+    v2_i = s0_i;
+L46:
+    // INS_LOAD_VAR_I
+    s0_i = v2_i;
+    // INS_LITERAL_I
+    s1_i = 5;
+    // INS_CMP_I_LESS_JUMP
+    if (s0_i < s1_i)
+        goto L23;
+    // INS_END
+    if (vmData->dataStack.base.end - vmData->dataStack.base.begin < (ptrdiff_t)(2 * HS_DATA_SIZE_INT + HS_DATA_SIZE_FLOAT))
+    {
+        vmData->error = VM_ERROR_STACK_OVERFLOW;
+        return HS_FALSE;
+    }
+    vmData->dataStack.reversePointer -= HS_DATA_SIZE_INT;
+    StoreVarInt(vmData->dataStack.reversePointer, v0_i);
+    vmData->dataStack.reversePointer -= HS_DATA_SIZE_FLOAT;
+    StoreVarFloat(vmData->dataStack.reversePointer, v1_f);
+    vmData->dataStack.reversePointer -= HS_DATA_SIZE_INT;
+    StoreVarInt(vmData->dataStack.reversePointer, v2_i);
+    vmData->instructionStack.stackPointer = vmData->instructionStack.begin + 54;
+    return HS_FALSE;
+}
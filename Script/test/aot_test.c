@@ -0,0 +1,528 @@
+#include <stdio.h>
+
+#include "aot.h"
+#include "async.h"
+#include "bytecode_c.h"
+#include "bytecode_info.h"
+#include "compiler.h"
+#include "file.h"
+#include "optimizer.h"
+
+// The translations of the corpus are checked in next to the test and compiled into it.
+// Each one has to match what TranslateToC generates now and leave the same data stack
+// behind as VMRunVerified. After a change to the translation run the test from Data/
+// with -update to rewrite them.
+
+#include "aot/Async.c"
+#include "aot/Calls.c"
+#include "aot/Fibonacci.c"
+#include "aot/Frames.c"
+#include "aot/Natives.c"
+#include "aot/Physics.c"
+#include "aot/Primes.c"
+#include "aot/Sum.c"
+#include "aot/Switch.c"
+#include "aot/TailCalls.c"
+#include "aot/Yield.c"
+#include "test_util.h"
+
+static const int DATA_SIZE = 1024;
+
+typedef Bool8 (RunFunction)(SVMData* vmData);
+
+typedef struct
+{
+    const char* script; // NULL for the handwritten programs
+    SStackData (*program)();
+    const char* name;
+    const char* translation;
+    RunFunction* run;
+} STranslatedScript;
+
+static hsbint s_traced;
+
+// float(int, float)
+static void NativeScale(SVMData* vmData)
+{
+    hsbfloat scale = PopFloat(&vmData->dataStack.base.stackPointer);
+    hsbint value = PopInt(&vmData->dataStack.base.stackPointer);
+    PushFloat(&vmData->dataStack.base.stackPointer, value * scale);
+}
+
+// void(int)
+static void NativeTrace(SVMData* vmData)
+{
+    s_traced += PopInt(&vmData->dataStack.base.stackPointer);
+}
+
+// int(int), async: odd arguments wait with themselves as the token, CompleteWaitingCall
+// completes them
+static void NativeFetch(SVMData* vmData)
+{
+    hsbint key = PopInt(&vmData->dataStack.base.stackPointer);
+    if (key % 2 == 0)
+        PushInt(&vmData->dataStack.base.stackPointer, key * 3);
+    else
+        vmData->asyncCall = (int)key;
+}
+
+static NativeFP* s_natives[] = { NativeScale, NativeTrace, NativeFetch };
+
+static void CompleteWaitingCall(SVMData* vmData)
+{
+    if (vmData->asyncCall != HS_NO_ASYNC_CALL)
+        CompleteAsyncCall(vmData, (SScriptValue){ .i = vmData->asyncCall * 5 });
+}
+
+// A function called twice, which the language cannot express yet
+static SStackData CallsProgram()
+{
+    const int function = 20;
+
+    SStackData s = CreateStack(100);
+    AddInstruction(&s, INS_ALLOC_VAR_I);
+    AddInt(&s, INS_LITERAL_I, 5);
+    AddOffset(&s, INS_SAVE_VAR_I, 0);
+    AddJump(&s, INS_CALL, function);
+    AddJump(&s, INS_CALL, function);
+    AddInstruction(&s, INS_LITERAL_F);
+    StoreFloatFwd(&s.stackPointer, 1.5f);
+    AddInstruction(&s, INS_LITERAL_B);
+    StoreBoolFwd(&s.stackPointer, HS_TRUE);
+    AddInstruction(&s, INS_END);
+
+    // the variable is below the return address
+    AddOffset(&s, INS_LOAD_VAR_I, HS_DATA_SIZE_ADDRESS);
+    AddInt(&s, INS_MULTIPLY_LITERAL_I, 3);
+    AddOffset(&s, INS_SAVE_VAR_I, HS_DATA_SIZE_ADDRESS);
+    AddInstruction(&s, INS_RETURN);
+    return Finish(s);
+}
+
+// f(5, 1.5) + f(2, -1) with f(int a, float b) { int local = a; if (0 < b) local = a * 3; return local + 1; }
+static SStackData FramesProgram()
+{
+    SStackData s = CreateStack(100);
+    AddInstruction(&s, INS_ALLOC_VAR_I);
+    AddInt(&s, INS_LITERAL_I, 5);
+    AddInstruction(&s, INS_LITERAL_F);
+    StoreFloatFwd(&s.stackPointer, 1.5f);
+    hsbaddress firstCall = Here(&s);
+    AddJump(&s, INS_CALL, 0);
+    AddOffset(&s, INS_SAVE_VAR_I, 0);
+    AddInt(&s, INS_LITERAL_I, 2);
+    AddInstruction(&s, INS_LITERAL_F);
+    StoreFloatFwd(&s.stackPointer, -1.0f);
+    hsbaddress secondCall = Here(&s);
+    AddJump(&s, INS_CALL, 0);
+    AddOffset(&s, INS_LOAD_VAR_I, 0);
+    AddInstruction(&s, INS_ADD_I);
+    AddInstruction(&s, INS_END);
+
+    const int local = HS_DATA_SIZE_INT + HS_DATA_SIZE_FLOAT;
+    hsbaddress function = Here(&s);
+    StoreAddress(s.begin + firstCall + 1, function);
+    StoreAddress(s.begin + secondCall + 1, function);
+    AddEnter(&s, HS_DATA_SIZE_INT + HS_DATA_SIZE_FLOAT, 1, 0);
+    AddOffset(&s, INS_LOAD_FRAME_I, 0);
+    AddOffset(&s, INS_SAVE_FRAME_I, local);
+    AddInstruction(&s, INS_LITERAL_F);
+    StoreFloatFwd(&s.stackPointer, 0.0f);
+    AddOffset(&s, INS_LOAD_FRAME_F, HS_DATA_SIZE_INT);
+    AddInstruction(&s, INS_CMP_F_LESS);
+    AddInstruction(&s, INS_NEGATE_B);
+    hsbaddress skip = Here(&s);
+    AddJump(&s, INS_COND_JUMP_B, 0);
+    AddOffset(&s, INS_LOAD_FRAME_I, 0);
+    AddInt(&s, INS_MULTIPLY_LITERAL_I, 3);
+    AddOffset(&s, INS_SAVE_FRAME_I, local);
+    StoreAddress(s.begin + skip + 1, Here(&s));
+    AddOffset(&s, INS_LOAD_FRAME_I, local);
+    AddInt(&s, INS_ADD_LITERAL_I, 1);
+    AddInstruction(&s, INS_LEAVE_I);
+    return Finish(s);
+}
+
+// f(10) + sum(3, 0) with f(int n) { return sum(n + 1, 0); } and
+// sum(int n, int acc) { if (n == 0) return acc; return sum(n - 1, acc + n); }, both tail calls
+// eliminated so sum returns to the callers of f as well
+static SStackData TailCallsProgram()
+{
+    SStackData s = CreateStack(100);
+    AddInstruction(&s, INS_ALLOC_VAR_I);
+    AddInt(&s, INS_LITERAL_I, 10);
+    hsbaddress callF = Here(&s);
+    AddJump(&s, INS_CALL, 0);
+    AddOffset(&s, INS_SAVE_VAR_I, 0);
+    AddInt(&s, INS_LITERAL_I, 3);
+    AddInt(&s, INS_LITERAL_I, 0);
+    hsbaddress callSum = Here(&s);
+    AddJump(&s, INS_CALL, 0);
+    AddOffset(&s, INS_LOAD_VAR_I, 0);
+    AddInstruction(&s, INS_ADD_I);
+    AddInstruction(&s, INS_END);
+
+    hsbaddress sum = Here(&s);
+    StoreAddress(s.begin + callSum + 1, sum);
+    AddEnter(&s, 2 * HS_DATA_SIZE_INT, 0, 0);
+    AddOffset(&s, INS_LOAD_FRAME_I, 0);
+    AddInt(&s, INS_LITERAL_I, 0);
+    AddInstruction(&s, INS_CMP_I_EQ);
+    hsbaddress done = Here(&s);
+    AddJump(&s, INS_COND_JUMP_B, 0);
+    AddOffset(&s, INS_LOAD_FRAME_I, 0);
+    AddInt(&s, INS_ADD_LITERAL_I, -1);
+    AddOffset(&s, INS_LOAD_FRAME_I, HS_DATA_SIZE_INT);
+    AddOffset(&s, INS_LOAD_FRAME_I, 0);
+    AddInstruction(&s, INS_ADD_I);
+    AddJump(&s, INS_CALL, sum);
+    AddInstruction(&s, INS_LEAVE_I);
+    StoreAddress(s.begin + done + 1, Here(&s));
+    AddOffset(&s, INS_LOAD_FRAME_I, HS_DATA_SIZE_INT);
+    AddInstruction(&s, INS_LEAVE_I);
+
+    StoreAddress(s.begin + callF + 1, Here(&s));
+    AddEnter(&s, HS_DATA_SIZE_INT, 0, 0);
+    AddOffset(&s, INS_LOAD_FRAME_I, 0);
+    AddInt(&s, INS_ADD_LITERAL_I, 1);
+    AddInt(&s, INS_LITERAL_I, 0);
+    AddJump(&s, INS_CALL, sum);
+    AddInstruction(&s, INS_LEAVE_I);
+
+    SStackData instructions = Finish(s);
+    EliminateTailCalls(&instructions);
+    return instructions;
+}
+
+// A dense switch goes through INS_SWITCH, the sparse one through compares
+static SStackData SwitchProgram()
+{
+    char code[] =
+        "var a: int = 0; var b: int = 0; var i: int = -2;"
+        "while (i < 8) { switch (i) { case 0: case 1: a = a + 1; case 2: b = b + a; case 4: a = b; case 5: b = 0; default: a = a + i; }"
+        "switch (i * 7) { case 14: b = b + 1; case -7: b = 1; case 700: a = 0; } i = i + 1; }";
+
+    SStackData instructions;
+    CompileSource(code, strlen(code), &instructions);
+    FuseSuperinstructions(&instructions);
+    return instructions;
+}
+
+// Calls of natives with their operands in locals, the results are read into them
+static SStackData NativesProgram()
+{
+    char code[] =
+        "var x: float = 0.0; var i: int = 0;"
+        "while (i < 10) { x = x + scale(i, 0.5) * 2.0; trace(i * i); i = i + 1; }";
+
+    SNativeTable natives;
+    InitNativeTable(&natives);
+    RegisterNative(&natives, "scale", "float(int, float)", NativeScale);
+    RegisterNative(&natives, "trace", "void(int)", NativeTrace);
+
+    SStackData instructions;
+    CompileSourceWithNatives(code, strlen(code), &natives, &instructions);
+    FuseSuperinstructions(&instructions);
+    DeleteNativeTable(&natives);
+    return instructions;
+}
+
+// Yields in a loop with operands and variables in locals
+static SStackData YieldProgram()
+{
+    char code[] =
+        "var a: int = 0; var f: float = 1.0; var i: int = 0;"
+        "while (i < 5) { a = a + i; yield; f = f * 1.5; i = i + 1; }";
+
+    SStackData instructions;
+    CompileSource(code, strlen(code), &instructions);
+    FuseSuperinstructions(&instructions);
+    return instructions;
+}
+
+// An async native with an operand below its arguments, half of the calls wait
+static SStackData AsyncProgram()
+{
+    char code[] =
+        "var x: int = 0; var i: int = 0;"
+        "while (i < 6) { x = x + fetch(i) * 2; i = i + 1; }";
+
+    SNativeTable natives;
+    InitNativeTable(&natives);
+    RegisterNative(&natives, "scale", "float(int, float)", NativeScale);
+    RegisterNative(&natives, "trace", "void(int)", NativeTrace);
+    RegisterAsyncNative(&natives, "fetch", "int(int)", NativeFetch);
+
+    SStackData instructions;
+    CompileSourceWithNatives(code, strlen(code), &natives, &instructions);
+    FuseSuperinstructions(&instructions);
+    DeleteNativeTable(&natives);
+    return instructions;
+}
+
+static const STranslatedScript SCRIPTS[] =
+{
+    { NULL, AsyncProgram, "RunAsync", "../Script/test/aot/Async.c", RunAsync },
+    { NULL, CallsProgram, "RunCalls", "../Script/test/aot/Calls.c", RunCalls },
+    { "Fibonacci.hss", NULL, "RunFibonacci", "../Script/test/aot/Fibonacci.c", RunFibonacci },
+    { NULL, FramesProgram, "RunFrames", "../Script/test/aot/Frames.c", RunFrames },
+    { NULL, NativesProgram, "RunNatives", "../Script/test/aot/Natives.c", RunNatives },
+    { "Physics.hss", NULL, "RunPhysics", "../Script/test/aot/Physics.c", RunPhysics },
+    { "Primes.hss", NULL, "RunPrimes", "../Script/test/aot/Primes.c", RunPrimes },
+    { "Sum.hss", NULL, "RunSum", "../Script/test/aot/Sum.c", RunSum },
+    { NULL, SwitchProgram, "RunSwitch", "../Script/test/aot/Switch.c", RunSwitch },
+    { NULL, TailCallsProgram, "RunTailCalls", "../Script/test/aot/TailCalls.c", RunTailCalls },
+    { NULL, YieldProgram, "RunYield", "../Script/test/aot/Yield.c", RunYield },
+};
+
+static const int NUM_SCRIPTS = sizeof(SCRIPTS) / sizeof(SCRIPTS[0]);
+
+static Bool8 CompileScript(const STranslatedScript* script, SStackData* outInstructions)
+{
+    if (!script->script)
+    {
+        *outInstructions = script->program();
+        return HS_TRUE;
+    }
+
+    char* code;
+    int size;
+    if (!ReadFile(script->script, &code, &size))
+        return HS_FALSE;
+
+    Bool8 result = CompileSource(code, size, outInstructions) == R_OK && FuseSuperinstructions(outInstructions) == R_OK;
+    free(code);
+    return result;
+}
+
+// The translation as a zero terminated string
+static char* Translate(SStackData instructions, const char* name)
+{
+    FILE* file = tmpfile();
+    if (!file)
+        return NULL;
+
+    char* text = NULL;
+    if (TranslateToC(instructions, name, file) == R_OK)
+    {
+        long size = ftell(file);
+        rewind(file);
+        text = malloc(size + 1);
+        text[fread(text, 1, size, file)] = 0;
+    }
+
+    fclose(file);
+    return text;
+}
+
+static Bool8 IsSameVM(const SVMData* a, const SVMData* b)
+{
+    int operandSize = a->dataStack.base.stackPointer - a->dataStack.base.begin;
+    int varSize = a->dataStack.base.end - a->dataStack.reversePointer;
+    return b->dataStack.base.stackPointer - b->dataStack.base.begin == operandSize
+        && b->dataStack.base.end - b->dataStack.reversePointer == varSize
+        && memcmp(a->dataStack.base.begin, b->dataStack.base.begin, operandSize) == 0
+        && memcmp(a->dataStack.reversePointer, b->dataStack.reversePointer, varSize) == 0
+        && a->instructionStack.stackPointer - a->instructionStack.begin
+            == b->instructionStack.stackPointer - b->instructionStack.begin
+        && a->error == b->error;
+}
+
+// Runs the first count instructions in the checked interpreter and the rest with run, which
+// is called again after each yield and completed async call like VMRunVerified
+static Bool8 IsSameAsInterpreter(const STranslatedScript* script, int count)
+{
+    SStackData instructions;
+    if (!CompileScript(script, &instructions))
+        return HS_FALSE;
+
+    SVMData interpreted;
+    SVMData translated;
+    FuncArray funcArray = { sizeof(s_natives) / sizeof(s_natives[0]), s_natives };
+    InitVM(&interpreted, instructions, DATA_SIZE, funcArray);
+    InitVM(&translated, instructions, DATA_SIZE, funcArray);
+
+    s_traced = 0;
+    while (VMRunVerified(&interpreted))
+        CompleteWaitingCall(&interpreted);
+    hsbint traced = s_traced;
+    s_traced = 0;
+    if (count > 0 && VMProcessInstructions(&translated, count))
+        CompleteWaitingCall(&translated);
+    while (script->run(&translated))
+        CompleteWaitingCall(&translated);
+
+    Bool8 result = IsSameVM(&interpreted, &translated)
+        && *translated.instructionStack.stackPointer == INS_END
+        && s_traced == traced;
+
+    DeleteVM(&interpreted, HS_TRUE, HS_TRUE);
+    DeleteVM(&translated, HS_TRUE, HS_TRUE);
+    DeleteStack(instructions);
+    return result;
+}
+
+int TestTranslationsUpToDate()
+{
+    Bool8 testResult = HS_TRUE;
+    for (int i = 0; i < NUM_SCRIPTS; ++i)
+    {
+        SStackData instructions;
+        char* expected;
+        int size;
+        if (!CompileScript(&SCRIPTS[i], &instructions) || !ReadFile(SCRIPTS[i].translation, &expected, &size))
+            return Report("TestTranslationsUpToDate", HS_FALSE);
+
+        char* text = Translate(instructions, SCRIPTS[i].name);
+        if (!text || strcmp(text, expected) != 0)
+        {
+            printf("%s is out of date\n", SCRIPTS[i].translation);
+            testResult = HS_FALSE;
+        }
+
+        free(text);
+        free(expected);
+        DeleteStack(instructions);
+    }
+
+    return Report("TestTranslationsUpToDate", testResult);
+}
+
+int TestSameAsInterpreter()
+{
+    Bool8 testResult = HS_TRUE;
+    for (int i = 0; i < NUM_SCRIPTS; ++i)
+    {
+        if (!IsSameAsInterpreter(&SCRIPTS[i], 0))
+        {
+            printf("%s differs\n", SCRIPTS[i].name);
+            testResult = HS_FALSE;
+        }
+    }
+
+    return Report("TestSameAsInterpreter", testResult);
+}
+
+// Started in the middle of the program the translation falls back to the interpreter
+int TestResume()
+{
+    Bool8 testResult = HS_TRUE;
+    for (int i = 0; i < NUM_SCRIPTS; ++i)
+        testResult &= IsSameAsInterpreter(&SCRIPTS[i], 10);
+
+    return Report("TestResume", testResult);
+}
+
+// The translation leaves the VM at the first yield as the interpreter does
+int TestYield()
+{
+    SStackData instructions = YieldProgram();
+
+    SVMData interpreted;
+    SVMData translated;
+    FuncArray funcArray = { 0 };
+    InitVM(&interpreted, instructions, DATA_SIZE, funcArray);
+    InitVM(&translated, instructions, DATA_SIZE, funcArray);
+
+    Bool8 testResult = VMRunVerified(&interpreted) && RunYield(&translated)
+        && translated.instructionStack.stackPointer[-1] == INS_YIELD
+        && IsSameVM(&interpreted, &translated);
+
+    DeleteVM(&interpreted, HS_TRUE, HS_TRUE);
+    DeleteVM(&translated, HS_TRUE, HS_TRUE);
+    DeleteStack(instructions);
+    return Report("TestYield", testResult);
+}
+
+// A waiting async call leaves the VM after the call with the operands below its arguments,
+// as the interpreter does
+int TestAsyncCall()
+{
+    SStackData instructions = AsyncProgram();
+
+    SVMData interpreted;
+    SVMData translated;
+    FuncArray funcArray = { sizeof(s_natives) / sizeof(s_natives[0]), s_natives };
+    InitVM(&interpreted, instructions, DATA_SIZE, funcArray);
+    InitVM(&translated, instructions, DATA_SIZE, funcArray);
+
+    Bool8 testResult = VMRunVerified(&interpreted) && RunAsync(&translated)
+        && translated.asyncCall == 1 && interpreted.asyncCall == 1
+        && translated.instructionStack.stackPointer[-GetInstructionSize(INS_CALL_ASYNC)] == INS_CALL_ASYNC
+        && IsSameVM(&interpreted, &translated);
+
+    DeleteVM(&interpreted, HS_TRUE, HS_TRUE);
+    DeleteVM(&translated, HS_TRUE, HS_TRUE);
+    DeleteStack(instructions);
+    return Report("TestAsyncCall", testResult);
+}
+
+int TestDataStackTooSmall()
+{
+    SStackData instructions = CallsProgram();
+
+    SVMData vmData;
+    FuncArray funcArray = { 0 };
+    InitVM(&vmData, instructions, HS_DATA_SIZE_INT, funcArray);
+
+    Bool8 running = RunCalls(&vmData);
+    Bool8 testResult = !running && vmData.error == VM_ERROR_STACK_OVERFLOW
+        && vmData.dataStack.base.stackPointer == vmData.dataStack.base.begin;
+
+    DeleteVM(&vmData, HS_FALSE, HS_TRUE);
+    return Report("TestDataStackTooSmall", testResult);
+}
+
+int TestRejectsInvalidCode()
+{
+    SStackData s = CreateStack(10);
+    AddInstruction(&s, INS_ADD_I);
+    AddInstruction(&s, INS_END);
+    SStackData instructions = Finish(s);
+
+    char* text = Translate(instructions, "RunInvalid");
+    Bool8 testResult = text == NULL;
+
+    free(text);
+    DeleteStack(instructions);
+    return Report("TestRejectsInvalidCode", testResult);
+}
+
+// Rewrites the checked in translations
+static int Update()
+{
+    for (int i = 0; i < NUM_SCRIPTS; ++i)
+    {
+        SStackData instructions;
+        FILE* file = fopen(SCRIPTS[i].translation, "wb");
+        if (!file || !CompileScript(&SCRIPTS[i], &instructions) || TranslateToC(instructions, SCRIPTS[i].name, file) != R_OK)
+        {
+            printf("Failed to update %s\n", SCRIPTS[i].translation);
+            return 1;
+        }
+
+        fclose(file);
+        DeleteStack(instructions);
+        printf("Updated %s\n", SCRIPTS[i].translation);
+    }
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc > 1 && strcmp(argv[1], "-update") == 0)
+        return Update();
+
+    int fails = 0;
+
+    fails += TestTranslationsUpToDate();
+    fails += TestSameAsInterpreter();
+    fails += TestResume();
+    fails += TestYield();
+    fails += TestAsyncCall();
+    fails += TestDataStackTooSmall();
+    fails += TestRejectsInvalidCode();
+
+    printf("\n%d tests failed\n", fails);
+    return fails;
+}
@@ -0,0 +1,219 @@
+#include <stdio.h>
+
+#include "async.h"
+#include "bytecode_c.h"
+#include "embed.h"
+#include "scheduler.h"
+#include "thread_pool.h"
+#include "test_util.h"
+
+// int(int): waits with the argument as its token when it is odd, even ones are read right away
+static void NativeRead(SVMData* vmData)
+{
+    hsbint file = PopInt(&vmData->dataStack.base.stackPointer);
+    if (file % 2 == 0)
+        PushInt(&vmData->dataStack.base.stackPointer, file * 100);
+    else
+        vmData->asyncCall = (int)file;
+}
+
+// float(int, float): always waits, the token is the first argument
+static void NativeMeasure(SVMData* vmData)
+{
+    PopFloat(&vmData->dataStack.base.stackPointer);
+    vmData->asyncCall = (int)PopInt(&vmData->dataStack.base.stackPointer);
+}
+
+// void(int): always waits
+static void NativeSleep(SVMData* vmData)
+{
+    vmData->asyncCall = (int)PopInt(&vmData->dataStack.base.stackPointer);
+}
+
+static char s_code[] =
+    "fun load(file: int): int\n"
+    "{\n"
+    "    var total: int = 1;\n"
+    "    total = total + read(file) + read(file + 1);\n"
+    "    return total;\n"
+    "}\n"
+    "fun probe(id: int): float { var x: float = 2.0; return x * measure(id, 0.5) + x; }\n"
+    "fun nap(id: int): int { sleep(id); return id + 1; }\n";
+
+static Bool8 CreateAsyncProgram(SProgram* outProgram)
+{
+    SNativeTable natives;
+    InitNativeTable(&natives);
+    RegisterAsyncNative(&natives, "read", "int(int)", NativeRead);
+    RegisterAsyncNative(&natives, "measure", "float(int, float)", NativeMeasure);
+    RegisterAsyncNative(&natives, "sleep", "void(int)", NativeSleep);
+    EResult result = CreateProgram(s_code, sizeof(s_code) - 1, &natives, outProgram);
+    DeleteNativeTable(&natives);
+    return result == R_OK;
+}
+
+// A waiting function does not run until its call is completed, the operands below the call
+// are still there after
+int TestCompleteAsyncCall()
+{
+    SProgram program;
+    if (!CreateAsyncProgram(&program))
+        return Report("TestCompleteAsyncCall", HS_FALSE);
+
+    SScriptContext context;
+    InitScriptContext(&context, &program);
+
+    // read(4) finishes right away, read(5) waits
+    SScriptValue arguments[] = { { .i = 4 } };
+    SScriptValue result = { 0 };
+    Bool8 testResult = StartFunction(&context, FindFunction(&program, "load"), arguments, 1) == R_OK
+        && ResumeFunction(&context, 1000, &result) == SCRIPT_WAITING && context.vmData.asyncCall == 5
+        && ResumeFunction(&context, 1000, &result) == SCRIPT_WAITING;
+
+    CompleteAsyncCall(&context.vmData, (SScriptValue){ .i = 7 });
+    testResult = testResult && context.vmData.asyncCall == HS_NO_ASYNC_CALL
+        && ResumeFunction(&context, 1000, &result) == SCRIPT_FINISHED && result.i == 1 + 400 + 7;
+
+    SScriptValue id[] = { { .i = 3 } };
+    testResult = testResult && StartFunction(&context, FindFunction(&program, "probe"), id, 1) == R_OK
+        && ResumeFunction(&context, 1000, &result) == SCRIPT_WAITING;
+    CompleteAsyncCall(&context.vmData, (SScriptValue){ .f = 1.5f });
+    testResult = testResult && ResumeFunction(&context, 1000, &result) == SCRIPT_FINISHED && result.f == 5.0f;
+
+    testResult = testResult && StartFunction(&context, FindFunction(&program, "nap"), id, 1) == R_OK
+        && ResumeFunction(&context, 1000, &result) == SCRIPT_WAITING;
+    CompleteAsyncCall(&context.vmData, (SScriptValue){ .i = 0 });
+    testResult = testResult && ResumeFunction(&context, 1000, &result) == SCRIPT_FINISHED && result.i == 4;
+
+    // calls fail at the first native that waits, a function started after them runs as usual
+    arguments[0].i = 1;
+    testResult = testResult && CallFunction(&context, FindFunction(&program, "load"), arguments, 1, &result) == R_ERROR
+        && CallFunction(&context, FindFunction(&program, "load"), (SScriptValue[]){ { .i = 2 } }, 1, &result) == R_ERROR;
+    testResult = testResult && StartFunction(&context, FindFunction(&program, "nap"), id, 1) == R_OK
+        && ResumeFunction(&context, 1000, &result) == SCRIPT_WAITING;
+
+    DeleteScriptContext(&context);
+    DeleteProgram(&program);
+    return Report("TestCompleteAsyncCall", testResult);
+}
+
+enum { INSTANCES = 5000 };
+
+// Thousands of instances wait at the same time, each one resumes in the tick after its
+// completion was posted, whatever the order
+int TestSchedulerCompletions()
+{
+    SProgram program;
+    if (!CreateAsyncProgram(&program))
+        return Report("TestSchedulerCompletions", HS_FALSE);
+
+    SScheduler scheduler;
+    InitScheduler(&scheduler, &program, 1000);
+    static int handles[INSTANCES];
+    for (int i = 0; i < INSTANCES; ++i)
+    {
+        SScriptValue arguments[] = { { .i = 2 * i + 1 } };
+        handles[i] = SpawnInstance(&scheduler, FindFunction(&program, "nap"), arguments, 1);
+    }
+
+    Bool8 testResult = RunSchedulerTick(&scheduler) == INSTANCES && scheduler.runningCount == 0
+        && scheduler.waitingCount == INSTANCES && RunSchedulerTick(&scheduler) == INSTANCES;
+
+    // every other one from the back, and a token nobody waits for
+    for (int i = INSTANCES - 1; i >= 0; i -= 2)
+        PostCompletion(&scheduler.completions, 2 * i + 1, (SScriptValue){ .i = 0 });
+    PostCompletion(&scheduler.completions, 2 * INSTANCES + 1, (SScriptValue){ .i = 0 });
+    testResult = testResult && RunSchedulerTick(&scheduler) == INSTANCES / 2;
+    for (int i = 0; i < INSTANCES; ++i)
+    {
+        const SScriptInstance* instance = GetInstance(&scheduler, handles[i]);
+        testResult = testResult && instance->state == (i % 2 ? SCRIPT_FINISHED : SCRIPT_WAITING)
+            && (i % 2 == 0 || instance->result.i == 2 * i + 2);
+    }
+
+    // a freed instance stops waiting, its completion is dropped
+    FreeInstance(&scheduler, handles[0]);
+    for (int i = 0; i < INSTANCES; i += 2)
+        PostCompletion(&scheduler.completions, 2 * i + 1, (SScriptValue){ .i = 0 });
+    testResult = testResult && RunSchedulerTick(&scheduler) == 0 && scheduler.waitingCount == 0
+        && GetInstance(&scheduler, handles[INSTANCES - 2])->result.i == 2 * INSTANCES - 2;
+
+    // two instances cannot wait for the same token
+    SScriptValue same[] = { { .i = 9 } };
+    int first = SpawnInstance(&scheduler, FindFunction(&program, "nap"), same, 1);
+    int second = SpawnInstance(&scheduler, FindFunction(&program, "nap"), same, 1);
+    testResult = testResult && RunSchedulerTick(&scheduler) == 1
+        && GetInstance(&scheduler, first)->state == SCRIPT_WAITING
+        && GetInstance(&scheduler, second)->state == SCRIPT_FAILED;
+
+    // completions that were never taken
+    PostCompletion(&scheduler.completions, 9, (SScriptValue){ .i = 0 });
+    DeleteScheduler(&scheduler);
+    DeleteProgram(&program);
+    return Report("TestSchedulerCompletions", testResult);
+}
+
+enum { POSTERS = 4, POSTS = 20000 };
+
+static SCompletionQueue s_queue;
+static int s_taken[POSTERS];
+static Bool8 s_inOrder;
+
+static void PostTokens(void* data, int thread)
+{
+    for (int i = 0; i < POSTS; ++i)
+        PostCompletion(&s_queue, thread * POSTS + i, (SScriptValue){ .i = i });
+}
+
+static void CountToken(void* data, int token, SScriptValue result)
+{
+    // the completions of one thread come in the order it posted them
+    int thread = token / POSTS;
+    s_inOrder = s_inOrder && result.i == s_taken[thread] && token == thread * POSTS + result.i;
+    ++s_taken[thread];
+}
+
+// Threads post while the caller takes. Build with -fsanitize=thread to check the queue for
+// data races.
+static void PostAndTake(void* data, int thread)
+{
+    if (thread < POSTERS)
+    {
+        PostTokens(data, thread);
+        return;
+    }
+
+    int* taken = data;
+    while (*taken < POSTERS * POSTS)
+        *taken += TakeCompletions(&s_queue, CountToken, NULL);
+}
+
+int TestPostFromThreads()
+{
+    InitCompletionQueue(&s_queue);
+    s_inOrder = HS_TRUE;
+
+    int taken = 0;
+    SThreadPool* pool = CreateThreadPool(POSTERS + 1);
+    RunOnThreads(pool, PostAndTake, &taken);
+    DeleteThreadPool(pool);
+
+    Bool8 testResult = s_inOrder && taken == POSTERS * POSTS && TakeCompletions(&s_queue, CountToken, NULL) == 0;
+    for (int i = 0; i < POSTERS; ++i)
+        testResult = testResult && s_taken[i] == POSTS;
+
+    DeleteCompletionQueue(&s_queue);
+    return Report("TestPostFromThreads", testResult);
+}
+
+int main()
+{
+    int fails = 0;
+
+    fails += TestCompleteAsyncCall();
+    fails += TestSchedulerCompletions();
+    fails += TestPostFromThreads();
+
+    printf("\n%d tests failed\n", fails);
+    return fails;
+}
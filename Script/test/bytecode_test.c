@@ -63,17 +63,17 @@ int TestVariable()
     AddInstruction(&instructionStack, INS_LITERAL_I);
     StoreIntFwd(&instructionStack.stackPointer, 1);
     AddInstruction(&instructionStack, INS_SAVE_VAR_I);
-    *instructionStack.stackPointer++ = 0 * sizeof(hsbint);
+    *instructionStack.stackPointer++ = 0 * HS_DATA_SIZE_INT;
     AddInstruction(&instructionStack, INS_LITERAL_I);
     StoreIntFwd(&instructionStack.stackPointer, 20);
     AddInstruction(&instructionStack, INS_SAVE_VAR_I);
-    *instructionStack.stackPointer++ = 1 * sizeof(hsbint);
+    *instructionStack.stackPointer++ = 1 * HS_DATA_SIZE_INT;
 
     // load variables and add them
     AddInstruction(&instructionStack, INS_LOAD_VAR_I);
-    *instructionStack.stackPointer++ = 0 * sizeof(hsbint);
+    *instructionStack.stackPointer++ = 0 * HS_DATA_SIZE_INT;
     AddInstruction(&instructionStack, INS_LOAD_VAR_I);
-    *instructionStack.stackPointer++ = 1 * sizeof(hsbint);
+    *instructionStack.stackPointer++ = 1 * HS_DATA_SIZE_INT;
 
     AddInstruction(&instructionStack, INS_ADD_I);
 	
@@ -124,28 +124,28 @@ int TestSimpleLoop()
 	AddInstruction(&instructionStack, INS_LITERAL_I);
     StoreIntFwd(&instructionStack.stackPointer, 0);
 	AddInstruction(&instructionStack, INS_SAVE_VAR_I);
-    *instructionStack.stackPointer++ = 0 * sizeof(hsbint);
+    *instructionStack.stackPointer++ = 0 * HS_DATA_SIZE_INT;
 	AddInstruction(&instructionStack, INS_LITERAL_I);
     StoreIntFwd(&instructionStack.stackPointer, numIterations);
 	AddInstruction(&instructionStack, INS_SAVE_VAR_I);
-    *instructionStack.stackPointer++ = 1 * sizeof(hsbint);
+    *instructionStack.stackPointer++ = 1 * HS_DATA_SIZE_INT;
 	
 	hsbaddress loopStartAddress = instructionStack.stackPointer - instructionStack.begin;
 	
 	// load variable, increment it and save it
 	AddInstruction(&instructionStack, INS_LOAD_VAR_I);
-    *instructionStack.stackPointer++ = 0 * sizeof(hsbint);
+    *instructionStack.stackPointer++ = 0 * HS_DATA_SIZE_INT;
 	AddInstruction(&instructionStack, INS_LITERAL_I);
     StoreIntFwd(&instructionStack.stackPointer, 1);
 	AddInstruction(&instructionStack, INS_ADD_I);
 	AddInstruction(&instructionStack, INS_SAVE_VAR_I);
-    *instructionStack.stackPointer++ = 0 * sizeof(hsbint);
+    *instructionStack.stackPointer++ = 0 * HS_DATA_SIZE_INT;
 	
 	// load both and compare them
 	AddInstruction(&instructionStack, INS_LOAD_VAR_I);
-    *instructionStack.stackPointer++ = 0 * sizeof(hsbint);
+    *instructionStack.stackPointer++ = 0 * HS_DATA_SIZE_INT;
     AddInstruction(&instructionStack, INS_LOAD_VAR_I);
-    *instructionStack.stackPointer++ = 1 * sizeof(hsbint);
+    *instructionStack.stackPointer++ = 1 * HS_DATA_SIZE_INT;
 	
 	AddInstruction(&instructionStack, INS_CMP_I_EQ);
 	AddInstruction(&instructionStack, INS_NEGATE_B);
@@ -157,7 +157,7 @@ int TestSimpleLoop()
 	
 	// load the variable (so the test could check the value)
 	AddInstruction(&instructionStack, INS_LOAD_VAR_I);
-    *instructionStack.stackPointer++ = 0 * sizeof(hsbint);
+    *instructionStack.stackPointer++ = 0 * HS_DATA_SIZE_INT;
 	
 	// dealloc variables
 	AddInstruction(&instructionStack, INS_DEALLOC_VAR_I);
@@ -0,0 +1,208 @@
+#include <stdio.h>
+
+#include "bytecode_c.h"
+#include "channel.h"
+#include "embed.h"
+#include "scheduler.h"
+#include "thread_pool.h"
+#include "test_util.h"
+
+static char s_code[] =
+    "fun produce(channel: int, first: int, count: int): int\n"
+    "{\n"
+    "    var i: int = 0;\n"
+    "    while (i < count) { if (send(channel, first + i) == 1) i = i + 1; else yield; }\n"
+    "    return i;\n"
+    "}\n"
+    "fun consume(channel: int, count: int): int\n"
+    "{\n"
+    "    var sum: int = 0; var i: int = 0;\n"
+    "    while (i < count) { sum = sum + receive(channel); i = i + 1; }\n"
+    "    return sum;\n"
+    "}\n"
+    "fun forward(from: int, to: int): float\n"
+    "{\n"
+    "    var f: float = receiveFloat(from);\n"
+    "    while (sendFloat(to, f * 2.0) == 0) yield;\n"
+    "    return f;\n"
+    "}\n";
+
+static Bool8 CreateChannelProgram(SProgram* outProgram)
+{
+    SNativeTable natives;
+    InitNativeTable(&natives);
+    RegisterChannelNatives(&natives);
+    EResult result = CreateProgram(s_code, sizeof(s_code) - 1, &natives, outProgram);
+    DeleteNativeTable(&natives);
+    return result == R_OK;
+}
+
+// The ring fills up, empties in order and wraps around
+int TestSendReceive()
+{
+    SCompletionQueue queue;
+    InitCompletionQueue(&queue);
+
+    Bool8 testResult = HS_TRUE;
+    for (int isSingleSender = 0; isSingleSender < 2; ++isSingleSender)
+    {
+        int handle = CreateChannel(3, isSingleSender, &queue, 0);
+        SChannel* channel = GetChannel(handle);
+        SScriptValue value;
+        for (int round = 0; round < 3; ++round)
+        {
+            for (int i = 0; i < 4; ++i)
+                testResult = testResult && SendValue(channel, (SScriptValue){ .i = (hsbint)(round * 10 + i) });
+            testResult = testResult && !SendValue(channel, (SScriptValue){ .i = 0 });
+            for (int i = 0; i < 4; ++i)
+                testResult = testResult && ReceiveValue(channel, &value) && value.i == round * 10 + i;
+            testResult = testResult && !ReceiveValue(channel, &value);
+        }
+        DeleteChannel(handle);
+        testResult = testResult && GetChannel(handle) == NULL;
+    }
+
+    testResult = testResult && TakeCompletions(&queue, NULL, NULL) == 0 && GetChannel(-1) == NULL;
+    DeleteCompletionQueue(&queue);
+    return Report("TestSendReceive", testResult);
+}
+
+// Instances of one scheduler: the receivers wait on the empty channels, the producer yields
+// on a full one
+int TestScriptsOnOneThread()
+{
+    SProgram program;
+    if (!CreateChannelProgram(&program))
+        return Report("TestScriptsOnOneThread", HS_FALSE);
+
+    SScheduler scheduler;
+    InitScheduler(&scheduler, &program, 1000);
+    int numbers = CreateChannel(4, HS_TRUE, &scheduler.completions, 1);
+    int floats = CreateChannel(2, HS_FALSE, &scheduler.completions, 2);
+    int doubled = CreateChannel(2, HS_FALSE, &scheduler.completions, 3);
+
+    // the consumer comes first and waits, the producer fills the channel in its first tick
+    SScriptValue consume[] = { { .i = (hsbint)numbers }, { .i = 100 } };
+    SScriptValue produce[] = { { .i = (hsbint)numbers }, { .i = 7 }, { .i = 100 } };
+    SScriptValue forward[] = { { .i = (hsbint)floats }, { .i = (hsbint)doubled } };
+    int consumer = SpawnInstance(&scheduler, FindFunction(&program, "consume"), consume, 2);
+    int producer = SpawnInstance(&scheduler, FindFunction(&program, "produce"), produce, 3);
+    int forwarder = SpawnInstance(&scheduler, FindFunction(&program, "forward"), forward, 2);
+
+    Bool8 testResult = RunSchedulerTick(&scheduler) == 3 && scheduler.waitingCount == 2
+        && GetInstance(&scheduler, consumer)->state == SCRIPT_WAITING;
+
+    SScriptValue half = { .f = 0.5f };
+    SScriptValue value;
+    testResult = testResult && SendValue(GetChannel(floats), half);
+    for (int tick = 0; tick < 200 && RunSchedulerTick(&scheduler) > 0; ++tick)
+    {
+    }
+
+    // 7 + 8 + ... + 106
+    testResult = testResult && GetInstance(&scheduler, producer)->result.i == 100
+        && GetInstance(&scheduler, consumer)->result.i == 5650
+        && GetInstance(&scheduler, forwarder)->result.f == 0.5f
+        && ReceiveValue(GetChannel(doubled), &value) && value.f == 1.0f && !ReceiveValue(GetChannel(numbers), &value);
+
+    DeleteChannel(numbers);
+    DeleteChannel(floats);
+    DeleteChannel(doubled);
+    DeleteScheduler(&scheduler);
+    DeleteProgram(&program);
+    return Report("TestScriptsOnOneThread", testResult);
+}
+
+enum { PRODUCERS = 3, MESSAGES = 3000, ROUNDS = 4 };
+
+typedef struct
+{
+    SProgram* program;
+    SScheduler schedulers[PRODUCERS + 1]; // The consumer's last, a scheduler is not tied to a thread
+    int channel;
+    hsbint sums[ROUNDS];
+} SPipeline;
+
+// The first threads run a producer each, the last one the consumer
+static void RunPipeline(void* data, int thread)
+{
+    SPipeline* pipeline = data;
+    SScheduler* scheduler = &pipeline->schedulers[thread];
+    for (int round = 0; round < ROUNDS; ++round)
+    {
+        if (thread < PRODUCERS)
+        {
+            SScriptValue produce[] = { { .i = (hsbint)pipeline->channel }, { .i = (hsbint)(thread * 10) },
+                { .i = MESSAGES } };
+            SpawnInstance(scheduler, FindFunction(pipeline->program, "produce"), produce, 3);
+        }
+        else
+        {
+            SScriptValue consume[] = { { .i = (hsbint)pipeline->channel }, { .i = PRODUCERS * MESSAGES } };
+            SpawnInstance(scheduler, FindFunction(pipeline->program, "consume"), consume, 2);
+        }
+
+        // the other threads go on when all instances wait or the channel is full
+        while (RunSchedulerTick(scheduler) > 0)
+            YieldThread();
+        if (thread == PRODUCERS)
+            pipeline->sums[round] = GetInstance(scheduler, 0)->result.i;
+        FreeInstance(scheduler, 0);
+    }
+}
+
+// Producers on three threads send to a consumer on a fourth one, which waits whenever it is
+// faster. The producers do not wait for the consumer between rounds, so a round can receive
+// values of the next one, but every value arrives once and nothing is left. Build with -fsanitize=thread to check
+// the channel for data races.
+int TestPipelineBetweenThreads()
+{
+    SProgram program;
+    if (!CreateChannelProgram(&program))
+        return Report("TestPipelineBetweenThreads", HS_FALSE);
+
+    int total = 0;
+    for (int thread = 0; thread < PRODUCERS; ++thread)
+        total += MESSAGES * thread * 10 + MESSAGES * (MESSAGES - 1) / 2;
+
+    Bool8 testResult = HS_TRUE;
+    SThreadPool* pool = CreateThreadPool(PRODUCERS + 1);
+    static SPipeline pipeline;
+    for (int capacity = 2; capacity <= 512; capacity *= 16)
+    {
+        pipeline.program = &program;
+        for (int i = 0; i <= PRODUCERS; ++i)
+            InitScheduler(&pipeline.schedulers[i], &program, 500);
+        pipeline.channel = CreateChannel(capacity, HS_FALSE, &pipeline.schedulers[PRODUCERS].completions, 0);
+
+        RunOnThreads(pool, RunPipeline, &pipeline);
+
+        // in the wrapping arithmetic of the scripts
+        hsbint sum = 0;
+        for (int round = 0; round < ROUNDS; ++round)
+            sum = (hsbint)(sum + pipeline.sums[round]);
+
+        SScriptValue value;
+        testResult = testResult && sum == (hsbint)(ROUNDS * total) && !ReceiveValue(GetChannel(pipeline.channel), &value);
+
+        DeleteChannel(pipeline.channel);
+        for (int i = 0; i <= PRODUCERS; ++i)
+            DeleteScheduler(&pipeline.schedulers[i]);
+    }
+
+    DeleteThreadPool(pool);
+    DeleteProgram(&program);
+    return Report("TestPipelineBetweenThreads", testResult);
+}
+
+int main()
+{
+    int fails = 0;
+
+    fails += TestSendReceive();
+    fails += TestScriptsOnOneThread();
+    fails += TestPipelineBetweenThreads();
+
+    printf("\n%d tests failed\n", fails);
+    return fails;
+}
@@ -0,0 +1,292 @@
+#include <stdio.h>
+
+#include "bytecode_c.h"
+#include "compiler.h"
+#include "test_util.h"
+
+static const int DATA_SIZE = 200;
+
+// Compiles and runs the code, the VM is left for inspection
+static Bool8 CompileAndRun(const char* source, SVMData* vmData)
+{
+    char code[1024];
+    int size = strlen(source);
+    memcpy(code, source, size + 1);
+
+    SStackData instructions;
+    if (CompileSource(code, size, &instructions) != R_OK)
+        return HS_FALSE;
+
+    FuncArray funcArray = { 0 };
+    InitVM(vmData, instructions, DATA_SIZE, funcArray);
+
+    while (VMProcessInstructions(vmData, 1))
+    {
+    }
+
+    return HS_TRUE;
+}
+
+// Globals stay allocated, the last declared one is on top of the variable area
+static hsbint GlobalInt(SVMData* vmData, int indexFromLast)
+{
+    return LoadVarInt(vmData->dataStack.reversePointer + indexFromLast * HS_DATA_SIZE_INT);
+}
+
+int TestArithmetic()
+{
+    SVMData vmData;
+    Bool8 testResult = CompileAndRun(
+        "var x: int;"
+        "var z: int;"
+        "x = z = 3;"
+        "var y: int = 42;"
+        "z = 2 + y * -x / (10 - 4) + x * 2;",
+        &vmData);
+
+    testResult = testResult
+        && GlobalInt(&vmData, 0) == 42
+        && GlobalInt(&vmData, 1) == 2 + 42 * -3 / 6 + 6
+        && GlobalInt(&vmData, 2) == 3
+        && vmData.dataStack.base.stackPointer == vmData.dataStack.base.begin;
+
+    DeleteVM(&vmData, HS_FALSE, HS_TRUE);
+    return Report("TestArithmetic", testResult);
+}
+
+int TestFloat()
+{
+    SVMData vmData;
+    Bool8 testResult = CompileAndRun(
+        "var f: float = 1.5;"
+        "f = -f * 2.0 + 0.25;",
+        &vmData);
+
+    testResult = testResult && LoadVarFloat(vmData.dataStack.reversePointer) == -2.75f;
+
+    DeleteVM(&vmData, HS_FALSE, HS_TRUE);
+    return Report("TestFloat", testResult);
+}
+
+int TestIfElse()
+{
+    SVMData vmData;
+    Bool8 testResult = CompileAndRun(
+        "var a: int = 0;"
+        "var b: int = 0;"
+        "var c: int = 0;"
+        "if (1 < 2) a = 1; else a = 2;"
+        "if (2 != 2) b = 1; else { b = 2; }"
+        "if (3 >= 3) { var tmp: int = 5; c = tmp; }",
+        &vmData);
+
+    testResult = testResult
+        && GlobalInt(&vmData, 2) == 1
+        && GlobalInt(&vmData, 1) == 2
+        && GlobalInt(&vmData, 0) == 5
+        && vmData.dataStack.reversePointer == vmData.dataStack.base.end - 3 * HS_DATA_SIZE_INT;
+
+    DeleteVM(&vmData, HS_FALSE, HS_TRUE);
+    return Report("TestIfElse", testResult);
+}
+
+int TestWhile()
+{
+    SVMData vmData;
+    Bool8 testResult = CompileAndRun(
+        "var i: int = 0;"
+        "var sum: int = 0;"
+        "while (i < 10)"
+        "{"
+        "    var twice: int = i * 2;"
+        "    if (twice > 10) sum = sum + twice;"
+        "    i = i + 1;"
+        "}",
+        &vmData);
+
+    testResult = testResult
+        && GlobalInt(&vmData, 1) == 10
+        && GlobalInt(&vmData, 0) == 12 + 14 + 16 + 18;
+
+    DeleteVM(&vmData, HS_FALSE, HS_TRUE);
+    return Report("TestWhile", testResult);
+}
+
+// Dense cases go through the jump table, sparse ones through a binary search, a few through
+// a chain of compares
+int TestSwitch()
+{
+    SVMData vmData;
+    Bool8 testResult = CompileAndRun(
+        "var dense: int = 0;"
+        "var i: int = -1;"
+        "while (i < 7)"
+        "{"
+        "    switch (i)"
+        "    {"
+        "        case 0: dense = dense + 1;"
+        "        case 1: case 2: dense = dense + 10;"
+        "        case 3: dense = dense + 100;"
+        "        case 5: dense = dense + 1000;"
+        "        default: dense = dense + 10000;"
+        "    }"
+        "    i = i + 1;"
+        "}"
+        "var sparse: int = 0;"
+        "switch (i * 1000) { case -5: sparse = 1; case 7000: sparse = 2; case 9: sparse = 3; case 300: sparse = 4; case 20000: sparse = 5; }"
+        "var tiny: int = 1;"
+        "switch (sparse) { case 2: tiny = 2; }"
+        "var none: int = 1;"
+        "switch (tiny) { case 1: none = 2; }",
+        &vmData);
+
+    testResult = testResult
+        && GlobalInt(&vmData, 4) == 1 + 2 * 10 + 100 + 1000 + 3 * 10000
+        && GlobalInt(&vmData, 2) == 2
+        && GlobalInt(&vmData, 1) == 2
+        && GlobalInt(&vmData, 0) == 1
+        && vmData.dataStack.reversePointer == vmData.dataStack.base.end - 5 * HS_DATA_SIZE_INT;
+
+    DeleteVM(&vmData, HS_FALSE, HS_TRUE);
+    return Report("TestSwitch", testResult);
+}
+
+int TestErrors()
+{
+    const char* invalid[] =
+    {
+        "var x: int = 1.0;",
+        "x = 1;",
+        "var x: int; x + 1;",
+        "var x: float; if (x) x = 1.0;",
+        "var x: bool;",
+        "var x: int; switch (x) { case 1: x = 1; case 1: x = 2; }",
+        "var x: int; switch (x) { default: x = 1; default: x = 2; }",
+        "var x: float; switch (x) { case 1: x = 1.0; }",
+        "var x: int; switch (x) { case 2000000000: x = 1; case -2000000000: x = 2; case 0: x = 3; }",
+    };
+
+    Bool8 testResult = HS_TRUE;
+    for (int i = 0; i < (int)(sizeof(invalid) / sizeof(invalid[0])); ++i)
+    {
+        char code[256];
+        strcpy(code, invalid[i]);
+
+        SStackData instructions;
+        if (CompileSource(code, strlen(code), &instructions) == R_OK)
+        {
+            DeleteStack(instructions);
+            testResult = HS_FALSE;
+        }
+    }
+
+    return Report("TestErrors", testResult);
+}
+
+static Bool8 IsPosition(const SLineTable* lines, int offset, int line, int column)
+{
+    SSourcePosition position;
+    return FindSourcePosition(lines, offset, &position) && position.line == line && position.column == column;
+}
+
+// Entries read back as added, lines going back and numbers taking more than a byte
+int TestLineTable()
+{
+    SLineTable lines;
+    InitLineTable(&lines);
+    AddLineEntry(&lines, 0, (SSourcePosition){ 10, 1 });
+    AddLineEntry(&lines, 5, (SSourcePosition){ 2, 200 });
+    AddLineEntry(&lines, 6, (SSourcePosition){ 2, 200 }); // The same position adds nothing
+    AddLineEntry(&lines, 300, (SSourcePosition){ 40000, 3 });
+
+    SLineEntry entries[4];
+    int entryCount = 0;
+    SLineEntry entry = { 0 };
+    while (entryCount < 4 && ReadLineEntry(&lines, &entry))
+        entries[entryCount++] = entry;
+
+    Bool8 testResult = entryCount == 3 && lines.entryCount == 3
+        && entries[0].offset == 0 && entries[0].position.line == 10 && entries[0].position.column == 1
+        && entries[1].offset == 5 && entries[1].position.line == 2 && entries[1].position.column == 200
+        && entries[2].offset == 300 && entries[2].position.line == 40000 && entries[2].position.column == 3
+        && lines.size == 3 + 4 + 6
+        && IsPosition(&lines, 4, 10, 1)
+        && IsPosition(&lines, 299, 2, 200)
+        && IsPosition(&lines, 1000, 40000, 3);
+
+    DeleteLineTable(&lines);
+
+    // Nothing covers an offset before the first entry
+    SSourcePosition position;
+    InitLineTable(&lines);
+    AddLineEntry(&lines, 4, (SSourcePosition){ 1, 1 });
+    testResult = testResult && !FindSourcePosition(&lines, 3, &position) && IsPosition(&lines, 4, 1, 1);
+    DeleteLineTable(&lines);
+
+    return Report("TestLineTable", testResult);
+}
+
+// Instructions get the position of the statement or expression they were compiled from
+int TestSourcePositions()
+{
+    char code[] =
+        "var i: int = 0;\n"
+        "// The loop\n"
+        "while (i < 10)\n"
+        "{\n"
+        "    i = i + 1;\n"
+        "}\n";
+
+    SStackData instructions;
+    SLineTable lines;
+    if (CompileSourceWithLines(code, strlen(code), &instructions, &lines) != R_OK)
+        return Report("TestSourcePositions", HS_FALSE);
+
+    // ALLOC_VAR_I, LITERAL_I, SAVE_VAR_I, then the JUMP to the condition at the bottom, the body
+    // from 9 and the condition from 17
+    int size = instructions.end - instructions.begin;
+    Bool8 testResult = IsPosition(&lines, 0, 1, 1)
+        && IsPosition(&lines, 1, 1, 14)
+        && IsPosition(&lines, 5, 1, 1)
+        && IsPosition(&lines, 6, 3, 1)
+        && IsPosition(&lines, 9, 5, 9)
+        && IsPosition(&lines, 14, 5, 11)
+        && IsPosition(&lines, 15, 5, 5)
+        && IsPosition(&lines, 17, 3, 8)
+        && IsPosition(&lines, 22, 3, 10)
+        && IsPosition(&lines, 23, 3, 1)
+        && IsPosition(&lines, size - 1, 7, 1)
+        && instructions.begin[size - 1] == INS_END
+        && lines.size <= 3 * lines.entryCount;
+
+    // The table does not change the code
+    SStackData plain;
+    if (CompileSource(code, strlen(code), &plain) == R_OK)
+    {
+        testResult = testResult && plain.end - plain.begin == size && memcmp(plain.begin, instructions.begin, size) == 0;
+        DeleteStack(plain);
+    }
+    else
+    {
+        testResult = HS_FALSE;
+    }
+
+    DeleteStack(instructions);
+    DeleteLineTable(&lines);
+    return Report("TestSourcePositions", testResult);
+}
+
+int main()
+{
+    int fails = 0;
+    fails += TestArithmetic();
+    fails += TestFloat();
+    fails += TestIfElse();
+    fails += TestWhile();
+    fails += TestSwitch();
+    fails += TestErrors();
+    fails += TestLineTable();
+    fails += TestSourcePositions();
+
+    return fails;
+}
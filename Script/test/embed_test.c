@@ -0,0 +1,380 @@
+#include <stdio.h>
+
+#include "bytecode_c.h"
+#include "compiler.h"
+#include "embed.h"
+#include "file.h"
+#include "verifier.h"
+#include "test_util.h"
+
+static const int DATA_SIZE = 200;
+
+static int s_traced;
+
+// void(int)
+static void NativeTrace(SVMData* vmData)
+{
+    s_traced = s_traced * 10 + PopInt(&vmData->dataStack.base.stackPointer);
+}
+
+static char s_functions[] =
+    "var unused: int = 5;\n"
+    "fun scale(value: int, factor: float): float\n"
+    "{\n"
+    "    var result: float = factor;\n"
+    "    var i: int = 1;\n"
+    "    while (i < value) { result = result + factor; i = i + 1; }\n"
+    "    return result;\n"
+    "}\n"
+    "fun sign(value: int): int\n"
+    "{\n"
+    "    if (value < 0) { var minus: int = -1; return minus; }\n"
+    "    switch (value) { case 0: return 0; default: { var plus: int = 1; return plus; } }\n"
+    "}\n"
+    "fun sum(a: int, b: int, c: int): int { return a + b * 10 + c * 100; }\n"
+    "fun traceTwice(value: int) { trace(value); trace(twice(value)); }\n"
+    "fun twice(value: int): int { value = value * 2; return value; }\n";
+
+// Functions with int and float arguments and results, locals, returns from nested scopes and
+// calls of other functions and natives
+int TestCallFunctions()
+{
+    SNativeTable natives;
+    InitNativeTable(&natives);
+    RegisterNative(&natives, "trace", "void(int)", NativeTrace);
+
+    SProgram program;
+    if (CreateProgram(s_functions, strlen(s_functions), &natives, &program) != R_OK)
+    {
+        DeleteNativeTable(&natives);
+        return Report("TestCallFunctions", HS_FALSE);
+    }
+    DeleteNativeTable(&natives);
+
+    SScriptContext context;
+    InitScriptContext(&context, &program);
+
+    int scale = FindFunction(&program, "scale");
+    int sign = FindFunction(&program, "sign");
+    int sum = FindFunction(&program, "sum");
+    int traceTwice = FindFunction(&program, "traceTwice");
+    Bool8 testResult = scale == 0 && sign == 1 && sum == 2 && traceTwice == 3 && FindFunction(&program, "unused") == -1;
+
+    SScriptValue result;
+    SScriptValue scaleArguments[] = { { .i = 4 }, { .f = 1.5f } };
+    testResult = testResult && CallFunction(&context, scale, scaleArguments, 2, &result) == R_OK && result.f == 6.0f;
+
+    for (int value = -3; value <= 3; ++value)
+    {
+        SScriptValue argument = { .i = value };
+        testResult = testResult && CallFunction(&context, sign, &argument, 1, &result) == R_OK
+            && result.i == (value > 0) - (value < 0);
+    }
+
+    SScriptValue sumArguments[] = { { .i = 1 }, { .i = 2 }, { .i = 3 } };
+    testResult = testResult && CallFunction(&context, sum, sumArguments, 3, &result) == R_OK && result.i == 321;
+
+    s_traced = 0;
+    SScriptValue traceArgument = { .i = 4 };
+    testResult = testResult && CallFunction(&context, traceTwice, &traceArgument, 1, NULL) == R_OK && s_traced == 48;
+
+    // The data stack is as deep as the deepest call needs
+    testResult = testResult && program.callReserve == 0
+        && program.dataSize < 8 * HS_DATA_SIZE_FLOAT + 4 * HS_DATA_SIZE_ADDRESS;
+
+    DeleteScriptContext(&context);
+    DeleteProgram(&program);
+    return Report("TestCallFunctions", testResult);
+}
+
+// The main program calls the functions, the verifier accepts the frames the compiler emits
+// and VMRunVerified gets the same globals. It needs every call of a function to have the
+// same stack layout, here each is called once.
+int TestCallsFromMain()
+{
+    char code[] =
+        "fun fma(a: float, b: float, c: float): float { return a * b + c; }\n"
+        "fun countDown(n: int): int { var steps: int = 0; while (n > 0) { n = n - 1; steps = steps + 1; } return steps; }\n"
+        "var f: float = fma(2.0, 3.0, 0.5);\n"
+        "var i: int = countDown(10);\n";
+
+    SStackData instructions;
+    if (CompileSource(code, strlen(code), &instructions) != R_OK)
+        return Report("TestCallsFromMain", HS_FALSE);
+
+    SVerifyResult verifyResult;
+    Bool8 testResult = VerifyInstructions(instructions, DATA_SIZE, &verifyResult) == R_OK;
+    if (!testResult)
+        printf("%s at %d\n", verifyResult.error, verifyResult.errorOffset);
+
+    for (int verified = 0; verified < 2 && testResult; ++verified)
+    {
+        SVMData vmData;
+        FuncArray funcArray = { 0 };
+        InitVM(&vmData, instructions, DATA_SIZE, funcArray);
+        if (verified)
+            VMRunVerified(&vmData);
+        else
+            while (VMProcessInstructions(&vmData, 1000));
+
+        testResult = vmData.error == VM_OK
+            && LoadVarInt(vmData.dataStack.reversePointer) == 10
+            && LoadVarFloat(vmData.dataStack.reversePointer + HS_DATA_SIZE_INT) == 6.5f;
+        DeleteVM(&vmData, HS_TRUE, HS_TRUE);
+    }
+
+    DeleteStack(instructions);
+    return Report("TestCallsFromMain", testResult);
+}
+
+// A recursive program gets a fixed data stack, running out of it fails the call but not the
+// context
+int TestRecursion()
+{
+    char code[] =
+        "fun fib(n: int): int { if (n < 2) return n; return fib(n - 1) + fib(n - 2); }\n"
+        "fun depth(n: int): int { if (n == 0) return 0; return depth(n - 1) + 1; }\n";
+
+    SProgram program;
+    if (CreateProgram(code, strlen(code), NULL, &program) != R_OK)
+        return Report("TestRecursion", HS_FALSE);
+
+    SScriptContext context;
+    InitScriptContext(&context, &program);
+
+    SScriptValue argument = { .i = 15 };
+    SScriptValue result;
+    Bool8 testResult = program.dataSize == HS_RECURSIVE_DATA_SIZE && program.callReserve > 0
+        && CallFunction(&context, FindFunction(&program, "fib"), &argument, 1, &result) == R_OK && result.i == 610;
+
+    argument.i = 30000;
+    testResult = testResult && CallFunction(&context, FindFunction(&program, "depth"), &argument, 1, &result) == R_ERROR
+        && context.vmData.error == VM_ERROR_STACK_OVERFLOW;
+
+    argument.i = 10;
+    testResult = testResult && CallFunction(&context, FindFunction(&program, "fib"), &argument, 1, &result) == R_OK
+        && result.i == 55;
+
+    DeleteScriptContext(&context);
+    DeleteProgram(&program);
+    return Report("TestRecursion", testResult);
+}
+
+// The compiler turns the recursive call into INS_TAIL_CALL, so the recursion goes deeper than
+// the data stack of a recursive program
+int TestTailRecursion()
+{
+    char* code;
+    int size;
+    if (!ReadFile("TailRecursion.hss", &code, &size))
+        return Report("TestTailRecursion", HS_FALSE);
+
+    SProgram program;
+    EResult result = CreateProgram(code, size, NULL, &program);
+    free(code);
+    if (result != R_OK)
+        return Report("TestTailRecursion", HS_FALSE);
+
+    SScriptContext context;
+    InitScriptContext(&context, &program);
+
+    // 1 + 2 + ... + 22000 modulo 10000
+    SScriptValue arguments[] = { { .i = 22000 }, { .i = 0 } };
+    SScriptValue sum;
+    Bool8 testResult = program.callReserve == 0
+        && CallFunction(&context, FindFunction(&program, "sum"), arguments, 2, &sum) == R_OK && sum.i == 1000;
+
+    DeleteScriptContext(&context);
+    DeleteProgram(&program);
+    return Report("TestTailRecursion", testResult);
+}
+
+// Contexts of the same program do not share state
+int TestContexts()
+{
+    char code[] = "fun next(value: int): int { var v: int = value; v = v * 3 + 1; return v; }\n";
+
+    SProgram program;
+    if (CreateProgram(code, strlen(code), NULL, &program) != R_OK)
+        return Report("TestContexts", HS_FALSE);
+
+    SScriptContext first, second;
+    InitScriptContext(&first, &program);
+    InitScriptContext(&second, &program);
+
+    int next = FindFunction(&program, "next");
+    SScriptValue a = { .i = 1 }, b = { .i = 2 };
+    Bool8 testResult = HS_TRUE;
+    for (int i = 0; i < 5; ++i)
+    {
+        testResult = testResult && CallFunction(&first, next, &a, 1, &a) == R_OK
+            && CallFunction(&second, next, &b, 1, &b) == R_OK;
+    }
+    testResult = testResult && a.i == 364 && b.i == 607;
+
+    DeleteScriptContext(&first);
+    DeleteScriptContext(&second);
+    DeleteProgram(&program);
+    return Report("TestContexts", testResult);
+}
+
+// A batch gets the results CallFunction gets row by row
+int TestBatch()
+{
+    SNativeTable natives;
+    InitNativeTable(&natives);
+    RegisterNative(&natives, "trace", "void(int)", NativeTrace);
+
+    SProgram program;
+    if (CreateProgram(s_functions, strlen(s_functions), &natives, &program) != R_OK)
+    {
+        DeleteNativeTable(&natives);
+        return Report("TestBatch", HS_FALSE);
+    }
+    DeleteNativeTable(&natives);
+
+    SScriptContext context;
+    InitScriptContext(&context, &program);
+
+    enum { ROWS = 100 };
+    hsbint values[ROWS];
+    hsbfloat factors[ROWS];
+    hsbfloat scaled[ROWS];
+    hsbint signs[ROWS];
+    for (int row = 0; row < ROWS; ++row)
+    {
+        values[row] = row % 7 - 3;
+        factors[row] = row * 0.25f;
+    }
+
+    const void* scaleInputs[] = { values, factors };
+    const void* signInputs[] = { values };
+    Bool8 testResult = CallFunctionBatch(&context, FindFunction(&program, "scale"), scaleInputs, 2, scaled, ROWS) == R_OK
+        && CallFunctionBatch(&context, FindFunction(&program, "sign"), signInputs, 1, signs, ROWS) == R_OK;
+
+    for (int row = 0; row < ROWS && testResult; ++row)
+    {
+        SScriptValue arguments[] = { { .i = values[row] }, { .f = factors[row] } };
+        SScriptValue result;
+        testResult = CallFunction(&context, FindFunction(&program, "scale"), arguments, 2, &result) == R_OK
+            && result.f == scaled[row]
+            && signs[row] == (values[row] > 0) - (values[row] < 0);
+    }
+
+    // Without a result, and without rows
+    hsbint traceValues[] = { 1, 2, 3 };
+    const void* traceInputs[] = { traceValues };
+    s_traced = 0;
+    testResult = testResult
+        && CallFunctionBatch(&context, FindFunction(&program, "traceTwice"), traceInputs, 1, NULL, 3) == R_OK
+        && s_traced == 122436
+        && CallFunctionBatch(&context, FindFunction(&program, "traceTwice"), traceInputs, 1, NULL, 0) == R_OK
+        && s_traced == 122436
+        && CallFunctionBatch(&context, FindFunction(&program, "traceTwice"), traceInputs, 2, NULL, 3) == R_ERROR;
+
+    DeleteScriptContext(&context);
+    DeleteProgram(&program);
+    return Report("TestBatch", testResult);
+}
+
+// The rows before the one that overflows the stack have their results
+int TestBatchError()
+{
+    char code[] = "fun depth(n: int): int { if (n == 0) return 0; return depth(n - 1) + 1; }\n";
+
+    SProgram program;
+    if (CreateProgram(code, strlen(code), NULL, &program) != R_OK)
+        return Report("TestBatchError", HS_FALSE);
+
+    SScriptContext context;
+    InitScriptContext(&context, &program);
+
+    hsbint depths[] = { 3, 10, 30000, 5 };
+    hsbint results[] = { -1, -1, -1, -1 };
+    const void* inputs[] = { depths };
+    Bool8 testResult = CallFunctionBatch(&context, 0, inputs, 1, results, 4) == R_ERROR
+        && context.vmData.error == VM_ERROR_STACK_OVERFLOW
+        && results[0] == 3 && results[1] == 10 && results[2] == -1 && results[3] == -1;
+
+    testResult = testResult && CallFunctionBatch(&context, 0, inputs, 1, results, 2) == R_OK
+        && results[0] == 3 && results[1] == 10;
+
+    DeleteScriptContext(&context);
+    DeleteProgram(&program);
+    return Report("TestBatchError", testResult);
+}
+
+static Bool8 FailsToCompile(char* code)
+{
+    SProgram program;
+    if (CreateProgram(code, strlen(code), NULL, &program) == R_OK)
+    {
+        DeleteProgram(&program);
+        return HS_FALSE;
+    }
+    return HS_TRUE;
+}
+
+// Calls have to match the function, functions have to return their result
+int TestErrors()
+{
+    char code[] = "fun add(a: int, b: int): int { return a + b; }";
+    SProgram program;
+    if (CreateProgram(code, strlen(code), NULL, &program) != R_OK)
+        return Report("TestErrors", HS_FALSE);
+
+    SScriptContext context;
+    InitScriptContext(&context, &program);
+    SScriptValue arguments[] = { { .i = 1 }, { .i = 2 } };
+    SScriptValue result;
+    Bool8 testResult = CallFunction(&context, 0, arguments, 1, &result) == R_ERROR
+        && CallFunction(&context, 1, arguments, 2, &result) == R_ERROR
+        && CallFunction(&context, -1, arguments, 2, &result) == R_ERROR
+        && CallFunction(&context, 0, arguments, 2, &result) == R_OK && result.i == 3;
+    DeleteScriptContext(&context);
+    DeleteProgram(&program);
+
+    char outside[] = "return 1;";
+    char noReturn[] = "fun f(a: int): int { if (a < 0) return 0; }";
+    char returnType[] = "fun f(a: int): float { return a; }";
+    char returnValue[] = "fun f(a: int) { return a; }";
+    char returnNothing[] = "fun f(a: int): int { return; }";
+    char duplicate[] = "fun f() { } fun f() { }";
+    char nested[] = "fun f() { fun g() { } }";
+    char parameterType[] = "fun f(a: bool) { }";
+    char globals[] = "var g: int = 1; fun f(): int { return g; }";
+    char arguments3[] = "fun f(a: int) { } var i: int = 0; f(i, i);";
+    char unusedResult[] = "fun f(): int { return 1; } f();";
+
+    testResult = testResult
+        && FailsToCompile(outside)
+        && FailsToCompile(noReturn)
+        && FailsToCompile(returnType)
+        && FailsToCompile(returnValue)
+        && FailsToCompile(returnNothing)
+        && FailsToCompile(duplicate)
+        && FailsToCompile(nested)
+        && FailsToCompile(parameterType)
+        && FailsToCompile(globals)
+        && FailsToCompile(arguments3)
+        && FailsToCompile(unusedResult);
+
+    return Report("TestErrors", testResult);
+}
+
+int main()
+{
+    int fails = 0;
+
+    fails += TestCallFunctions();
+    fails += TestCallsFromMain();
+    fails += TestRecursion();
+    fails += TestTailRecursion();
+    fails += TestContexts();
+    fails += TestBatch();
+    fails += TestBatchError();
+    fails += TestErrors();
+
+    printf("\n%d tests failed\n", fails);
+    return fails;
+}
@@ -0,0 +1,219 @@
+#if defined(__unix__) || defined(__APPLE__)
+    // sigaction and mmap flags are not part of C99
+    #define _DEFAULT_SOURCE
+    #define _DARWIN_C_SOURCE
+#endif
+
+#include <stdio.h>
+
+#include "bytecode_c.h"
+#include "guarded_stack.h"
+#include "test_util.h"
+
+#if HS_GUARDED_STACK_SUPPORTED
+#include <setjmp.h>
+#include <signal.h>
+#include <sys/mman.h>
+#endif
+
+// Runs the program in a guarded VM, returns how it stopped
+static EVMError RunGuarded(SStackData instructions, int dataSize)
+{
+    SVMData vmData;
+    FuncArray funcArray = { 0 };
+    InitGuardedVM(&vmData, instructions, dataSize, funcArray);
+
+    while (VMProcessInstructionsGuarded(&vmData, 1000))
+    {
+    }
+
+    EVMError error = vmData.error;
+    DeleteGuardedVM(&vmData, HS_FALSE, HS_TRUE);
+    return error;
+}
+
+#if HS_GUARDED_STACK_SUPPORTED
+static sigjmp_buf s_hostJump;
+static int s_hostFaults;
+
+static void OnHostFault(int signal, siginfo_t* info, void* context)
+{
+    ++s_hostFaults;
+    siglongjmp(s_hostJump, 1);
+}
+
+// A handler of the host installed before the first guarded VM still gets its own faults, more
+// than once, and the guard pages keep working after them. Has to run first.
+int TestHostFaults()
+{
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_sigaction = OnHostFault;
+    action.sa_flags = SA_SIGINFO | SA_NODEFER;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGSEGV, &action, NULL);
+    sigaction(SIGBUS, &action, NULL);
+
+    SStackData instructionStack = CreateStack(100);
+    AddInstruction(&instructionStack, INS_END);
+    SVMData vmData;
+    FuncArray funcArray = { 0 };
+    InitGuardedVM(&vmData, Finish(instructionStack), 200, funcArray);
+    DeleteGuardedVM(&vmData, HS_FALSE, HS_TRUE);
+
+    volatile byte* page = mmap(NULL, 1, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    for (int i = 0; i < 3; ++i)
+    {
+        if (!sigsetjmp(s_hostJump, 0))
+            *page = 1;
+    }
+    munmap((void*)page, 1);
+
+    // LITERAL_I 1, JUMP 0
+    instructionStack = CreateStack(100);
+    AddInt(&instructionStack, INS_LITERAL_I, 1);
+    AddJump(&instructionStack, INS_JUMP, 0);
+
+    Bool8 testResult = s_hostFaults == 3 && RunGuarded(Finish(instructionStack), 200) == VM_ERROR_STACK_OVERFLOW;
+    return Report("TestHostFaults", testResult);
+}
+#endif
+
+int TestProgram()
+{
+    SStackData instructionStack = CreateStack(100);
+    AddInstruction(&instructionStack, INS_ALLOC_VAR_I);
+    AddInt(&instructionStack, INS_LITERAL_I, 40);
+    AddInt(&instructionStack, INS_LITERAL_I, 2);
+    AddInstruction(&instructionStack, INS_ADD_I);
+    AddInstruction(&instructionStack, INS_SAVE_VAR_I);
+    *instructionStack.stackPointer++ = 0;
+    AddInstruction(&instructionStack, INS_END);
+
+    SVMData vmData;
+    FuncArray funcArray = { 0 };
+    InitGuardedVM(&vmData, Finish(instructionStack), 200, funcArray);
+
+    while (VMProcessInstructionsGuarded(&vmData, 1))
+    {
+    }
+
+    Bool8 testResult = vmData.error == VM_OK
+        && *vmData.instructionStack.stackPointer == INS_END
+        && LoadVarInt(vmData.dataStack.reversePointer) == 42;
+
+    DeleteGuardedVM(&vmData, HS_FALSE, HS_TRUE);
+    return Report("TestProgram", testResult);
+}
+
+int TestOperandOverflow()
+{
+    // LITERAL_I 1, JUMP 0
+    SStackData instructionStack = CreateStack(100);
+    AddInt(&instructionStack, INS_LITERAL_I, 1);
+    AddJump(&instructionStack, INS_JUMP, 0);
+
+    return Report("TestOperandOverflow", RunGuarded(Finish(instructionStack), 200) == VM_ERROR_STACK_OVERFLOW);
+}
+
+int TestVariableOverflow()
+{
+    // ALLOC_VAR_I, JUMP 0
+    SStackData instructionStack = CreateStack(100);
+    AddInstruction(&instructionStack, INS_ALLOC_VAR_I);
+    AddJump(&instructionStack, INS_JUMP, 0);
+
+    return Report("TestVariableOverflow", RunGuarded(Finish(instructionStack), 200) == VM_ERROR_STACK_OVERFLOW);
+}
+
+int TestUnderflow()
+{
+    SStackData instructionStack = CreateStack(100);
+    AddInstruction(&instructionStack, INS_ADD_I);
+    AddInstruction(&instructionStack, INS_END);
+
+    return Report("TestUnderflow", RunGuarded(Finish(instructionStack), 200) == VM_ERROR_STACK_OVERFLOW);
+}
+
+int TestVMsAreIndependent()
+{
+    // An overflowing VM does not affect another one
+    SStackData overflowStack = CreateStack(100);
+    AddInt(&overflowStack, INS_LITERAL_I, 1);
+    AddJump(&overflowStack, INS_JUMP, 0);
+
+    SStackData programStack = CreateStack(100);
+    AddInt(&programStack, INS_LITERAL_I, 7);
+    AddInstruction(&programStack, INS_END);
+
+    SVMData overflowVM;
+    SVMData programVM;
+    FuncArray funcArray = { 0 };
+    InitGuardedVM(&overflowVM, Finish(overflowStack), 64, funcArray);
+    InitGuardedVM(&programVM, Finish(programStack), 64, funcArray);
+
+    while (VMProcessInstructionsGuarded(&overflowVM, 1000))
+    {
+    }
+    while (VMProcessInstructionsGuarded(&programVM, 1000))
+    {
+    }
+
+    Bool8 testResult = overflowVM.error == VM_ERROR_STACK_OVERFLOW
+        && !VMProcessInstructionsGuarded(&overflowVM, 1)
+        && programVM.error == VM_OK
+        && LoadVarInt(programVM.dataStack.base.begin) == 7;
+
+    DeleteGuardedVM(&overflowVM, HS_FALSE, HS_TRUE);
+    DeleteGuardedVM(&programVM, HS_FALSE, HS_TRUE);
+    return Report("TestVMsAreIndependent", testResult);
+}
+
+int TestLazyCommit()
+{
+    // A large reservation only costs the pages the program touches
+    const int reserved = 64 * 1024 * 1024;
+
+    SStackData instructionStack = CreateStack(100);
+    AddInstruction(&instructionStack, INS_ALLOC_VAR_I);
+    AddInt(&instructionStack, INS_LITERAL_I, 1);
+    AddInstruction(&instructionStack, INS_END);
+
+    SVMData vmData;
+    FuncArray funcArray = { 0 };
+    InitGuardedVM(&vmData, Finish(instructionStack), reserved, funcArray);
+
+    while (VMProcessInstructionsGuarded(&vmData, 1000))
+    {
+    }
+
+    int resident = GetGuardedStackResidentSize(&vmData);
+    Bool8 testResult = vmData.error == VM_OK
+        && resident > 0
+        && resident <= 2 * 64 * 1024;
+
+    DeleteGuardedVM(&vmData, HS_FALSE, HS_TRUE);
+    return Report("TestLazyCommit", testResult);
+}
+
+int main()
+{
+    int fails = 0;
+
+#if HS_GUARDED_STACK_SUPPORTED
+    fails += TestHostFaults();
+#endif
+    fails += TestProgram();
+#if HS_GUARDED_STACK_SUPPORTED
+    fails += TestOperandOverflow();
+    fails += TestVariableOverflow();
+    fails += TestUnderflow();
+    fails += TestVMsAreIndependent();
+    fails += TestLazyCommit();
+#else
+    printf("Guard pages are not supported on this platform, overflow tests skipped\n");
+#endif
+
+    printf("\n%d tests failed\n", fails);
+    return fails;
+}
@@ -0,0 +1,346 @@
+#include <stdio.h>
+#include <limits.h>
+
+#include "bytecode_c.h"
+#include "compiler.h"
+#include "file.h"
+#include "ir.h"
+#include "tokenizer.h"
+#include "verifier.h"
+#include "test_util.h"
+
+// The IR of each script is checked in next to the test as it is built and after OptimizeIR.
+// After a change to the IR or its passes run the test from Data/ with -update to rewrite them.
+
+static const int DATA_SIZE = 1024;
+
+typedef struct
+{
+    const char* name;
+    const char* script; // NULL for the ones written below
+    const char* code;
+    const char* dump;
+} SIRScript;
+
+static const SIRScript SCRIPTS[] =
+{
+    { "Fibonacci", "Fibonacci.hss", NULL, "../Script/test/ir/Fibonacci.txt" },
+    { "Physics", "Physics.hss", NULL, "../Script/test/ir/Physics.txt" },
+    { "Primes", "Primes.hss", NULL, "../Script/test/ir/Primes.txt" },
+    { "Sum", "Sum.hss", NULL, "../Script/test/ir/Sum.txt" },
+    {
+        "Invariants", NULL,
+        "var j: int = 0; while (j < 3) { j = j + 1; }"
+        "var k: int = j * 5; var b: int = 0; var i: int = 0;"
+        "while (i < 10) { b = b + k * k + k / 5; i = i + 1; }",
+        "../Script/test/ir/Invariants.txt"
+    },
+    {
+        "Common", NULL,
+        "var x: int = 0; var y: int = 0; var i: int = 0;"
+        "while (i < 10) { x = x + i * 3; y = y + 3 * i; if (i * 3 < 9) { x = x - 1; } i = i + 1; }",
+        "../Script/test/ir/Common.txt"
+    },
+    {
+        "Dead", NULL,
+        "var a: int = 5; var b: int = 0; if (a < 3) { b = 1; } else { b = 2; }"
+        "var unused: int = b * 4; unused = 3; while (0 == 1) { a = a + 1; }",
+        "../Script/test/ir/Dead.txt"
+    },
+    {
+        "Swap", NULL,
+        "var a: int = 1; var b: int = 2; var i: int = 0;"
+        "while (i < 5) { var t: int = a; a = b; b = t + b; i = i + 1; }",
+        "../Script/test/ir/Swap.txt"
+    },
+    {
+        "Floats", NULL,
+        "var f: float = 0.0; var n: int = 0;"
+        "while (f < 2.5) { f = f + 0.5; if (f >= 1.0) { n = n + 1; } else { n = n - 1; } }"
+        "var nan: float = 0.0 / 0.0; var c: int = 0; if (nan >= 1.0) { c = 1; }",
+        "../Script/test/ir/Floats.txt"
+    },
+    {
+        "Switch", NULL,
+        "var a: int = 0; var b: int = 0; var i: int = 0;"
+        "while (i < 8) { switch (i) { case 0: case 1: a = a + 1; case 2: b = b + a; case 4: a = b; case 5: b = 0; default: a = a + i; }"
+        "switch (i * 7) { case 14: b = b + 1; case -7: b = 1; case 700: a = 0; } i = i + 1; }",
+        "../Script/test/ir/Switch.txt"
+    },
+};
+
+static const int NUM_SCRIPTS = sizeof(SCRIPTS) / sizeof(SCRIPTS[0]);
+
+// The code of the script as a zero terminated string
+static char* ReadScript(const SIRScript* script)
+{
+    if (!script->script)
+    {
+        char* code = malloc(strlen(script->code) + 1);
+        strcpy(code, script->code);
+        return code;
+    }
+
+    char* code;
+    int size;
+    return ReadFile(script->script, &code, &size) ? code : NULL;
+}
+
+static Bool8 BuildScriptIR(const SIRScript* script, SIRProgram* outProgram)
+{
+    char* code = ReadScript(script);
+    if (!code)
+        return HS_FALSE;
+
+    SToken* tokens;
+    int tokenCount;
+    SASTNode* root;
+    Bool8 result = Tokenize(code, strlen(code), &tokens, &tokenCount) == R_OK;
+    if (result)
+    {
+        result = Parse(tokens, tokenCount, &root) == R_OK && BuildIR(root, outProgram) == R_OK;
+        FreeTokens(&tokens, &tokenCount);
+    }
+
+    free(code);
+    return result;
+}
+
+static Bool8 CompileScript(const SIRScript* script, int level, SStackData* outInstructions)
+{
+    char* code = ReadScript(script);
+    if (!code)
+        return HS_FALSE;
+
+    Bool8 result = CompileSourceOptimized(code, strlen(code), level, outInstructions) == R_OK;
+    free(code);
+    return result;
+}
+
+// Both dumps as a zero terminated string
+static char* Dump(const SIRScript* script)
+{
+    SIRProgram program;
+    if (!BuildScriptIR(script, &program))
+        return NULL;
+
+    FILE* file = tmpfile();
+    if (!file)
+    {
+        FreeIR(&program);
+        return NULL;
+    }
+
+    fprintf(file, "; built\n");
+    DumpIR(&program, file);
+    OptimizeIR(&program);
+    fprintf(file, "; optimized\n");
+    DumpIR(&program, file);
+    FreeIR(&program);
+
+    long size = ftell(file);
+    rewind(file);
+    char* text = malloc(size + 1);
+    text[fread(text, 1, size, file)] = 0;
+    fclose(file);
+    return text;
+}
+
+// Runs the program to the end, returns the number of instructions dispatched
+static int Run(SStackData instructions, SVMData* vmData)
+{
+    FuncArray funcArray = { 0 };
+    InitVM(vmData, instructions, DATA_SIZE, funcArray);
+
+    int count = 0;
+    while (VMProcessInstructions(vmData, 1))
+        ++count;
+    return count;
+}
+
+static Bool8 IsSameResult(const SVMData* a, const SVMData* b)
+{
+    int operandSize = a->dataStack.base.stackPointer - a->dataStack.base.begin;
+    int varSize = a->dataStack.base.end - a->dataStack.reversePointer;
+    return b->dataStack.base.stackPointer - b->dataStack.base.begin == operandSize
+        && b->dataStack.base.end - b->dataStack.reversePointer == varSize
+        && memcmp(a->dataStack.reversePointer, b->dataStack.reversePointer, varSize) == 0
+        && a->error == VM_OK && b->error == VM_OK;
+}
+
+int TestDumpsUpToDate()
+{
+    Bool8 testResult = HS_TRUE;
+    for (int i = 0; i < NUM_SCRIPTS; ++i)
+    {
+        char* expected;
+        int size;
+        if (!ReadFile(SCRIPTS[i].dump, &expected, &size))
+            return Report("TestDumpsUpToDate", HS_FALSE);
+
+        char* text = Dump(&SCRIPTS[i]);
+        if (!text || strcmp(text, expected) != 0)
+        {
+            printf("%s is out of date\n", SCRIPTS[i].dump);
+            testResult = HS_FALSE;
+        }
+
+        free(text);
+        free(expected);
+    }
+
+    return Report("TestDumpsUpToDate", testResult);
+}
+
+// The globals end up the same with and without the passes, in fewer dispatches with them
+int TestSameAsCompile()
+{
+    Bool8 testResult = HS_TRUE;
+    for (int i = 0; i < NUM_SCRIPTS; ++i)
+    {
+        SStackData compiled;
+        SStackData optimized;
+        if (!CompileScript(&SCRIPTS[i], 0, &compiled) || !CompileScript(&SCRIPTS[i], 1, &optimized))
+            return Report("TestSameAsCompile", HS_FALSE);
+
+        SVMData expected;
+        SVMData vmData;
+        int compiledCount = Run(compiled, &expected);
+        int optimizedCount = Run(optimized, &vmData);
+        if (!IsSameResult(&expected, &vmData) || optimizedCount >= compiledCount)
+        {
+            printf("%s differs, %d and %d dispatches\n", SCRIPTS[i].name, compiledCount, optimizedCount);
+            testResult = HS_FALSE;
+        }
+
+        DeleteVM(&expected, HS_FALSE, HS_TRUE);
+        DeleteVM(&vmData, HS_FALSE, HS_TRUE);
+    }
+
+    return Report("TestSameAsCompile", testResult);
+}
+
+// Lowering does not depend on the passes having run
+int TestLowerUnoptimized()
+{
+    Bool8 testResult = HS_TRUE;
+    for (int i = 0; i < NUM_SCRIPTS; ++i)
+    {
+        SIRProgram program;
+        SStackData compiled;
+        SStackData lowered;
+        if (!BuildScriptIR(&SCRIPTS[i], &program) || !CompileScript(&SCRIPTS[i], 0, &compiled))
+            return Report("TestLowerUnoptimized", HS_FALSE);
+
+        EResult r = LowerIR(&program, &lowered);
+        FreeIR(&program);
+        if (r != R_OK)
+        {
+            DeleteStack(compiled);
+            return Report("TestLowerUnoptimized", HS_FALSE);
+        }
+
+        SVMData expected;
+        SVMData vmData;
+        Run(compiled, &expected);
+        Run(lowered, &vmData);
+        if (!IsSameResult(&expected, &vmData))
+        {
+            printf("%s differs\n", SCRIPTS[i].name);
+            testResult = HS_FALSE;
+        }
+
+        DeleteVM(&expected, HS_FALSE, HS_TRUE);
+        DeleteVM(&vmData, HS_FALSE, HS_TRUE);
+    }
+
+    return Report("TestLowerUnoptimized", testResult);
+}
+
+int TestVerified()
+{
+    Bool8 testResult = HS_TRUE;
+    for (int i = 0; i < NUM_SCRIPTS; ++i)
+    {
+        SStackData instructions;
+        SVerifyResult result;
+        if (!CompileScript(&SCRIPTS[i], 1, &instructions))
+            return Report("TestVerified", HS_FALSE);
+
+        if (VerifyInstructions(instructions, INT_MAX, &result) != R_OK)
+        {
+            printf("%s does not verify\n", SCRIPTS[i].name);
+            testResult = HS_FALSE;
+        }
+        DeleteStack(instructions);
+    }
+
+    return Report("TestVerified", testResult);
+}
+
+int TestErrors()
+{
+    const char* invalid[] =
+    {
+        "var x: int = 1.0;",
+        "x = 1;",
+        "var x: int; x + 1;",
+        "var x: float; if (x) x = 1.0;",
+        "var x: bool;",
+        "var x: int = 40000;",
+    };
+
+    Bool8 testResult = HS_TRUE;
+    for (int i = 0; i < (int)(sizeof(invalid) / sizeof(invalid[0])); ++i)
+    {
+        char code[256];
+        strcpy(code, invalid[i]);
+
+        SStackData instructions;
+        if (CompileSourceOptimized(code, strlen(code), 1, &instructions) == R_OK)
+        {
+            DeleteStack(instructions);
+            testResult = HS_FALSE;
+        }
+    }
+
+    return Report("TestErrors", testResult);
+}
+
+// Rewrites the checked in dumps
+static int Update()
+{
+    for (int i = 0; i < NUM_SCRIPTS; ++i)
+    {
+        char* text = Dump(&SCRIPTS[i]);
+        FILE* file = fopen(SCRIPTS[i].dump, "wb");
+        if (!text || !file)
+        {
+            printf("Failed to update %s\n", SCRIPTS[i].dump);
+            return 1;
+        }
+
+        fputs(text, file);
+        fclose(file);
+        free(text);
+        printf("Updated %s\n", SCRIPTS[i].dump);
+    }
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc > 1 && strcmp(argv[1], "-update") == 0)
+        return Update();
+
+    int fails = 0;
+
+    fails += TestDumpsUpToDate();
+    fails += TestSameAsCompile();
+    fails += TestLowerUnoptimized();
+    fails += TestVerified();
+    fails += TestErrors();
+
+    printf("\n%d tests failed\n", fails);
+    return fails;
+}
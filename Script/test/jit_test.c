@@ -0,0 +1,456 @@
+#include <stdio.h>
+
+#include "bytecode_c.h"
+#include "compiler.h"
+#include "file.h"
+#include "jit.h"
+#include "optimizer.h"
+#include "test_util.h"
+
+// Differential tests, every program runs in the interpreter (VMRunVerified) and as JIT code
+// and both have to leave the same data stack behind.
+
+static const int DATA_SIZE = 1024;
+
+static int s_nativeCalls;
+
+// float(int, float, int)
+static void NativeMix(SVMData* vmData)
+{
+    hsbint b = PopInt(&vmData->dataStack.base.stackPointer);
+    hsbfloat f = PopFloat(&vmData->dataStack.base.stackPointer);
+    hsbint a = PopInt(&vmData->dataStack.base.stackPointer);
+    PushFloat(&vmData->dataStack.base.stackPointer, a * f - b);
+}
+
+// void()
+static void NativeCount(SVMData* vmData)
+{
+    ++s_nativeCalls;
+}
+
+// int()
+static void NativeCalls(SVMData* vmData)
+{
+    PushInt(&vmData->dataStack.base.stackPointer, s_nativeCalls);
+}
+
+static NativeFP* s_natives[] = { NativeMix, NativeCount, NativeCalls };
+
+// Runs both and compares the operands, the variables and the final instruction
+static Bool8 IsSameAsInterpreter(SStackData instructions)
+{
+    SJitCode code;
+    if (JitCompile(instructions, DATA_SIZE, &code) != R_OK)
+        return HS_FALSE;
+
+    SVMData interpreted;
+    SVMData jitted;
+    FuncArray funcArray = { sizeof(s_natives) / sizeof(s_natives[0]), s_natives };
+    InitVM(&interpreted, instructions, DATA_SIZE, funcArray);
+    InitVM(&jitted, instructions, DATA_SIZE, funcArray);
+
+    s_nativeCalls = 0;
+    VMRunVerified(&interpreted);
+    s_nativeCalls = 0;
+    VMRunJit(&jitted, &code);
+
+    int operandSize = interpreted.dataStack.base.stackPointer - interpreted.dataStack.base.begin;
+    int varSize = interpreted.dataStack.base.end - interpreted.dataStack.reversePointer;
+    Bool8 result = jitted.dataStack.base.stackPointer - jitted.dataStack.base.begin == operandSize
+        && jitted.dataStack.base.end - jitted.dataStack.reversePointer == varSize
+        && memcmp(interpreted.dataStack.base.begin, jitted.dataStack.base.begin, operandSize) == 0
+        && memcmp(interpreted.dataStack.reversePointer, jitted.dataStack.reversePointer, varSize) == 0
+        && jitted.instructionStack.stackPointer == interpreted.instructionStack.stackPointer
+        && *jitted.instructionStack.stackPointer == INS_END;
+
+    DeleteVM(&interpreted, HS_TRUE, HS_TRUE);
+    DeleteVM(&jitted, HS_TRUE, HS_TRUE);
+    FreeJitCode(&code);
+    return result;
+}
+
+static int Compare(const char* name, SStackData instructionStack)
+{
+    SStackData instructions = Finish(instructionStack);
+    Bool8 testResult = IsSameAsInterpreter(instructions);
+    DeleteStack(instructions);
+    return Report(name, testResult);
+}
+
+int TestIntArithmetic()
+{
+    SStackData s = CreateStack(200);
+    EInstruction ops[] = { INS_ADD_I, INS_SUBSTRACT_I, INS_MULTIPLY_I, INS_DIVIDE_I };
+    hsbint values[][2] = { { 7, 3 }, { -7, 3 }, { 32767, 2 }, { -32768, -1 }, { 100, -7 } };
+    for (int op = 0; op < 4; ++op)
+    {
+        for (int v = 0; v < 5; ++v)
+        {
+            AddInt(&s, INS_LITERAL_I, values[v][0]);
+            AddInt(&s, INS_LITERAL_I, values[v][1]);
+            AddInstruction(&s, ops[op]);
+        }
+    }
+    AddInstruction(&s, INS_END);
+    return Compare("TestIntArithmetic", s);
+}
+
+int TestFloatArithmetic()
+{
+    SStackData s = CreateStack(200);
+    EInstruction ops[] = { INS_ADD_F, INS_SUBSTRACT_F, INS_MULTIPLY_F, INS_DIVIDE_F };
+    hsbfloat values[][2] = { { 1.5f, 0.25f }, { -3.0f, 7.0f }, { 1e30f, 1e30f }, { 1.0f, 0.0f } };
+    for (int op = 0; op < 4; ++op)
+    {
+        for (int v = 0; v < 4; ++v)
+        {
+            AddFloat(&s, INS_LITERAL_F, values[v][0]);
+            AddFloat(&s, INS_LITERAL_F, values[v][1]);
+            AddInstruction(&s, ops[op]);
+        }
+    }
+    AddInstruction(&s, INS_END);
+    return Compare("TestFloatArithmetic", s);
+}
+
+int TestCompare()
+{
+    SStackData s = CreateStack(400);
+    EInstruction intOps[] = { INS_CMP_I_EQ, INS_CMP_I_LESS, INS_CMP_I_LESS_EQ };
+    EInstruction floatOps[] = { INS_CMP_F_EQ, INS_CMP_F_LESS, INS_CMP_F_LESS_EQ };
+    hsbint ints[][2] = { { 1, 2 }, { 2, 1 }, { 5, 5 }, { -3, 3 } };
+    hsbfloat floats[][2] = { { 1.0f, 2.0f }, { 2.0f, 1.0f }, { 5.0f, 5.0f }, { -0.0f, 0.0f } };
+    for (int op = 0; op < 3; ++op)
+    {
+        for (int v = 0; v < 4; ++v)
+        {
+            AddInt(&s, INS_LITERAL_I, ints[v][0]);
+            AddInt(&s, INS_LITERAL_I, ints[v][1]);
+            AddInstruction(&s, intOps[op]);
+            AddFloat(&s, INS_LITERAL_F, floats[v][0]);
+            AddFloat(&s, INS_LITERAL_F, floats[v][1]);
+            AddInstruction(&s, floatOps[op]);
+        }
+
+        // NaN compares false
+        AddFloat(&s, INS_LITERAL_F, 0.0f);
+        AddFloat(&s, INS_LITERAL_F, 0.0f);
+        AddInstruction(&s, INS_DIVIDE_F);
+        AddFloat(&s, INS_LITERAL_F, 1.0f);
+        AddInstruction(&s, floatOps[op]);
+    }
+    AddInstruction(&s, INS_END);
+    return Compare("TestCompare", s);
+}
+
+int TestBool()
+{
+    SStackData s = CreateStack(200);
+    for (int first = 0; first < 2; ++first)
+    {
+        for (int second = 0; second < 2; ++second)
+        {
+            AddBool(&s, first);
+            AddBool(&s, second);
+            AddInstruction(&s, INS_AND_B);
+            AddBool(&s, first);
+            AddBool(&s, second);
+            AddInstruction(&s, INS_OR_B);
+            AddInstruction(&s, INS_NEGATE_B);
+        }
+    }
+    AddInstruction(&s, INS_NOOP);
+    AddInstruction(&s, INS_END);
+    return Compare("TestBool", s);
+}
+
+int TestVariables()
+{
+    // float f = 2.5; int i = -3; i = i * i; f = f + f; int j; j = i; float g; g = f
+    SStackData s = CreateStack(200);
+    AddInstruction(&s, INS_ALLOC_VAR_F);
+    AddInstruction(&s, INS_ALLOC_VAR_I);
+    AddFloat(&s, INS_LITERAL_F, 2.5f);
+    AddOffset(&s, INS_SAVE_VAR_F, HS_DATA_SIZE_INT);
+    AddInt(&s, INS_LITERAL_I, -3);
+    AddOffset(&s, INS_SAVE_VAR_I, 0);
+    AddOffset(&s, INS_LOAD_VAR_I, 0);
+    AddOffset(&s, INS_LOAD_VAR_I, 0);
+    AddInstruction(&s, INS_MULTIPLY_I);
+    AddOffset(&s, INS_SAVE_VAR_I, 0);
+    AddOffset(&s, INS_LOAD_VAR_F, HS_DATA_SIZE_INT);
+    AddOffset(&s, INS_LOAD_VAR_F, HS_DATA_SIZE_INT);
+    AddInstruction(&s, INS_ADD_F);
+    AddOffset(&s, INS_SAVE_VAR_F, HS_DATA_SIZE_INT);
+    AddInstruction(&s, INS_ALLOC_VAR_I);
+    AddOffset(&s, INS_LOAD_VAR_I, HS_DATA_SIZE_INT);
+    AddOffset(&s, INS_SAVE_VAR_I, 0);
+    AddInstruction(&s, INS_ALLOC_VAR_F);
+    AddOffset(&s, INS_LOAD_VAR_F, HS_DATA_SIZE_FLOAT + 2 * HS_DATA_SIZE_INT);
+    AddOffset(&s, INS_SAVE_VAR_F, 0);
+    AddInstruction(&s, INS_DEALLOC_VAR_F);
+    AddInstruction(&s, INS_END);
+    return Compare("TestVariables", s);
+}
+
+int TestLoopAndCall()
+{
+    //  0 main: ALLOC_VAR_I, LITERAL_I 0, SAVE_VAR_I 0
+    //    loop: LOAD_VAR_I 0, CALL twice, SAVE_VAR_I 0, LOAD_VAR_I 0, LITERAL_I 1000, CMP_I_LESS, COND_JUMP_B loop
+    //          END
+    //    twice: LITERAL_I 2, MULTIPLY_I, LITERAL_I 1, ADD_I, RETURN
+    SStackData s = CreateStack(200);
+    AddInstruction(&s, INS_ALLOC_VAR_I);
+    AddInt(&s, INS_LITERAL_I, 0);
+    AddOffset(&s, INS_SAVE_VAR_I, 0);
+    hsbaddress loop = Here(&s);
+    AddOffset(&s, INS_LOAD_VAR_I, 0);
+    hsbaddress call = Here(&s);
+    AddJump(&s, INS_CALL, 0);
+    AddOffset(&s, INS_SAVE_VAR_I, 0);
+    AddOffset(&s, INS_LOAD_VAR_I, 0);
+    AddInt(&s, INS_LITERAL_I, 1000);
+    AddInstruction(&s, INS_CMP_I_LESS);
+    AddJump(&s, INS_COND_JUMP_B, loop);
+    AddInstruction(&s, INS_END);
+    hsbaddress twice = Here(&s);
+    AddInt(&s, INS_LITERAL_I, 2);
+    AddInstruction(&s, INS_MULTIPLY_I);
+    AddInt(&s, INS_LITERAL_I, 1);
+    AddInstruction(&s, INS_ADD_I);
+    AddInstruction(&s, INS_RETURN);
+    StoreAddress(s.begin + call + 1, twice);
+
+    return Compare("TestLoopAndCall", s);
+}
+
+// Natives called from main and from a function with variables allocated, the results and
+// the calls counted by the natives are the same
+int TestNativeCalls()
+{
+    //  0 main: ALLOC_VAR_I, ALLOC_VAR_F
+    //    loop: LOAD_VAR_I 0, CALL function, SAVE_VAR_F 0, CALL_EXT count, CALL_EXT calls, SAVE_VAR_I, ...
+    //          LOAD_VAR_I, LITERAL_I 50, CMP_I_LESS, COND_JUMP_B loop, CALL_EXT calls, END
+    //    function: ALLOC_VAR_I, LITERAL_F 1.5, LITERAL_I 3, CALL_EXT mix, DEALLOC_VAR_I, RETURN
+    SStackData s = CreateStack(200);
+    AddInstruction(&s, INS_ALLOC_VAR_I);
+    AddInstruction(&s, INS_ALLOC_VAR_F);
+    hsbaddress loop = Here(&s);
+    AddOffset(&s, INS_LOAD_VAR_I, HS_DATA_SIZE_FLOAT);
+    hsbaddress call = Here(&s);
+    AddJump(&s, INS_CALL, 0);
+    AddOffset(&s, INS_SAVE_VAR_F, 0);
+    AddCallExt(&s, 1, 0, 0, NATIVE_NONE);
+    AddCallExt(&s, 2, 0, 0, NATIVE_INT);
+    AddOffset(&s, INS_SAVE_VAR_I, HS_DATA_SIZE_FLOAT);
+    AddOffset(&s, INS_LOAD_VAR_I, HS_DATA_SIZE_FLOAT);
+    AddInt(&s, INS_LITERAL_I, 50);
+    AddInstruction(&s, INS_CMP_I_LESS);
+    AddJump(&s, INS_COND_JUMP_B, loop);
+    AddCallExt(&s, 2, 0, 0, NATIVE_INT);
+    AddInstruction(&s, INS_END);
+    hsbaddress function = Here(&s);
+    AddInstruction(&s, INS_ALLOC_VAR_I);
+    AddFloat(&s, INS_LITERAL_F, 1.5f);
+    AddInt(&s, INS_LITERAL_I, 3);
+    AddCallExt(&s, 0, 3, 2, NATIVE_FLOAT);
+    AddInstruction(&s, INS_DEALLOC_VAR_I);
+    AddInstruction(&s, INS_RETURN);
+    StoreAddress(s.begin + call + 1, function);
+
+    int fails = Compare("TestNativeCalls", s);
+    if (s_nativeCalls != 50)
+    {
+        printf("TestNativeCalls: %d native calls\n", s_nativeCalls);
+        ++fails;
+    }
+    return fails;
+}
+
+int TestSuperinstructions()
+{
+    // i = 0, acc = 1
+    // do { acc = (acc - i + 3) * -2; i = i + 1; if (acc * i == 0) continue; if (i <= 0) break; } while (i < 100)
+    const int I = HS_DATA_SIZE_INT;
+    SStackData s = CreateStack(200);
+    AddInstruction(&s, INS_ALLOC_VAR_I);
+    AddInstruction(&s, INS_ALLOC_VAR_I);
+    AddInt(&s, INS_LITERAL_I, 0);
+    AddOffset(&s, INS_SAVE_VAR_I, I);
+    AddInt(&s, INS_LITERAL_I, 1);
+    AddOffset(&s, INS_SAVE_VAR_I, 0);
+    hsbaddress loop = Here(&s);
+    AddInstruction(&s, INS_LOAD_VAR_VAR_SUBSTRACT_I);
+    *s.stackPointer++ = 0;
+    *s.stackPointer++ = I;
+    AddInt(&s, INS_ADD_LITERAL_I, 3);
+    AddInt(&s, INS_MULTIPLY_LITERAL_I, -2);
+    AddOffset(&s, INS_SAVE_VAR_I, 0);
+    AddOffset(&s, INS_LOAD_VAR_I, I);
+    AddInt(&s, INS_SUBSTRACT_LITERAL_I, -1);
+    AddOffset(&s, INS_SAVE_VAR_I, I);
+    AddInstruction(&s, INS_LOAD_VAR_VAR_MULTIPLY_I);
+    *s.stackPointer++ = 0;
+    *s.stackPointer++ = I;
+    AddInt(&s, INS_LITERAL_I, 0);
+    hsbaddress next = Here(&s) + 1 + sizeof(hsbaddress);
+    AddJump(&s, INS_CMP_I_EQ_JUMP, next);
+    AddInstruction(&s, INS_LOAD_VAR_VAR_ADD_I);
+    *s.stackPointer++ = 0;
+    *s.stackPointer++ = I;
+    AddOffset(&s, INS_SAVE_VAR_I, 0);
+    AddOffset(&s, INS_LOAD_VAR_I, I);
+    AddInt(&s, INS_LITERAL_I, 0);
+    hsbaddress breakJump = Here(&s);
+    AddJump(&s, INS_CMP_I_LESS_EQ_JUMP, 0);
+    AddOffset(&s, INS_LOAD_VAR_I, I);
+    AddInt(&s, INS_LITERAL_I, 100);
+    AddJump(&s, INS_CMP_I_LESS_JUMP, loop);
+    StoreAddress(s.begin + breakJump + 1, Here(&s));
+    AddInstruction(&s, INS_MOVE_VAR_I);
+    *s.stackPointer++ = 0;
+    *s.stackPointer++ = I;
+    AddInstruction(&s, INS_ALLOC_VAR_F);
+    AddFloat(&s, INS_LITERAL_F, 4.5f);
+    AddOffset(&s, INS_SAVE_VAR_F, 0);
+    AddInstruction(&s, INS_ALLOC_VAR_F);
+    AddInstruction(&s, INS_MOVE_VAR_F);
+    *s.stackPointer++ = HS_DATA_SIZE_FLOAT;
+    *s.stackPointer++ = 0;
+    AddInstruction(&s, INS_END);
+    return Compare("TestSuperinstructions", s);
+}
+
+static unsigned int s_seed = 12345;
+
+static int Random(int range)
+{
+    s_seed = s_seed * 1103515245u + 12345u;
+    return (int)((s_seed >> 16) % range);
+}
+
+int TestRandomPrograms()
+{
+    // Straight line int and float expressions, the stack depth stays between 2 and 12 values
+    EInstruction intOps[] = { INS_ADD_I, INS_SUBSTRACT_I, INS_MULTIPLY_I, INS_CMP_I_LESS };
+    EInstruction floatOps[] = { INS_ADD_F, INS_SUBSTRACT_F, INS_MULTIPLY_F, INS_DIVIDE_F, INS_CMP_F_LESS_EQ };
+    Bool8 testResult = HS_TRUE;
+    for (int program = 0; program < 200 && testResult; ++program)
+    {
+        SStackData s = CreateStack(2000);
+        Bool8 isFloat = program % 2;
+        int depth = 0;
+        for (int i = 0; i < 200; ++i)
+        {
+            if (depth < 2 || (depth < 12 && Random(2)))
+            {
+                if (isFloat)
+                    AddFloat(&s, INS_LITERAL_F, (Random(2000) - 1000) / 8.0f);
+                else
+                    AddInt(&s, INS_LITERAL_I, Random(65536) - 32768);
+                ++depth;
+            }
+            else
+            {
+                EInstruction op = isFloat ? floatOps[Random(4)] : intOps[Random(3)];
+                AddInstruction(&s, op);
+                --depth;
+            }
+        }
+
+        // Compare with the last one, the result stays on the stack
+        AddInstruction(&s, isFloat ? floatOps[4] : intOps[3]);
+        AddInstruction(&s, INS_END);
+
+        SStackData instructions = Finish(s);
+        testResult = IsSameAsInterpreter(instructions);
+        DeleteStack(instructions);
+    }
+    return Report("TestRandomPrograms", testResult);
+}
+
+int TestCorpus()
+{
+    const char* corpus[] = { "Sum.hss", "Fibonacci.hss", "Primes.hss", "Physics.hss" };
+
+    Bool8 testResult = HS_TRUE;
+    for (int i = 0; i < 4; ++i)
+    {
+        char* code;
+        int size;
+        SStackData instructions;
+        testResult = testResult && ReadFile(corpus[i], &code, &size)
+            && CompileSource(code, size, &instructions) == R_OK;
+        if (!testResult)
+            break;
+
+        testResult = IsSameAsInterpreter(instructions)
+            && FuseSuperinstructions(&instructions) == R_OK
+            && IsSameAsInterpreter(instructions);
+
+        if (!testResult)
+            printf("%s differs\n", corpus[i]);
+        DeleteStack(instructions);
+        free(code);
+    }
+    return Report("TestCorpus", testResult);
+}
+
+int TestRejectsUnverified()
+{
+    SStackData s = CreateStack(100);
+    AddInstruction(&s, INS_ADD_I);
+    AddInstruction(&s, INS_END);
+
+    SStackData instructions = Finish(s);
+    SJitCode code;
+    Bool8 testResult = JitCompile(instructions, DATA_SIZE, &code) == R_ERROR && code.code == NULL;
+    DeleteStack(instructions);
+    return Report("TestRejectsUnverified", testResult);
+}
+
+// Verified code the templates cannot run yet
+int TestRejectsFrames()
+{
+    SStackData s = CreateStack(100);
+    AddInt(&s, INS_LITERAL_I, 2);
+    AddJump(&s, INS_CALL, 7);
+    AddInstruction(&s, INS_END);
+    AddInstruction(&s, INS_ENTER);
+    *s.stackPointer++ = HS_DATA_SIZE_INT;
+    *s.stackPointer++ = 0;
+    *s.stackPointer++ = 0;
+    AddInstruction(&s, INS_LEAVE);
+
+    SStackData instructions = Finish(s);
+    SJitCode code;
+    Bool8 testResult = JitCompile(instructions, DATA_SIZE, &code) == R_ERROR && code.code == NULL;
+    DeleteStack(instructions);
+    return Report("TestRejectsFrames", testResult);
+}
+
+int main()
+{
+    int fails = 0;
+
+#if HS_JIT_SUPPORTED
+    fails += TestIntArithmetic();
+    fails += TestFloatArithmetic();
+    fails += TestCompare();
+    fails += TestBool();
+    fails += TestVariables();
+    fails += TestLoopAndCall();
+    fails += TestNativeCalls();
+    fails += TestSuperinstructions();
+    fails += TestRandomPrograms();
+    fails += TestCorpus();
+    fails += TestRejectsUnverified();
+    fails += TestRejectsFrames();
+#else
+    printf("The JIT is not supported on this platform, tests skipped\n");
+#endif
+
+    printf("\n%d tests failed\n", fails);
+    return fails;
+}
@@ -0,0 +1,246 @@
+#include <stdio.h>
+
+#include "bytecode_c.h"
+#include "compiler.h"
+#include "natives.h"
+#include "stack_usage.h"
+#include "verifier.h"
+#include "test_util.h"
+
+static const int DATA_SIZE = 200;
+
+static hsbint s_traced;
+
+// int(int, int)
+static void NativeMin(SVMData* vmData)
+{
+    hsbint second = PopInt(&vmData->dataStack.base.stackPointer);
+    hsbint first = PopInt(&vmData->dataStack.base.stackPointer);
+    PushInt(&vmData->dataStack.base.stackPointer, first < second ? first : second);
+}
+
+// float(int, float)
+static void NativeScale(SVMData* vmData)
+{
+    hsbfloat factor = PopFloat(&vmData->dataStack.base.stackPointer);
+    hsbint value = PopInt(&vmData->dataStack.base.stackPointer);
+    PushFloat(&vmData->dataStack.base.stackPointer, value * factor);
+}
+
+// void(int)
+static void NativeTrace(SVMData* vmData)
+{
+    s_traced = s_traced * 10 + PopInt(&vmData->dataStack.base.stackPointer);
+}
+
+static void InitTestNatives(SNativeTable* natives)
+{
+    InitNativeTable(natives);
+    RegisterStandardNatives(natives);
+    RegisterNative(natives, "min", "int(int, int)", NativeMin);
+    RegisterNative(natives, "scale", "float(int,float)", NativeScale);
+    RegisterNative(natives, "trace", "void(int)", NativeTrace);
+}
+
+// Signatures are parsed, names are unique
+int TestRegister()
+{
+    SNativeTable natives;
+    InitTestNatives(&natives);
+
+    int min = FindNative(&natives, "min");
+    int scale = FindNative(&natives, "scale");
+    int trace = FindNative(&natives, "trace");
+    Bool8 testResult = natives.count == 8
+        && min >= 0 && natives.natives[min].signature.argumentCount == 2
+        && natives.natives[min].signature.floatArguments == 0
+        && natives.natives[min].signature.result == NATIVE_INT
+        && scale >= 0 && natives.natives[scale].signature.argumentCount == 2
+        && natives.natives[scale].signature.floatArguments == 2
+        && natives.natives[scale].signature.result == NATIVE_FLOAT
+        && trace >= 0 && natives.natives[trace].signature.result == NATIVE_NONE
+        && FindNative(&natives, "max") == -1;
+
+    testResult = testResult
+        && RegisterNative(&natives, "min", "int(int, int)", NativeMin) == R_ERROR
+        && RegisterNative(&natives, "a", "int(int", NativeMin) == R_ERROR
+        && RegisterNative(&natives, "b", "int(void)", NativeMin) == R_ERROR
+        && RegisterNative(&natives, "c", "bool(int)", NativeMin) == R_ERROR
+        && RegisterNative(&natives, "d", "int(int,)", NativeMin) == R_ERROR
+        && RegisterNative(&natives, "e", "int(int) x", NativeMin) == R_ERROR
+        && RegisterNative(&natives, "f", "int(int, int, int, int, int, int, int, int, int)", NativeMin) == R_ERROR
+        && natives.count == 8
+        && RegisterNative(&natives, "g", "void( )", NativeMin) == R_OK
+        && RegisterNative(&natives, "h", "int(int, int, int, int, int, int, int, int)", NativeMin) == R_OK;
+
+    DeleteNativeTable(&natives);
+    return Report("TestRegister", testResult);
+}
+
+// A script calling natives with int and float arguments and without a result, checked,
+// verified and in VMRunVerified
+int TestCompiledCalls()
+{
+    char code[] =
+        "var i: int = 0;"
+        "var f: float = 0.0;"
+        "var m: int = 100;"
+        "while (i < 5)"
+        "{"
+        "    trace(i);"
+        "    f = f + scale(i, 1.5);"
+        "    m = min(m, 10 - i);"
+        "    i = i + 1;"
+        "}"
+        "f = f + sqrt(16.0);";
+
+    SNativeTable natives;
+    InitTestNatives(&natives);
+
+    SStackData instructions;
+    if (CompileSourceWithNatives(code, strlen(code), &natives, &instructions) != R_OK)
+    {
+        DeleteNativeTable(&natives);
+        return Report("TestCompiledCalls", HS_FALSE);
+    }
+
+    SVerifyResult verifyResult;
+    SStackUsage usage;
+    Bool8 testResult = VerifyInstructions(instructions, DATA_SIZE, &verifyResult) == R_OK
+        && AnalyzeStackUsage(instructions, &usage) == R_OK;
+    if (testResult)
+    {
+        testResult = !usage.isRecursive && usage.requiredDataSize == verifyResult.maxDataSize;
+        FreeStackUsage(&usage);
+    }
+
+    for (int verified = 0; verified < 2; ++verified)
+    {
+        SVMData vmData;
+        InitVM(&vmData, instructions, DATA_SIZE, CreateNativeFunctions(&natives));
+        s_traced = 0;
+        if (verified)
+            VMRunVerified(&vmData);
+        else
+            while (VMProcessInstructions(&vmData, 1000));
+
+        byte* vars = vmData.dataStack.reversePointer;
+        testResult = testResult && vmData.error == VM_OK
+            && LoadVarInt(vars) == 6
+            && LoadVarFloat(vars + HS_DATA_SIZE_INT) == 19.0f
+            && LoadVarInt(vars + HS_DATA_SIZE_INT + HS_DATA_SIZE_FLOAT) == 5
+            && s_traced == 1234
+            && vmData.dataStack.base.stackPointer == vmData.dataStack.base.begin;
+        DeleteVM(&vmData, HS_TRUE, HS_FALSE);
+    }
+
+    DeleteStack(instructions);
+    DeleteNativeTable(&natives);
+    return Report("TestCompiledCalls", testResult);
+}
+
+static Bool8 FailsToCompile(const SNativeTable* natives, char* code)
+{
+    SStackData instructions;
+    if (CompileSourceWithNatives(code, strlen(code), natives, &instructions) == R_OK)
+    {
+        DeleteStack(instructions);
+        return HS_FALSE;
+    }
+    return HS_TRUE;
+}
+
+// Calls have to match the signature and results have to be used, natives only exist when given
+int TestCompileErrors()
+{
+    SNativeTable natives;
+    InitTestNatives(&natives);
+
+    char unknown[] = "var i: int = max(1, 2);";
+    char types[] = "var f: float = scale(1.0, 2.0);";
+    char fewer[] = "var i: int = min(1);";
+    char more[] = "trace(1, 2);";
+    char unused[] = "min(1, 2);";
+    char noResult[] = "var i: int = trace(1);";
+    char assigned[] = "var i: int = 0; i = sqrt(2.0);";
+    char valid[] = "trace(min(3, 4));";
+    char noNatives[] = "trace(1);";
+
+    SStackData instructions;
+    Bool8 testResult = FailsToCompile(&natives, unknown)
+        && FailsToCompile(&natives, types)
+        && FailsToCompile(&natives, fewer)
+        && FailsToCompile(&natives, more)
+        && FailsToCompile(&natives, unused)
+        && FailsToCompile(&natives, noResult)
+        && FailsToCompile(&natives, assigned)
+        && !FailsToCompile(&natives, valid)
+        && CompileSource(noNatives, strlen(noNatives), &instructions) == R_ERROR;
+
+    DeleteNativeTable(&natives);
+    return Report("TestCompileErrors", testResult);
+}
+
+// The checked interpreter stops at an index the VM has no function for
+int TestInvalidIndex()
+{
+    SStackData s = CreateStack(50);
+    AddInt(&s, INS_LITERAL_I, 1);
+    AddCallExt(&s, 3, 1, 0, NATIVE_NONE);
+    AddInstruction(&s, INS_END);
+    SStackData instructions = Finish(s);
+
+    SNativeTable natives;
+    InitNativeTable(&natives);
+    RegisterNative(&natives, "trace", "void(int)", NativeTrace);
+
+    SVMData vmData;
+    InitVM(&vmData, instructions, DATA_SIZE, CreateNativeFunctions(&natives));
+    while (VMProcessInstructions(&vmData, 1000));
+
+    Bool8 testResult = vmData.error == VM_ERROR_INVALID_INSTRUCTION
+        && vmData.instructionStack.stackPointer - instructions.begin == 1 + sizeof(hsbint);
+
+    DeleteVM(&vmData, HS_FALSE, HS_FALSE);
+    DeleteNativeTable(&natives);
+    return Report("TestInvalidIndex", testResult);
+}
+
+// The verifier checks the arguments against the signature in the operands
+int TestVerifySignature()
+{
+    SStackData s = CreateStack(50);
+    AddInt(&s, INS_LITERAL_I, 1);
+    AddCallExt(&s, 0, 1, 1, NATIVE_FLOAT);
+    AddInstruction(&s, INS_END);
+    SStackData instructions = Finish(s);
+
+    SVerifyResult result;
+    Bool8 testResult = VerifyInstructions(instructions, DATA_SIZE, &result) == R_ERROR
+        && result.errorOffset == 1 + sizeof(hsbint);
+
+    // An int argument and a float result that is left on the stack
+    instructions.begin[1 + sizeof(hsbint) + 3] = 0;
+    testResult = testResult && VerifyInstructions(instructions, DATA_SIZE, &result) == R_OK
+        && result.maxDataSize == HS_DATA_SIZE_FLOAT;
+
+    instructions.begin[1 + sizeof(hsbint) + 2] = 2;
+    testResult = testResult && VerifyInstructions(instructions, DATA_SIZE, &result) == R_ERROR;
+
+    DeleteStack(instructions);
+    return Report("TestVerifySignature", testResult);
+}
+
+int main()
+{
+    int fails = 0;
+
+    fails += TestRegister();
+    fails += TestCompiledCalls();
+    fails += TestCompileErrors();
+    fails += TestInvalidIndex();
+    fails += TestVerifySignature();
+
+    printf("\n%d tests failed\n", fails);
+    return fails;
+}
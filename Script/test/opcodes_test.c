@@ -0,0 +1,405 @@
+#include <stdio.h>
+
+#include "bytecode_c.h"
+#include "test_util.h"
+
+// Runs every instruction at least once. Written against the HS_DATA_SIZE_* sizes so the same
+// tests pass with the packed data stack and with HS_SLOT_STACK.
+
+static const int DATA_SIZE = 200;
+
+// int(int, int)
+static void NativeSubstract(SVMData* vmData)
+{
+    hsbint second = PopInt(&vmData->dataStack.base.stackPointer);
+    hsbint first = PopInt(&vmData->dataStack.base.stackPointer);
+    PushInt(&vmData->dataStack.base.stackPointer, first - second);
+}
+
+static NativeFP* s_natives[] = { NativeSubstract };
+
+// runs the program to the end, leaves the VM for inspection
+static void Run(SVMData* vmData, SStackData instructionStack)
+{
+    instructionStack.end = instructionStack.stackPointer;
+    instructionStack.stackPointer = instructionStack.begin;
+
+    FuncArray funcArray = { sizeof(s_natives) / sizeof(s_natives[0]), s_natives };
+    InitVM(vmData, instructionStack, DATA_SIZE, funcArray);
+
+    while (VMProcessInstructions(vmData, 1))
+    {
+    }
+}
+
+static Bool8 IsBalanced(SVMData* vmData, int dataSize)
+{
+    return vmData->dataStack.base.stackPointer == vmData->dataStack.base.begin + dataSize
+        && vmData->dataStack.reversePointer == vmData->dataStack.base.end;
+}
+
+static int ExpectInt(const char* name, SStackData instructionStack, hsbint expected)
+{
+    SVMData vmData;
+    Run(&vmData, instructionStack);
+
+    Bool8 testResult = IsBalanced(&vmData, HS_DATA_SIZE_INT) && LoadVarInt(vmData.dataStack.base.begin) == expected;
+
+    DeleteVM(&vmData, HS_FALSE, HS_TRUE);
+    return Report(name, testResult);
+}
+
+static int ExpectFloat(const char* name, SStackData instructionStack, hsbfloat expected)
+{
+    SVMData vmData;
+    Run(&vmData, instructionStack);
+
+    Bool8 testResult = IsBalanced(&vmData, HS_DATA_SIZE_FLOAT) && LoadVarFloat(vmData.dataStack.base.begin) == expected;
+
+    DeleteVM(&vmData, HS_FALSE, HS_TRUE);
+    return Report(name, testResult);
+}
+
+static int ExpectBool(const char* name, SStackData instructionStack, hsbbool expected)
+{
+    SVMData vmData;
+    Run(&vmData, instructionStack);
+
+    byte* pointer = vmData.dataStack.base.stackPointer;
+    Bool8 testResult = IsBalanced(&vmData, HS_DATA_SIZE_BOOL) && PopBool(&pointer) == expected;
+
+    DeleteVM(&vmData, HS_FALSE, HS_TRUE);
+    return Report(name, testResult);
+}
+
+static int TestBinaryInt(const char* name, EInstruction instruction, hsbint first, hsbint second, hsbint expected)
+{
+    SStackData instructionStack = CreateStack(100);
+    AddInt(&instructionStack, INS_LITERAL_I, first);
+    AddInt(&instructionStack, INS_LITERAL_I, second);
+    AddInstruction(&instructionStack, instruction);
+
+    return ExpectInt(name, instructionStack, expected);
+}
+
+static int TestBinaryFloat(const char* name, EInstruction instruction, hsbfloat first, hsbfloat second, hsbfloat expected)
+{
+    SStackData instructionStack = CreateStack(100);
+    AddFloat(&instructionStack, INS_LITERAL_F, first);
+    AddFloat(&instructionStack, INS_LITERAL_F, second);
+    AddInstruction(&instructionStack, instruction);
+
+    return ExpectFloat(name, instructionStack, expected);
+}
+
+static int TestCompareInt(const char* name, EInstruction instruction, hsbint first, hsbint second, hsbbool expected)
+{
+    SStackData instructionStack = CreateStack(100);
+    AddInt(&instructionStack, INS_LITERAL_I, first);
+    AddInt(&instructionStack, INS_LITERAL_I, second);
+    AddInstruction(&instructionStack, instruction);
+
+    return ExpectBool(name, instructionStack, expected);
+}
+
+static int TestCompareFloat(const char* name, EInstruction instruction, hsbfloat first, hsbfloat second, hsbbool expected)
+{
+    SStackData instructionStack = CreateStack(100);
+    AddFloat(&instructionStack, INS_LITERAL_F, first);
+    AddFloat(&instructionStack, INS_LITERAL_F, second);
+    AddInstruction(&instructionStack, instruction);
+
+    return ExpectBool(name, instructionStack, expected);
+}
+
+static int TestBinaryBool(const char* name, EInstruction instruction, hsbbool first, hsbbool second, hsbbool expected)
+{
+    SStackData instructionStack = CreateStack(100);
+    AddBool(&instructionStack, first);
+    AddBool(&instructionStack, second);
+    AddInstruction(&instructionStack, instruction);
+
+    return ExpectBool(name, instructionStack, expected);
+}
+
+int TestNoopAndCallExt()
+{
+    SStackData instructionStack = CreateStack(100);
+    AddInstruction(&instructionStack, INS_NOOP);
+    AddInt(&instructionStack, INS_LITERAL_I, 17);
+    AddInt(&instructionStack, INS_LITERAL_I, 3);
+    AddCallExt(&instructionStack, 0, 2, 0, NATIVE_INT);
+    AddInstruction(&instructionStack, INS_NOOP);
+
+    return ExpectInt("TestNoopAndCallExt", instructionStack, 14);
+}
+
+int TestNegate()
+{
+    SStackData instructionStack = CreateStack(100);
+    AddBool(&instructionStack, 0);
+    AddInstruction(&instructionStack, INS_NEGATE_B);
+
+    return ExpectBool("TestNegate", instructionStack, 1);
+}
+
+int TestVariablesInt()
+{
+    SStackData instructionStack = CreateStack(100);
+    AddInstruction(&instructionStack, INS_ALLOC_VAR_I);
+    AddInstruction(&instructionStack, INS_ALLOC_VAR_I);
+    AddInt(&instructionStack, INS_LITERAL_I, -300);
+    AddOffset(&instructionStack, INS_SAVE_VAR_I, 0 * HS_DATA_SIZE_INT);
+    AddInt(&instructionStack, INS_LITERAL_I, 7);
+    AddOffset(&instructionStack, INS_SAVE_VAR_I, 1 * HS_DATA_SIZE_INT);
+    AddOffset(&instructionStack, INS_LOAD_VAR_I, 0 * HS_DATA_SIZE_INT);
+    AddOffset(&instructionStack, INS_LOAD_VAR_I, 1 * HS_DATA_SIZE_INT);
+    AddInstruction(&instructionStack, INS_MULTIPLY_I);
+    AddInstruction(&instructionStack, INS_DEALLOC_VAR_I);
+    AddInstruction(&instructionStack, INS_DEALLOC_VAR_I);
+
+    return ExpectInt("TestVariablesInt", instructionStack, -2100);
+}
+
+int TestVariablesFloat()
+{
+    // a float and an int variable side by side, the float one is allocated first
+    SStackData instructionStack = CreateStack(100);
+    AddInstruction(&instructionStack, INS_ALLOC_VAR_F);
+    AddInstruction(&instructionStack, INS_ALLOC_VAR_I);
+    AddFloat(&instructionStack, INS_LITERAL_F, 0.5f);
+    AddOffset(&instructionStack, INS_SAVE_VAR_F, HS_DATA_SIZE_INT);
+    AddInt(&instructionStack, INS_LITERAL_I, 3);
+    AddOffset(&instructionStack, INS_SAVE_VAR_I, 0);
+    AddOffset(&instructionStack, INS_LOAD_VAR_F, HS_DATA_SIZE_INT);
+    AddOffset(&instructionStack, INS_LOAD_VAR_F, HS_DATA_SIZE_INT);
+    AddInstruction(&instructionStack, INS_ADD_F);
+    AddInstruction(&instructionStack, INS_DEALLOC_VAR_I);
+    AddInstruction(&instructionStack, INS_DEALLOC_VAR_F);
+
+    return ExpectFloat("TestVariablesFloat", instructionStack, 1.0f);
+}
+
+int TestJump()
+{
+    SStackData instructionStack = CreateStack(100);
+    AddInt(&instructionStack, INS_LITERAL_I, 1);
+    int patch = AddJump(&instructionStack, INS_JUMP, 0);
+    AddInt(&instructionStack, INS_LITERAL_I, 2);
+    AddInstruction(&instructionStack, INS_ADD_I);
+    StoreAddress(instructionStack.begin + patch, Here(&instructionStack));
+    AddInt(&instructionStack, INS_LITERAL_I, 3);
+    AddInstruction(&instructionStack, INS_ADD_I);
+
+    return ExpectInt("TestJump", instructionStack, 4);
+}
+
+int TestCondJump()
+{
+    // the first jump is taken, the second is not
+    SStackData instructionStack = CreateStack(100);
+    AddInt(&instructionStack, INS_LITERAL_I, 1);
+    AddBool(&instructionStack, 1);
+    int patch = AddJump(&instructionStack, INS_COND_JUMP_B, 0);
+    AddInt(&instructionStack, INS_LITERAL_I, 10);
+    AddInstruction(&instructionStack, INS_ADD_I);
+    StoreAddress(instructionStack.begin + patch, Here(&instructionStack));
+    AddBool(&instructionStack, 0);
+    patch = AddJump(&instructionStack, INS_COND_JUMP_B, 0);
+    AddInt(&instructionStack, INS_LITERAL_I, 100);
+    AddInstruction(&instructionStack, INS_ADD_I);
+    StoreAddress(instructionStack.begin + patch, Here(&instructionStack));
+    AddInstruction(&instructionStack, INS_NOOP);
+
+    return ExpectInt("TestCondJump", instructionStack, 101);
+}
+
+// The entry of the value is not a jump, the VM stops at INS_SWITCH
+int TestSwitchInvalidEntry()
+{
+    SStackData instructionStack = CreateStack(100);
+    AddInt(&instructionStack, INS_LITERAL_I, 0);
+    hsbaddress position = Here(&instructionStack);
+    AddInt(&instructionStack, INS_SWITCH, 0);
+    *instructionStack.stackPointer++ = 1;
+    int patch = AddJump(&instructionStack, INS_JUMP, 0);
+    AddInstruction(&instructionStack, INS_NOOP);
+    AddInstruction(&instructionStack, INS_NOOP);
+    AddInstruction(&instructionStack, INS_NOOP);
+    StoreAddress(instructionStack.begin + patch, Here(&instructionStack));
+    AddInstruction(&instructionStack, INS_END);
+
+    SVMData vmData;
+    Run(&vmData, instructionStack);
+    Bool8 testResult = vmData.error == VM_ERROR_INVALID_INSTRUCTION
+        && vmData.instructionStack.stackPointer == vmData.instructionStack.begin + position;
+
+    DeleteVM(&vmData, HS_FALSE, HS_TRUE);
+    return Report("TestSwitchInvalidEntry", testResult);
+}
+
+int TestCallReturn()
+{
+    SStackData instructionStack = CreateStack(100);
+    AddInt(&instructionStack, INS_LITERAL_I, 2);
+    int patchCall = AddJump(&instructionStack, INS_CALL, 0);
+    AddInt(&instructionStack, INS_LITERAL_I, 1);
+    AddInstruction(&instructionStack, INS_ADD_I);
+    int patchEnd = AddJump(&instructionStack, INS_JUMP, 0);
+
+    // function adding 40 to the value on the stack
+    StoreAddress(instructionStack.begin + patchCall, Here(&instructionStack));
+    AddInt(&instructionStack, INS_LITERAL_I, 40);
+    AddInstruction(&instructionStack, INS_ADD_I);
+    AddInstruction(&instructionStack, INS_RETURN);
+
+    StoreAddress(instructionStack.begin + patchEnd, Here(&instructionStack));
+    AddInstruction(&instructionStack, INS_NOOP);
+
+    return ExpectInt("TestCallReturn", instructionStack, 43);
+}
+
+int TestFrame()
+{
+    SStackData instructionStack = CreateStack(100);
+    AddInt(&instructionStack, INS_LITERAL_I, 7);
+    AddFloat(&instructionStack, INS_LITERAL_F, 0.5f);
+    int patchCall = AddJump(&instructionStack, INS_CALL, 0);
+    int patchEnd = AddJump(&instructionStack, INS_JUMP, 0);
+
+    // function(int a, float b) with an int and a float local, returns a + 5 + (int)(b + b == 1)
+    StoreAddress(instructionStack.begin + patchCall, Here(&instructionStack));
+    AddEnter(&instructionStack, HS_DATA_SIZE_INT + HS_DATA_SIZE_FLOAT, 1, 1);
+    const int local = HS_DATA_SIZE_INT + HS_DATA_SIZE_FLOAT;
+    AddOffset(&instructionStack, INS_LOAD_FRAME_I, 0);
+    AddInt(&instructionStack, INS_ADD_LITERAL_I, 5);
+    AddOffset(&instructionStack, INS_SAVE_FRAME_I, local);
+    AddOffset(&instructionStack, INS_LOAD_FRAME_F, HS_DATA_SIZE_INT);
+    AddOffset(&instructionStack, INS_LOAD_FRAME_F, HS_DATA_SIZE_INT);
+    AddInstruction(&instructionStack, INS_ADD_F);
+    AddOffset(&instructionStack, INS_SAVE_FRAME_F, local + HS_DATA_SIZE_INT);
+    AddOffset(&instructionStack, INS_LOAD_FRAME_F, local + HS_DATA_SIZE_INT);
+    AddFloat(&instructionStack, INS_LITERAL_F, 1.0f);
+    AddInstruction(&instructionStack, INS_CMP_F_EQ);
+    int patchSkip = AddJump(&instructionStack, INS_COND_JUMP_B, 0);
+    AddOffset(&instructionStack, INS_LOAD_FRAME_I, local);
+    AddInstruction(&instructionStack, INS_LEAVE_I);
+    StoreAddress(instructionStack.begin + patchSkip, Here(&instructionStack));
+    AddOffset(&instructionStack, INS_LOAD_FRAME_I, local);
+    AddInt(&instructionStack, INS_ADD_LITERAL_I, 1);
+    AddInstruction(&instructionStack, INS_LEAVE_I);
+
+    StoreAddress(instructionStack.begin + patchEnd, Here(&instructionStack));
+    AddInstruction(&instructionStack, INS_NOOP);
+
+    return ExpectInt("TestFrame", instructionStack, 13);
+}
+
+// The frame pointer of the caller is back after the callee leaves
+int TestNestedFrames()
+{
+    SStackData instructionStack = CreateStack(100);
+    AddInt(&instructionStack, INS_LITERAL_I, 3);
+    int patchOuter = AddJump(&instructionStack, INS_CALL, 0);
+    int patchEnd = AddJump(&instructionStack, INS_JUMP, 0);
+
+    // outer(int a) returns a + inner(a) + void(a)
+    hsbaddress outer = Here(&instructionStack);
+    AddEnter(&instructionStack, HS_DATA_SIZE_INT, 0, 0);
+    AddOffset(&instructionStack, INS_LOAD_FRAME_I, 0);
+    int patchInner = AddJump(&instructionStack, INS_CALL, 0);
+    AddOffset(&instructionStack, INS_LOAD_FRAME_I, 0);
+    int patchVoid = AddJump(&instructionStack, INS_CALL, 0);
+    AddOffset(&instructionStack, INS_LOAD_FRAME_I, 0);
+    AddInstruction(&instructionStack, INS_ADD_I);
+    AddInstruction(&instructionStack, INS_LEAVE_I);
+
+    // inner(int a) returns a * a
+    hsbaddress inner = Here(&instructionStack);
+    AddEnter(&instructionStack, HS_DATA_SIZE_INT, 0, 0);
+    AddOffset(&instructionStack, INS_LOAD_FRAME_I, 0);
+    AddOffset(&instructionStack, INS_LOAD_FRAME_I, 0);
+    AddInstruction(&instructionStack, INS_MULTIPLY_I);
+    AddInstruction(&instructionStack, INS_LEAVE_I);
+
+    // void(int a) with a local, leaves nothing behind
+    hsbaddress voidFunction = Here(&instructionStack);
+    AddEnter(&instructionStack, HS_DATA_SIZE_INT, 1, 0);
+    AddInt(&instructionStack, INS_LITERAL_I, 100);
+    AddInstruction(&instructionStack, INS_LEAVE);
+
+    StoreAddress(instructionStack.begin + patchOuter, outer);
+    StoreAddress(instructionStack.begin + patchInner, inner);
+    StoreAddress(instructionStack.begin + patchVoid, voidFunction);
+    StoreAddress(instructionStack.begin + patchEnd, Here(&instructionStack));
+    AddInstruction(&instructionStack, INS_NOOP);
+
+    return ExpectInt("TestNestedFrames", instructionStack, 12);
+}
+
+// The interpreter stops after INS_YIELD with instructions left, the next call goes on from there
+int TestYield()
+{
+    SStackData instructionStack = CreateStack(100);
+    AddInt(&instructionStack, INS_LITERAL_I, 5);
+    AddInstruction(&instructionStack, INS_YIELD);
+    hsbaddress resume = Here(&instructionStack);
+    AddInt(&instructionStack, INS_LITERAL_I, 6);
+    AddInstruction(&instructionStack, INS_ADD_I);
+    instructionStack.end = instructionStack.stackPointer;
+    instructionStack.stackPointer = instructionStack.begin;
+
+    SVMData vmData;
+    FuncArray funcArray = { 0, NULL };
+    InitVM(&vmData, instructionStack, DATA_SIZE, funcArray);
+
+    Bool8 testResult = VMProcessInstructions(&vmData, 100)
+        && vmData.instructionStack.stackPointer == instructionStack.begin + resume
+        && IsBalanced(&vmData, HS_DATA_SIZE_INT);
+    testResult = testResult && !VMProcessInstructions(&vmData, 100)
+        && vmData.error == VM_OK && IsBalanced(&vmData, HS_DATA_SIZE_INT)
+        && PopInt(&vmData.dataStack.base.stackPointer) == 11;
+
+    DeleteVM(&vmData, HS_FALSE, HS_TRUE);
+    return Report("TestYield", testResult);
+}
+
+int main()
+{
+    int fails = 0;
+    fails += TestNoopAndCallExt();
+
+    fails += TestBinaryInt("TestAddInt", INS_ADD_I, 1200, 34, 1234);
+    fails += TestBinaryInt("TestSubstractInt", INS_SUBSTRACT_I, 5, 12, -7);
+    fails += TestBinaryInt("TestMultiplyInt", INS_MULTIPLY_I, -12, 11, -132);
+    fails += TestBinaryInt("TestDivideInt", INS_DIVIDE_I, 100, 7, 14);
+
+    fails += TestBinaryFloat("TestAddFloat", INS_ADD_F, 1.5f, 2.25f, 3.75f);
+    fails += TestBinaryFloat("TestSubstractFloat", INS_SUBSTRACT_F, 1.5f, 2.25f, -0.75f);
+    fails += TestBinaryFloat("TestMultiplyFloat", INS_MULTIPLY_F, 1.5f, -2.5f, -3.75f);
+    fails += TestBinaryFloat("TestDivideFloat", INS_DIVIDE_F, 1.0f, 4.0f, 0.25f);
+
+    fails += TestNegate();
+    fails += TestBinaryBool("TestAnd", INS_AND_B, 1, 0, 0);
+    fails += TestBinaryBool("TestOr", INS_OR_B, 1, 0, 1);
+
+    fails += TestCompareInt("TestCmpIntEq", INS_CMP_I_EQ, 300, 300, 1);
+    fails += TestCompareInt("TestCmpIntLess", INS_CMP_I_LESS, 3, -2, 0);
+    fails += TestCompareInt("TestCmpIntLessEq", INS_CMP_I_LESS_EQ, -2, -2, 1);
+    fails += TestCompareFloat("TestCmpFloatEq", INS_CMP_F_EQ, 0.5f, 0.25f, 0);
+    fails += TestCompareFloat("TestCmpFloatLess", INS_CMP_F_LESS, 0.25f, 0.5f, 1);
+    fails += TestCompareFloat("TestCmpFloatLessEq", INS_CMP_F_LESS_EQ, 0.75f, 0.5f, 0);
+
+    fails += TestVariablesInt();
+    fails += TestVariablesFloat();
+
+    fails += TestJump();
+    fails += TestCondJump();
+    fails += TestSwitchInvalidEntry();
+    fails += TestCallReturn();
+    fails += TestFrame();
+    fails += TestNestedFrames();
+    fails += TestYield();
+
+    return fails;
+}
@@ -0,0 +1,325 @@
+#include <stdio.h>
+
+#include "bytecode_c.h"
+#include "bytecode_info.h"
+#include "compiler.h"
+#include "optimizer.h"
+#include "stack_usage.h"
+#include "verifier.h"
+#include "test_util.h"
+
+static const int DATA_SIZE = 200;
+
+static SStackData CompileCode(const char* source)
+{
+    char code[1024];
+    int size = strlen(source);
+    memcpy(code, source, size + 1);
+
+    SStackData instructions = { 0 };
+    CompileSource(code, size, &instructions);
+    return instructions;
+}
+
+static SStackData CopyInstructions(SStackData instructions)
+{
+    int size = instructions.end - instructions.begin;
+    SStackData copy = CreateStack(size);
+    memcpy(copy.begin, instructions.begin, size);
+    return copy;
+}
+
+// Runs the program and returns the number of dispatched instructions
+static int Run(SVMData* vmData, SStackData instructions)
+{
+    FuncArray funcArray = { 0 };
+    InitVM(vmData, instructions, DATA_SIZE, funcArray);
+
+    int dispatches = 1;
+    while (VMProcessInstructions(vmData, 1))
+    {
+        ++dispatches;
+    }
+
+    return dispatches;
+}
+
+// The fused program has to end with the same variables and take fewer dispatches
+static int TestSameResult(const char* name, const char* source)
+{
+    SStackData instructions = CompileCode(source);
+    SStackData fused = CopyInstructions(instructions);
+    Bool8 testResult = instructions.begin && FuseSuperinstructions(&fused) == R_OK;
+
+    SVMData vmData;
+    SVMData fusedVmData;
+    int dispatches = Run(&vmData, instructions);
+    int fusedDispatches = Run(&fusedVmData, fused);
+
+    int varSize = vmData.dataStack.base.end - vmData.dataStack.reversePointer;
+    testResult = testResult
+        && fused.end - fused.begin < instructions.end - instructions.begin
+        && fusedDispatches < dispatches
+        && fusedVmData.dataStack.base.end - fusedVmData.dataStack.reversePointer == varSize
+        && memcmp(vmData.dataStack.reversePointer, fusedVmData.dataStack.reversePointer, varSize) == 0;
+
+    DeleteVM(&vmData, HS_FALSE, HS_TRUE);
+    DeleteVM(&fusedVmData, HS_FALSE, HS_TRUE);
+    return Report(name, testResult);
+}
+
+int TestJumpTargetNotFused()
+{
+    // LITERAL_I 5, ADD_I would fuse but the ADD_I is a jump target
+    SStackData instructions = CreateStack(100);
+    AddInstruction(&instructions, INS_LITERAL_I);
+    StoreIntFwd(&instructions.stackPointer, 1);
+    AddInstruction(&instructions, INS_LITERAL_I);
+    StoreIntFwd(&instructions.stackPointer, 2);
+    AddInstruction(&instructions, INS_LITERAL_B);
+    StoreBoolFwd(&instructions.stackPointer, 1);
+    AddInstruction(&instructions, INS_COND_JUMP_B);
+    hsbaddress* patch = (hsbaddress*)instructions.stackPointer;
+    instructions.stackPointer += sizeof(hsbaddress);
+    AddInstruction(&instructions, INS_LITERAL_I);
+    StoreIntFwd(&instructions.stackPointer, 5);
+    StoreAddress((byte*)patch, instructions.stackPointer - instructions.begin);
+    AddInstruction(&instructions, INS_ADD_I);
+    instructions.end = instructions.stackPointer;
+    instructions.stackPointer = instructions.begin;
+
+    int size = instructions.end - instructions.begin;
+    Bool8 testResult = FuseSuperinstructions(&instructions) == R_OK
+        && instructions.end - instructions.begin == size;
+
+    DeleteStack(instructions);
+    return Report("TestJumpTargetNotFused", testResult);
+}
+
+static void Patch(SStackData* instructionStack, int patch)
+{
+    StoreAddress(instructionStack->begin + patch, Here(instructionStack));
+}
+
+// sum(n, acc) = n == 0 ? acc : sum(n - 1, acc + n), with sharedLeave both branches end
+// at the LEAVE_I after the recursive call
+static SStackData SumProgram(hsbint n, Bool8 sharedLeave)
+{
+    SStackData s = CreateStack(100);
+    AddInt(&s, INS_LITERAL_I, n);
+    AddInt(&s, INS_LITERAL_I, 0);
+    int call = AddJump(&s, INS_CALL, 0);
+    AddInstruction(&s, INS_END);
+
+    hsbaddress function = Here(&s);
+    Patch(&s, call);
+    AddInstruction(&s, INS_ENTER);
+    *s.stackPointer++ = 2 * HS_DATA_SIZE_INT;
+    *s.stackPointer++ = 0;
+    *s.stackPointer++ = 0;
+    AddOffset(&s, INS_LOAD_FRAME_I, 0);
+    AddInt(&s, INS_LITERAL_I, 0);
+    AddInstruction(&s, INS_CMP_I_EQ);
+    int done = AddJump(&s, INS_COND_JUMP_B, 0);
+    AddOffset(&s, INS_LOAD_FRAME_I, 0);
+    AddInt(&s, INS_ADD_LITERAL_I, -1);
+    AddOffset(&s, INS_LOAD_FRAME_I, HS_DATA_SIZE_INT);
+    AddOffset(&s, INS_LOAD_FRAME_I, 0);
+    AddInstruction(&s, INS_ADD_I);
+    AddJump(&s, INS_CALL, function);
+    hsbaddress leave = Here(&s);
+    AddInstruction(&s, INS_LEAVE_I);
+
+    Patch(&s, done);
+    AddOffset(&s, INS_LOAD_FRAME_I, HS_DATA_SIZE_INT);
+    if (sharedLeave)
+        AddJump(&s, INS_JUMP, leave);
+    else
+        AddInstruction(&s, INS_LEAVE_I);
+
+    s.end = s.stackPointer;
+    s.stackPointer = s.begin;
+    return s;
+}
+
+static Bool8 HasTailCall(SStackData instructions)
+{
+    for (byte* ins = instructions.begin; ins < instructions.end; ins += GetInstructionSize(*ins))
+    {
+        if (*ins == INS_TAIL_CALL)
+            return HS_TRUE;
+    }
+    return HS_FALSE;
+}
+
+// The tail recursion runs in the stack the main program needs itself
+int TestTailRecursion()
+{
+    SStackData instructions = SumProgram(200, HS_FALSE);
+    SStackUsage usage;
+    Bool8 testResult = AnalyzeStackUsage(instructions, &usage) == R_OK && usage.isRecursive;
+    FreeStackUsage(&usage);
+
+    int size = instructions.end - instructions.begin;
+    SVerifyResult verifyResult;
+    testResult &= EliminateTailCalls(&instructions) == R_OK
+        && instructions.end - instructions.begin == size
+        && HasTailCall(instructions)
+        && VerifyInstructions(instructions, DATA_SIZE, &verifyResult) == R_OK
+        && AnalyzeStackUsage(instructions, &usage) == R_OK;
+
+    if (testResult)
+    {
+        // the arguments, three operands, the return address and the frame pointer of one call
+        testResult &= !usage.isRecursive
+            && usage.requiredDataSize == 5 * HS_DATA_SIZE_INT + 2 * HS_DATA_SIZE_ADDRESS;
+
+        SVMData vmData;
+        FuncArray funcArray = { 0 };
+        InitVMForProgram(&vmData, instructions, &usage, DATA_SIZE, funcArray);
+        while (VMProcessInstructions(&vmData, 1 << 30))
+        {
+        }
+        testResult &= vmData.error == VM_OK
+            && vmData.dataStack.base.stackPointer - vmData.dataStack.base.begin == HS_DATA_SIZE_INT
+            && LoadVarInt(vmData.dataStack.base.begin) == 20100;
+        DeleteVM(&vmData, HS_TRUE, HS_TRUE);
+    }
+    FreeStackUsage(&usage);
+
+    DeleteStack(instructions);
+    return Report("TestTailRecursion", testResult);
+}
+
+// The LEAVE_I after the call is also reached by a jump, the call has to stay
+int TestLeaveJumpTargetNotRewritten()
+{
+    SStackData instructions = SumProgram(10, HS_TRUE);
+    Bool8 testResult = EliminateTailCalls(&instructions) == R_OK && !HasTailCall(instructions);
+
+    DeleteStack(instructions);
+    return Report("TestLeaveJumpTargetNotRewritten", testResult);
+}
+
+// total = 0; for (i = 0; i < 10; ++i) addClamped(i); with addClamped(x) adding clamp(3 * x, 5, 20)
+// to the variable total of the main program
+static SStackData HelpersProgram()
+{
+    SStackData s = CreateStack(200);
+    AddInstruction(&s, INS_ALLOC_VAR_I); // total
+    AddInstruction(&s, INS_ALLOC_VAR_I); // i
+    hsbaddress loop = Here(&s);
+    AddOffset(&s, INS_LOAD_VAR_I, 0);
+    int callAdd = AddJump(&s, INS_CALL, 0);
+    AddOffset(&s, INS_LOAD_VAR_I, 0);
+    AddInt(&s, INS_ADD_LITERAL_I, 1);
+    AddOffset(&s, INS_SAVE_VAR_I, 0);
+    AddOffset(&s, INS_LOAD_VAR_I, 0);
+    AddInt(&s, INS_LITERAL_I, 10);
+    AddInstruction(&s, INS_CMP_I_LESS);
+    AddJump(&s, INS_COND_JUMP_B, loop);
+    AddInstruction(&s, INS_END);
+
+    // clamp(x, lo, hi) with the arguments in the variables x, lo, hi
+    hsbaddress clamp = Here(&s);
+    AddInstruction(&s, INS_ALLOC_VAR_I);
+    AddInstruction(&s, INS_ALLOC_VAR_I);
+    AddInstruction(&s, INS_ALLOC_VAR_I);
+    AddOffset(&s, INS_SAVE_VAR_I, 0);
+    AddOffset(&s, INS_SAVE_VAR_I, HS_DATA_SIZE_INT);
+    AddOffset(&s, INS_SAVE_VAR_I, 2 * HS_DATA_SIZE_INT);
+    AddOffset(&s, INS_LOAD_VAR_I, 2 * HS_DATA_SIZE_INT);
+    AddOffset(&s, INS_LOAD_VAR_I, HS_DATA_SIZE_INT);
+    AddInstruction(&s, INS_CMP_I_LESS);
+    int low = AddJump(&s, INS_COND_JUMP_B, 0);
+    AddOffset(&s, INS_LOAD_VAR_I, 0);
+    AddOffset(&s, INS_LOAD_VAR_I, 2 * HS_DATA_SIZE_INT);
+    AddInstruction(&s, INS_CMP_I_LESS);
+    int high = AddJump(&s, INS_COND_JUMP_B, 0);
+    AddOffset(&s, INS_LOAD_VAR_I, 2 * HS_DATA_SIZE_INT);
+    int done = AddJump(&s, INS_JUMP, 0);
+    Patch(&s, low);
+    AddOffset(&s, INS_LOAD_VAR_I, HS_DATA_SIZE_INT);
+    AddInstruction(&s, INS_DEALLOC_VAR_I);
+    AddInstruction(&s, INS_DEALLOC_VAR_I);
+    AddInstruction(&s, INS_DEALLOC_VAR_I);
+    AddInstruction(&s, INS_RETURN);
+    Patch(&s, high);
+    AddOffset(&s, INS_LOAD_VAR_I, 0);
+    Patch(&s, done);
+    AddInstruction(&s, INS_DEALLOC_VAR_I);
+    AddInstruction(&s, INS_DEALLOC_VAR_I);
+    AddInstruction(&s, INS_DEALLOC_VAR_I);
+    AddInstruction(&s, INS_RETURN);
+
+    // addClamped(x), total is below i and the return address
+    Patch(&s, callAdd);
+    AddInt(&s, INS_MULTIPLY_LITERAL_I, 3);
+    AddInt(&s, INS_LITERAL_I, 5);
+    AddInt(&s, INS_LITERAL_I, 20);
+    AddJump(&s, INS_CALL, clamp);
+    AddOffset(&s, INS_LOAD_VAR_I, HS_DATA_SIZE_ADDRESS + HS_DATA_SIZE_INT);
+    AddInstruction(&s, INS_ADD_I);
+    AddOffset(&s, INS_SAVE_VAR_I, HS_DATA_SIZE_ADDRESS + HS_DATA_SIZE_INT);
+    AddInstruction(&s, INS_RETURN);
+
+    s.end = s.stackPointer;
+    s.stackPointer = s.begin;
+    return s;
+}
+
+// Inlines with the options and checks the program still verifies and ends with the same total
+static Bool8 IsInlinedSame(int maxGrowth, int maxDepth, int expectedInlined, int* outDispatches)
+{
+    SStackData instructions = HelpersProgram();
+    const SInlineOptions options = { 64, maxGrowth, maxDepth };
+    int inlinedCount;
+    SVerifyResult verifyResult;
+    Bool8 testResult = InlineCalls(&instructions, &options, &inlinedCount) == R_OK
+        && inlinedCount == expectedInlined
+        && VerifyInstructions(instructions, DATA_SIZE, &verifyResult) == R_OK;
+
+    SVMData vmData;
+    *outDispatches = Run(&vmData, instructions);
+    testResult &= vmData.error == VM_OK
+        && vmData.dataStack.base.end - vmData.dataStack.reversePointer == 2 * HS_DATA_SIZE_INT
+        && LoadVarInt(vmData.dataStack.base.end - HS_DATA_SIZE_INT) == 130;
+
+    DeleteVM(&vmData, HS_FALSE, HS_TRUE);
+    return testResult;
+}
+
+// clamp is inlined into addClamped, which then has no calls left and is inlined into the loop.
+// Each inlined call saves INS_CALL and INS_RETURN, except when clamp returns early for i = 0 and 1
+// where the INS_RETURN becomes a jump.
+int TestInlining()
+{
+    int dispatches, partialDispatches, inlinedDispatches;
+    Bool8 testResult = IsInlinedSame(0, 4, 0, &dispatches)
+        && IsInlinedSame(1000, 1, 1, &partialDispatches)
+        && IsInlinedSame(1000, 4, 2, &inlinedDispatches)
+        && partialDispatches == dispatches - 2 * 10 + 2
+        && inlinedDispatches == dispatches - 4 * 10 + 2;
+
+    return Report("TestInlining", testResult);
+}
+
+int main()
+{
+    int fails = 0;
+    fails += TestSameResult("TestLoadLoadOp",
+        "var a: int = 3; var b: int = 4; var c: int = a + b; c = c * a - b;");
+    fails += TestSameResult("TestLiteralOp",
+        "var a: int = 3; a = a + 7; a = a * 3; a = a - 2;");
+    fails += TestSameResult("TestMove",
+        "var a: int = 3; var b: int = a; var f: float = 1.5; var g: float = f; g = f;");
+    fails += TestSameResult("TestCompareJump",
+        "var i: int = 0; var j: int = 0;"
+        "while (i < 20) { i = i + 1; while (j <= i) j = j + 2; if (i == 5) j = 0; }");
+    fails += TestJumpTargetNotFused();
+    fails += TestTailRecursion();
+    fails += TestLeaveJumpTargetNotRewritten();
+    fails += TestInlining();
+
+    return fails;
+}
@@ -0,0 +1,180 @@
+#include <stdio.h>
+
+#include "bytecode_c.h"
+#include "embed.h"
+#include "parallel_scheduler.h"
+#include "scheduler.h"
+#include "test_util.h"
+
+static char s_agents[] =
+    "fun wait(frames: int): int\n"
+    "{\n"
+    "    var i: int = 0;\n"
+    "    while (i < frames) { yield; i = i + 1; }\n"
+    "    return i * 10;\n"
+    "}\n"
+    "fun work(n: int): float\n"
+    "{\n"
+    "    var result: float = 0.0;\n"
+    "    while (n > 0) { result = result + 0.5; n = n - 1; }\n"
+    "    return result;\n"
+    "}\n";
+
+static char s_counters[] =
+    "fun count(n: int): int\n"
+    "{\n"
+    "    var sum: int = 0;\n"
+    "    while (n > 0) { sum = sum + n; n = n - 1; if (n - n / 3 * 3 == 0) yield; }\n"
+    "    return sum;\n"
+    "}\n"
+    "fun depth(n: int): int { if (n == 0) return 0; return depth(n - 1) + 1; }\n";
+
+enum { INSTANCES = 3000, MAX_TICKS = 200 };
+
+// The tick every instance finished in and its result, by the scheduler of scheduler.h
+static Bool8 RunSingle(SProgram* agents, SProgram* counters, int* outTicks, SScriptValue* outResults)
+{
+    SScheduler schedulers[2];
+    InitScheduler(&schedulers[0], agents, 40);
+    InitScheduler(&schedulers[1], counters, 1000);
+
+    for (int i = 0; i < INSTANCES; ++i)
+    {
+        SScriptValue arguments[] = { { .i = (hsbint)(i % 37) } };
+        SScheduler* scheduler = &schedulers[i % 3 == 2];
+        const char* name = i % 3 == 0 ? "wait" : i % 3 == 1 ? "work" : "count";
+        SpawnInstance(scheduler, FindFunction(scheduler->program, name), arguments, 1);
+        outTicks[i] = -1;
+    }
+
+    for (int tick = 0; tick < MAX_TICKS; ++tick)
+    {
+        RunSchedulerTick(&schedulers[0]);
+        RunSchedulerTick(&schedulers[1]);
+        for (int i = 0; i < INSTANCES; ++i)
+        {
+            const SScriptInstance* instance = GetInstance(&schedulers[i % 3 == 2], i % 3 == 2 ? i / 3 : i - i / 3);
+            if (outTicks[i] < 0 && instance->state == SCRIPT_FINISHED)
+            {
+                outTicks[i] = tick;
+                outResults[i] = instance->result;
+            }
+        }
+    }
+
+    DeleteScheduler(&schedulers[0]);
+    DeleteScheduler(&schedulers[1]);
+    for (int i = 0; i < INSTANCES; ++i)
+    {
+        if (outTicks[i] < 0)
+            return HS_FALSE;
+    }
+    return HS_TRUE;
+}
+
+// Two programs on 1 to 4 threads, every instance finishes in the same tick with the same result
+// as on a single thread. Build with -fsanitize=thread to check the deques for data races.
+int TestSameAsSingleThread()
+{
+    SProgram* agents = CreateSharedProgram(s_agents, sizeof(s_agents) - 1, NULL);
+    SProgram* counters = CreateSharedProgram(s_counters, sizeof(s_counters) - 1, NULL);
+    if (!agents || !counters)
+        return Report("TestSameAsSingleThread", HS_FALSE);
+
+    static int expectedTicks[INSTANCES];
+    static SScriptValue expectedResults[INSTANCES];
+    Bool8 testResult = RunSingle(agents, counters, expectedTicks, expectedResults);
+
+    static int handles[INSTANCES];
+    static int ticks[INSTANCES];
+    for (int threads = 1; threads <= 4 && testResult; ++threads)
+    {
+        SParallelScheduler* scheduler = CreateParallelScheduler(threads);
+        int programs[] = { AddParallelProgram(scheduler, agents, 40), AddParallelProgram(scheduler, counters, 1000) };
+        for (int i = 0; i < INSTANCES; ++i)
+        {
+            SScriptValue arguments[] = { { .i = (hsbint)(i % 37) } };
+            SProgram* program = i % 3 == 2 ? counters : agents;
+            const char* name = i % 3 == 0 ? "wait" : i % 3 == 1 ? "work" : "count";
+            handles[i] = SpawnParallelInstance(scheduler, programs[i % 3 == 2], FindFunction(program, name), arguments, 1);
+            ticks[i] = -1;
+        }
+
+        for (int tick = 0; tick < MAX_TICKS; ++tick)
+        {
+            RunParallelTick(scheduler);
+            for (int i = 0; i < INSTANCES; ++i)
+            {
+                const SScriptInstance* instance = GetParallelInstance(scheduler, handles[i]);
+                if (ticks[i] < 0 && instance->state == SCRIPT_FINISHED)
+                {
+                    ticks[i] = tick;
+                    testResult = testResult && (i % 3 == 1 ? instance->result.f == expectedResults[i].f
+                        : instance->result.i == expectedResults[i].i);
+                }
+            }
+        }
+
+        testResult = testResult && memcmp(ticks, expectedTicks, sizeof(ticks)) == 0 && RunParallelTick(scheduler) == 0;
+        DeleteParallelScheduler(scheduler);
+    }
+
+    ReleaseProgram(agents);
+    ReleaseProgram(counters);
+    return Report("TestSameAsSingleThread", testResult);
+}
+
+// Freed, failed and reused instances, invalid handles
+int TestFreeInstance()
+{
+    SProgram* agents = CreateSharedProgram(s_agents, sizeof(s_agents) - 1, NULL);
+    SProgram* counters = CreateSharedProgram(s_counters, sizeof(s_counters) - 1, NULL);
+    if (!agents || !counters)
+        return Report("TestFreeInstance", HS_FALSE);
+
+    SParallelScheduler* scheduler = CreateParallelScheduler(3);
+    int agentsProgram = AddParallelProgram(scheduler, agents, 1000);
+    int countersProgram = AddParallelProgram(scheduler, counters, 1000000);
+    ReleaseProgram(agents);
+    ReleaseProgram(counters);
+
+    int wait = FindFunction(agents, "wait");
+    SScriptValue arguments[] = { { .i = 5 } };
+    SScriptValue deep[] = { { .i = 30000 } };
+    int first = SpawnParallelInstance(scheduler, agentsProgram, wait, arguments, 1);
+    int second = SpawnParallelInstance(scheduler, agentsProgram, wait, arguments, 1);
+    int failing = SpawnParallelInstance(scheduler, countersProgram, FindFunction(counters, "depth"), deep, 1);
+
+    Bool8 testResult = SpawnParallelInstance(scheduler, agentsProgram, wait, arguments, 2) == -1
+        && SpawnParallelInstance(scheduler, 2, wait, arguments, 1) == -1
+        && RunParallelTick(scheduler) == 2
+        && GetParallelInstance(scheduler, failing)->state == SCRIPT_FAILED;
+
+    FreeParallelInstance(scheduler, second);
+    FreeParallelInstance(scheduler, failing);
+    testResult = testResult && GetParallelInstance(scheduler, second) == NULL
+        && GetParallelInstance(scheduler, failing) == NULL && GetParallelInstance(scheduler, 100) == NULL;
+
+    SScriptValue later[] = { { .i = 1 } };
+    int reused = SpawnParallelInstance(scheduler, agentsProgram, wait, later, 1);
+    testResult = testResult && reused == second;
+
+    for (int tick = 0; tick < 10; ++tick)
+        RunParallelTick(scheduler);
+    testResult = testResult && GetParallelInstance(scheduler, reused)->result.i == 10
+        && GetParallelInstance(scheduler, first)->result.i == 50;
+
+    DeleteParallelScheduler(scheduler);
+    return Report("TestFreeInstance", testResult);
+}
+
+int main()
+{
+    int fails = 0;
+
+    fails += TestSameAsSingleThread();
+    fails += TestFreeInstance();
+
+    printf("\n%d tests failed\n", fails);
+    return fails;
+}
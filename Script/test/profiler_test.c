@@ -0,0 +1,169 @@
+#include <stdio.h>
+
+#include "bytecode_c.h"
+#include "compiler.h"
+#include "profiler.h"
+#include "test_util.h"
+
+static const int DATA_SIZE = 200;
+
+static SStackData CompileCode(const char* source)
+{
+    char code[256];
+    strcpy(code, source);
+
+    SStackData instructions = { 0 };
+    CompileSource(code, strlen(code), &instructions);
+    return instructions;
+}
+
+// Runs the program to the end count instructions at a time
+static void RunProfiled(SStackData instructions, int count, SProfile* profile, SVMData* vmData)
+{
+    FuncArray funcArray = { 0 };
+    InitVM(vmData, instructions, DATA_SIZE, funcArray);
+    InitProfile(profile, instructions);
+    while (ProfiledProcessInstructions(vmData, count, profile))
+    {
+    }
+}
+
+// Every instruction is counted once for its opcode and once for its offset
+int TestCounts()
+{
+    SStackData instructions = CompileCode("var i: int = 0; var sum: int = 0; while (i < 10) { sum = sum + i; i = i + 1; }");
+
+    // The plain interpreter returns HS_TRUE for all but the last instruction
+    SVMData expected;
+    FuncArray funcArray = { 0 };
+    InitVM(&expected, instructions, DATA_SIZE, funcArray);
+    uint64_t count = 1;
+    while (VMProcessInstructions(&expected, 1))
+        ++count;
+
+    SVMData vmData;
+    SProfile profile;
+    RunProfiled(instructions, 1000, &profile, &vmData);
+
+    uint64_t hits = 0;
+    for (int i = 0; i < instructions.end - instructions.begin; ++i)
+        hits += profile.hits[i];
+
+    Bool8 testResult = GetProfiledInstructionCount(&profile) == count
+        && hits == count
+        && profile.counts[INS_END] == 1
+        && profile.counts[INS_ADD_I] == 20
+        && profile.counts[INS_COND_JUMP_B] == 11
+        && profile.hits[0] == 1
+        && LoadVarInt(vmData.dataStack.reversePointer) == 45
+        && vmData.dataStack.base.end - vmData.dataStack.reversePointer == expected.dataStack.base.end - expected.dataStack.reversePointer;
+
+    DeleteProfile(&profile);
+    DeleteVM(&vmData, HS_TRUE, HS_TRUE);
+    DeleteVM(&expected, HS_FALSE, HS_TRUE);
+    return Report("TestCounts", testResult);
+}
+
+// Stopping and resuming does not change the counts, the ticks between calls are not counted
+int TestChunks()
+{
+    SStackData instructions = CompileCode("var i: int = 0; var f: float = 1.0; while (i < 100) { f = f * 1.5; i = i + 1; }");
+
+    SVMData whole;
+    SVMData chunked;
+    SProfile wholeProfile;
+    SProfile chunkedProfile;
+    RunProfiled(instructions, 100000, &wholeProfile, &whole);
+    RunProfiled(instructions, 7, &chunkedProfile, &chunked);
+
+    uint64_t ticks = 0;
+    for (int i = 0; i < INS_COUNT; ++i)
+        ticks += chunkedProfile.ticks[i];
+
+    Bool8 testResult = memcmp(wholeProfile.counts, chunkedProfile.counts, sizeof(wholeProfile.counts)) == 0
+        && memcmp(wholeProfile.hits, chunkedProfile.hits, (instructions.end - instructions.begin) * sizeof(uint64_t)) == 0
+        && chunkedProfile.lastInstruction == INS_COUNT
+        && ticks > 0;
+
+    DeleteProfile(&wholeProfile);
+    DeleteProfile(&chunkedProfile);
+    DeleteVM(&whole, HS_FALSE, HS_TRUE);
+    DeleteVM(&chunked, HS_TRUE, HS_TRUE);
+    return Report("TestChunks", testResult);
+}
+
+// One line per opcode and per offset which ran, after the header
+int TestCsv()
+{
+    SStackData instructions = CompileCode("var i: int = 0; while (i < 3) { i = i + 1; }");
+
+    SVMData vmData;
+    SProfile profile;
+    RunProfiled(instructions, 1000, &profile, &vmData);
+
+    int expectedLines = 1;
+    for (int i = 0; i < INS_COUNT; ++i)
+        expectedLines += profile.counts[i] > 0;
+    for (int i = 0; i < instructions.end - instructions.begin; ++i)
+        expectedLines += profile.hits[i] > 0;
+
+    Bool8 testResult = HS_FALSE;
+    FILE* file = tmpfile();
+    if (file)
+    {
+        WriteProfileCsv(&profile, file);
+        rewind(file);
+
+        char line[256];
+        int lines = 0;
+        Bool8 hasEnd = HS_FALSE;
+        while (fgets(line, sizeof(line), file))
+        {
+            ++lines;
+            hasEnd |= strncmp(line, "opcode,", 7) == 0 && strstr(line, ",INS_END,1,") != NULL;
+        }
+        fclose(file);
+        testResult = lines == expectedLines && hasEnd;
+    }
+
+    DeleteProfile(&profile);
+    DeleteVM(&vmData, HS_FALSE, HS_TRUE);
+    return Report("TestCsv", testResult);
+}
+
+// An invalid instruction is not counted and stops the VM as it would without the profiler
+int TestInvalidInstruction()
+{
+    SStackData instructions = CreateStack(10);
+    AddInstruction(&instructions, INS_NOOP);
+    AddInstruction(&instructions, INS_COUNT);
+    AddInstruction(&instructions, INS_END);
+    instructions.end = instructions.stackPointer;
+    instructions.stackPointer = instructions.begin;
+
+    SVMData vmData;
+    SProfile profile;
+    RunProfiled(instructions, 10, &profile, &vmData);
+
+    Bool8 testResult = vmData.error == VM_ERROR_INVALID_INSTRUCTION
+        && GetProfiledInstructionCount(&profile) == 1
+        && profile.counts[INS_NOOP] == 1
+        && profile.hits[1] == 0;
+
+    DeleteProfile(&profile);
+    DeleteVM(&vmData, HS_FALSE, HS_TRUE);
+    return Report("TestInvalidInstruction", testResult);
+}
+
+int main()
+{
+    int fails = 0;
+
+    fails += TestCounts();
+    fails += TestChunks();
+    fails += TestCsv();
+    fails += TestInvalidInstruction();
+
+    printf("\n%d tests failed\n", fails);
+    return fails;
+}
@@ -0,0 +1,282 @@
+#include <stdio.h>
+
+#include "bytecode_c.h"
+#include "compiler.h"
+#include "file.h"
+#include "register_vm.h"
+#include "tokenizer.h"
+#include "test_util.h"
+
+static const int DATA_SIZE = 1024;
+
+typedef struct
+{
+    const char* name;
+    const char* script; // NULL for the ones written below
+    const char* code;
+} SRegScript;
+
+static const SRegScript SCRIPTS[] =
+{
+    { "Fibonacci", "Fibonacci.hss", NULL },
+    { "Physics", "Physics.hss", NULL },
+    { "Primes", "Primes.hss", NULL },
+    { "Sum", "Sum.hss", NULL },
+    {
+        // Phis swapping their registers
+        "Swap", NULL,
+        "var a: int = 1; var b: int = 2; var i: int = 0;"
+        "while (i < 5) { var t: int = a; a = b; b = t; i = i + 1; }"
+    },
+    {
+        "Floats", NULL,
+        "var f: float = 0.0; var n: int = 0;"
+        "while (f < 2.5) { f = f + 0.5; if (f >= 1.0) { n = n + 1; } else { n = n - 1; } }"
+        "var nan: float = 0.0 / 0.0; var c: int = 0; if (nan >= 1.0) { c = 1; } if (nan < 1.0) { c = c + 4; } else { c = c + 2; }"
+    },
+    {
+        // Globals ending with the same value and a constant
+        "Globals", NULL,
+        "var a: int = 3; var b: int = a; var c: int = 7; var d: float = 1.5; if (a == 3) { b = c; c = a; }"
+    },
+    {
+        "Switch", NULL,
+        "var a: int = 0; var b: int = 0; var i: int = 0;"
+        "while (i < 8) { switch (i) { case 0: case 1: a = a + 1; case 2: b = b + a; case 4: a = b; case 5: b = 0; default: a = a + i; }"
+        "switch (i * 7) { case 14: b = b + 1; case -7: b = 1; case 700: a = 0; } i = i + 1; }"
+    },
+};
+
+static const int NUM_SCRIPTS = sizeof(SCRIPTS) / sizeof(SCRIPTS[0]);
+
+// The code of the script as a zero terminated string
+static char* ReadScript(const SRegScript* script)
+{
+    if (!script->script)
+    {
+        char* code = malloc(strlen(script->code) + 1);
+        strcpy(code, script->code);
+        return code;
+    }
+
+    char* code;
+    int size;
+    return ReadFile(script->script, &code, &size) ? code : NULL;
+}
+
+// Runs the program to the end, returns the number of instructions dispatched
+static int Run(SStackData instructions, SVMData* vmData)
+{
+    FuncArray funcArray = { 0 };
+    InitVM(vmData, instructions, DATA_SIZE, funcArray);
+
+    int count = 0;
+    while (VMProcessInstructions(vmData, 1))
+        ++count;
+    return count;
+}
+
+static int RunRegisters(const SRegProgram* program, SRegVMData* vmData)
+{
+    InitRegVM(vmData, program);
+
+    int count = 0;
+    while (RegVMProcessInstructions(vmData, 1))
+        ++count;
+    return count;
+}
+
+// The globals in the variable area of the stack VM, the first one allocated first
+static Bool8 HasSameGlobals(const SVMData* expected, const SRegVMData* vmData, const SRegProgram* program)
+{
+    byte* var = expected->dataStack.base.end;
+    for (int i = 0; i < program->globalCount; ++i)
+    {
+        if (program->globalTypes[i] == IRT_INT)
+        {
+            var -= HS_DATA_SIZE_INT;
+            if (LoadVarInt(var) != vmData->registers[i].i)
+                return HS_FALSE;
+        }
+        else
+        {
+            var -= HS_DATA_SIZE_FLOAT;
+            if (memcmp(&(hsbfloat){ LoadVarFloat(var) }, &vmData->registers[i].f, sizeof(hsbfloat)) != 0)
+                return HS_FALSE;
+        }
+    }
+    return var == expected->dataStack.reversePointer && expected->error == VM_OK && vmData->error == VM_OK;
+}
+
+// The globals end up the same as with the stack VM, in fewer dispatches than the optimized
+// stack bytecode takes
+int TestSameAsStackVM()
+{
+    Bool8 testResult = HS_TRUE;
+    for (int i = 0; i < NUM_SCRIPTS; ++i)
+    {
+        char* code = ReadScript(&SCRIPTS[i]);
+        SStackData compiled;
+        SStackData optimized;
+        SRegProgram program;
+        if (!code
+            || CompileSourceOptimized(code, strlen(code), 0, &compiled) != R_OK
+            || CompileSourceOptimized(code, strlen(code), 1, &optimized) != R_OK
+            || CompileSourceToRegisters(code, strlen(code), &program) != R_OK)
+        {
+            free(code);
+            return Report("TestSameAsStackVM", HS_FALSE);
+        }
+        free(code);
+
+        SVMData expected;
+        SVMData vmData;
+        SRegVMData regVMData;
+        Run(compiled, &expected);
+        int optimizedCount = Run(optimized, &vmData);
+        int count = RunRegisters(&program, &regVMData);
+        if (!HasSameGlobals(&expected, &regVMData, &program) || count >= optimizedCount)
+        {
+            printf("%s differs, %d and %d dispatches\n", SCRIPTS[i].name, optimizedCount, count);
+            testResult = HS_FALSE;
+        }
+
+        DeleteVM(&expected, HS_FALSE, HS_TRUE);
+        DeleteVM(&vmData, HS_FALSE, HS_TRUE);
+        DeleteRegProgram(&program);
+    }
+
+    return Report("TestSameAsStackVM", testResult);
+}
+
+// Lowering does not depend on the passes having run, copies and all
+int TestLowerUnoptimized()
+{
+    Bool8 testResult = HS_TRUE;
+    for (int i = 0; i < NUM_SCRIPTS; ++i)
+    {
+        char* code = ReadScript(&SCRIPTS[i]);
+        SStackData compiled;
+        SToken* tokens;
+        int tokenCount;
+        SASTNode* root;
+        SIRProgram ir;
+        SRegProgram program;
+        if (!code || CompileSourceOptimized(code, strlen(code), 0, &compiled) != R_OK
+            || Tokenize(code, strlen(code), &tokens, &tokenCount) != R_OK)
+        {
+            free(code);
+            return Report("TestLowerUnoptimized", HS_FALSE);
+        }
+
+        EResult r = Parse(tokens, tokenCount, &root);
+        if (r == R_OK)
+            r = BuildIR(root, &ir);
+        if (r == R_OK)
+        {
+            r = LowerIRToRegisters(&ir, &program);
+            FreeIR(&ir);
+        }
+        FreeTokens(&tokens, &tokenCount);
+        free(code);
+
+        SVMData expected;
+        SRegVMData vmData;
+        Run(compiled, &expected);
+        if (r != R_OK)
+        {
+            printf("%s does not lower\n", SCRIPTS[i].name);
+            testResult = HS_FALSE;
+        }
+        else
+        {
+            RunRegisters(&program, &vmData);
+            if (!HasSameGlobals(&expected, &vmData, &program))
+            {
+                printf("%s differs\n", SCRIPTS[i].name);
+                testResult = HS_FALSE;
+            }
+            DeleteRegProgram(&program);
+        }
+
+        DeleteVM(&expected, HS_FALSE, HS_TRUE);
+    }
+
+    return Report("TestLowerUnoptimized", testResult);
+}
+
+int TestInstructionSizes()
+{
+    Bool8 testResult = GetRegInstructionSize(RINS_COUNT) == 0;
+    for (int instruction = 0; instruction < RINS_COUNT; ++instruction)
+        testResult = testResult && GetRegInstructionSize(instruction) > 0;
+
+    // Every instruction of a program is followed by the next one
+    char code[] = "var x: int = 0; var y: float = 0.5; while (x < 10) { x = x + 1; y = y * 2.0; }";
+    SRegProgram program;
+    if (CompileSourceToRegisters(code, strlen(code), &program) != R_OK)
+        return Report("TestInstructionSizes", HS_FALSE);
+
+    byte* ins = program.instructions.begin;
+    while (ins < program.instructions.end && GetRegInstructionSize(*ins) > 0)
+        ins += GetRegInstructionSize(*ins);
+    testResult = testResult && ins == program.instructions.end && program.instructions.end[-1] == RINS_END;
+
+    DeleteRegProgram(&program);
+    return Report("TestInstructionSizes", testResult);
+}
+
+int TestInvalidInstruction()
+{
+    byte code[] = { RINS_LOAD_I, 1, 0, 0, RINS_COUNT, RINS_END };
+    SRegProgram program = { .instructions = { code, code + sizeof(code), code } };
+    SRegVMData vmData;
+    InitRegVM(&vmData, &program);
+
+    Bool8 testResult = RegVMProcessInstructions(&vmData, 1) == HS_TRUE
+        && RegVMProcessInstructions(&vmData, 1) == HS_FALSE
+        && vmData.error == VM_ERROR_INVALID_INSTRUCTION
+        && vmData.instructionStack.stackPointer == code + 4;
+
+    return Report("TestInvalidInstruction", testResult);
+}
+
+int TestErrors()
+{
+    const char* invalid[] =
+    {
+        "var x: int = 1.0;",
+        "x = 1;",
+        "var x: bool;",
+    };
+
+    Bool8 testResult = HS_TRUE;
+    for (int i = 0; i < (int)(sizeof(invalid) / sizeof(invalid[0])); ++i)
+    {
+        char code[256];
+        strcpy(code, invalid[i]);
+
+        SRegProgram program;
+        if (CompileSourceToRegisters(code, strlen(code), &program) == R_OK)
+        {
+            DeleteRegProgram(&program);
+            testResult = HS_FALSE;
+        }
+    }
+
+    return Report("TestErrors", testResult);
+}
+
+int main()
+{
+    int fails = 0;
+
+    fails += TestSameAsStackVM();
+    fails += TestLowerUnoptimized();
+    fails += TestInstructionSizes();
+    fails += TestInvalidInstruction();
+    fails += TestErrors();
+
+    printf("\n%d tests failed\n", fails);
+    return fails;
+}
@@ -0,0 +1,176 @@
+#include <stdio.h>
+
+#include "bytecode_c.h"
+#include "embed.h"
+#include "runner.h"
+#include "test_util.h"
+
+static char s_code[] =
+    "fun sum(a: int, b: int, c: int): int { return a + b * 10 + c * 100; }\n"
+    "fun scale(value: int, factor: float): float\n"
+    "{\n"
+    "    var result: float = 0.0;\n"
+    "    var i: int = 0;\n"
+    "    while (i < value) { result = result + factor; i = i + 1; }\n"
+    "    return result;\n"
+    "}\n"
+    "fun depth(n: int): int { if (n == 0) return 0; return depth(n - 1) + 1; }\n";
+
+static void InitJobs(SScriptJob* jobs, int jobCount, const SProgram* program)
+{
+    for (int i = 0; i < jobCount; ++i)
+    {
+        SScriptJob* job = &jobs[i];
+        job->result.i = -1;
+        switch (i % 3)
+        {
+            case 0:
+                job->function = FindFunction(program, "sum");
+                job->argumentCount = 3;
+                job->arguments[0].i = (hsbint)(i % 10);
+                job->arguments[1].i = (hsbint)(i % 7);
+                job->arguments[2].i = (hsbint)(i % 5);
+                break;
+            case 1:
+                job->function = FindFunction(program, "scale");
+                job->argumentCount = 2;
+                job->arguments[0].i = (hsbint)(i % 20);
+                job->arguments[1].f = 0.5f;
+                break;
+            default:
+                job->function = FindFunction(program, "depth");
+                job->argumentCount = 1;
+                job->arguments[0].i = (hsbint)(i % 50);
+                break;
+        }
+    }
+}
+
+// Every job has the result CallFunction gets for it on this thread
+static Bool8 CheckJobs(const SScriptJob* jobs, int jobCount, const SProgram* program)
+{
+    SScriptContext context;
+    InitScriptContext(&context, program);
+
+    Bool8 testResult = HS_TRUE;
+    for (int i = 0; i < jobCount && testResult; ++i)
+    {
+        // the bytes past an int result stay the same
+        SScriptValue result = jobs[i].result;
+        testResult = jobs[i].status == R_OK
+            && CallFunction(&context, jobs[i].function, jobs[i].arguments, jobs[i].argumentCount, &result) == R_OK
+            && memcmp(&result, &jobs[i].result, sizeof(SScriptValue)) == 0;
+    }
+
+    DeleteScriptContext(&context);
+    return testResult;
+}
+
+int TestRunJobs()
+{
+    SProgram* program = CreateSharedProgram(s_code, strlen(s_code), NULL);
+    if (!program)
+        return Report("TestRunJobs", HS_FALSE);
+
+    enum { JOBS = 1000 };
+    static SScriptJob jobs[JOBS];
+    Bool8 testResult = HS_TRUE;
+    int threadCounts[] = { 1, 2, 4 };
+    for (int i = 0; i < 3 && testResult; ++i)
+    {
+        SScriptRunner* runner = CreateScriptRunner(program, threadCounts[i]);
+        InitJobs(jobs, JOBS, program);
+        testResult = RunScriptJobs(runner, jobs, JOBS) == R_OK
+            && CheckJobs(jobs, JOBS, program)
+            && RunScriptJobs(runner, jobs, 0) == R_OK;
+        DeleteScriptRunner(runner);
+    }
+
+    ReleaseProgram(program);
+    return Report("TestRunJobs", testResult);
+}
+
+// The runner keeps the program alive after the creator released it
+int TestReferences()
+{
+    SProgram* program = CreateSharedProgram(s_code, strlen(s_code), NULL);
+    if (!program)
+        return Report("TestReferences", HS_FALSE);
+
+    SScriptRunner* runner = CreateScriptRunner(program, 3);
+    Bool8 testResult = program->references == 2;
+    SProgram* retained = RetainProgram(program);
+    testResult = testResult && retained == program && program->references == 3;
+    ReleaseProgram(retained);
+    ReleaseProgram(program);
+    testResult = testResult && program->references == 1;
+
+    SScriptJob jobs[5];
+    for (int i = 0; i < 5; ++i)
+    {
+        jobs[i].function = 0;
+        jobs[i].argumentCount = 3;
+        jobs[i].arguments[0].i = (hsbint)i;
+        jobs[i].arguments[1].i = 1;
+        jobs[i].arguments[2].i = 2;
+    }
+    testResult = testResult && RunScriptJobs(runner, jobs, 5) == R_OK
+        && jobs[0].result.i == 210 && jobs[4].result.i == 214;
+
+    DeleteScriptRunner(runner);
+
+    char invalid[] = "fun f(): int { }";
+    testResult = testResult && CreateSharedProgram(invalid, strlen(invalid), NULL) == NULL;
+    return Report("TestReferences", testResult);
+}
+
+// Many rounds on several threads, with jobs that fail in between. Build with
+// -fsanitize=thread to check the runner for data races.
+int TestStress()
+{
+    SProgram* program = CreateSharedProgram(s_code, strlen(s_code), NULL);
+    if (!program)
+        return Report("TestStress", HS_FALSE);
+
+    SScriptRunner* runner = CreateScriptRunner(program, 4);
+
+    enum { JOBS = 700, ROUNDS = 50 };
+    static SScriptJob jobs[JOBS];
+    Bool8 testResult = HS_TRUE;
+    for (int round = 0; round < ROUNDS && testResult; ++round)
+    {
+        InitJobs(jobs, JOBS, program);
+        int failing = round % 2 ? (round * 37) % JOBS : -1;
+        if (failing >= 0)
+        {
+            // deeper than the data stack of a context
+            jobs[failing].function = FindFunction(program, "depth");
+            jobs[failing].argumentCount = 1;
+            jobs[failing].arguments[0].i = 30000;
+        }
+
+        testResult = RunScriptJobs(runner, jobs, JOBS) == (failing >= 0 ? R_ERROR : R_OK);
+        if (failing >= 0)
+        {
+            testResult = testResult && jobs[failing].status == R_ERROR;
+            jobs[failing] = jobs[0];
+        }
+        testResult = testResult && CheckJobs(jobs, JOBS, program);
+    }
+
+    DeleteScriptRunner(runner);
+    ReleaseProgram(program);
+    return Report("TestStress", testResult);
+}
+
+int main()
+{
+    int fails = 0;
+
+    fails += TestRunJobs();
+    fails += TestReferences();
+    fails += TestStress();
+
+    printf("\n%d tests failed\n", fails);
+    return fails;
+}
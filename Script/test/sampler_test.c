@@ -0,0 +1,276 @@
+#include <stdio.h>
+
+#include "bytecode_c.h"
+#include "bytecode_info.h"
+#include "compiler.h"
+#include "sampler.h"
+#include "test_util.h"
+
+static const int DATA_SIZE = 200;
+
+// Runs the program to the end count instructions at a time, returns the number of instructions
+static int RunSampled(SStackData instructions, int period, SSampleProfile* profile, SVMData* vmData)
+{
+    SVMData counted;
+    FuncArray funcArray = { 0 };
+    InitVM(&counted, instructions, DATA_SIZE, funcArray);
+    int count = 1;
+    while (VMProcessInstructions(&counted, 1))
+        ++count;
+    DeleteVM(&counted, HS_TRUE, HS_TRUE);
+
+    InitVM(vmData, instructions, DATA_SIZE, funcArray);
+    InitSampleProfile(profile, instructions, period);
+    while (SampledProcessInstructions(vmData, 1000, profile))
+    {
+    }
+    return count;
+}
+
+// The folded stacks the way a flame graph tool would read them, returns the sum of the samples
+static uint64_t ReadFolded(const SSampleProfile* profile, const SLineTable* lines, const char* name, Bool8 perLine,
+    char* text, int textSize)
+{
+    FILE* file = tmpfile();
+    if (!file)
+        return 0;
+
+    WriteFoldedStacks(profile, lines, name, perLine, file);
+    rewind(file);
+    int size = fread(text, 1, textSize - 1, file);
+    text[size] = 0;
+    fclose(file);
+
+    uint64_t total = 0;
+    for (char* line = text; *line; )
+    {
+        char* end = strchr(line, '\n');
+        if (!end)
+            return 0;
+        *end = 0;
+        char* space = strrchr(line, ' ');
+        if (space)
+            total += strtoull(space + 1, NULL, 10);
+        *end = '\n';
+        if (!space)
+            return 0;
+        line = end + 1;
+    }
+    return total;
+}
+
+// A sample every period instructions on average, each at the start of an instruction
+int TestSampleCount()
+{
+    char code[] = "var i: int = 0; var f: float = 1.0; while (i < 2000) { f = f * 1.5; i = i + 1; }";
+    SStackData instructions;
+    if (CompileSource(code, strlen(code), &instructions) != R_OK)
+        return Report("TestSampleCount", HS_FALSE);
+
+    SVMData vmData;
+    SSampleProfile profile;
+    const int period = 50;
+    int count = RunSampled(instructions, period, &profile, &vmData);
+
+    int size = instructions.end - instructions.begin;
+    Bool8* isStart = calloc(size, sizeof(Bool8));
+    for (int offset = 0; offset < size && GetInstructionSize(instructions.begin[offset]) > 0; offset += GetInstructionSize(instructions.begin[offset]))
+        isStart[offset] = HS_TRUE;
+
+    uint64_t samples = 0;
+    Bool8 onStarts = HS_TRUE;
+    for (int offset = 0; offset < size; ++offset)
+    {
+        samples += profile.samples[offset];
+        onStarts = onStarts && (isStart[offset] || profile.samples[offset] == 0);
+    }
+
+    uint64_t expected = count / period;
+    Bool8 testResult = samples == profile.sampleCount
+        && profile.sampleCount >= expected * 9 / 10 && profile.sampleCount <= expected * 11 / 10
+        && onStarts
+        && vmData.error == VM_OK
+        && LoadVarInt(vmData.dataStack.reversePointer + HS_DATA_SIZE_FLOAT) == 2000;
+
+    free(isStart);
+    DeleteSampleProfile(&profile);
+    DeleteVM(&vmData, HS_FALSE, HS_TRUE);
+    return Report("TestSampleCount", testResult);
+}
+
+// main calls outer 30 times, outer calls inner, which loops in an INS_ENTER frame. The samples in
+// inner have both return addresses.
+int TestSampleStacks()
+{
+    SStackData s = CreateStack(100);
+    AddInstruction(&s, INS_ALLOC_VAR_I);
+    hsbaddress mainLoop = Here(&s);
+    hsbaddress callOuter = Here(&s);
+    AddJump(&s, INS_CALL, 0);
+    AddOffset(&s, INS_LOAD_VAR_I, 0);
+    AddInt(&s, INS_ADD_LITERAL_I, 1);
+    AddOffset(&s, INS_SAVE_VAR_I, 0);
+    AddOffset(&s, INS_LOAD_VAR_I, 0);
+    AddInt(&s, INS_LITERAL_I, 30);
+    AddInstruction(&s, INS_CMP_I_LESS);
+    AddJump(&s, INS_COND_JUMP_B, mainLoop);
+    AddInstruction(&s, INS_END);
+
+    hsbaddress outer = Here(&s);
+    StoreAddress(s.begin + callOuter + 1, outer);
+    hsbaddress callInner = Here(&s);
+    AddJump(&s, INS_CALL, 0);
+    AddInstruction(&s, INS_RETURN);
+
+    hsbaddress inner = Here(&s);
+    StoreAddress(s.begin + callInner + 1, inner);
+    AddInstruction(&s, INS_ENTER);
+    *s.stackPointer++ = 0;
+    *s.stackPointer++ = 1;
+    *s.stackPointer++ = 0;
+    hsbaddress innerLoop = Here(&s);
+    AddOffset(&s, INS_LOAD_FRAME_I, 0);
+    AddInt(&s, INS_ADD_LITERAL_I, 1);
+    AddOffset(&s, INS_SAVE_FRAME_I, 0);
+    AddOffset(&s, INS_LOAD_FRAME_I, 0);
+    AddInt(&s, INS_LITERAL_I, 40);
+    AddInstruction(&s, INS_CMP_I_LESS);
+    AddJump(&s, INS_COND_JUMP_B, innerLoop);
+    AddInstruction(&s, INS_LEAVE);
+    SStackData instructions = Finish(s);
+
+    SVMData vmData;
+    SSampleProfile profile;
+    RunSampled(instructions, 13, &profile, &vmData);
+
+    const hsbaddress returnToMain = callOuter + 1 + sizeof(hsbaddress);
+    const hsbaddress returnToOuter = callInner + 1 + sizeof(hsbaddress);
+    uint64_t innerSamples = 0;
+    Bool8 testResult = profile.sampleCount > 0 && LoadVarInt(vmData.dataStack.reversePointer) == 30;
+    for (int i = 0; i < profile.stackCount; ++i)
+    {
+        const SSampleStack* stack = &profile.stacks[i];
+        const hsbaddress* frames = profile.frames + stack->first;
+        int leaf = frames[stack->depth - 1];
+        int function = profile.functions[leaf];
+        if (function == inner)
+        {
+            testResult = testResult && stack->depth == 3 && frames[0] == returnToMain && frames[1] == returnToOuter;
+            innerSamples += stack->count;
+        }
+        else if (function == outer)
+        {
+            testResult = testResult && stack->depth == 2 && frames[0] == returnToMain;
+        }
+        else
+        {
+            testResult = testResult && function == 0 && stack->depth == 1;
+        }
+    }
+
+    // Most of the time goes to inner, the per function folded stacks have a line for it
+    char text[1024];
+    char expected[64];
+    sprintf(expected, "main;function_%d;function_%d ", outer, inner);
+    testResult = testResult && innerSamples > profile.sampleCount / 2
+        && ReadFolded(&profile, NULL, NULL, HS_FALSE, text, sizeof(text)) == profile.sampleCount
+        && strstr(text, expected) != NULL;
+
+    // Without a line table the frames have the offsets of the calls
+    sprintf(expected, "main+%d;function_%d+%d;function_%d+", callOuter, outer, callInner, inner);
+    testResult = testResult && ReadFolded(&profile, NULL, "calls", HS_TRUE, text, sizeof(text)) == profile.sampleCount
+        && strncmp(text, "calls;main+", 11) == 0
+        && strstr(text, expected) != NULL;
+
+    DeleteSampleProfile(&profile);
+    DeleteVM(&vmData, HS_FALSE, HS_TRUE);
+    return Report("TestSampleStacks", testResult);
+}
+
+// The folded stacks per line and the report name the lines of the source
+int TestSampleLines()
+{
+    char code[] =
+        "var n: int = 0;\n"
+        "var sum: int = 0;\n"
+        "while (n < 100)\n"
+        "{\n"
+        "    var d: int = 0;\n"
+        "    while (d < 20) { sum = sum + d * n; d = d + 1; }\n"
+        "    n = n + 1;\n"
+        "}\n";
+
+    SStackData instructions;
+    SLineTable lines;
+    if (CompileSourceWithLines(code, strlen(code), &instructions, &lines) != R_OK)
+        return Report("TestSampleLines", HS_FALSE);
+
+    SVMData vmData;
+    SSampleProfile profile;
+    RunSampled(instructions, 17, &profile, &vmData);
+
+    // Lines sorted by their text, the inner loop takes most samples
+    char text[1024];
+    uint64_t total = ReadFolded(&profile, &lines, "loops.hss", HS_TRUE, text, sizeof(text));
+    char* hot = strstr(text, "loops.hss;main:6 ");
+    Bool8 testResult = total == profile.sampleCount
+        && strncmp(text, "loops.hss;main:", 15) == 0
+        && hot && strtoull(hot + 17, NULL, 10) > profile.sampleCount / 2;
+
+    FILE* file = tmpfile();
+    if (file)
+    {
+        PrintSampleProfile(&profile, &lines, code, file);
+        rewind(file);
+        int size = fread(text, 1, sizeof(text) - 1, file);
+        text[size] = 0;
+        fclose(file);
+        testResult = testResult && strstr(text, "while (d < 20) { sum = sum + d * n; d = d + 1; }") != NULL;
+    }
+    else
+    {
+        testResult = HS_FALSE;
+    }
+
+    DeleteSampleProfile(&profile);
+    DeleteLineTable(&lines);
+    DeleteVM(&vmData, HS_FALSE, HS_TRUE);
+    return Report("TestSampleLines", testResult);
+}
+
+// Code the verifier rejects is sampled without callers and stops as it would without samples
+int TestUnverified()
+{
+    SStackData instructions = CreateStack(10);
+    AddInstruction(&instructions, INS_NOOP);
+    AddInstruction(&instructions, INS_NOOP);
+    AddInstruction(&instructions, INS_COUNT);
+    AddInstruction(&instructions, INS_END);
+    instructions = Finish(instructions);
+
+    SVMData vmData;
+    SSampleProfile profile;
+    RunSampled(instructions, 1, &profile, &vmData);
+
+    Bool8 testResult = vmData.error == VM_ERROR_INVALID_INSTRUCTION
+        && profile.sampleCount == 2
+        && profile.samples[1] == 1 && profile.samples[2] == 1
+        && profile.stackCount == 2 && profile.stacks[0].depth == 1 && profile.stacks[1].depth == 1;
+
+    DeleteSampleProfile(&profile);
+    DeleteVM(&vmData, HS_FALSE, HS_TRUE);
+    return Report("TestUnverified", testResult);
+}
+
+int main()
+{
+    int fails = 0;
+
+    fails += TestSampleCount();
+    fails += TestSampleStacks();
+    fails += TestSampleLines();
+    fails += TestUnverified();
+
+    printf("\n%d tests failed\n", fails);
+    return fails;
+}
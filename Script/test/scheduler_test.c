@@ -0,0 +1,182 @@
+#include <stdio.h>
+
+#include "bytecode_c.h"
+#include "embed.h"
+#include "scheduler.h"
+#include "test_util.h"
+
+static char s_code[] =
+    "fun wait(frames: int): int\n"
+    "{\n"
+    "    var i: int = 0;\n"
+    "    while (i < frames) { yield; i = i + 1; }\n"
+    "    return i * 10;\n"
+    "}\n"
+    "fun work(n: int): float\n"
+    "{\n"
+    "    var result: float = 0.0;\n"
+    "    while (n > 0) { result = result + 0.5; n = n - 1; }\n"
+    "    return result;\n"
+    "}\n"
+    "fun depth(n: int): int { if (n == 0) return 0; return depth(n - 1) + 1; }\n"
+    "fun nested(n: int): int { var a: int = wait(n); yield; return a + wait(n) + 1; }\n";
+
+// A started function runs up to each yield, a call runs through them
+int TestResume()
+{
+    SProgram program;
+    if (CreateProgram(s_code, sizeof(s_code) - 1, NULL, &program) != R_OK)
+        return Report("TestResume", HS_FALSE);
+
+    SScriptContext context;
+    InitScriptContext(&context, &program);
+
+    SScriptValue arguments[] = { { .i = 3 } };
+    SScriptValue result = { 0 };
+    Bool8 testResult = StartFunction(&context, FindFunction(&program, "wait"), arguments, 1) == R_OK;
+    for (int i = 0; i < 3; ++i)
+        testResult = testResult && ResumeFunction(&context, 1000, &result) == SCRIPT_RUNNING;
+    testResult = testResult && ResumeFunction(&context, 1000, &result) == SCRIPT_FINISHED && result.i == 30
+        && ResumeFunction(&context, 1000, &result) == SCRIPT_FAILED;
+
+    // the yields of the callee suspend the caller as well
+    testResult = testResult && StartFunction(&context, FindFunction(&program, "nested"), arguments, 1) == R_OK;
+    for (int i = 0; i < 7; ++i)
+        testResult = testResult && ResumeFunction(&context, 1000, &result) == SCRIPT_RUNNING;
+    testResult = testResult && ResumeFunction(&context, 1000, &result) == SCRIPT_FINISHED && result.i == 61;
+
+    result.i = 0;
+    testResult = testResult && CallFunction(&context, FindFunction(&program, "nested"), arguments, 1, &result) == R_OK
+        && result.i == 61
+        && StartFunction(&context, FindFunction(&program, "wait"), arguments, 2) == R_ERROR;
+
+    DeleteScriptContext(&context);
+    DeleteProgram(&program);
+    return Report("TestResume", testResult);
+}
+
+// Every instance of "wait n frames" finishes in the tick after its n yields
+int TestWaitFrames()
+{
+    SProgram program;
+    if (CreateProgram(s_code, sizeof(s_code) - 1, NULL, &program) != R_OK)
+        return Report("TestWaitFrames", HS_FALSE);
+
+    SScheduler scheduler;
+    InitScheduler(&scheduler, &program, 1000);
+
+    enum { INSTANCES = 100 };
+    int instances[INSTANCES];
+    Bool8 testResult = HS_TRUE;
+    for (int i = 0; i < INSTANCES; ++i)
+    {
+        SScriptValue arguments[] = { { .i = (hsbint)(i % 10) } };
+        instances[i] = SpawnInstance(&scheduler, FindFunction(&program, "wait"), arguments, 1);
+        testResult = testResult && instances[i] == i;
+    }
+
+    for (int tick = 1; tick <= 10 && testResult; ++tick)
+    {
+        int running = RunSchedulerTick(&scheduler);
+        testResult = running == INSTANCES / 10 * (10 - tick);
+        for (int i = 0; i < INSTANCES && testResult; ++i)
+        {
+            const SScriptInstance* instance = GetInstance(&scheduler, instances[i]);
+            if (i % 10 < tick)
+                testResult = instance->state == SCRIPT_FINISHED && instance->result.i == i % 10 * 10;
+            else
+                testResult = instance->state == SCRIPT_RUNNING;
+        }
+    }
+
+    testResult = testResult && RunSchedulerTick(&scheduler) == 0;
+    DeleteScheduler(&scheduler);
+    DeleteProgram(&program);
+    return Report("TestWaitFrames", testResult);
+}
+
+// A function without yields is preempted after its quantum and gets the same result
+int TestQuantum()
+{
+    SProgram program;
+    if (CreateProgram(s_code, sizeof(s_code) - 1, NULL, &program) != R_OK)
+        return Report("TestQuantum", HS_FALSE);
+
+    SScheduler scheduler;
+    InitScheduler(&scheduler, &program, 50);
+
+    SScriptValue arguments[] = { { .i = 100 } };
+    int slow = SpawnInstance(&scheduler, FindFunction(&program, "work"), arguments, 1);
+    int fast = SpawnInstance(&scheduler, FindFunction(&program, "work"), arguments, 1);
+    SetInstanceQuantum(&scheduler, fast, 100000);
+
+    int ticks = 0;
+    Bool8 testResult = HS_TRUE;
+    while (RunSchedulerTick(&scheduler) > 0)
+    {
+        ++ticks;
+        testResult = testResult && GetInstance(&scheduler, fast)->state == SCRIPT_FINISHED;
+    }
+
+    testResult = testResult && ticks > 10
+        && GetInstance(&scheduler, slow)->result.f == 50.0f
+        && GetInstance(&scheduler, fast)->result.f == 50.0f;
+
+    DeleteScheduler(&scheduler);
+    DeleteProgram(&program);
+    return Report("TestQuantum", testResult);
+}
+
+// Freed and failed instances, the contexts of freed ones are taken over
+int TestFreeInstance()
+{
+    SProgram program;
+    if (CreateProgram(s_code, sizeof(s_code) - 1, NULL, &program) != R_OK)
+        return Report("TestFreeInstance", HS_FALSE);
+
+    SScheduler scheduler;
+    InitScheduler(&scheduler, &program, 1000);
+
+    SScriptValue arguments[] = { { .i = 5 } };
+    SScriptValue deep[] = { { .i = 30000 } };
+    int wait = FindFunction(&program, "wait");
+    int first = SpawnInstance(&scheduler, wait, arguments, 1);
+    int second = SpawnInstance(&scheduler, wait, arguments, 1);
+    int failing = SpawnInstance(&scheduler, FindFunction(&program, "depth"), deep, 1);
+    int third = SpawnInstance(&scheduler, wait, arguments, 1);
+    SetInstanceQuantum(&scheduler, failing, 1000000);
+
+    Bool8 testResult = SpawnInstance(&scheduler, wait, arguments, 0) == -1 && RunSchedulerTick(&scheduler) == 3;
+
+    // stopped while it runs, the others keep going in their order
+    FreeInstance(&scheduler, second);
+    testResult = testResult && GetInstance(&scheduler, second) == NULL
+        && GetInstance(&scheduler, failing)->state == SCRIPT_FAILED
+        && scheduler.runningCount == 2 && scheduler.running[0] == first && scheduler.running[1] == third;
+
+    SScriptValue later[] = { { .i = 1 } };
+    int reused = SpawnInstance(&scheduler, wait, later, 1);
+    testResult = testResult && reused == second && scheduler.running[2] == reused;
+
+    for (int tick = 0; tick < 10; ++tick)
+        RunSchedulerTick(&scheduler);
+    testResult = testResult && GetInstance(&scheduler, reused)->result.i == 10
+        && GetInstance(&scheduler, first)->result.i == 50 && GetInstance(&scheduler, third)->result.i == 50;
+
+    DeleteScheduler(&scheduler);
+    DeleteProgram(&program);
+    return Report("TestFreeInstance", testResult);
+}
+
+int main()
+{
+    int fails = 0;
+
+    fails += TestResume();
+    fails += TestWaitFrames();
+    fails += TestQuantum();
+    fails += TestFreeInstance();
+
+    printf("\n%d tests failed\n", fails);
+    return fails;
+}
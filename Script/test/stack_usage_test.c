@@ -0,0 +1,321 @@
+#include <stdio.h>
+
+#include "bytecode_c.h"
+#include "compiler.h"
+#include "optimizer.h"
+#include "stack_usage.h"
+#include "verifier.h"
+#include "test_util.h"
+
+static void AddOperand(SStackData* instructionStack, EInstruction instruction, int operand)
+{
+    AddInstruction(instructionStack, instruction);
+    *instructionStack->stackPointer++ = operand;
+}
+
+static int Max(int a, int b)
+{
+    return a > b ? a : b;
+}
+
+int TestCompiledScript()
+{
+    char code[] =
+        "var i: int = 0;"
+        "var sum: int = 0;"
+        "while (i < 100)"
+        "{"
+        "    var twice: int = i * 2;"
+        "    if (twice > 10) sum = sum + twice;"
+        "    i = i + 1;"
+        "}";
+
+    SStackData instructions;
+    Bool8 testResult = CompileSource(code, strlen(code), &instructions) == R_OK;
+    testResult = testResult && FuseSuperinstructions(&instructions) == R_OK;
+
+    // Without calls the bound is the one the verifier finds
+    SStackUsage usage;
+    SVerifyResult verifyResult;
+    testResult = testResult && AnalyzeStackUsage(instructions, &usage) == R_OK
+        && VerifyInstructions(instructions, 200, &verifyResult) == R_OK
+        && usage.errorOffset == -1
+        && usage.functionCount == 1
+        && !usage.isRecursive
+        && usage.callReserve == 0
+        && usage.requiredDataSize == verifyResult.maxDataSize
+        && usage.functions[0].maxFrameSize == 3 * HS_DATA_SIZE_INT;
+
+    SVMData vmData;
+    FuncArray funcArray = { 0 };
+    InitVMForProgram(&vmData, instructions, &usage, 0, funcArray);
+
+    while (VMProcessInstructions(&vmData, 1))
+    {
+    }
+
+    testResult = testResult && vmData.error == VM_OK
+        && vmData.dataStack.base.end - vmData.dataStack.base.begin == usage.requiredDataSize
+        && *vmData.instructionStack.stackPointer == INS_END
+        && LoadVarInt(vmData.dataStack.reversePointer) == 9870;
+
+    FreeStackUsage(&usage);
+    DeleteVM(&vmData, HS_FALSE, HS_TRUE);
+    return Report("TestCompiledScript", testResult);
+}
+
+int TestCallChain()
+{
+    //  0 main: LITERAL_I 1, CALL f, END
+    //  7 f:    LITERAL_I 2, CALL g, ADD_I, RETURN
+    // 15 g:    ALLOC_VAR_F, DEALLOC_VAR_F, LITERAL_I 3, RETURN
+    SStackData instructionStack = CreateStack(100);
+    AddInt(&instructionStack, INS_LITERAL_I, 1);
+    AddJump(&instructionStack, INS_CALL, 7);
+    AddInstruction(&instructionStack, INS_END);
+    AddInt(&instructionStack, INS_LITERAL_I, 2);
+    AddJump(&instructionStack, INS_CALL, 15);
+    AddInstruction(&instructionStack, INS_ADD_I);
+    AddInstruction(&instructionStack, INS_RETURN);
+    AddInstruction(&instructionStack, INS_ALLOC_VAR_F);
+    AddInstruction(&instructionStack, INS_DEALLOC_VAR_F);
+    AddInt(&instructionStack, INS_LITERAL_I, 3);
+    AddInstruction(&instructionStack, INS_RETURN);
+    SStackData instructions = Finish(instructionStack);
+
+    const int I = HS_DATA_SIZE_INT;
+    const int A = HS_DATA_SIZE_ADDRESS;
+    int gSize = Max(HS_DATA_SIZE_FLOAT, I);
+    int fSize = Max(2 * I, I + A + gSize);
+    int mainSize = I + A + fSize;
+
+    SStackUsage usage;
+    Bool8 testResult = AnalyzeStackUsage(instructions, &usage) == R_OK
+        && usage.functionCount == 3
+        && !usage.isRecursive
+        && usage.functions[1].entry == 7
+        && usage.functions[1].maxOperandSize == 2 * I
+        && usage.functions[1].maxLocalSize == 2 * I
+        && usage.functions[2].entry == 15
+        && usage.functions[2].maxFrameSize == HS_DATA_SIZE_FLOAT
+        && usage.functions[2].maxTotalSize == gSize
+        && usage.functions[1].maxTotalSize == fSize
+        && usage.requiredDataSize == mainSize;
+
+    SVMData vmData;
+    FuncArray funcArray = { 0 };
+    InitVMForProgram(&vmData, instructions, &usage, 0, funcArray);
+
+    while (VMProcessInstructions(&vmData, 1))
+    {
+    }
+
+    testResult = testResult && vmData.error == VM_OK
+        && vmData.dataStack.base.stackPointer == vmData.dataStack.base.begin + 2 * I
+        && LoadVarInt(vmData.dataStack.base.begin) == 1
+        && LoadVarInt(vmData.dataStack.base.begin + I) == 5
+        && *vmData.instructionStack.stackPointer == INS_END;
+
+    FreeStackUsage(&usage);
+    DeleteVM(&vmData, HS_FALSE, HS_TRUE);
+    return Report("TestCallChain", testResult);
+}
+
+// main: LITERAL_I count, CALL countdown, END
+// countdown pops its argument into a variable and calls itself until it reaches 0
+static SStackData CreateCountdown(hsbint count)
+{
+    SStackData instructionStack = CreateStack(100);
+    AddInt(&instructionStack, INS_LITERAL_I, count);
+    AddJump(&instructionStack, INS_CALL, 7);
+    AddInstruction(&instructionStack, INS_END);
+    AddInstruction(&instructionStack, INS_ALLOC_VAR_I);          //  7
+    AddOperand(&instructionStack, INS_SAVE_VAR_I, 0);           //  8
+    AddOperand(&instructionStack, INS_LOAD_VAR_I, 0);           // 10
+    AddInt(&instructionStack, INS_LITERAL_I, 0);                // 12
+    AddInstruction(&instructionStack, INS_CMP_I_EQ);            // 15
+    AddJump(&instructionStack, INS_COND_JUMP_B, 28);            // 16
+    AddOperand(&instructionStack, INS_LOAD_VAR_I, 0);           // 19
+    AddInt(&instructionStack, INS_LITERAL_I, -1);               // 21
+    AddInstruction(&instructionStack, INS_ADD_I);               // 24
+    AddJump(&instructionStack, INS_CALL, 7);                    // 25
+    AddInstruction(&instructionStack, INS_DEALLOC_VAR_I);       // 28
+    AddInstruction(&instructionStack, INS_RETURN);
+    return Finish(instructionStack);
+}
+
+int TestRecursion()
+{
+    SStackData instructions = CreateCountdown(5);
+
+    const int I = HS_DATA_SIZE_INT;
+    const int A = HS_DATA_SIZE_ADDRESS;
+
+    SStackUsage usage;
+    Bool8 testResult = AnalyzeStackUsage(instructions, &usage) == R_OK
+        && usage.functionCount == 2
+        && usage.isRecursive
+        && usage.requiredDataSize == -1
+        && usage.functions[1].maxTotalSize == -1
+        && usage.functions[1].argumentSize == I
+        && usage.functions[1].maxLocalSize == 2 * I
+        && usage.callReserve == A + 2 * I;
+
+    // Enough for the whole recursion
+    int levelSize = A + I;
+    SVMData vmData;
+    FuncArray funcArray = { 0 };
+    InitVMForProgram(&vmData, instructions, &usage, 6 * levelSize + usage.callReserve, funcArray);
+
+    while (VMProcessInstructions(&vmData, 1))
+    {
+    }
+
+    testResult = testResult && vmData.error == VM_OK
+        && *vmData.instructionStack.stackPointer == INS_END
+        && vmData.dataStack.base.stackPointer == vmData.dataStack.base.begin
+        && vmData.dataStack.reversePointer == vmData.dataStack.base.end;
+
+    FreeStackUsage(&usage);
+    DeleteVM(&vmData, HS_FALSE, HS_TRUE);
+    return Report("TestRecursion", testResult);
+}
+
+// fib(n) with the argument in an INS_ENTER frame, the result takes its place
+int TestRecursiveFrames()
+{
+    SStackData instructionStack = CreateStack(100);
+    AddInt(&instructionStack, INS_LITERAL_I, 10);
+    AddJump(&instructionStack, INS_CALL, 7);
+    AddInstruction(&instructionStack, INS_END);
+    AddInstruction(&instructionStack, INS_ENTER);                //  7
+    *instructionStack.stackPointer++ = HS_DATA_SIZE_INT;
+    *instructionStack.stackPointer++ = 0;
+    *instructionStack.stackPointer++ = 0;
+    AddOperand(&instructionStack, INS_LOAD_FRAME_I, 0);         // 11
+    AddInt(&instructionStack, INS_LITERAL_I, 2);                // 13
+    AddInstruction(&instructionStack, INS_CMP_I_LESS);          // 16
+    AddJump(&instructionStack, INS_COND_JUMP_B, 38);            // 17
+    AddOperand(&instructionStack, INS_LOAD_FRAME_I, 0);         // 20
+    AddInt(&instructionStack, INS_ADD_LITERAL_I, -1);           // 22
+    AddJump(&instructionStack, INS_CALL, 7);                    // 25
+    AddOperand(&instructionStack, INS_LOAD_FRAME_I, 0);         // 28
+    AddInt(&instructionStack, INS_ADD_LITERAL_I, -2);           // 30
+    AddJump(&instructionStack, INS_CALL, 7);                    // 33
+    AddInstruction(&instructionStack, INS_ADD_I);               // 36
+    AddInstruction(&instructionStack, INS_LEAVE_I);             // 37
+    AddOperand(&instructionStack, INS_LOAD_FRAME_I, 0);         // 38
+    AddInstruction(&instructionStack, INS_LEAVE_I);
+    SStackData instructions = Finish(instructionStack);
+
+    const int I = HS_DATA_SIZE_INT;
+    const int A = HS_DATA_SIZE_ADDRESS;
+
+    SStackUsage usage;
+    Bool8 testResult = AnalyzeStackUsage(instructions, &usage) == R_OK
+        && usage.functionCount == 2
+        && usage.isRecursive
+        && usage.functions[1].argumentSize == I
+        && usage.functions[1].maxLocalSize == 2 * I + A
+        && usage.callReserve == 2 * A + 2 * I;
+
+    SVMData vmData;
+    FuncArray funcArray = { 0 };
+    InitVMForProgram(&vmData, instructions, &usage, 1024, funcArray);
+
+    while (VMProcessInstructions(&vmData, 1))
+    {
+    }
+
+    testResult = testResult && vmData.error == VM_OK
+        && *vmData.instructionStack.stackPointer == INS_END
+        && vmData.dataStack.base.stackPointer == vmData.dataStack.base.begin + I
+        && LoadVarInt(vmData.dataStack.base.begin) == 55
+        && vmData.framePointer == vmData.dataStack.base.begin
+        && vmData.dataStack.reversePointer == vmData.dataStack.base.end;
+
+    FreeStackUsage(&usage);
+    DeleteVM(&vmData, HS_FALSE, HS_TRUE);
+    return Report("TestRecursiveFrames", testResult);
+}
+
+int TestRecursionOverflow()
+{
+    SStackData instructions = CreateCountdown(1000);
+
+    SStackUsage usage;
+    Bool8 testResult = AnalyzeStackUsage(instructions, &usage) == R_OK;
+
+    // The call that would not fit stops the VM before it writes outside of the stack
+    SVMData vmData;
+    FuncArray funcArray = { 0 };
+    InitVMForProgram(&vmData, instructions, &usage, 64, funcArray);
+
+    while (VMProcessInstructions(&vmData, 1))
+    {
+    }
+
+    testResult = testResult && vmData.error == VM_ERROR_STACK_OVERFLOW
+        && *vmData.instructionStack.stackPointer == INS_CALL
+        && vmData.dataStack.reversePointer - vmData.dataStack.base.stackPointer < usage.callReserve;
+
+    FreeStackUsage(&usage);
+    DeleteVM(&vmData, HS_FALSE, HS_TRUE);
+    return Report("TestRecursionOverflow", testResult);
+}
+
+int TestArgumentUnderflow()
+{
+    // main: CALL f, END
+    // f:    ADD_I, RETURN - pops an operand main never pushed
+    SStackData instructionStack = CreateStack(100);
+    AddJump(&instructionStack, INS_CALL, 4);
+    AddInstruction(&instructionStack, INS_END);
+    AddInstruction(&instructionStack, INS_ADD_I);
+    AddInstruction(&instructionStack, INS_RETURN);
+    SStackData instructions = Finish(instructionStack);
+
+    SStackUsage usage;
+    Bool8 testResult = AnalyzeStackUsage(instructions, &usage) == R_ERROR
+        && usage.errorOffset == 0
+        && usage.error != NULL;
+
+    FreeStackUsage(&usage);
+    DeleteStack(instructions);
+    return Report("TestArgumentUnderflow", testResult);
+}
+
+int TestUnbalancedJoin()
+{
+    // LITERAL_B 1, COND_JUMP_B 8, LITERAL_I 1, END - the jump skips the push
+    SStackData instructionStack = CreateStack(100);
+    AddOperand(&instructionStack, INS_LITERAL_B, 1);
+    AddJump(&instructionStack, INS_COND_JUMP_B, 8);
+    AddInt(&instructionStack, INS_LITERAL_I, 1);
+    AddInstruction(&instructionStack, INS_END);
+    SStackData instructions = Finish(instructionStack);
+
+    SStackUsage usage;
+    Bool8 testResult = AnalyzeStackUsage(instructions, &usage) == R_ERROR
+        && usage.error != NULL;
+
+    FreeStackUsage(&usage);
+    DeleteStack(instructions);
+    return Report("TestUnbalancedJoin", testResult);
+}
+
+int main()
+{
+    int fails = 0;
+
+    fails += TestCompiledScript();
+    fails += TestCallChain();
+    fails += TestRecursion();
+    fails += TestRecursiveFrames();
+    fails += TestRecursionOverflow();
+    fails += TestArgumentUnderflow();
+    fails += TestUnbalancedJoin();
+
+    printf("\n%d tests failed\n", fails);
+    return fails;
+}
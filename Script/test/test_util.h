@@ -0,0 +1,102 @@
+#pragma once
+
+#include <stdio.h>
+
+#include "bytecode_c.h"
+
+// Helpers the tests share: the report of a test and the instructions the tests write by hand.
+// Every test file includes this header instead of keeping its own copies.
+
+//------------------------------------------------------------------------------
+// Prints the result of the test, returns 1 when it failed
+static inline int Report(const char* name, Bool8 testResult)
+{
+    printf("%s: ", name);
+    if (testResult)
+    {
+        printf("passed\n");
+    }
+    else
+    {
+        printf("FAILED\n");
+    }
+
+    return 1 - testResult;
+}
+
+//------------------------------------------------------------------------------
+static inline void AddInt(SStackData* instructionStack, EInstruction instruction, hsbint value)
+{
+    AddInstruction(instructionStack, instruction);
+    StoreIntFwd(&instructionStack->stackPointer, value);
+}
+
+//------------------------------------------------------------------------------
+static inline void AddFloat(SStackData* instructionStack, EInstruction instruction, hsbfloat value)
+{
+    AddInstruction(instructionStack, instruction);
+    StoreFloatFwd(&instructionStack->stackPointer, value);
+}
+
+//------------------------------------------------------------------------------
+static inline void AddBool(SStackData* instructionStack, hsbbool value)
+{
+    AddInstruction(instructionStack, INS_LITERAL_B);
+    StoreBoolFwd(&instructionStack->stackPointer, value);
+}
+
+//------------------------------------------------------------------------------
+// An instruction with a variable or frame offset
+static inline void AddOffset(SStackData* instructionStack, EInstruction instruction, int offset)
+{
+    AddInstruction(instructionStack, instruction);
+    *instructionStack->stackPointer++ = offset;
+}
+
+//------------------------------------------------------------------------------
+// Returns the position of the address, to patch it once the target is known:
+// StoreAddress(instructionStack.begin + patch, Here(&instructionStack))
+static inline int AddJump(SStackData* instructionStack, EInstruction instruction, hsbaddress address)
+{
+    AddInstruction(instructionStack, instruction);
+    int position = instructionStack->stackPointer - instructionStack->begin;
+    StoreAddress(instructionStack->stackPointer, address);
+    instructionStack->stackPointer += sizeof(hsbaddress);
+    return position;
+}
+
+//------------------------------------------------------------------------------
+static inline void AddEnter(SStackData* instructionStack, int argumentSize, int intCount, int floatCount)
+{
+    AddInstruction(instructionStack, INS_ENTER);
+    *instructionStack->stackPointer++ = argumentSize;
+    *instructionStack->stackPointer++ = intCount;
+    *instructionStack->stackPointer++ = floatCount;
+}
+
+//------------------------------------------------------------------------------
+static inline void AddCallExt(SStackData* instructionStack, int index, int argumentCount, int floatArguments,
+    ENativeType result)
+{
+    AddInstruction(instructionStack, INS_CALL_EXT);
+    *instructionStack->stackPointer++ = index;
+    *instructionStack->stackPointer++ = argumentCount;
+    *instructionStack->stackPointer++ = floatArguments;
+    *instructionStack->stackPointer++ = result;
+}
+
+//------------------------------------------------------------------------------
+// Address of the next instruction
+static inline hsbaddress Here(SStackData* instructionStack)
+{
+    return instructionStack->stackPointer - instructionStack->begin;
+}
+
+//------------------------------------------------------------------------------
+// The written instructions, ready to run
+static inline SStackData Finish(SStackData instructionStack)
+{
+    instructionStack.end = instructionStack.stackPointer;
+    instructionStack.stackPointer = instructionStack.begin;
+    return instructionStack;
+}
@@ -0,0 +1,248 @@
+#include <stdio.h>
+
+#include "bytecode_c.h"
+#include "compiler.h"
+#include "file.h"
+#include "tiered.h"
+#include "test_util.h"
+
+// Tiered VMs have to end with the same data stack as the plain interpreter, whether
+// and wherever they get promoted
+
+static const int DATA_SIZE = 1024;
+
+static SStackData Copy(SStackData instructions)
+{
+    int size = instructions.end - instructions.begin;
+    SStackData copy = CreateStack(size);
+    memcpy(copy.begin, instructions.begin, size);
+    copy.end = copy.begin + size;
+    return copy;
+}
+
+// A loop in the main program calling a function count times, the function has a loop
+// itself: var n: int; var total: int; function: var j: int; while (j < 3) total = total + j;
+static SStackData CallsProgram(hsbint count)
+{
+    SStackData s = CreateStack(200);
+    AddInstruction(&s, INS_ALLOC_VAR_I); // n
+    AddInstruction(&s, INS_ALLOC_VAR_I); // total
+    hsbaddress callJump = Here(&s);
+    AddJump(&s, INS_JUMP, 0);
+
+    hsbaddress function = Here(&s);
+    AddInstruction(&s, INS_ALLOC_VAR_I); // j, above the return address
+    hsbaddress functionLoop = Here(&s);
+    AddOffset(&s, INS_LOAD_VAR_I, HS_DATA_SIZE_INT + HS_DATA_SIZE_ADDRESS);
+    AddOffset(&s, INS_LOAD_VAR_I, 0);
+    AddInstruction(&s, INS_ADD_I);
+    AddOffset(&s, INS_SAVE_VAR_I, HS_DATA_SIZE_INT + HS_DATA_SIZE_ADDRESS);
+    AddOffset(&s, INS_LOAD_VAR_I, 0);
+    AddInt(&s, INS_LITERAL_I, 1);
+    AddInstruction(&s, INS_ADD_I);
+    AddOffset(&s, INS_SAVE_VAR_I, 0);
+    AddOffset(&s, INS_LOAD_VAR_I, 0);
+    AddInt(&s, INS_LITERAL_I, 3);
+    AddInstruction(&s, INS_CMP_I_LESS);
+    AddJump(&s, INS_COND_JUMP_B, functionLoop);
+    AddInstruction(&s, INS_DEALLOC_VAR_I);
+    AddInstruction(&s, INS_RETURN);
+
+    hsbaddress mainLoop = Here(&s);
+    StoreAddress(s.begin + callJump + 1, mainLoop);
+    AddJump(&s, INS_CALL, function);
+    AddOffset(&s, INS_LOAD_VAR_I, HS_DATA_SIZE_INT);
+    AddInt(&s, INS_LITERAL_I, 1);
+    AddInstruction(&s, INS_ADD_I);
+    AddOffset(&s, INS_SAVE_VAR_I, HS_DATA_SIZE_INT);
+    AddOffset(&s, INS_LOAD_VAR_I, HS_DATA_SIZE_INT);
+    AddInt(&s, INS_LITERAL_I, count);
+    AddInstruction(&s, INS_CMP_I_LESS);
+    AddJump(&s, INS_COND_JUMP_B, mainLoop);
+    AddInstruction(&s, INS_END);
+    return Finish(s);
+}
+
+// countdown(n) calling itself with n - 1 until n is 0, which the verifier rejects
+static SStackData RecursiveProgram()
+{
+    SStackData s = CreateStack(100);
+    AddInt(&s, INS_LITERAL_I, 50);
+    hsbaddress call = Here(&s);
+    AddJump(&s, INS_CALL, 0);
+    AddInstruction(&s, INS_END);
+
+    // the argument moves from the operand stack to a variable above the return address
+    hsbaddress function = Here(&s);
+    StoreAddress(s.begin + call + 1, function);
+    AddInstruction(&s, INS_ALLOC_VAR_I);
+    AddOffset(&s, INS_SAVE_VAR_I, 0);
+    AddOffset(&s, INS_LOAD_VAR_I, 0);
+    AddInt(&s, INS_LITERAL_I, 1);
+    AddInstruction(&s, INS_SUBSTRACT_I);
+    AddInt(&s, INS_LITERAL_I, 0);
+    AddOffset(&s, INS_LOAD_VAR_I, 0);
+    AddInstruction(&s, INS_CMP_I_LESS);
+    hsbaddress recurse = Here(&s);
+    AddJump(&s, INS_COND_JUMP_B, 0);
+    AddOffset(&s, INS_SAVE_VAR_I, 0); // drops n - 1
+    AddInstruction(&s, INS_DEALLOC_VAR_I);
+    AddInstruction(&s, INS_RETURN);
+    StoreAddress(s.begin + recurse + 1, Here(&s));
+    AddJump(&s, INS_CALL, function);
+    AddInstruction(&s, INS_DEALLOC_VAR_I);
+    AddInstruction(&s, INS_RETURN);
+    return Finish(s);
+}
+
+// Runs the instructions tiered in slices of count and compares with the plain interpreter
+static Bool8 IsSameAsInterpreter(SStackData instructions, int threshold, int count, STieredVM* outTiered)
+{
+    SVMData interpreted;
+    FuncArray funcArray = { 0 };
+    InitVM(&interpreted, instructions, DATA_SIZE, funcArray);
+    while (VMProcessInstructions(&interpreted, 1 << 30))
+    {
+    }
+
+    InitTieredVM(outTiered, Copy(instructions), DATA_SIZE, funcArray, threshold);
+    while (TieredProcessInstructions(outTiered, count))
+    {
+    }
+
+    const SVMData* tiered = &outTiered->vm;
+    int operandSize = interpreted.dataStack.base.stackPointer - interpreted.dataStack.base.begin;
+    int varSize = interpreted.dataStack.base.end - interpreted.dataStack.reversePointer;
+    Bool8 result = tiered->dataStack.base.stackPointer - tiered->dataStack.base.begin == operandSize
+        && tiered->dataStack.base.end - tiered->dataStack.reversePointer == varSize
+        && memcmp(interpreted.dataStack.base.begin, tiered->dataStack.base.begin, operandSize) == 0
+        && memcmp(interpreted.dataStack.reversePointer, tiered->dataStack.reversePointer, varSize) == 0
+        && *tiered->instructionStack.stackPointer == INS_END
+        && tiered->error == VM_OK;
+
+    DeleteVM(&interpreted, HS_TRUE, HS_TRUE);
+    return result;
+}
+
+int TestCorpus()
+{
+    const char* corpus[] = { "Sum.hss", "Fibonacci.hss", "Primes.hss", "Physics.hss" };
+
+    Bool8 testResult = HS_TRUE;
+    for (int i = 0; i < (int)(sizeof(corpus) / sizeof(corpus[0])); ++i)
+    {
+        char* code;
+        int size;
+        SStackData instructions;
+        if (!ReadFile(corpus[i], &code, &size) || CompileSource(code, size, &instructions) != R_OK)
+            return Report("TestCorpus", HS_FALSE);
+
+        STieredVM tiered;
+        if (!IsSameAsInterpreter(instructions, 10, 1 << 30, &tiered) || tiered.tier != TIER_OPTIMIZED)
+        {
+            printf("%s differs\n", corpus[i]);
+            testResult = HS_FALSE;
+        }
+
+        DeleteTieredVM(&tiered, HS_TRUE);
+        DeleteStack(instructions);
+        free(code);
+    }
+
+    return Report("TestCorpus", testResult);
+}
+
+int TestColdStaysBaseline()
+{
+    SStackData instructions = CallsProgram(20);
+    STieredVM tiered;
+    Bool8 testResult = IsSameAsInterpreter(instructions, 1000, 1 << 30, &tiered)
+        && tiered.tier == TIER_BASELINE && tiered.promotionAddress == -1;
+
+    // the function loop jumps back twice per call, the main loop 19 times
+    SHotSpot spots[4];
+    int spotCount = GetHotSpots(&tiered, spots, 4);
+    testResult &= spotCount == 3
+        && !spots[0].isFunction && spots[0].count == 40
+        && spots[1].isFunction && spots[1].count == 20
+        && !spots[2].isFunction && spots[2].count == 19;
+
+    DeleteTieredVM(&tiered, HS_TRUE);
+    DeleteStack(instructions);
+    return Report("TestColdStaysBaseline", testResult);
+}
+
+// Promoted at the function entry on the first call, the return address in the variable area
+// has to move to the optimized code
+int TestPromotionInFunction()
+{
+    SStackData instructions = CallsProgram(20);
+    STieredVM tiered;
+    Bool8 testResult = IsSameAsInterpreter(instructions, 1, 1 << 30, &tiered)
+        && tiered.tier == TIER_OPTIMIZED
+        && tiered.promotionAddress == 5
+        && tiered.optimized.end - tiered.optimized.begin < instructions.end - instructions.begin;
+
+    DeleteTieredVM(&tiered, HS_TRUE);
+    DeleteStack(instructions);
+    return Report("TestPromotionInFunction", testResult);
+}
+
+// The loop in the function gets hot during the first call
+int TestPromotionAtLoopHeader()
+{
+    SStackData instructions = CallsProgram(20);
+    STieredVM tiered;
+    Bool8 testResult = IsSameAsInterpreter(instructions, 2, 1 << 30, &tiered)
+        && tiered.tier == TIER_OPTIMIZED
+        && tiered.promotionAddress == 6;
+
+    DeleteTieredVM(&tiered, HS_TRUE);
+    DeleteStack(instructions);
+    return Report("TestPromotionAtLoopHeader", testResult);
+}
+
+int TestTimeSlices()
+{
+    SStackData instructions = CallsProgram(20);
+    Bool8 testResult = HS_TRUE;
+    for (int count = 1; count < 8; ++count)
+    {
+        STieredVM tiered;
+        testResult &= IsSameAsInterpreter(instructions, 7, count, &tiered) && tiered.tier == TIER_OPTIMIZED;
+        DeleteTieredVM(&tiered, HS_TRUE);
+    }
+
+    DeleteStack(instructions);
+    return Report("TestTimeSlices", testResult);
+}
+
+int TestRecursionStaysBaseline()
+{
+    SStackData instructions = RecursiveProgram();
+    STieredVM tiered;
+    Bool8 testResult = IsSameAsInterpreter(instructions, 10, 1 << 30, &tiered)
+        && tiered.tier == TIER_BASELINE;
+
+    SHotSpot spot;
+    testResult &= GetHotSpots(&tiered, &spot, 1) == 1 && spot.isFunction && spot.count == 51;
+
+    DeleteTieredVM(&tiered, HS_TRUE);
+    DeleteStack(instructions);
+    return Report("TestRecursionStaysBaseline", testResult);
+}
+
+int main()
+{
+    int fails = 0;
+
+    fails += TestCorpus();
+    fails += TestColdStaysBaseline();
+    fails += TestPromotionInFunction();
+    fails += TestPromotionAtLoopHeader();
+    fails += TestTimeSlices();
+    fails += TestRecursionStaysBaseline();
+
+    printf("\n%d tests failed\n", fails);
+    return fails;
+}
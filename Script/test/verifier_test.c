@@ -0,0 +1,295 @@
+#include <stdio.h>
+
+#include "bytecode_c.h"
+#include "compiler.h"
+#include "optimizer.h"
+#include "verifier.h"
+#include "test_util.h"
+
+static const int DATA_SIZE = 200;
+
+static void AddOperand(SStackData* instructionStack, EInstruction instruction, int operand)
+{
+    AddInstruction(instructionStack, instruction);
+    *instructionStack->stackPointer++ = operand;
+}
+
+// The program has to be rejected at the offset
+static int ExpectError(const char* name, SStackData instructionStack, int dataSize, int errorOffset)
+{
+    SStackData instructions = Finish(instructionStack);
+
+    SVerifyResult result;
+    Bool8 testResult = VerifyInstructions(instructions, dataSize, &result) == R_ERROR
+        && result.errorOffset == errorOffset
+        && result.error != NULL;
+
+    if (!testResult)
+        printf("Got offset %d: %s\n", result.errorOffset, result.error ? result.error : "no error");
+
+    DeleteStack(instructions);
+    return Report(name, testResult);
+}
+
+int TestCompiledScript()
+{
+    char code[] =
+        "var i: int = 0;"
+        "var sum: int = 0;"
+        "var f: float = 0.5;"
+        "while (i < 100)"
+        "{"
+        "    var twice: int = i * 2;"
+        "    if (twice > 10) sum = sum + twice;"
+        "    f = f * 1.5;"
+        "    i = i + 1;"
+        "}";
+
+    SStackData instructions;
+    Bool8 testResult = CompileSource(code, strlen(code), &instructions) == R_OK;
+    testResult = testResult && FuseSuperinstructions(&instructions) == R_OK;
+
+    SVerifyResult result;
+    testResult = testResult && VerifyInstructions(instructions, DATA_SIZE, &result) == R_OK
+        && result.errorOffset == -1
+        && result.maxDataSize > 0
+        && result.maxDataSize <= DATA_SIZE;
+
+    // The unchecked interpreter computes the same as the checked one
+    SVMData vmData;
+    SVMData verifiedVmData;
+    FuncArray funcArray = { 0 };
+    InitVM(&vmData, instructions, DATA_SIZE, funcArray);
+    InitVM(&verifiedVmData, instructions, DATA_SIZE, funcArray);
+
+    while (VMProcessInstructions(&vmData, 1))
+    {
+    }
+    VMRunVerified(&verifiedVmData);
+
+    int varSize = vmData.dataStack.base.end - vmData.dataStack.reversePointer;
+    testResult = testResult
+        && verifiedVmData.dataStack.base.end - verifiedVmData.dataStack.reversePointer == varSize
+        && memcmp(vmData.dataStack.reversePointer, verifiedVmData.dataStack.reversePointer, varSize) == 0
+        && LoadVarInt(vmData.dataStack.reversePointer + HS_DATA_SIZE_FLOAT) == 9870;
+
+    DeleteVM(&vmData, HS_TRUE, HS_TRUE);
+    DeleteVM(&verifiedVmData, HS_FALSE, HS_TRUE);
+    return Report("TestCompiledScript", testResult);
+}
+
+int TestFunction()
+{
+    // main: LITERAL_I 2, CALL f, END
+    // f: LITERAL_I 40, ADD_I, RETURN
+    SStackData instructionStack = CreateStack(100);
+    AddInt(&instructionStack, INS_LITERAL_I, 2);
+    AddJump(&instructionStack, INS_CALL, 7);
+    AddInstruction(&instructionStack, INS_END);
+    AddInt(&instructionStack, INS_LITERAL_I, 40);
+    AddInstruction(&instructionStack, INS_ADD_I);
+    AddInstruction(&instructionStack, INS_RETURN);
+    SStackData instructions = Finish(instructionStack);
+
+    SVerifyResult result;
+    Bool8 testResult = VerifyInstructions(instructions, DATA_SIZE, &result) == R_OK
+        && result.maxDataSize == 2 * HS_DATA_SIZE_INT + HS_DATA_SIZE_ADDRESS;
+
+    SVMData vmData;
+    FuncArray funcArray = { 0 };
+    InitVM(&vmData, instructions, DATA_SIZE, funcArray);
+    VMRunVerified(&vmData);
+
+    testResult = testResult && LoadVarInt(vmData.dataStack.base.begin) == 42
+        && *vmData.instructionStack.stackPointer == INS_END;
+
+    DeleteVM(&vmData, HS_FALSE, HS_TRUE);
+    return Report("TestFunction", testResult);
+}
+
+int TestFrame()
+{
+    // main: LITERAL_I 2, CALL f, END
+    // f: ENTER a, 1 int, LOAD_FRAME_I a, ADD_LITERAL_I 40, SAVE_FRAME_I local, LOAD_FRAME_I local, LEAVE_I
+    SStackData instructionStack = CreateStack(100);
+    AddInt(&instructionStack, INS_LITERAL_I, 2);
+    AddJump(&instructionStack, INS_CALL, 7);
+    AddInstruction(&instructionStack, INS_END);
+    AddEnter(&instructionStack, HS_DATA_SIZE_INT, 1, 0);
+    AddOperand(&instructionStack, INS_LOAD_FRAME_I, 0);
+    AddInt(&instructionStack, INS_ADD_LITERAL_I, 40);
+    AddOperand(&instructionStack, INS_SAVE_FRAME_I, HS_DATA_SIZE_INT);
+    AddOperand(&instructionStack, INS_LOAD_FRAME_I, HS_DATA_SIZE_INT);
+    AddInstruction(&instructionStack, INS_LEAVE_I);
+    SStackData instructions = Finish(instructionStack);
+
+    SVerifyResult result;
+    Bool8 testResult = VerifyInstructions(instructions, DATA_SIZE, &result) == R_OK
+        && result.maxDataSize == 3 * HS_DATA_SIZE_INT + 2 * HS_DATA_SIZE_ADDRESS;
+
+    SVMData vmData;
+    FuncArray funcArray = { 0 };
+    InitVM(&vmData, instructions, DATA_SIZE, funcArray);
+    VMRunVerified(&vmData);
+
+    testResult = testResult && LoadVarInt(vmData.dataStack.base.begin) == 42
+        && vmData.dataStack.base.stackPointer == vmData.dataStack.base.begin + HS_DATA_SIZE_INT
+        && vmData.framePointer == vmData.dataStack.base.begin
+        && *vmData.instructionStack.stackPointer == INS_END;
+
+    DeleteVM(&vmData, HS_FALSE, HS_TRUE);
+    return Report("TestFrame", testResult);
+}
+
+int TestFrameType()
+{
+    SStackData instructionStack = CreateStack(100);
+    AddInt(&instructionStack, INS_LITERAL_I, 2);
+    AddJump(&instructionStack, INS_CALL, 7);
+    AddInstruction(&instructionStack, INS_END);
+    AddEnter(&instructionStack, HS_DATA_SIZE_INT, 0, 0);
+    AddOperand(&instructionStack, INS_LOAD_FRAME_F, 0);
+    AddInstruction(&instructionStack, INS_LEAVE_F);
+    return ExpectError("TestFrameType", instructionStack, DATA_SIZE, 11);
+}
+
+int TestReturnInsideFrame()
+{
+    SStackData instructionStack = CreateStack(100);
+    AddInt(&instructionStack, INS_LITERAL_I, 2);
+    AddJump(&instructionStack, INS_CALL, 7);
+    AddInstruction(&instructionStack, INS_END);
+    AddEnter(&instructionStack, HS_DATA_SIZE_INT, 0, 0);
+    AddInstruction(&instructionStack, INS_RETURN);
+    return ExpectError("TestReturnInsideFrame", instructionStack, DATA_SIZE, 11);
+}
+
+int TestJumpIntoInstruction()
+{
+    SStackData instructionStack = CreateStack(100);
+    AddInt(&instructionStack, INS_LITERAL_I, 2);
+    AddJump(&instructionStack, INS_JUMP, 1);
+    AddInstruction(&instructionStack, INS_END);
+    return ExpectError("TestJumpIntoInstruction", instructionStack, DATA_SIZE, 3);
+}
+
+int TestRunsPastEnd()
+{
+    SStackData instructionStack = CreateStack(100);
+    AddInt(&instructionStack, INS_LITERAL_I, 2);
+    AddInstruction(&instructionStack, INS_NOOP);
+    return ExpectError("TestRunsPastEnd", instructionStack, DATA_SIZE, 3);
+}
+
+int TestUnderflow()
+{
+    SStackData instructionStack = CreateStack(100);
+    AddInt(&instructionStack, INS_LITERAL_I, 2);
+    AddInstruction(&instructionStack, INS_ADD_I);
+    AddInstruction(&instructionStack, INS_END);
+    return ExpectError("TestUnderflow", instructionStack, DATA_SIZE, 3);
+}
+
+int TestTypeMismatch()
+{
+    SStackData instructionStack = CreateStack(100);
+    AddInt(&instructionStack, INS_LITERAL_I, 2);
+    AddInt(&instructionStack, INS_LITERAL_I, 3);
+    AddInstruction(&instructionStack, INS_ADD_F);
+    AddInstruction(&instructionStack, INS_END);
+    return ExpectError("TestTypeMismatch", instructionStack, DATA_SIZE, 6);
+}
+
+int TestInvalidVariable()
+{
+    SStackData instructionStack = CreateStack(100);
+    AddInstruction(&instructionStack, INS_ALLOC_VAR_I);
+    AddOperand(&instructionStack, INS_LOAD_VAR_I, 0);
+    AddOperand(&instructionStack, INS_LOAD_VAR_I, HS_DATA_SIZE_INT);
+    AddInstruction(&instructionStack, INS_END);
+    return ExpectError("TestInvalidVariable", instructionStack, DATA_SIZE, 3);
+}
+
+int TestVariableType()
+{
+    SStackData instructionStack = CreateStack(100);
+    AddInstruction(&instructionStack, INS_ALLOC_VAR_F);
+    AddOperand(&instructionStack, INS_LOAD_VAR_I, 0);
+    AddInstruction(&instructionStack, INS_END);
+    return ExpectError("TestVariableType", instructionStack, DATA_SIZE, 1);
+}
+
+int TestOverflow()
+{
+    // two ints fit, the third does not
+    SStackData instructionStack = CreateStack(100);
+    AddInt(&instructionStack, INS_LITERAL_I, 1);
+    AddInt(&instructionStack, INS_LITERAL_I, 2);
+    AddInt(&instructionStack, INS_LITERAL_I, 3);
+    AddInstruction(&instructionStack, INS_END);
+    return ExpectError("TestOverflow", instructionStack, 2 * HS_DATA_SIZE_INT, 6);
+}
+
+int TestLoopGrowsStack()
+{
+    // every iteration leaves one more value on the stack
+    SStackData instructionStack = CreateStack(100);
+    AddInt(&instructionStack, INS_LITERAL_I, 1);
+    AddJump(&instructionStack, INS_JUMP, 0);
+    return ExpectError("TestLoopGrowsStack", instructionStack, DATA_SIZE, 3);
+}
+
+int TestSwitchTable()
+{
+    // the table has room for the default and one case, the case is not a jump
+    SStackData instructionStack = CreateStack(100);
+    AddInt(&instructionStack, INS_LITERAL_I, 2);
+    AddInt(&instructionStack, INS_SWITCH, 0);
+    *instructionStack.stackPointer++ = 1;
+    AddJump(&instructionStack, INS_JUMP, 11);
+    AddInstruction(&instructionStack, INS_NOOP);
+    AddInstruction(&instructionStack, INS_END);
+    return ExpectError("TestSwitchTable", instructionStack, DATA_SIZE, 3);
+}
+
+int TestReturnOutsideFunction()
+{
+    SStackData instructionStack = CreateStack(100);
+    AddInstruction(&instructionStack, INS_NOOP);
+    AddInstruction(&instructionStack, INS_RETURN);
+    return ExpectError("TestReturnOutsideFunction", instructionStack, DATA_SIZE, 1);
+}
+
+int TestRecursion()
+{
+    // f calls itself, the stack grows without bound
+    SStackData instructionStack = CreateStack(100);
+    AddJump(&instructionStack, INS_CALL, 4);
+    AddInstruction(&instructionStack, INS_END);
+    AddJump(&instructionStack, INS_CALL, 4);
+    AddInstruction(&instructionStack, INS_RETURN);
+    return ExpectError("TestRecursion", instructionStack, DATA_SIZE, 4);
+}
+
+int main()
+{
+    int fails = 0;
+    fails += TestCompiledScript();
+    fails += TestFunction();
+    fails += TestFrame();
+    fails += TestFrameType();
+    fails += TestReturnInsideFrame();
+    fails += TestJumpIntoInstruction();
+    fails += TestRunsPastEnd();
+    fails += TestUnderflow();
+    fails += TestTypeMismatch();
+    fails += TestInvalidVariable();
+    fails += TestVariableType();
+    fails += TestOverflow();
+    fails += TestLoopGrowsStack();
+    fails += TestSwitchTable();
+    fails += TestReturnOutsideFunction();
+    fails += TestRecursion();
+
+    return fails;
+}
@@ -0,0 +1,187 @@
+#include <stdio.h>
+
+#include "bytecode_c.h"
+#include "embed.h"
+#include "wide_vm.h"
+#include "test_util.h"
+
+// void(int)
+static void NativeNothing(SVMData* vmData)
+{
+    PopInt(&vmData->dataStack.base.stackPointer);
+}
+
+static char s_functions[] =
+    "fun update(position: float, velocity: float, dt: float): float { return position + velocity * dt; }\n"
+    "fun clamp(value: int, low: int, high: int): int\n"
+    "{\n"
+    "    if (value < low) return low;\n"
+    "    if (value > high) { var h: int = high; return h; }\n"
+    "    return value;\n"
+    "}\n"
+    "fun scale(value: int, factor: float): float\n"
+    "{\n"
+    "    var result: float = 0.0;\n"
+    "    var i: int = 0;\n"
+    "    while (i < value) { result = result + factor; i = i + 1; }\n"
+    "    if (result < 2.0) { result = -result; } else { result = result / 2.0; }\n"
+    "    return result;\n"
+    "}\n"
+    "fun dense(value: int): int\n"
+    "{\n"
+    "    switch (value) { case 0: return 10; case 1: value = 7; case 2: return value * 3; case 3: return 0; }\n"
+    "    return value / 2 - 1000;\n"
+    "}\n"
+    "fun sparse(value: int): int\n"
+    "{\n"
+    "    var r: int = 1;\n"
+    "    switch (value) { case -100: r = 2; case 50: r = r + 3; case 3000: { var x: int = 4; r = r * x; } default: r = r - 1; }\n"
+    "    return r;\n"
+    "}\n"
+    "fun wrap(value: int): int { var w: int = value * 1000; if (w < 0) w = w + 1; return w; }\n"
+    "fun steps(n: int): int\n"
+    "{\n"
+    "    var s: int = 0;\n"
+    "    while (n > 1) { if (n - n / 2 * 2 == 0) n = n / 2; else n = 3 * n + 1; s = s + 1; }\n"
+    "    return s;\n"
+    "}\n";
+
+// Rows 0 to 36, not a multiple of the lanes, with values that branch differently in every group
+int TestMatchesBatch()
+{
+    SProgram program;
+    if (CreateProgram(s_functions, strlen(s_functions), NULL, &program) != R_OK)
+        return Report("TestMatchesBatch", HS_FALSE);
+
+    SScriptContext context;
+    InitScriptContext(&context, &program);
+    SWideContext wide;
+    InitWideContext(&wide, &program);
+
+    enum { ROWS = 37 };
+    hsbint values[ROWS], lows[ROWS], highs[ROWS];
+    hsbfloat positions[ROWS], velocities[ROWS], deltas[ROWS];
+    for (int row = 0; row < ROWS; ++row)
+    {
+        values[row] = (hsbint)((row * 37) % 11 - 3);
+        lows[row] = (hsbint)(row % 3 - 1);
+        highs[row] = (hsbint)(row % 5 + 1);
+        positions[row] = row * 0.5f;
+        velocities[row] = row * -0.25f;
+        deltas[row] = 1.0f / (row + 1);
+    }
+    // cases of the sparse switch and values that wrap
+    values[4] = -100;
+    values[9] = 50;
+    values[20] = 3000;
+    values[30] = 32000;
+    values[31] = -32000;
+
+    const char* names[] = { "update", "clamp", "scale", "dense", "sparse", "wrap" };
+    const void* floatInputs[] = { positions, velocities, deltas };
+    const void* intInputs[] = { values, lows, highs };
+    const void* scaleInputs[] = { values, velocities };
+
+    Bool8 testResult = HS_TRUE;
+    for (int i = 0; i < 6 && testResult; ++i)
+    {
+        int function = FindFunction(&program, names[i]);
+        const SNativeSignature* signature = &program.functions.functions[function].signature;
+        const void* const* inputs = i == 0 ? floatInputs : i == 2 ? scaleInputs : intInputs;
+
+        // ints and floats have the same size, the columns compare as bytes
+        hsbfloat batch[ROWS], wideResults[ROWS];
+        memset(batch, 0, sizeof(batch));
+        memset(wideResults, 0, sizeof(wideResults));
+        testResult = CallFunctionBatch(&context, function, inputs, signature->argumentCount, batch, ROWS) == R_OK
+            && CallFunctionWide(&wide, function, inputs, signature->argumentCount, wideResults, ROWS) == R_OK
+            && memcmp(batch, wideResults, sizeof(batch)) == 0;
+        if (!testResult)
+            printf("%s differs\n", names[i]);
+    }
+
+    DeleteWideContext(&wide);
+    DeleteScriptContext(&context);
+    DeleteProgram(&program);
+    return Report("TestMatchesBatch", testResult);
+}
+
+// Every lane loops a different number of times, the results are the known step counts
+int TestDivergentLoops()
+{
+    SProgram program;
+    if (CreateProgram(s_functions, strlen(s_functions), NULL, &program) != R_OK)
+        return Report("TestDivergentLoops", HS_FALSE);
+
+    SWideContext wide;
+    InitWideContext(&wide, &program);
+
+    hsbint values[] = { 1, 27, 2, 3, 6, 7, 1, 9, 27, 2 };
+    hsbint expected[] = { 0, 111, 1, 7, 8, 16, 0, 19, 111, 1 };
+    hsbint results[10];
+    const void* inputs[] = { values };
+    Bool8 testResult = CallFunctionWide(&wide, FindFunction(&program, "steps"), inputs, 1, results, 10) == R_OK
+        && memcmp(results, expected, sizeof(results)) == 0;
+
+    // No rows, no outputs
+    testResult = testResult
+        && CallFunctionWide(&wide, FindFunction(&program, "steps"), inputs, 1, results, 0) == R_OK
+        && CallFunctionWide(&wide, FindFunction(&program, "steps"), inputs, 1, NULL, 10) == R_OK;
+
+    DeleteWideContext(&wide);
+    DeleteProgram(&program);
+    return Report("TestDivergentLoops", testResult);
+}
+
+// Functions with calls run with CallFunctionBatch only
+int TestRejected()
+{
+    SNativeTable natives;
+    InitNativeTable(&natives);
+    RegisterNative(&natives, "nothing", "void(int)", NativeNothing);
+
+    char code[] =
+        "fun twice(value: int): int { return value * 2; }\n"
+        "fun callsScript(value: int): int { return twice(value) + 1; }\n"
+        "fun callsNative(value: int) { nothing(value); }\n";
+
+    SProgram program;
+    if (CreateProgram(code, strlen(code), &natives, &program) != R_OK)
+    {
+        DeleteNativeTable(&natives);
+        return Report("TestRejected", HS_FALSE);
+    }
+    DeleteNativeTable(&natives);
+
+    SWideContext wide;
+    InitWideContext(&wide, &program);
+
+    hsbint values[] = { 1, 2, 3 };
+    hsbint results[3];
+    const void* inputs[] = { values };
+    Bool8 testResult = CanRunWide(&program, FindFunction(&program, "twice"))
+        && !CanRunWide(&program, FindFunction(&program, "callsScript"))
+        && !CanRunWide(&program, FindFunction(&program, "callsNative"))
+        && !CanRunWide(&program, -1)
+        && !CanRunWide(&program, program.functions.count)
+        && CallFunctionWide(&wide, FindFunction(&program, "callsScript"), inputs, 1, results, 3) == R_ERROR
+        && CallFunctionWide(&wide, FindFunction(&program, "twice"), inputs, 2, results, 3) == R_ERROR
+        && CallFunctionWide(&wide, FindFunction(&program, "twice"), inputs, 1, results, 3) == R_OK
+        && results[0] == 2 && results[1] == 4 && results[2] == 6;
+
+    DeleteWideContext(&wide);
+    DeleteProgram(&program);
+    return Report("TestRejected", testResult);
+}
+
+int main()
+{
+    int fails = 0;
+
+    fails += TestMatchesBatch();
+    fails += TestDivergentLoops();
+    fails += TestRejected();
+
+    printf("\n%d tests failed\n", fails);
+    return fails;
+}
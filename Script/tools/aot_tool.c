@@ -0,0 +1,99 @@
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "aot.h"
+#include "bytecode_c.h"
+#include "compiler.h"
+#include "optimizer.h"
+#include "file.h"
+
+// Translates a script to C source to compile into the host instead of interpreting it.
+//
+// Usage: aot_tool [-fused] [-name Function] [-o file.c] file.hss
+//   -fused     run FuseSuperinstructions before translating
+//   -name      name of the generated function (default Run<file name>)
+//   -o         output file (default stdout)
+//
+// The host sets up a VM with the same instructions (the compiled script) and calls the
+// generated function where it would call VMRunVerified.
+
+static const int MAX_NAME = 64;
+
+// Run followed by the file name without directories and extension, as an identifier
+static void DefaultName(const char* path, char* name)
+{
+    const char* fileName = path;
+    for (const char* c = path; *c; ++c)
+    {
+        if (*c == '/' || *c == '\\')
+            fileName = c + 1;
+    }
+
+    strcpy(name, "Run");
+    int length = 3;
+    for (const char* c = fileName; *c && *c != '.' && length < MAX_NAME - 1; ++c)
+        name[length++] = isalnum((unsigned char)*c) ? *c : '_';
+    name[length] = 0;
+}
+
+int main(int argc, char** argv)
+{
+    Bool8 fused = HS_FALSE;
+    const char* name = NULL;
+    const char* outName = NULL;
+
+    int arg = 1;
+    for (; arg < argc && argv[arg][0] == '-'; ++arg)
+    {
+        if (strcmp(argv[arg], "-fused") == 0)
+            fused = HS_TRUE;
+        else if (strcmp(argv[arg], "-name") == 0 && arg + 1 < argc)
+            name = argv[++arg];
+        else if (strcmp(argv[arg], "-o") == 0 && arg + 1 < argc)
+            outName = argv[++arg];
+        else
+            break;
+    }
+
+    if (arg + 1 != argc)
+    {
+        printf("Usage: %s [-fused] [-name Function] [-o file.c] file.hss\n", argv[0]);
+        return 1;
+    }
+
+    char defaultName[MAX_NAME];
+    if (!name)
+    {
+        DefaultName(argv[arg], defaultName);
+        name = defaultName;
+    }
+
+    char* code;
+    int size;
+    if (!ReadFile(argv[arg], &code, &size))
+        return 1;
+
+    SStackData instructions;
+    if (CompileSource(code, size, &instructions) != R_OK
+        || (fused && FuseSuperinstructions(&instructions) != R_OK))
+    {
+        printf("Failed to compile %s\n", argv[arg]);
+        return 1;
+    }
+
+    FILE* out = outName ? fopen(outName, "wb") : stdout;
+    if (!out)
+    {
+        printf("Cannot open %s\n", outName);
+        return 1;
+    }
+
+    EResult result = TranslateToC(instructions, name, out);
+
+    if (outName)
+        fclose(out);
+    DeleteStack(instructions);
+    free(code);
+    return result == R_OK ? 0 : 1;
+}
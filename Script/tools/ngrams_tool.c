@@ -0,0 +1,174 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bytecode_c.h"
+#include "bytecode_info.h"
+#include "compiler.h"
+#include "optimizer.h"
+#include "file.h"
+
+// Counts opcode n-grams over compiled scripts to pick which sequences to fuse.
+//
+// Usage: ngrams_tool [-n N] [-dynamic] [-fused] file.hss...
+//   -n N       length of the sequences, 1 to 3 (default 2)
+//   -dynamic   count the executed instruction stream instead of the compiled code
+//   -fused     run FuseSuperinstructions before counting
+
+static const int DATA_SIZE = 1024;
+static const int MAX_N = 3;
+static const int NUM_PRINTED = 30;
+
+typedef struct
+{
+    int n;
+    int* counts; // Indexed by the n-gram as a number in base INS_COUNT
+    int total;
+
+    EInstruction window[3];
+    int windowSize;
+} SNGramCounter;
+
+static void ResetWindow(SNGramCounter* counter)
+{
+    counter->windowSize = 0;
+}
+
+static void CountInstruction(SNGramCounter* counter, EInstruction instruction)
+{
+    if (counter->windowSize == counter->n)
+    {
+        for (int i = 1; i < counter->n; ++i)
+            counter->window[i - 1] = counter->window[i];
+        --counter->windowSize;
+    }
+    counter->window[counter->windowSize++] = instruction;
+
+    if (counter->windowSize == counter->n)
+    {
+        int index = 0;
+        for (int i = 0; i < counter->n; ++i)
+            index = index * INS_COUNT + counter->window[i];
+        ++counter->counts[index];
+        ++counter->total;
+    }
+}
+
+static void CountStatic(SNGramCounter* counter, SStackData instructions)
+{
+    for (byte* ins = instructions.begin; ins < instructions.end; ins += GetInstructionSize(*ins))
+        CountInstruction(counter, *ins);
+}
+
+static void CountDynamic(SNGramCounter* counter, SStackData instructions)
+{
+    SVMData vmData;
+    FuncArray funcArray = { 0 };
+    InitVM(&vmData, instructions, DATA_SIZE, funcArray);
+
+    Bool8 running = HS_TRUE;
+    while (running)
+    {
+        CountInstruction(counter, *vmData.instructionStack.stackPointer);
+        running = VMProcessInstructions(&vmData, 1);
+    }
+
+    DeleteVM(&vmData, HS_TRUE, HS_TRUE);
+}
+
+static int* g_Counts;
+
+static int CompareCounts(const void* a, const void* b)
+{
+    return g_Counts[*(const int*)b] - g_Counts[*(const int*)a];
+}
+
+static void PrintNGrams(SNGramCounter* counter, int numNGrams)
+{
+    int* order = malloc(numNGrams * sizeof(int));
+    for (int i = 0; i < numNGrams; ++i)
+        order[i] = i;
+
+    g_Counts = counter->counts;
+    qsort(order, numNGrams, sizeof(int), CompareCounts);
+
+    printf("%d %d-grams\n", counter->total, counter->n);
+    for (int i = 0; i < numNGrams && i < NUM_PRINTED && counter->counts[order[i]] > 0; ++i)
+    {
+        int count = counter->counts[order[i]];
+        printf("%8d %6.2f%% ", count, 100.0 * count / counter->total);
+
+        EInstruction nGram[3];
+        int index = order[i];
+        for (int j = counter->n - 1; j >= 0; --j)
+        {
+            nGram[j] = index % INS_COUNT;
+            index /= INS_COUNT;
+        }
+        for (int j = 0; j < counter->n; ++j)
+            printf(" %s", GetInstructionName(nGram[j]));
+        printf("\n");
+    }
+
+    free(order);
+}
+
+int main(int argc, char** argv)
+{
+    SNGramCounter counter = { .n = 2 };
+    Bool8 dynamic = HS_FALSE;
+    Bool8 fused = HS_FALSE;
+
+    int arg = 1;
+    for (; arg < argc && argv[arg][0] == '-'; ++arg)
+    {
+        if (strcmp(argv[arg], "-n") == 0 && arg + 1 < argc)
+            counter.n = atoi(argv[++arg]);
+        else if (strcmp(argv[arg], "-dynamic") == 0)
+            dynamic = HS_TRUE;
+        else if (strcmp(argv[arg], "-fused") == 0)
+            fused = HS_TRUE;
+        else
+            break;
+    }
+
+    if (arg == argc || counter.n < 1 || counter.n > MAX_N)
+    {
+        printf("Usage: %s [-n 1..%d] [-dynamic] [-fused] file.hss...\n", argv[0], MAX_N);
+        return 1;
+    }
+
+    int numNGrams = 1;
+    for (int i = 0; i < counter.n; ++i)
+        numNGrams *= INS_COUNT;
+    counter.counts = calloc(numNGrams, sizeof(int));
+
+    for (; arg < argc; ++arg)
+    {
+        char* code;
+        int size;
+        if (!ReadFile(argv[arg], &code, &size))
+            return 1;
+
+        SStackData instructions;
+        if (CompileSource(code, size, &instructions) != R_OK
+            || (fused && FuseSuperinstructions(&instructions) != R_OK))
+        {
+            printf("Failed to compile %s\n", argv[arg]);
+            return 1;
+        }
+
+        ResetWindow(&counter);
+        if (dynamic)
+            CountDynamic(&counter, instructions);
+        else
+            CountStatic(&counter, instructions);
+
+        DeleteStack(instructions);
+        free(code);
+    }
+
+    PrintNGrams(&counter, numNGrams);
+
+    free(counter.counts);
+    return 0;
+}
@@ -7,7 +7,16 @@
 	exit /B 1
 )
 
-clang -g -O0 -std=c99 -D_CRT_SECURE_NO_WARNINGS -o Build/test/TestMain.exe -I Script/include Script/test/%1_test.c
+@rem Everything except the program entry point is linked into the test, extra parameters are passed to the compiler (e.g. -DHS_SLOT_STACK)
+@pushd "Script/src"
+@set objs=
+@for /R %%f in (*.c) do @if /I not "%%~nxf" == "main.c" @call set objs=%%objs%% %%f
+@popd
+
+@set flags=
+@for /f "tokens=1,* delims= " %%a in ("%*") do @set flags=%%b
+
+clang -g -O0 -std=c99 -D_CRT_SECURE_NO_WARNINGS %flags% -o Build/test/TestMain.exe -I Script/include Script/test/%1_test.c %objs%
 
 @echo off
 set err=%errorlevel%
@@ -0,0 +1,31 @@
+@if not exist Build\tools\ (
+    @mkdir Build\tools
+)
+
+@if "%~1" == "" (
+	echo "Error: First parameter needs to be name of the tool to run"
+	exit /B 1
+)
+
+@rem Everything except the program entry point is linked into the tool, extra parameters are passed to the tool
+@pushd "Script/src"
+@set objs=
+@for /R %%f in (*.c) do @if /I not "%%~nxf" == "main.c" @call set objs=%%objs%% %%f
+@popd
+
+@set args=
+@for /f "tokens=1,* delims= " %%a in ("%*") do @set args=%%b
+
+clang -O2 -DNDEBUG -std=c99 -D_CRT_SECURE_NO_WARNINGS -o Build/tools/%1.exe -I Script/include Script/tools/%1_tool.c %objs%
+
+@echo off
+set err=%errorlevel%
+
+if %err% NEQ 0 (
+    exit /B 1
+)
+
+pushd Data
+..\Build\tools\%1.exe %args%
+
+popd